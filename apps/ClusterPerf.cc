@@ -56,6 +56,7 @@ namespace po = boost::program_options;
 #include "BasicTransport.h"
 #include "btreeRamCloud/Btree.h"
 #include "ClientLeaseAgent.h"
+#include "CoroutineScheduler.h"
 #include "IndexLookup.h"
 #include "TimeTrace.h"
 #include "Transaction.h"
@@ -6594,6 +6595,83 @@ readNotFound()
     printTime("readNotFound", t, "read object that doesn't exist");
 }
 
+// A single client keeps a varying number of reads of a single object in
+// flight, first with hand-written asynchronous code (an array of ReadRpcs
+// that is refilled as they complete) and then with coroutines (each of
+// which issues reads in a loop using CoroutineScheduler). The throughput
+// of the two should be the same.
+void
+readPipelined()
+{
+    if (clientIndex != 0)
+        return;
+
+    const char* key = "123456789012345678901234567890";
+    uint16_t keyLength = downCast<uint16_t>(strlen(key));
+    Buffer input;
+    fillBuffer(input, objectSize, dataTable, key, keyLength);
+    cluster->write(dataTable, key, keyLength,
+            input.getRange(0, objectSize), objectSize);
+
+    uint64_t runCycles = Cycles::fromSeconds(.5);
+    const int maxDepth = 64;
+    const int depths[] = {1, 4, 16, maxDepth};
+    foreach (int depth, depths) {
+        // Hand-written asynchronous code.
+        Tub<ReadRpc> rpcs[maxDepth];
+        Buffer values[maxDepth];
+        uint64_t count = 0;
+        uint64_t start = Cycles::rdtsc();
+        uint64_t stop = start + runCycles;
+        int outstanding = 0;
+        for (int i = 0; i < depth; i++) {
+            rpcs[i].construct(cluster, dataTable, key, keyLength, &values[i]);
+            outstanding++;
+        }
+        while (outstanding > 0) {
+            cluster->poll();
+            bool more = Cycles::rdtsc() < stop;
+            for (int i = 0; i < depth; i++) {
+                if (!rpcs[i] || !rpcs[i]->isReady())
+                    continue;
+                rpcs[i]->wait();
+                count++;
+                if (more) {
+                    rpcs[i].construct(cluster, dataTable, key, keyLength,
+                            &values[i]);
+                } else {
+                    rpcs[i].destroy();
+                    outstanding--;
+                }
+            }
+        }
+        double rate = static_cast<double>(count) /
+                Cycles::toSeconds(Cycles::rdtsc() - start);
+        printRate(format("readPipelined.async.%d", depth).c_str(), rate,
+                format("hand-written reads, %d in flight", depth).c_str());
+
+        // Coroutines.
+        CoroutineScheduler scheduler(cluster);
+        count = 0;
+        start = Cycles::rdtsc();
+        stop = start + runCycles;
+        for (int i = 0; i < depth; i++) {
+            scheduler.spawn([&scheduler, &count, stop, key, keyLength] {
+                Buffer value;
+                while (Cycles::rdtsc() < stop) {
+                    scheduler.read(dataTable, key, keyLength, &value);
+                    count++;
+                }
+            });
+        }
+        scheduler.run();
+        rate = static_cast<double>(count) /
+                Cycles::toSeconds(Cycles::rdtsc() - start);
+        printRate(format("readPipelined.coroutine.%d", depth).c_str(), rate,
+                format("coroutine reads, %d in flight", depth).c_str());
+    }
+}
+
 /**
  * This method contains the core of the "readRandom" test; it is
  * shared by the master and slaves.
@@ -7404,6 +7482,7 @@ TestInfo tests[] = {
     {"readInterference", readInterference},
     {"readLoaded", readLoaded},
     {"readNotFound", readNotFound},
+    {"readPipelined", readPipelined},
     {"readRandom", readRandom},
     {"readThroughput", readThroughput},
     {"readVaryingKeyLength", readVaryingKeyLength},
@@ -19,12 +19,17 @@
 namespace po = boost::program_options;
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "CycleCounter.h"
 #include "Cycles.h"
 #include "PerfStats.h"
+#include "PerfStatsSampler.h"
+#include "ProtoBuf.h"
 #include "RamCloud.h"
+#include "RpcPhaseTrace.h"
+#include "ServerId.h"
 
 using namespace RAMCloud;
 
@@ -37,9 +42,85 @@ class StatDumper {
         , stats()
         , currentStats{&stats[1]}
         , previousStats{&stats[0]}
+        , lastSamples()
     {
     }
 
+    /**
+     * Instead of printing cluster-wide summaries, retrieve the servers'
+     * PerfStats histories (see PerfStatsSampler) and print one line for
+     * each sampling interval on each server. Runs forever.
+     *
+     * \param maxSamples
+     *      Maximum number of samples to fetch from each server on each
+     *      pull; should cover at least pullSeconds worth of samples.
+     * \param pullSeconds
+     *      Time to wait between pulls.
+     */
+    void
+    runHistory(uint32_t maxSamples, uint32_t pullSeconds)
+    {
+        printf("%8s %12s %6s %6s %9s %9s %8s %7s %7s %8s\n",
+                "server", "time (ms)", "disp", "worker", "reads/s",
+                "writes/s", "logMB/s", "cleaner", "compact", "backMB/s");
+        while (true) {
+            Buffer history;
+            ramcloud.serverControlAll(
+                    WireFormat::ControlOp::GET_PERF_STATS_HISTORY,
+                    &maxSamples, sizeof32(maxSamples), &history);
+            std::vector<PerfStatsSampler::History> servers;
+            PerfStatsSampler::parseClusterHistory(&history, &servers);
+            foreach (PerfStatsSampler::History& server, servers) {
+                printHistory(server);
+            }
+            fflush(stdout);
+            sleep(pullSeconds);
+        }
+    }
+
+    /**
+     * Instead of printing cluster-wide summaries, retrieve each server's
+     * RPC phase latency histograms (see RpcPhaseTrace) and print them.
+     * Runs forever.
+     *
+     * \param pullSeconds
+     *      Time to wait between pulls.
+     */
+    void
+    runPhases(uint32_t pullSeconds)
+    {
+        while (true) {
+            Buffer output;
+            ramcloud.serverControlAll(
+                    WireFormat::ControlOp::GET_RPC_PHASE_HISTOGRAMS,
+                    NULL, 0, &output);
+            uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
+            while (offset < output.size()) {
+                WireFormat::ServerControl::Response* header =
+                        output.getOffset<WireFormat::ServerControl::Response>(
+                        offset);
+                if (header == NULL)
+                    break;
+                offset += sizeof32(*header);
+                if (header->common.status != STATUS_OK) {
+                    printf("== %s: %s ==\n",
+                            ServerId(header->serverId).toString().c_str(),
+                            statusToString(header->common.status));
+                } else {
+                    ProtoBuf::RpcPhaseHistograms histograms;
+                    ProtoBuf::parseFromResponse(&output, offset,
+                            header->outputLength, &histograms);
+                    printf("== %s ==\n%s",
+                            ServerId(header->serverId).toString().c_str(),
+                            RpcPhaseTrace::toString(histograms).c_str());
+                }
+                offset += header->outputLength;
+            }
+            fflush(stdout);
+            sleep(pullSeconds);
+        }
+    }
+
     void
     run()
     {
@@ -72,6 +153,62 @@ class StatDumper {
 
     }
 
+    /**
+     * Print the intervals between the samples from one server that haven't
+     * been printed yet.
+     */
+    void printHistory(PerfStatsSampler::History& server)
+    {
+        LastSample& last = lastSamples[server.serverId];
+        if (last.nextSequence < server.firstSequence) {
+            if (last.nextSequence != 0) {
+                printf("%8s %lu samples lost\n",
+                        ServerId(server.serverId).toString().c_str(),
+                        server.firstSequence - last.nextSequence);
+            }
+            last.valid = false;
+        }
+        for (size_t i = 0; i < server.samples.size(); i++) {
+            uint64_t sequence = server.firstSequence + i;
+            if (sequence < last.nextSequence)
+                continue;
+            PerfStats& p2 = server.samples[i];
+            if (last.valid) {
+                printInterval(server.serverId, last.stats, p2);
+            }
+            last.stats = p2;
+            last.valid = true;
+            last.nextSequence = sequence + 1;
+        }
+    }
+
+    /**
+     * Print one line describing a server's activity between two samples.
+     */
+    void printInterval(uint64_t serverId, PerfStats& p1, PerfStats& p2)
+    {
+        double cycles = static_cast<double>(p2.collectionTime
+                - p1.collectionTime);
+        if (cycles <= 0)
+            return;
+        double seconds = cycles / p2.cyclesPerSecond;
+#define DELTA(metric) static_cast<double>(p2.metric - p1.metric)
+        printf("%8s %12.3f %6.2f %6.2f %9.0f %9.0f %8.2f %7.2f %7.2f "
+                "%8.2f\n",
+                ServerId(serverId).toString().c_str(),
+                1e03 * static_cast<double>(p2.collectionTime)
+                        / p2.cyclesPerSecond,
+                DELTA(dispatchActiveCycles) / cycles,
+                DELTA(workerActiveCycles) / cycles,
+                DELTA(readCount) / seconds,
+                DELTA(writeCount) / seconds,
+                1e-06 * DELTA(logBytesAppended) / seconds,
+                DELTA(cleanerActiveCycles) / cycles,
+                DELTA(compactorActiveCycles) / cycles,
+                1e-06 * DELTA(backupWriteBytes) / seconds);
+#undef DELTA
+    }
+
 
     RamCloud ramcloud;
     double dispatchDelay;
@@ -81,6 +218,17 @@ class StatDumper {
     Buffer* currentStats;
     Buffer* previousStats;
 
+    /// Used by runHistory: the most recent sample printed for a server.
+    struct LastSample {
+        LastSample() : stats(), valid(false), nextSequence(0) {}
+        PerfStats stats;
+        bool valid;
+        uint64_t nextSequence;
+    };
+
+    /// Used by runHistory; indexed by server id.
+    std::unordered_map<uint64_t, LastSample> lastSamples;
+
     DISALLOW_COPY_AND_ASSIGN(StatDumper);
 };
 
@@ -91,6 +239,10 @@ try
 {
     std::string logFile{};
     std::string logLevel{"NOTICE"};
+    bool history = false;
+    bool phases = false;
+    uint32_t historySamples = 1000;
+    uint32_t pullSeconds = 1;
     CommandLineOptions options{};
 
     po::options_description desc{
@@ -102,6 +254,21 @@ try
     desc.add_options()
         ("coordinator,C", po::value<string>(&options.coordinatorLocator),
                 "Service locator for the cluster coordinator (required)")
+        ("history", po::bool_switch(&history),
+                "Print the time series recorded by each server's PerfStats "
+                "sampler (servers must be started with "
+                "--perfStatsSampleInterval) instead of cluster summaries")
+        ("phases", po::bool_switch(&phases),
+                "Print each server's latency histograms for the phases of "
+                "its RPCs (servers must be started with "
+                "--rpcPhaseTraceInterval) instead of cluster summaries")
+        ("historySamples",
+                po::value<uint32_t>(&historySamples)->default_value(1000),
+                "With --history, maximum number of samples to fetch from "
+                "each server on each pull")
+        ("pullInterval",
+                po::value<uint32_t>(&pullSeconds)->default_value(1),
+                "With --history or --phases, seconds to wait between pulls")
         ("logFile", po::value<string>(&logFile),
                 "Redirect all output to this file")
         ("logLevel,l", po::value<string>(&logLevel)->default_value("NOTICE"),
@@ -140,7 +307,12 @@ try
     }
 
     StatDumper dumper{&options};
-    dumper.run();
+    if (history)
+        dumper.runHistory(historySamples, pullSeconds);
+    else if (phases)
+        dumper.runPhases(pullSeconds);
+    else
+        dumper.run();
 
     return 0;
 } catch (std::exception& e) {
@@ -117,7 +117,9 @@ class MigrateTabletBenchmark {
         metrics->temp.count8 =
         metrics->temp.count9 = 0;
 
-        Tub<Segment> transferSeg{};
+        // An invalid receiver makes the sender discard full segments
+        // rather than send them.
+        MigrationSender sender(&context, ServerId{}, 0, 0);
 
         uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
         uint64_t totalBytes = 0;
@@ -129,9 +131,8 @@ class MigrateTabletBenchmark {
             SegmentIterator it{*s};
             while (!it.isDone()) {
                 Status r = service->migrateSingleLogEntry(
-                                it, transferSeg, entryTotals, totalBytes,
-                                0, 0lu, ~0lu,
-                                ServerId{});
+                                it, sender, entryTotals, totalBytes,
+                                0, 0lu, ~0lu);
                 if (r != STATUS_OK) {
                     printf("Catastrophic failure\n");
                     exit(-1);
@@ -891,6 +891,7 @@ simple_tests = [
     Test("netBandwidth", netBandwidth),
     Test("readAllToAll", readAllToAll),
     Test("readNotFound", default),
+    Test("readPipelined", default),
 ]
 
 graph_tests = [
@@ -42,6 +42,7 @@ import sys
 # the Opcode enum in WireFormat.h.
 
 callees = {
+    "BULK_LOAD":             ["BACKUP_WRITE"],
     "COORD_SPLIT_AND_MIGRATE_INDEXLET":
                              ["SPLIT_AND_MIGRATE_INDEXLET",
                               "TAKE_TABLET_OWNERSHIP",
@@ -51,9 +52,11 @@ callees = {
     "CREATE_TABLE":          ["TAKE_TABLET_OWNERSHIP"],
     "DROP_INDEX":            ["DROP_TABLET_OWNERSHIP"],
     "DROP_TABLE":            ["TAKE_TABLET_OWNERSHIP"],
+    "EXPORT_SNAPSHOT":       ["BACKUP_WRITE"],
     "FILL_WITH_TEST_DATA":   ["BACKUP_WRITE"],
     "GET_HEAD_OF_LOG":       ["BACKUP_WRITE"],
     "HINT_SERVER_CRASHED":   ["PING"],
+    "IMPORT_SNAPSHOT":       ["BACKUP_WRITE"],
     "INCREMENT":             ["BACKUP_WRITE"],
     "INSERT_INDEX_ENTRY":    ["BACKUP_WRITE"],
     "MIGRATE_TABLET":        ["RECEIVE_MIGRATION_DATA",
@@ -66,6 +69,7 @@ callees = {
     "REASSIGN_TABLET_OWNERSHIP": ["TAKE_TABLET_OWNERSHIP"],
     "RECEIVE_MIGRATION_DATA":["BACKUP_WRITE"],
     "RECOVER":               ["BACKUP_GETRECOVERYDATA", "BACKUP_WRITE"],
+    "RELAY_SERVER_LIST":     ["UPDATE_SERVER_LIST"],
     "REMOVE":                ["BACKUP_WRITE", "REMOVE_INDEX_ENTRY"],
     "REMOVE_INDEX_ENTRY":    ["BACKUP_WRITE"],
     "SERVER_CONTROL_ALL":    ["SERVER_CONTROL"],
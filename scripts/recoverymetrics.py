@@ -480,6 +480,8 @@ def makeReport(data):
                 storageTypeStr = 'memory'
             elif storageType == 2:
                 storageTypeStr = 'disk'
+            elif storageType == 3:
+                storageTypeStr = 'persistent memory'
             else:
                 storageTypeStr = 'unknown (%s)' % storageType
         summary.line('Storage type', storageTypeStr)
@@ -19,6 +19,7 @@
 #include "Log.h"
 #include "LogCleaner.h"
 #include "PerfStats.h"
+#include "RpcResult.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
 
@@ -81,6 +82,7 @@ AbstractLog::AbstractLog(LogEntryHandlers* entryHandlers,
 bool
 AbstractLog::append(AppendVector* appends, uint32_t numAppends)
 {
+    RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::LOG_APPEND);
     CycleCounter<uint64_t> _(&metrics.totalAppendTicks);
     SpinLock::Guard lock(appendLock);
     metrics.totalAppendCalls++;
@@ -133,6 +135,7 @@ bool
 AbstractLog::append(Buffer *logBuffer, Reference *references,
                     uint32_t numEntries)
 {
+    RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::LOG_APPEND);
     CycleCounter<uint64_t> _(&metrics.totalAppendTicks);
     SpinLock::Guard lock(appendLock);
     metrics.totalAppendCalls++;
@@ -201,6 +204,9 @@ AbstractLog::free(Reference reference)
                                            &lengthWithMetadata);
     segment->trackDeadEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+        type == LOG_ENTRY_TYPE_OBJCHUNK ||
+        type == LOG_ENTRY_TYPE_OBJRPCRESULT ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
@@ -263,6 +269,11 @@ AbstractLog::getMemoryStats(PerfStats* stats)
  * case, we take a slower path to look up the subsequent discontiguous pieces
  * of the entry, which typically incurs several additional cache misses.
  *
+ * Objects stored together with an RpcResult (LOG_ENTRY_TYPE_OBJRPCRESULT) are
+ * returned as LOG_ENTRY_TYPE_OBJ with just the object in \a outBuffer, since
+ * that is all that callers reaching them through the hash table care about.
+ * Use getRawEntry() to see the whole entry.
+ *
  * \param reference
  *      Reference to the entry requested. This value is returned in the append
  *      method. If this reference is invalid behaviour is undefined. The log
@@ -275,6 +286,30 @@ AbstractLog::getMemoryStats(PerfStats* stats)
  */
 LogEntryType
 AbstractLog::getEntry(Reference reference, Buffer& outBuffer)
+{
+    uint32_t offset = outBuffer.size();
+    LogEntryType type = getRawEntry(reference, outBuffer);
+    if (type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
+        outBuffer.truncate(offset +
+                RpcResult::objectLengthInCombinedEntry(outBuffer, offset));
+        type = LOG_ENTRY_TYPE_OBJ;
+    }
+    return type;
+}
+
+/**
+ * Like getEntry(), but returns entries exactly as they were appended. This
+ * is needed to read the RpcResult of an object stored with one.
+ *
+ * \param reference
+ *      Reference to the entry requested.
+ * \param outBuffer
+ *      Buffer to append the entry being looked up to.
+ * \return
+ *      The type of the entry being looked up is returned here.
+ */
+LogEntryType
+AbstractLog::getRawEntry(Reference reference, Buffer& outBuffer)
 {
     return reference.getEntry(&segmentManager->getAllocator(), &outBuffer);
 }
@@ -416,6 +451,9 @@ AbstractLog::append(const SpinLock::Guard& lock,
     // when trying to reclaim memory.
     head->trackNewEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+        type == LOG_ENTRY_TYPE_OBJCHUNK ||
+        type == LOG_ENTRY_TYPE_OBJRPCRESULT ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
@@ -503,6 +541,9 @@ AbstractLog::append(const SpinLock::Guard& lock,
     // when trying to reclaim memory.
     head->trackNewEntry(type, lengthWithMetadata);
     if (type == LOG_ENTRY_TYPE_OBJ ||
+        type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+        type == LOG_ENTRY_TYPE_OBJCHUNK ||
+        type == LOG_ENTRY_TYPE_OBJRPCRESULT ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
         type == LOG_ENTRY_TYPE_TXPLIST)
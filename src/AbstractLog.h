@@ -27,6 +27,7 @@
 #include "SpinLock.h"
 #include "ReplicaManager.h"
 #include "HashTable.h"
+#include "RpcPhaseTrace.h"
 
 #include "LogMetrics.pb.h"
 
@@ -115,6 +116,8 @@ class AbstractLog {
     void getMemoryStats(PerfStats* stats);
     LogEntryType getEntry(Reference reference,
                           Buffer& outBuffer);
+    LogEntryType getRawEntry(Reference reference,
+                             Buffer& outBuffer);
     uint64_t getSegmentId(Reference reference);
     bool hasSpaceFor(uint64_t objectSize);
     bool segmentExists(uint64_t segmentId);
@@ -140,6 +143,7 @@ class AbstractLog {
            uint32_t length,
            Reference* outReference = NULL)
     {
+        RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::LOG_APPEND);
         SpinLock::Guard lock(appendLock);
         metrics.totalAppendCalls++;
         return append(lock,
@@ -158,6 +162,7 @@ class AbstractLog {
            Buffer& buffer,
            Reference* outReference = NULL)
     {
+        RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::LOG_APPEND);
         SpinLock::Guard lock(appendLock);
         metrics.totalAppendCalls++;
         return append(lock,
@@ -199,6 +199,57 @@ ProxyPingRpc::wait()
     return respHdr->replyNanoseconds;
 }
 
+/**
+ * Constructor for ForwardServerListRpc: sends an UPDATE_SERVER_LIST RPC
+ * containing server lists that this server received from the coordinator.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Identifies the server to which the lists should be forwarded.
+ * \param lists
+ *      Contains the server lists, in the format of an UPDATE_SERVER_LIST
+ *      request (each list preceded by its Part header). The data must
+ *      remain stable until the RPC completes or #wait gives up.
+ * \param offset
+ *      Offset within \a lists of the first Part header.
+ * \param length
+ *      Total number of bytes of Part headers and lists.
+ */
+ForwardServerListRpc::ForwardServerListRpc(Context* context,
+        ServerId serverId, Buffer* lists, uint32_t offset, uint32_t length)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::UpdateServerList::Response))
+{
+    allocHeader<WireFormat::UpdateServerList>(serverId);
+    request.append(lists, offset, length);
+    send();
+}
+
+/**
+ * Wait for a ForwardServerListRpc to complete, but give up at a given time.
+ *
+ * \param abortTime
+ *      If the RPC hasn't completed by this time (in Cycles::rdtsc units),
+ *      it is abandoned.
+ *
+ * \return
+ *      The target's server list version after processing the lists, or 0
+ *      if the RPC timed out, the target has crashed, or it returned an
+ *      error.
+ */
+uint64_t
+ForwardServerListRpc::wait(uint64_t abortTime)
+{
+    if (!waitInternal(context->dispatch, abortTime)) {
+        TEST_LOG("timeout");
+        cancel();
+        return 0;
+    }
+    if (serverCrashed || responseHeader->status != STATUS_OK)
+        return 0;
+    return getResponseHeader<WireFormat::UpdateServerList>()->currentVersion;
+}
 
 /**
  * This RPC is used to invoke a variety of miscellaneous operations on a server,
@@ -98,6 +98,23 @@ class ProxyPingRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(ProxyPingRpc);
 };
 
+/**
+ * Carries server list updates from one server to another, on behalf of the
+ * coordinator (see AdminService::relayServerList). Unlike most RPCs, this
+ * one gives up after a deadline: the forwarding server must report back to
+ * the coordinator even if the target never responds.
+ */
+class ForwardServerListRpc : public ServerIdRpcWrapper {
+  public:
+    ForwardServerListRpc(Context* context, ServerId serverId, Buffer* lists,
+            uint32_t offset, uint32_t length);
+    ~ForwardServerListRpc() {}
+    uint64_t wait(uint64_t abortTime);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ForwardServerListRpc);
+};
+
 /**
  * Encapsulates the state of a AdminClient::serverControl operation,
  * allowing it to execute asynchronously.
@@ -24,6 +24,9 @@
 #include "PerfStats.h"
 #include "AdminClient.h"
 #include "AdminService.h"
+#include "ProtoBuf.h"
+#include "RpcLatency.h"
+#include "RpcPhaseTrace.h"
 #include "ServerList.h"
 #include "TimeTrace.h"
 #include "CacheTrace.h"
@@ -55,12 +58,28 @@ AdminService::AdminService(Context* context,
     , serverConfig(serverConfig)
     , ignoreKill(false)
     , returnUnknownId(false)
+    , perfStatsSampler()
 {
     context->services[WireFormat::ADMIN_SERVICE] = this;
+    if ((serverConfig != NULL) &&
+            (serverConfig->perfStatsSampleIntervalMs != 0)) {
+        perfStatsSampler.construct(context,
+                serverConfig->perfStatsSampleIntervalMs,
+                serverConfig->perfStatsHistorySamples);
+        perfStatsSampler->start();
+    }
+    if ((serverConfig != NULL) &&
+            (serverConfig->rpcPhaseTraceIntervalMs != 0)) {
+        RpcPhaseTrace::start(serverConfig->rpcPhaseTraceIntervalMs);
+    }
 }
 
 AdminService::~AdminService()
 {
+    if ((serverConfig != NULL) &&
+            (serverConfig->rpcPhaseTraceIntervalMs != 0)) {
+        RpcPhaseTrace::stop();
+    }
     context->services[WireFormat::ADMIN_SERVICE] = NULL;
 }
 
@@ -194,6 +213,68 @@ AdminService::proxyPing(const WireFormat::ProxyPing::Request* reqHdr,
     }
 }
 
+/**
+ * Top-level service method to handle the RELAY_SERVER_LIST request: apply
+ * the server lists locally, as for UPDATE_SERVER_LIST, then forward them
+ * to other servers on behalf of the coordinator and report how that went.
+ * This lets the coordinator update a large cluster without sending an RPC
+ * to every server itself.
+ *
+ * \copydetails Service::ping
+ */
+void
+AdminService::relayServerList(
+        const WireFormat::RelayServerList::Request* reqHdr,
+        WireFormat::RelayServerList::Response* respHdr,
+        Rpc* rpc)
+{
+    if (serverList == NULL) {
+        respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+        return;
+    }
+    uint64_t abortTime = Cycles::rdtsc() +
+            Cycles::fromNanoseconds(reqHdr->timeoutNanoseconds);
+    uint32_t relayCount = reqHdr->relayCount;
+    uint32_t offset = sizeof32(*reqHdr);
+
+    // Check the count before using it, so that a bogus one can't overflow
+    // the size computation below or cause a huge allocation.
+    if (relayCount > (rpc->requestPayload->size() - offset) /
+            sizeof32(uint64_t)) {
+        respHdr->common.status = STATUS_MESSAGE_TOO_SHORT;
+        return;
+    }
+    const uint64_t* targets = static_cast<const uint64_t*>(
+            rpc->requestPayload->getRange(offset,
+            relayCount * sizeof32(uint64_t)));
+    if (targets == NULL && relayCount > 0) {
+        respHdr->common.status = STATUS_MESSAGE_TOO_SHORT;
+        return;
+    }
+    offset += relayCount * sizeof32(uint64_t);
+    uint32_t listsLength = rpc->requestPayload->size() - offset;
+
+    // Apply the lists here first: they may be what tells this server
+    // where the other servers are.
+    applyServerLists(rpc->requestPayload, offset, &respHdr->currentVersion);
+
+    std::unique_ptr<Tub<ForwardServerListRpc>[]> rpcs(
+            new Tub<ForwardServerListRpc>[relayCount]);
+    for (uint32_t i = 0; i < relayCount; i++) {
+        rpcs[i].construct(context, ServerId(targets[i]),
+                rpc->requestPayload, offset, listsLength);
+    }
+    for (uint32_t i = 0; i < relayCount; i++) {
+        uint64_t version = rpcs[i]->wait(abortTime);
+        if (version == 0) {
+            LOG(NOTICE, "Couldn't forward server list to server %s",
+                    ServerId(targets[i]).toString().c_str());
+        }
+        rpc->replyPayload->emplaceAppend<uint64_t>(version);
+    }
+    respHdr->relayCount = relayCount;
+}
+
 /**
  * Top-level service method to handle the SERVER_CONTROL request.
  *
@@ -327,6 +408,52 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
             rpc->replyPayload->appendCopy(&stats, respHdr->outputLength);
             break;
         }
+        case WireFormat::GET_PERF_STATS_HISTORY:
+        {
+            // The optional input is the maximum number of (most recent)
+            // samples to return.
+            if (!perfStatsSampler) {
+                respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+                return;
+            }
+            uint32_t maxSamples = 0;
+            if (reqHdr->inputLength >= sizeof(maxSamples)) {
+                maxSamples = *reinterpret_cast<const uint32_t*>(inputData);
+            }
+            // The request may have been sent to every server by
+            // serverControlAll, so leave room for the others' histories.
+            uint32_t serverCount = 1;
+            if (serverList != NULL) {
+                serverCount = 0;
+                ServerId id;
+                bool end = false;
+                while (true) {
+                    id = serverList->nextServer(id,
+                            {WireFormat::ADMIN_SERVICE}, &end);
+                    if (end || !id.isValid())
+                        break;
+                    serverCount++;
+                }
+            }
+            uint32_t initialLength = rpc->replyPayload->size();
+            perfStatsSampler->appendHistory(maxSamples, rpc->replyPayload,
+                    serverCount);
+            respHdr->outputLength = rpc->replyPayload->size() - initialLength;
+            break;
+        }
+        case WireFormat::GET_RPC_PHASE_HISTOGRAMS:
+        {
+            if ((serverConfig == NULL) ||
+                    (serverConfig->rpcPhaseTraceIntervalMs == 0)) {
+                respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+                return;
+            }
+            ProtoBuf::RpcPhaseHistograms histograms;
+            RpcPhaseTrace::serialize(&histograms);
+            respHdr->outputLength = ProtoBuf::serializeToResponse(
+                    rpc->replyPayload, &histograms);
+            break;
+        }
         case WireFormat::GET_TIME_TRACE:
         {
             string s = TimeTrace::getTrace();
@@ -376,6 +503,8 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
         case WireFormat::RESET_METRICS:
         {
             TimeTrace::reset();
+            RpcPhaseTrace::reset();
+            RpcLatency::reset();
             break;
         }
         case WireFormat::START_PERF_COUNTERS:
@@ -409,14 +538,35 @@ AdminService::updateServerList(
         respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
         return;
     }
-    uint32_t reqOffset = sizeof32(*reqHdr);
-    uint32_t reqLen = rpc->requestPayload->size();
+    applyServerLists(rpc->requestPayload, sizeof32(*reqHdr),
+            &respHdr->currentVersion);
+}
+
+/**
+ * Apply the server lists in an UPDATE_SERVER_LIST or RELAY_SERVER_LIST
+ * request to this server's server list.
+ *
+ * \param request
+ *      The request message.
+ * \param offset
+ *      Offset within \a request of the first list's Part header; the lists
+ *      continue to the end of the request.
+ * \param[out] currentVersion
+ *      Set to the server list version after each list is applied (not
+ *      modified if there are no lists).
+ */
+void
+AdminService::applyServerLists(Buffer* request, uint32_t offset,
+        uint64_t* currentVersion)
+{
+    uint32_t reqOffset = offset;
+    uint32_t reqLen = request->size();
 
     // Repeatedly apply the server lists in the RPC while we haven't reached
     // the end of the RPC.
     while (reqOffset < reqLen) {
         ProtoBuf::ServerList list;
-        auto* part = rpc->requestPayload->getOffset<
+        auto* part = request->getOffset<
                     WireFormat::UpdateServerList::Request::Part>(reqOffset);
         reqOffset += sizeof32(*part);
 
@@ -430,10 +580,10 @@ AdminService::updateServerList(
 
 
         // Check passed, parse server list and apply.
-        ProtoBuf::parseFromRequest(rpc->requestPayload, reqOffset,
+        ProtoBuf::parseFromRequest(request, reqOffset,
                                    part->serverListLength, &list);
         reqOffset += part->serverListLength;
-        respHdr->currentVersion = serverList->applyServerList(list);
+        *currentVersion = serverList->applyServerList(list);
     }
 }
 
@@ -468,6 +618,10 @@ AdminService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::ProxyPing, AdminService,
                         &AdminService::proxyPing>(rpc);
             break;
+        case WireFormat::RelayServerList::opcode:
+            callHandler<WireFormat::RelayServerList, AdminService,
+                        &AdminService::relayServerList>(rpc);
+            break;
         case WireFormat::ServerControl::opcode:
             callHandler<WireFormat::ServerControl, AdminService,
                         &AdminService::serverControl>(rpc);
@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_ADMINSERVICE_H
 #define RAMCLOUD_ADMINSERVICE_H
 
+#include "PerfStatsSampler.h"
 #include "Service.h"
 #include "ServerConfig.h"
 #include "ServerList.h"
@@ -52,12 +53,17 @@ class AdminService : public Service {
     void proxyPing(const WireFormat::ProxyPing::Request* reqHdr,
             WireFormat::ProxyPing::Response* respHdr,
             Rpc* rpc);
+    void relayServerList(const WireFormat::RelayServerList::Request* reqHdr,
+            WireFormat::RelayServerList::Response* respHdr,
+            Rpc* rpc);
     void serverControl(const WireFormat::ServerControl::Request* reqHdr,
             WireFormat::ServerControl::Response* respHdr,
             Rpc* rpc);
     void updateServerList(const WireFormat::UpdateServerList::Request* reqHdr,
                        WireFormat::UpdateServerList::Response* respHdr,
                        Rpc* rpc);
+    void applyServerLists(Buffer* request, uint32_t offset,
+            uint64_t* currentVersion);
 
     /// Shared RAMCloud information.
     Context* context;
@@ -80,6 +86,10 @@ class AdminService : public Service {
     /// false.
     bool returnUnknownId;
 
+    /// Records this server's PerfStats periodically, if enabled in
+    /// serverConfig (see ServerConfig::perfStatsSampleIntervalMs).
+    Tub<PerfStatsSampler> perfStatsSampler;
+
     DISALLOW_COPY_AND_ASSIGN(AdminService);
 };
 
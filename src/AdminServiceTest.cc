@@ -29,6 +29,7 @@
 #include "MockExternalStorage.h"
 #include "RamCloud.h"
 #include "RawMetrics.h"
+#include "RpcPhaseTrace.h"
 #include "ServerList.h"
 #include "ServerMetrics.h"
 #include "Tablets.pb.h"
@@ -273,6 +274,75 @@ TEST_F(AdminServiceTest, proxyPing_timeout) {
     EXPECT_LE(elapsedMicros, 2000.0);
 }
 
+TEST_F(AdminServiceTest, relayServerList_noServerList) {
+    WireFormat::RelayServerList::Response response;
+    response.common.status = STATUS_OK;
+    AdminService admin2(&context, NULL, NULL);
+    admin2.relayServerList(NULL, &response, NULL);
+    EXPECT_STREQ("invalid RPC request type",
+            statusToString(response.common.status));
+}
+
+TEST_F(AdminServiceTest, relayServerList_badRelayCount) {
+    Buffer reqBuf;
+    Buffer respBuf;
+    Service::Rpc rpc(NULL, &reqBuf, &respBuf);   // Fake RPC with no worker.
+    WireFormat::RelayServerList::Request* reqHdr =
+            reqBuf.emplaceAppend<WireFormat::RelayServerList::Request>();
+    WireFormat::RelayServerList::Response* respHdr =
+            respBuf.emplaceAppend<WireFormat::RelayServerList::Response>();
+    respHdr->common.status = STATUS_OK;
+    reqBuf.emplaceAppend<uint64_t>(serverId.getId());
+
+    // relayCount * sizeof(uint64_t) wraps around to 8 in 32 bits.
+    reqHdr->relayCount = 0x20000001;
+    reqHdr->timeoutNanoseconds = 1000000;
+    adminService.relayServerList(reqHdr, respHdr, &rpc);
+    EXPECT_EQ(STATUS_MESSAGE_TOO_SHORT, respHdr->common.status);
+    EXPECT_EQ(0u, respBuf.size() - sizeof32(*respHdr));
+}
+
+TEST_F(AdminServiceTest, relayServerList) {
+    Context context2;
+    context2.externalStorage = &storage;
+    CoordinatorService coordinatorService(&context2, 1000, true);
+    CoordinatorServerList* source(context2.coordinatorServerList);
+    source->haltUpdater();
+    ServerId id1 = source->enlistServer({WireFormat::MASTER_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 100, "mock:host=55");
+    ServerId id2 = source->enlistServer({WireFormat::MASTER_SERVICE,
+            WireFormat::ADMIN_SERVICE}, 0, 100, "mock:host=56");
+    ProtoBuf::ServerList fullList;
+    source->serialize(&fullList, {WireFormat::MASTER_SERVICE,
+            WireFormat::BACKUP_SERVICE});
+    string list;
+    fullList.SerializeToString(&list);
+
+    // The first target is this server itself (which has just applied the
+    // list); the second never responds.
+    ServerId targetId(2, 3);
+    MockTransport mockTransport(&context);
+    context.transportManager->registerMock(&mockTransport, "mock2");
+    serverList.testingAdd({targetId, "mock2:", {WireFormat::ADMIN_SERVICE}, 100,
+                           ServerStatus::UP});
+    CoordinatorServerList::UpdateServerListRpc rpc(&context, serverId, &list,
+            {serverId, targetId});
+    rpc.request.getStart<WireFormat::RelayServerList::Request>()
+            ->timeoutNanoseconds = 1000000;
+    TestLog::reset();
+    rpc.send();
+    rpc.waitAndCheckErrors();
+    EXPECT_STREQ("mock:host=55", serverList.getLocator(id1).c_str());
+    EXPECT_STREQ("mock:host=56", serverList.getLocator(id2).c_str());
+    EXPECT_EQ(2lu, rpc.getResponseHeader<WireFormat::UpdateServerList>()
+            ->currentVersion);
+    EXPECT_EQ(2lu, rpc.getRelayedVersion(0));
+    EXPECT_EQ(0lu, rpc.getRelayedVersion(1));
+    EXPECT_EQ(0lu, rpc.getRelayedVersion(2));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "relayServerList: Couldn't forward server list to server 2.3"));
+}
+
 TEST_F(AdminServiceTest, serverControl_ObjectServerControl_Basic) {
     // Everything works EXPECT STATUS_UNIMPLEMENTED_REQUEST
     AdminServiceTest::addMasterService();
@@ -548,6 +618,41 @@ TEST_F(AdminServiceTest, serverControl_DispatchProfilerExceptions) {
                 , RequestFormatError);
 }
 
+TEST_F(AdminServiceTest, serverControl_getRpcPhaseHistograms) {
+    Buffer output;
+
+    // Tracing isn't enabled in the server's configuration.
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_RPC_PHASE_HISTOGRAMS, NULL, 0, &output),
+            UnimplementedRequestError);
+
+    serverConfig.rpcPhaseTraceIntervalMs = 1;
+    RpcPhaseTrace::reset();
+    RpcPhaseTrace::start(0);
+    uint64_t start = Cycles::rdtsc() - Cycles::fromNanoseconds(10000000);
+    RpcPhaseTrace::record(1, WireFormat::READ, RpcPhaseTrace::LOG_APPEND,
+            RpcPhaseTrace::START, start);
+    RpcPhaseTrace::record(1, WireFormat::READ, RpcPhaseTrace::LOG_APPEND,
+            RpcPhaseTrace::END, start + 100);
+    RpcPhaseTrace::stop();
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_RPC_PHASE_HISTOGRAMS, NULL, 0, &output);
+    ProtoBuf::RpcPhaseHistograms histograms;
+    ProtoBuf::parseFromResponse(&output, 0, output.size(), &histograms);
+    ASSERT_EQ(1, histograms.entry_size());
+    EXPECT_EQ(uint32_t(WireFormat::READ), histograms.entry(0).opcode());
+    EXPECT_EQ(uint32_t(RpcPhaseTrace::LOG_APPEND),
+            histograms.entry(0).phase());
+
+    // RESET_METRICS discards the histograms.
+    AdminClient::serverControl(&context, serverId, WireFormat::RESET_METRICS);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_RPC_PHASE_HISTOGRAMS, NULL, 0, &output);
+    ProtoBuf::parseFromResponse(&output, 0, output.size(), &histograms);
+    EXPECT_EQ(0, histograms.entry_size());
+    serverConfig.rpcPhaseTraceIntervalMs = 0;
+}
+
 TEST_F(AdminServiceTest, serverControl_getTimeTrace) {
     Buffer output;
 
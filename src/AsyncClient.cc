@@ -0,0 +1,323 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "AsyncClient.h"
+#include "Dispatch.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an AsyncClient.
+ *
+ * \param ramcloud
+ *      Client used to issue all of the operations. Once the AsyncClient
+ *      has been created, this client should be used only by the thread
+ *      that calls #poll.
+ */
+AsyncClient::AsyncClient(RamCloud* ramcloud)
+    : ramcloud(ramcloud)
+    , operations()
+{
+}
+
+/**
+ * Destructor for AsyncClient. Any operations that are still outstanding are
+ * abandoned; their callbacks are never invoked.
+ */
+AsyncClient::~AsyncClient()
+{
+    foreach (Operation* operation, operations) {
+        delete operation;
+    }
+}
+
+/**
+ * Start committing a transaction; see Transaction::commit for details.
+ *
+ * \param transaction
+ *      Transaction to commit. It must not be destroyed until the callback
+ *      has been invoked.
+ * \param callback
+ *      Invoked once the commit decision has been accepted by all of the
+ *      participant servers.
+ */
+void
+AsyncClient::commit(Transaction* transaction, CommitCallback callback)
+{
+    std::shared_ptr<bool> committed = std::make_shared<bool>(false);
+    start<Transaction::CommitOp>(new Transaction::CommitOp(transaction),
+            [committed] (Transaction::CommitOp* op) {
+                *committed = op->wait();
+            },
+            [callback, committed] (Status status) {
+                callback(status, *committed);
+            });
+}
+
+/**
+ * Return a file descriptor that becomes readable when #poll has work to do
+ * (see Dispatch::getEventFd). The descriptor belongs to the client's
+ * Dispatch and must not be closed by the caller.
+ */
+int
+AsyncClient::getEventFd()
+{
+    return ramcloud->clientContext->dispatch->getEventFd();
+}
+
+/**
+ * Return the longest time, in milliseconds, that an event loop should wait
+ * for the descriptor from #getEventFd to become readable before calling
+ * #poll anyway; the result is suitable for passing to epoll_wait. This
+ * is needed because some of the client's work (such as transports that
+ * busy-poll the network, or RPC timeouts) doesn't signal the descriptor.
+ *
+ * \return
+ *      -1 if no operations are outstanding (wait indefinitely), 0 if the
+ *      client's transports must be polled continuously, or a short
+ *      interval otherwise.
+ */
+int
+AsyncClient::getPollTimeoutMs()
+{
+    if (operations.empty())
+        return -1;
+    if (ramcloud->clientContext->dispatch->hasPollers())
+        return 0;
+    return 1;
+}
+
+/**
+ * Start reading a group of objects; see RamCloud::multiRead for details.
+ *
+ * \param requests
+ *      Each element describes one object to read; the status of each
+ *      read is returned in its element. The array and the objects it
+ *      points to must remain valid until the callback has been invoked.
+ * \param numRequests
+ *      Number of elements in \a requests.
+ * \param callback
+ *      Invoked once all of the objects have been read.
+ */
+void
+AsyncClient::multiRead(MultiReadObject* const requests[],
+        uint32_t numRequests, Callback callback)
+{
+    start<MultiRead>(new MultiRead(ramcloud, requests, numRequests),
+            [] (MultiRead* rpc) {rpc->wait();}, callback);
+}
+
+/**
+ * Start writing a group of objects; see RamCloud::multiWrite for details.
+ *
+ * \param requests
+ *      Each element describes one object to write; the status of each
+ *      write is returned in its element. The array and the objects it
+ *      points to must remain valid until the callback has been invoked.
+ * \param numRequests
+ *      Number of elements in \a requests.
+ * \param callback
+ *      Invoked once all of the objects have been written.
+ */
+void
+AsyncClient::multiWrite(MultiWriteObject* const requests[],
+        uint32_t numRequests, Callback callback)
+{
+    start<MultiWrite>(new MultiWrite(ramcloud, requests, numRequests),
+            [] (MultiWrite* rpc) {rpc->wait();}, callback);
+}
+
+/**
+ * This method should be invoked by the event loop whenever the descriptor
+ * from #getEventFd is readable or the timeout from #getPollTimeoutMs has
+ * expired. It never blocks: it gives the client's transports a chance to
+ * make progress and then invokes the callbacks of all the operations that
+ * have completed. Callbacks may start new operations.
+ *
+ * \return
+ *      The number of callbacks that were invoked.
+ */
+int
+AsyncClient::poll()
+{
+    ramcloud->poll();
+
+    // Remove the completed operations before invoking any callbacks, since
+    // the callbacks may start new operations.
+    std::vector<Operation*> completed;
+    size_t remaining = 0;
+    for (size_t i = 0; i < operations.size(); i++) {
+        Operation* operation = operations[i];
+        if (operation->isReady()) {
+            completed.push_back(operation);
+        } else {
+            operations[remaining] = operation;
+            remaining++;
+        }
+    }
+    operations.resize(remaining);
+
+    foreach (Operation* operation, completed) {
+        operation->finish();
+        delete operation;
+    }
+    return downCast<int>(completed.size());
+}
+
+/**
+ * Start reading an object; see RamCloud::read for details.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      The contents of the object are returned here.
+ * \param callback
+ *      Invoked once the read has completed.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here
+ *      before the callback is invoked.
+ * \param[out] objectExists
+ *      If non-NULL, the read doesn't fail if the object doesn't exist;
+ *      instead, whether it exists is returned here.
+ */
+void
+AsyncClient::read(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, Callback callback, const RejectRules* rejectRules,
+        uint64_t* version, bool* objectExists)
+{
+    start<ReadRpc>(new ReadRpc(ramcloud, tableId, key, keyLength, value,
+            rejectRules),
+            [version, objectExists] (ReadRpc* rpc) {
+                rpc->wait(version, objectExists);
+            }, callback);
+}
+
+/**
+ * Start deleting an object; see RamCloud::remove for details.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param callback
+ *      Invoked once the object has been deleted.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the removal should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object (just before deletion)
+ *      is returned here before the callback is invoked.
+ */
+void
+AsyncClient::remove(uint64_t tableId, const void* key, uint16_t keyLength,
+        Callback callback, const RejectRules* rejectRules, uint64_t* version)
+{
+    start<RemoveRpc>(new RemoveRpc(ramcloud, tableId, key, keyLength,
+            rejectRules),
+            [version] (RemoveRpc* rpc) {rpc->wait(version);}, callback);
+}
+
+/**
+ * Start reading an object as part of a transaction; see Transaction::read
+ * for details.
+ *
+ * \param transaction
+ *      Transaction the read is part of.
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      The contents of the object are returned here.
+ * \param callback
+ *      Invoked once the read has completed.
+ * \param[out] objectExists
+ *      If non-NULL, the read doesn't fail if the object doesn't exist;
+ *      instead, whether it exists is returned here.
+ */
+void
+AsyncClient::transactionRead(Transaction* transaction, uint64_t tableId,
+        const void* key, uint16_t keyLength, Buffer* value, Callback callback,
+        bool* objectExists)
+{
+    start<Transaction::ReadOp>(new Transaction::ReadOp(transaction, tableId,
+            key, keyLength, value),
+            [objectExists] (Transaction::ReadOp* op) {
+                op->wait(objectExists);
+            }, callback);
+}
+
+/**
+ * Start writing an object; see RamCloud::write for details.
+ *
+ * \param tableId
+ *      The table to which the object is written.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first byte of the new contents for the object.
+ * \param length
+ *      Size in bytes of the new contents for the object.
+ * \param callback
+ *      Invoked once the object has been written.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the write should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the new object is returned here
+ *      before the callback is invoked.
+ */
+void
+AsyncClient::write(uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* buf, uint32_t length, Callback callback,
+        const RejectRules* rejectRules, uint64_t* version)
+{
+    start<WriteRpc>(new WriteRpc(ramcloud, tableId, key, keyLength, buf,
+            length, rejectRules),
+            [version] (WriteRpc* rpc) {rpc->wait(version);}, callback);
+}
+
+/**
+ * Record a newly started operation, so that #poll will invoke its callback
+ * once it completes.
+ *
+ * \param rpc
+ *      Object carrying out the operation; it has already been started.
+ * \param waiter
+ *      Collects the operation's results; see RpcOperation.
+ * \param callback
+ *      Invoked once the operation has completed.
+ */
+template<typename T>
+void
+AsyncClient::start(T* rpc, std::function<void(T*)> waiter, Callback callback)
+{
+    operations.push_back(new RpcOperation<T>(rpc, waiter, callback));
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,197 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_ASYNCCLIENT_H
+#define RAMCLOUD_ASYNCCLIENT_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Common.h"
+#include "ClientException.h"
+#include "MultiRead.h"
+#include "MultiWrite.h"
+#include "RamCloud.h"
+#include "Transaction.h"
+
+namespace RAMCloud {
+
+/**
+ * This class provides a callback-based interface to the most common RamCloud
+ * operations, for applications that run their own event loop (e.g. one built
+ * on epoll) and don't want to dedicate a thread to each RamCloud client.
+ * Each operation starts the corresponding RPC(s) and returns immediately;
+ * the caller's callback is invoked, with the operation's status, from a
+ * later call to #poll once the operation has completed.
+ *
+ * A typical event loop watches the descriptor returned by #getEventFd,
+ * waiting no longer than #getPollTimeoutMs, and calls #poll whenever the
+ * descriptor is readable or the timeout expires. A single thread can keep
+ * thousands of operations outstanding this way.
+ *
+ * This class is not thread-safe: the RamCloud object must be used only by
+ * the thread that calls #poll. Keys, values, and the other arguments passed
+ * by pointer must remain valid until the operation's callback is invoked.
+ */
+class AsyncClient {
+  PUBLIC:
+    /**
+     * Invoked when an operation completes. The argument is STATUS_OK if
+     * the operation succeeded; otherwise it is the status of the
+     * ClientException that the blocking form of the operation would
+     * have thrown.
+     */
+    typedef std::function<void(Status status)> Callback;
+
+    /**
+     * Invoked when a transaction commit completes. The second argument is
+     * the value the blocking Transaction::commit would have returned; it is
+     * meaningful only if the status is STATUS_OK.
+     */
+    typedef std::function<void(Status status, bool committed)>
+            CommitCallback;
+
+    explicit AsyncClient(RamCloud* ramcloud);
+    ~AsyncClient();
+
+    void commit(Transaction* transaction, CommitCallback callback);
+    int getEventFd();
+    int getPollTimeoutMs();
+    void multiRead(MultiReadObject* const requests[], uint32_t numRequests,
+            Callback callback);
+    void multiWrite(MultiWriteObject* const requests[], uint32_t numRequests,
+            Callback callback);
+
+    /**
+     * Return the number of operations that have been started but whose
+     * callbacks haven't been invoked yet.
+     */
+    size_t
+    outstanding()
+    {
+        return operations.size();
+    }
+
+    int poll();
+    void read(uint64_t tableId, const void* key, uint16_t keyLength,
+            Buffer* value, Callback callback,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL,
+            bool* objectExists = NULL);
+    void remove(uint64_t tableId, const void* key, uint16_t keyLength,
+            Callback callback, const RejectRules* rejectRules = NULL,
+            uint64_t* version = NULL);
+    void transactionRead(Transaction* transaction, uint64_t tableId,
+            const void* key, uint16_t keyLength, Buffer* value,
+            Callback callback, bool* objectExists = NULL);
+    void write(uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* buf, uint32_t length, Callback callback,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
+
+  PRIVATE:
+    /**
+     * One outstanding operation; subclasses wrap the objects (such as
+     * ReadRpc) that carry out each kind of operation.
+     */
+    class Operation {
+      public:
+        explicit Operation(Callback callback)
+            : callback(callback)
+        {}
+        virtual ~Operation() {}
+
+        /// Returns true once the operation has completed, so that #finish
+        /// will not block.
+        virtual bool isReady() = 0;
+
+        /// Collects the operation's results and invokes its callback.
+        virtual void finish() = 0;
+
+      PROTECTED:
+        /// Invoked by #finish.
+        Callback callback;
+
+        DISALLOW_COPY_AND_ASSIGN(Operation);
+    };
+
+    /**
+     * An operation carried out by a single object of type T (such as
+     * ReadRpc or MultiRead), which must provide an isReady method.
+     */
+    template<typename T>
+    class RpcOperation : public Operation {
+      public:
+        /**
+         * Constructor for RpcOperation.
+         *
+         * \param rpc
+         *      Object carrying out the operation; it has already been
+         *      started, and is deleted along with this object.
+         * \param waiter
+         *      Invoked by #finish to collect the operation's results
+         *      (typically by calling the wait method of \a rpc); any
+         *      ClientException it throws is passed to the callback as
+         *      a status.
+         * \param callback
+         *      Invoked by #finish.
+         */
+        RpcOperation(T* rpc, std::function<void(T*)> waiter,
+                Callback callback)
+            : Operation(callback)
+            , rpc(rpc)
+            , waiter(waiter)
+        {}
+
+        bool
+        isReady()
+        {
+            return rpc->isReady();
+        }
+
+        void
+        finish()
+        {
+            Status status = STATUS_OK;
+            try {
+                waiter(rpc.get());
+            } catch (const ClientException& e) {
+                status = e.status;
+            }
+            callback(status);
+        }
+
+      PRIVATE:
+        std::unique_ptr<T> rpc;
+        std::function<void(T*)> waiter;
+
+        DISALLOW_COPY_AND_ASSIGN(RpcOperation);
+    };
+
+    template<typename T>
+    void start(T* rpc, std::function<void(T*)> waiter, Callback callback);
+
+    /// Client used to issue all of the operations.
+    RamCloud* ramcloud;
+
+    /// Operations whose callbacks haven't been invoked yet, in the order
+    /// they were started.
+    std::vector<Operation*> operations;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncClient);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ASYNCCLIENT_H
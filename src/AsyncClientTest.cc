@@ -0,0 +1,246 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "AsyncClient.h"
+#include "Dispatch.h"
+#include "MockCluster.h"
+
+namespace RAMCloud {
+
+class AsyncClientTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Tub<AsyncClient> client;
+    uint64_t tableId;
+
+    /// Describes the callbacks that have been invoked so far.
+    string completions;
+
+  public:
+    AsyncClientTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , client()
+        , tableId(-1)
+        , completions()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+        ramcloud->write(tableId, "0", 1, "abcdef", 6);
+        client.construct(ramcloud.get());
+    }
+
+    /**
+     * Return a callback that appends a name and the status it is invoked
+     * with to #completions.
+     */
+    AsyncClient::Callback
+    record(const char* name)
+    {
+        return [this, name] (Status status) {
+            if (!completions.empty())
+                completions += ", ";
+            completions += format("%s: %s", name, statusToSymbol(status));
+        };
+    }
+
+    /**
+     * Call client->poll until no operations are outstanding (or a large
+     * number of polls have failed to finish them).
+     */
+    void
+    pollUntilDone()
+    {
+        for (int i = 0; i < 1000 && client->outstanding() > 0; i++)
+            client->poll();
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncClientTest);
+};
+
+TEST_F(AsyncClientTest, destructor_abandonOperations) {
+    Buffer value;
+    client->read(tableId, "0", 1, &value, record("read"));
+    EXPECT_EQ(1u, client->outstanding());
+    client.destroy();
+    EXPECT_EQ("", completions);
+}
+
+TEST_F(AsyncClientTest, commit) {
+    Transaction transaction(ramcloud.get());
+    transaction.write(tableId, "1", 1, "xyz", 3);
+    bool committed = false;
+    client->commit(&transaction,
+            [this, &committed] (Status status, bool result) {
+                completions = statusToSymbol(status);
+                committed = result;
+            });
+    pollUntilDone();
+    EXPECT_EQ("STATUS_OK", completions);
+    EXPECT_TRUE(committed);
+
+    Buffer value;
+    ramcloud->read(tableId, "1", 1, &value);
+    EXPECT_EQ("xyz", TestUtil::toString(&value));
+}
+
+TEST_F(AsyncClientTest, getEventFd) {
+    EXPECT_EQ(context.dispatch->getEventFd(), client->getEventFd());
+}
+
+TEST_F(AsyncClientTest, getPollTimeoutMs) {
+    EXPECT_EQ(-1, client->getPollTimeoutMs());
+    Buffer value;
+    client->read(tableId, "0", 1, &value, record("read"));
+    int expected = context.dispatch->hasPollers() ? 0 : 1;
+    EXPECT_EQ(expected, client->getPollTimeoutMs());
+    pollUntilDone();
+    EXPECT_EQ(-1, client->getPollTimeoutMs());
+}
+
+TEST_F(AsyncClientTest, multiRead) {
+    ramcloud->write(tableId, "1", 1, "ghi", 3);
+    Tub<ObjectBuffer> value1, value2;
+    MultiReadObject request1(tableId, "0", 1, &value1);
+    MultiReadObject request2(tableId, "1", 1, &value2);
+    MultiReadObject* requests[] = {&request1, &request2};
+    client->multiRead(requests, 2, record("multiRead"));
+    pollUntilDone();
+    EXPECT_EQ("multiRead: STATUS_OK", completions);
+    EXPECT_EQ("abcdef", string(reinterpret_cast<const char*>(
+            value1->getValue()), 6));
+    EXPECT_EQ("ghi", string(reinterpret_cast<const char*>(
+            value2->getValue()), 3));
+}
+
+TEST_F(AsyncClientTest, multiWrite) {
+    MultiWriteObject request1(tableId, "1", 1, "first", 5);
+    MultiWriteObject request2(tableId, "2", 1, "second", 6);
+    MultiWriteObject* requests[] = {&request1, &request2};
+    client->multiWrite(requests, 2, record("multiWrite"));
+    pollUntilDone();
+    EXPECT_EQ("multiWrite: STATUS_OK", completions);
+    EXPECT_EQ(STATUS_OK, request2.status);
+
+    Buffer value;
+    ramcloud->read(tableId, "2", 1, &value);
+    EXPECT_EQ("second", TestUtil::toString(&value));
+}
+
+TEST_F(AsyncClientTest, poll_callbackStartsOperation) {
+    Buffer value1, value2;
+    client->read(tableId, "0", 1, &value1,
+            [this, &value2] (Status status) {
+                completions = "first";
+                client->read(tableId, "0", 1, &value2, record("second"));
+            });
+    pollUntilDone();
+    EXPECT_EQ("first, second: STATUS_OK", completions);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value2));
+}
+
+TEST_F(AsyncClientTest, poll_manyOperations) {
+    Buffer values[10];
+    for (int i = 0; i < 10; i++)
+        client->read(tableId, "0", 1, &values[i], [] (Status status) {});
+    EXPECT_EQ(10u, client->outstanding());
+    int finished = 0;
+    for (int i = 0; i < 1000 && finished < 10; i++)
+        finished += client->poll();
+    EXPECT_EQ(10, finished);
+    EXPECT_EQ(0u, client->outstanding());
+    EXPECT_EQ("abcdef", TestUtil::toString(&values[9]));
+}
+
+TEST_F(AsyncClientTest, read) {
+    Buffer value;
+    uint64_t version = 0;
+    client->read(tableId, "0", 1, &value, record("read"), NULL, &version);
+    pollUntilDone();
+    EXPECT_EQ("read: STATUS_OK", completions);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+    EXPECT_EQ(1u, version);
+}
+
+TEST_F(AsyncClientTest, read_error) {
+    Buffer value;
+    client->read(tableId, "bogus", 5, &value, record("read"));
+    pollUntilDone();
+    EXPECT_EQ("read: STATUS_OBJECT_DOESNT_EXIST", completions);
+}
+
+TEST_F(AsyncClientTest, read_objectExists) {
+    Buffer value;
+    bool objectExists = true;
+    client->read(tableId, "bogus", 5, &value, record("read"), NULL, NULL,
+            &objectExists);
+    pollUntilDone();
+    EXPECT_EQ("read: STATUS_OK", completions);
+    EXPECT_FALSE(objectExists);
+}
+
+TEST_F(AsyncClientTest, remove) {
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = 1;
+    rules.givenVersion = 99;
+    client->remove(tableId, "0", 1, record("remove1"), &rules);
+    pollUntilDone();
+    uint64_t version = 0;
+    client->remove(tableId, "0", 1, record("remove2"), NULL, &version);
+    pollUntilDone();
+    EXPECT_EQ("remove1: STATUS_WRONG_VERSION, remove2: STATUS_OK",
+            completions);
+    EXPECT_EQ(1u, version);
+}
+
+TEST_F(AsyncClientTest, transactionRead) {
+    Transaction transaction(ramcloud.get());
+    Buffer value;
+    client->transactionRead(&transaction, tableId, "0", 1, &value,
+            record("read"));
+    pollUntilDone();
+    EXPECT_EQ("read: STATUS_OK", completions);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+}
+
+TEST_F(AsyncClientTest, write) {
+    uint64_t version = 0;
+    client->write(tableId, "0", 1, "new value", 9, record("write"), NULL,
+            &version);
+    pollUntilDone();
+    EXPECT_EQ("write: STATUS_OK", completions);
+    EXPECT_EQ(2u, version);
+
+    Buffer value;
+    ramcloud->read(tableId, "0", 1, &value);
+    EXPECT_EQ("new value", TestUtil::toString(&value));
+}
+
+} // namespace RAMCloud
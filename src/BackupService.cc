@@ -19,6 +19,7 @@
 #include "Cycles.h"
 #include "InMemoryStorage.h"
 #include "PerfStats.h"
+#include "PmemStorage.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
 #include "MultiFileStorage.h"
@@ -63,6 +64,11 @@ BackupService::BackupService(Context* context,
         storage.reset(new InMemoryStorage(config->segmentSize,
                                           config->backup.numSegmentFrames,
                                           config->backup.writeRateLimit));
+    } else if (config->backup.persistentMemory) {
+        storage.reset(new PmemStorage(config->segmentSize,
+                                      config->backup.numSegmentFrames,
+                                      config->backup.writeRateLimit,
+                                      config->backup.file.c_str()));
     } else {
         size_t maxWriteBuffers = config->backup.maxNonVolatileBuffers;
         if (maxWriteBuffers == 0) {
@@ -73,12 +79,17 @@ BackupService::BackupService(Context* context,
             maxWriteBuffers = config->backup.numSegmentFrames;
         }
 
+        // Grouped writes are made durable with fdatasync instead of O_SYNC.
+        size_t writeGroupSize = config->backup.writeGroupSize;
+
         storage.reset(new MultiFileStorage(config->segmentSize,
                                            config->backup.numSegmentFrames,
                                            config->backup.writeRateLimit,
                                            maxWriteBuffers,
                                            config->backup.file.c_str(),
-                                           O_DIRECT | O_SYNC));
+                                           O_DIRECT | (writeGroupSize > 1 ?
+                                                       0 : O_SYNC),
+                                           writeGroupSize));
     }
     if (storage->getMetadataSize() < sizeof(BackupReplicaMetadata))
         DIE("Storage metadata block too small to hold BackupReplicaMetadata");
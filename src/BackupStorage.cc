@@ -14,6 +14,7 @@
  */
 
 #include "BackupStorage.h"
+#include "ClientException.h"
 #include "CycleCounter.h"
 #include "ShortMacros.h"
 
@@ -30,6 +31,62 @@ BackupStorage::BackupStorage(size_t segmentSize,
 {
 }
 
+/**
+ * Measure and log the write speed of this storage in MB/s under a workload
+ * like that of a backup serving many masters: a replica is open for each
+ * master, and the masters take turns appending small chunks, so storage
+ * sees many small writes interleaved across frames. Returns once all of
+ * the data is durable.
+ *
+ * \return
+ *      Storage write speed in MB/s, or 0 if no replicas could be opened.
+ */
+uint32_t
+BackupStorage::benchmarkWrites()
+{
+    const uint32_t masters = 16;
+    const uint32_t appendsPerReplica = 64;
+    const size_t appendLength = std::max(segmentSize / appendsPerReplica,
+                                         1LU);
+
+    std::vector<FrameRef> frames;
+    for (uint32_t i = 0; i < masters; ++i) {
+        try {
+            frames.push_back(open(false, ServerId(), 0));
+        } catch (BackupOpenRejectedException& e) {
+            // Too few write buffers; use the replicas we've got.
+            break;
+        }
+    }
+    if (frames.empty())
+        return 0;
+
+    std::unique_ptr<char[]> data(new char[appendLength]());
+    Buffer source;
+    source.appendExternal(data.get(), downCast<uint32_t>(appendLength));
+
+    CycleCounter<> counter;
+    for (uint32_t i = 0; i < appendsPerReplica; ++i) {
+        foreach (FrameRef& frame, frames)
+            frame->append(source, 0, appendLength, i * appendLength, NULL, 0);
+    }
+    // Closing the replicas and waiting for them to load ensures that all of
+    // the data has reached storage.
+    foreach (FrameRef& frame, frames) {
+        frame->close();
+        frame->load();
+    }
+    uint64_t ns = std::max(Cycles::toNanoseconds(counter.stop()), 1LU);
+
+    uint64_t bytes = frames.size() * appendsPerReplica * appendLength;
+    uint32_t writeSpeed = downCast<uint32_t>(bytes * 1000UL * 1000 * 1000 /
+                                             (1 << 20) / ns);
+    LOG(NOTICE, "Backup storage speeds: %u MB/s write (%lu replicas with "
+        "interleaved %lu-byte appends)", writeSpeed, frames.size(),
+        appendLength);
+    return writeSpeed;
+}
+
 /**
  * Report the read speed of this storage in MB/s.
  *
@@ -39,6 +96,8 @@ BackupStorage::BackupStorage(size_t segmentSize,
 uint32_t
 BackupStorage::benchmark(BackupStrategy backupStrategy)
 {
+    benchmarkWrites();
+
     const uint32_t count = 16;
     uint32_t readSpeeds[count];
     BackupStorage::FrameRef frames[count];
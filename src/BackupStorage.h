@@ -59,8 +59,9 @@ struct BackupStorageException : public Exception {
  * Subclasses store replica data (along with some higher-level provided
  * metadata) and allow them to be retrieved later. Subclasses may have
  * different durability properties. This includes MultiFileStorage for
- * storing and recovering from disk and InMemoryStorage for storing and
- * recovering from RAM.
+ * storing and recovering from disk, InMemoryStorage for storing and
+ * recovering from RAM, and PmemStorage for storing and recovering from
+ * persistent memory.
  */
 class BackupStorage {
   PUBLIC:
@@ -315,6 +316,7 @@ class BackupStorage {
     virtual ~BackupStorage() {}
 
     virtual uint32_t benchmark(BackupStrategy backupStrategy);
+    uint32_t benchmarkWrites();
     void sleepToThrottleWrites(size_t count, uint64_t ticks) const;
 
     /**
@@ -446,7 +448,8 @@ class BackupStorage {
     virtual void fry() = 0;
 
     /// See #storageType.
-    enum class Type { UNKNOWN = 0, MEMORY = 1, DISK = 2 };
+    enum class Type { UNKNOWN = 0, MEMORY = 1, DISK = 2,
+                      PERSISTENT_MEMORY = 3 };
 
   PROTECTED:
     /**
@@ -0,0 +1,247 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "BulkLoader.h"
+#include "ClientException.h"
+#include "Object.h"
+#include "ObjectFinder.h"
+#include "SegmentIterator.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a BulkLoader.
+ *
+ * \param ramcloud
+ *      The RamCloud object that governs the RPCs.
+ * \param tableId
+ *      Table into which objects are loaded (return value from a previous
+ *      call to getTableId).
+ * \param batchBytes
+ *      A tablet's objects are sent to its master once this many bytes have
+ *      accumulated. Larger batches amortize the master's sync over more
+ *      objects; the limit is the size of a segment.
+ * \param maxOutstanding
+ *      Maximum number of RPCs to keep in flight at once (must be nonzero).
+ */
+BulkLoader::BulkLoader(RamCloud* ramcloud, uint64_t tableId,
+        uint32_t batchBytes, uint32_t maxOutstanding)
+    : ramcloud(ramcloud)
+    , tableId(tableId)
+    , batchBytes(batchBytes)
+    , maxOutstanding(std::max(maxOutstanding, 1u))
+    , filling()
+    , outstanding()
+    , misdirected()
+    , retries(0)
+    , objectsLoaded(0)
+{
+}
+
+/**
+ * Destructor for BulkLoader. Objects that haven't been flushed are
+ * discarded, and RPCs still outstanding are abandoned.
+ */
+BulkLoader::~BulkLoader()
+{
+    for (auto& entry : filling)
+        delete entry.second;
+    foreach (Batch* batch, outstanding)
+        delete batch;
+    foreach (Batch* batch, misdirected)
+        delete batch;
+}
+
+/**
+ * Add an object to the table. The object is packed into the batch for its
+ * tablet; if that fills the batch, the batch is sent (which may wait for
+ * earlier RPCs to complete).
+ *
+ * \param key
+ *      Primary key for the object; copied.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param value
+ *      The object's value; copied.
+ * \param valueLength
+ *      Size in bytes of the value.
+ *
+ * \throw RequestTooLargeException
+ *      The object doesn't fit in a segment.
+ */
+void
+BulkLoader::add(const void* key, KeyLength keyLength, const void* value,
+        uint32_t valueLength)
+{
+    // The master assigns the version and timestamp.
+    Key objectKey(tableId, key, keyLength);
+    Buffer buffer;
+    Object object(objectKey, value, valueLength, 0, 0, buffer);
+    Buffer entry;
+    object.assembleForLog(entry);
+    append(objectKey.getHash(), entry);
+    redistribute();
+}
+
+/**
+ * Send all of the objects added so far and wait until the masters have
+ * stored them.
+ */
+void
+BulkLoader::flush()
+{
+    while (true) {
+        redistribute();
+        while (!filling.empty()) {
+            Batch* batch = filling.begin()->second;
+            filling.erase(filling.begin());
+            send(batch);
+        }
+        if (outstanding.empty() && misdirected.empty())
+            break;
+        if (!outstanding.empty())
+            waitOldest();
+    }
+}
+
+/**
+ * Add an object in log format to the batch for its tablet, sending the
+ * batch if it has filled up.
+ *
+ * \param keyHash
+ *      Hash of the object's primary key.
+ * \param object
+ *      The object, in the format of an Object in the log.
+ */
+void
+BulkLoader::append(uint64_t keyHash, Buffer& object)
+{
+    Batch* batch = NULL;
+    auto it = filling.lower_bound(keyHash);
+    if (it != filling.end() && it->second->firstKeyHash <= keyHash) {
+        batch = it->second;
+    } else {
+        TabletWithLocator* tablet = ramcloud->clientContext->objectFinder->
+                lookupTablet(tableId, keyHash);
+        batch = new Batch(tablet->tablet.startKeyHash,
+                tablet->tablet.endKeyHash);
+        filling[batch->lastKeyHash] = batch;
+    }
+
+    if (!batch->segment->append(LOG_ENTRY_TYPE_OBJ, object)) {
+        if (batch->segment->getAppendedLength() == 0) {
+            throw RequestTooLargeException(HERE);
+        }
+        // Full: ship it and start a new batch for the same tablet.
+        filling.erase(batch->lastKeyHash);
+        send(batch);
+        append(keyHash, object);
+        return;
+    }
+    if (batch->segment->getAppendedLength() >= batchBytes) {
+        filling.erase(batch->lastKeyHash);
+        send(batch);
+    }
+}
+
+/**
+ * Add the objects from misdirected batches again, so that they are
+ * regrouped by their current tablets. If objects keep being misdirected
+ * (e.g. because a tablet is being migrated), wait a bit longer before
+ * each retry.
+ */
+void
+BulkLoader::redistribute()
+{
+    while (!misdirected.empty()) {
+        if (retries > 0) {
+            usleep(std::min(1000u << std::min(retries, 10u),
+                    MAX_RETRY_DELAY_US));
+        }
+        retries++;
+        ramcloud->clientContext->objectFinder->flush(tableId);
+
+        // Batches that are misdirected while we're at it are picked up on
+        // the next iteration.
+        std::list<Batch*> batches;
+        batches.swap(misdirected);
+        while (!batches.empty()) {
+            std::unique_ptr<Batch> batch(batches.front());
+            batches.pop_front();
+            for (SegmentIterator it(*batch->segment); !it.isDone();
+                    it.next()) {
+                if (it.getType() != LOG_ENTRY_TYPE_OBJ)
+                    continue;
+                Buffer object;
+                it.appendToBuffer(object);
+                Key key(LOG_ENTRY_TYPE_OBJ, object);
+                append(key.getHash(), object);
+            }
+        }
+    }
+}
+
+/**
+ * Issue the RPC for a batch, first waiting for older RPCs if the limit on
+ * outstanding RPCs has been reached.
+ *
+ * \param batch
+ *      The batch to send; no longer in #filling. This object takes
+ *      ownership of it.
+ */
+void
+BulkLoader::send(Batch* batch)
+{
+    // Reap RPCs that have already finished, so that segments are freed
+    // promptly.
+    while (!outstanding.empty() && outstanding.front()->rpc->isReady())
+        waitOldest();
+    while (outstanding.size() >= maxOutstanding)
+        waitOldest();
+
+    batch->segment->close();
+    outstanding.push_back(batch);
+    batch->rpc.construct(ramcloud, tableId, batch->firstKeyHash,
+            batch->lastKeyHash, batch->segment);
+}
+
+/**
+ * Wait for the oldest outstanding RPC to complete, then discard its
+ * batch. If the master no longer owns the whole tablet (because it was
+ * split or migrated after the batch was started), the batch is moved to
+ * #misdirected instead, and #add or #flush later sends its objects again
+ * (see #redistribute).
+ */
+void
+BulkLoader::waitOldest()
+{
+    Batch* batch = outstanding.front();
+    outstanding.pop_front();
+    uint32_t objectCount;
+    if (batch->rpc->wait(&objectCount)) {
+        objectsLoaded += objectCount;
+        retries = 0;
+        delete batch;
+        return;
+    }
+
+    LOG(NOTICE, "Bulk load batch for tablet [0x%lx,0x%lx] in table %lu "
+            "was misdirected; redistributing its objects",
+            batch->firstKeyHash, batch->lastKeyHash, tableId);
+    misdirected.push_back(batch);
+}
+
+} // namespace RAMCloud
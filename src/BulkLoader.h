@@ -0,0 +1,149 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_BULKLOADER_H
+#define RAMCLOUD_BULKLOADER_H
+
+#include <list>
+#include <map>
+
+#include "RamCloud.h"
+#include "Segment.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+/**
+ * A BulkLoader loads a large number of objects into a table much faster
+ * than write or multiWrite. Objects are packed on the client into Segment
+ * containers, one per tablet, and each full segment is shipped to the
+ * tablet's master in a single BULK_LOAD RPC; the master replays the
+ * segment into its log with one sync, just as it does for segments
+ * received during migration. Several RPCs may be outstanding at once, so
+ * the client keeps packing while earlier segments are in flight.
+ *
+ * Bulk loading is intended for initial loads of tables that nobody is
+ * using yet:
+ *   - Objects in a segment become visible on the master before they are
+ *     durable.
+ *   - An object doesn't replace an existing object with the same key
+ *     unless the existing one is older than the segment (each segment is
+ *     given a new version when it arrives). If the same key is added more
+ *     than once, the later copy wins only if it is sent in a later
+ *     segment.
+ *   - Objects have only a primary key (no secondary index entries).
+ *
+ * Objects are not guaranteed to have been stored until #flush returns.
+ */
+class BulkLoader {
+  PUBLIC:
+    /// Default number of bytes of objects to send to a master in each RPC.
+    static const uint32_t DEFAULT_BATCH_BYTES = 1 << 20;
+
+    /// Default limit on the number of BULK_LOAD RPCs outstanding at once.
+    static const uint32_t DEFAULT_MAX_OUTSTANDING = 4;
+
+    /// Upper limit on the delay (in microseconds) before objects from
+    /// misdirected batches are sent again.
+    static const uint32_t MAX_RETRY_DELAY_US = 100000;
+
+    BulkLoader(RamCloud* ramcloud, uint64_t tableId,
+            uint32_t batchBytes = DEFAULT_BATCH_BYTES,
+            uint32_t maxOutstanding = DEFAULT_MAX_OUTSTANDING);
+    ~BulkLoader();
+    void add(const void* key, KeyLength keyLength, const void* value,
+            uint32_t valueLength);
+    void flush();
+
+    /// Returns the number of objects that masters have acknowledged.
+    uint64_t getObjectCount() { return objectsLoaded; }
+
+  PRIVATE:
+    /**
+     * A segment of objects destined for one tablet, along with the RPC
+     * that carries it once the segment has been sent. The segment must
+     * stay around until the RPC completes, since the request refers to its
+     * memory.
+     */
+    struct Batch {
+        Batch(uint64_t firstKeyHash, uint64_t lastKeyHash)
+            : firstKeyHash(firstKeyHash)
+            , lastKeyHash(lastKeyHash)
+            , segment(new Segment())
+            , rpc()
+        {}
+
+        ~Batch()
+        {
+            rpc.destroy();
+            delete segment;
+        }
+
+        /// Range of key hashes of the tablet, as of when the batch was
+        /// started.
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+
+        /// Holds the objects (owned by this object).
+        Segment* segment;
+
+        /// RPC carrying the segment to the tablet's master.
+        Tub<BulkLoadRpc> rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
+    void append(uint64_t keyHash, Buffer& object);
+    void redistribute();
+    void send(Batch* batch);
+    void waitOldest();
+
+    /// Used to issue RPCs and locate tablets.
+    RamCloud* ramcloud;
+
+    /// Table being loaded.
+    uint64_t tableId;
+
+    /// A batch is sent once it holds at least this many bytes.
+    uint32_t batchBytes;
+
+    /// Maximum number of RPCs outstanding at once.
+    uint32_t maxOutstanding;
+
+    /// Batches that are still being filled, indexed by the last key hash
+    /// of their tablets.
+    std::map<uint64_t, Batch*> filling;
+
+    /// Batches whose RPCs have been issued, oldest first.
+    std::list<Batch*> outstanding;
+
+    /// Batches that were rejected because their masters no longer own
+    /// the whole tablet; #redistribute sends their objects again.
+    std::list<Batch*> misdirected;
+
+    /// Number of times in a row that misdirected objects have been
+    /// redistributed without any RPC succeeding in between; used to back
+    /// off while the table's tablets are in flux.
+    uint32_t retries;
+
+    /// Number of objects acknowledged by masters so far.
+    uint64_t objectsLoaded;
+
+    DISALLOW_COPY_AND_ASSIGN(BulkLoader);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_BULKLOADER_H
@@ -0,0 +1,175 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "BulkLoader.h"
+#include "ClientException.h"
+#include "MasterService.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class BulkLoaderTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+
+    BulkLoaderTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table", 2);
+    }
+
+    // Returns the value of an object, or the name of the exception if the
+    // read fails.
+    string
+    read(const char* key)
+    {
+        Buffer value;
+        try {
+            ramcloud->read(tableId, key, downCast<uint16_t>(strlen(key)),
+                    &value);
+        } catch (ClientException& e) {
+            return statusToSymbol(e.status);
+        }
+        return TestUtil::toString(&value);
+    }
+
+    // Adds objects "key0" ... "key<count-1>", with values "value0" ...
+    void
+    addObjects(BulkLoader* loader, int count)
+    {
+        for (int i = 0; i < count; i++) {
+            string key = format("key%d", i);
+            string value = format("value%d", i);
+            loader->add(key.data(), downCast<KeyLength>(key.size()),
+                    value.data(), downCast<uint32_t>(value.size()));
+        }
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BulkLoaderTest);
+};
+
+TEST_F(BulkLoaderTest, add_batchesByTablet) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    addObjects(&loader, 20);
+
+    // One batch per tablet, and nothing sent yet.
+    EXPECT_EQ(2U, loader.filling.size());
+    EXPECT_EQ(0U, loader.outstanding.size());
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", read("key0"));
+
+    loader.flush();
+    EXPECT_EQ(20U, loader.getObjectCount());
+    EXPECT_EQ(0U, loader.filling.size());
+    EXPECT_EQ("value0", read("key0"));
+    EXPECT_EQ("value19", read("key19"));
+}
+
+TEST_F(BulkLoaderTest, add_sendsFullBatches) {
+    BulkLoader loader(ramcloud.get(), tableId, 100, 1);
+    addObjects(&loader, 50);
+    EXPECT_GE(1U, loader.outstanding.size());
+    EXPECT_LT(0U, loader.getObjectCount());
+    loader.flush();
+    EXPECT_EQ(50U, loader.getObjectCount());
+    EXPECT_EQ("value17", read("key17"));
+}
+
+TEST_F(BulkLoaderTest, add_objectTooLarge) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    string value(Segment::DEFAULT_SEGMENT_SIZE, 'x');
+    Status status = STATUS_OK;
+    try {
+        loader.add("a", 1, value.data(), downCast<uint32_t>(value.size()));
+    } catch (RequestTooLargeException& e) {
+        status = e.status;
+    }
+    EXPECT_EQ(STATUS_REQUEST_TOO_LARGE, status);
+}
+
+TEST_F(BulkLoaderTest, add_replacesExistingObjects) {
+    ramcloud->write(tableId, "a", 1, "old a");
+    BulkLoader loader(ramcloud.get(), tableId);
+    loader.add("a", 1, "new a", 5);
+    loader.flush();
+    EXPECT_EQ("new a", read("a"));
+}
+
+TEST_F(BulkLoaderTest, waitOldest_misdirected) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    addObjects(&loader, 20);
+    ASSERT_EQ(2U, loader.filling.size());
+
+    // Split both tablets after the batches were started, so that neither
+    // master owns a batch's whole range any more.
+    ramcloud->splitTablet("table", 1UL << 62);
+    ramcloud->splitTablet("table", 3UL << 62);
+    TestLog::reset();
+    loader.flush();
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "was misdirected; redistributing its objects"));
+    EXPECT_EQ(20U, loader.getObjectCount());
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(format("value%d", i), read(format("key%d", i).c_str()));
+    }
+    EXPECT_EQ(0U, loader.misdirected.size());
+    EXPECT_EQ(0U, loader.retries);
+}
+
+TEST_F(BulkLoaderTest, waitOldest_misdirectedBatchRequeued) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    addObjects(&loader, 20);
+    ramcloud->splitTablet("table", 1UL << 62);
+    BulkLoader::Batch* batch = loader.filling.begin()->second;
+    loader.filling.erase(loader.filling.begin());
+    loader.send(batch);
+
+    // The objects aren't resent until the batch gets back to the top level.
+    loader.waitOldest();
+    EXPECT_EQ(0U, loader.outstanding.size());
+    ASSERT_EQ(1U, loader.misdirected.size());
+    EXPECT_EQ(batch, loader.misdirected.front());
+    EXPECT_EQ(1U, loader.filling.size());
+
+    loader.redistribute();
+    EXPECT_EQ(0U, loader.misdirected.size());
+    EXPECT_EQ(1U, loader.retries);
+    EXPECT_LT(1U, loader.filling.size());
+    loader.flush();
+    EXPECT_EQ(20U, loader.getObjectCount());
+    EXPECT_EQ(0U, loader.retries);
+}
+
+}  // namespace RAMCloud
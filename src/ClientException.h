@@ -242,6 +242,9 @@ DEFINE_EXCEPTION(ExpiredLeaseException,
 DEFINE_EXCEPTION(TxOpAfterCommit,
                  STATUS_TX_OP_AFTER_COMMIT,
                  ClientException)
+DEFINE_EXCEPTION(SnapshotTooOldException,
+                 STATUS_SNAPSHOT_TOO_OLD,
+                 ClientException)
 
 } // namespace RAMCloud
 
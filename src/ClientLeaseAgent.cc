@@ -31,6 +31,8 @@ ClientLeaseAgent::ClientLeaseAgent(RamCloud* ramcloud)
     : mutex("ClientLeaseAgent")
     , ramcloud(ramcloud)
     , lease({0, 0, 0})
+    , leaseTimestampCycles(0)
+    , observedTime()
     , lastRenewalTimeCycles(0)
     , nextRenewalTimeCycles(0)
     , leaseExpirationCycles(0)
@@ -63,6 +65,46 @@ ClientLeaseAgent::getLease()
     return lease;
 }
 
+/**
+ * Return an estimate of the current cluster time, for use as the time of a
+ * snapshot (see Transaction). The estimate is the timestamp of the latest
+ * lease plus the time elapsed since it was requested; it is always later than
+ * any time passed to observeClusterTime, so that a snapshot includes the
+ * client's own committed transactions. This method may block in the same way
+ * as getLease.
+ */
+ClusterTime
+ClientLeaseAgent::getClusterTime()
+{
+    getLease();
+
+    SpinLock::Guard _(mutex);
+    ClusterTime estimate = ClusterTime(lease.timestamp) +
+            ClusterTimeDuration::fromNanoseconds(downCast<int64_t>(
+                    Cycles::toNanoseconds(Cycles::rdtsc() -
+                                          leaseTimestampCycles)));
+    ClusterTime minimum = observedTime +
+            ClusterTimeDuration::fromNanoseconds(1);
+    if (estimate < minimum)
+        return minimum;
+    return estimate;
+}
+
+/**
+ * Record a cluster time observed by this client, so that future calls to
+ * getClusterTime will return later times.
+ *
+ * \param time
+ *      The observed cluster time.
+ */
+void
+ClientLeaseAgent::observeClusterTime(ClusterTime time)
+{
+    SpinLock::Guard _(mutex);
+    if (observedTime < time)
+        observedTime = time;
+}
+
 /**
  * Make incremental progress toward ensuring a valid lease. This method must be
  * called periodically in order to maintain a valid lease.
@@ -95,6 +137,7 @@ ClientLeaseAgent::poll()
             // Wait for rpc to become ready.
         } else {
             lease = renewLeaseRpc->wait();
+            leaseTimestampCycles = lastRenewalTimeCycles;
             renewLeaseRpc.destroy();
             // Use local rdtsc cycle time to estimate when the lease will expire
             // if the lease is not renewed.
@@ -17,6 +17,7 @@
 #define RAMCLOUD_CLIENTLEASEAGENT_H
 
 #include "Common.h"
+#include "ClusterTime.h"
 #include "CoordinatorClient.h"
 #include "WireFormat.h"
 
@@ -37,6 +38,8 @@ class ClientLeaseAgent {
   public:
     explicit ClientLeaseAgent(RamCloud* ramcloud);
     WireFormat::ClientLease getLease();
+    ClusterTime getClusterTime();
+    void observeClusterTime(ClusterTime time);
     void poll();
 
   PRIVATE:
@@ -49,6 +52,14 @@ class ClientLeaseAgent {
     /// Latest ClientLease received from the coordinator.
     WireFormat::ClientLease lease;
 
+    /// The Cycles::rdtsc() value (in cycles) when the request for #lease was
+    /// issued.  Used to estimate the current cluster time.
+    uint64_t leaseTimestampCycles;
+
+    /// Largest cluster time observed by this client (e.g. the commit time of
+    /// one of its transactions); see observeClusterTime.
+    ClusterTime observedTime;
+
     /// The Cycles::rdtsc() value (in cycles) when the last ClientLease renewal
     /// request was issued.  Used to estimate when the lease term will elapse.
     uint64_t lastRenewalTimeCycles;
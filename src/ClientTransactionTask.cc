@@ -38,6 +38,7 @@ ClientTransactionTask::ClientTransactionTask(RamCloud* ramcloud)
     , state(INIT)
     , decision(WireFormat::TxDecision::UNDECIDED)
     , lease()
+    , commitTime()
     , txId(0)
     , prepareRpcs()
     , decisionRpcs()
@@ -164,6 +165,11 @@ ClientTransactionTask::performTask()
                         ClientException::throwException(HERE,
                                                         STATUS_INTERNAL_ERROR);
                 }
+
+                // Snapshots this client reads from now on must include the
+                // transaction's writes.
+                if (decision == WireFormat::TxDecision::COMMIT)
+                    ramcloud->clientLeaseAgent->observeClusterTime(commitTime);
             }
         }
         if (state == DECISION) {
@@ -577,6 +583,7 @@ ClientTransactionTask::DecisionRpc::DecisionRpc(RamCloud* ramcloud,
     reqHdr->transactionId = task->txId;
     reqHdr->recovered = false;
     reqHdr->participantCount = 0;
+    reqHdr->commitTime = task->commitTime.getEncoded();
 }
 
 /**
@@ -666,7 +673,7 @@ ClientTransactionTask::PrepareRpc::PrepareRpc(RamCloud* ramcloud,
     : ClientTransactionRpcWrapper(ramcloud,
                                   session,
                                   task,
-                                  sizeof(WireFormat::TxDecision::Response))
+                                  sizeof(WireFormat::TxPrepare::Response))
     , reqHdr(allocHeader<WireFormat::TxPrepare>())
 {
     reqHdr->lease = task->lease;
@@ -764,6 +771,9 @@ ClientTransactionTask::PrepareRpc::wait()
 
     WireFormat::TxPrepare::Response* respHdr =
             response->getStart<WireFormat::TxPrepare::Response>();
+    ClusterTime prepareTime(respHdr->clusterTime);
+    if (task->commitTime < prepareTime)
+        task->commitTime = prepareTime;
     return respHdr->vote;
 }
 
@@ -20,6 +20,8 @@
 #include <map>
 #include <memory>
 
+#include "Common.h"
+#include "ClusterTime.h"
 #include "Dispatch.h"
 #include "RamCloud.h"
 
@@ -118,6 +120,11 @@ class ClientTransactionTask : public RpcTracker::TrackedRpc {
     /// Lease information for to this transaction.
     WireFormat::ClientLease lease;
 
+    /// Cluster time at which a committed transaction's writes become visible
+    /// to snapshot reads: the latest time reported by any participant when
+    /// it prepared.
+    ClusterTime commitTime;
+
     /// RpcId used to identify this transaction.  Also is the rpcId that should
     /// be completed once the transaction is complete.
     uint64_t txId;
@@ -405,14 +405,20 @@ CoordinatorClient::getTableConfig(Context* context,
  *      Overall information about this RAMCloud server or client.
  * \param tableId
  *      The id of a table whose tablet configuration is to be fetched.
+ * \param knownVersion
+ *      Version of the configuration that the caller already has (as
+ *      returned by an earlier call to wait), or 0. If the configuration
+ *      hasn't changed since then, the coordinator doesn't send it again.
  */
-GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
+GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId,
+        uint64_t knownVersion)
     : CoordinatorRpcWrapper(context,
             sizeof(WireFormat::GetTableConfig::Response))
 {
     WireFormat::GetTableConfig::Request* reqHdr(
             allocHeader<WireFormat::GetTableConfig>());
     reqHdr->tableId = tableId;
+    reqHdr->knownVersion = knownVersion;
     send();
 }
 
@@ -425,17 +431,32 @@ GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
  *      in the table given by tableId argument passed to the constructor.
  *      If the table does not exist, then the result will contain no tablets
  *      and indexes.
+ * \param[out] version
+ *      If non-NULL, the version of the table's configuration is returned
+ *      here; it can be passed to the constructor of a later RPC as
+ *      knownVersion. 0 means the configuration shouldn't be reused.
+ * \return
+ *      False means that the configuration hasn't changed since the
+ *      knownVersion passed to the constructor, so \a tableConfig was left
+ *      untouched; true means \a tableConfig has been filled in.
  */
-void
-GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig)
+bool
+GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig, uint64_t* version)
 {
     waitInternal(context->dispatch);
     const WireFormat::GetTableConfig::Response* respHdr(
             getResponseHeader<WireFormat::GetTableConfig>());
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
+    if (version != NULL)
+        *version = respHdr->version;
+    const WireFormat::GetTableConfig::Request* reqHdr(
+            getRequestHeader<WireFormat::GetTableConfig>());
+    if (respHdr->version != 0 && respHdr->version == reqHdr->knownVersion)
+        return false;
     ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
                                 respHdr->tableConfigLength, tableConfig);
+    return true;
 }
 
 /**
@@ -159,9 +159,10 @@ class GetServerListRpc : public CoordinatorRpcWrapper {
  */
 class GetTableConfigRpc : public CoordinatorRpcWrapper {
     public:
-    explicit GetTableConfigRpc(Context* context, uint64_t tableId);
+    GetTableConfigRpc(Context* context, uint64_t tableId,
+            uint64_t knownVersion = 0);
     ~GetTableConfigRpc() {}
-    void wait(ProtoBuf::TableConfig* tableConfig);
+    bool wait(ProtoBuf::TableConfig* tableConfig, uint64_t* version = NULL);
 
     PRIVATE:
     DISALLOW_COPY_AND_ASSIGN(GetTableConfigRpc);
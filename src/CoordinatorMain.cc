@@ -52,8 +52,10 @@ main(int argc, char *argv[])
     string localLocator("???");
     uint32_t deadServerTimeout;
     uint32_t maxCores;
+    uint32_t serverListFanout;
     bool reset;
     bool neverKill;
+    TabletBalancer::Config balancerConfig;
     try {
         OptionsDescription coordinatorOptions("Coordinator");
         coordinatorOptions.add_options()
@@ -74,6 +76,25 @@ main(int argc, char *argv[])
              "under this limit, but may occasionally need to exceed it "
              "(e.g., to avoid distributed deadlocks). Th limit does not "
              "include cleaner threads and some other miscellaneous functions.")
+            ("balanceInterval",
+             ProgramOptions::value<double>(&balancerConfig.intervalSeconds)->
+                default_value(0),
+             "Number of seconds between checks of the load on masters; if "
+             "the load is unbalanced, the coordinator splits and migrates "
+             "tablets to even it out. 0 means never rebalance automatically.")
+            ("balanceRatio",
+             ProgramOptions::value<double>(&balancerConfig.imbalanceRatio)->
+                default_value(1.25),
+             "Tablets are only rebalanced if the busiest master's load "
+             "(operations per second or bytes stored) exceeds the average "
+             "load of all masters by at least this factor.")
+            ("serverListFanout",
+             ProgramOptions::value<uint32_t>(&serverListFanout)->
+                default_value(1),
+             "Maximum number of servers reached by each server list update "
+             "RPC sent by the coordinator: the recipient forwards the update "
+             "to the others. Values greater than 1 reduce the load on the "
+             "coordinator in large clusters.")
             ("neverKill,n",
              ProgramOptions::bool_switch(&neverKill),
              "If specified, the coordinator will never attempt to kill any "
@@ -145,6 +166,9 @@ main(int argc, char *argv[])
                                               false,
                                               neverKill);
         AdminService adminService(&context, NULL, NULL);
+        context.coordinatorServerList->setRelayFanout(serverListFanout);
+        if (balancerConfig.intervalSeconds > 0)
+            coordinatorService.tabletBalancer.enable(balancerConfig);
         while (true) {
             context.dispatch->poll();
         }
@@ -15,6 +15,7 @@
 
 #include <list>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Common.h"
 #include "ClientException.h"
@@ -49,6 +50,8 @@ CoordinatorServerList::CoordinatorServerList(Context* context)
     , updaterSleeping(false)
     , lastScan()
     , updates()
+    , serializedUpdates()
+    , relayFanout(1)
     , hasUpdatesOrStop()
     , listUpToDate()
     , updaterThread()
@@ -534,6 +537,25 @@ CoordinatorServerList::setMasterRecoveryInfo(
     }
 }
 
+/**
+ * Control how server list updates are propagated: the coordinator sends
+ * each update to one server, which then forwards it to as many as
+ * \a fanout - 1 other servers that need the same update. This reduces the
+ * number of RPCs the coordinator must send to update the cluster by a
+ * factor of \a fanout, at the cost of an extra hop for most servers.
+ *
+ * \param fanout
+ *      Maximum number of servers updated by each RPC from the coordinator;
+ *      1 (the default) means that the coordinator updates each server
+ *      directly.
+ */
+void
+CoordinatorServerList::setRelayFanout(uint32_t fanout)
+{
+    Lock _(mutex);
+    relayFanout = std::max(fanout, 1u);
+}
+
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList Private Methods
 //////////////////////////////////////////////////////////////////////
@@ -863,6 +885,7 @@ void
 CoordinatorServerList::pushUpdate(const Lock& lock, Entry* entry)
 {
     ++version;
+    serializedUpdates.clear();
     updates.emplace_back(version);
     ServerListUpdate* update = &(updates.back());
     update->incremental.set_version_number(version);
@@ -906,6 +929,7 @@ CoordinatorServerList::insertUpdate(const Lock& lock, Entry* entry,
 
     // Note: "insert" is used instead of "emplace" below, because
     // emplace doesn't appear to work in gcc 4.4.7 (as of 10/2013).
+    serializedUpdates.clear();
     it = updates.insert(it, ServerListUpdate(version));
     it->incremental.set_version_number(version);
     it->incremental.set_type(ProtoBuf::ServerList_Type_UPDATE);
@@ -1154,8 +1178,19 @@ CoordinatorServerList::checkUpdates()
             rpc->wait();
             workSuccess(rpc->id, rpc->getResponseHeader<
                     WireFormat::UpdateServerList>()->currentVersion);
+            for (size_t i = 0; i < rpc->relayTargets.size(); i++) {
+                uint64_t relayedVersion = rpc->getRelayedVersion(i);
+                if (relayedVersion == 0) {
+                    workFailed(rpc->relayTargets[i]);
+                } else {
+                    workSuccess(rpc->relayTargets[i], relayedVersion);
+                }
+            }
         } catch (const ServerNotUpException& e) {
             workFailed(rpc->id);
+            foreach (ServerId target, rpc->relayTargets) {
+                workFailed(target);
+            }
         }
         (*it)->destroy();
         spareRpcs.push_back(*it);
@@ -1242,36 +1277,32 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
             // update required
             if (server->verifiedVersion < version &&
                     server->updateVersion == server->verifiedVersion) {
-                if (server->verifiedVersion == UNINITIALIZED_VERSION) {
-                    // New server, send full server list
-                    ProtoBuf::ServerList fullList;
-                    serialize(lock, &fullList, {WireFormat::MASTER_SERVICE,
-                            WireFormat::BACKUP_SERVICE});
-                    rpc->construct(context, server->serverId, &fullList);
-                    server->updateVersion = version;
-                } else {
-                    // Incremental update(s). Create an RPC containing all
-                    // the updates that this server hasn't yet seen.
-                    int updatesInRpc = 0;
-                    for (size_t i = 0; i < updates.size(); i++) {
-                        ServerListUpdate* update = &updates[i];
-                        if (update->version <= server->verifiedVersion) {
-                            continue;
-                        }
-                        if (updatesInRpc == 0) {
-                            rpc->construct(context, server->serverId,
-                                    &update->incremental);
-                        } else {
-                            (*rpc)->appendServerList(&update->incremental);
-                        }
-                        server->updateVersion = update->version;
-                        updatesInRpc++;
-                        if (updatesInRpc >= MAX_UPDATES_PER_RPC) {
-                            break;
-                        }
+                // New servers get the full list; others get all the
+                // updates they haven't yet seen, coalesced into one.
+                uint64_t baseVersion = server->verifiedVersion;
+                const SerializedUpdate* update =
+                        getSerializedUpdate(lock, baseVersion);
+
+                // Have this server relay the update to other idle servers
+                // that need exactly the same one.
+                vector<ServerId> relayTargets;
+                for (size_t j = (i + 1) % serverList.size();
+                        j != i && relayTargets.size() + 1 < relayFanout;
+                        j = (j + 1) % serverList.size()) {
+                    Entry* peer = serverList[j].entry.get();
+                    if (peer && peer->status == ServerStatus::UP &&
+                            peer->services.has(WireFormat::ADMIN_SERVICE) &&
+                            peer->verifiedVersion == baseVersion &&
+                            peer->updateVersion == baseVersion) {
+                        relayTargets.push_back(peer->serverId);
+                        peer->updateVersion = update->version;
+                        numUpdatingServers++;
                     }
                 }
 
+                rpc->construct(context, server->serverId, &update->list,
+                        relayTargets);
+                server->updateVersion = update->version;
                 numUpdatingServers++;
                 lastScan.searchIndex = i;
                 return true;
@@ -1307,6 +1338,84 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
     return false;
 }
 
+/**
+ * Returns the update that will bring a server list from a given version
+ * up to date (or as close to up to date as fits in one RPC). Updates are
+ * serialized once, then shared by all of the servers that need them.
+ *
+ * \param lock
+ *      Explicitly needs CoordinatorServerList lock.
+ * \param baseVersion
+ *      Version of the server list to be updated; UNINITIALIZED_VERSION
+ *      means the server list is empty and needs a full list.
+ * \return
+ *      The update. It remains valid until the version of the server list
+ *      changes.
+ */
+const CoordinatorServerList::SerializedUpdate*
+CoordinatorServerList::getSerializedUpdate(const Lock& lock,
+        uint64_t baseVersion)
+{
+    SerializedUpdate* update = &serializedUpdates[baseVersion];
+    if (update->version != 0) {
+        return update;
+    }
+
+    ProtoBuf::ServerList list;
+    if (baseVersion == UNINITIALIZED_VERSION) {
+        serialize(lock, &list, {WireFormat::MASTER_SERVICE,
+                WireFormat::BACKUP_SERVICE});
+    } else {
+        // Coalesce the missing updates. Servers that were added and
+        // removed within this range can be left out entirely: the
+        // recipient never heard of them.
+        list.set_version_number(baseVersion);
+        list.set_type(ProtoBuf::ServerList_Type_UPDATE);
+        list.set_base_version(baseVersion);
+        std::unordered_set<uint64_t> added;
+        std::unordered_set<uint64_t> transient;
+        int count = 0;
+        foreach (const ServerListUpdate& u, updates) {
+            if (u.version <= baseVersion) {
+                continue;
+            }
+            if (count >= MAX_UPDATES_PER_RPC) {
+                break;
+            }
+            foreach (const ProtoBuf::ServerList_Entry& entry,
+                    u.incremental.server()) {
+                ServerStatus status =
+                        static_cast<ServerStatus>(entry.status());
+                if (status == ServerStatus::UP) {
+                    added.insert(entry.server_id());
+                } else if (status == ServerStatus::REMOVE &&
+                        added.count(entry.server_id())) {
+                    transient.insert(entry.server_id());
+                }
+            }
+            list.set_version_number(u.version);
+            count++;
+        }
+        foreach (const ServerListUpdate& u, updates) {
+            if (u.version <= baseVersion) {
+                continue;
+            }
+            if (u.version > list.version_number()) {
+                break;
+            }
+            foreach (const ProtoBuf::ServerList_Entry& entry,
+                    u.incremental.server()) {
+                if (!transient.count(entry.server_id())) {
+                    *list.add_server() = entry;
+                }
+            }
+        }
+    }
+    list.SerializeToString(&update->list);
+    update->version = list.version_number();
+    return update;
+}
+
 /**
  * Signals the success of updater to complete an update RPC. This
  * will update internal metadata to allow the target server to be
@@ -1443,6 +1552,7 @@ CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
             const ProtoBuf::ServerList* list)
     : ServerIdRpcWrapper(context, serverId,
             sizeof(WireFormat::UpdateServerList::Response))
+    , relayTargets()
 {
     allocHeader<WireFormat::UpdateServerList>(serverId);
 
@@ -1452,6 +1562,69 @@ CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
     part->serverListLength = serializeToRequest(&request, list);
 }
 
+/**
+ * Constructor for UpdateServerListRpc that creates but does not send()
+ * an RPC carrying an update that has already been serialized. If
+ * \a relayTargets isn't empty, the RPC is a RELAY_SERVER_LIST request:
+ * the recipient applies the update, then forwards it to the given servers.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Identifies the server to which this update should be sent.
+ * \param list
+ *      A serialized ProtoBuf::ServerList; copied.
+ * \param relayTargets
+ *      Servers to which the recipient should forward the update. Their
+ *      new versions can be retrieved with getRelayedVersion() once the
+ *      RPC has completed.
+ */
+CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
+            Context* context,
+            ServerId serverId,
+            const string* list,
+            const vector<ServerId>& relayTargets)
+    : ServerIdRpcWrapper(context, serverId, relayTargets.empty()
+            ? sizeof(WireFormat::UpdateServerList::Response)
+            : sizeof(WireFormat::RelayServerList::Response))
+    , relayTargets(relayTargets)
+{
+    if (relayTargets.empty()) {
+        allocHeader<WireFormat::UpdateServerList>(serverId);
+    } else {
+        auto* reqHdr = allocHeader<WireFormat::RelayServerList>(serverId);
+        reqHdr->relayCount = downCast<uint32_t>(relayTargets.size());
+        reqHdr->timeoutNanoseconds = RELAY_TIMEOUT_NANOSECONDS;
+        foreach (ServerId target, relayTargets) {
+            request.emplaceAppend<uint64_t>(target.getId());
+        }
+    }
+
+    auto* part = request.emplaceAppend<
+            WireFormat::UpdateServerList::Request::Part>();
+    part->serverListLength = downCast<uint32_t>(list->size());
+    request.appendCopy(list->data(), part->serverListLength);
+}
+
+/**
+ * After a RELAY_SERVER_LIST RPC has completed, returns the server list
+ * version of one of the servers to which the update was relayed.
+ *
+ * \param index
+ *      Index of the server in the relayTargets passed to the constructor.
+ * \return
+ *      The server's version after receiving the update, or 0 if the
+ *      recipient of this RPC couldn't forward the update to it.
+ */
+uint64_t
+CoordinatorServerList::UpdateServerListRpc::getRelayedVersion(size_t index)
+{
+    const uint64_t* version = response->getOffset<uint64_t>(
+            downCast<uint32_t>(sizeof(WireFormat::RelayServerList::Response)
+            + index * sizeof(uint64_t)));
+    return (version == NULL) ? 0 : *version;
+}
+
 /**
  * Appends a server list update ProtoBuf to the request rpc. This is used
  * to batch up multiple server list updates into one rpc for the server and
@@ -20,6 +20,7 @@
 #include <thread>
 #include <list>
 #include <deque>
+#include <map>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -55,6 +56,13 @@ namespace RAMCloud {
  * The updates are done asynchronously from the CoordinatorServerList call
  * thread. sync() can be called to force a synchronization point.
  *
+ * To keep the cost of propagation down in large clusters, a server that is
+ * several versions behind receives a single update that coalesces all of
+ * the versions it is missing, and each such update is serialized once and
+ * shared by all of the servers that need it. In addition, if the relay
+ * fanout is set (see setRelayFanout()), the coordinator sends each update
+ * to just one of the servers that need it, which forwards it to the others.
+ *
  * CoordinatorServerList is thread-safe and supports ServerTrackers.
  *
  * This class publicly extends AbstractServerList to provide a common
@@ -72,6 +80,11 @@ class CoordinatorServerList : public AbstractServerList{
     /// batching, small enough that we never overflow the RPC size limit).
     static const int MAX_UPDATES_PER_RPC = 100;
 
+    /// A server relaying an update to other servers gives up on those that
+    /// haven't responded within this many nanoseconds; the coordinator
+    /// will try them again later.
+    static const uint64_t RELAY_TIMEOUT_NANOSECONDS = 500 * 1000 * 1000;
+
     /**
      * This class represents one entry in the CoordinatorServerList. Each
      * entry describes a specific server in the system and contains the
@@ -180,6 +193,7 @@ class CoordinatorServerList : public AbstractServerList{
     virtual void serverCrashed(ServerId serverId);
     bool setMasterRecoveryInfo(ServerId serverId,
                 const ProtoBuf::MasterRecoveryInfo* recoveryInfo);
+    void setRelayFanout(uint32_t fanout);
     void startUpdater();
 
   PRIVATE:
@@ -216,13 +230,21 @@ class CoordinatorServerList : public AbstractServerList{
       public:
         UpdateServerListRpc(Context* context, ServerId serverId,
                 const ProtoBuf::ServerList* list);
+        UpdateServerListRpc(Context* context, ServerId serverId,
+                const string* list, const vector<ServerId>& relayTargets);
         ~UpdateServerListRpc() {}
         /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
         void wait() {waitAndCheckErrors();}
         ServerId getTargetServerId();
+        uint64_t getRelayedVersion(size_t index);
 
       PRIVATE:
         bool appendServerList(const ProtoBuf::ServerList* list);
+
+        /// Servers to which the recipient should forward the update (empty
+        /// means the update is for the recipient only).
+        vector<ServerId> relayTargets;
+
         DISALLOW_COPY_AND_ASSIGN(UpdateServerListRpc);
     };
 
@@ -302,6 +324,25 @@ class CoordinatorServerList : public AbstractServerList{
         }
     };
 
+    /**
+     * An update that brings a server list from a particular version up to
+     * date (as of when the update was created), in serialized form, ready
+     * to be copied into RPCs.
+     */
+    struct SerializedUpdate {
+        SerializedUpdate()
+            : version(0)
+            , list()
+        {}
+
+        /// Server list version after applying the update.
+        uint64_t version;
+
+        /// A serialized ProtoBuf::ServerList: either a full list, or an
+        /// update that coalesces several versions.
+        string list;
+    };
+
     /// Internal Use Only - Does not grab locks
     ServerDetails* iget(ServerId id);
     ServerDetails* iget(uint32_t index);
@@ -336,6 +377,8 @@ class CoordinatorServerList : public AbstractServerList{
     void pruneUpdates(const Lock& lock);
 
     bool getWork(Tub<UpdateServerListRpc>* rpc);
+    const SerializedUpdate* getSerializedUpdate(const Lock& lock,
+            uint64_t baseVersion);
     void workSuccess(ServerId id, uint64_t currentVersion);
     void workFailed(ServerId id);
     void waitForWork();
@@ -376,6 +419,21 @@ class CoordinatorServerList : public AbstractServerList{
      */
     std::deque<ServerListUpdate> updates;
 
+    /**
+     * Updates that have been serialized for the current version of the
+     * server list, indexed by the version they start from (0 refers to the
+     * full list). Cleared whenever the version changes.
+     */
+    std::map<uint64_t, SerializedUpdate> serializedUpdates;
+
+    /**
+     * Maximum number of servers reached by each RPC that the updater
+     * sends: the recipient forwards the update to up to relayFanout - 1
+     * other servers that need exactly the same update. 1 means the
+     * coordinator updates every server itself.
+     */
+    uint32_t relayFanout;
+
     /**
      * Triggered when the server list is detected to be out of date or
      * when the stop is toggled (to start/stop the updater thread).
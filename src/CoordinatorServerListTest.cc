@@ -1445,6 +1445,35 @@ TEST_F(CoordinatorServerListTest, checkUpdates_ServerNotUpException) {
     EXPECT_EQ(0UL, sl->updates.size());
 }
 
+TEST_F(CoordinatorServerListTest, checkUpdates_relay) {
+    sl->setRelayFanout(3);
+    ServerId id1 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server2");
+    ServerId id3 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server3");
+    sl->checkUpdates();
+    ASSERT_EQ(1UL, sl->activeRpcs.size());
+
+    // Server 1 reached server 2 but not server 3.
+    finishRpc(sl->activeRpcs.front()->get(), "0 3 0 2 3 0 0 0");
+    TestLog::reset();
+    sl->checkUpdates();
+    EXPECT_EQ("workSuccess: ServerList Update Success: 1.0 update (0 => 3) | "
+            "workSuccess: ServerList Update Success: 2.0 update (0 => 3) | "
+            "workFailed: ServerList Update Failed : 3.0 update (0 => 0)",
+            TestLog::get());
+    EXPECT_EQ(3lu, sl->getEntry(id1)->verifiedVersion);
+    EXPECT_EQ(3lu, sl->getEntry(id2)->verifiedVersion);
+    EXPECT_EQ(CoordinatorServerList::UNINITIALIZED_VERSION,
+            sl->getEntry(id3)->verifiedVersion);
+
+    // Server 3 gets the list directly.
+    ASSERT_EQ(1UL, sl->activeRpcs.size());
+    EXPECT_EQ(id3, sl->activeRpcs.front()->get()->id);
+}
+
 TEST_F(CoordinatorServerListTest, getWork_emptyServerList) {
     EXPECT_FALSE(sl->getWork(&rpc));
 }
@@ -1519,15 +1548,13 @@ TEST_F(CoordinatorServerListTest, getWork_incrementalUpdates) {
             "protobuf: server { services: 1 server_id: 2 "
             "service_locator: \"mock:host=server2\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
-            "version_number: 5 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 3 "
+            "server { services: 1 server_id: 3 "
             "service_locator: \"mock:host=server3\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
-            "version_number: 6 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 2 "
+            "server { services: 1 server_id: 2 "
             "service_locator: \"mock:host=server2\" "
             "expected_read_mbytes_per_sec: 0 status: 2 replication_id: 0 } "
-            "version_number: 7 type: UPDATE",
+            "version_number: 7 type: UPDATE base_version: 4",
             parseUpdateRequest(&rpc->request));
     EXPECT_EQ(4lu, sl->lastScan.minVersion);
     CoordinatorServerList::Entry* e = sl->getEntry(id4);
@@ -1552,15 +1579,97 @@ TEST_F(CoordinatorServerListTest, getWork_skipEntriesAlreadySeen) {
             "protobuf: server { services: 1 server_id: 3 "
             "service_locator: \"mock:host=server3\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
-            "version_number: 3 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 4 "
+            "server { services: 1 server_id: 4 "
             "service_locator: \"mock:host=server4\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
-            "version_number: 4 type: UPDATE",
+            "version_number: 4 type: UPDATE base_version: 2",
             parseUpdateRequest(&rpc->request));
     EXPECT_EQ(4lu, e->updateVersion);
 }
 
+TEST_F(CoordinatorServerListTest, getWork_omitTransientServers) {
+    ServerId id1 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server1");
+    while (sl->getWork(&rpc)) {
+        sl->workSuccess(rpc->id, ~0lu);
+    }
+
+    // Server 2 comes and goes before server 1 hears about it.
+    ServerId id2 = sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server2");
+    sl->serverCrashed(id2);
+    sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server3");
+    sl->recoveryCompleted(id2);
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ("opcode: UPDATE_SERVER_LIST, "
+            "protobuf: server { services: 1 server_id: 3 "
+            "service_locator: \"mock:host=server3\" "
+            "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
+            "version_number: 5 type: UPDATE base_version: 1",
+            parseUpdateRequest(&rpc->request));
+    EXPECT_EQ(5lu, sl->getEntry(id1)->updateVersion);
+}
+
+TEST_F(CoordinatorServerListTest, getWork_shareSerializedUpdates) {
+    sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server1");
+    sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server2");
+    sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0, "mock:host=server3");
+
+    // All three servers get the same full list, serialized once.
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(1u, sl->serializedUpdates.size());
+    EXPECT_EQ(3lu, sl->serializedUpdates[0].version);
+
+    // A new update invalidates the cache.
+    sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server4");
+    EXPECT_EQ(0u, sl->serializedUpdates.size());
+}
+
+TEST_F(CoordinatorServerListTest, getWork_relay) {
+    sl->setRelayFanout(3);
+    ServerId id1 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server2");
+    sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server3");
+    ServerId id4 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server4");
+    ServerId id5 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server5");
+
+    // Server 1 relays to the next two servers that need the same update.
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(id1, rpc->id);
+    const WireFormat::RelayServerList::Request* reqHdr =
+            rpc->request.getStart<WireFormat::RelayServerList::Request>();
+    EXPECT_STREQ("RELAY_SERVER_LIST",
+            WireFormat::opcodeSymbol(reqHdr->common.opcode));
+    EXPECT_EQ(2u, reqHdr->relayCount);
+    EXPECT_EQ(id2.getId(), *rpc->request.getOffset<uint64_t>(
+            sizeof32(*reqHdr)));
+    EXPECT_EQ(id4.getId(), *rpc->request.getOffset<uint64_t>(
+            sizeof32(*reqHdr) + 8));
+    EXPECT_EQ(5lu, sl->getEntry(id2)->updateVersion);
+    EXPECT_EQ(5lu, sl->getEntry(id4)->updateVersion);
+    EXPECT_EQ(3lu, sl->numUpdatingServers);
+
+    // Server 5 has nobody left to relay to.
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(id5, rpc->id);
+    EXPECT_EQ("opcode: UPDATE_SERVER_LIST, protobuf: "
+            "server { services: 1 server_id: 3 "
+            "service_locator: \"mock:host=server3\" "
+            "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
+            "version_number: 5 type: FULL_LIST",
+            parseUpdateRequest(&rpc->request));
+    EXPECT_FALSE(sl->getWork(&rpc));
+}
+
 TEST_F(CoordinatorServerListTest, getWork_updateStatsAndPrune) {
     // Create two servers.
     ServerId id1 = sl->enlistServer(
@@ -1844,4 +1953,65 @@ TEST_F(CoordinatorServerListTest, Entry_sync) {
             entryPb.ShortDebugString());
 }
 
+// Don't delete this.  Occasionally useful for measuring how the cost of
+// propagating server list updates grows with cluster size.
+#if 0
+// Enlists servers one at a time (as during cluster startup), running the
+// updater after each enlistment, then lets the updater finish. Simulated
+// servers answer each RPC as soon as it has been sent. Prints the number
+// of RPCs the coordinator issued, the bytes it sent, and the time it spent
+// in the updater.
+static void
+benchUpdates(CoordinatorServerList* sl, int numServers, uint32_t fanout)
+{
+    sl->setRelayFanout(fanout);
+    uint64_t rpcs = 0;
+    uint64_t bytes = 0;
+    uint64_t cycles = 0;
+    for (int i = 0; i <= numServers; i++) {
+        if (i < numServers) {
+            sl->enlistServer({WireFormat::MASTER_SERVICE,
+                    WireFormat::ADMIN_SERVICE}, 0, 0,
+                    format("mock:host=server%d", i).c_str());
+        }
+        do {
+            uint64_t start = Cycles::rdtsc();
+            sl->checkUpdates();
+            cycles += Cycles::rdtsc() - start;
+            foreach (Tub<CoordinatorServerList::UpdateServerListRpc>* tub,
+                    sl->activeRpcs) {
+                CoordinatorServerList::UpdateServerListRpc* rpc = tub->get();
+                if (rpc->isReady())
+                    continue;
+                rpcs++;
+                bytes += rpc->request.size();
+                uint64_t version = sl->getEntry(rpc->id)->updateVersion;
+                auto* respHdr = rpc->response->emplaceAppend<
+                        WireFormat::RelayServerList::Response>();
+                respHdr->common.status = STATUS_OK;
+                respHdr->currentVersion = version;
+                respHdr->relayCount =
+                        downCast<uint32_t>(rpc->relayTargets.size());
+                for (size_t j = 0; j < rpc->relayTargets.size(); j++)
+                    rpc->response->emplaceAppend<uint64_t>(version);
+                rpc->completed();
+            }
+        } while (i == numServers && !sl->activeRpcs.empty());
+    }
+    printf("%d servers, fanout %u: %lu RPCs, %.1f MB, %.1f ms\n",
+            numServers, fanout, rpcs, static_cast<double>(bytes) / 1e06,
+            Cycles::toSeconds(cycles) * 1e03);
+}
+
+TEST_F(CoordinatorServerListTest, benchUpdates_noRelay) {
+    Logger::get().setLogLevels(SILENT_LOG_LEVEL);
+    benchUpdates(sl, 1000, 1);
+}
+
+TEST_F(CoordinatorServerListTest, benchUpdates_relay) {
+    Logger::get().setLogLevels(SILENT_LOG_LEVEL);
+    benchUpdates(sl, 1000, 32);
+}
+#endif
+
 } // namespace RAMCloud
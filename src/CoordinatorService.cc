@@ -52,6 +52,7 @@ CoordinatorService::CoordinatorService(Context* context,
     , serverList(context)
     , tableManager(context, &updateManager)
     , leaseAuthority(context)
+    , tabletBalancer(context, &tableManager)
     , runtimeOptions()
     , recoveryManager(context, tableManager, &runtimeOptions)
     , activeVerifications()
@@ -476,10 +477,18 @@ CoordinatorService::getTableConfig(
         WireFormat::GetTableConfig::Response* respHdr,
         Rpc* rpc)
 {
-    ProtoBuf::TableConfig tableConfig;
-    tableManager.serializeTableConfig(&tableConfig, reqHdr->tableId);
-    respHdr->tableConfigLength = serializeToResponse(rpc->replyPayload,
-                                                     &tableConfig);
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot =
+            tableManager.getTableConfig(reqHdr->tableId);
+    respHdr->version = snapshot->version;
+    if (snapshot->version != 0 && snapshot->version == reqHdr->knownVersion) {
+        // The client already has this configuration.
+        respHdr->tableConfigLength = 0;
+        return;
+    }
+    respHdr->tableConfigLength =
+            downCast<uint32_t>(snapshot->config.size());
+    rpc->replyPayload->appendCopy(snapshot->config.data(),
+            respHdr->tableConfigLength);
 }
 
 /**
@@ -38,6 +38,7 @@
 #include "RuntimeOptions.h"
 #include "Service.h"
 #include "TableManager.h"
+#include "TabletBalancer.h"
 #include "TransportManager.h"
 #include "ServerConfig.h"
 
@@ -191,6 +192,12 @@ class CoordinatorService : public Service {
      */
     ClientLeaseAuthority leaseAuthority;
 
+    /**
+     * Splits and migrates tablets to even out the load on masters (only
+     * if enabled).
+     */
+    TabletBalancer tabletBalancer;
+
   PRIVATE:
     /**
      * Contains coordinator configuration options which can be modified while
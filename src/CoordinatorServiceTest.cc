@@ -232,6 +232,33 @@ TEST_F(CoordinatorServiceTest, getTableConfig_indexInfo) {
     EXPECT_EQ("", tableConfigProtoBuf.ShortDebugString());
 }
 
+TEST_F(CoordinatorServiceTest, getTableConfig_knownVersion) {
+    ramcloud->createTable("foo");
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t version;
+    GetTableConfigRpc rpc(&context, 1);
+    EXPECT_TRUE(rpc.wait(&tableConfig, &version));
+    EXPECT_NE(0lu, version);
+    EXPECT_EQ(1, tableConfig.tablet_size());
+
+    // Unchanged: the configuration isn't sent again.
+    ProtoBuf::TableConfig tableConfig2;
+    uint64_t version2;
+    GetTableConfigRpc rpc2(&context, 1, version);
+    EXPECT_FALSE(rpc2.wait(&tableConfig2, &version2));
+    EXPECT_EQ(version, version2);
+    EXPECT_EQ(0, tableConfig2.tablet_size());
+    EXPECT_EQ(sizeof(WireFormat::GetTableConfig::Response),
+            rpc2.response->size());
+
+    // Changed.
+    ramcloud->splitTablet("foo", 1000);
+    GetTableConfigRpc rpc3(&context, 1, version);
+    EXPECT_TRUE(rpc3.wait(&tableConfig2, &version2));
+    EXPECT_NE(version, version2);
+    EXPECT_EQ(2, tableConfig2.tablet_size());
+}
+
 TEST_F(CoordinatorServiceTest, getTableConfig_invalid) {
     ramcloud->createTable("bar");
     ProtoBuf::TableConfig tableConfig;
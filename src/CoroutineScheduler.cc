@@ -0,0 +1,449 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "CoroutineScheduler.h"
+#include "Exception.h"
+#include "MultiRead.h"
+#include "MultiWrite.h"
+
+namespace RAMCloud {
+
+__thread CoroutineScheduler* CoroutineScheduler::starting = NULL;
+
+/**
+ * Construct a CoroutineScheduler with no coroutines.
+ *
+ * \param ramcloud
+ *      Client used to issue all of the operations. Once the scheduler has
+ *      been created, this client should be used only by the thread that
+ *      calls #poll.
+ * \param stackBytes
+ *      Size of each coroutine's stack, in bytes; rounded up to a multiple
+ *      of the page size.
+ */
+CoroutineScheduler::CoroutineScheduler(RamCloud* ramcloud,
+        uint32_t stackBytes)
+    : ramcloud(ramcloud)
+    , guardBytes(sysconf(_SC_PAGESIZE))
+    , stackBytes((stackBytes + guardBytes - 1) & ~(guardBytes - 1))
+    , coroutines()
+    , current(NULL)
+    , schedulerContext()
+    , freeStacks()
+    , cancelling(false)
+{
+}
+
+/**
+ * Destructor for CoroutineScheduler. Coroutines that are still running are
+ * unwound: the operation each one is waiting for throws an exception that
+ * can't be caught by name, so that the destructors of the objects on its
+ * stack (such as outstanding RPCs) are invoked. Coroutines that haven't
+ * started yet never run.
+ */
+CoroutineScheduler::~CoroutineScheduler()
+{
+    cancelling = true;
+
+    // Coroutines may spawn others while unwinding, so don't use an
+    // iterator here.
+    for (size_t i = 0; i < coroutines.size(); i++) {
+        Coroutine* coroutine = coroutines[i];
+        if (!coroutine->finished)
+            resume(coroutine);
+        freeStack(coroutine->stack);
+        delete coroutine;
+    }
+    foreach (char* stack, freeStacks) {
+        freeStack(stack);
+    }
+}
+
+/**
+ * Commit a transaction; see Transaction::commit for details.
+ *
+ * \param transaction
+ *      Transaction to commit.
+ * \return
+ *      True if the transaction was able to commit.  False otherwise.
+ */
+bool
+CoroutineScheduler::commit(Transaction* transaction)
+{
+    Transaction::CommitOp op(transaction);
+    await(&op);
+    return op.wait();
+}
+
+/**
+ * Read a group of objects; see RamCloud::multiRead for details.
+ *
+ * \param requests
+ *      Each element describes one object to read; the status of each
+ *      read is returned in its element.
+ * \param numRequests
+ *      Number of elements in \a requests.
+ */
+void
+CoroutineScheduler::multiRead(MultiReadObject* const requests[],
+        uint32_t numRequests)
+{
+    MultiRead request(ramcloud, requests, numRequests);
+    await(&request);
+    request.wait();
+}
+
+/**
+ * Write a group of objects; see RamCloud::multiWrite for details.
+ *
+ * \param requests
+ *      Each element describes one object to write; the status of each
+ *      write is returned in its element.
+ * \param numRequests
+ *      Number of elements in \a requests.
+ */
+void
+CoroutineScheduler::multiWrite(MultiWriteObject* const requests[],
+        uint32_t numRequests)
+{
+    MultiWrite request(ramcloud, requests, numRequests);
+    await(&request);
+    request.wait();
+}
+
+/**
+ * Poll the client's Dispatch once, then resume each coroutine whose
+ * operation has completed (and each new coroutine), letting it run until it
+ * waits again or returns. This method doesn't block (unless a coroutine
+ * does), so it can be invoked from an application's event loop.
+ *
+ * \return
+ *      The number of coroutines that returned.
+ *
+ * \throw
+ *      If a coroutine threw an exception that it didn't catch, the
+ *      exception is rethrown here after the coroutine has been cleaned up.
+ *      If several did, only the first one is rethrown.
+ */
+int
+CoroutineScheduler::poll()
+{
+    ramcloud->poll();
+
+    int finished = 0;
+    std::exception_ptr exception;
+    size_t count = coroutines.size();
+    size_t remaining = 0;
+    for (size_t i = 0; i < count; i++) {
+        Coroutine* coroutine = coroutines[i];
+        if ((coroutine->isReady == NULL) ||
+                coroutine->isReady(coroutine->awaited)) {
+            resume(coroutine);
+        }
+        if (coroutine->finished) {
+            if (coroutine->exception && !exception)
+                exception = coroutine->exception;
+            freeStacks.push_back(coroutine->stack);
+            delete coroutine;
+            finished++;
+        } else {
+            coroutines[remaining] = coroutine;
+            remaining++;
+        }
+    }
+
+    // Keep the coroutines that were spawned by the ones we resumed; they
+    // will start in the next call.
+    for (size_t i = count; i < coroutines.size(); i++) {
+        coroutines[remaining] = coroutines[i];
+        remaining++;
+    }
+    coroutines.resize(remaining);
+
+    if (exception)
+        std::rethrow_exception(exception);
+    return finished;
+}
+
+/**
+ * Read an object; see RamCloud::read for details.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      The contents of the object are returned here.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] objectExists
+ *      If non-NULL, the read doesn't fail if the object doesn't exist;
+ *      instead, whether it exists is returned here.
+ */
+void
+CoroutineScheduler::read(uint64_t tableId, const void* key,
+        uint16_t keyLength, Buffer* value, const RejectRules* rejectRules,
+        uint64_t* version, bool* objectExists)
+{
+    ReadRpc rpc(ramcloud, tableId, key, keyLength, value, rejectRules);
+    await(&rpc);
+    rpc.wait(version, objectExists);
+}
+
+/**
+ * Delete an object; see RamCloud::remove for details.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the removal should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object (just before
+ *      deletion) is returned here.
+ */
+void
+CoroutineScheduler::remove(uint64_t tableId, const void* key,
+        uint16_t keyLength, const RejectRules* rejectRules, uint64_t* version)
+{
+    RemoveRpc rpc(ramcloud, tableId, key, keyLength, rejectRules);
+    await(&rpc);
+    rpc.wait(version);
+}
+
+/**
+ * Invoke #poll repeatedly until all of the coroutines have returned.
+ */
+void
+CoroutineScheduler::run()
+{
+    while (!coroutines.empty())
+        poll();
+}
+
+/**
+ * Create a new coroutine. It starts running during the next call to #poll.
+ *
+ * \param body
+ *      The function that the coroutine executes. It may spawn other
+ *      coroutines.
+ */
+void
+CoroutineScheduler::spawn(Body body)
+{
+    Coroutine* coroutine = new Coroutine(body, allocateStack());
+    if (getcontext(&coroutine->context) != 0) {
+        freeStacks.push_back(coroutine->stack);
+        delete coroutine;
+        throw FatalError(HERE, "getcontext failed in CoroutineScheduler",
+                errno);
+    }
+    coroutine->context.uc_stack.ss_sp = coroutine->stack;
+    coroutine->context.uc_stack.ss_size = stackBytes;
+    coroutine->context.uc_link = &schedulerContext;
+    makecontext(&coroutine->context, trampoline, 0);
+    coroutines.push_back(coroutine);
+}
+
+/**
+ * Read an object as part of a transaction; see Transaction::read for
+ * details.
+ *
+ * \param transaction
+ *      Transaction the read is part of.
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      The contents of the object are returned here.
+ * \param[out] objectExists
+ *      If non-NULL, the read doesn't fail if the object doesn't exist;
+ *      instead, whether it exists is returned here.
+ */
+void
+CoroutineScheduler::transactionRead(Transaction* transaction,
+        uint64_t tableId, const void* key, uint16_t keyLength, Buffer* value,
+        bool* objectExists)
+{
+    Transaction::ReadOp op(transaction, tableId, key, keyLength, value);
+    await(&op);
+    op.wait(objectExists);
+}
+
+/**
+ * Write an object; see RamCloud::write for details.
+ *
+ * \param tableId
+ *      The table to which the object is written.
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first byte of the new contents for the object.
+ * \param length
+ *      Size in bytes of the new contents for the object.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the write should be
+ *      aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the new object is returned here.
+ */
+void
+CoroutineScheduler::write(uint64_t tableId, const void* key,
+        uint16_t keyLength, const void* buf, uint32_t length,
+        const RejectRules* rejectRules, uint64_t* version)
+{
+    WriteRpc rpc(ramcloud, tableId, key, keyLength, buf, length,
+            rejectRules);
+    await(&rpc);
+    rpc.wait(version);
+}
+
+/**
+ * Suspend the calling coroutine until the next call to #poll, so that other
+ * coroutines can run. If invoked from outside any coroutine, this method
+ * just polls the client's Dispatch.
+ */
+void
+CoroutineScheduler::yield()
+{
+    if (current == NULL) {
+        ramcloud->poll();
+        return;
+    }
+    current->isReady = NULL;
+    suspend();
+}
+
+/**
+ * Return memory for a new coroutine's stack, reusing the stack of a
+ * coroutine that has returned if possible. New stacks are mapped separately
+ * with an inaccessible guard page below them, so that a coroutine that
+ * overflows its stack crashes instead of silently corrupting memory.
+ *
+ * \return
+ *      The lowest address of the stack (just above the guard page); the
+ *      stack is #stackBytes long.
+ *
+ * \throw FatalError
+ *      The stack couldn't be mapped.
+ */
+char*
+CoroutineScheduler::allocateStack()
+{
+    if (!freeStacks.empty()) {
+        char* stack = freeStacks.back();
+        freeStacks.pop_back();
+        return stack;
+    }
+
+    void* region = mmap(NULL, guardBytes + stackBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (region == MAP_FAILED) {
+        throw FatalError(HERE, "couldn't map a coroutine stack", errno);
+    }
+    if (mprotect(region, guardBytes, PROT_NONE) != 0) {
+        int error = errno;
+        munmap(region, guardBytes + stackBytes);
+        throw FatalError(HERE, "couldn't protect a coroutine stack's guard "
+                "page", error);
+    }
+    return static_cast<char*>(region) + guardBytes;
+}
+
+/**
+ * Release a stack returned by #allocateStack, along with its guard page.
+ *
+ * \param stack
+ *      The stack's lowest address, as returned by #allocateStack.
+ */
+void
+CoroutineScheduler::freeStack(char* stack)
+{
+    munmap(stack - guardBytes, guardBytes + stackBytes);
+}
+
+/**
+ * Switch to a coroutine, and return once it waits or returns.
+ *
+ * \param coroutine
+ *      The coroutine to run.
+ */
+void
+CoroutineScheduler::resume(Coroutine* coroutine)
+{
+    coroutine->awaited = NULL;
+    coroutine->isReady = NULL;
+    current = coroutine;
+    starting = this;
+    swapcontext(&schedulerContext, &coroutine->context);
+    current = NULL;
+}
+
+/**
+ * Switch from the current coroutine back to the scheduler; returns when
+ * #poll resumes the coroutine.
+ *
+ * \throw Cancelled
+ *      The scheduler is being destroyed.
+ */
+void
+CoroutineScheduler::suspend()
+{
+    if (!cancelling)
+        swapcontext(&current->context, &schedulerContext);
+    if (cancelling)
+        throw Cancelled();
+}
+
+/**
+ * The first function executed by each coroutine: it invokes the coroutine's
+ * body and records its outcome. When this function returns, the coroutine's
+ * context (see #spawn) switches back to the scheduler.
+ */
+void
+CoroutineScheduler::trampoline()
+{
+    CoroutineScheduler* scheduler = starting;
+    Coroutine* coroutine = scheduler->current;
+    if (!scheduler->cancelling) {
+        try {
+            coroutine->body();
+        } catch (const Cancelled&) {
+            // The scheduler is being destroyed.
+        } catch (...) {
+            coroutine->exception = std::current_exception();
+        }
+    }
+    coroutine->finished = true;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,230 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_COROUTINESCHEDULER_H
+#define RAMCLOUD_COROUTINESCHEDULER_H
+
+#include <ucontext.h>
+#include <exception>
+#include <functional>
+#include <vector>
+
+#include "Common.h"
+#include "RamCloud.h"
+#include "Transaction.h"
+
+namespace RAMCloud {
+
+/**
+ * A CoroutineScheduler runs any number of coroutines on the calling thread,
+ * so that pipelines of dependent RamCloud operations can be written as
+ * straight-line code instead of hand-written state machines (such as
+ * ClientTransactionTask::performTask). Each coroutine is an ordinary
+ * function with its own stack; when it invokes one of the operations below
+ * (read, write, commit, etc.) the operation's RPC is started and the
+ * coroutine is suspended until the RPC completes, while other coroutines
+ * continue to run. Results and errors are returned exactly as by the
+ * corresponding blocking RamCloud methods, including ClientExceptions.
+ *
+ * Coroutines make progress only while #poll (or #run) is being invoked;
+ * #poll polls the client's Dispatch once and then resumes every coroutine
+ * whose operation has completed, so it can be called from an application's
+ * event loop just like AsyncClient::poll.
+ *
+ * Restrictions:
+ *   - The scheduler and its RamCloud object must be used only by the thread
+ *     that calls #poll.
+ *   - A coroutine must not suspend (i.e. invoke one of the operations
+ *     below) inside a catch clause: the C++ runtime tracks the exceptions
+ *     being handled per thread, not per stack.
+ *   - Each coroutine's stack is a fixed size (see the constructor), so
+ *     coroutines shouldn't allocate large objects on their stacks.
+ */
+class CoroutineScheduler {
+  PUBLIC:
+    /// The function that a coroutine executes.
+    typedef std::function<void()> Body;
+
+    /// Default size of each coroutine's stack, in bytes.
+    static const uint32_t DEFAULT_STACK_BYTES = 256*1024;
+
+    explicit CoroutineScheduler(RamCloud* ramcloud,
+            uint32_t stackBytes = DEFAULT_STACK_BYTES);
+    ~CoroutineScheduler();
+
+    /**
+     * Return the number of coroutines that have been spawned but haven't
+     * returned yet.
+     */
+    size_t
+    active()
+    {
+        return coroutines.size();
+    }
+
+    int poll();
+    void run();
+    void spawn(Body body);
+    void yield();
+
+    // The following methods behave like the blocking RamCloud methods with
+    // the same names, except that when invoked in a coroutine they suspend
+    // only the calling coroutine. If invoked from outside any coroutine,
+    // they simply block.
+    bool commit(Transaction* transaction);
+    void multiRead(MultiReadObject* const requests[], uint32_t numRequests);
+    void multiWrite(MultiWriteObject* const requests[], uint32_t numRequests);
+    void read(uint64_t tableId, const void* key, uint16_t keyLength,
+            Buffer* value, const RejectRules* rejectRules = NULL,
+            uint64_t* version = NULL, bool* objectExists = NULL);
+    void remove(uint64_t tableId, const void* key, uint16_t keyLength,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
+    void transactionRead(Transaction* transaction, uint64_t tableId,
+            const void* key, uint16_t keyLength, Buffer* value,
+            bool* objectExists = NULL);
+    void write(uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* buf, uint32_t length,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
+
+    /**
+     * Suspend the calling coroutine until an asynchronous operation has
+     * completed, so that calling its wait method won't block. If invoked
+     * from outside any coroutine, this method polls until the operation
+     * completes.
+     *
+     * \param op
+     *      An operation that has already been started, such as a ReadRpc,
+     *      MultiRead, or Transaction::ReadOp: any class with an isReady
+     *      method will do.
+     */
+    template<typename T>
+    void
+    await(T* op)
+    {
+        if (current == NULL) {
+            while (!op->isReady())
+                ramcloud->poll();
+            return;
+        }
+        current->awaited = op;
+        current->isReady = &checkReady<T>;
+        suspend();
+    }
+
+  PRIVATE:
+    /**
+     * Thrown by #suspend in coroutines that are still running when the
+     * scheduler is destroyed, in order to unwind their stacks. Deliberately
+     * not a std::exception, so that it is seldom caught by accident.
+     */
+    struct Cancelled {};
+
+    /**
+     * The state of one coroutine.
+     */
+    struct Coroutine {
+        Coroutine(Body body, char* stack)
+            : body(body)
+            , context()
+            , stack(stack)
+            , awaited(NULL)
+            , isReady(NULL)
+            , finished(false)
+            , exception()
+        {}
+
+        /// The function the coroutine executes.
+        Body body;
+
+        /// Saved registers (including the stack pointer) while the
+        /// coroutine is suspended.
+        ucontext_t context;
+
+        /// Memory for the coroutine's stack; owned by the scheduler.
+        char* stack;
+
+        /// The operation the coroutine is waiting for, if any.
+        void* awaited;
+
+        /// Invoked with #awaited to find out whether the coroutine can be
+        /// resumed; NULL means the coroutine is runnable.
+        bool (*isReady)(void* op);
+
+        /// True once #body has returned.
+        bool finished;
+
+        /// If #body threw an exception, it is saved here so that #poll can
+        /// rethrow it in the scheduler's thread of control.
+        std::exception_ptr exception;
+
+        DISALLOW_COPY_AND_ASSIGN(Coroutine);
+    };
+
+    /**
+     * Invoked through Coroutine::isReady to test whether an operation of
+     * type T has completed.
+     */
+    template<typename T>
+    static bool
+    checkReady(void* op)
+    {
+        return static_cast<T*>(op)->isReady();
+    }
+
+    char* allocateStack();
+    void freeStack(char* stack);
+    void resume(Coroutine* coroutine);
+    void suspend();
+    static void trampoline();
+
+    /// Client used to issue all of the operations.
+    RamCloud* ramcloud;
+
+    /// Size of the inaccessible guard page below each stack, in bytes.
+    size_t guardBytes;
+
+    /// Size of each coroutine's stack, in bytes (a multiple of the page
+    /// size, not including the guard page).
+    size_t stackBytes;
+
+    /// Coroutines that haven't returned yet, in the order they were spawned.
+    std::vector<Coroutine*> coroutines;
+
+    /// The coroutine that is currently running, or NULL if the scheduler
+    /// itself is running.
+    Coroutine* current;
+
+    /// Saved registers of the scheduler while a coroutine is running.
+    ucontext_t schedulerContext;
+
+    /// Stacks of coroutines that have returned, which are recycled for new
+    /// coroutines to avoid allocating (and faulting in) a new stack for
+    /// each one.
+    std::vector<char*> freeStacks;
+
+    /// True means the scheduler is being destroyed, so coroutines that
+    /// try to suspend are unwound instead.
+    bool cancelling;
+
+    /// The scheduler that is starting a new coroutine on this thread; used
+    /// by #trampoline, which can't take pointer arguments.
+    static __thread CoroutineScheduler* starting;
+
+    DISALLOW_COPY_AND_ASSIGN(CoroutineScheduler);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_COROUTINESCHEDULER_H
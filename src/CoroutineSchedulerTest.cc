@@ -0,0 +1,270 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "CoroutineScheduler.h"
+#include "MockCluster.h"
+
+namespace RAMCloud {
+
+class CoroutineSchedulerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Tub<CoroutineScheduler> scheduler;
+    uint64_t tableId;
+
+    /// Coroutines append notes about their progress here.
+    string log;
+
+  public:
+    CoroutineSchedulerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , scheduler()
+        , tableId(-1)
+        , log()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+        ramcloud->write(tableId, "0", 1, "abcdef", 6);
+        scheduler.construct(ramcloud.get(), 64*1024);
+    }
+
+    /// Append a message to #log.
+    void
+    note(const string& message)
+    {
+        if (!log.empty())
+            log += ", ";
+        log += message;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(CoroutineSchedulerTest);
+};
+
+/**
+ * Used with CoroutineScheduler::await: becomes ready after isReady has
+ * been called a given number of times.
+ */
+struct CountdownOp {
+    explicit CountdownOp(int count)
+        : count(count)
+    {}
+
+    bool
+    isReady()
+    {
+        count--;
+        return count <= 0;
+    }
+
+    int count;
+};
+
+/**
+ * Records in a log when it is destroyed; used to check that coroutine stacks
+ * are unwound.
+ */
+class Unwound {
+  public:
+    explicit Unwound(string* log)
+        : log(log)
+    {}
+
+    ~Unwound()
+    {
+        *log += ", first unwound";
+    }
+
+    string* log;
+
+    DISALLOW_COPY_AND_ASSIGN(Unwound);
+};
+
+TEST_F(CoroutineSchedulerTest, destructor_unwindCoroutines) {
+    CountdownOp op(1000000);
+    scheduler->spawn([this, &op] {
+        note("first started");
+        Unwound unwound(&log);
+        scheduler->await(&op);
+        note("first resumed");
+    });
+    scheduler->poll();
+    scheduler->spawn([this] {
+        note("second started");
+    });
+    scheduler.destroy();
+    EXPECT_EQ("first started, first unwound", log);
+}
+
+TEST_F(CoroutineSchedulerTest, commit) {
+    scheduler->spawn([this] {
+        Transaction transaction(ramcloud.get());
+        Buffer value;
+        scheduler->transactionRead(&transaction, tableId, "0", 1, &value);
+        transaction.write(tableId, "1", 1, "copy", 4);
+        note(format("committed %d", scheduler->commit(&transaction)));
+    });
+    scheduler->run();
+    EXPECT_EQ("committed 1", log);
+    Buffer value;
+    ramcloud->read(tableId, "1", 1, &value);
+    EXPECT_EQ("copy", TestUtil::toString(&value));
+}
+
+TEST_F(CoroutineSchedulerTest, multiReadAndMultiWrite) {
+    scheduler->spawn([this] {
+        MultiWriteObject write1(tableId, "1", 1, "first", 5);
+        MultiWriteObject write2(tableId, "2", 1, "second", 6);
+        MultiWriteObject* writes[] = {&write1, &write2};
+        scheduler->multiWrite(writes, 2);
+
+        Tub<ObjectBuffer> value1, value2;
+        MultiReadObject read1(tableId, "1", 1, &value1);
+        MultiReadObject read2(tableId, "2", 1, &value2);
+        MultiReadObject* reads[] = {&read1, &read2};
+        scheduler->multiRead(reads, 2);
+        uint32_t length;
+        const char* data = static_cast<const char*>(
+                value2->getValue(&length));
+        note(string(data, length));
+    });
+    scheduler->run();
+    EXPECT_EQ("second", log);
+}
+
+TEST_F(CoroutineSchedulerTest, poll_interleaveCoroutines) {
+    CountdownOp op1(2), op2(1);
+    scheduler->spawn([this, &op1] {
+        note("a1");
+        scheduler->await(&op1);
+        note("a2");
+    });
+    scheduler->spawn([this, &op2] {
+        note("b1");
+        scheduler->await(&op2);
+        note("b2");
+    });
+    EXPECT_EQ(0, scheduler->poll());
+    EXPECT_EQ("a1, b1", log);
+    EXPECT_EQ(1, scheduler->poll());
+    EXPECT_EQ("a1, b1, b2", log);
+    EXPECT_EQ(1u, scheduler->active());
+    EXPECT_EQ(1, scheduler->poll());
+    EXPECT_EQ("a1, b1, b2, a2", log);
+    EXPECT_EQ(0u, scheduler->active());
+}
+
+TEST_F(CoroutineSchedulerTest, poll_spawnFromCoroutine) {
+    scheduler->spawn([this] {
+        note("parent");
+        scheduler->spawn([this] {
+            note("child");
+        });
+    });
+    EXPECT_EQ(1, scheduler->poll());
+    EXPECT_EQ("parent", log);
+    EXPECT_EQ(1u, scheduler->active());
+    EXPECT_EQ(1, scheduler->poll());
+    EXPECT_EQ("parent, child", log);
+}
+
+TEST_F(CoroutineSchedulerTest, poll_rethrowException) {
+    scheduler->spawn([this] {
+        Buffer value;
+        scheduler->read(tableId, "bogus", 5, &value);
+    });
+    scheduler->spawn([this] {
+        note("other coroutine ran");
+    });
+    EXPECT_THROW(scheduler->run(), ObjectDoesntExistException);
+    EXPECT_EQ("other coroutine ran", log);
+    EXPECT_EQ(0u, scheduler->active());
+}
+
+TEST_F(CoroutineSchedulerTest, allocateStack) {
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    scheduler.construct(ramcloud.get(), pageSize + 1);
+    EXPECT_EQ(2 * pageSize, scheduler->stackBytes);
+    EXPECT_EQ(pageSize, scheduler->guardBytes);
+
+    // The stack is page-aligned and writable from end to end.
+    char* stack = scheduler->allocateStack();
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(stack) % pageSize);
+    memset(stack, 'x', scheduler->stackBytes);
+    scheduler->freeStack(stack);
+}
+
+TEST_F(CoroutineSchedulerTest, poll_reuseStacks) {
+    scheduler->spawn([] {});
+    scheduler->run();
+    EXPECT_EQ(1u, scheduler->freeStacks.size());
+    char* stack = scheduler->freeStacks[0];
+    scheduler->spawn([] {});
+    EXPECT_EQ(0u, scheduler->freeStacks.size());
+    EXPECT_EQ(stack, scheduler->coroutines[0]->stack);
+    scheduler->run();
+}
+
+TEST_F(CoroutineSchedulerTest, readWriteRemove) {
+    scheduler->spawn([this] {
+        uint64_t version;
+        scheduler->write(tableId, "1", 1, "xyz", 3, NULL, &version);
+        note(format("wrote version %lu", version));
+        Buffer value;
+        scheduler->read(tableId, "1", 1, &value, NULL, &version);
+        note(format("read %s version %lu",
+                TestUtil::toString(&value).c_str(), version));
+        scheduler->remove(tableId, "1", 1);
+        bool exists = true;
+        scheduler->read(tableId, "1", 1, &value, NULL, NULL, &exists);
+        note(format("exists %d", exists));
+    });
+    scheduler->run();
+    EXPECT_EQ("wrote version 2, read xyz version 2, exists 0", log);
+}
+
+TEST_F(CoroutineSchedulerTest, read_outsideCoroutine) {
+    Buffer value;
+    scheduler->read(tableId, "0", 1, &value);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+}
+
+TEST_F(CoroutineSchedulerTest, yield) {
+    scheduler->spawn([this] {
+        note("before");
+        scheduler->yield();
+        note("after");
+    });
+    scheduler->poll();
+    EXPECT_EQ("before", log);
+    scheduler->poll();
+    EXPECT_EQ("before, after", log);
+}
+
+} // namespace RAMCloud
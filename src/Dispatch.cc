@@ -70,6 +70,8 @@ Dispatch::Dispatch(bool hasDedicatedThread)
     , epollThread()
     , readyFd(-1)
     , readyEvents(0)
+    , eventFd(-1)
+    , eventFdSignaled(0)
     , fileInvocationSerial(0)
     , timerMutex("Dispatch::timerMutex")
     , timers()
@@ -108,6 +110,10 @@ Dispatch::~Dispatch()
         sys->close(epollFd);
         epollFd = -1;
     }
+    if (eventFd >= 0) {
+        sys->close(eventFd);
+        eventFd = -1;
+    }
     for (uint32_t i = 0; i < pollers.size(); i++) {
         pollers[i]->owner = NULL;
         pollers[i]->slot = -1;
@@ -177,6 +183,13 @@ Dispatch::poll()
         }
         currentTime = newCurrent;
     }
+    if (eventFdSignaled.load() != 0) {
+        // Clear the flag before draining, so that a wakeup that races with
+        // us leaves the eventfd readable rather than being lost.
+        eventFdSignaled.store(0);
+        uint64_t count;
+        sys->read(eventFd, &count, sizeof(count));
+    }
     for (uint32_t i = 0; i < pollers.size(); i++) {
 #if DEBUG_SLOW_POLLERS
         uint64_t ticks = 0;
@@ -285,6 +298,47 @@ Dispatch::poll()
     return result;
 }
 
+/**
+ * Return a file descriptor that an external event loop (e.g. one built on
+ * epoll) can watch to find out when this dispatcher needs to be polled:
+ * it becomes readable whenever one of the dispatcher's Files has an event
+ * or #wakeup is called, and stays readable until the next call to #poll.
+ * The descriptor is created on first use and owned by the dispatcher.
+ *
+ * Note: Pollers (e.g. those of kernel-bypass transports) and Timers don't
+ * signal the descriptor, so loops that depend on them must also poll
+ * periodically (see AsyncClient::getPollTimeoutMs).
+ *
+ * \throw FatalError
+ *      The eventfd couldn't be created.
+ */
+int
+Dispatch::getEventFd()
+{
+    if (eventFd < 0) {
+        eventFd = sys->eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (eventFd < 0) {
+            throw FatalError(HERE, "Dispatch couldn't create an eventfd",
+                    errno);
+        }
+    }
+    return eventFd;
+}
+
+/**
+ * Make the descriptor returned by #getEventFd readable, so that an external
+ * event loop will call #poll soon. This method may be invoked in any thread
+ * and does nothing if #getEventFd has never been called.
+ */
+void
+Dispatch::wakeup()
+{
+    if ((eventFd >= 0) && (eventFdSignaled.exchange(1) == 0)) {
+        uint64_t one = 1;
+        sys->write(eventFd, &one, sizeof(one));
+    }
+}
+
 /**
  * Invokes Dispatch::poll repeatedly, and maintains statistics about
  * how much time is spent doing useful work. This method never returns;
@@ -637,6 +691,7 @@ try {
             // modification of readyFd.
             Fence::sfence();
             owner->readyFd = events[i].data.fd;
+            owner->wakeup();
         }
     }
 } catch (const std::exception& e) {
@@ -64,8 +64,22 @@ class Dispatch {
         return (!hasDedicatedThread || ownerId == ThreadId::get());
     }
 
+    int getEventFd();
+
+    /**
+     * Returns true if any Pollers are currently defined, in which case
+     * #poll must be called continuously for them to make progress (the
+     * descriptor from #getEventFd doesn't reflect their work).
+     */
+    bool
+    hasPollers()
+    {
+        return !pollers.empty();
+    }
+
     int poll();
     void run() __attribute__ ((noreturn));
+    void wakeup();
 
     /// The return value from rdtsc at the beginning of the last call to
     /// #poll.  May be read from multiple threads, so must be volatile.
@@ -291,6 +305,16 @@ class Dispatch {
     // FileEvent values).
     volatile int readyEvents;
 
+    // Descriptor returned by #getEventFd, or -1 if it hasn't been created.
+    // The eventfd is made readable by #wakeup and whenever the epoll thread
+    // reports a ready file, so that event loops outside RAMCloud can tell
+    // when #poll has work to do.
+    int eventFd;
+
+    // Nonzero means #eventFd has been signaled since #poll last drained it;
+    // avoids a kernel call in #poll when there is nothing to drain.
+    Atomic<int> eventFdSignaled;
+
     // Used to assign a (nearly) unique identifier to each invocation
     // of a File.
     int fileInvocationSerial;
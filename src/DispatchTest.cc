@@ -382,6 +382,28 @@ TEST_F(DispatchTest, poll_fileHandling) {
     EXPECT_EQ("", *localLog);
 }
 
+TEST_F(DispatchTest, poll_drainEventFd) {
+    int fd = dispatch.getEventFd();
+    dispatch.wakeup();
+    EXPECT_TRUE(Dispatch::fdIsReady(fd));
+    dispatch.poll();
+    EXPECT_FALSE(Dispatch::fdIsReady(fd));
+    EXPECT_EQ(0, dispatch.eventFdSignaled.load());
+}
+
+TEST_F(DispatchTest, poll_fileSignalsEventFd) {
+    int fd = dispatch.getEventFd();
+    DummyFile f("f1", false, pipeFds[0], Dispatch::FileEvent::READABLE,
+            &dispatch);
+    EXPECT_FALSE(Dispatch::fdIsReady(fd));
+    write(pipeFds[1], "x", 1);
+    waitForReadyFd(1.0);
+    EXPECT_TRUE(Dispatch::fdIsReady(fd));
+    dispatch.poll();
+    EXPECT_EQ("file f1 invoked, read 'x'", *localLog);
+    EXPECT_FALSE(Dispatch::fdIsReady(fd));
+}
+
 TEST_F(DispatchTest, poll_fileDeletedDuringInvocation) {
     int fds[2];
     pipe(fds);
@@ -479,6 +501,33 @@ TEST_F(DispatchTest, poll_handlerDeletesTimers) {
 // No tests for Dispatch::run: it doesn't return, so can't test (it's
 // pretty simple anyway).
 
+TEST_F(DispatchTest, getEventFd) {
+    int fd = dispatch.getEventFd();
+    EXPECT_LE(0, fd);
+    EXPECT_EQ(fd, dispatch.getEventFd());
+    EXPECT_FALSE(Dispatch::fdIsReady(fd));
+}
+
+TEST_F(DispatchTest, getEventFd_errorInEventfd) {
+    sys->eventfdErrno = EMFILE;
+    EXPECT_THROW(dispatch.getEventFd(), FatalError);
+    EXPECT_EQ(-1, dispatch.eventFd);
+}
+
+TEST_F(DispatchTest, wakeup) {
+    // No eventfd yet: nothing happens.
+    dispatch.wakeup();
+    EXPECT_EQ(0, dispatch.eventFdSignaled.load());
+
+    int fd = dispatch.getEventFd();
+    dispatch.wakeup();
+    dispatch.wakeup();
+    EXPECT_TRUE(Dispatch::fdIsReady(fd));
+    uint64_t count = 0;
+    EXPECT_EQ(8, read(fd, &count, sizeof(count)));
+    EXPECT_EQ(1lu, count);
+}
+
 // Helper function that runs in a separate thread for the following test.
 static void checkDispatchThread(Dispatch* dispatch, bool* result) {
     *result = dispatch->isDispatchThread();
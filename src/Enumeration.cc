@@ -15,6 +15,7 @@
 
 #include "Enumeration.h"
 #include "Object.h"
+#include "ObjectManager.h"
 
 namespace RAMCloud {
 
@@ -36,6 +37,10 @@ struct EnumerateBucketArgs {
     /// Iterator containing information about previous tablet configurations.
     EnumerationIterator* iter;
 
+    /// Objects that don't match the key and version predicates of this
+    /// filter are skipped.
+    const EnumerationFilter* filter;
+
     /// A vector in which to place the resulting objects.
     std::vector<Log::Reference>* objectReferences;
 };
@@ -43,6 +48,7 @@ struct EnumerateBucketArgs {
 /**
  * Helper function to process an individual entry in a bucket. Filters
  * the entry by the desired table ID and tablet start and end hashes,
+ * by the key and version predicates of the client's EnumerationFilter,
  * and by any previous state stored on the iterator stack (besides the
  * top most entry). If the object passes all filters, then its reference
  * is pushed onto a vector so the caller can place the resulting
@@ -64,7 +70,7 @@ enumerateBucket(uint64_t reference, void* cookie)
     Buffer buffer;
     type = args.log->getEntry(Log::Reference(reference), buffer);
 
-    if (type != LOG_ENTRY_TYPE_OBJ)
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJMANIFEST)
         return;
 
     // Filter objects by table and tablet hash range.
@@ -76,6 +82,13 @@ enumerateBucket(uint64_t reference, void* cookie)
         return;
     }
 
+    // Apply the client's predicates before anything is copied. Manifests
+    // carry the version of the chunked object, so this works for them too.
+    if (!args.filter->matchesKey(key) ||
+            !args.filter->matchesVersion(Object(buffer).getVersion())) {
+        return;
+    }
+
     // Filter out objects from stale iterator entries. Skip the
     // topmost entry, which refers to the current master's state.
     for (int64_t frameIndex = static_cast<int64_t>(args.iter->size()) - 2;
@@ -109,10 +122,16 @@ enumerateBucket(uint64_t reference, void* cookie)
 
 /**
  * Appends objects to a buffer. Each object is a uint32_t size and a complete,
- * serialized Object.
+ * serialized Object. Chunked objects are returned as ordinary objects whose
+ * value is the concatenation of their chunks. Objects that don't match the
+ * value predicate of the filter are skipped, and if the filter selects a
+ * slice of each value, only that slice is returned.
  *
  * \param log
  *      The log containing the objects.
+ * \param objectMap
+ *      The hash table referencing the objects; used to find the chunks of
+ *      chunked objects.
  * \param buffer
  *      The buffer to append to.
  * \param references 
@@ -123,23 +142,64 @@ enumerateBucket(uint64_t reference, void* cookie)
  *      False means that full objects are returned, containing both keys
  *      and data. True means that the returned objects have
  *      been truncated so that the object data (normally the last
- *      field of the object) is omitted.       
+ *      field of the object) is omitted.
+ * \param filter
+ *      The client's filter; only its value predicate and projection are
+ *      applied here (enumerateBucket has already applied the rest).
+ * \return
+ *      -1 if all of the objects were appended (or skipped), otherwise the
+ *      index in \a references of the first object that didn't fit.
  */
 static int64_t
 appendObjectsToBuffer(Log& log,
+                      HashTable& objectMap,
                       Buffer* buffer,
                       std::vector<Log::Reference>& references,
-                      uint32_t maxBytes, bool keysOnly)
+                      uint32_t maxBytes, bool keysOnly,
+                      const EnumerationFilter& filter)
 {
+    bool needValue = !keysOnly || filter.examinesValue();
     for (uint32_t index = 0; index < references.size(); index++) {
         Buffer objectBuffer;
-        log.getEntry(references[index], objectBuffer);
+        LogEntryType type = log.getEntry(references[index], objectBuffer);
 
         Object object(objectBuffer);
         uint32_t length = objectBuffer.size();
-        if (keysOnly) {
+        if (keysOnly && !needValue) {
             uint32_t dataLength = object.getValueLength();
             length -= dataLength;
+        } else if (type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+            // Replace the manifest with the object's real value and
+            // reserialize it so that its header is consistent.
+            Key key(type, objectBuffer);
+            Buffer keysAndValue;
+            object.appendKeysAndValueToBuffer(keysAndValue);
+            keysAndValue.truncate(keysAndValue.size() -
+                                  object.getValueLength());
+            if (!ObjectManager::appendChunkedValue(log, objectMap, key,
+                    object, &keysAndValue)) {
+                continue;
+            }
+            Object chunkedObject(object.getTableId(), object.getVersion(),
+                                 object.getTimestamp(), keysAndValue);
+            objectBuffer.reset();
+            chunkedObject.assembleForLog(objectBuffer);
+            length = objectBuffer.size();
+        }
+
+        if (filter.examinesValue()) {
+            Object current(objectBuffer);
+            if (!filter.matchesValue(current))
+                continue;
+            if (keysOnly) {
+                length = objectBuffer.size() - current.getValueLength();
+            } else if (filter.slicesValue()) {
+                Buffer sliced;
+                filter.sliceValue(current, sliced);
+                objectBuffer.reset();
+                objectBuffer.append(&sliced, 0, sliced.size());
+                length = objectBuffer.size();
+            }
         }
 
         if (buffer->size() + sizeof(length) + length > maxBytes) {
@@ -215,6 +275,9 @@ class ObjectHashComparator {
  *      and data. True means that the returned objects have
  *      been truncated so that the object data (normally the last
  *      field of the object) is omitted.
+ * \param filter
+ *      Selects the objects to return and the part of each value to
+ *      return. Must remain valid until #complete returns.
  * \param requestedTabletStartHash
  *      The start hash of the tablet as requested by the client.
  * \param actualTabletStartHash
@@ -237,6 +300,7 @@ class ObjectHashComparator {
  */
 Enumeration::Enumeration(uint64_t tableId,
                          bool keysOnly,
+                         const EnumerationFilter& filter,
                          uint64_t requestedTabletStartHash,
                          uint64_t actualTabletStartHash,
                          uint64_t actualTabletEndHash,
@@ -247,6 +311,7 @@ Enumeration::Enumeration(uint64_t tableId,
                          Buffer& payload, uint32_t maxPayloadBytes)
     : tableId(tableId)
     , keysOnly(keysOnly)
+    , filter(filter)
     , requestedTabletStartHash(requestedTabletStartHash)
     , actualTabletStartHash(actualTabletStartHash)
     , actualTabletEndHash(actualTabletEndHash)
@@ -293,14 +358,16 @@ Enumeration::complete()
     args.requestedTabletStartHash = requestedTabletStartHash;
     args.log = &log;
     args.iter = &iter;
+    args.filter = &filter;
     args.objectReferences = &objectRefs;
     void* cookie = static_cast<void*>(&args);
     while (bucketIndex < numBuckets) {
         objectRefs.clear();
         bucketStart = payload.size();
         objectMap.forEachInBucket(enumerateBucket, cookie, bucketIndex);
-        int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
-                                                 maxPayloadBytes, keysOnly);
+        int64_t overflow = appendObjectsToBuffer(log, objectMap, &payload,
+                                                 objectRefs, maxPayloadBytes,
+                                                 keysOnly, filter);
         payloadFull = overflow >= 0;
         if (payloadFull) {
             break;
@@ -319,8 +386,10 @@ Enumeration::complete()
             ObjectHashComparator comparator(log);
             std::sort(objectRefs.begin(), objectRefs.end(), comparator);
 
-            int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
-                                                     maxPayloadBytes, keysOnly);
+            int64_t overflow = appendObjectsToBuffer(log, objectMap,
+                                                     &payload, objectRefs,
+                                                     maxPayloadBytes, keysOnly,
+                                                     filter);
             if (overflow >= 0) {
                 LogEntryType type;
                 Buffer buffer;
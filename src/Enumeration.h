@@ -17,6 +17,7 @@
 #define RAMCLOUD_ENUMERATION_H
 
 #include "Buffer.h"
+#include "EnumerationFilter.h"
 #include "EnumerationIterator.h"
 #include "HashTable.h"
 #include "Log.h"
@@ -38,6 +39,7 @@ class Enumeration {
   public:
     Enumeration(uint64_t tableId,
                 bool keysOnly,
+                const EnumerationFilter& filter,
                 uint64_t requestedTabletStartHash,
                 uint64_t actualTabletStartHash,
                 uint64_t actualTabletEndHash,
@@ -58,6 +60,10 @@ class Enumeration {
     /// field of the object) is omitted.
     bool keysOnly;
 
+    /// Selects the objects to return and the part of each value to
+    /// return; see EnumerationFilter.
+    const EnumerationFilter& filter;
+
     /// The start hash of the tablet as requested by the client.
     uint64_t requestedTabletStartHash;
 
@@ -0,0 +1,309 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "EnumerationFilter.h"
+#include "Key.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an EnumerationFilter that matches every object and returns
+ * each value in its entirety.
+ */
+EnumerationFilter::EnumerationFilter()
+    : lastKeyHash(~0UL)
+    , minVersion(0)
+    , maxVersion(~0UL)
+    , keyPrefix()
+    , valuePatternOffset(0)
+    , valuePattern()
+    , valueSliceOffset(0)
+    , valueSliceLength(~0U)
+{
+}
+
+/**
+ * Returns true if the filter needs an object's value (either to test
+ * it or to slice it), false if the keys and version suffice.
+ */
+bool
+EnumerationFilter::examinesValue() const
+{
+    return !valuePattern.empty() || slicesValue();
+}
+
+/**
+ * Returns true if the filter matches every object and doesn't alter
+ * them, in which case it needn't be sent to the server.
+ */
+bool
+EnumerationFilter::isEmpty() const
+{
+    return lastKeyHash == ~0UL && minVersion == 0 && maxVersion == ~0UL &&
+            keyPrefix.empty() && !examinesValue();
+}
+
+/**
+ * Test the predicates that depend only on an object's primary key.
+ *
+ * \param key
+ *      Primary key of the object.
+ * \return
+ *      True if the key hash is within the limit and the key starts with
+ *      the requested prefix.
+ */
+bool
+EnumerationFilter::matchesKey(Key& key) const
+{
+    if (key.getHash() > lastKeyHash)
+        return false;
+    if (keyPrefix.empty())
+        return true;
+    if (key.getStringKeyLength() < keyPrefix.size())
+        return false;
+    return memcmp(key.getStringKey(), keyPrefix.data(),
+            keyPrefix.size()) == 0;
+}
+
+/**
+ * Test the value predicate against an object.
+ *
+ * \param object
+ *      Object whose value is to be tested. For chunked objects this must
+ *      be the reassembled object, not the manifest.
+ * \return
+ *      True if no value pattern was specified, or if the value contains
+ *      the pattern at the requested offset.
+ */
+bool
+EnumerationFilter::matchesValue(Object& object) const
+{
+    if (valuePattern.empty())
+        return true;
+    uint32_t valueLength = object.getValueLength();
+    if (valuePatternOffset > valueLength ||
+            valuePattern.size() > valueLength - valuePatternOffset) {
+        return false;
+    }
+    const char* value = static_cast<const char*>(object.getValue());
+    return memcmp(value + valuePatternOffset, valuePattern.data(),
+            valuePattern.size()) == 0;
+}
+
+/**
+ * Test the version predicate.
+ *
+ * \param version
+ *      Version of an object.
+ * \return
+ *      True if the version is within the requested range.
+ */
+bool
+EnumerationFilter::matchesVersion(uint64_t version) const
+{
+    return minVersion <= version && version <= maxVersion;
+}
+
+/**
+ * Replace the contents of this filter with one that was serialized into
+ * a request by #serialize.
+ *
+ * \param buffer
+ *      Buffer containing the serialized filter.
+ * \param offset
+ *      Offset of the filter within \a buffer.
+ * \param length
+ *      Length of the serialized filter in bytes; 0 means that the request
+ *      had no filter, so every object matches.
+ * \return
+ *      False if the serialized filter was malformed, true otherwise.
+ */
+bool
+EnumerationFilter::parse(Buffer& buffer, uint32_t offset, uint32_t length)
+{
+    *this = EnumerationFilter();
+    if (length == 0)
+        return true;
+
+    const Header* header = buffer.getOffset<Header>(offset);
+    if (header == NULL || length < sizeof32(*header))
+        return false;
+    uint64_t variableLength = uint64_t(header->keyPrefixLength) +
+            header->valuePatternLength;
+    if (length != sizeof32(*header) + variableLength ||
+            buffer.size() < offset + length) {
+        return false;
+    }
+
+    lastKeyHash = header->lastKeyHash;
+    minVersion = header->minVersion;
+    maxVersion = header->maxVersion;
+    valuePatternOffset = header->valuePatternOffset;
+    valueSliceOffset = header->valueSliceOffset;
+    valueSliceLength = header->valueSliceLength;
+    offset += sizeof32(*header);
+    keyPrefix.resize(header->keyPrefixLength);
+    buffer.copy(offset, header->keyPrefixLength, &keyPrefix[0]);
+    offset += header->keyPrefixLength;
+    valuePattern.resize(header->valuePatternLength);
+    buffer.copy(offset, header->valuePatternLength, &valuePattern[0]);
+    return true;
+}
+
+/**
+ * Append a serialized form of this filter to a buffer.
+ *
+ * \param buffer
+ *      The filter is appended here.
+ * \return
+ *      The number of bytes appended.
+ */
+uint32_t
+EnumerationFilter::serialize(Buffer& buffer) const
+{
+    Header* header = buffer.emplaceAppend<Header>();
+    header->lastKeyHash = lastKeyHash;
+    header->minVersion = minVersion;
+    header->maxVersion = maxVersion;
+    header->valuePatternOffset = valuePatternOffset;
+    header->valuePatternLength = downCast<uint32_t>(valuePattern.size());
+    header->valueSliceOffset = valueSliceOffset;
+    header->valueSliceLength = valueSliceLength;
+    header->keyPrefixLength = downCast<uint16_t>(keyPrefix.size());
+    buffer.appendCopy(keyPrefix.data(), header->keyPrefixLength);
+    buffer.appendCopy(valuePattern.data(), header->valuePatternLength);
+    return sizeof32(*header) + header->keyPrefixLength +
+            header->valuePatternLength;
+}
+
+/**
+ * Restrict the filter to objects whose primary key hash is at most a
+ * given value.
+ *
+ * \param lastKeyHash
+ *      Largest key hash to return.
+ */
+void
+EnumerationFilter::setKeyHashLimit(uint64_t lastKeyHash)
+{
+    this->lastKeyHash = lastKeyHash;
+}
+
+/**
+ * Restrict the filter to objects whose primary key begins with a given
+ * byte string.
+ *
+ * \param prefix
+ *      The required prefix; copied.
+ * \param length
+ *      Length of \a prefix in bytes; 0 removes the restriction.
+ */
+void
+EnumerationFilter::setKeyPrefix(const void* prefix, uint16_t length)
+{
+    keyPrefix.assign(static_cast<const char*>(prefix), length);
+}
+
+/**
+ * Restrict the filter to objects whose value contains a given byte string
+ * at a given offset.
+ *
+ * \param offset
+ *      Offset within the value at which the pattern must appear.
+ * \param pattern
+ *      The required bytes; copied.
+ * \param length
+ *      Length of \a pattern in bytes; 0 removes the restriction.
+ */
+void
+EnumerationFilter::setValuePattern(uint32_t offset, const void* pattern,
+        uint32_t length)
+{
+    valuePatternOffset = offset;
+    valuePattern.assign(static_cast<const char*>(pattern), length);
+}
+
+/**
+ * Return only part of each object's value. The value predicate (if any)
+ * is evaluated against the complete value.
+ *
+ * \param offset
+ *      Offset within the value of the first byte to return.
+ * \param length
+ *      Maximum number of bytes to return. ~0 returns the entire value
+ *      (and \a offset is ignored).
+ */
+void
+EnumerationFilter::setValueSlice(uint32_t offset, uint32_t length)
+{
+    valueSliceOffset = offset;
+    valueSliceLength = length;
+}
+
+/**
+ * Restrict the filter to objects whose version lies in a given range.
+ *
+ * \param minVersion
+ *      Smallest version to return.
+ * \param maxVersion
+ *      Largest version to return.
+ */
+void
+EnumerationFilter::setVersionRange(uint64_t minVersion, uint64_t maxVersion)
+{
+    this->minVersion = minVersion;
+    this->maxVersion = maxVersion;
+}
+
+/**
+ * Returns true if the filter returns only part of each value.
+ */
+bool
+EnumerationFilter::slicesValue() const
+{
+    return valueSliceLength != ~0U;
+}
+
+/**
+ * Serialize an object with its value reduced to the slice selected by
+ * #setValueSlice.
+ *
+ * \param object
+ *      The object to slice. For chunked objects this must be the
+ *      reassembled object, not the manifest.
+ * \param[out] output
+ *      The sliced object, in the format of an Object in the log, is
+ *      appended here.
+ */
+void
+EnumerationFilter::sliceValue(Object& object, Buffer& output) const
+{
+    Buffer keysAndValue;
+    object.appendKeysAndValueToBuffer(keysAndValue);
+    uint32_t valueLength = object.getValueLength();
+    uint32_t keysLength = keysAndValue.size() - valueLength;
+    uint32_t start = std::min(valueSliceOffset, valueLength);
+    uint32_t length = std::min(valueSliceLength, valueLength - start);
+
+    Buffer sliced;
+    sliced.append(&keysAndValue, 0, keysLength);
+    sliced.append(&keysAndValue, keysLength + start, length);
+    Object slicedObject(object.getTableId(), object.getVersion(),
+            object.getTimestamp(), sliced);
+    slicedObject.assembleForLog(output);
+}
+
+} // namespace RAMCloud
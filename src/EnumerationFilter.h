@@ -0,0 +1,113 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_ENUMERATIONFILTER_H
+#define RAMCLOUD_ENUMERATIONFILTER_H
+
+#include "Common.h"
+#include "Buffer.h"
+
+namespace RAMCloud {
+
+class Key;
+class Object;
+
+/**
+ * An EnumerationFilter describes which objects a table enumeration should
+ * return and which part of each object's value to return. The client
+ * sends the filter with each ENUMERATE request and the master applies it
+ * while walking its hash table, so objects that the client would discard
+ * are never copied into the response.
+ *
+ * A filter is a conjunction of the following predicates, each of which
+ * is disabled by default:
+ *   - The primary key starts with a given prefix.
+ *   - The object's version lies in a given range.
+ *   - The value contains a given byte string at a given offset.
+ *   - The primary key hash is no greater than a given limit (used by
+ *     TableEnumerator to divide a table among parallel streams).
+ * In addition, a filter may project each returned value down to a slice
+ * of it (the slice is clipped to the end of the value).
+ *
+ * Filters are serialized in the ENUMERATE request immediately after the
+ * enumeration iterator; see WireFormat::Enumerate.
+ */
+class EnumerationFilter {
+  public:
+    EnumerationFilter();
+    bool examinesValue() const;
+    bool isEmpty() const;
+    bool matchesKey(Key& key) const;
+    bool matchesValue(Object& object) const;
+    bool matchesVersion(uint64_t version) const;
+    bool parse(Buffer& buffer, uint32_t offset, uint32_t length);
+    uint32_t serialize(Buffer& buffer) const;
+    void setKeyHashLimit(uint64_t lastKeyHash);
+    void setKeyPrefix(const void* prefix, uint16_t length);
+    void setValuePattern(uint32_t offset, const void* pattern,
+            uint32_t length);
+    void setValueSlice(uint32_t offset, uint32_t length);
+    void setVersionRange(uint64_t minVersion, uint64_t maxVersion);
+    bool slicesValue() const;
+    void sliceValue(Object& object, Buffer& output) const;
+
+  PRIVATE:
+    /**
+     * Fixed-size part of a serialized filter. It is followed by the key
+     * prefix and then the value pattern.
+     */
+    struct Header {
+        uint64_t lastKeyHash;
+        uint64_t minVersion;
+        uint64_t maxVersion;
+        uint32_t valuePatternOffset;
+        uint32_t valuePatternLength;
+        uint32_t valueSliceOffset;
+        uint32_t valueSliceLength;
+        uint16_t keyPrefixLength;
+    } __attribute__((packed));
+
+    /// Only objects whose primary key hash is at most this are returned.
+    uint64_t lastKeyHash;
+
+    /// Only objects whose version is at least this are returned.
+    uint64_t minVersion;
+
+    /// Only objects whose version is at most this are returned.
+    uint64_t maxVersion;
+
+    /// Only objects whose primary key begins with these bytes are
+    /// returned. Empty means any key matches.
+    string keyPrefix;
+
+    /// Offset within the value at which #valuePattern must appear.
+    uint32_t valuePatternOffset;
+
+    /// Only objects whose value contains these bytes at
+    /// #valuePatternOffset are returned. Empty means any value matches.
+    string valuePattern;
+
+    /// Offset within the value of the first byte to return, if
+    /// #valueSliceLength isn't ~0.
+    uint32_t valueSliceOffset;
+
+    /// Maximum number of value bytes to return, starting at
+    /// #valueSliceOffset. ~0 means the entire value is returned.
+    uint32_t valueSliceLength;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ENUMERATIONFILTER_H
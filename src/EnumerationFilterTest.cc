@@ -0,0 +1,172 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "EnumerationFilter.h"
+#include "Key.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+class EnumerationFilterTest : public ::testing::Test {
+  public:
+    EnumerationFilter filter;
+    Buffer objectBuffer;
+
+    EnumerationFilterTest()
+        : filter()
+        , objectBuffer()
+    {
+    }
+
+    // Returns an object in table 1 with the given key and value; its
+    // storage is in objectBuffer.
+    Object*
+    makeObject(const char* key, const char* value)
+    {
+        Key objectKey(1, key, downCast<uint16_t>(strlen(key)));
+        objectBuffer.reset();
+        Buffer serialized;
+        Object object(objectKey, value, downCast<uint32_t>(strlen(value)),
+                7, 0, serialized);
+        object.assembleForLog(objectBuffer);
+        return new Object(objectBuffer);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(EnumerationFilterTest);
+};
+
+TEST_F(EnumerationFilterTest, isEmpty) {
+    EXPECT_TRUE(filter.isEmpty());
+    EXPECT_FALSE(filter.examinesValue());
+    filter.setValueSlice(0, 2);
+    EXPECT_FALSE(filter.isEmpty());
+    EXPECT_TRUE(filter.examinesValue());
+    EXPECT_TRUE(filter.slicesValue());
+
+    EnumerationFilter hashLimit;
+    hashLimit.setKeyHashLimit(100);
+    EXPECT_FALSE(hashLimit.isEmpty());
+    EXPECT_FALSE(hashLimit.examinesValue());
+}
+
+TEST_F(EnumerationFilterTest, matchesKey) {
+    Key key1(1, "user:17", 7);
+    Key key2(1, "us", 2);
+    Key key3(1, "order:3", 7);
+    EXPECT_TRUE(filter.matchesKey(key1));
+    filter.setKeyPrefix("user:", 5);
+    EXPECT_TRUE(filter.matchesKey(key1));
+    EXPECT_FALSE(filter.matchesKey(key2));
+    EXPECT_FALSE(filter.matchesKey(key3));
+
+    filter.setKeyHashLimit(key1.getHash() - 1);
+    EXPECT_FALSE(filter.matchesKey(key1));
+    filter.setKeyHashLimit(key1.getHash());
+    EXPECT_TRUE(filter.matchesKey(key1));
+}
+
+TEST_F(EnumerationFilterTest, matchesValue) {
+    std::unique_ptr<Object> object(makeObject("key", "abcdef"));
+    EXPECT_TRUE(filter.matchesValue(*object));
+    filter.setValuePattern(2, "cd", 2);
+    EXPECT_TRUE(filter.matchesValue(*object));
+    filter.setValuePattern(1, "cd", 2);
+    EXPECT_FALSE(filter.matchesValue(*object));
+    filter.setValuePattern(5, "fg", 2);
+    EXPECT_FALSE(filter.matchesValue(*object));
+    filter.setValuePattern(100, "f", 1);
+    EXPECT_FALSE(filter.matchesValue(*object));
+}
+
+TEST_F(EnumerationFilterTest, matchesVersion) {
+    EXPECT_TRUE(filter.matchesVersion(0));
+    filter.setVersionRange(5, 10);
+    EXPECT_FALSE(filter.matchesVersion(4));
+    EXPECT_TRUE(filter.matchesVersion(5));
+    EXPECT_TRUE(filter.matchesVersion(10));
+    EXPECT_FALSE(filter.matchesVersion(11));
+}
+
+TEST_F(EnumerationFilterTest, serializeAndParse) {
+    filter.setKeyPrefix("pre", 3);
+    filter.setVersionRange(3, 9);
+    filter.setValuePattern(4, "xyz", 3);
+    filter.setValueSlice(1, 2);
+    filter.setKeyHashLimit(99);
+
+    Buffer buffer;
+    buffer.appendCopy("junk", 4);
+    uint32_t length = filter.serialize(buffer);
+    EXPECT_EQ(buffer.size() - 4, length);
+
+    EnumerationFilter parsed;
+    EXPECT_TRUE(parsed.parse(buffer, 4, length));
+    EXPECT_EQ(99U, parsed.lastKeyHash);
+    EXPECT_EQ(3U, parsed.minVersion);
+    EXPECT_EQ(9U, parsed.maxVersion);
+    EXPECT_EQ("pre", parsed.keyPrefix);
+    EXPECT_EQ(4U, parsed.valuePatternOffset);
+    EXPECT_EQ("xyz", parsed.valuePattern);
+    EXPECT_EQ(1U, parsed.valueSliceOffset);
+    EXPECT_EQ(2U, parsed.valueSliceLength);
+
+    // No filter in the request.
+    EXPECT_TRUE(parsed.parse(buffer, 4, 0));
+    EXPECT_TRUE(parsed.isEmpty());
+}
+
+TEST_F(EnumerationFilterTest, parse_malformed) {
+    filter.setKeyPrefix("pre", 3);
+    Buffer buffer;
+    uint32_t length = filter.serialize(buffer);
+    EnumerationFilter parsed;
+    EXPECT_FALSE(parsed.parse(buffer, 0, length - 1));
+    EXPECT_FALSE(parsed.parse(buffer, 0, length + 1));
+    EXPECT_FALSE(parsed.parse(buffer, 0, 5));
+    buffer.truncate(length - 1);
+    EXPECT_FALSE(parsed.parse(buffer, 0, length));
+}
+
+TEST_F(EnumerationFilterTest, sliceValue) {
+    std::unique_ptr<Object> object(makeObject("key", "abcdef"));
+    Buffer output;
+    filter.setValueSlice(2, 3);
+    filter.sliceValue(*object, output);
+    Object sliced(output);
+    EXPECT_EQ("key", string(static_cast<const char*>(sliced.getKey()),
+            sliced.getKeyLength()));
+    uint32_t valueLength;
+    const void* value = sliced.getValue(&valueLength);
+    EXPECT_EQ("cde", string(static_cast<const char*>(value), valueLength));
+    EXPECT_EQ(7U, sliced.getVersion());
+    EXPECT_TRUE(sliced.checkIntegrity());
+
+    // The slice is clipped to the end of the value.
+    output.reset();
+    filter.setValueSlice(4, 10);
+    filter.sliceValue(*object, output);
+    Object clipped(output);
+    value = clipped.getValue(&valueLength);
+    EXPECT_EQ("ef", string(static_cast<const char*>(value), valueLength));
+
+    output.reset();
+    filter.setValueSlice(10, 10);
+    filter.sliceValue(*object, output);
+    Object empty(output);
+    EXPECT_EQ(0U, empty.getValueLength());
+}
+
+}  // namespace RAMCloud
@@ -116,6 +116,25 @@ HashTable::Entry::hashMatches(uint64_t hash) const
     return (!ue.chain && ue.ptr != 0 && ue.hash == hash);
 }
 
+/**
+ * Check whether the secondary hash bits stored fall within a range.
+ * \param[in] firstHash
+ *      Lowest secondary hash bits (16 bits) considered a match.
+ * \param[in] lastHash
+ *      Highest secondary hash bits (16 bits) considered a match.
+ * \return
+ *      True if this Entry stores a reference whose secondary hash bits
+ *      are in [firstHash, lastHash], otherwise false.
+ */
+bool
+HashTable::Entry::hashInRange(uint64_t firstHash, uint64_t lastHash) const
+{
+    UnpackedEntry ue;
+    unpack(ue);
+    return (!ue.chain && ue.ptr != 0 &&
+            ue.hash >= firstHash && ue.hash <= lastHash);
+}
+
 /**
  * Replace this hash table entry.
  * \param[in] hash
@@ -411,6 +430,56 @@ HashTable::forEachInBucket(void (*callback)(uint64_t, void *),
     return numCalls;
 }
 
+/**
+ * Apply the given callback function to each element stored in the
+ * specified bucket of the hash table whose key hash may lie in a given
+ * range. Since only the secondary hash bits are stored in each entry, the
+ * callback may also be invoked for some elements outside the range; the
+ * caller must check them. However, elements that can be excluded cheaply
+ * are, without touching the memory they refer to.
+ * \param callback
+ *      The callback to fire on each element stored in the bucket.
+ * \param cookie
+ *      An opaque parameter to pass to the callback function.
+ * \param bucket
+ *      An index into the HashTable's buckets.  Must be < #numBuckets.
+ * \param firstKeyHash
+ *      Lowest key hash of interest.
+ * \param lastKeyHash
+ *      Highest key hash of interest.
+ * \return
+ *      The total number of callbacks fired.
+ */
+uint64_t
+HashTable::forEachInBucket(void (*callback)(uint64_t, void *),
+                           void *cookie,
+                           uint64_t bucket,
+                           KeyHash firstKeyHash,
+                           KeyHash lastKeyHash)
+{
+    uint64_t firstHash, lastHash;
+    findBucketIndex(numBuckets, firstKeyHash, &firstHash);
+    findBucketIndex(numBuckets, lastKeyHash, &lastHash);
+
+    uint64_t numCalls = 0;
+    CacheLine *cl = &buckets.get()[bucket];
+    while (1) {
+        for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
+            Entry *e = &cl->entries[j];
+            if (e->hashInRange(firstHash, lastHash)) {
+                callback(e->getReference(), cookie);
+                numCalls++;
+            }
+        }
+
+        Entry *entry = &cl->entries[ENTRIES_PER_CACHE_LINE - 1];
+        cl = entry->getChainPointer();
+        if (cl == NULL)
+            break;
+    }
+    return numCalls;
+}
+
 /**
  * Apply the given callback function to each element stored in the
  * HashTable.
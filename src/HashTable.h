@@ -85,6 +85,7 @@ class HashTable {
         uint64_t getReference() const;
         CacheLine* getChainPointer() const;
         bool hashMatches(uint64_t hash) const;
+        bool hashInRange(uint64_t firstHash, uint64_t lastHash) const;
 
       PRIVATE:
         /**
@@ -224,6 +225,11 @@ class HashTable {
     uint64_t forEachInBucket(void (*callback)(uint64_t, void *),
                              void *cookie,
                              uint64_t bucket);
+    uint64_t forEachInBucket(void (*callback)(uint64_t, void *),
+                             void *cookie,
+                             uint64_t bucket,
+                             KeyHash firstKeyHash,
+                             KeyHash lastKeyHash);
     uint64_t forEach(void (*callback)(uint64_t, void *), void *cookie);
     void prefetchBucket(KeyHash keyHash);
     static uint32_t bytesPerCacheLine();
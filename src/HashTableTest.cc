@@ -225,6 +225,20 @@ TEST_F(HashTableEntryTest, hashMatches) {
     EXPECT_TRUE(!e.hashMatches(0xfeedUL));
 }
 
+TEST_F(HashTableEntryTest, hashInRange) {
+    HashTable::Entry e;
+    e.clear();
+    EXPECT_FALSE(e.hashInRange(0UL, 0xffffUL));
+    e.setChainPointer(reinterpret_cast<HashTable::CacheLine*>(
+        0x1UL));
+    EXPECT_FALSE(e.hashInRange(0UL, 0xffffUL));
+    e.setReference(0xbeefUL, 0x1UL);
+    EXPECT_TRUE(e.hashInRange(0UL, 0xffffUL));
+    EXPECT_TRUE(e.hashInRange(0xbeefUL, 0xbeefUL));
+    EXPECT_FALSE(e.hashInRange(0UL, 0xbeeeUL));
+    EXPECT_FALSE(e.hashInRange(0xbef0UL, 0xffffUL));
+}
+
 /**
  * Unit tests for HashTable.
  */
@@ -821,4 +835,40 @@ TEST_F(HashTableTest, forEach) {
         EXPECT_EQ(1U, checkoff[i].count);
 }
 
+TEST_F(HashTableTest, forEachInBucket_keyHashRange) {
+    HashTable ht(2);
+    uint32_t arrayLen = 256;
+    TestObject checkoff[arrayLen] = {};
+    KeyHash hashes[arrayLen];
+
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        string stringKey = format("%u", i);
+        checkoff[i].setKey(stringKey);
+        Key key(checkoff[i].tableId,
+                checkoff[i].stringKeyPtr,
+                checkoff[i].stringKeyLength);
+        hashes[i] = key.getHash();
+        uint64_t ref = checkoff[i].u64Address();
+        replace(&ht, key, ref);
+    }
+
+    // The range is aligned to the secondary hash bits, so it is exact.
+    KeyHash lastKeyHash = 0x7fffffffffffffffUL;
+    uint64_t t = 0;
+    for (uint64_t bucket = 0; bucket < ht.getNumBuckets(); bucket++) {
+        t += ht.forEachInBucket(test_forEach_callback,
+            reinterpret_cast<void *>(57), bucket, 0, lastKeyHash);
+    }
+
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        uint64_t inRange = (hashes[i] <= lastKeyHash) ? 1 : 0;
+        EXPECT_EQ(inRange, checkoff[i].count);
+        expected += inRange;
+    }
+    EXPECT_EQ(expected, t);
+    EXPECT_LT(0U, expected);
+    EXPECT_GT(arrayLen, expected);
+}
+
 } // namespace RAMCloud
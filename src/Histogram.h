@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_HISTOGRAM_H
 #define RAMCLOUD_HISTOGRAM_H
 
+#include <cmath>
+
 #include "Common.h"
 
 #include "Histogram.pb.h"
@@ -271,6 +273,41 @@ class Histogram {
         return -1;
     }
 
+    /**
+     * Get the value at or below which the given fraction of the samples
+     * stored in the histogram fall, e.g. 0.99 for the 99th percentile
+     * (using the nearest-rank method). Unlike getMedian, the result is a
+     * sample value (the one represented by the bucket the percentile falls
+     * in), not a bucket index.
+     *
+     * If no samples were stored, returns 0. If the percentile falls within
+     * the outliers, returns the largest sample.
+     *
+     * \param fraction
+     *      Fraction of the samples (between 0 and 1).
+     */
+    uint64_t
+    getPercentile(double fraction) const
+    {
+        uint64_t totalSamples = getTotalSamples();
+        if (totalSamples == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(
+                ceil(fraction * static_cast<double>(totalSamples)));
+        if (rank == 0)
+            rank = 1;
+        if (rank > totalSamples)
+            rank = totalSamples;
+        uint64_t currentCount = 0;
+        for (uint64_t i = 0; i < numBuckets; i++) {
+            currentCount += buckets[i];
+            if (currentCount >= rank)
+                return i * bucketWidth;
+        }
+        return max;
+    }
+
     /**
      * Serialize the histogram to a protocol buffer for network transmission.
      */
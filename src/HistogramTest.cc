@@ -203,6 +203,25 @@ TEST_F(HistogramTest, getMedian) {
     EXPECT_EQ(5UL, h2.getMedian());
 }
 
+TEST_F(HistogramTest, getPercentile) {
+    Histogram noSamples(1, 1);
+    EXPECT_EQ(0UL, noSamples.getPercentile(0.99));
+
+    Histogram h(10, 10);
+    for (int i = 0; i < 100; i++)
+        h.storeSample(i < 90 ? 20 : 51);
+    EXPECT_EQ(20UL, h.getPercentile(0.0));
+    EXPECT_EQ(20UL, h.getPercentile(0.5));
+    EXPECT_EQ(20UL, h.getPercentile(0.89));
+    EXPECT_EQ(50UL, h.getPercentile(0.91));
+    EXPECT_EQ(50UL, h.getPercentile(1.0));
+
+    // percentile falls within outliers
+    h.storeSample(1000);
+    h.storeSample(2000);
+    EXPECT_EQ(2000UL, h.getPercentile(0.999));
+}
+
 TEST_F(HistogramTest, serialize) {
     // Covered by 'constructor_deserializer'.
 }
@@ -111,6 +111,12 @@ HomaTransport::HomaTransport(Context* context, const ServiceLocator* locator,
     , activeMessages()
     , inactiveMessages()
     , maxGrantedMessages()
+    , minDegreeOC()
+    , maxDegreeOC()
+    , rxQueueEstimator()
+    , rxIdleCycles(0)
+    , rxMaxQueuedBytes(0)
+    , lastOvercommitmentAdjustment(0)
 {
     // Set up the timer to trigger at 2 ms intervals. We use this choice
     // (as of 11/2015) because the Linux kernel appears to buffer packets
@@ -153,18 +159,21 @@ HomaTransport::HomaTransport(Context* context, const ServiceLocator* locator,
     highestSchedPriority = std::max(lowestUnschedPrio-1, 0);
     maxGrantedMessages = getOvercommitmentDegree(params,
             highestSchedPriority + 1);
+    getOvercommitmentRange(params, maxGrantedMessages, &minDegreeOC,
+            &maxDegreeOC);
     unschedPrioCutoffs = getUnschedPrioCutoffs(params,
             highestAvailPriority - lowestUnschedPrio + 1);
 
     LOG(NOTICE, "HomaTransport parameters: clientId %lu, maxDataPerPacket %u, "
             "roundTripBytes %u, grantIncrement %u, "
             "pingIntervals %d, timeoutIntervals %d, timerInterval %.2f ms, "
-            "maxGrantedMessages %u, highestAvailPriority %d, "
+            "maxGrantedMessages %u (range [%u, %u]), highestAvailPriority %d, "
             "lowestUnschedPriority %d, highestSchedPriority %d",
             clientId, maxDataPerPacket, roundTripBytes, grantIncrement,
             pingIntervals, timeoutIntervals,
             Cycles::toSeconds(timerInterval)*1e3, maxGrantedMessages,
-            highestAvailPriority, lowestUnschedPrio, highestSchedPriority);
+            minDegreeOC, maxDegreeOC, highestAvailPriority, lowestUnschedPrio,
+            highestSchedPriority);
 }
 
 /**
@@ -324,6 +333,10 @@ HomaTransport::getRoundTripBytes(const ServiceLocator* locator)
         }
     }
 
+    // The receive-side queue estimator used to adjust the degree of
+    // overcommitment runs at the same link speed.
+    rxQueueEstimator.setBandwidth(mBitsPerSec);
+
     // Compute round-trip time in terms of full packets (round up).
     uint32_t roundTripBytes = (roundTripMicros*mBitsPerSec)/8;
     roundTripBytes = ((roundTripBytes+maxDataPerPacket-1)/maxDataPerPacket)
@@ -362,6 +375,47 @@ HomaTransport::getOvercommitmentDegree(const ServiceLocator *locator,
     return degreeOC;
 }
 
+/**
+ * Parse option values in a service locator to determine the range within
+ * which the degree of overcommitment may be adjusted at runtime.
+ *
+ * \param locator
+ *      Service locator that may contain "minDegreeOC" and "maxDegreeOC"
+ *      options. If NULL, or if the options are missing, the range collapses
+ *      to degreeOC (i.e. the degree of overcommitment is static).
+ * \param degreeOC
+ *      Initial degree of overcommitment (see getOvercommitmentDegree). The
+ *      range is widened, if needed, to include this value.
+ * \param[out] minDegree
+ *      Lower bound on the degree of overcommitment.
+ * \param[out] maxDegree
+ *      Upper bound on the degree of overcommitment.
+ */
+void
+HomaTransport::getOvercommitmentRange(const ServiceLocator *locator,
+        uint32_t degreeOC, uint32_t* minDegree, uint32_t* maxDegree)
+{
+    *minDegree = *maxDegree = degreeOC;
+    if (locator && locator->hasOption("minDegreeOC")) {
+        int value = locator->getOption<int>("minDegreeOC");
+        if (value > 0) {
+            *minDegree = std::min(degreeOC, downCast<uint32_t>(value));
+        } else {
+            LOG(ERROR, "Bad HomaTransport minDegreeOC option value '%d' "
+                    "(expected positive integer); ignoring option", value);
+        }
+    }
+    if (locator && locator->hasOption("maxDegreeOC")) {
+        int value = locator->getOption<int>("maxDegreeOC");
+        if (value > 0) {
+            *maxDegree = std::max(degreeOC, downCast<uint32_t>(value));
+        } else {
+            LOG(ERROR, "Bad HomaTransport maxDegreeOC option value '%d' "
+                    "(expected positive integer); ignoring option", value);
+        }
+    }
+}
+
 /**
  * Parse option values in a service locator to determine what priorities to use
  * for unscheduled traffic.
@@ -1873,6 +1927,10 @@ HomaTransport::Poller::poll()
                 "last poll was %u ns ago", uint32_t(owner->iteration), ns);
 #endif
         for (uint32_t i = 0; i < numPackets; i++) {
+            if (t->minDegreeOC < t->maxDegreeOC) {
+                t->recordIncomingBytes(t->receivedPackets[i].len,
+                        owner->currentTime);
+            }
             t->handlePacket(&t->receivedPackets[i]);
         }
         t->receivedPackets.clear();
@@ -1925,6 +1983,9 @@ HomaTransport::Poller::poll()
                 timeTrace("Deadline invocation of checkTimeouts");
             }
             t->checkTimeouts();
+            if (t->minDegreeOC < t->maxDegreeOC) {
+                t->adjustOvercommitment(now);
+            }
             result = 1;
             t->nextTimeoutCheck = now + t->timerInterval;
             t->timeoutCheckDeadline = 0;
@@ -2210,26 +2271,10 @@ HomaTransport::replaceActiveMessage(ScheduledMessage *oldMessage,
         inactiveMessages.push_back(*oldMessage);
     }
 
-    // Find an inactive message to activate if none has been designated.
-    if (NULL == newMessage) {
-        for (ScheduledMessage& message : inactiveMessages) {
-            if (newMessage != NULL && newMessage->compareTo(message) <= 0) {
-                continue;
-            }
-
-            // Make sure the candidate doesn't have the same sender as any of
-            // the active messages.
-            bool senderConflict = false;
-            for (ScheduledMessage& active : activeMessages) {
-                if (active.senderHash == message.senderHash) {
-                    senderConflict = true;
-                    break;
-                }
-            }
-            if (!senderConflict) {
-                newMessage = &message;
-            }
-        }
+    // Find an inactive message to activate if none has been designated (and
+    // the degree of overcommitment hasn't been lowered in the meantime).
+    if ((NULL == newMessage) && (activeMessages.size() < maxGrantedMessages)) {
+        newMessage = pickInactiveMessage();
     }
     if (newMessage) {
         adjustSchedulingPrecedence(newMessage);
@@ -2273,9 +2318,9 @@ HomaTransport::tryToSchedule(ScheduledMessage* message)
     // than the active messages.
     if (activeMessages.size() < maxGrantedMessages) {
         // We have not buffered enough messages. Note that this can only
-        // happen if this message is new and that every inactive message
-        // has the same sender as one of the active messages.
-        assert(newMessage);
+        // happen if every inactive message has the same sender as one of
+        // the active messages (or the degree of overcommitment was just
+        // raised and this message hasn't been activated yet).
         adjustSchedulingPrecedence(message);
     } else if (message->compareTo(activeMessages.back()) < 0) {
         // This message should replace the "worst" active message.
@@ -2368,4 +2413,134 @@ HomaTransport::dataPacketArrive(ScheduledMessage* scheduledMessage)
     }
 }
 
+/**
+ * Choose the best inactive message that could be activated: the one with the
+ * fewest remaining bytes (SRPT) among those whose sender has no active
+ * message (we only grant one message per sender at a time).
+ *
+ * \return
+ *      The chosen message, or NULL if there is no eligible message.
+ */
+HomaTransport::ScheduledMessage*
+HomaTransport::pickInactiveMessage()
+{
+    ScheduledMessage* best = NULL;
+    for (ScheduledMessage& message : inactiveMessages) {
+        if (best != NULL && best->compareTo(message) <= 0) {
+            continue;
+        }
+
+        // Make sure the candidate doesn't have the same sender as any of
+        // the active messages.
+        bool senderConflict = false;
+        for (ScheduledMessage& active : activeMessages) {
+            if (active.senderHash == message.senderHash) {
+                senderConflict = true;
+                break;
+            }
+        }
+        if (!senderConflict) {
+            best = &message;
+        }
+    }
+    return best;
+}
+
+/**
+ * Move inactive messages to the active message list, in SRPT order, until
+ * either the list holds #maxGrantedMessages messages or there are no more
+ * eligible messages. Invoked after the degree of overcommitment is raised.
+ * Grants for the newly activated messages are issued as their next data
+ * packets arrive.
+ */
+void
+HomaTransport::activateInactiveMessages()
+{
+    while (activeMessages.size() < maxGrantedMessages) {
+        ScheduledMessage* message = pickInactiveMessage();
+        if (message == NULL) {
+            break;
+        }
+        adjustSchedulingPrecedence(message);
+    }
+}
+
+/**
+ * Account for an incoming packet in the model of our downlink that drives
+ * dynamic adjustment of the degree of overcommitment.
+ *
+ * \param length
+ *      Total # bytes in the packet.
+ * \param time
+ *      Cycles::rdtsc time when the packet was received.
+ */
+void
+HomaTransport::recordIncomingBytes(uint32_t length, uint64_t time)
+{
+    QueueEstimator::TransmitQueueState rxQueueState;
+    rxQueueEstimator.packetQueued(length, time, &rxQueueState);
+    if (rxQueueState.outstandingBytes > rxMaxQueuedBytes) {
+        rxMaxQueuedBytes = rxQueueState.outstandingBytes;
+    }
+
+    // Idle time only counts as wasted if there was a granted message that
+    // could have been using the link. The idle period may have started
+    // before the last adjustment; only count the part since then.
+    if (!activeMessages.empty()) {
+        rxIdleCycles += std::min(rxQueueState.idleTime,
+                time - std::min(time, lastOvercommitmentAdjustment));
+    }
+}
+
+/**
+ * Adjust the degree of overcommitment (#maxGrantedMessages) based on what
+ * the downlink experienced since the last call. If the link was idle for a
+ * significant fraction of the interval while messages were waiting to be
+ * granted, some senders must be slow to respond to our grants, so we
+ * grant more messages concurrently. If instead incoming packets piled up
+ * by more than one RTT's worth of bytes, too many senders are transmitting
+ * at once and data is queueing in the network (which delays the short
+ * messages that SRPT is trying to favor), so we grant fewer. The value only
+ * moves one step per interval, which keeps it from oscillating.
+ *
+ * \param now
+ *      Current time, in Cycles::rdtsc ticks.
+ */
+void
+HomaTransport::adjustOvercommitment(uint64_t now)
+{
+    uint64_t interval = now - std::min(now, lastOvercommitmentAdjustment);
+    lastOvercommitmentAdjustment = now;
+    if (interval == 0) {
+        return;
+    }
+
+    // Bring the idle time up to date, in case the link has been idle since
+    // the last packet arrived.
+    if (!activeMessages.empty() && (rxQueueEstimator.getQueueSize(now) == 0)) {
+        rxIdleCycles += std::min(interval,
+                now - std::max(rxQueueEstimator.idleSince, now - interval));
+    }
+
+    uint32_t oldDegree = maxGrantedMessages;
+    if ((rxIdleCycles * 10 > interval) && !inactiveMessages.empty()
+            && (maxGrantedMessages < maxDegreeOC)) {
+        maxGrantedMessages++;
+        activateInactiveMessages();
+    } else if ((rxMaxQueuedBytes > roundTripBytes)
+            && (maxGrantedMessages > minDegreeOC)) {
+        // Active messages in excess of the new limit are dropped as they
+        // become fully granted (see replaceActiveMessage).
+        maxGrantedMessages--;
+    }
+    if (maxGrantedMessages != oldDegree) {
+        timeTrace("degree of overcommitment changed from %u to %u, idle "
+                "cycles %u, max queued bytes %u", oldDegree,
+                maxGrantedMessages, rxIdleCycles,
+                rxMaxQueuedBytes);
+    }
+    rxIdleCycles = 0;
+    rxMaxQueuedBytes = 0;
+}
+
 }  // namespace RAMCloud
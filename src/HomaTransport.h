@@ -30,6 +30,7 @@
 #include "Cycles.h"
 #include "Dispatch.h"
 #include "Driver.h"
+#include "QueueEstimator.h"
 #include "ServerRpcPool.h"
 #include "ServiceLocator.h"
 #include "Transport.h"
@@ -698,6 +699,8 @@ class HomaTransport : public Transport {
     uint32_t getRoundTripBytes(const ServiceLocator* locator);
     uint32_t getOvercommitmentDegree(const ServiceLocator* locator,
             int numSchedPrio);
+    void getOvercommitmentRange(const ServiceLocator* locator,
+            uint32_t degreeOC, uint32_t* minDegree, uint32_t* maxDegree);
     void getUnschedPriorities(const ServiceLocator* locator, int* lowest,
             int* highest);
     vector<uint32_t> getUnschedPrioCutoffs(const ServiceLocator* locator,
@@ -717,6 +720,10 @@ class HomaTransport : public Transport {
     void replaceActiveMessage(ScheduledMessage* oldMessage,
             ScheduledMessage* newMessage);
     void dataPacketArrive(ScheduledMessage* message);
+    void activateInactiveMessages();
+    ScheduledMessage* pickInactiveMessage();
+    void recordIncomingBytes(uint32_t length, uint64_t time);
+    void adjustOvercommitment(uint64_t now);
 
     /// Shared RAMCloud information.
     Context* context;
@@ -903,8 +910,36 @@ class HomaTransport : public Transport {
 
     /// Maximum # incoming messages that can be actively granted by the
     /// receiver. Or, the "degree of overcommitment" in the Homa paper.
+    /// If #minDegreeOC < #maxDegreeOC, this value is adjusted dynamically
+    /// by adjustOvercommitment.
     uint32_t maxGrantedMessages;
 
+    /// Lower and upper bounds on #maxGrantedMessages when the degree of
+    /// overcommitment is adjusted dynamically (the "minDegreeOC" and
+    /// "maxDegreeOC" configuration options). Equal values (the default)
+    /// keep the degree of overcommitment fixed.
+    uint32_t minDegreeOC;
+    uint32_t maxDegreeOC;
+
+    /// Models the queue of incoming bytes at our downlink: every packet
+    /// we receive is "queued" at the time it arrives and drained at the
+    /// link bandwidth. A backlog means packets are arriving faster than
+    /// the link can deliver them (i.e. they were queued in the network);
+    /// idle time means the link went unused.
+    QueueEstimator rxQueueEstimator;
+
+    /// Total rdtsc ticks, since the last call to adjustOvercommitment, for
+    /// which the downlink was idle even though some granted message was
+    /// waiting for data.
+    uint64_t rxIdleCycles;
+
+    /// Largest backlog (in bytes) observed by #rxQueueEstimator since the
+    /// last call to adjustOvercommitment.
+    uint32_t rxMaxQueuedBytes;
+
+    /// Cycles::rdtsc time of the last call to adjustOvercommitment.
+    uint64_t lastOvercommitmentAdjustment;
+
     DISALLOW_COPY_AND_ASSIGN(HomaTransport);
 };
 
@@ -260,6 +260,34 @@ TEST_F(HomaTransportTest, getOvercommitmentDegree) {
     ServiceLocator locator2("mock:degreeOC=3");
     EXPECT_EQ(3u, transport.getOvercommitmentDegree(&locator2, 7));
 }
+TEST_F(HomaTransportTest, getOvercommitmentRange) {
+    uint32_t minDegree, maxDegree;
+    // No options: static degree of overcommitment.
+    transport.getOvercommitmentRange(NULL, 4, &minDegree, &maxDegree);
+    EXPECT_EQ(4u, minDegree);
+    EXPECT_EQ(4u, maxDegree);
+    // Good values.
+    ServiceLocator locator1("mock:minDegreeOC=2,maxDegreeOC=8");
+    transport.getOvercommitmentRange(&locator1, 4, &minDegree, &maxDegree);
+    EXPECT_EQ(2u, minDegree);
+    EXPECT_EQ(8u, maxDegree);
+    // Range must include the initial value.
+    ServiceLocator locator2("mock:minDegreeOC=6,maxDegreeOC=3");
+    transport.getOvercommitmentRange(&locator2, 4, &minDegree, &maxDegree);
+    EXPECT_EQ(4u, minDegree);
+    EXPECT_EQ(4u, maxDegree);
+    // Bad values.
+    TestLog::reset();
+    ServiceLocator locator3("mock:minDegreeOC=0,maxDegreeOC=-1");
+    transport.getOvercommitmentRange(&locator3, 4, &minDegree, &maxDegree);
+    EXPECT_EQ(4u, minDegree);
+    EXPECT_EQ(4u, maxDegree);
+    EXPECT_EQ("getOvercommitmentRange: Bad HomaTransport minDegreeOC option "
+            "value '0' (expected positive integer); ignoring option | "
+            "getOvercommitmentRange: Bad HomaTransport maxDegreeOC option "
+            "value '-1' (expected positive integer); ignoring option",
+            TestLog::get());
+}
 TEST_F(HomaTransportTest, getUnschedPriorities) {
     int lowest, highest;
     EXPECT_EQ(7, driver->getHighestPacketPriority());
@@ -1810,4 +1838,151 @@ TEST_F(HomaTransportTest, dataPacketArrive) {
     EXPECT_EQ(3u, transport.messagesToGrant.size());
 }
 
+TEST_F(HomaTransportTest, replaceActiveMessage_degreeLowered) {
+    transport.roundTripBytes = 100;
+    transport.maxDataPerPacket = 5;
+    transport.grantIncrement = 5;
+    transport.maxGrantedMessages = 2;
+    uint32_t unscheduledBytes = transport.roundTripBytes;
+
+    handlePacket("mock:client=1",
+            HomaTransport::DataHeader(HomaTransport::RpcId(100, 101), 150, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m1 = getServerRpc(
+            HomaTransport::RpcId(100, 101))->scheduledMessage.get();
+    handlePacket("mock:client=2",
+            HomaTransport::DataHeader(HomaTransport::RpcId(101, 102), 200, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    handlePacket("mock:client=3",
+            HomaTransport::DataHeader(HomaTransport::RpcId(102, 103), 250, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m3 = getServerRpc(
+            HomaTransport::RpcId(102, 103))->scheduledMessage.get();
+    EXPECT_EQ(2u, transport.activeMessages.size());
+    EXPECT_EQ(HomaTransport::ScheduledMessage::INACTIVE, m3->state);
+
+    // Once the limit drops, a fully granted message is not replaced.
+    transport.maxGrantedMessages = 1;
+    m1->grantOffset = ~0u;
+    transport.replaceActiveMessage(m1, NULL);
+    EXPECT_EQ(1u, transport.activeMessages.size());
+    EXPECT_EQ(HomaTransport::ScheduledMessage::INACTIVE, m3->state);
+}
+TEST_F(HomaTransportTest, activateInactiveMessages) {
+    transport.roundTripBytes = 100;
+    transport.maxDataPerPacket = 5;
+    transport.grantIncrement = 5;
+    transport.maxGrantedMessages = 1;
+    uint32_t unscheduledBytes = transport.roundTripBytes;
+
+    handlePacket("mock:client=1",
+            HomaTransport::DataHeader(HomaTransport::RpcId(100, 101), 150, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    // m2 is from the same sender as m1, so it can't be activated.
+    handlePacket("mock:client=1",
+            HomaTransport::DataHeader(HomaTransport::RpcId(100, 102), 160, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m2 = getServerRpc(
+            HomaTransport::RpcId(100, 102))->scheduledMessage.get();
+    handlePacket("mock:client=2",
+            HomaTransport::DataHeader(HomaTransport::RpcId(101, 103), 300, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m3 = getServerRpc(
+            HomaTransport::RpcId(101, 103))->scheduledMessage.get();
+    handlePacket("mock:client=3",
+            HomaTransport::DataHeader(HomaTransport::RpcId(102, 104), 200, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m4 = getServerRpc(
+            HomaTransport::RpcId(102, 104))->scheduledMessage.get();
+    EXPECT_EQ(1u, transport.activeMessages.size());
+    EXPECT_EQ(3u, transport.inactiveMessages.size());
+
+    // Raising the limit by one activates the shortest eligible message.
+    transport.maxGrantedMessages = 2;
+    transport.activateInactiveMessages();
+    EXPECT_EQ(2u, transport.activeMessages.size());
+    EXPECT_EQ(HomaTransport::ScheduledMessage::ACTIVE, m4->state);
+    EXPECT_EQ(HomaTransport::ScheduledMessage::INACTIVE, m3->state);
+
+    // Only messages from distinct senders are activated.
+    transport.maxGrantedMessages = 10;
+    transport.activateInactiveMessages();
+    EXPECT_EQ(3u, transport.activeMessages.size());
+    EXPECT_EQ(HomaTransport::ScheduledMessage::ACTIVE, m3->state);
+    EXPECT_EQ(HomaTransport::ScheduledMessage::INACTIVE, m2->state);
+    EXPECT_EQ(&transport.activeMessages.back(), m3);
+}
+TEST_F(HomaTransportTest, recordIncomingBytes) {
+    transport.rxQueueEstimator.bandwidth = 1.0;
+    transport.recordIncomingBytes(100, 1000);
+    EXPECT_EQ(0u, transport.rxMaxQueuedBytes);
+    // Idle time doesn't count when there's nothing granted.
+    EXPECT_EQ(0u, transport.rxIdleCycles);
+
+    // Packets arriving faster than the link drains them build a backlog.
+    transport.recordIncomingBytes(100, 1050);
+    EXPECT_EQ(50u, transport.rxMaxQueuedBytes);
+    transport.recordIncomingBytes(100, 1300);
+    EXPECT_EQ(50u, transport.rxMaxQueuedBytes);
+
+    // Idle time counts once there is an active message.
+    transport.roundTripBytes = 100;
+    transport.maxDataPerPacket = 5;
+    transport.grantIncrement = 5;
+    handlePacket("mock:client=1",
+            HomaTransport::DataHeader(HomaTransport::RpcId(100, 101), 150, 0,
+            100, HomaTransport::FROM_CLIENT), "abcde");
+    EXPECT_EQ(1u, transport.activeMessages.size());
+    transport.recordIncomingBytes(100, 1600);
+    EXPECT_EQ(200u, transport.rxIdleCycles);
+}
+TEST_F(HomaTransportTest, adjustOvercommitment) {
+    transport.roundTripBytes = 100;
+    transport.maxDataPerPacket = 5;
+    transport.grantIncrement = 5;
+    transport.maxGrantedMessages = 1;
+    transport.minDegreeOC = 1;
+    transport.maxDegreeOC = 2;
+    transport.rxQueueEstimator.bandwidth = 1.0;
+    transport.lastOvercommitmentAdjustment = 1000;
+    uint32_t unscheduledBytes = transport.roundTripBytes;
+
+    handlePacket("mock:client=1",
+            HomaTransport::DataHeader(HomaTransport::RpcId(100, 101), 150, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    handlePacket("mock:client=2",
+            HomaTransport::DataHeader(HomaTransport::RpcId(101, 102), 200, 0,
+            unscheduledBytes, HomaTransport::FROM_CLIENT), "abcde");
+    HomaTransport::ScheduledMessage* m2 = getServerRpc(
+            HomaTransport::RpcId(101, 102))->scheduledMessage.get();
+    EXPECT_EQ(HomaTransport::ScheduledMessage::INACTIVE, m2->state);
+
+    // The link was idle most of the interval: grant one more message.
+    transport.rxIdleCycles = 500;
+    transport.adjustOvercommitment(2000);
+    EXPECT_EQ(2u, transport.maxGrantedMessages);
+    EXPECT_EQ(HomaTransport::ScheduledMessage::ACTIVE, m2->state);
+    EXPECT_EQ(0u, transport.rxIdleCycles);
+    EXPECT_EQ(2000u, transport.lastOvercommitmentAdjustment);
+
+    // Never beyond maxDegreeOC.
+    transport.rxIdleCycles = 500;
+    transport.rxQueueEstimator.setQueueSize(10, 3000);
+    transport.adjustOvercommitment(3000);
+    EXPECT_EQ(2u, transport.maxGrantedMessages);
+
+    // Too much data queued in the network: back off.
+    transport.rxMaxQueuedBytes = 101;
+    transport.rxQueueEstimator.setQueueSize(10, 4000);
+    transport.adjustOvercommitment(4000);
+    EXPECT_EQ(1u, transport.maxGrantedMessages);
+    EXPECT_EQ(0u, transport.rxMaxQueuedBytes);
+
+    // Never below minDegreeOC.
+    transport.rxMaxQueuedBytes = 101;
+    transport.rxQueueEstimator.setQueueSize(10, 5000);
+    transport.adjustOvercommitment(5000);
+    EXPECT_EQ(1u, transport.maxGrantedMessages);
+}
+
 }  // namespace RAMCloud
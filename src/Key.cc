@@ -17,6 +17,7 @@
 #include "Key.h"
 #include "MurmurHash3.h"
 #include "Object.h"
+#include "ObjectChunk.h"
 #include "StringUtil.h"
 
 namespace RAMCloud {
@@ -24,7 +25,7 @@ namespace RAMCloud {
 /**
  * Construct a new key object by extracting the appropriate fields from a
  * log entry. Use this method when obtaining the key from a serialized
- * object or tombstone in the log.
+ * object, tombstone, chunked object manifest or object chunk in the log.
  *
  * \param type
  *      The log entry type of this entry, as indicated by the log or segment
@@ -43,7 +44,9 @@ Key::Key(LogEntryType type, Buffer& buffer)
       keyLength(0),
       hash()
 {
-    if (type == LOG_ENTRY_TYPE_OBJ) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+            type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
+        // Combined entries start with the object, so its keys parse the same.
         Object object(buffer);
         tableId = object.getTableId();
         keyLength = object.getKeyLength();
@@ -55,6 +58,12 @@ Key::Key(LogEntryType type, Buffer& buffer)
         keyLength = tomb.getKeyLength();
         key = tomb.getKey();
 
+    } else if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+        ObjectChunk chunk(buffer);
+        tableId = chunk.getTableId();
+        keyLength = chunk.getKeyLength();
+        key = chunk.getKey();
+
     } else {
         throw FatalError(HERE, "unknown Log::Entry type %d", type);
     }
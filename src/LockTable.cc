@@ -15,7 +15,9 @@
 
 #include "LockTable.h"
 #include "BitOps.h"
+#include "Cycles.h"
 #include "Memory.h"
+#include "PerfStats.h"
 #include "PreparedOp.h"
 
 namespace RAMCloud {
@@ -30,13 +32,25 @@ namespace RAMCloud {
  *      memory but will also improve common case performance.
  * \param log
  *      Contains all objects that represent locks managed by this LockTable.
+ * \param maxWaitUs
+ *      Longest time, in microseconds, that admit() lets a transaction wait
+ *      for a lock.  0 (the default) means transactions never wait.
+ * \param maxWaiters
+ *      Largest number of transactions that may wait for one lock at once.
+ *      0 (the default) means transactions never wait.
  */
-LockTable::LockTable(uint64_t numEntries, Log& log)
+LockTable::LockTable(uint64_t numEntries, Log& log, uint32_t maxWaitUs,
+                     uint32_t maxWaiters)
     : bucketIndexHashMask(
             BitOps::powerOfTwoGreaterOrEqual(
                     numEntries / (ENTRIES_PER_CACHE_LINE - 1)) - 1)
     , buckets()
     , log(log)
+    , maxWaitCycles(maxWaiters == 0 ? 0 :
+            Cycles::fromMicroseconds(maxWaitUs))
+    , maxWaiters(maxWaiters)
+    , waitMutex("LockTable::waitMutex")
+    , waitQueues()
 {
     void *buf  = Memory::xmemalign(
             HERE,
@@ -81,17 +95,155 @@ LockTable::acquireLock(Key& key, Log::Reference lockObjectRef)
         continue;
 }
 
+/**
+ * Decide whether a transaction that wants to prepare an operation on a key
+ * may acquire the key's lock, should wait for it, or must abort.  See
+ * \ref waiting "Waiting for Locks" for the policy.  The caller must call
+ * tryAcquireLock after a PROCEED outcome, and should prevent other threads
+ * from acquiring the same lock in between (e.g. by holding the object's
+ * HashTableBucketLock).
+ *
+ * \param key
+ *      The key whose lock the transaction wants.
+ * \param txId
+ *      Identifies the transaction.  A transaction that was told to WAIT must
+ *      come back with the same TransactionId to keep its place.
+ * \return
+ *      See LockTable::Admission.
+ */
+LockTable::Admission
+LockTable::admit(Key& key, TransactionId txId)
+{
+    TransactionId holder(0, 0);
+    bool locked = isLockAcquired(key, &holder);
+
+    if (maxWaitCycles == 0) {
+        if (locked) {
+            PerfStats::threadStats.txLockConflicts++;
+            PerfStats::threadStats.txLockAborts++;
+            return ABORT;
+        }
+        return PROCEED;
+    }
+
+    std::lock_guard<SpinLock> lock(waitMutex);
+    WaitQueue* queue = findWaitQueue(key);
+    if (queue == NULL) {
+        if (!locked)
+            return PROCEED;
+        queue = createWaitQueue(key);
+    }
+
+    // Find this transaction's place in the queue, noting which of the
+    // transactions ahead of it are still waiting.
+    uint64_t now = Cycles::rdtsc();
+    std::deque<Waiter>& waiters = queue->waiters;
+    bool waitersAhead = false;
+    bool olderAhead = false;
+    auto self = waiters.begin();
+    for (; self != waiters.end(); ) {
+        uint64_t waited = now - self->since;
+        if (self->txId == txId)
+            break;
+        if (waited > ABANDON_FACTOR * maxWaitCycles) {
+            self = waiters.erase(self);
+            continue;
+        }
+        if (waited <= maxWaitCycles) {
+            waitersAhead = true;
+            if (isOlder(self->txId, txId))
+                olderAhead = true;
+        }
+        ++self;
+    }
+    bool queued = (self != waiters.end());
+
+    Contention& contention = queue->contention;
+    if (queued && now - self->since > maxWaitCycles) {
+        contention.timeouts++;
+        PerfStats::threadStats.txLockAborts++;
+        waiters.erase(self);
+        return ABORT;
+    }
+
+    if (!locked && !waitersAhead) {
+        if (queued) {
+            uint64_t waited = now - self->since;
+            contention.grants++;
+            contention.waitCycles += waited;
+            PerfStats::threadStats.txLockWaitCycles += waited;
+            waiters.erase(self);
+        }
+        return PROCEED;
+    }
+
+    if (!queued) {
+        contention.conflicts++;
+        PerfStats::threadStats.txLockConflicts++;
+    }
+
+    // The transaction can't have the lock yet.  It may only wait for
+    // younger transactions; otherwise waits could form a cycle.
+    if ((locked && isOlder(holder, txId)) || olderAhead) {
+        if (queued)
+            waiters.erase(self);
+        contention.yields++;
+        PerfStats::threadStats.txLockAborts++;
+        return ABORT;
+    }
+
+    if (!queued) {
+        if (waiters.size() >= maxWaiters) {
+            contention.yields++;
+            PerfStats::threadStats.txLockAborts++;
+            RAMCLOUD_CLOG(NOTICE, "Wait queue for lock on key %s is full "
+                    "(%lu conflicts so far); aborting prepare",
+                    key.toString().c_str(), contention.conflicts);
+            return ABORT;
+        }
+        waiters.emplace_back(txId, now);
+    }
+    contention.waits++;
+    PerfStats::threadStats.txLockWaits++;
+    return WAIT;
+}
+
+/**
+ * Return the contention counters accumulated for a key.
+ *
+ * \param key
+ *      The key whose counters are wanted.
+ * \param[out] contention
+ *      Filled in with the counters, if any.
+ * \return
+ *      True if counters were found.  False means the lock for the key hasn't
+ *      been contended since waiting was enabled (or not recently enough).
+ */
+bool
+LockTable::getContention(Key& key, Contention* contention)
+{
+    std::lock_guard<SpinLock> lock(waitMutex);
+    WaitQueue* queue = findWaitQueue(key);
+    if (queue == NULL)
+        return false;
+    *contention = queue->contention;
+    return true;
+}
+
 /**
  * Check if lock with the provided key is currently acquired.
  *
  * \param key
  *      The key whose "locked" status should be checked.
+ * \param[out] holder
+ *      If non-NULL and the lock is acquired, the transaction holding it is
+ *      returned here.
  *
  * \return
  *      TRUE if the lock is currently acquired, FALSE otherwise.
  */
 bool
-LockTable::isLockAcquired(Key& key)
+LockTable::isLockAcquired(Key& key, TransactionId* holder)
 {
     // Find the right bucket.
     uint64_t bucketIndex = (key.getHash() & bucketIndexHashMask);
@@ -108,6 +260,14 @@ LockTable::isLockAcquired(Key& key)
     while (true) {
         for (; entryIndex < ENTRIES_PER_CACHE_LINE; entryIndex++) {
             if (keysMatch(key, cacheLine->entries[entryIndex])) {
+                if (holder != NULL) {
+                    Buffer buffer;
+                    log.getEntry(Log::Reference(
+                            cacheLine->entries[entryIndex]), buffer);
+                    PreparedOp prepOp(buffer, 0, buffer.size());
+                    *holder = TransactionId(prepOp.header.clientId,
+                                            prepOp.header.clientTxId);
+                }
                 return true;
             }
         }
@@ -237,6 +397,53 @@ LockTable::tryAcquireLock(Key& key, Log::Reference lockObjectRef)
     return true;
 }
 
+/**
+ * Return the wait queue for a key, or NULL if there is none.  The caller
+ * must hold #waitMutex.
+ */
+LockTable::WaitQueue*
+LockTable::findWaitQueue(Key& key)
+{
+    auto range = waitQueues.equal_range(key.getHash());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.matches(key))
+            return &it->second;
+    }
+    return NULL;
+}
+
+/**
+ * Create an empty wait queue for a key, first discarding idle queues if
+ * there are too many.  The caller must hold #waitMutex.
+ */
+LockTable::WaitQueue*
+LockTable::createWaitQueue(Key& key)
+{
+    if (waitQueues.size() >= MAX_WAIT_QUEUES) {
+        for (auto it = waitQueues.begin(); it != waitQueues.end(); ) {
+            if (it->second.waiters.empty())
+                it = waitQueues.erase(it);
+            else
+                ++it;
+        }
+    }
+    auto it = waitQueues.emplace(key.getHash(), WaitQueue(key));
+    return &it->second;
+}
+
+/**
+ * Return true if transaction \a a is older than transaction \a b.  Client
+ * lease ids are handed out in increasing order, as are the transaction ids
+ * of each client, so the pair orders transactions roughly by age.
+ */
+bool
+LockTable::isOlder(TransactionId a, TransactionId b)
+{
+    if (a.clientLeaseId != b.clientLeaseId)
+        return a.clientLeaseId < b.clientLeaseId;
+    return a.clientTransactionId < b.clientTransactionId;
+}
+
 /**
  * Return TRUE if the given key matches the key in the referenced lock object;
  * FALSE otherwise.
@@ -16,11 +16,16 @@
 #ifndef RAMCLOUD_LOCKTABLE_H
 #define RAMCLOUD_LOCKTABLE_H
 
+#include <deque>
+#include <unordered_map>
+
 #include "Common.h"
 
 #include "Atomic.h"
 #include "Fence.h"
 #include "Log.h"
+#include "SpinLock.h"
+#include "TransactionId.h"
 
 namespace RAMCloud {
 
@@ -70,14 +75,78 @@ namespace RAMCloud {
  * For best performance, the number of buckets should be set large enough so
  * that overflow cache lines are almost never needed but small enough that the
  * entire structure might fit in CPU cache.
+ *
+ * \section waiting Waiting for Locks
+ *
+ * Transaction prepares ask admit() before acquiring a lock.  By default a
+ * prepare that finds the key locked is told to abort.  If a maximum wait time
+ * is configured, the prepare may instead be told to WAIT: it is placed in a
+ * bounded FIFO queue for the key, and is expected to come back (the master
+ * asks the client to retry the prepare after a short delay) until it reaches
+ * the front of the queue and the lock is free, or until the wait time runs
+ * out.  Waiting is only allowed for transactions older than the lock holder
+ * and everything queued ahead of them (the "wait-die" variant of wound-wait
+ * ordering on TransactionId): a lock holder has already voted, so it can't be
+ * wounded, and a younger transaction that conflicts aborts right away.  Since
+ * every wait is for a younger transaction, waits can't form a cycle across
+ * masters.
+ *
+ * Each key with a wait queue also accumulates Contention counters, so that
+ * hot keys can be identified; the same events are counted in PerfStats.
  */
 class LockTable {
   PUBLIC:
-    LockTable(uint64_t numEntries, Log& log);
+    /// Outcome of admit().
+    enum Admission {
+        /// The caller may acquire the lock now.
+        PROCEED,
+        /// The caller should try again after a short delay; it keeps its
+        /// place in the key's wait queue.
+        WAIT,
+        /// The caller must give up on the lock (the transaction votes to
+        /// abort).
+        ABORT
+    };
+
+    /**
+     * Counters describing how contended the lock for a particular key has
+     * been.  Returned by getContention().
+     */
+    struct Contention {
+        Contention()
+            : conflicts(0)
+            , waits(0)
+            , yields(0)
+            , timeouts(0)
+            , grants(0)
+            , waitCycles(0)
+        {}
+
+        /// Number of prepares that found the key locked or other prepares
+        /// waiting for it.
+        uint64_t conflicts;
+        /// Number of WAIT outcomes.
+        uint64_t waits;
+        /// Number of conflicting prepares that aborted without waiting,
+        /// because an older transaction was ahead of them or the queue was
+        /// full.
+        uint64_t yields;
+        /// Number of prepares that aborted after waiting too long.
+        uint64_t timeouts;
+        /// Number of prepares that acquired the lock after waiting.
+        uint64_t grants;
+        /// Total time (in cycles) waited by the prepares in #grants.
+        uint64_t waitCycles;
+    };
+
+    LockTable(uint64_t numEntries, Log& log, uint32_t maxWaitUs = 0,
+              uint32_t maxWaiters = 0);
     virtual ~LockTable();
 
     void acquireLock(Key& key, Log::Reference lockObjectRef);
-    bool isLockAcquired(Key& key);
+    Admission admit(Key& key, TransactionId txId);
+    bool getContention(Key& key, Contention* contention);
+    bool isLockAcquired(Key& key, TransactionId* holder = NULL);
     bool releaseLock(Key& key, Log::Reference lockObjectRef);
     bool tryAcquireLock(Key& key, Log::Reference lockObjectRef);
 
@@ -198,6 +267,73 @@ class LockTable {
 
     bool keysMatch(Key& key, Entry lockObjectRef);
 
+    /**
+     * A transaction waiting for the lock on a key.
+     */
+    struct Waiter {
+        Waiter(TransactionId txId, uint64_t since)
+            : txId(txId)
+            , since(since)
+        {}
+
+        /// Identifies the waiting transaction.
+        TransactionId txId;
+        /// Cycles::rdtsc() when the transaction started waiting.
+        uint64_t since;
+    };
+
+    /**
+     * The waiters and contention counters for one key.
+     */
+    struct WaitQueue {
+        explicit WaitQueue(Key& key)
+            : tableId(key.getTableId())
+            , key(static_cast<const char*>(key.getStringKey()),
+                  key.getStringKeyLength())
+            , waiters()
+            , contention()
+        {}
+
+        bool matches(Key& other) const {
+            return tableId == other.getTableId() &&
+                   key.size() == other.getStringKeyLength() &&
+                   memcmp(key.data(), other.getStringKey(), key.size()) == 0;
+        }
+
+        uint64_t tableId;
+        string key;
+        /// Transactions waiting for the lock, in the order they arrived.
+        std::deque<Waiter> waiters;
+        Contention contention;
+    };
+
+    typedef std::unordered_multimap<KeyHash, WaitQueue> WaitQueueMap;
+
+    /// Wait queues are kept for at most this many keys; queues with no
+    /// waiters are discarded (along with their counters) to make room.
+    static const size_t MAX_WAIT_QUEUES = 1024;
+
+    /// A waiter that hasn't come back for this many times the maximum wait
+    /// time is assumed to have given up and is dropped from its queue.
+    static const uint64_t ABANDON_FACTOR = 4;
+
+    WaitQueue* findWaitQueue(Key& key);
+    WaitQueue* createWaitQueue(Key& key);
+    static bool isOlder(TransactionId a, TransactionId b);
+
+    /// Longest time (in cycles) a prepare may wait for a lock; 0 means
+    /// conflicting prepares abort right away.
+    const uint64_t maxWaitCycles;
+
+    /// Largest number of prepares that may wait for one key at once.
+    const uint32_t maxWaiters;
+
+    /// Protects #waitQueues.
+    SpinLock waitMutex;
+
+    /// Wait queues and contention counters of recently contended keys.
+    WaitQueueMap waitQueues;
+
     DISALLOW_COPY_AND_ASSIGN(LockTable);
 };
 
@@ -70,12 +70,13 @@ class LockTableTest : public ::testing::Test {
     ~LockTableTest()
     {}
 
-    Log::Reference addPreparedOp(Key& key, Log& log) {
+    Log::Reference addPreparedOp(Key& key, Log& log, uint64_t clientId = 1,
+                                 uint64_t clientTxId = 1) {
         Buffer buffer;
         Buffer logBuffer;
         Log::Reference ref;
-        PreparedOp prepOp(WireFormat::TxPrepare::READ, 1, 1, 1, key, NULL,
-                0, 0, 0, buffer);
+        PreparedOp prepOp(WireFormat::TxPrepare::READ, clientId, clientTxId,
+                1, key, NULL, 0, 0, 0, buffer);
         prepOp.assembleForLog(logBuffer);
         log.append(LOG_ENTRY_TYPE_PREP, logBuffer, &ref);
         return ref;
@@ -129,6 +130,126 @@ TEST_F(LockTableTest, acquireLock) {
     EXPECT_EQ(ref.toInteger(), lockTable.buckets[0].entries[1]);
 }
 
+TEST_F(LockTableTest, admit_noWaiting) {
+    Key key(12, "blah", 4);
+    TransactionId older(1, 1);
+    EXPECT_EQ(LockTable::PROCEED, lockTable.admit(key, older));
+    lockTable.acquireLock(key, addPreparedOp(key, lockTable.log, 5, 5));
+    EXPECT_EQ(LockTable::ABORT, lockTable.admit(key, older));
+    EXPECT_EQ(0u, lockTable.waitQueues.size());
+}
+
+TEST_F(LockTableTest, admit_waitThenProceed) {
+    LockTable lt(1, l, 1000, 2);
+    Key key(12, "blah", 4);
+    TransactionId older(1, 1);
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, older));
+    EXPECT_EQ(0u, lt.waitQueues.size());
+
+    Log::Reference ref = addPreparedOp(key, l, 5, 5);
+    lt.acquireLock(key, ref);
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, older));
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, older));
+    lt.releaseLock(key, ref);
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, older));
+
+    LockTable::Contention contention;
+    EXPECT_TRUE(lt.getContention(key, &contention));
+    EXPECT_EQ(1u, contention.conflicts);
+    EXPECT_EQ(2u, contention.waits);
+    EXPECT_EQ(1u, contention.grants);
+    EXPECT_EQ(0u, contention.yields);
+    EXPECT_LT(0u, contention.waitCycles);
+    EXPECT_EQ(0u, lt.findWaitQueue(key)->waiters.size());
+}
+
+TEST_F(LockTableTest, admit_youngerAborts) {
+    LockTable lt(1, l, 1000, 2);
+    Key key(12, "blah", 4);
+    lt.acquireLock(key, addPreparedOp(key, l, 5, 5));
+    EXPECT_EQ(LockTable::ABORT, lt.admit(key, TransactionId(5, 6)));
+    EXPECT_EQ(LockTable::ABORT, lt.admit(key, TransactionId(6, 1)));
+
+    LockTable::Contention contention;
+    EXPECT_TRUE(lt.getContention(key, &contention));
+    EXPECT_EQ(2u, contention.conflicts);
+    EXPECT_EQ(2u, contention.yields);
+    EXPECT_EQ(0u, lt.findWaitQueue(key)->waiters.size());
+}
+
+TEST_F(LockTableTest, admit_queueOrder) {
+    LockTable lt(1, l, 1000, 4);
+    Key key(12, "blah", 4);
+    Log::Reference ref = addPreparedOp(key, l, 9, 9);
+    lt.acquireLock(key, ref);
+
+    // Older transactions may wait behind younger ones, but not vice versa.
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(5, 5)));
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(3, 3)));
+    EXPECT_EQ(LockTable::ABORT, lt.admit(key, TransactionId(7, 7)));
+
+    // The lock goes to the front of the queue.
+    lt.releaseLock(key, ref);
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(3, 3)));
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, TransactionId(5, 5)));
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, TransactionId(3, 3)));
+}
+
+TEST_F(LockTableTest, admit_queueFull) {
+    LockTable lt(1, l, 1000, 1);
+    Key key(12, "blah", 4);
+    lt.acquireLock(key, addPreparedOp(key, l, 9, 9));
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(5, 5)));
+    EXPECT_EQ(LockTable::ABORT, lt.admit(key, TransactionId(3, 3)));
+    EXPECT_EQ(1u, lt.findWaitQueue(key)->waiters.size());
+}
+
+TEST_F(LockTableTest, admit_timeout) {
+    LockTable lt(1, l, 1000, 2);
+    Key key(12, "blah", 4);
+    lt.acquireLock(key, addPreparedOp(key, l, 9, 9));
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(5, 5)));
+    lt.findWaitQueue(key)->waiters.front().since -= 2 * lt.maxWaitCycles;
+    EXPECT_EQ(LockTable::ABORT, lt.admit(key, TransactionId(5, 5)));
+
+    LockTable::Contention contention;
+    EXPECT_TRUE(lt.getContention(key, &contention));
+    EXPECT_EQ(1u, contention.timeouts);
+    EXPECT_EQ(0u, lt.findWaitQueue(key)->waiters.size());
+}
+
+TEST_F(LockTableTest, admit_skipExpiredWaiters) {
+    LockTable lt(1, l, 1000, 4);
+    Key key(12, "blah", 4);
+    Log::Reference ref = addPreparedOp(key, l, 9, 9);
+    lt.acquireLock(key, ref);
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(5, 5)));
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(4, 4)));
+    lt.releaseLock(key, ref);
+
+    // A waiter that has timed out doesn't hold up the ones behind it; one
+    // that hasn't come back in a long time is dropped.
+    std::deque<LockTable::Waiter>& waiters = lt.findWaitQueue(key)->waiters;
+    waiters.front().since -= 2 * lt.maxWaitCycles;
+    EXPECT_EQ(LockTable::WAIT, lt.admit(key, TransactionId(3, 3)));
+    waiters.front().since -= LockTable::ABANDON_FACTOR * lt.maxWaitCycles;
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, TransactionId(4, 4)));
+    EXPECT_EQ(1u, waiters.size());
+    waiters.front().since -= 2 * LockTable::ABANDON_FACTOR * lt.maxWaitCycles;
+    EXPECT_EQ(LockTable::PROCEED, lt.admit(key, TransactionId(6, 6)));
+    EXPECT_EQ(0u, waiters.size());
+}
+
+TEST_F(LockTableTest, getContention) {
+    LockTable lt(1, l, 1000, 2);
+    Key key(12, "blah", 4);
+    LockTable::Contention contention;
+    EXPECT_FALSE(lt.getContention(key, &contention));
+    lt.createWaitQueue(key);
+    EXPECT_TRUE(lt.getContention(key, &contention));
+    EXPECT_EQ(0u, contention.conflicts);
+}
+
 TEST_F(LockTableTest, isLockAcquired_basic) {
     Key key(12, "blah", 4);
     Log::Reference ref = addPreparedOp(key, lockTable.log);
@@ -139,6 +260,15 @@ TEST_F(LockTableTest, isLockAcquired_basic) {
     EXPECT_TRUE(lockTable.isLockAcquired(key));
 }
 
+TEST_F(LockTableTest, isLockAcquired_holder) {
+    Key key(12, "blah", 4);
+    TransactionId holder(0, 0);
+    EXPECT_FALSE(lockTable.isLockAcquired(key, &holder));
+    lockTable.acquireLock(key, addPreparedOp(key, lockTable.log, 7, 8));
+    EXPECT_TRUE(lockTable.isLockAcquired(key, &holder));
+    EXPECT_EQ(TransactionId(7, 8), holder);
+}
+
 TEST_F(LockTableTest, isLockAcquired_findBucket) {
     LockTable newLockTable(4 * (LockTable::ENTRIES_PER_CACHE_LINE - 1), l);
     Key key(12, "blah", 4);
@@ -283,6 +413,31 @@ TEST_F(LockTableTest, BucketLock_unlock) {
     EXPECT_NE(1UL, (*bl).mutex.load());
 }
 
+TEST_F(LockTableTest, createWaitQueue_discardIdle) {
+    LockTable lt(1, l, 1000, 2);
+    Key busy(12, "busy", 4);
+    lt.createWaitQueue(busy)->waiters.emplace_back(TransactionId(1, 1), 0);
+    for (uint32_t i = 1; i < LockTable::MAX_WAIT_QUEUES; i++) {
+        string name = format("%u", i);
+        Key key(12, name.c_str(), downCast<uint16_t>(name.size()));
+        lt.createWaitQueue(key);
+    }
+    EXPECT_EQ(LockTable::MAX_WAIT_QUEUES, lt.waitQueues.size());
+
+    Key key(12, "blah", 4);
+    lt.createWaitQueue(key);
+    EXPECT_EQ(2u, lt.waitQueues.size());
+    EXPECT_TRUE(lt.findWaitQueue(busy) != NULL);
+    EXPECT_TRUE(lt.findWaitQueue(key) != NULL);
+}
+
+TEST_F(LockTableTest, isOlder) {
+    EXPECT_TRUE(LockTable::isOlder(TransactionId(1, 9), TransactionId(2, 1)));
+    EXPECT_TRUE(LockTable::isOlder(TransactionId(2, 1), TransactionId(2, 2)));
+    EXPECT_FALSE(LockTable::isOlder(TransactionId(2, 2), TransactionId(2, 2)));
+    EXPECT_FALSE(LockTable::isOlder(TransactionId(3, 1), TransactionId(2, 2)));
+}
+
 TEST_F(LockTableTest, keysMatch) {
     Key matchedKey(12, "match", 5);
     Key unmatchedKey(12, "unmatched", 9);
@@ -153,6 +153,7 @@ Log::getHead() {
 void
 Log::sync()
 {
+    RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::REPLICATION_SYNC);
     CycleCounter<uint64_t> __(&PerfStats::threadStats.logSyncCycles);
 
     Tub<SpinLock::Guard> lock;
@@ -220,6 +221,7 @@ Log::sync()
 void
 Log::syncTo(Log::Reference reference)
 {
+    RpcPhaseTrace::Scope phaseTrace(RpcPhaseTrace::REPLICATION_SYNC);
     CycleCounter<uint64_t> __(&PerfStats::threadStats.logSyncCycles);
     metrics.totalSyncCalls++;
 
@@ -130,6 +130,7 @@ class Log : public AbstractLog {
     friend class SideLog;
     friend class CleanerCompactionBenchmark;
     friend class ObjectManagerBenchmark;
+    friend class TableSnapshot;
 
     DISALLOW_COPY_AND_ASSIGN(Log);
 };
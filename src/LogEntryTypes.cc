@@ -50,6 +50,12 @@ toString(LogEntryType type)
         return "Transaction Decision Record";
     case LOG_ENTRY_TYPE_TXPLIST:
         return "Transaction Participant List Record";
+    case LOG_ENTRY_TYPE_OBJMANIFEST:
+        return "Chunked Object Manifest";
+    case LOG_ENTRY_TYPE_OBJCHUNK:
+        return "Object Chunk";
+    case LOG_ENTRY_TYPE_OBJRPCRESULT:
+        return "Object With Linearizable Rpc Record";
     default:
         return "<<Unknown>>";
     }
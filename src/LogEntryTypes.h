@@ -61,6 +61,18 @@ enum LogEntryType {
     /// See ParticipantList
     LOG_ENTRY_TYPE_TXPLIST,
 
+    /// Manifest of a chunked object; formatted like an Object whose value
+    /// is an ObjectChunk.h::ObjectChunkManifest.
+    LOG_ENTRY_TYPE_OBJMANIFEST,
+
+    /// See ObjectChunk.h::ObjectChunk
+    LOG_ENTRY_TYPE_OBJCHUNK,
+
+    /// An Object followed by the RpcResult of the linearizable write that
+    /// created it; see RpcResult::assembleForLogWithObject. AbstractLog's
+    /// getEntry() presents these as LOG_ENTRY_TYPE_OBJ.
+    LOG_ENTRY_TYPE_OBJRPCRESULT,
+
     /// Not a type, but rather the total number of types we have defined.
     /// This is currently restricted by the lower 6 bits in a uint8_t field
     /// in Segment.h's Segment::EntryHeader. RAMCloud will probably collapse
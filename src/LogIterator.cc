@@ -132,6 +132,23 @@ LogIterator::next()
     }
 }
 
+/**
+ * Advance the iterator to the first entry of the next segment, ignoring
+ * any remaining entries in the current one. Once the head has been reached
+ * this is the same as #next: the segments after it may still be receiving
+ * appends, so they are always iterated entry by entry.
+ */
+void
+LogIterator::skipSegment()
+{
+    if (!done && !headReached && currentIterator) {
+        // Truncate the current segment at the current entry; next() will
+        // then find it exhausted and move on.
+        currentIterator->setLimit(currentIterator->getOffset());
+    }
+    next();
+}
+
 /**
  * Test whether or not the iterator is currently on the head of the log. When
  * iterating the head all log appends are delayed until the iterator has been
@@ -54,6 +54,7 @@ class LogIterator {
     ~LogIterator();
 
     void next();
+    void skipSegment();
     bool onHead();
     Log::Reference getReference();
 
@@ -75,6 +76,16 @@ class LogIterator {
         return currentIterator.get();
     }
 
+    /**
+     * Returns the segment containing the current entry. Callers can use
+     * its metadata (e.g. per-type entry counts) to decide whether the
+     * segment is worth iterating or should be passed over with
+     * #skipSegment. Must not be invoked once #isDone returns true.
+     */
+    LogSegment* getSegment() {
+        return segmentList.back();
+    }
+
     LogEntryType getType();
     uint32_t getLength();
     uint32_t appendToBuffer(Buffer& buffer);
@@ -241,6 +241,35 @@ TEST_F(LogIteratorTest, next_setLimitForHeadSegment) {
     EXPECT_EQ(writeCount, readCount);
 }
 
+TEST_F(LogIteratorTest, skipSegment) {
+    // Create 3 segments in the log.
+    while (l.head == NULL || l.head->id < 3)
+        l.append(LOG_ENTRY_TYPE_OBJ, data, sizeof(data));
+    l.append(LOG_ENTRY_TYPE_OBJ, data, sizeof(data));
+
+    LogIterator i(l);
+    EXPECT_EQ(1U, i.getSegment()->id);
+    i.next();
+    i.skipSegment();
+    EXPECT_EQ(2U, i.getSegment()->id);
+    EXPECT_EQ(LOG_ENTRY_TYPE_SEGHEADER, i.getType());
+    i.skipSegment();
+    EXPECT_EQ(3U, i.getSegment()->id);
+    EXPECT_TRUE(i.onHead());
+
+    // Entries in the head segment are never skipped.
+    i.skipSegment();
+    EXPECT_FALSE(i.isDone());
+    EXPECT_EQ(3U, i.getSegment()->id);
+    int objects = 0;
+    while (!i.isDone()) {
+        if (i.getType() == LOG_ENTRY_TYPE_OBJ)
+            objects++;
+        i.next();
+    }
+    EXPECT_EQ(2, objects);
+}
+
 TEST_F(LogIteratorTest, populateSegmentList) {
         l.sync();
         LogSegment* seg1 = segmentManager.allocHeadSegment();
@@ -28,6 +28,7 @@
 #pragma GCC diagnostic pop
 
 #include "Cycles.h"
+#include "Fence.h"
 #include "LogCabinLogger.h"
 #include "Logger.h"
 #include "ShortMacros.h"
@@ -60,6 +61,9 @@ static const char* logModuleNames[] = {
 static_assert(unsafeArrayLength(logModuleNames) == NUM_LOG_MODULES,
               "logModuleNames size does not match NUM_LOG_MODULES");
 
+thread_local std::shared_ptr<Logger::StagingBuffer>
+        Logger::threadStagingBuffer;
+
 /**
  * Create a new debug logger; messages will go to stderr by default. Should
  * not be called outside this class except during unit testing.
@@ -82,6 +86,11 @@ Logger::Logger(LogLevel level)
     , nextToInsert(0)
     , nextToPrint(0)
     , discardedEntries(0)
+    , deferredFormatting(false)
+    , stagingBuffers()
+    , stagingBufferSize(DEFAULT_STAGING_BUFFER_SIZE)
+    , baseCycles(0)
+    , baseTime({0, 0})
     , printThread()
     , printThreadExit(false)
     , testingBufferSize(0)
@@ -118,7 +127,11 @@ Logger::~Logger()
     }
     printThread->join();
 
-    // No lock needed: the print thread is finished
+    // No lock needed: the print thread is finished. Threads may still hold
+    // references to their staging buffers; make sure they stop using them.
+    foreach (std::shared_ptr<StagingBuffer>& buffer, stagingBuffers) {
+        buffer->logger = NULL;
+    }
     if (mustCloseFd)
         close(fd);
     delete[] messageBuffer;
@@ -363,6 +376,29 @@ Logger::changeLogLevels(int delta)
     }
 }
 
+/**
+ * Enable or disable deferred formatting. When it is enabled, RAMCLOUD_LOG
+ * and RAMCLOUD_CLOG copy the arguments of each message into a buffer private
+ * to the calling thread, without formatting the message or acquiring the
+ * Logger lock; the print thread formats the messages later (collapsing
+ * duplicates as usual). Messages whose format strings or arguments can't be
+ * deferred (for example, because they use %n) are still formatted right away.
+ *
+ * \param enabled
+ *      True means defer formatting; false means format each message in the
+ *      thread that logs it.
+ */
+void
+Logger::setDeferredFormatting(bool enabled)
+{
+    Lock lock(mutex);
+    if (enabled && !deferredFormatting) {
+        baseCycles = Cycles::rdtsc();
+        clock_gettime(CLOCK_REALTIME, &baseTime);
+    }
+    deferredFormatting = enabled;
+}
+
 /**
  * If there is currently a large amount of buffered log output that has
  * not yet been written, wait until this congestion eases before returning.
@@ -452,6 +488,64 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
 #endif
     Lock lock(mutex);
 
+    // Format any messages staged earlier by this thread (or others) first,
+    // so that messages come out in order.
+    if (!stagingBuffers.empty()) {
+        drainStagingBuffers(lock);
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    logMessage(lock, collapse, level, where, now, ThreadId::get(), fmt, ap);
+    va_end(ap);
+
+    // Make sure this method did not take very long to execute.  If the
+    // logging gets backed up it is really bad news, because it can lock
+    // up the server so that it appears dead and crash recovery happens
+    // (e.g., the Dispatch thread might be blocked waiting to log a message).
+    // Thus, generate a log message to help people trying to debug the "crash".
+    double elapsedMs = Cycles::toSeconds(Cycles::rdtsc() - start)*1e3;
+    if (elapsedMs > 10) {
+        char buffer[200];
+        clock_gettime(CLOCK_REALTIME, &now);
+        CodeLocation here = HERE;
+        snprintf(buffer, sizeof(buffer), "%010lu.%09lu %s:%d in %s "
+                "ERROR[%d]: Logger got stuck for %.1f ms, which could "
+                "hang server\n",
+                now.tv_sec, now.tv_nsec, here.baseFileName(),
+                here.line, here.function, ThreadId::get(),
+                elapsedMs);
+        addToBuffer(buffer, downCast<int>(strlen(buffer)));
+    }
+}
+
+/**
+ * This method does most of the work of logMessage: it formats a message
+ * and adds it to the buffer for the print thread, unless it is a duplicate
+ * that should be collapsed. It is also used to print deferred messages.
+ *
+ * \param lock
+ *      Ensures that the caller holds the Logger lock.
+ * \param collapse
+ *      Collapse log messages when set.
+ * \param level
+ *      See #LOG.
+ * \param where
+ *      Where the message was generated.
+ * \param now
+ *      Time at which the message was generated.
+ * \param threadId
+ *      ThreadId of the thread that generated the message.
+ * \param fmt
+ *      See #LOG except the string should end with a newline character.
+ * \param ap
+ *      The arguments to \a fmt.
+ */
+void
+Logger::logMessage(Lock& lock, bool collapse, LogLevel level,
+                   const CodeLocation& where, struct timespec now,
+                   int threadId, const char* fmt, va_list ap)
+{
     // See if this log message should be collapsed away entirely.
     SkipInfo* skip = NULL;
     int skipCount = 0;
@@ -502,7 +596,7 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
                 "lost because of buffer overflow\n",
                 now.tv_sec, now.tv_nsec, here.baseFileName(),
                 here.line, here.function, logLevelNames[WARNING],
-                ThreadId::get(), discardedEntries);
+                threadId, discardedEntries);
         if (actual >= spaceLeft) {
             // We ran out of space in the buffer (should never happen here).
             charsLost += 1 + actual - spaceLeft;
@@ -518,7 +612,7 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
             "%010lu.%09lu %s:%d in %s %s[%d]: ",
             now.tv_sec, now.tv_nsec, where.baseFileName(), where.line,
             where.function, logLevelNames[level],
-            ThreadId::get());
+            threadId);
     if (actual >= spaceLeft) {
         // We ran out of space in the buffer (should never happen here).
         charsLost += 1 + actual - spaceLeft;
@@ -541,10 +635,7 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
     }
 
     // Last, add the caller's log message.
-    va_list ap;
-    va_start(ap, fmt);
     actual = vsnprintf(buffer + charsWritten, spaceLeft, fmt, ap);
-    va_end(ap);
     if (actual >= spaceLeft) {
         // We ran out of space in the buffer.
         charsLost += 1 + actual - spaceLeft;
@@ -586,25 +677,6 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
     if (Util::timespecLessEqual(nextCleanTime, now)) {
         cleanCollapseMap(now);
     }
-
-    // Make sure this method did not take very long to execute.  If the
-    // logging gets backed up it is really bad news, because it can lock
-    // up the server so that it appears dead and crash recovery happens
-    // (e.g., the Dispatch thread might be blocked waiting to log a message).
-    // Thus, generate a log message to help people trying to debug the "crash".
-    double elapsedMs = Cycles::toSeconds(Cycles::rdtsc() - start)*1e3;
-    if (elapsedMs > 10) {
-        struct timespec now;
-        clock_gettime(CLOCK_REALTIME, &now);
-        CodeLocation here = HERE;
-        snprintf(buffer, sizeof(buffer), "%010lu.%09lu %s:%d in %s "
-                "ERROR[%d]: Logger got stuck for %.1f ms, which could "
-                "hang server\n",
-                now.tv_sec, now.tv_nsec, here.baseFileName(),
-                here.line, here.function, ThreadId::get(),
-                elapsedMs);
-        addToBuffer(buffer, downCast<int>(strlen(buffer)));
-    }
 }
 
 /**
@@ -740,6 +812,11 @@ Logger::printThreadMain(Logger* logger)
             return;
         }
 
+        // Format any messages that other threads have staged.
+        if (!logger->stagingBuffers.empty()) {
+            logger->drainStagingBuffers(lock);
+        }
+
         // Handle buffer wraparound.
         if (logger->nextToPrint >= logger->bufferSize) {
             logger->nextToPrint = 0;
@@ -758,7 +835,12 @@ Logger::printThreadMain(Logger* logger)
             // keeps up, only the first part of the buffer will be used,
             // and the later parts will never be touched.
             logger->nextToPrint = logger->nextToInsert = 0;
-            logger->logDataAvailable.wait(lock);
+            if (logger->stagingBuffers.empty()) {
+                logger->logDataAvailable.wait(lock);
+            } else {
+                logger->logDataAvailable.wait_for(lock,
+                        std::chrono::milliseconds(STAGING_POLL_INTERVAL_MS));
+            }
             continue;
         }
 
@@ -791,6 +873,733 @@ Logger::printThreadMain(Logger* logger)
     }
 }
 
+/**
+ * Format the messages in all staging buffers and add them to the buffer for
+ * the print thread, then free the staging buffers of threads that have
+ * exited.
+ *
+ * \param lock
+ *      Ensures that the caller holds the Logger lock.
+ */
+void
+Logger::drainStagingBuffers(Lock& lock)
+{
+    // Keep the conversion of staged timestamps from drifting away from
+    // the system clock.
+    if (Cycles::toSeconds(Cycles::rdtsc() - baseCycles) > 1.0) {
+        baseCycles = Cycles::rdtsc();
+        clock_gettime(CLOCK_REALTIME, &baseTime);
+    }
+
+    string message;
+    size_t i = 0;
+    while (i < stagingBuffers.size()) {
+        StagingBuffer* buffer = stagingBuffers[i].get();
+        discardedEntries += buffer->droppedEntries.exchange(0);
+        const char* data;
+        while ((data = buffer->peek()) != NULL) {
+            const StagedEntry* entry =
+                    reinterpret_cast<const StagedEntry*>(data);
+            message.clear();
+            entry->site->decode(data + sizeof(StagedEntry), &message);
+            logStagedMessage(lock, entry->collapse, entry->level,
+                    entry->site->where, stagedTime(entry->cycles),
+                    entry->threadId, "%s", message.c_str());
+            buffer->consume(entry->length);
+        }
+
+        // If we hold the only reference, the owning thread has exited
+        // and no more messages will be staged here.
+        if (stagingBuffers[i].use_count() == 1 && buffer->peek() == NULL) {
+            stagingBuffers.erase(stagingBuffers.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+/**
+ * Return the calling thread's staging buffer for this Logger, creating it
+ * if needed.
+ */
+Logger::StagingBuffer*
+Logger::getStagingBuffer()
+{
+    StagingBuffer* buffer = threadStagingBuffer.get();
+    if (expect_true(buffer != NULL && buffer->logger == this)) {
+        return buffer;
+    }
+
+    // This thread hasn't staged any messages for this Logger yet. If it
+    // has a buffer for some other Logger, releasing it here lets that
+    // Logger free it.
+    threadStagingBuffer = std::make_shared<StagingBuffer>(this,
+            stagingBufferSize);
+    Lock lock(mutex);
+    stagingBuffers.push_back(threadStagingBuffer);
+
+    // The print thread may be waiting for data indefinitely; from now on
+    // it needs to poll the staging buffers.
+    logDataAvailable.notify_one();
+    return threadStagingBuffer.get();
+}
+
+/**
+ * Invokes logMessage with a variable number of arguments; used to print
+ * deferred messages. See logMessage for documentation of the arguments.
+ */
+void
+Logger::logStagedMessage(Lock& lock, bool collapse, LogLevel level,
+                         const CodeLocation& where, struct timespec now,
+                         int threadId, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    logMessage(lock, collapse, level, where, now, threadId, fmt, ap);
+    va_end(ap);
+}
+
+namespace {
+
+/**
+ * The length recorded for a string argument whose value was NULL.
+ */
+const uint32_t NULL_STRING = ~0u;
+
+/**
+ * Check that the arguments of a deferred log message are what its format
+ * string expects, and compute how much space they need in a staging buffer.
+ *
+ * \param site
+ *      Call site that generated the message.
+ * \param arguments
+ *      The arguments of the message. The stringLength fields of string
+ *      arguments are filled in.
+ * \param count
+ *      Number of entries in \a arguments.
+ * \param[out] length
+ *      Set to the number of bytes needed by copyArguments.
+ * \return
+ *      False means the message can't be deferred.
+ */
+bool
+measureArguments(const Logger::LogSite& site, Logger::LogArgument* arguments,
+                 uint32_t count, uint32_t* length)
+{
+    typedef Logger::LogArgument LogArgument;
+    typedef Logger::LogSite::Conversion Conversion;
+    if (!site.deferrable || count != site.argumentCount) {
+        return false;
+    }
+
+    uint32_t bytes = 0;
+    LogArgument* argument = arguments;
+    for (uint32_t i = 0; i < site.numConversions; i++) {
+        const Conversion& conversion = site.conversions[i];
+        int precision = conversion.precision;
+        if (conversion.widthArgument) {
+            if (argument->type != LogArgument::INTEGER) {
+                return false;
+            }
+            argument++;
+            bytes += downCast<uint32_t>(sizeof(uint64_t));
+        }
+        if (conversion.precisionArgument) {
+            if (argument->type != LogArgument::INTEGER) {
+                return false;
+            }
+            precision = static_cast<int>(argument->value);
+            argument++;
+            bytes += downCast<uint32_t>(sizeof(uint64_t));
+        }
+
+        LogArgument::Type expected = LogArgument::INTEGER;
+        if (conversion.kind == Conversion::FLOATING) {
+            expected = LogArgument::FLOATING;
+        } else if (conversion.kind == Conversion::STRING ||
+                conversion.kind == Conversion::POINTER) {
+            expected = LogArgument::POINTER;
+        }
+        if (argument->type != expected) {
+            return false;
+        }
+
+        if (conversion.kind == Conversion::STRING) {
+            // Copy no more of the string than can be printed.
+            const char* s = reinterpret_cast<const char*>(argument->value);
+            argument->stringLength = NULL_STRING;
+            bytes += downCast<uint32_t>(sizeof(uint32_t));
+            if (s != NULL) {
+                size_t limit = MAX_MESSAGE_CHARS;
+                if (precision >= 0 && static_cast<size_t>(precision) < limit) {
+                    limit = static_cast<size_t>(precision);
+                }
+                argument->stringLength = downCast<uint32_t>(strnlen(s, limit));
+                bytes += argument->stringLength;
+            }
+        } else {
+            bytes += downCast<uint32_t>(sizeof(uint64_t));
+        }
+        argument++;
+    }
+    *length = bytes;
+    return true;
+}
+
+/**
+ * Copy the arguments of a deferred log message into a staging buffer, in
+ * the order the format string consumes them: integers, floating-point values
+ * and pointers take 8 bytes each; strings take a 4-byte length followed by
+ * their characters (without a terminating null).
+ *
+ * \param site
+ *      Call site that generated the message.
+ * \param arguments
+ *      The arguments of the message, which have already been checked by
+ *      measureArguments.
+ * \param out
+ *      Where to copy the arguments.
+ */
+void
+copyArguments(const Logger::LogSite& site,
+              const Logger::LogArgument* arguments, char* out)
+{
+    const Logger::LogArgument* argument = arguments;
+    for (uint32_t i = 0; i < site.numConversions; i++) {
+        const Logger::LogSite::Conversion& conversion = site.conversions[i];
+        uint32_t values = 1;
+        if (conversion.widthArgument) {
+            values++;
+        }
+        if (conversion.precisionArgument) {
+            values++;
+        }
+        for (uint32_t j = 0; j < values; j++, argument++) {
+            if (j == values - 1 &&
+                    conversion.kind == Logger::LogSite::Conversion::STRING) {
+                uint32_t length = argument->stringLength;
+                memcpy(out, &length, sizeof(length));
+                out += sizeof(length);
+                if (length != NULL_STRING) {
+                    memcpy(out, reinterpret_cast<const char*>(argument->value),
+                           length);
+                    out += length;
+                }
+                continue;
+            }
+            memcpy(out, &argument->value, sizeof(argument->value));
+            out += sizeof(argument->value);
+        }
+    }
+}
+
+/**
+ * Read the next 8-byte value from the arguments of a staged message.
+ *
+ * \param data
+ *      Points to the next argument; advanced past the value.
+ */
+uint64_t
+readValue(const char** data)
+{
+    uint64_t value;
+    memcpy(&value, *data, sizeof(value));
+    *data += sizeof(value);
+    return value;
+}
+
+/**
+ * Append the output of one printf conversion to a message.
+ *
+ * \param message
+ *      Output is appended here.
+ * \param conversion
+ *      Describes the conversion.
+ * \param width
+ *      Field width, if the conversion takes it as an argument.
+ * \param precision
+ *      Precision, if the conversion takes it as an argument.
+ * \param value
+ *      The value to print, of the type conversion.spec expects.
+ */
+template<typename T>
+void
+appendConversion(string* message, const Logger::LogSite::Conversion& conversion,
+                 int width, int precision, T value)
+{
+    char buffer[MAX_MESSAGE_CHARS];
+    bool precisionArgument = conversion.precisionArgument ||
+            conversion.kind == Logger::LogSite::Conversion::STRING;
+    int actual;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+    if (conversion.widthArgument && precisionArgument) {
+        actual = snprintf(buffer, sizeof(buffer), conversion.spec, width,
+                          precision, value);
+    } else if (conversion.widthArgument) {
+        actual = snprintf(buffer, sizeof(buffer), conversion.spec, width,
+                          value);
+    } else if (precisionArgument) {
+        actual = snprintf(buffer, sizeof(buffer), conversion.spec, precision,
+                          value);
+    } else {
+        actual = snprintf(buffer, sizeof(buffer), conversion.spec, value);
+    }
+#pragma GCC diagnostic pop
+    if (actual > 0) {
+        message->append(buffer, std::min(static_cast<size_t>(actual),
+                                          sizeof(buffer) - 1));
+    }
+}
+
+/**
+ * Append part of a format string that contains no conversions to a message,
+ * replacing each "%%" with "%".
+ *
+ * \param message
+ *      Output is appended here.
+ * \param start
+ *      First character to append.
+ * \param end
+ *      Character just after the last one to append.
+ */
+void
+appendLiteral(string* message, const char* start, const char* end)
+{
+    for (const char* p = start; p < end; p++) {
+        message->push_back(*p);
+        if (*p == '%') {
+            p++;
+        }
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Record a log message in the calling thread's staging buffer. See
+ * logDeferred for documentation of the arguments and result.
+ */
+bool
+Logger::stage(const LogSite& site, bool collapse, LogLevel level,
+              LogArgument* arguments, uint32_t count)
+{
+    uint32_t argumentBytes;
+    if (!measureArguments(site, arguments, count, &argumentBytes)) {
+        return false;
+    }
+    uint32_t length = downCast<uint32_t>(
+            (sizeof(StagedEntry) + argumentBytes + 7) & ~7lu);
+
+    StagingBuffer* buffer = getStagingBuffer();
+    char* data = buffer->reserve(length);
+    if (data == NULL) {
+        // The print thread has fallen behind; it will report how many
+        // messages were lost.
+        buffer->droppedEntries.inc();
+        return true;
+    }
+    StagedEntry* entry = new(data) StagedEntry(length, &site, level, collapse);
+    entry->threadId = ThreadId::get();
+    entry->cycles = Cycles::rdtsc();
+    copyArguments(site, arguments, data + sizeof(StagedEntry));
+    buffer->commit(length);
+    return true;
+}
+
+/**
+ * Convert the timestamp of a staged message to wall-clock time.
+ *
+ * \param cycles
+ *      Cycles::rdtsc() when the message was staged.
+ */
+struct timespec
+Logger::stagedTime(uint64_t cycles)
+{
+#ifdef TESTING
+    if (testingLogTime != NULL) {
+        return *testingLogTime;
+    }
+#endif
+    int64_t offset;
+    if (cycles >= baseCycles) {
+        offset = static_cast<int64_t>(
+                Cycles::toNanoseconds(cycles - baseCycles));
+    } else {
+        offset = -static_cast<int64_t>(
+                Cycles::toNanoseconds(baseCycles - cycles));
+    }
+    int64_t ns = baseTime.tv_sec*1000000000L + baseTime.tv_nsec + offset;
+    struct timespec result;
+    result.tv_sec = ns / 1000000000L;
+    result.tv_nsec = ns % 1000000000L;
+    return result;
+}
+
+/**
+ * Construct a LogSite, parsing its format string.
+ *
+ * \param where
+ *      Location of the RAMCLOUD_LOG or RAMCLOUD_CLOG invocation.
+ * \param formatString
+ *      Format string of the invocation; must remain valid for the life of
+ *      the process (it is a literal).
+ */
+Logger::LogSite::LogSite(CodeLocation where, const char* formatString)
+    : where(where)
+    , formatString(formatString)
+    , conversions(NULL)
+    , numConversions(0)
+    , argumentCount(0)
+    , deferrable(true)
+{
+    std::vector<Conversion> parsed;
+    const char* p = formatString;
+    while (*p != 0) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+
+        Conversion conversion;
+        conversion.start = downCast<uint32_t>(p - formatString);
+        string spec("%");
+        p++;
+
+        // Flags and field width.
+        while (*p != 0 && strchr("-+ #0'", *p) != NULL) {
+            spec += *p++;
+        }
+        if (*p == '*') {
+            conversion.widthArgument = true;
+            argumentCount++;
+            spec += *p++;
+        } else {
+            while (isdigit(*p)) {
+                spec += *p++;
+            }
+        }
+
+        // Precision.
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                conversion.precisionArgument = true;
+                argumentCount++;
+                p++;
+            } else {
+                conversion.precision = 0;
+                while (isdigit(*p)) {
+                    conversion.precision = 10*conversion.precision + *p - '0';
+                    p++;
+                }
+            }
+        }
+
+        // Length modifier.
+        if (*p == 'h') {
+            conversion.length = Conversion::SHORT;
+            p++;
+            if (*p == 'h') {
+                conversion.length = Conversion::CHAR;
+                p++;
+            }
+        } else if (*p == 'l') {
+            conversion.length = Conversion::LONG;
+            p++;
+            if (*p == 'l') {
+                conversion.length = Conversion::LONG_LONG;
+                p++;
+            }
+        } else if (*p != 0 && strchr("Lqjzt", *p) != NULL) {
+            conversion.length = Conversion::LONG_LONG;
+            p++;
+        }
+
+        // Conversion specifier. The spec used to print the value is
+        // rewritten to match the types decode passes to snprintf.
+        char specifier = *p;
+        if (strchr("di", specifier) != NULL && specifier != 0) {
+            conversion.kind = Conversion::SIGNED;
+        } else if (strchr("uoxX", specifier) != NULL && specifier != 0) {
+            conversion.kind = Conversion::UNSIGNED;
+        } else if (strchr("eEfFgGaA", specifier) != NULL && specifier != 0) {
+            conversion.kind = Conversion::FLOATING;
+        } else if (specifier == 'c' &&
+                conversion.length == Conversion::NONE) {
+            conversion.kind = Conversion::CHARACTER;
+        } else if (specifier == 's' &&
+                conversion.length == Conversion::NONE) {
+            conversion.kind = Conversion::STRING;
+        } else if (specifier == 'p') {
+            conversion.kind = Conversion::POINTER;
+        } else {
+            // Something we don't handle, such as %n, %m, wide characters,
+            // or positional arguments.
+            deferrable = false;
+            break;
+        }
+        argumentCount++;
+        p++;
+        conversion.end = downCast<uint32_t>(p - formatString);
+
+        if (conversion.kind == Conversion::STRING ||
+                conversion.precisionArgument) {
+            spec += ".*";
+        } else if (conversion.precision >= 0) {
+            spec += format(".%d", conversion.precision);
+        }
+        if (conversion.kind == Conversion::SIGNED ||
+                conversion.kind == Conversion::UNSIGNED) {
+            spec += "ll";
+        }
+        spec += specifier;
+        if (spec.size() >= sizeof(conversion.spec)) {
+            deferrable = false;
+            break;
+        }
+        memcpy(conversion.spec, spec.c_str(), spec.size() + 1);
+        parsed.push_back(conversion);
+    }
+
+    if (deferrable && !parsed.empty()) {
+        // Never freed: LogSites are static variables that last until the
+        // process exits (and the print thread may use them until then).
+        numConversions = downCast<uint32_t>(parsed.size());
+        conversions = new Conversion[numConversions];
+        std::copy(parsed.begin(), parsed.end(), conversions);
+    }
+}
+
+/**
+ * Format a message staged by this site.
+ *
+ * \param data
+ *      The arguments of the message, as stored by Logger::stage.
+ * \param message
+ *      The formatted message is appended here.
+ */
+void
+Logger::LogSite::decode(const char* data, string* message) const
+{
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < numConversions; i++) {
+        const Conversion& conversion = conversions[i];
+        appendLiteral(message, formatString + next,
+                      formatString + conversion.start);
+        next = conversion.end;
+
+        int width = 0;
+        int precision = 0;
+        if (conversion.widthArgument) {
+            width = static_cast<int>(readValue(&data));
+        }
+        if (conversion.precisionArgument) {
+            precision = static_cast<int>(readValue(&data));
+        }
+
+        switch (conversion.kind) {
+            case Conversion::SIGNED: {
+                // Truncate the value to the size the format string
+                // specifies, as printf would.
+                uint64_t raw = readValue(&data);
+                long long value;                        // NOLINT
+                switch (conversion.length) {
+                    case Conversion::CHAR:
+                        value = static_cast<signed char>(raw);
+                        break;
+                    case Conversion::SHORT:
+                        value = static_cast<int16_t>(raw);
+                        break;
+                    case Conversion::NONE:
+                        value = static_cast<int32_t>(raw);
+                        break;
+                    default:
+                        value = static_cast<long long>(raw);  // NOLINT
+                        break;
+                }
+                appendConversion(message, conversion, width, precision,
+                                 value);
+                break;
+            }
+            case Conversion::UNSIGNED: {
+                uint64_t raw = readValue(&data);
+                unsigned long long value;               // NOLINT
+                switch (conversion.length) {
+                    case Conversion::CHAR:
+                        value = static_cast<uint8_t>(raw);
+                        break;
+                    case Conversion::SHORT:
+                        value = static_cast<uint16_t>(raw);
+                        break;
+                    case Conversion::NONE:
+                        value = static_cast<uint32_t>(raw);
+                        break;
+                    default:
+                        value = raw;
+                        break;
+                }
+                appendConversion(message, conversion, width, precision,
+                                 value);
+                break;
+            }
+            case Conversion::CHARACTER:
+                appendConversion(message, conversion, width, precision,
+                                 static_cast<int>(readValue(&data)));
+                break;
+            case Conversion::FLOATING: {
+                uint64_t bits = readValue(&data);
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                appendConversion(message, conversion, width, precision,
+                                 value);
+                break;
+            }
+            case Conversion::POINTER:
+                appendConversion(message, conversion, width, precision,
+                        reinterpret_cast<void*>(readValue(&data)));
+                break;
+            case Conversion::STRING: {
+                uint32_t length;
+                memcpy(&length, data, sizeof(length));
+                data += sizeof(length);
+                if (length == NULL_STRING) {
+                    appendConversion(message, conversion, width, 6,
+                                     "(null)");
+                    break;
+                }
+                string value(data, length);
+                data += length;
+                appendConversion(message, conversion, width,
+                                 downCast<int>(length), value.c_str());
+                break;
+            }
+        }
+    }
+    appendLiteral(message, formatString + next,
+                  formatString + strlen(formatString));
+}
+
+/**
+ * Construct a StagingBuffer.
+ *
+ * \param logger
+ *      The Logger whose print thread will drain the buffer.
+ * \param size
+ *      Number of bytes of storage; must be a multiple of 8.
+ */
+Logger::StagingBuffer::StagingBuffer(Logger* logger, uint32_t size)
+    : logger(logger)
+    , size(size)
+    , storage(new char[size])
+    , producerPos(0)
+    , consumerPos(0)
+    , reservedPos(0)
+    , droppedEntries(0)
+{
+    assert((size % 8) == 0);
+
+    // Touch every page so that staging messages doesn't take page faults.
+    for (uint32_t i = 0; i < size; i += 1000) {
+        storage[i] = 'x';
+    }
+}
+
+Logger::StagingBuffer::~StagingBuffer()
+{
+    delete[] storage;
+}
+
+/**
+ * Find contiguous space for a new entry. Called only by the owning thread;
+ * the entry isn't visible to the consumer until commit is called.
+ *
+ * \param length
+ *      Number of bytes needed (a multiple of 8).
+ * \return
+ *      The space for the entry, or NULL if the buffer doesn't have room.
+ */
+char*
+Logger::StagingBuffer::reserve(uint32_t length)
+{
+    uint64_t head = producerPos.load();
+    uint32_t offset = downCast<uint32_t>(head % size);
+    uint32_t contiguous = size - offset;
+    uint64_t needed = length;
+    if (contiguous < length) {
+        needed += contiguous;
+    }
+    if (head + needed - consumerPos.load() > size) {
+        return NULL;
+    }
+    if (contiguous < length) {
+        // There isn't room before the end of the storage: mark the rest
+        // of it as unused and start again at the beginning.
+        memset(storage + offset, 0, sizeof(uint32_t));
+        head += contiguous;
+        offset = 0;
+    }
+    reservedPos = head;
+    return storage + offset;
+}
+
+/**
+ * Make the entry filled in after the last call to reserve visible to the
+ * consumer.
+ *
+ * \param length
+ *      Number of bytes in the entry; must be the value passed to reserve.
+ */
+void
+Logger::StagingBuffer::commit(uint32_t length)
+{
+    // The entry's contents must be visible before the new position is.
+    Fence::leave();
+    producerPos.store(reservedPos + length);
+}
+
+/**
+ * Return the oldest entry in the buffer, or NULL if there are none. Called
+ * only with the Logger lock held.
+ */
+const char*
+Logger::StagingBuffer::peek()
+{
+    uint64_t tail = consumerPos.load();
+    while (tail != producerPos.load()) {
+        Fence::enter();
+        uint32_t offset = downCast<uint32_t>(tail % size);
+        uint32_t length;
+        memcpy(&length, storage + offset, sizeof(length));
+        if (length != 0) {
+            return storage + offset;
+        }
+
+        // Skip the unused space at the end of the storage.
+        tail += size - offset;
+        consumerPos.store(tail);
+    }
+    return NULL;
+}
+
+/**
+ * Remove the entry returned by peek. Called only with the Logger lock held.
+ *
+ * \param length
+ *      Number of bytes in the entry.
+ */
+void
+Logger::StagingBuffer::consume(uint32_t length)
+{
+    // Finish reading the entry before the producer can overwrite it.
+    Fence::leave();
+    consumerPos.store(consumerPos.load() + length);
+}
+
 /**
  * Restore a logger to its default initialized state. Used primarily by tests.
  */
@@ -811,6 +1620,8 @@ Logger::reset()
     nextToPrint = 0;
     discardedEntries = 0;
     testingBufferSize = 0;
+    deferredFormatting = false;
+    stagingBufferSize = DEFAULT_STAGING_BUFFER_SIZE;
     testingLogTime = NULL;
     testingNoNotify = false;
 }
@@ -826,6 +1637,9 @@ void
 Logger::sync()
 {
     Lock lock(mutex);
+    if (!stagingBuffers.empty()) {
+        drainStagingBuffers(lock);
+    }
     while (nextToInsert != nextToPrint) {
         Unlock<SpinLock> unlock(mutex);
         usleep(100);
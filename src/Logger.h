@@ -17,10 +17,13 @@
 #define RAMCLOUD_LOGGER_H
 
 #include <condition_variable>
+#include <cstdarg>
 #include <thread>
 #include <time.h>
+#include <type_traits>
 #include <unordered_map>
 
+#include "Atomic.h"
 #include "CodeLocation.h"
 #include "SpinLock.h"
 #include "Tub.h"
@@ -71,6 +74,12 @@ enum LogModule {
  * you'll need to access this class to configure the verbosity of the logger
  * and where the log messages should go.
  *
+ * Normally each message is formatted by the thread that logs it. When deferred
+ * formatting is enabled (see setDeferredFormatting), RAMCLOUD_LOG and
+ * RAMCLOUD_CLOG instead copy their raw arguments into a buffer private to the
+ * logging thread, and the print thread formats them later; this takes the
+ * cost of formatting, and the Logger lock, off the threads that log.
+ *
  * Note: this class is thread-safe.
  */
 class Logger {
@@ -133,12 +142,299 @@ class Logger {
         return (level <= logLevels[module]);
     }
 
+    void setDeferredFormatting(bool enabled);
+
+    /**
+     * Return whether RAMCLOUD_LOG and RAMCLOUD_CLOG should record their
+     * arguments with logDeferred rather than calling logMessage.
+     */
+    bool isDeferred() {
+        return deferredFormatting;
+    }
+
+    /**
+     * One of these is created for each RAMCLOUD_LOG or RAMCLOUD_CLOG
+     * invocation in the source, the first time it logs a message while
+     * deferred formatting is enabled. It parses the format string once, so
+     * that each later message only needs to record its raw arguments.
+     * LogSites live for the life of the process.
+     */
+    class LogSite {
+      public:
+        LogSite(CodeLocation where, const char* formatString);
+        void decode(const char* data, string* message) const;
+
+        /// Where the log message is generated.
+        const CodeLocation where;
+
+        /// The printf-style format string for the message (a literal).
+        const char* const formatString;
+
+        /**
+         * Describes one conversion specification (such as "%-8.3lu") in
+         * #formatString.
+         */
+        struct Conversion {
+            /// The type of value the conversion prints.
+            enum Kind : uint8_t {
+                SIGNED,
+                UNSIGNED,
+                CHARACTER,
+                FLOATING,
+                STRING,
+                POINTER
+            };
+
+            /// The length modifier of an integer conversion.
+            enum Length : uint8_t {
+                NONE,
+                CHAR,
+                SHORT,
+                LONG,
+                LONG_LONG
+            };
+
+            Conversion()
+                : start(0), end(0), kind(SIGNED), length(NONE)
+                , widthArgument(false), precisionArgument(false)
+                , precision(-1), spec() {}
+
+            /// Offset in #formatString of the '%' that starts the
+            /// conversion.
+            uint32_t start;
+
+            /// Offset in #formatString of the first character after the
+            /// conversion.
+            uint32_t end;
+
+            Kind kind;
+            Length length;
+
+            /// True means the field width is given by an argument ("*").
+            bool widthArgument;
+
+            /// True means the precision is given by an argument (".*").
+            bool precisionArgument;
+
+            /// The precision given in the format string, or -1 if none.
+            int precision;
+
+            /// The conversion as passed to snprintf by decode: integers are
+            /// always printed as long longs, and strings always take their
+            /// precision as an argument (since the copies in staging
+            /// buffers aren't null-terminated).
+            char spec[32];
+        };
+
+        /// The conversion specifications in #formatString, in order.
+        Conversion* conversions;
+
+        /// Number of entries in #conversions.
+        uint32_t numConversions;
+
+        /// Number of arguments #formatString consumes.
+        uint32_t argumentCount;
+
+        /// False means #formatString uses features that deferred formatting
+        /// doesn't support (such as %n or wide strings), so messages from
+        /// this site are always formatted by logMessage.
+        bool deferrable;
+
+        DISALLOW_COPY_AND_ASSIGN(LogSite);
+    };
+
+    /**
+     * Holds the value of one argument of a deferred log message until it
+     * gets copied into a staging buffer.
+     */
+    struct LogArgument {
+        enum Type : uint8_t {
+            NONE,
+            INTEGER,
+            FLOATING,
+            POINTER
+        };
+
+        LogArgument()
+            : type(NONE), stringLength(0), value(0) {}
+        template<typename T>
+        explicit LogArgument(T arg, typename std::enable_if<
+                std::is_integral<T>::value ||
+                std::is_enum<T>::value>::type* dummy = NULL)
+            : type(INTEGER), stringLength(0)
+            , value(static_cast<uint64_t>(arg)) {}
+        template<typename T>
+        explicit LogArgument(T arg, typename std::enable_if<
+                std::is_floating_point<T>::value>::type* dummy = NULL)
+            : type(FLOATING), stringLength(0)
+            , value(doubleBits(static_cast<double>(arg))) {}
+        template<typename T>
+        explicit LogArgument(T* arg)
+            : type(POINTER), stringLength(0)
+            , value(reinterpret_cast<uintptr_t>(arg)) {}
+
+        static uint64_t doubleBits(double arg) {
+            uint64_t bits;
+            memcpy(&bits, &arg, sizeof(bits));
+            return bits;
+        }
+
+        /// The kind of value the caller passed.
+        Type type;
+
+        /// If the argument is printed with %s, the number of bytes of the
+        /// string to copy (computed while staging the message).
+        uint32_t stringLength;
+
+        /// The value: integers are converted to 64 bits (sign-extended if
+        /// signed), floating-point values are stored as the bits of a
+        /// double, and pointers as addresses.
+        uint64_t value;
+    };
+
+    /**
+     * The value member is true if all of the given argument types can be
+     * recorded in a LogArgument.
+     */
+    template<typename... T>
+    struct CanDefer : std::true_type {};
+    template<typename T, typename... Rest>
+    struct CanDefer<T, Rest...> : std::integral_constant<bool,
+            (std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+             (std::is_pointer<T>::value && !std::is_function<
+                    typename std::remove_pointer<T>::type>::value)) &&
+            CanDefer<Rest...>::value> {};
+
+    /**
+     * Record a log message in the calling thread's staging buffer, to be
+     * formatted later by the print thread. Normally invoked only by
+     * RAMCLOUD_LOG and RAMCLOUD_CLOG.
+     *
+     * \param site
+     *      The call site generating the message.
+     * \param collapse
+     *      Collapse log messages when set.
+     * \param level
+     *      See #LOG.
+     * \param args
+     *      The arguments to site's format string.
+     * \return
+     *      True means the message has been taken care of (it may have been
+     *      discarded if the staging buffer was full); false means it can't
+     *      be deferred, and the caller should use logMessage instead.
+     */
+    template<typename... Args>
+    bool logDeferred(const LogSite& site, bool collapse, LogLevel level,
+                     Args... args)
+    {
+        return deferArguments(
+                std::integral_constant<bool, CanDefer<Args...>::value>(),
+                site, collapse, level, args...);
+    }
+
     static void installCrashBacktraceHandlers();
 
   PRIVATE:
+    typedef std::unique_lock<SpinLock> Lock;
+
+    /**
+     * A single-producer, single-consumer circular buffer in which one thread
+     * stages deferred log messages. Only the owning thread adds entries; any
+     * thread holding the Logger lock may remove them.
+     */
+    class StagingBuffer {
+      public:
+        StagingBuffer(Logger* logger, uint32_t size);
+        ~StagingBuffer();
+        char* reserve(uint32_t length);
+        void commit(uint32_t length);
+        const char* peek();
+        void consume(uint32_t length);
+
+        /// The Logger whose print thread drains this buffer, or NULL if
+        /// that Logger has been destroyed.
+        Logger* volatile logger;
+
+        /// Number of bytes of storage.
+        const uint32_t size;
+
+        /// Space for entries (dynamically allocated, must be freed).
+        char* const storage;
+
+        /// Total number of bytes ever added to the buffer; the next entry
+        /// goes at this offset (modulo #size). Modified only by the owner.
+        Atomic<uint64_t> producerPos;
+
+        /// Total number of bytes ever removed from the buffer; the oldest
+        /// entry is at this offset (modulo #size). Modified only by the
+        /// consumer.
+        Atomic<uint64_t> consumerPos;
+
+        /// Position at which the space returned by the last call to reserve
+        /// starts. Used only by the owner.
+        uint64_t reservedPos;
+
+        /// Number of entries discarded because the buffer was full, which
+        /// the print thread hasn't reported yet.
+        Atomic<int> droppedEntries;
+
+        DISALLOW_COPY_AND_ASSIGN(StagingBuffer);
+    };
+
+    /**
+     * The header of each entry in a StagingBuffer; it is followed by the
+     * raw arguments of the message.
+     */
+    struct StagedEntry {
+        StagedEntry(uint32_t length, const LogSite* site, LogLevel level,
+                    bool collapse)
+            : length(length), level(level), collapse(collapse)
+            , threadId(0), cycles(0), site(site) {}
+
+        /// Total bytes occupied by the entry, including padding to keep
+        /// entries 8-byte aligned. Zero marks the unused space at the end
+        /// of the storage; the next entry is at the beginning.
+        uint32_t length;
+        LogLevel level;
+        bool collapse;
+        /// ThreadId of the thread that logged the message.
+        int threadId;
+        /// Cycles::rdtsc() when the message was logged.
+        uint64_t cycles;
+        /// Where the message was logged and how to format it.
+        const LogSite* site;
+    };
+
+    template<typename... Args>
+    bool deferArguments(std::true_type, const LogSite& site, bool collapse,
+                        LogLevel level, Args... args)
+    {
+        LogArgument arguments[sizeof...(Args) + 1] = {LogArgument(args)...};
+        return stage(site, collapse, level, arguments, sizeof...(Args));
+    }
+    template<typename... Args>
+    bool deferArguments(std::false_type, const LogSite& site, bool collapse,
+                        LogLevel level, Args... args)
+    {
+        return false;
+    }
+
     bool addToBuffer(const char* src, int length);
     void cleanCollapseMap(struct timespec now);
+    void drainStagingBuffers(Lock& lock);
+    StagingBuffer* getStagingBuffer();
+    void logMessage(Lock& lock, bool collapse, LogLevel level,
+                    const CodeLocation& where, struct timespec now,
+                    int threadId, const char* fmt, va_list ap)
+        __attribute__((format(printf, 8, 0)));
+    void logStagedMessage(Lock& lock, bool collapse, LogLevel level,
+                          const CodeLocation& where, struct timespec now,
+                          int threadId, const char* fmt, ...)
+        __attribute__((format(printf, 8, 9)));
     static void printThreadMain(Logger* logger);
+    bool stage(const LogSite& site, bool collapse, LogLevel level,
+               LogArgument* arguments, uint32_t count);
+    struct timespec stagedTime(uint64_t cycles);
 
     /**
      * Log output gets written to this file descriptor (default is 3, for
@@ -169,7 +465,6 @@ class Logger {
      * caused server pings to timeout).
      */
     SpinLock mutex;
-    typedef std::unique_lock<SpinLock> Lock;
 
     /**
      * Objects of the following type are used in collapseMap to keep
@@ -291,6 +586,55 @@ class Logger {
      */
     int discardedEntries;
 
+    // The following variables implement deferred formatting: each thread
+    // that logs stages its messages in a StagingBuffer of its own, and the
+    // print thread formats them into messageBuffer.
+
+    /**
+     * True means RAMCLOUD_LOG and RAMCLOUD_CLOG stage their messages rather
+     * than formatting them (see setDeferredFormatting).
+     */
+    volatile bool deferredFormatting;
+
+    /**
+     * The StagingBuffers of all threads that have staged messages; the print
+     * thread drains them. Once a buffer's thread has exited (so this is the
+     * only reference left) and the buffer is empty, it is freed.
+     */
+    std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+
+    /**
+     * The calling thread's own reference to its StagingBuffer, if it has
+     * staged messages.
+     */
+    static thread_local std::shared_ptr<StagingBuffer> threadStagingBuffer;
+
+    /**
+     * Number of bytes in each new StagingBuffer; modified only for unit
+     * testing.
+     */
+    uint32_t stagingBufferSize;
+
+    /**
+     * This is the value of stagingBufferSize except during testing.
+     */
+    static const uint32_t DEFAULT_STAGING_BUFFER_SIZE = 256*1024;
+
+    /**
+     * The print thread sleeps for this many milliseconds at a time when
+     * there is nothing to print, then checks the staging buffers again
+     * (threads that stage messages don't wake it up).
+     */
+    static const uint32_t STAGING_POLL_INTERVAL_MS = 1;
+
+    /**
+     * Cycles::rdtsc() and CLOCK_REALTIME sampled at the same time; used to
+     * convert the timestamps of staged messages into wall-clock time.
+     * Resampled by the print thread every second or so.
+     */
+    uint64_t baseCycles;
+    struct timespec baseTime;
+
     /**
      * This thread is responsible for invoking the (potentially blocking)
      * kernel calls to write out the log.
@@ -363,20 +707,31 @@ class Logger {
  * \param[in] ...
  *      The arguments to the format string.
  */
-#define RAMCLOUD_LOG(level, format, ...) do { \
-    RAMCloud::Logger& _logger = Logger::get(); \
-    if (_logger.isLogging(RAMCLOUD_CURRENT_LOG_MODULE, level)) { \
-        _logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, level, HERE, \
-                           format "\n", ##__VA_ARGS__); \
-    } \
-    RAMCLOUD_TEST_LOG(format, ##__VA_ARGS__); \
-} while (0)
+#define RAMCLOUD_LOG(level, format, ...) \
+    RAMCLOUD_LOG_COMMON(false, level, format, ##__VA_ARGS__)
+
+#define RAMCLOUD_CLOG(level, format, ...) \
+    RAMCLOUD_LOG_COMMON(true, level, format, ##__VA_ARGS__)
 
-#define RAMCLOUD_CLOG(level, format, ...) do { \
+/**
+ * Helper for RAMCLOUD_LOG and RAMCLOUD_CLOG: when deferred formatting is
+ * enabled, the message is staged for the print thread using a LogSite
+ * private to this invocation; otherwise (or if the arguments can't be
+ * deferred) it is formatted right away.
+ */
+#define RAMCLOUD_LOG_COMMON(collapse, level, format, ...) do { \
     RAMCloud::Logger& _logger = Logger::get(); \
     if (_logger.isLogging(RAMCLOUD_CURRENT_LOG_MODULE, level)) { \
-        _logger.logMessage(true, RAMCLOUD_CURRENT_LOG_MODULE, level, HERE, \
-                           format "\n", ##__VA_ARGS__); \
+        bool _staged = false; \
+        if (_logger.isDeferred()) { \
+            static RAMCloud::Logger::LogSite _logSite(HERE, format "\n"); \
+            _staged = _logger.logDeferred(_logSite, collapse, level, \
+                                          ##__VA_ARGS__); \
+        } \
+        if (!_staged) { \
+            _logger.logMessage(collapse, RAMCLOUD_CURRENT_LOG_MODULE, \
+                               level, HERE, format "\n", ##__VA_ARGS__); \
+        } \
     } \
     RAMCLOUD_TEST_LOG(format, ##__VA_ARGS__); \
 } while (0)
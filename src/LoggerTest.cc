@@ -553,6 +553,205 @@ TEST_F(LoggerTest, printThreadMain_wrapAround) {
     EXPECT_EQ(0, logger.nextToPrint);
     EXPECT_EQ(0, logger.nextToInsert);
 }
+TEST_F(LoggerTest, setDeferredFormatting) {
+    EXPECT_FALSE(logger.isDeferred());
+    logger.setDeferredFormatting(true);
+    EXPECT_TRUE(logger.isDeferred());
+    EXPECT_NE(0u, logger.baseCycles);
+    logger.reset();
+    EXPECT_FALSE(logger.isDeferred());
+}
+
+TEST_F(LoggerTest, logMessage_printsStagedMessagesFirst) {
+    logger.setDeferredFormatting(true);
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "staged %d\n");
+    EXPECT_TRUE(logger.logDeferred(site, false, ERROR, 1));
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, ERROR,
+            CodeLocation("file", 100, "func", "pretty"), "immediate\n");
+    EXPECT_EQ("0000000003.500000000 file:99 in func ERROR[1]: staged 1\n"
+            "0000000003.500000000 file:100 in func ERROR[1]: immediate\n",
+            getLog("__test.log"));
+}
+
+TEST_F(LoggerTest, logDeferred_basics) {
+    logger.setDeferredFormatting(true);
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "%d, %s, %.3s, %-4s|, %5.1f, %hhu, %lx, %c, %s, 100%%\n");
+    const char* nullString = NULL;
+    EXPECT_TRUE(logger.logDeferred(site, false, ERROR, -3, "abc", "abcdef",
+            "ab", 2.5, 257, 255lu, 'z', nullString));
+    EXPECT_EQ("0000000003.500000000 file:99 in func ERROR[1]: "
+            "-3, abc, abc, ab  |,   2.5, 1, ff, z, (null), 100%\n",
+            getLog("__test.log"));
+}
+
+TEST_F(LoggerTest, logDeferred_cantDefer) {
+    logger.setDeferredFormatting(true);
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "%d %s\n");
+    struct { int x; } notPrintable = {1};
+
+    // Wrong number of arguments.
+    EXPECT_FALSE(logger.logDeferred(site, false, ERROR, 1));
+    // Wrong types.
+    EXPECT_FALSE(logger.logDeferred(site, false, ERROR, "a", 1));
+    EXPECT_FALSE(logger.logDeferred(site, false, ERROR, 1.0, "a"));
+    // Types that can't be recorded.
+    EXPECT_FALSE(logger.logDeferred(site, false, ERROR, 1, notPrintable));
+
+    Logger::LogSite badSite(CodeLocation("file", 99, "func", "pretty"),
+            "%m\n");
+    EXPECT_FALSE(logger.logDeferred(badSite, false, ERROR));
+    EXPECT_EQ(0u, logger.stagingBuffers.size());
+}
+
+TEST_F(LoggerTest, logDeferred_collapseDuplicates) {
+    logger.setDeferredFormatting(true);
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "message %d\n");
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(logger.logDeferred(site, true, ERROR, i));
+    }
+    EXPECT_EQ("0000000003.500000000 file:99 in func ERROR[1]: message 0\n",
+            getLog("__test.log"));
+    EXPECT_EQ(4, logger.collapseMap[std::make_pair("file", 99)].skipCount);
+}
+
+TEST_F(LoggerTest, drainStagingBuffers_freeBuffersOfExitedThreads) {
+    logger.setDeferredFormatting(true);
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "from thread %d\n");
+    std::thread thread([this, &site] {
+        logger.logDeferred(site, false, ERROR, 7);
+    });
+    thread.join();
+    EXPECT_TRUE(TestUtil::contains(getLog("__test.log"), "from thread 7"));
+    EXPECT_EQ(0u, logger.stagingBuffers.size());
+
+    // The current thread's buffer is retained.
+    EXPECT_TRUE(logger.logDeferred(site, false, ERROR, 8));
+    logger.sync();
+    EXPECT_EQ(1u, logger.stagingBuffers.size());
+}
+
+TEST_F(LoggerTest, getStagingBuffer) {
+    Logger::StagingBuffer* buffer = logger.getStagingBuffer();
+    EXPECT_EQ(&logger, buffer->logger);
+    EXPECT_EQ(buffer, logger.getStagingBuffer());
+    EXPECT_EQ(1u, logger.stagingBuffers.size());
+
+    // Switching to a different Logger gives up the old buffer.
+    Logger other(WARNING);
+    Logger::StagingBuffer* otherBuffer = other.getStagingBuffer();
+    EXPECT_NE(buffer, otherBuffer);
+    EXPECT_EQ(1, logger.stagingBuffers[0].use_count());
+}
+
+TEST_F(LoggerTest, stage_bufferFull) {
+    logger.setDeferredFormatting(true);
+    logger.stagingBufferSize = 96;
+    Logger::LogSite site(CodeLocation("file", 99, "func", "pretty"),
+            "message %d\n");
+    logger.getStagingBuffer();
+    {
+        // Keep the print thread from draining the buffer.
+        Logger::Lock lock(logger.mutex);
+        for (int i = 0; i < 4; i++) {
+            EXPECT_TRUE(logger.logDeferred(site, false, ERROR, i));
+        }
+        EXPECT_EQ(2, logger.stagingBuffers[0]->droppedEntries.load());
+    }
+    logger.sync();
+    EXPECT_TRUE(TestUtil::contains(getLog("__test.log", true),
+            "WARNING[1]: 2 log messages lost because of buffer overflow\n"));
+    EXPECT_TRUE(TestUtil::contains(getLog("__test.log"), "message 1\n"));
+    EXPECT_FALSE(TestUtil::contains(getLog("__test.log"), "message 2\n"));
+}
+
+TEST_F(LoggerTest, stagedTime) {
+    logger.testingLogTime = NULL;
+    Cycles::mockCyclesPerSec = 1e9;
+    logger.baseCycles = 1000000000;
+    logger.baseTime = {5, 900000000};
+    struct timespec time = logger.stagedTime(1200000000);
+    EXPECT_EQ(6, time.tv_sec);
+    EXPECT_EQ(100000000, time.tv_nsec);
+    time = logger.stagedTime(800000000);
+    EXPECT_EQ(5, time.tv_sec);
+    EXPECT_EQ(700000000, time.tv_nsec);
+    Cycles::mockCyclesPerSec = 0;
+}
+
+TEST_F(LoggerTest, LogSite_constructor) {
+    Logger::LogSite site(HERE, "a %d %-5s %*.*s %lu %5.2f %p 100%% %hhx\n");
+    EXPECT_TRUE(site.deferrable);
+    EXPECT_EQ(7u, site.numConversions);
+    EXPECT_EQ(9u, site.argumentCount);
+    EXPECT_STREQ("%lld", site.conversions[0].spec);
+    EXPECT_STREQ("%-5.*s", site.conversions[1].spec);
+    EXPECT_STREQ("%*.*s", site.conversions[2].spec);
+    EXPECT_TRUE(site.conversions[2].widthArgument);
+    EXPECT_TRUE(site.conversions[2].precisionArgument);
+    EXPECT_STREQ("%llu", site.conversions[3].spec);
+    EXPECT_STREQ("%5.2f", site.conversions[4].spec);
+    EXPECT_STREQ("%p", site.conversions[5].spec);
+    EXPECT_STREQ("%llx", site.conversions[6].spec);
+    EXPECT_EQ(Logger::LogSite::Conversion::CHAR, site.conversions[6].length);
+    EXPECT_EQ(2u, site.conversions[0].start);
+    EXPECT_EQ(4u, site.conversions[0].end);
+}
+
+TEST_F(LoggerTest, LogSite_constructor_notDeferrable) {
+    EXPECT_FALSE(Logger::LogSite(HERE, "%n\n").deferrable);
+    EXPECT_FALSE(Logger::LogSite(HERE, "%m\n").deferrable);
+    EXPECT_FALSE(Logger::LogSite(HERE, "%ls\n").deferrable);
+    EXPECT_FALSE(Logger::LogSite(HERE, "%1$d\n").deferrable);
+    EXPECT_FALSE(Logger::LogSite(HERE, "trailing %").deferrable);
+    EXPECT_TRUE(Logger::LogSite(HERE, "no conversions\n").deferrable);
+}
+
+TEST_F(LoggerTest, LogSite_decode) {
+    Logger::LogSite site(HERE, "[%*d] [%.*s] [%hd] [%u] %%\n");
+    logger.getStagingBuffer();
+    Logger::Lock lock(logger.mutex);
+    EXPECT_TRUE(logger.logDeferred(site, false, ERROR, 4, 12, 2, "xyz",
+            65537, -1));
+    const char* data = logger.stagingBuffers[0]->peek();
+    ASSERT_TRUE(data != NULL);
+    string message;
+    site.decode(data + sizeof(Logger::StagedEntry), &message);
+    EXPECT_EQ("[  12] [xy] [1] [4294967295] %\n", message);
+}
+
+TEST_F(LoggerTest, StagingBuffer_wrapAround) {
+    Logger::StagingBuffer buffer(NULL, 64);
+    uint32_t length = 24;
+    for (int i = 0; i < 2; i++) {
+        char* entry = buffer.reserve(length);
+        ASSERT_TRUE(entry != NULL);
+        memcpy(entry, &length, sizeof(length));
+        buffer.commit(length);
+    }
+    EXPECT_TRUE(buffer.reserve(length) == NULL);
+    EXPECT_EQ(buffer.storage, buffer.peek());
+    buffer.consume(length);
+
+    // Not enough room at the end: the new entry goes at the beginning.
+    char* entry = buffer.reserve(length);
+    EXPECT_EQ(buffer.storage, entry);
+    memcpy(entry, &length, sizeof(length));
+    buffer.commit(length);
+    EXPECT_EQ(88u, buffer.producerPos.load());
+
+    EXPECT_EQ(buffer.storage + 24, buffer.peek());
+    buffer.consume(length);
+    EXPECT_EQ(buffer.storage, buffer.peek());
+    EXPECT_EQ(64u, buffer.consumerPos.load());
+    buffer.consume(length);
+    EXPECT_TRUE(buffer.peek() == NULL);
+}
+
 // The following test is normally disabled, since it generates output
 // on stderr.
 #if 0
@@ -580,6 +779,19 @@ TEST_F(LoggerTest, LOG) {
             getLog("__test.log")));
 }
 
+TEST_F(LoggerTest, LOG_deferred) {
+    useSharedLogger();
+    Logger::get().setDeferredFormatting(true);
+    LOG(DEBUG, "x");
+    LOG(ERROR, "rofl: %d %s", 3, "lol");
+    const char* pattern = "^0000000003.500000000 "
+            "LoggerTest.cc:[[:digit:]]\\{1,4\\} in TestBody "
+            "ERROR\\[1\\]: rofl: 3 lol\n$";
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(pattern,
+            getLog("__test.log")));
+    Logger::get().setDeferredFormatting(false);
+}
+
 TEST_F(LoggerTest, DIE) {
     useSharedLogger();
     try {
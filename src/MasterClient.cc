@@ -226,6 +226,84 @@ GetHeadOfLogRpc::wait()
     return { respHdr->headSegmentId, respHdr->headSegmentOffset };
 }
 
+/**
+ * Obtain the access statistics for each of the tablets owned by a master.
+ * Used by the coordinator's TabletBalancer.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ * \param[out] serverStats
+ *      The master's statistics are returned here.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::getMasterStatistics(Context* context, ServerId serverId,
+        ProtoBuf::ServerStatistics* serverStats)
+{
+    GetMasterStatisticsRpc rpc(context, serverId);
+    rpc.wait(serverStats);
+}
+
+/**
+ * Constructor for GetMasterStatisticsRpc: initiates an RPC in the same way as
+ * #MasterClient::getMasterStatistics, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ */
+GetMasterStatisticsRpc::GetMasterStatisticsRpc(Context* context,
+        ServerId serverId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::GetServerStatistics::Response))
+{
+    allocHeader<WireFormat::GetServerStatistics>();
+    send();
+}
+
+/**
+ * Wait for a getMasterStatistics RPC to complete.
+ *
+ * \param[out] serverStats
+ *      The master's statistics are returned here.
+ * \param abortTime
+ *      If the RPC hasn't completed by this time (in Cycles::rdtsc units),
+ *      it is abandoned. The default is to wait indefinitely.
+ *
+ * \return
+ *      True means serverStats has been filled in; false means the RPC
+ *      timed out and was canceled.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+bool
+GetMasterStatisticsRpc::wait(ProtoBuf::ServerStatistics* serverStats,
+        uint64_t abortTime)
+{
+    if (!waitInternal(context->dispatch, abortTime)) {
+        cancel();
+        return false;
+    }
+    if (serverCrashed)
+        throw ServerNotUpException(HERE);
+    if (responseHeader->status != STATUS_OK)
+        ClientException::throwException(HERE, responseHeader->status);
+    const WireFormat::GetServerStatistics::Response* respHdr(
+            getResponseHeader<WireFormat::GetServerStatistics>());
+    ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
+            respHdr->serverStatsLength, serverStats);
+    return true;
+}
+
 /**
  * This RPC is sent to an index server to request that it insert an index
  * entry in an indexlet it holds.
@@ -760,6 +838,73 @@ RemoveIndexEntryRpc::handleIndexDoesntExist()
     response->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
 }
 
+/**
+ * Ask the master that owns a tablet to migrate it to another master. This
+ * is used by the coordinator to rebalance load; it returns once the
+ * migration has completed.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param newOwnerId
+ *      Identifier for the master that will own the tablet.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw UnknownTabletException
+ *      \a serverId no longer owns the tablet.
+ */
+void
+MasterClient::requestMigration(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId newOwnerId)
+{
+    RequestMigrationRpc rpc(context, serverId, tableId, firstKeyHash,
+            lastKeyHash, newOwnerId);
+    rpc.wait();
+}
+
+/**
+ * Constructor for RequestMigrationRpc: initiates an RPC in the same way as
+ * #MasterClient::requestMigration, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param newOwnerId
+ *      Identifier for the master that will own the tablet.
+ */
+RequestMigrationRpc::RequestMigrationRpc(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId newOwnerId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::MigrateTablet::Response))
+{
+    WireFormat::MigrateTablet::Request* reqHdr(
+            allocHeader<WireFormat::MigrateTablet>());
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = firstKeyHash;
+    reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->newOwnerMasterId = newOwnerId.getId();
+    send();
+}
+
 /**
  * Request that a master (with id currentOwnerId) split a given indexlet at
  * splitKey and migrate the second indexlet resulting from this split to server
@@ -50,6 +50,8 @@ class MasterClient {
     static void dropTabletOwnership(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
     static LogPosition getHeadOfLog(Context* context, ServerId serverId);
+    static void getMasterStatistics(Context* context, ServerId serverId,
+            ProtoBuf::ServerStatistics* serverStats);
     static void insertIndexEntry(Context* context,
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
@@ -77,6 +79,9 @@ class MasterClient {
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
             uint64_t primaryKeyHash);
+    static void requestMigration(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwnerId);
     static void splitAndMigrateIndexlet(Context* context,
             ServerId currentOwnerId, ServerId newOwnerId,
             uint64_t tableId, uint8_t indexId,
@@ -146,6 +151,21 @@ class GetHeadOfLogRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(GetHeadOfLogRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::getMasterStatistics
+ * request, allowing it to execute asynchronously.
+ */
+class GetMasterStatisticsRpc : public ServerIdRpcWrapper {
+  public:
+    GetMasterStatisticsRpc(Context* context, ServerId serverId);
+    ~GetMasterStatisticsRpc() {}
+    bool wait(ProtoBuf::ServerStatistics* serverStats,
+            uint64_t abortTime = ~0UL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetMasterStatisticsRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::insertIndexEntry
  * request, allowing it to execute asynchronously.
@@ -269,6 +289,23 @@ class RemoveIndexEntryRpc : public IndexRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(RemoveIndexEntryRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::requestMigration
+ * request, allowing it to execute asynchronously.
+ */
+class RequestMigrationRpc : public ServerIdRpcWrapper {
+  public:
+    RequestMigrationRpc(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwnerId);
+    ~RequestMigrationRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(RequestMigrationRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::splitAndMigrateIndexlet
  * request, allowing it to execute asynchronously.
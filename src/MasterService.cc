@@ -31,9 +31,12 @@
 #include "PerfCounter.h"
 #include "ProtoBuf.h"
 #include "RawMetrics.h"
+#include "RpcLatency.h"
 #include "Segment.h"
 #include "ServerRpcPool.h"
 #include "ShortMacros.h"
+#include "StringUtil.h"
+#include "TableSnapshot.h"
 #include "TableStats.h"
 #include "TimeTrace.h"
 #include "Transport.h"
@@ -85,7 +88,8 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
                     &masterTableMetadata,
                     &unackedRpcResults,
                     &transactionManager,
-                    &txRecoveryManager)
+                    &txRecoveryManager,
+                    &clusterClock)
     , tabletManager()
     , txRecoveryManager(context)
     , indexletManager(context, &objectManager)
@@ -134,6 +138,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
     }
 
     switch (opcode) {
+        case WireFormat::BulkLoad::opcode:
+            callHandler<WireFormat::BulkLoad, MasterService,
+                        &MasterService::bulkLoad>(rpc);
+            break;
         case WireFormat::DropTabletOwnership::opcode:
             callHandler<WireFormat::DropTabletOwnership, MasterService,
                         &MasterService::dropTabletOwnership>(rpc);
@@ -150,6 +158,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::Enumerate, MasterService,
                         &MasterService::enumerate>(rpc);
             break;
+        case WireFormat::ExportSnapshot::opcode:
+            callHandler<WireFormat::ExportSnapshot, MasterService,
+                        &MasterService::exportSnapshot>(rpc);
+            break;
         case WireFormat::GetHeadOfLog::opcode:
             callHandler<WireFormat::GetHeadOfLog, MasterService,
                         &MasterService::getHeadOfLog>(rpc);
@@ -166,6 +178,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::FillWithTestData, MasterService,
                         &MasterService::fillWithTestData>(rpc);
             break;
+        case WireFormat::ImportSnapshot::opcode:
+            callHandler<WireFormat::ImportSnapshot, MasterService,
+                        &MasterService::importSnapshot>(rpc);
+            break;
         case WireFormat::Increment::opcode:
             callHandler<WireFormat::Increment, MasterService,
                         &MasterService::increment>(rpc);
@@ -210,6 +226,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::ReadKeysAndValue, MasterService,
                         &MasterService::readKeysAndValue>(rpc);
             break;
+        case WireFormat::ReadSnapshot::opcode:
+            callHandler<WireFormat::ReadSnapshot, MasterService,
+                        &MasterService::readSnapshot>(rpc);
+            break;
         case WireFormat::ReceiveMigrationData::opcode:
             callHandler<WireFormat::ReceiveMigrationData, MasterService,
                         &MasterService::receiveMigrationData>(rpc);
@@ -313,6 +333,41 @@ volatile int MasterService::pauseIncrement = 0;
 volatile int MasterService::continueIncrement = 0;
 #endif
 
+/**
+ * Top-level server method to handle the BULK_LOAD request: adds a segment
+ * of objects packed by a client (see BulkLoader) to this master with a
+ * single log sync. See ObjectManager::bulkLoad for details.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::bulkLoad(const WireFormat::BulkLoad::Request* reqHdr,
+        WireFormat::BulkLoad::Response* respHdr,
+        Rpc* rpc)
+{
+    // The whole range must lie in one of our tablets; if not, the client's
+    // tablet map is out of date and it will redistribute the objects.
+    TabletManager::Tablet tablet;
+    if (!tabletManager.getTablet(reqHdr->tableId, reqHdr->firstKeyHash,
+            &tablet) || tablet.state != TabletManager::NORMAL ||
+            tablet.endKeyHash < reqHdr->lastKeyHash) {
+        respHdr->common.status = STATUS_UNKNOWN_TABLET;
+        return;
+    }
+
+    uint32_t segmentBytes = reqHdr->segmentBytes;
+    if (rpc->requestPayload->size() != sizeof32(*reqHdr) + segmentBytes) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+    SegmentCertificate certificate = reqHdr->certificate;
+    void* segment = rpc->requestPayload->getRange(sizeof32(*reqHdr),
+            segmentBytes);
+    respHdr->common.status = objectManager.bulkLoad(tablet.tableId,
+            tablet.startKeyHash, tablet.endKeyHash, segment, segmentBytes,
+            certificate, &respHdr->objectCount);
+}
+
 /**
  * Top-level server method to handle the DROP_TABLET_OWNERSHIP request.
  *
@@ -432,6 +487,12 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
 
     EnumerationIterator iter(*rpc->requestPayload,
             downCast<uint32_t>(sizeof(*reqHdr)), reqHdr->iteratorBytes);
+    EnumerationFilter filter;
+    if (!filter.parse(*rpc->requestPayload,
+            sizeof32(*reqHdr) + reqHdr->iteratorBytes, reqHdr->filterBytes)) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
 
     // Put at most maxPayloadBytes of enumerated objects in the reply. This
     // limit is used to leave enough room in the reply buffer for the response
@@ -439,7 +500,7 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
     uint32_t maxPayloadBytes = downCast<uint32_t>(
             Transport::MAX_RPC_LEN - sizeof(*respHdr) - (1 << 20));
     Enumeration enumeration(
-            reqHdr->tableId, reqHdr->keysOnly,
+            reqHdr->tableId, reqHdr->keysOnly, filter,
             reqHdr->tabletFirstHash,
             actualTabletStartHash, actualTabletEndHash,
             &respHdr->tabletFirstHash, iter,
@@ -455,6 +516,56 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
     respHdr->iteratorBytes = iteratorBytes;
 }
 
+/**
+ * Top-level server method to handle the EXPORT_SNAPSHOT request: writes
+ * a snapshot of one of this master's tablets to a file on local disk
+ * (see TableSnapshot).
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::exportSnapshot(
+        const WireFormat::ExportSnapshot::Request* reqHdr,
+        WireFormat::ExportSnapshot::Response* respHdr,
+        Rpc* rpc)
+{
+    TabletManager::Tablet tablet;
+    if (!tabletManager.getTablet(reqHdr->tableId, reqHdr->keyHash, &tablet)
+            || tablet.state != TabletManager::NORMAL) {
+        respHdr->common.status = STATUS_UNKNOWN_TABLET;
+        return;
+    }
+
+    uint32_t offset = sizeof32(*reqHdr);
+    string path, basePath;
+    if (!getSnapshotPath(getString(rpc->requestPayload, offset,
+            reqHdr->pathLength), &path) || (reqHdr->basePathLength != 0 &&
+            !getSnapshotPath(getString(rpc->requestPayload,
+            offset + reqHdr->pathLength, reqHdr->basePathLength),
+            &basePath))) {
+        respHdr->common.status = STATUS_INVALID_PARAMETER;
+        return;
+    }
+
+    try {
+        Tub<TableSnapshot> base;
+        if (!basePath.empty())
+            base.construct(basePath);
+        TableSnapshot::Header header;
+        TableSnapshot::create(&objectManager, tablet.tableId,
+                tablet.startKeyHash, tablet.endKeyHash, path, base.get(),
+                &header);
+        respHdr->firstKeyHash = header.firstKeyHash;
+        respHdr->lastKeyHash = header.lastKeyHash;
+        respHdr->objectCount = header.objectCount;
+    } catch (SnapshotException& e) {
+        LOG(WARNING, "Couldn't export snapshot of tablet %lu [0x%lx,0x%lx]: "
+                "%s", tablet.tableId, tablet.startKeyHash, tablet.endKeyHash,
+                e.what());
+        respHdr->common.status = STATUS_INTERNAL_ERROR;
+    }
+}
+
 /**
  * Top-level server method to handle the GET_HEAD_OF_LOG request.
  */
@@ -497,11 +608,59 @@ MasterService::getServerStatistics(
 {
     ProtoBuf::ServerStatistics serverStats;
     tabletManager.getStatistics(&serverStats);
+    for (int i = 0; i < serverStats.tabletentry_size(); i++) {
+        ProtoBuf::ServerStatistics_TabletEntry* entry =
+                serverStats.mutable_tabletentry(i);
+        uint64_t byteCount = TableStats::estimateByteCount(
+                &masterTableMetadata, entry->table_id(),
+                entry->start_key_hash(), entry->end_key_hash());
+        if (byteCount > 0)
+            entry->set_byte_count(byteCount);
+    }
     SpinLock::getStatistics(serverStats.mutable_spin_lock_stats());
+    RpcLatency::getStatistics(&serverStats);
     respHdr->serverStatsLength = serializeToResponse(
             rpc->replyPayload, &serverStats);
 }
 
+/**
+ * Find the file named by an EXPORT_SNAPSHOT or IMPORT_SNAPSHOT request.
+ * Clients may only name files within the configured snapshot directory.
+ *
+ * \param name
+ *      File name from the request; must be relative to the snapshot
+ *      directory, and may not contain ".." components.
+ * \param[out] path
+ *      Set to the full path of the file.
+ * \return
+ *      True if the name is acceptable; false (after logging a warning) if
+ *      it isn't or snapshots are disabled on this master.
+ */
+bool
+MasterService::getSnapshotPath(const char* name, string* path)
+{
+    const string& dir = config->master.snapshotDir;
+    if (dir.empty()) {
+        LOG(WARNING, "Rejecting snapshot %s: no snapshot directory is "
+                "configured", name);
+        return false;
+    }
+    if (name[0] == '\0' || name[0] == '/') {
+        LOG(WARNING, "Rejecting snapshot %s: name must be relative to the "
+                "snapshot directory", name);
+        return false;
+    }
+    foreach (const string& component, StringUtil::split(name, '/')) {
+        if (component == "..") {
+            LOG(WARNING, "Rejecting snapshot %s: name may not contain \"..\"",
+                    name);
+            return false;
+        }
+    }
+    *path = dir + "/" + name;
+    return true;
+}
+
 /**
  * Fill a master server with the given number of objects, each of the
  * same given size. Objects are added to all tables in the master in
@@ -589,6 +748,51 @@ MasterService::fillWithTestData(
     LOG(NOTICE, "Done writing objects.");
 }
 
+/**
+ * Top-level server method to handle the IMPORT_SNAPSHOT request: loads
+ * the objects in a snapshot file written by EXPORT_SNAPSHOT into a tablet
+ * owned by this master (see TableSnapshot::load).
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::importSnapshot(
+        const WireFormat::ImportSnapshot::Request* reqHdr,
+        WireFormat::ImportSnapshot::Response* respHdr,
+        Rpc* rpc)
+{
+    string path;
+    if (!getSnapshotPath(getString(rpc->requestPayload, sizeof32(*reqHdr),
+            reqHdr->pathLength), &path)) {
+        respHdr->common.status = STATUS_INVALID_PARAMETER;
+        return;
+    }
+    try {
+        TableSnapshot snapshot(path);
+        const TableSnapshot::Header& header = snapshot.getHeader();
+
+        // Key hashes depend on the table id, so the objects can only be
+        // loaded into a table with the same id as the one exported. The
+        // client routed the request by key hash, so a missing tablet means
+        // the snapshot doesn't match the request (retrying won't help).
+        TabletManager::Tablet tablet;
+        if (header.tableId != reqHdr->tableId ||
+                !tabletManager.getTablet(header.tableId, header.firstKeyHash,
+                &tablet) || tablet.endKeyHash < header.lastKeyHash) {
+            LOG(WARNING, "Snapshot %s (tablet %lu [0x%lx,0x%lx]) doesn't "
+                    "match a tablet owned by this master", path.c_str(),
+                    header.tableId, header.firstKeyHash, header.lastKeyHash);
+            respHdr->common.status = STATUS_INVALID_PARAMETER;
+            return;
+        }
+        respHdr->objectCount = snapshot.load(&objectManager);
+    } catch (SnapshotException& e) {
+        LOG(WARNING, "Couldn't import snapshot %s: %s", path.c_str(),
+                e.what());
+        respHdr->common.status = STATUS_INTERNAL_ERROR;
+    }
+}
+
 /**
  * Top-level server method to handle the INCREMENT request.
  *
@@ -897,17 +1101,14 @@ MasterService::lookupIndexKeys(
  * Helper function to avoid code duplication in migrateTablet which copies a log
  * entry to a segment for migration if it is a live log entry.
  *
- * If the segment is full, it will send the segment to the target of the
- * migration, destroy the segment, and create a new one.
- *
- * If there is an error, this method will set the status code of the response
- * to the client to be an error.
+ * Entries are packed into segments by the MigrationSender, which ships each
+ * one to the target of the migration as it fills.
  *
  * \param it
  *      The iterator that points at the object we are attempting to migrate.
- * \param[out] transferSeg
- *      Segment object that we append objects to, and possibly send when it gets
- *      full.
+ * \param sender
+ *      Accumulates the migrated entries and sends them to the receiving
+ *      master.
  * \param[out] entryTotals
  *      Array indexed by type of the total number of log entries copied into
  *      segments for transfer thus far, which we increment whenever we append an
@@ -922,10 +1123,13 @@ MasterService::lookupIndexKeys(
  *      Lowest key hash that will be migrated.
  * \param lastKeyHash
  *      Highest key hash that will be migrated.
- * \param receiver
- *      ServerId of the master that is receiving the migration data. Each time
- *      a transfer segment fills, this server will be sent an RPC containing
- *      the data.
+ * \param objectAlreadySent
+ *      True means the entry was appended before the migration's hash table
+ *      walk, which has already dealt with any object in it. Then only the
+ *      RpcResult part of a LOG_ENTRY_TYPE_OBJRPCRESULT entry is sent (as a
+ *      LOG_ENTRY_TYPE_RPCRESULT entry): the object may have been deleted
+ *      since, and sending it without its tombstone would bring it back to
+ *      life on the receiver.
  * \return
  *      Returns STATUS_OK on success (either the entry is ignored or
  *      successfully added to the segment) or another status failure (an entry
@@ -934,17 +1138,20 @@ MasterService::lookupIndexKeys(
 Status
 MasterService::migrateSingleLogEntry(
         SegmentIterator& it,
-        Tub<Segment>& transferSeg,
+        MigrationSender& sender,
         uint64_t entryTotals[],
         uint64_t& totalBytes,
         uint64_t tableId,
         uint64_t firstKeyHash,
         uint64_t lastKeyHash,
-        ServerId receiver)
+        bool objectAlreadySent)
 {
     LogEntryType type = it.getType();
     if (type != LOG_ENTRY_TYPE_OBJ &&
         type != LOG_ENTRY_TYPE_OBJTOMB &&
+        type != LOG_ENTRY_TYPE_OBJMANIFEST &&
+        type != LOG_ENTRY_TYPE_OBJCHUNK &&
+        type != LOG_ENTRY_TYPE_OBJRPCRESULT &&
         type != LOG_ENTRY_TYPE_RPCRESULT &&
         type != LOG_ENTRY_TYPE_PREP &&
         type != LOG_ENTRY_TYPE_PREPTOMB &&
@@ -962,7 +1169,10 @@ MasterService::migrateSingleLogEntry(
     uint64_t entryTableId = 0;
     KeyHash entryKeyHash = 0;
 
-    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB ||
+            type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+            type == LOG_ENTRY_TYPE_OBJCHUNK ||
+            type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
         Key key(type, buffer);
         entryTableId = key.getTableId();
         entryKeyHash = key.getHash();
@@ -1013,7 +1223,9 @@ MasterService::migrateSingleLogEntry(
     }
 
 
-    if (type == LOG_ENTRY_TYPE_OBJ) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+            type == LOG_ENTRY_TYPE_OBJCHUNK ||
+            type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
         // Note: there used to be code here to ignore objects that aren't
         // pointed to by the hash table, under the assumption that they are
         // dead. However, this doesn't work in the presence of concurrent
@@ -1021,7 +1233,8 @@ MasterService::migrateSingleLogEntry(
         // that is not yet visible. Thus, we must send objects even if they
         // don't appear to be alive. If an object really is dead, we will
         // also send a tombstone, which will allow the object to be filtered at
-        // the destination.
+        // the destination. Chunks of chunked objects are sent the same way;
+        // stale ones are discarded by the destination once migration ends.
 
     } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
         // We must always send tombstones, since an object we may have sent
@@ -1035,41 +1248,145 @@ MasterService::migrateSingleLogEntry(
         // iterating and only send newer tombstones.
     }
 
+    if (type == LOG_ENTRY_TYPE_OBJRPCRESULT && objectAlreadySent) {
+        Buffer rpcResultBuffer;
+        rpcResultBuffer.appendExternal(&buffer,
+                RpcResult::objectLengthInCombinedEntry(buffer),
+                RpcResult::lengthInCombinedEntry(buffer));
+        Status status = migrateEntry(LOG_ENTRY_TYPE_RPCRESULT,
+                rpcResultBuffer, sender, entryTotals, totalBytes);
+        if (status != STATUS_OK)
+            return status;
+        sender.sendQueued();
+        TEST_LOG("Migrated RpcResult of log entry type %s",
+                LogEntryTypeHelpers::toString(type));
+        return STATUS_OK;
+    }
+
+    Status status = migrateEntry(type, buffer, sender, entryTotals,
+            totalBytes);
+    if (status != STATUS_OK)
+        return status;
+    sender.sendQueued();
+
+    TEST_LOG("Migrated log entry type %s",
+            LogEntryTypeHelpers::toString(type));
+    return STATUS_OK;
+}
+
+/**
+ * Add a log entry to the data being sent to the target of a migration.
+ * This method never blocks, so it can be invoked with hash table bucket
+ * locks held.
+ *
+ * \param type
+ *      Type of the entry.
+ * \param buffer
+ *      Contents of the entry.
+ * \param sender
+ *      Accumulates the migrated entries and sends them to the receiving
+ *      master.
+ * \param[out] entryTotals
+ *      Array indexed by type of the total number of log entries migrated
+ *      thus far; incremented for this entry.
+ * \param[out] totalBytes
+ *      The total number of bytes migrated thus far; incremented by the size
+ *      of this entry.
+ * \return
+ *      STATUS_OK, or STATUS_INTERNAL_ERROR if the entry is too large to fit
+ *      in a segment.
+ */
+Status
+MasterService::migrateEntry(LogEntryType type, Buffer& buffer,
+        MigrationSender& sender, uint64_t entryTotals[], uint64_t& totalBytes)
+{
     entryTotals[type]++;
     totalBytes += buffer.size();
     PerfStats::threadStats.migrationPhase1Bytes += buffer.size();
 
-    if (!transferSeg)
-        transferSeg.construct();
-
 #if !MIGRATION_SKIP_APPEND
-    // If we can't fit it, send the current buffer and retry.
-    if (!transferSeg->append(type, buffer)) {
-        transferSeg->close();
-        LOG(DEBUG, "Sending migration segment");
-        if (expect_true(receiver != ServerId{})) {
-#if !MIGRATION_SKIP_TX
-            MasterClient::receiveMigrationData(context, receiver,
-                    transferSeg.get(), tableId, firstKeyHash);
+    if (!sender.append(type, buffer)) {
+        LOG(ERROR, "Tablet migration failed: could not fit object "
+                "into empty segment (obj bytes %u)",
+                buffer.size());
+        return STATUS_INTERNAL_ERROR;
+    }
 #endif
-        }
+    return STATUS_OK;
+}
 
-        transferSeg.destroy();
-        transferSeg.construct();
+/**
+ * Invoked by ObjectManager::forEachTabletEntry for each object in a
+ * tablet being migrated; adds the object to the migrated data.
+ *
+ * \param type
+ *      Type of the entry.
+ * \param buffer
+ *      Contents of the entry.
+ * \param reference
+ *      Location of the entry in the log (unused).
+ * \param cookie
+ *      The MigrationParameters for the migration.
+ */
+void
+MasterService::migrateHashTableEntry(LogEntryType type, Buffer& buffer,
+        Log::Reference reference, void* cookie)
+{
+    MigrationParameters* params = static_cast<MigrationParameters*>(cookie);
+    if (params->status != STATUS_OK)
+        return;
+    params->status = params->service->migrateEntry(type, buffer,
+            *params->sender, params->entryTotals, *params->totalBytes);
+}
 
-        // If it doesn't fit this time, we're in trouble.
-        if (!transferSeg->append(type, buffer)) {
-            LOG(ERROR, "Tablet migration failed: could not fit object "
-                    "into empty segment (obj bytes %u)",
-                    buffer.size());
-            return STATUS_INTERNAL_ERROR;
-        }
-    }
-#endif
+/**
+ * Decide whether the current entry of a log scan done for migration has
+ * already been accounted for by the hash table walk that preceded it.
+ * That is the case for objects (and their tombstones) appended before the
+ * walk started: live ones were found through the hash table, and dead ones
+ * need not be sent, since the receiver never had them. For an object stored
+ * with an RpcResult, only the object is covered, since the walk sends only
+ * the object; the RpcResult must still be sent (see migrateSingleLogEntry).
+ *
+ * \param it
+ *      Iterator positioned at the entry in question.
+ * \param startPosition
+ *      Log head position when the hash table walk started. The head must
+ *      have been rolled over to a new segment at that point, so that every
+ *      entry appended before the walk is in a segment with a lower id.
+ *      Offsets are not compared: in-memory compaction rewrites a segment
+ *      (keeping its id) and moves the entries within it.
+ */
+static bool
+coveredByHashTableWalk(LogIterator& it, LogPosition startPosition)
+{
+    LogEntryType type = it.getType();
+    if (type != LOG_ENTRY_TYPE_OBJ &&
+        type != LOG_ENTRY_TYPE_OBJTOMB &&
+        type != LOG_ENTRY_TYPE_OBJMANIFEST &&
+        type != LOG_ENTRY_TYPE_OBJCHUNK &&
+        type != LOG_ENTRY_TYPE_OBJRPCRESULT)
+        return false;
+    return it.getSegment()->id < startPosition.getSegmentId();
+}
 
-    TEST_LOG("Migrated log entry type %s",
-            LogEntryTypeHelpers::toString(type));
-    return STATUS_OK;
+/**
+ * Returns true if a segment may contain entries other than objects that
+ * must move with a migrating tablet (linearizable RPC results and
+ * transaction records), so a migration's log scan must examine it.
+ *
+ * \param segment
+ *      Segment to check.
+ */
+static bool
+mayHoldTabletMetadata(LogSegment* segment)
+{
+    return segment->getEntryCount(LOG_ENTRY_TYPE_RPCRESULT) != 0 ||
+           segment->getEntryCount(LOG_ENTRY_TYPE_OBJRPCRESULT) != 0 ||
+           segment->getEntryCount(LOG_ENTRY_TYPE_PREP) != 0 ||
+           segment->getEntryCount(LOG_ENTRY_TYPE_PREPTOMB) != 0 ||
+           segment->getEntryCount(LOG_ENTRY_TYPE_TXDECISION) != 0 ||
+           segment->getEntryCount(LOG_ENTRY_TYPE_TXPLIST) != 0;
 }
 
 /**
@@ -1130,24 +1447,64 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         context->serverList->toString(receiver).c_str());
 
     // We'll send over objects in Segment containers for better network
-    // efficiency and convenience.
-    Tub<Segment> transferSeg;
+    // efficiency and convenience. Several are kept in flight at once so
+    // that the receiver replays one while we're filling the next.
+#if MIGRATION_SKIP_TX
+    MigrationSender sender(context, ServerId(), tableId, firstKeyHash);
+#else
+    MigrationSender sender(context, receiver, tableId, firstKeyHash);
+#endif
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
 
-    LogIterator it(*objectManager.getLog());
-    // Phase 1: scan the log from oldest to newest entries until we reach
-    // the head segment.
+    // Phase 1: copy the tablet's objects, finding them through the hash
+    // table rather than by scanning the whole log (the tablet may hold
+    // only a small fraction of the master's data). The head is rolled over
+    // first, so anything appended during the walk lands in a segment at
+    // least as new as startPosition's and is picked up by the log scan
+    // below; some objects may be sent twice, which is harmless since the
+    // receiver replays migration data the same way as recovery data.
     CycleCounter<> phase1Cycles{};
+    Log* log = objectManager.getLog();
+    LogPosition startPosition = log->rollHeadOver();
+    HashTable* objectMap = objectManager.getObjectMap();
+    MigrationParameters params = { this, &sender, entryTotals, &totalBytes,
+                                   STATUS_OK };
+    for (uint64_t i = 0; i < objectMap->getNumBuckets(); i++) {
+        objectManager.forEachTabletEntry(i, tableId, firstKeyHash,
+                lastKeyHash, migrateHashTableEntry, &params);
+        if (params.status != STATUS_OK) {
+            respHdr->common.status = params.status;
+            return;
+        }
+        sender.sendQueued();
+    }
+
+    // Phase 2: scan the log from oldest to newest entries until we reach
+    // the head segment, for RPC results and transaction records belonging
+    // to the tablet and for entries appended since startPosition. Older
+    // segments without any such records are skipped without reading them.
+    LogIterator it(*log);
     if (!it.isDone()) {
         while (true) {
-            Status error = migrateSingleLogEntry(
-                    *it.getCurrentSegmentIterator(),
-                    transferSeg, entryTotals, totalBytes,
-                    tableId, firstKeyHash, lastKeyHash,
-                    receiver);
-            if (error) return;
+            if (!it.onHead() &&
+                    it.getSegment()->id < startPosition.getSegmentId() &&
+                    !mayHoldTabletMetadata(it.getSegment())) {
+                it.skipSegment();
+                continue;
+            }
+            bool covered = coveredByHashTableWalk(it, startPosition);
+            if (!covered || it.getType() == LOG_ENTRY_TYPE_OBJRPCRESULT) {
+                Status error = migrateSingleLogEntry(
+                        *it.getCurrentSegmentIterator(),
+                        sender, entryTotals, totalBytes,
+                        tableId, firstKeyHash, lastKeyHash, covered);
+                if (error) {
+                    respHdr->common.status = error;
+                    return;
+                }
+            }
 
             if (it.onHead())
                 break;
@@ -1156,7 +1513,7 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
     }
     PerfStats::threadStats.migrationPhase1Cycles += phase1Cycles.stop();
 
-    // Phase 2: block new writes and let current writes finish
+    // Phase 3: block new writes and let current writes finish
     if (it.onHead()) {
         tabletManager.changeState(tableId, firstKeyHash, lastKeyHash,
                 TabletManager::NORMAL, TabletManager::LOCKED_FOR_MIGRATION);
@@ -1165,26 +1522,26 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         LogProtector::wait(context, Transport::ServerRpc::APPEND_ACTIVITY);
     }
 
-    // Phase 3: finish iterating over the remaining log entries.
+    // Phase 4: finish iterating over the remaining log entries.
     while (true) {
         it.next();
         if (it.isDone())
             break;
+        bool covered = coveredByHashTableWalk(it, startPosition);
+        if (covered && it.getType() != LOG_ENTRY_TYPE_OBJRPCRESULT)
+            continue;
         Status error = migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
-        if (error) return;
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash, covered);
+        if (error) {
+            respHdr->common.status = error;
+            return;
+        }
     }
 
-    if (transferSeg) {
-        transferSeg->close();
-        LOG(DEBUG, "Sending last migration segment");
-        MasterClient::receiveMigrationData(context, receiver,
-                transferSeg.get(), tableId, firstKeyHash);
-        transferSeg.destroy();
-    }
+    LOG(DEBUG, "Sending last migration segment");
+    sender.finish();
 
     // Now that all data has been transferred, we can reassign ownership of
     // the tablet. If this succeeds, we are free to drop the tablet. The
@@ -1741,14 +2098,17 @@ MasterService::read(const WireFormat::Read::Request* reqHdr,
 
     RejectRules rejectRules = reqHdr->rejectRules;
     bool valueOnly = true;
+    bool degraded = false;
     uint32_t initialLength = rpc->replyPayload->size();
     respHdr->common.status = objectManager.readObject(
-            key, rpc->replyPayload, &rejectRules, &respHdr->version, valueOnly);
+            key, rpc->replyPayload, &rejectRules, &respHdr->version, valueOnly,
+            reqHdr->allowDegraded ? &degraded : NULL);
 
     if (respHdr->common.status != STATUS_OK)
         return;
 
     respHdr->length = rpc->replyPayload->size() - initialLength;
+    respHdr->degraded = degraded;
 }
 
 /**
@@ -1797,6 +2157,46 @@ MasterService::readKeysAndValue(
     respHdr->length = rpc->replyPayload->size() - initialLength;
 }
 
+/**
+ * Top-level server method to handle the READ_SNAPSHOT request, which reads
+ * an object as it was at a given cluster time (see
+ * ObjectManager::readSnapshot).
+ *
+ * \copydetails MasterService::readKeysAndValue
+ */
+void
+MasterService::readSnapshot(
+        const WireFormat::ReadSnapshot::Request* reqHdr,
+        WireFormat::ReadSnapshot::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+
+    if (stringKey == NULL) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+
+    // Writes that happen on this master from now on must not be visible
+    // in the snapshot, so they must be stamped after the snapshot time.
+    ClusterTime snapshotTime(reqHdr->snapshotTime);
+    clusterClock.updateClock(snapshotTime);
+
+    uint32_t initialLength = rpc->replyPayload->size();
+    respHdr->common.status = objectManager.readSnapshot(
+            key, snapshotTime, rpc->replyPayload, &respHdr->version);
+
+    if (respHdr->common.status != STATUS_OK)
+        return;
+
+    respHdr->length = rpc->replyPayload->size() - initialLength;
+}
+
 /**
  * Top-level server method to handle the RECEIVE_MIGRATION_DATA request.
  *
@@ -2477,6 +2877,10 @@ MasterService::takeTabletOwnership(
             LOG(NOTICE, "Took ownership of existing tablet [0x%lx,0x%lx] in "
                     "tableId %lu in NOT_READY state", reqHdr->firstKeyHash,
                     reqHdr->lastKeyHash, reqHdr->tableId);
+
+            // The tablet's objects were recovered or migrated here without
+            // their history, so older snapshots can't be served.
+            objectManager.forgetHistory();
         } else {
             LOG(WARNING, "Could not take ownership of tablet [0x%lx,0x%lx] in "
                     "tableId %lu: overlaps with one or more different ranges.",
@@ -2577,6 +2981,10 @@ MasterService::txDecision(const WireFormat::TxDecision::Request* reqHdr,
     }
 
     if (reqHdr->decision == WireFormat::TxDecision::COMMIT) {
+        // Every participant stamps the transaction's writes with the same
+        // cluster time, so that they are visible to exactly the same
+        // snapshots.
+        ClusterTime commitTime(reqHdr->commitTime);
         for (uint32_t i = 0; i < participantCount; ++i) {
             TabletManager::Tablet tablet;
             if (!tabletManager.getTablet(participants[i].tableId,
@@ -2605,9 +3013,11 @@ MasterService::txDecision(const WireFormat::TxDecision::Request* reqHdr,
             if (op.header.type == WireFormat::TxPrepare::READ) {
                 status = objectManager.commitRead(op, opRef);
             } else if (op.header.type == WireFormat::TxPrepare::REMOVE) {
-                status = objectManager.commitRemove(op, opRef);
+                status = objectManager.commitRemove(op, opRef, NULL,
+                                                    commitTime);
             } else if (op.header.type == WireFormat::TxPrepare::WRITE) {
-                status = objectManager.commitWrite(op, opRef);
+                status = objectManager.commitWrite(op, opRef, NULL,
+                                                   commitTime);
             }
 
             if (status != STATUS_OK) {
@@ -3088,6 +3498,13 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
         rh->recordCompletion(rpcResultPtr);
     }
 
+    // Snapshot reads served by this master so far have advanced its clock,
+    // and any later ones will wait for the locks taken above. Committing no
+    // earlier than the current time thus keeps the transaction's writes out
+    // of all of those snapshots.
+    ClusterTime prepareTime = clusterClock.getTime();
+    respHdr->clusterTime = prepareTime.getEncoded();
+
     // when it is a single server transaction, we commit the transaction
     // preemptively, so that a client doesn't need to send decision RPC.
     // Assume that if there is at least one READ-ONLY request they should all
@@ -3114,9 +3531,11 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
             if (op.header.type == WireFormat::TxPrepare::READ) {
                 status = objectManager.commitRead(op, opRef);
             } else if (op.header.type == WireFormat::TxPrepare::REMOVE) {
-                status = objectManager.commitRemove(op, opRef);
+                status = objectManager.commitRemove(op, opRef, NULL,
+                                                    prepareTime);
             } else if (op.header.type == WireFormat::TxPrepare::WRITE) {
-                status = objectManager.commitWrite(op, opRef);
+                status = objectManager.commitWrite(op, opRef, NULL,
+                                                   prepareTime);
             }
 
             // When an error happens in preemptive commit, we just respond
@@ -3833,7 +4252,7 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
              recoveryPartition.tablet()) {
         bool added = tabletManager.addTablet(newTablet.table_id(),
                 newTablet.start_key_hash(), newTablet.end_key_hash(),
-                TabletManager::NOT_READY);
+                TabletManager::NOT_READY, true);
         if (!added) {
             throw Exception(HERE, format("Cannot recover tablet that overlaps "
                     "an already existing one (tablet to recover: %lu "
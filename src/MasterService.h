@@ -25,6 +25,7 @@
 #include "LogIterator.h"
 #include "HashTable.h"
 #include "MasterTableMetadata.h"
+#include "MigrationSender.h"
 #include "Object.h"
 #include "ObjectFinder.h"
 #include "ObjectManager.h"
@@ -148,6 +149,9 @@ class MasterService : public Service {
 #endif
 
   PRIVATE:
+    void bulkLoad(const WireFormat::BulkLoad::Request* reqHdr,
+                WireFormat::BulkLoad::Response* respHdr,
+                Rpc* rpc);
     void dropTabletOwnership(
                 const WireFormat::DropTabletOwnership::Request* reqHdr,
                 WireFormat::DropTabletOwnership::Response* respHdr,
@@ -162,6 +166,9 @@ class MasterService : public Service {
     void enumerate(const WireFormat::Enumerate::Request* reqHdr,
                 WireFormat::Enumerate::Response* respHdr,
                 Rpc* rpc);
+    void exportSnapshot(const WireFormat::ExportSnapshot::Request* reqHdr,
+                WireFormat::ExportSnapshot::Response* respHdr,
+                Rpc* rpc);
     void getHeadOfLog(const WireFormat::GetHeadOfLog::Request* reqHdr,
                 WireFormat::GetHeadOfLog::Response* respHdr,
                 Rpc* rpc);
@@ -175,6 +182,10 @@ class MasterService : public Service {
     void fillWithTestData(const WireFormat::FillWithTestData::Request* reqHdr,
                 WireFormat::FillWithTestData::Response* respHdr,
                 Rpc* rpc);
+    bool getSnapshotPath(const char* name, string* path);
+    void importSnapshot(const WireFormat::ImportSnapshot::Request* reqHdr,
+                WireFormat::ImportSnapshot::Response* respHdr,
+                Rpc* rpc);
     void increment(const WireFormat::Increment::Request* reqHdr,
                 WireFormat::Increment::Response* respHdr,
                 Rpc* rpc);
@@ -213,14 +224,39 @@ class MasterService : public Service {
                 WireFormat::SplitAndMigrateIndexlet::Response* respHdr);
   public: // For MigrateTabletBenchmark.
     Status migrateSingleLogEntry(SegmentIterator& it,
-                Tub<Segment>& transferSeg,
+                MigrationSender& sender,
                 uint64_t entryTotals[],
                 uint64_t& totalBytes,
                 uint64_t tableId,
                 uint64_t firstKeyHash,
                 uint64_t lastKeyHash,
-                ServerId receiver);
+                bool objectAlreadySent = false);
   PRIVATE:
+    /**
+     * Struct used to pass parameters into migrateHashTableEntry through
+     * ObjectManager::forEachTabletEntry.
+     */
+    struct MigrationParameters {
+        /// Service performing the migration.
+        MasterService* service;
+
+        /// Accumulates the migrated entries and sends them.
+        MigrationSender* sender;
+
+        /// Per-type entry counts and total bytes migrated so far.
+        uint64_t* entryTotals;
+        uint64_t* totalBytes;
+
+        /// Set to an error if an entry couldn't be migrated.
+        Status status;
+    };
+
+    Status migrateEntry(LogEntryType type, Buffer& buffer,
+                MigrationSender& sender,
+                uint64_t entryTotals[],
+                uint64_t& totalBytes);
+    static void migrateHashTableEntry(LogEntryType type, Buffer& buffer,
+                Log::Reference reference, void* cookie);
     void migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
                 WireFormat::MigrateTablet::Response* respHdr,
                 Rpc* rpc);
@@ -252,6 +288,9 @@ class MasterService : public Service {
     void readKeysAndValue(const WireFormat::ReadKeysAndValue::Request* reqHdr,
                 WireFormat::ReadKeysAndValue::Response* respHdr,
                 Rpc* rpc);
+    void readSnapshot(const WireFormat::ReadSnapshot::Request* reqHdr,
+                WireFormat::ReadSnapshot::Response* respHdr,
+                Rpc* rpc);
     void receiveMigrationData(
                 const WireFormat::ReceiveMigrationData::Request* reqHdr,
                 WireFormat::ReceiveMigrationData::Response* respHdr,
@@ -318,11 +357,18 @@ class MasterService : public Service {
                     "Duplicate RPC is in progress.");
         }
 
-        //Obtain saved RPC response from log.
+        //Obtain saved RPC response from log. Writes store it in the same
+        //entry as the object they wrote.
         Buffer resultBuffer;
         Log::Reference resultRef(result);
-        objectManager.getLog()->getEntry(resultRef, resultBuffer);
-        RpcResult savedRec(resultBuffer);
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        if (objectManager.getLog()->getRawEntry(resultRef, resultBuffer) ==
+                LOG_ENTRY_TYPE_OBJRPCRESULT) {
+            offset = RpcResult::objectLengthInCombinedEntry(resultBuffer);
+            length = RpcResult::lengthInCombinedEntry(resultBuffer);
+        }
+        RpcResult savedRec(resultBuffer, offset, length);
         return *(reinterpret_cast<const typename LinearizableRpcType::Response*>
                                                         (savedRec.getResp()));
     }
@@ -20,6 +20,7 @@
 #include "BackupStorage.h"
 #include "Buffer.h"
 #include "Cycles.h"
+#include "EnumerationFilter.h"
 #include "EnumerationIterator.h"
 #include "LeaseCommon.h"
 #include "LogIterator.h"
@@ -619,6 +620,104 @@ TEST_F(MasterServiceTest, enumerate_mergeTablet) {
     EXPECT_EQ(0U, objects.size());
 }
 
+TEST_F(MasterServiceTest, enumerate_filter) {
+    uint64_t version0, version1, version2;
+    ramcloud->write(1, "a0", 2, "abcdef", 6, NULL, &version0, false);
+    ramcloud->write(1, "b1", 2, "ghijkl", 6, NULL, &version1, false);
+    ramcloud->write(1, "b2", 2, "ghimno", 6, NULL, &version2, false);
+
+    // Key prefix, version range, and value pattern are all applied, and
+    // keysOnly still drops the value even though the server examined it.
+    EnumerationFilter filter;
+    filter.setKeyPrefix("b", 1);
+    filter.setVersionRange(version1, version2);
+    filter.setValuePattern(3, "jk", 2);
+    Buffer iter, nextIter, objects;
+    EnumerateTableRpc rpc(ramcloud.get(), 1, true, 0, iter, objects,
+            &filter);
+    EXPECT_EQ(0U, rpc.wait(nextIter));
+    ASSERT_EQ(33U, objects.size());
+    EXPECT_EQ(29U, *objects.getOffset<uint32_t>(0));
+    Object object(objects, 4, 29);
+    EXPECT_EQ("b1", string(reinterpret_cast<const char*>(
+            object.getKey()), 2));
+    EXPECT_EQ(version1, object.getVersion());
+
+    // Value slices.
+    EnumerationFilter slice;
+    slice.setValueSlice(4, 100);
+    iter.reset();
+    EnumerateTableRpc rpc2(ramcloud.get(), 1, false, 0, iter, objects,
+            &slice);
+    rpc2.wait(nextIter);
+    EXPECT_EQ(3 * (4 + 24 + 3 + 2 + 2U), objects.size());
+}
+
+TEST_F(MasterServiceTest, exportSnapshot) {
+    char dir[] = "/tmp/ramcloud-master-snapshot-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    masterServer->config.master.snapshotDir = dir;
+    ramcloud->write(1, "a", 1, "value a");
+    ramcloud->write(1, "b", 1, "value b");
+
+    uint64_t firstKeyHash, lastKeyHash;
+    ExportSnapshotRpc rpc(ramcloud.get(), 1, 0, "full");
+    EXPECT_EQ(2U, rpc.wait(&firstKeyHash, &lastKeyHash));
+    EXPECT_EQ(0U, firstKeyHash);
+    EXPECT_EQ(~0UL, lastKeyHash);
+    EXPECT_EQ(0, access((string(dir) + "/full").c_str(), R_OK));
+
+    ramcloud->write(1, "a", 1, "new a");
+    EXPECT_EQ(1U, ramcloud->exportTabletSnapshot(1, 0, "delta", "full"));
+
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "nonexistent/x"),
+            InternalError);
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "delta",
+            "nonexistent/x"), InternalError);
+    system((string("rm -rf ") + dir).c_str());
+}
+
+TEST_F(MasterServiceTest, exportSnapshot_badPath) {
+    char dir[] = "/tmp/ramcloud-master-snapshot-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    ramcloud->write(1, "a", 1, "value a");
+
+    // Snapshots are disabled unless there is a snapshot directory.
+    TestLog::Enable _("getSnapshotPath");
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "full"),
+            InvalidParameterException);
+    EXPECT_EQ("getSnapshotPath: Rejecting snapshot full: no snapshot "
+            "directory is configured", TestLog::get());
+
+    masterServer->config.master.snapshotDir = dir;
+    TestLog::reset();
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0,
+            (string(dir) + "/full").c_str()), InvalidParameterException);
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "../full"),
+            InvalidParameterException);
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "a/../../full"),
+            InvalidParameterException);
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, "full", "/tmp/x"),
+            InvalidParameterException);
+    EXPECT_THROW(ramcloud->exportTabletSnapshot(1, 0, ""),
+            InvalidParameterException);
+    EXPECT_EQ(format("getSnapshotPath: Rejecting snapshot %s/full: name "
+            "must be relative to the snapshot directory | "
+            "getSnapshotPath: Rejecting snapshot ../full: name may not "
+            "contain \"..\" | "
+            "getSnapshotPath: Rejecting snapshot a/../../full: name may not "
+            "contain \"..\" | "
+            "getSnapshotPath: Rejecting snapshot /tmp/x: name must be "
+            "relative to the snapshot directory | "
+            "getSnapshotPath: Rejecting snapshot : name must be relative to "
+            "the snapshot directory", dir), TestLog::get());
+
+    // Names that merely contain dots are fine.
+    EXPECT_EQ(1U, ramcloud->exportTabletSnapshot(1, 0, "..full"));
+    EXPECT_EQ(0, access((string(dir) + "/..full").c_str(), R_OK));
+    system((string("rm -rf ") + dir).c_str());
+}
+
 TEST_F(MasterServiceTest, getHeadOfLog) {
     EXPECT_EQ(LogPosition(2, 88),
             MasterClient::getHeadOfLog(&context, masterServer->serverId));
@@ -672,6 +771,32 @@ TEST_F(MasterServiceTest, getServerStatistics) {
     }
 }
 
+TEST_F(MasterServiceTest, importSnapshot) {
+    char dir[] = "/tmp/ramcloud-master-snapshot-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    masterServer->config.master.snapshotDir = dir;
+    ramcloud->write(1, "a", 1, "value a");
+    ramcloud->exportTabletSnapshot(1, 0, "full");
+    ramcloud->write(1, "a", 1, "new a");
+
+    // Newer versions already on the master win.
+    EXPECT_EQ(1U, ramcloud->importTabletSnapshot(1, 0, "full"));
+    Buffer value;
+    ramcloud->read(1, "a", 1, &value);
+    EXPECT_EQ("new a", TestUtil::toString(&value));
+
+    // The snapshot came from a different table.
+    EXPECT_THROW(ramcloud->importTabletSnapshot(99, 0, "full"),
+            InvalidParameterException);
+    EXPECT_THROW(ramcloud->importTabletSnapshot(1, 0, "nonexistent/x"),
+            InternalError);
+    EXPECT_THROW(ramcloud->importTabletSnapshot(1, 0,
+            (string(dir) + "/full").c_str()), InvalidParameterException);
+    EXPECT_THROW(ramcloud->importTabletSnapshot(1, 0, "../full"),
+            InvalidParameterException);
+    system((string("rm -rf ") + dir).c_str());
+}
+
 TEST_F(MasterServiceTest, increment_basic) {
     Buffer buffer;
     uint64_t version = 0;
@@ -872,7 +997,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -880,15 +1004,15 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -907,7 +1031,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongTable) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -915,15 +1038,15 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongTable) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -943,7 +1066,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongKeyHash) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -951,15 +1073,15 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongKeyHash) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     Status error;
     for (; !it.isDone(); it.next()) {
         TestLog::reset();
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -998,7 +1120,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_RPCRESULT, buffer));
     }
 
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -1006,6 +1127,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     TestLog::reset();
     Status error;
@@ -1013,9 +1135,8 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
     for (SegmentIterator it(segment); !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 it,
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1086,7 +1207,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_PREPTOMB, buffer));
     }
 
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -1094,6 +1214,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
     uint64_t firstKeyHash = keyToMigrate.getHash();
     uint64_t lastKeyHash = keyToMigrate.getHash();
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     TestLog::reset();
     Status error;
@@ -1101,9 +1222,8 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
     for (SegmentIterator it(segment); !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 it,
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1146,7 +1266,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_decisionRecord) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -1154,15 +1273,15 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_decisionRecord) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     TestLog::reset();
     Status error;
     for (; !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1231,7 +1350,6 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_participantList) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
@@ -1239,15 +1357,15 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_participantList) {
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
     ServerId receiver(1);
+    MigrationSender sender(&context, receiver, tableId, firstKeyHash);
 
     TestLog::reset();
     Status error;
     for (; !it.isDone(); it.next()) {
         error = service->migrateSingleLogEntry(
                 *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                sender, entryTotals, totalBytes,
+                tableId, firstKeyHash, lastKeyHash);
         if (error) break;
     }
 
@@ -1361,6 +1479,123 @@ TEST_F(MasterServiceTest, migrateTablet_movingData) {
     EXPECT_LT(ctimeCoord, master2HeadPositionAfter);
 }
 
+TEST_F(MasterServiceTest, migrateTablet_skipsSegmentsWithoutMetadata) {
+    uint64_t tbl = ramcloud->createTable("migrationTable");
+    uint64_t otherTbl = ramcloud->createTable("otherTable");
+    Key key1(tbl, "k1", 2);
+    Buffer buffer1, buffer2, buffer3;
+    Object obj1(key1, "old", 3, 0, 0, buffer1);
+    EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj1, 0, 0));
+    Object obj2(key1, "new", 3, 0, 0, buffer2);
+    EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj2, 0, 0));
+    Key key2(otherTbl, "k2", 2);
+    Object obj3(key2, "x", 1, 0, 0, buffer3);
+    EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj3, 0, 0));
+    service->objectManager.log.rollHeadOver();
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+
+    TestLog::Enable _("migrateSingleLogEntry", "migrateTablet", NULL);
+    ramcloud->migrateTablet(tbl, 0, -1, master2->serverId);
+    string log = TestLog::get();
+
+    // The live object came from the hash table; neither the overwritten
+    // version nor the object in the other table was ever examined.
+    EXPECT_EQ(string::npos, log.find("Object not migrated"));
+    EXPECT_EQ(string::npos, log.find("Migrated log entry type Object"));
+    EXPECT_NE(string::npos, log.find("sent 1 objects and 0 tombstones"));
+
+    Buffer value;
+    EXPECT_EQ(STATUS_OK, master2->master->objectManager.readObject(
+            key1, &value, NULL, NULL, true));
+    EXPECT_EQ("new", TestUtil::toString(&value));
+}
+
+TEST_F(MasterServiceTest, migrateTablet_rollsHeadOverBeforeWalk) {
+    uint64_t tbl = ramcloud->createTable("migrationTable");
+    Key key(tbl, "k1", 2);
+    Buffer buffer;
+    Object obj(key, "value", 5, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
+    uint64_t headId = service->objectManager.log.head->id;
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+
+    // The object is in the segment that was the head when the migration
+    // started; the hash table walk sends it, and the log scan must not.
+    TestLog::Enable _("migrateSingleLogEntry", "migrateTablet", NULL);
+    ramcloud->migrateTablet(tbl, 0, -1, master2->serverId);
+    EXPECT_GT(service->objectManager.log.head->id, headId);
+    string log = TestLog::get();
+    EXPECT_EQ(string::npos, log.find("Migrated log entry type Object"));
+    EXPECT_NE(string::npos, log.find("sent 1 objects and 0 tombstones"));
+}
+
+TEST_F(MasterServiceTest, migrateTablet_removedLinearizableWrite) {
+    uint64_t tbl = ramcloud->createTable("migrationTable");
+    ramcloud->write(tbl, "k1", 2, "value", 5);
+    ramcloud->remove(tbl, "k1", 2);
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+
+    // The write's entry predates the migration and its tombstone is
+    // skipped, so only the RpcResult half of the entry may be sent.
+    TestLog::Enable _("migrateSingleLogEntry", NULL);
+    ramcloud->migrateTablet(tbl, 0, -1, master2->serverId);
+    string log = TestLog::get();
+    EXPECT_NE(string::npos, log.find("Migrated RpcResult of log entry type "
+            "Object With Linearizable Rpc Record"));
+    EXPECT_EQ(string::npos, log.find("Migrated log entry type "
+            "Object With Linearizable Rpc Record"));
+
+    Key key(tbl, "k1", 2);
+    Buffer value;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            master2->master->objectManager.readObject(key, &value, NULL,
+            NULL, true));
+    EXPECT_THROW(ramcloud->read(tbl, "k1", 2, &value),
+            ObjectDoesntExistException);
+}
+
+TEST_F(MasterServiceTest, migrateTablet_manyObjects) {
+    uint64_t tbl = ramcloud->createTable("migrationTable");
+    char value[50000];
+    memset(value, 'x', sizeof(value));
+    for (int i = 0; i < 20; i++) {
+        string key = format("key%d", i);
+        ramcloud->write(tbl, key.c_str(), downCast<uint16_t>(key.length()),
+                value, sizeof(value));
+    }
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+
+    TestLog::Enable _("migrateTablet", NULL);
+    ramcloud->migrateTablet(tbl, 0, -1, master2->serverId);
+    EXPECT_NE(string::npos,
+            TestLog::get().find("sent 20 objects and 0 tombstones"));
+    for (int i = 0; i < 20; i++) {
+        string keyString = format("key%d", i);
+        Key key(tbl, keyString.c_str(),
+                downCast<uint16_t>(keyString.length()));
+        Buffer buffer;
+        EXPECT_EQ(STATUS_OK, master2->master->objectManager.readObject(
+                key, &buffer, NULL, NULL, true));
+        EXPECT_EQ(sizeof(value), buffer.size());
+    }
+}
+
 TEST_F(MasterServiceTest, multiIncrement_basics) {
     uint64_t tableId1 = ramcloud->createTable("table1");
 
@@ -1905,6 +2140,45 @@ TEST_F(MasterServiceTest, read_basics) {
     EXPECT_EQ(6U, value.size());
 }
 
+TEST_F(MasterServiceTest, read_degraded) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    Buffer value;
+    uint64_t version;
+    bool degraded = true;
+    ramcloud->readDegraded(1, "0", 1, &value, &version, &degraded);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+    EXPECT_FALSE(degraded);
+
+    // Pretend that the tablet is being recovered here.
+    service->tabletManager.deleteTablet(1, 0, ~0UL);
+    service->tabletManager.addTablet(1, 0, ~0UL, TabletManager::NOT_READY,
+            true);
+    value.reset();
+    ramcloud->readDegraded(1, "0", 1, &value, &version, &degraded);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+    EXPECT_EQ(1U, version);
+    EXPECT_TRUE(degraded);
+
+    // Objects that haven't been replayed yet must be retried.
+    Key key(1, "5", 1);
+    EXPECT_THROW(service->objectManager.readObject(key, &value, NULL, NULL,
+            true, &degraded), RetryException);
+}
+
+TEST_F(MasterServiceTest, read_degradedMigrationTarget) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+
+    // A tablet that is being migrated here still belongs to the source.
+    service->tabletManager.changeState(1, 0, ~0UL, TabletManager::NORMAL,
+            TabletManager::NOT_READY);
+    Key key(1, "0", 1);
+    Buffer value;
+    bool degraded = true;
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET, service->objectManager.readObject(key,
+            &value, NULL, NULL, true, &degraded));
+    EXPECT_FALSE(degraded);
+}
+
 TEST_F(MasterServiceTest, readKeysAndValue_basics) {
     uint64_t tableId1 = 1;
     ObjectBuffer keysAndValue;
@@ -3912,7 +4186,7 @@ TEST_F(MasterServiceTest, write_basics) {
     ramcloud->write(1, "key0", 4, "item0", 5, NULL, &version);
     EXPECT_EQ(1U, version);
     EXPECT_EQ("writeObject: object: 36 bytes, version 1 | "
-            "writeObject: rpcResult: 56 bytes | "
+            "writeObject: rpcResult: 56 bytes, combined with object | "
             "sync: syncing segment 1 to offset 176 | "
             "schedule: scheduled | "
             "performWrite: Sending write to backup 1.0 | "
@@ -0,0 +1,162 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "MigrationSender.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a MigrationSender.
+ *
+ * \param context
+ *      Overall information about this server.
+ * \param receiver
+ *      Master that has agreed (via PREP_FOR_MIGRATION) to accept the
+ *      tablet. If this is an invalid ServerId, segments are discarded
+ *      instead of being sent.
+ * \param tableId
+ *      Table containing the tablet being migrated.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet being migrated.
+ * \param maxOutstanding
+ *      Maximum number of RPCs to keep in flight at once (must be nonzero).
+ */
+MigrationSender::MigrationSender(Context* context, ServerId receiver,
+        uint64_t tableId, uint64_t firstKeyHash, uint32_t maxOutstanding)
+    : context(context)
+    , receiver(receiver)
+    , tableId(tableId)
+    , firstKeyHash(firstKeyHash)
+    , maxOutstanding(std::max(maxOutstanding, 1u))
+    , current(NULL)
+    , queued()
+    , outstanding()
+    , segmentsSent(0)
+{
+}
+
+/**
+ * Destructor for MigrationSender. Any RPCs still outstanding are abandoned
+ * (this only happens if migration is aborted by an exception).
+ */
+MigrationSender::~MigrationSender()
+{
+    delete current;
+    foreach (Segment* segment, queued) {
+        delete segment;
+    }
+}
+
+/**
+ * Add a log entry to the data being migrated. If the current segment is
+ * full, it is queued for transmission and a new one is started; no RPCs
+ * are issued here (see sendQueued).
+ *
+ * \param type
+ *      Type of the log entry.
+ * \param buffer
+ *      Contents of the log entry; they are copied.
+ * \return
+ *      True means the entry was added; false means it is too large to fit
+ *      even in an empty segment.
+ */
+bool
+MigrationSender::append(LogEntryType type, Buffer& buffer)
+{
+    if (current == NULL)
+        current = new Segment();
+    if (current->append(type, buffer))
+        return true;
+
+    // If we can't fit it, queue the current segment and retry.
+    current->close();
+    queued.push_back(current);
+    current = new Segment();
+    return current->append(type, buffer);
+}
+
+/**
+ * Send everything appended so far and wait for the receiver to process
+ * all of it.
+ *
+ * \throw ServerNotUpException
+ *      The receiver crashed.
+ */
+void
+MigrationSender::finish()
+{
+    if (current != NULL) {
+        current->close();
+        queued.push_back(current);
+        current = NULL;
+    }
+    sendQueued();
+    while (!outstanding.empty())
+        waitOldest();
+}
+
+/**
+ * Issue RPCs for all of the segments that have filled up. If this would
+ * exceed the limit on outstanding RPCs, wait for the earliest ones to
+ * complete first. This method must not be invoked while holding locks
+ * that the receiver's progress could depend on.
+ *
+ * \throw ServerNotUpException
+ *      The receiver crashed.
+ */
+void
+MigrationSender::sendQueued()
+{
+    // Reap RPCs that have already finished, so that errors are noticed
+    // promptly and segments are freed.
+    while (!outstanding.empty() && outstanding.front().rpc->isReady())
+        waitOldest();
+
+    while (!queued.empty()) {
+        Segment* segment = queued.front();
+        queued.pop_front();
+        segmentsSent++;
+        if (expect_false(receiver == ServerId())) {
+            delete segment;
+            continue;
+        }
+
+        while (outstanding.size() >= maxOutstanding)
+            waitOldest();
+        LOG(DEBUG, "Sending migration segment");
+        outstanding.emplace_back(segment);
+        outstanding.back().rpc.construct(context, receiver, segment,
+                tableId, firstKeyHash, false, 0UL, uint8_t(0),
+                static_cast<const void*>(NULL), uint16_t(0));
+    }
+}
+
+/**
+ * Wait for the oldest outstanding RPC to complete, then discard it along
+ * with its segment.
+ *
+ * \throw ServerNotUpException
+ *      The receiver crashed.
+ */
+void
+MigrationSender::waitOldest()
+{
+    Transfer& transfer = outstanding.front();
+    transfer.rpc->wait();
+    outstanding.pop_front();
+}
+
+} // namespace RAMCloud
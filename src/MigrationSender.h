@@ -0,0 +1,121 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_MIGRATIONSENDER_H
+#define RAMCLOUD_MIGRATIONSENDER_H
+
+#include <deque>
+#include <list>
+
+#include "Common.h"
+#include "MasterClient.h"
+#include "Segment.h"
+#include "ServerId.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+/**
+ * A MigrationSender packs the log entries of a migrating tablet into
+ * Segment containers and ships them to the receiving master with
+ * RECEIVE_MIGRATION_DATA RPCs. Several segments may be in flight at once:
+ * the receiver replays each one into its own SideLog, so it can process
+ * them in parallel and in any order, while the sender goes on collecting
+ * entries for the next segment.
+ *
+ * Appending never blocks, so it is safe to append while holding locks
+ * (such as hash table bucket locks); the caller must periodically invoke
+ * sendQueued (without holding any locks) to issue the RPCs.
+ */
+class MigrationSender {
+  PUBLIC:
+    /// Default limit on the number of RECEIVE_MIGRATION_DATA RPCs that
+    /// may be outstanding at once.
+    static const uint32_t DEFAULT_MAX_OUTSTANDING = 4;
+
+    MigrationSender(Context* context, ServerId receiver, uint64_t tableId,
+            uint64_t firstKeyHash,
+            uint32_t maxOutstanding = DEFAULT_MAX_OUTSTANDING);
+    ~MigrationSender();
+    bool append(LogEntryType type, Buffer& buffer);
+    void finish();
+    void sendQueued();
+
+  PRIVATE:
+    /**
+     * A segment whose RPC has been issued, along with the RPC. The segment
+     * must stay around until the RPC completes, since the request refers
+     * to its memory.
+     */
+    struct Transfer {
+        explicit Transfer(Segment* segment)
+            : segment(segment)
+            , rpc()
+        {}
+
+        ~Transfer()
+        {
+            rpc.destroy();
+            delete segment;
+        }
+
+        /// Segment being transferred (owned by this object).
+        Segment* segment;
+
+        /// RPC carrying the segment to the receiver.
+        Tub<ReceiveMigrationDataRpc> rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Transfer);
+    };
+
+    void waitOldest();
+
+    /// Used to issue RPCs.
+    Context* context;
+
+    /// Master receiving the migrated data. An invalid id means that
+    /// segments are dropped instead of sent (used by benchmarks).
+    ServerId receiver;
+
+    /// Identifies the tablet being migrated (the receiver uses these to
+    /// find the tablet that it prepared for migration).
+    uint64_t tableId;
+    uint64_t firstKeyHash;
+
+    /// Maximum number of RPCs outstanding at once.
+    uint32_t maxOutstanding;
+
+    /// Entries are appended to this segment until it fills; NULL if no
+    /// entries have been appended since the last segment was queued.
+    Segment* current;
+
+    /// Segments that are full but haven't been sent yet, oldest first
+    /// (owned by this object).
+    std::deque<Segment*> queued;
+
+    /// Segments whose RPCs have been issued, oldest first.
+    std::list<Transfer> outstanding;
+
+  PUBLIC:
+    /// Number of segments handed to the receiver so far (including any
+    /// that are still in flight).
+    uint64_t segmentsSent;
+
+    DISALLOW_COPY_AND_ASSIGN(MigrationSender);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_MIGRATIONSENDER_H
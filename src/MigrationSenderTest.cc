@@ -0,0 +1,150 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MasterService.h"
+#include "MigrationSender.h"
+#include "MockCluster.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+class MigrationSenderTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Server* receiver;
+
+    MigrationSenderTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , receiver()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.master.numReplicas = 0;
+        config.localLocator = "mock:host=master";
+        receiver = cluster.addServer(config);
+        MasterClient::prepForMigration(&context, receiver->serverId,
+                5, 0, ~0UL);
+    }
+
+    // Append an object with the given key and value to a sender.
+    void
+    appendObject(MigrationSender* sender, const char* key, const char* value)
+    {
+        Key objectKey(5, key, downCast<uint16_t>(strlen(key)));
+        Buffer dataBuffer;
+        Object object(objectKey, value, downCast<uint32_t>(strlen(value)),
+                1, 0, dataBuffer);
+        Buffer buffer;
+        object.assembleForLog(buffer);
+        EXPECT_TRUE(sender->append(LOG_ENTRY_TYPE_OBJ, buffer));
+    }
+
+    // Returns the value of an object on the receiver, or "missing".
+    string
+    readObject(const char* key)
+    {
+        MasterService* master = receiver->master.get();
+        master->tabletManager.changeState(5, 0, ~0UL,
+                TabletManager::NOT_READY, TabletManager::NORMAL);
+        Key objectKey(5, key, downCast<uint16_t>(strlen(key)));
+        Buffer value;
+        Status status = master->objectManager.readObject(objectKey, &value,
+                NULL, NULL, true);
+        master->tabletManager.changeState(5, 0, ~0UL,
+                TabletManager::NORMAL, TabletManager::NOT_READY);
+        if (status != STATUS_OK)
+            return "missing";
+        return TestUtil::toString(&value);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(MigrationSenderTest);
+};
+
+TEST_F(MigrationSenderTest, append) {
+    MigrationSender sender(&context, ServerId(), 5, 0);
+    appendObject(&sender, "k1", "value1");
+    EXPECT_TRUE(sender.current != NULL);
+    EXPECT_EQ(0U, sender.queued.size());
+
+    // Fill up the current segment.
+    char data[100000];
+    memset(data, 'x', sizeof(data));
+    Buffer buffer;
+    buffer.appendExternal(data, sizeof(data));
+    while (sender.queued.empty())
+        EXPECT_TRUE(sender.append(LOG_ENTRY_TYPE_OBJ, buffer));
+    EXPECT_TRUE(sender.queued.front()->closed);
+    EXPECT_FALSE(sender.current->closed);
+}
+
+TEST_F(MigrationSenderTest, append_entryTooLarge) {
+    MigrationSender sender(&context, ServerId(), 5, 0);
+    Buffer buffer;
+    string big(Segment::DEFAULT_SEGMENT_SIZE + 1, 'x');
+    buffer.appendExternal(big.c_str(), downCast<uint32_t>(big.length()));
+    EXPECT_FALSE(sender.append(LOG_ENTRY_TYPE_OBJ, buffer));
+}
+
+TEST_F(MigrationSenderTest, finish) {
+    MigrationSender sender(&context, receiver->serverId, 5, 0);
+    appendObject(&sender, "k1", "value1");
+    appendObject(&sender, "k2", "value2");
+    EXPECT_EQ("missing", readObject("k1"));
+    sender.finish();
+    EXPECT_EQ(1U, sender.segmentsSent);
+    EXPECT_TRUE(sender.current == NULL);
+    EXPECT_EQ(0U, sender.outstanding.size());
+    EXPECT_EQ("value1", readObject("k1"));
+    EXPECT_EQ("value2", readObject("k2"));
+}
+
+TEST_F(MigrationSenderTest, sendQueued_limitOutstanding) {
+    MigrationSender sender(&context, receiver->serverId, 5, 0, 2);
+    const char* keys[] = {"k1", "k2", "k3", "k4"};
+    foreach (const char* key, keys) {
+        appendObject(&sender, key, key);
+        sender.current->close();
+        sender.queued.push_back(sender.current);
+        sender.current = NULL;
+    }
+    sender.sendQueued();
+    EXPECT_EQ(4U, sender.segmentsSent);
+    EXPECT_EQ(0U, sender.queued.size());
+    EXPECT_GE(2U, sender.outstanding.size());
+
+    sender.finish();
+    EXPECT_EQ(0U, sender.outstanding.size());
+    foreach (const char* key, keys) {
+        EXPECT_EQ(key, readObject(key));
+    }
+}
+
+TEST_F(MigrationSenderTest, sendQueued_noReceiver) {
+    MigrationSender sender(&context, ServerId(), 5, 0);
+    appendObject(&sender, "k1", "value1");
+    sender.finish();
+    EXPECT_EQ(1U, sender.segmentsSent);
+    EXPECT_EQ(0U, sender.outstanding.size());
+}
+
+}  // namespace RAMCloud
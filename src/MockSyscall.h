@@ -37,7 +37,8 @@ class MockSyscall : public Syscall {
     MockSyscall() : acceptErrno(0), bindErrno(0), closeErrno(0), closeCount(0),
                     connectErrno(0), epollCreateErrno(0), epollCtlErrno(0),
                     epollWaitCount(-1), epollWaitEvents(NULL),
-                    epollWaitErrno(0), exitCount(0), fcntlErrno(0),
+                    epollWaitErrno(0), eventfdErrno(0), exitCount(0),
+                    fcntlErrno(0),
                     futexWaitErrno(0), futexWakeErrno(0), fwriteResult(~0LU),
                     getsocknameErrno(0), ioctlErrno(0),
                     ioctlRetriesToSuccess(0), listenErrno(0), pipeErrno(0),
@@ -123,6 +124,15 @@ class MockSyscall : public Syscall {
         return -1;
     }
 
+    int eventfdErrno;
+    int eventfd(unsigned int initval, int flags) {
+        if (eventfdErrno == 0) {
+            return ::eventfd(initval, flags);
+        }
+        errno = eventfdErrno;
+        return -1;
+    }
+
     int exitCount;
     void exit(int status) {
         exitCount++;
@@ -363,7 +363,19 @@ MultiFileStorage::Frame::append(Buffer& source,
     }
 
     if (!isSynced()) {
-        if (sync) {
+        if (sync && storage->writeGroupSize > 1) {
+            // Some other thread may be writing this frame as part of its
+            // group; wait for it, then write whatever it didn't cover
+            // (along with any other dirty frames).
+            while (performingIo)
+                storage->ioFinished.wait(lock);
+            if (!isSynced()) {
+                performingIo = true;
+                storage->writeGroup(lock, this);
+                performingIo = false;
+                storage->ioFinished.notify_all();
+            }
+        } else if (sync) {
             performWrite(lock);
         } else {
             schedule(lock, LOW);
@@ -412,7 +424,8 @@ MultiFileStorage::Frame::close()
 
 /**
  * Perform outstanding IO for this frame. Frames prioritize writes over loads
- * since loads require writes to finish first.
+ * since loads require writes to finish first. If writes are grouped, dirty
+ * data from other frames is written along with this frame's.
  */
 void
 MultiFileStorage::Frame::performTask()
@@ -420,13 +433,22 @@ MultiFileStorage::Frame::performTask()
     Lock lock(storage->mutex);
     if (epoch != scheduledInEpoch)
         return;
+    if (performingIo) {
+        // Being written as part of another frame's group; the frame is
+        // rescheduled afterwards if it still needs IO.
+        return;
+    }
     performingIo = true;
     if (!isSynced()) {
-        performWrite(lock);
+        if (storage->writeGroupSize > 1)
+            storage->writeGroup(lock, this);
+        else
+            performWrite(lock);
     } else if (loadRequested && !buffer) {
         performRead(lock);
     }
     performingIo = false;
+    storage->ioFinished.notify_all();
 }
 
 // - protected -
@@ -444,10 +466,8 @@ void
 MultiFileStorage::Frame::free()
 {
     Lock lock(storage->mutex);
-    while (performingIo) {
-        lock.unlock();
-        lock.lock();
-    }
+    while (performingIo)
+        storage->ioFinished.wait(lock);
     ++epoch;
     deschedule();
     if (!isSynced())
@@ -644,12 +664,6 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     CycleCounter<RawMetric> writeTicks(&metrics->backup.storageWriteTicks);
     lock.unlock();
 
-    size_t remaining = count;
-    off_t frameletStart = offsetOfFramelet(frameIndex);
-    off_t offsetInFramelet = offsetInFrame;
-
-    // Use asynchronous IO to initiate concurrent IO operations on all of the
-    // storage files to read the replica in parallel.
     // Keep one control block for each file, plus an extra (the last one) for
     // metadata.
     struct aiocb cbs[fds.size() + 1];
@@ -657,6 +671,100 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     // zeroing everything out makes it safe to call aio_suspend on any control
     // blocks that don't end up being used.
     memset(cbs, 0, sizeof(struct aiocb) * (fds.size() + 1));
+    startWrite(cbs, buf, count, frameIndex, offsetInFrame,
+               metadataBuf, metadataCount);
+    waitForWrites(cbs, fds.size() + 1, start);
+
+    // Reduce our bandwidth (if so configured) by delaying this operation.
+    sleepToThrottleWrites(count + metadataCount, Cycles::rdtsc() - start);
+
+    uint64_t elapsed = Cycles::rdtsc() - start;
+    metrics->backup.storageWriteTicks += elapsed;
+    PerfStats::threadStats.backupWriteActiveCycles += elapsed;
+    lock.lock();
+}
+
+/**
+ * Performs all necessary IO operations to write the dirty data and metadata
+ * of several frames to storage, then makes all of it durable with a single
+ * fdatasync of each file (unless the files were opened O_SYNC). All of the
+ * writes are issued at once and are ordered by their offsets in the files,
+ * so that many small appends from different masters reach the disks as a
+ * few (mostly) sequential writes. DIEs on any problem and releases #lock
+ * during IO.
+ *
+ * \param lock
+ *     Lock on the storage mutex which must be held before calling. This lock
+ *     is released during IO and reacquired at the end of the method.
+ * \param writes
+ *     Describes the data to write for each frame; see
+ *     Frame::prepareWrite(). Must be sorted by frame index.
+ */
+void
+MultiFileStorage::unlockedWriteGroup(Frame::Lock& lock,
+                                     std::vector<Frame::PendingWrite>& writes)
+{
+    uint64_t start = Cycles::rdtsc();
+    lock.unlock();
+
+    // One control block per file for each frame, plus one for its metadata.
+    // Value-initialization zeroes the control blocks, as in unlockedWrite().
+    const size_t cbsPerWrite = fds.size() + 1;
+    std::vector<struct aiocb> cbs(writes.size() * cbsPerWrite);
+    size_t bytes = 0;
+    for (size_t i = 0; i < writes.size(); i++) {
+        Frame::PendingWrite& write = writes[i];
+        startWrite(&cbs[i * cbsPerWrite], write.data, write.count,
+                   write.frame->frameIndex, write.offsetInFrame,
+                   write.metadata, METADATA_SIZE);
+        bytes += write.count + METADATA_SIZE;
+    }
+    waitForWrites(&cbs[0], cbs.size(), start);
+    syncFiles();
+
+    // Reduce our bandwidth (if so configured) by delaying this operation.
+    sleepToThrottleWrites(bytes, Cycles::rdtsc() - start);
+
+    uint64_t elapsed = Cycles::rdtsc() - start;
+    metrics->backup.storageWriteTicks += elapsed;
+    PerfStats::threadStats.backupWriteActiveCycles += elapsed;
+    lock.lock();
+}
+
+/**
+ * Start asynchronous writes of #count bytes to the Frame identified by
+ * #frameIndex, beginning at #offsetInFrame bytes, along with a write of
+ * the frame's metadata block. Use waitForWrites() to wait for them to
+ * complete. Must be called without holding the storage mutex.
+ *
+ * \param cbs
+ *     Zeroed array of fds.size() + 1 control blocks: one for each file,
+ *     plus (the last one) for metadata.
+ * \param buf
+ *     Pointer to the buffer that contains the data to write to disk.
+ * \param count
+ *     Number of bytes to write.
+ * \param frameIndex
+ *     Identifies which Frame to write to.
+ * \param offsetInFrame
+ *     Offset into the Frame to write to. (Note that the caller does NOT have
+ *     to worry about framelet offsets.)
+ * \param metadataBuf
+ *     Pointer to the buffer that contains the metadata to write to disk.
+ * \param metadataCount
+ *     Number of bytes of metadata to write.
+ */
+void
+MultiFileStorage::startWrite(struct aiocb* cbs, void* buf, size_t count,
+                             size_t frameIndex, off_t offsetInFrame,
+                             void* metadataBuf, size_t metadataCount)
+{
+    size_t remaining = count;
+    off_t frameletStart = offsetOfFramelet(frameIndex);
+    off_t offsetInFramelet = offsetInFrame;
+
+    // Use asynchronous IO to initiate concurrent IO operations on all of the
+    // storage files to write the replica in parallel.
     for (size_t fileIndex = 0; remaining > 0; fileIndex++) {
         size_t frameletSize = bytesInFramelet(fileIndex);
         if (static_cast<size_t>(offsetInFramelet) > frameletSize) {
@@ -686,26 +794,43 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     metadataCb->aio_buf = metadataBuf;
     metadataCb->aio_nbytes = metadataCount;
     aio_write(metadataCb);
+}
 
-    // Wait for all of the IO operations to complete.
+/**
+ * Wait for writes started by startWrite() to complete. DIEs if any of them
+ * failed, and warns if they are slow.
+ *
+ * \param cbs
+ *     Control blocks filled in by one or more calls to startWrite(); each
+ *     call uses fds.size() + 1 consecutive control blocks.
+ * \param cbCount
+ *     Number of control blocks in \a cbs.
+ * \param start
+ *     Cycles::rdtsc() when the writes were started.
+ */
+void
+MultiFileStorage::waitForWrites(struct aiocb* cbs, size_t cbCount,
+                                uint64_t start)
+{
     bool firstSlowIO = true;
-    for (size_t i = 0; i < fds.size() + 1; i++) {
+    for (size_t i = 0; i < cbCount; i++) {
         struct aiocb* cb = &cbs[i];
+        size_t fileIndex = i % (fds.size() + 1);
         aio_suspend(&cb, 1, NULL);
         ssize_t r = aio_return(cb);
         if (r == -1) {
-            if (i == fds.size())
+            if (fileIndex == fds.size())
                 DIE("Failed to write metadata for replica: %s, "
                     "writing %lu bytes to backup file %lu at offset %lu.",
                     strerror(aio_error(cb)),
-                    cb->aio_nbytes, i, cb->aio_offset);
+                    cb->aio_nbytes, fileIndex, cb->aio_offset);
             else
                 DIE("Failed to write replica: %s, "
                     "writing %lu bytes to backup file %lu at offset %lu.",
                     strerror(aio_error(cb)),
-                    cb->aio_nbytes, i, cb->aio_offset);
+                    cb->aio_nbytes, fileIndex, cb->aio_offset);
         } else if (r != downCast<ssize_t>(cb->aio_nbytes)) {
-            if (i == fds.size())
+            if (fileIndex == fds.size())
                 DIE("Unexpectedly short write to metadata for replica, "
                     "file 0 at offset %lu, "
                     "expected length %lu, actual write length %lu",
@@ -714,23 +839,99 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
                 DIE("Unexpectedly short write to replica, "
                     "file %lu at offset %lu, "
                     "expected length %lu, actual write length %lu",
-                    i, cb->aio_offset, cb->aio_nbytes, r);
+                    fileIndex, cb->aio_offset, cb->aio_nbytes, r);
         }
         double elapsedSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
         if ((elapsedSeconds > 0.1) && firstSlowIO) {
             firstSlowIO = false;
             LOG(WARNING, "Slow write to replica storage on device %lu: %.1f ms "
-                    "for %lu bytes", i, elapsedSeconds*1e03, cb->aio_nbytes);
+                    "for %lu bytes", fileIndex, elapsedSeconds*1e03,
+                    cb->aio_nbytes);
         }
     }
+}
 
-    // Reduce our bandwidth (if so configured) by delaying this operation.
-    sleepToThrottleWrites(count + metadataCount, Cycles::rdtsc() - start);
+/**
+ * Make all data written to the storage files durable. Does nothing if the
+ * files were opened O_SYNC (every write is already durable) or if they are
+ * /dev/null. DIEs on any problem.
+ */
+void
+MultiFileStorage::syncFiles()
+{
+    if ((openFlags & O_SYNC) || usingDevNull)
+        return;
+    for (size_t i = 0; i < fds.size(); i++) {
+        if (fdatasync(fds[i]) == -1) {
+            DIE("Failed to sync backup file %lu: %s", i, strerror(errno));
+        }
+    }
+}
 
-    uint64_t elapsed = Cycles::rdtsc() - start;
-    metrics->backup.storageWriteTicks += elapsed;
-    PerfStats::threadStats.backupWriteActiveCycles += elapsed;
-    lock.lock();
+/**
+ * Flush the dirty data and metadata of a frame to storage, along with that
+ * of up to writeGroupSize - 1 other frames that need writing, using a
+ * single batch of IO and a single sync (see unlockedWriteGroup()). This
+ * turns a storm of small appends to many open replicas into a few large
+ * writes. Each frame in the group is updated and rescheduled just as if
+ * it had been written by Frame::performWrite().
+ *
+ * \param lock
+ *      Lock on the storage mutex, which must be held. It is released
+ *      during IO and reacquired before returning.
+ * \param first
+ *      Frame that needs writing. The caller must have set its
+ *      performingIo flag.
+ */
+void
+MultiFileStorage::writeGroup(Lock& lock, Frame* first)
+{
+    std::vector<Frame*> group{first};
+    foreach (Frame& frame, frames) {
+        if (group.size() >= writeGroupSize)
+            break;
+        if (&frame == first || frame.performingIo || !frame.buffer ||
+                frame.isSynced())
+            continue;
+        // Keeps free() and the frame's own task away until we're done.
+        frame.performingIo = true;
+        group.push_back(&frame);
+    }
+
+    // Write the frames in the order they are laid out in the files.
+    std::sort(group.begin(), group.end(),
+              [](const Frame* a, const Frame* b) {
+                  return a->frameIndex < b->frameIndex;
+              });
+
+    std::vector<Frame::PendingWrite> writes;
+    foreach (Frame* frame, group)
+        writes.push_back(frame->prepareWrite());
+
+    if (Frame::testingSkipRealIo) {
+        foreach (Frame::PendingWrite& write, writes) {
+            TEST_LOG("sourceBufferOffset %lu count %lu frameIndex %lu",
+                     write.offsetInFrame, write.count,
+                     write.frame->frameIndex);
+        }
+    } else {
+        foreach (Frame::PendingWrite& write, writes) {
+            ++metrics->backup.storageWriteCount;
+            metrics->backup.storageWriteBytes += write.count;
+            ++PerfStats::threadStats.backupWriteOps;
+            PerfStats::threadStats.backupWriteBytes += write.count;
+        }
+        // Lock released during this call; assume any field could have
+        // changed (except that no frame in the group can be freed).
+        unlockedWriteGroup(lock, writes);
+    }
+
+    foreach (Frame::PendingWrite& write, writes) {
+        write.frame->finishWrite(lock, write);
+        if (write.frame != first)
+            write.frame->performingIo = false;
+    }
+    ioFinished.notify_all();
 }
 
 namespace {
@@ -797,44 +998,71 @@ MultiFileStorage::Frame::performRead(Lock& lock)
 void
 MultiFileStorage::Frame::performWrite(Lock& lock)
 {
-    assert(buffer);
-
-    const size_t startOfFirstDirtyBlock = roundDown(committedLength);
-    const size_t startOfNextCleanBlock = roundUp(appendedLength);
-    const size_t dirtyLength = startOfNextCleanBlock - startOfFirstDirtyBlock;
-
-    char* firstDirtyBlock =
-        static_cast<char*>(buffer.get()) + startOfFirstDirtyBlock;
-    char* metadataBlock =
-        static_cast<char*>(buffer.get()) + storage->segmentSize;
-
-    // Snapshot values which will be needed after the write and the
-    // metadata block. Appends to the main buffer that are concurrent
-    // with the write are ok.
-    const size_t appendedLength = this->appendedLength;
-    memcpy(metadataBlock, appendedMetadata.get(), appendedMetadataLength);
-    const size_t appendedMetadataVersion = this->appendedMetadataVersion;
+    PendingWrite write = prepareWrite();
 
     if (testingSkipRealIo) {
         TEST_LOG("sourceBufferOffset %lu count %lu frameIndex %lu",
-                 startOfFirstDirtyBlock, dirtyLength, frameIndex);
+                 write.offsetInFrame, write.count, frameIndex);
     } else {
         ++metrics->backup.storageWriteCount;
-        metrics->backup.storageWriteBytes += dirtyLength;
+        metrics->backup.storageWriteBytes += write.count;
         ++PerfStats::threadStats.backupWriteOps;
-        PerfStats::threadStats.backupWriteBytes += dirtyLength;
+        PerfStats::threadStats.backupWriteBytes += write.count;
         // Lock released during this call; assume any field could have changed.
-        storage->unlockedWrite(lock, firstDirtyBlock, dirtyLength,
-                               frameIndex, startOfFirstDirtyBlock,
-                               metadataBlock, METADATA_SIZE);
+        storage->unlockedWrite(lock, write.data, write.count,
+                               frameIndex, write.offsetInFrame,
+                               write.metadata, METADATA_SIZE);
     }
 
+    finishWrite(lock, write);
+}
+
+/**
+ * Determine which part of the buffer must be written to flush any appended
+ * data to storage, copy the latest appended metadata into the metadata
+ * block, and snapshot the values finishWrite() needs once the write
+ * completes. Appends to the main buffer that are concurrent with the
+ * write are ok. The caller must hold the storage mutex.
+ */
+MultiFileStorage::Frame::PendingWrite
+MultiFileStorage::Frame::prepareWrite()
+{
+    assert(buffer);
+
+    const size_t startOfFirstDirtyBlock = roundDown(committedLength);
+    const size_t startOfNextCleanBlock = roundUp(appendedLength);
+
+    PendingWrite write;
+    write.frame = this;
+    write.data = static_cast<char*>(buffer.get()) + startOfFirstDirtyBlock;
+    write.offsetInFrame = startOfFirstDirtyBlock;
+    write.count = startOfNextCleanBlock - startOfFirstDirtyBlock;
+    write.metadata = static_cast<char*>(buffer.get()) + storage->segmentSize;
+    memcpy(write.metadata, appendedMetadata.get(), appendedMetadataLength);
+    write.appendedLength = appendedLength;
+    write.appendedMetadataVersion = appendedMetadataVersion;
+    return write;
+}
+
+/**
+ * Record that a write prepared by prepareWrite() is durable. Releases the
+ * buffer if it won't be needed in the immediate future and reschedules if
+ * any additional IO has been requested since the write was prepared.
+ *
+ * \param lock
+ *      Lock on the storage mutex, which must be held.
+ * \param write
+ *      The write that completed.
+ */
+void
+MultiFileStorage::Frame::finishWrite(Lock& lock, const PendingWrite& write)
+{
     assert(buffer);
 
-    // Update committed based on the above snapshots of fields taken
-    // just before the write.
-    committedLength = appendedLength;
-    committedMetadataVersion = appendedMetadataVersion;
+    // Update committed based on the snapshots of fields taken just before
+    // the write.
+    committedLength = write.appendedLength;
+    committedMetadataVersion = write.appendedMetadataVersion;
 
     // Release the in-memory copy if it won't be used again.
     if (isClosed && isSynced() && !loadRequested && buffer) {
@@ -920,15 +1148,22 @@ MultiFileStorage::BufferDeleter::operator()(void* buffer)
  * \param openFlags
  *      Extra flags for use while opening files in filePathsStr (default to 0,
  *      O_DIRECT may be used to disable the OS buffer cache.
+ * \param writeGroupSize
+ *      Maximum number of frames whose dirty data is written to storage in
+ *      one batch, followed by a single fdatasync of each file. 1 (the
+ *      default) writes each frame on its own; the caller should then pass
+ *      O_SYNC in \a openFlags to make each write durable.
  */
 MultiFileStorage::MultiFileStorage(size_t segmentSize,
                                    size_t frameCount,
                                    size_t writeRateLimit,
                                    size_t maxWriteBuffers,
                                    const char* filePathsStr,
-                                   int openFlags)
+                                   int openFlags,
+                                   size_t writeGroupSize)
     : BackupStorage(segmentSize, Type::DISK, writeRateLimit)
     , mutex()
+    , ioFinished()
     , ioQueue()
     , superblock()
     , lastSuperblockFrame(1)
@@ -937,6 +1172,7 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     , freeMap(frameCount)
     , lastAllocatedFrame(FreeMap::npos)
     , openFlags(openFlags)
+    , writeGroupSize(std::max(writeGroupSize, 1LU))
     , fds()
     , usingDevNull(filePathsStr != NULL && string(filePathsStr) == "/dev/null")
     , writeBuffersInUse(0)
@@ -1019,6 +1255,10 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     LOG(NOTICE, "Backup storage opened with %lu bytes available; allocated %lu "
             "frame(s) across %lu file(s) with %lu bytes per frame",
             frameCount * segmentSize, frameCount, fds.size(), segmentSize);
+    if (this->writeGroupSize > 1) {
+        LOG(NOTICE, "Writing up to %lu replicas to backup storage at once",
+            this->writeGroupSize);
+    }
 }
 
 /// Close the files.
@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_MULTIFILESTORAGE_H
 #define RAMCLOUD_MULTIFILESTORAGE_H
 
+#include <aio.h>
+#include <condition_variable>
 #include <stack>
 
 #include "Common.h"
@@ -86,10 +88,41 @@ class MultiFileStorage : public BackupStorage {
         void performTask();
 
       PRIVATE:
+        /**
+         * Describes a region of a frame's buffer (plus its metadata block)
+         * that is about to be flushed to storage, along with snapshots of
+         * the frame's state taken just before the write; used to update
+         * the frame once the write is durable. See prepareWrite().
+         */
+        struct PendingWrite {
+            /// Frame being written.
+            Frame* frame;
+
+            /// First dirty block in the frame's buffer.
+            char* data;
+
+            /// Offset of #data within the frame.
+            size_t offsetInFrame;
+
+            /// Bytes to write starting at #data (a multiple of BLOCK_SIZE).
+            size_t count;
+
+            /// Copy of the frame's most recently appended metadata.
+            char* metadata;
+
+            /// Value of #appendedLength when the write was prepared.
+            size_t appendedLength;
+
+            /// Value of #appendedMetadataVersion when the write was prepared.
+            uint64_t appendedMetadataVersion;
+        };
+
         void open(bool sync, ServerId masterId, uint64_t segmentId);
 
         void performRead(Lock& lock);
         void performWrite(Lock& lock);
+        PendingWrite prepareWrite();
+        void finishWrite(Lock& lock, const PendingWrite& write);
 
         bool isSynced() const;
 
@@ -217,8 +250,9 @@ class MultiFileStorage : public BackupStorage {
         bool testingHadToWaitForSyncOnLoad;
         static bool testingSkipRealIo;
 
-        // ONLY for open() and isSynced(); please try not to touch other
-        // details of frames in MultiFileStorage (or elsewhere).
+        // ONLY for open(), isSynced(), and grouping writes (writeGroup());
+        // please try not to touch other details of frames in
+        // MultiFileStorage (or elsewhere).
         friend class MultiFileStorage;
         DISALLOW_COPY_AND_ASSIGN(Frame);
     };
@@ -228,7 +262,8 @@ class MultiFileStorage : public BackupStorage {
                      size_t writeRateLimit,
                      size_t maxNonVolatileBuffers,
                      const char* filePaths,
-                     int openFlags = 0);
+                     int openFlags = 0,
+                     size_t writeGroupSize = 1);
     ~MultiFileStorage();
 
     FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
@@ -269,6 +304,14 @@ class MultiFileStorage : public BackupStorage {
     void unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
                        size_t frameIndex, off_t offsetInFrame,
                        void* metadataBuf, size_t metadataCount);
+    void unlockedWriteGroup(Frame::Lock& lock,
+                            std::vector<Frame::PendingWrite>& writes);
+    void startWrite(struct aiocb* cbs, void* buf, size_t count,
+                    size_t frameIndex, off_t offsetInFrame,
+                    void* metadataBuf, size_t metadataCount);
+    void waitForWrites(struct aiocb* cbs, size_t cbCount, uint64_t start);
+    void syncFiles();
+    void writeGroup(Frame::Lock& lock, Frame* first);
 
     void reserveSpace(int fd);
     Tub<Superblock> tryLoadSuperblock(uint32_t superblockFrame);
@@ -277,6 +320,12 @@ class MultiFileStorage : public BackupStorage {
     std::mutex mutex;
     typedef std::unique_lock<std::mutex> Lock;
 
+    /**
+     * Notified (with mutex held) whenever a frame's performingIo flag is
+     * cleared, so threads waiting for a frame's IO to finish can proceed.
+     */
+    std::condition_variable ioFinished;
+
     /**
      * Orders competing read/write operations for frames and calls back
      * to frames when their turn for IO arrives. Provides its own
@@ -317,6 +366,14 @@ class MultiFileStorage : public BackupStorage {
     /// Extra flags for use while opening filePath (e.g. O_DIRECT | O_SYNC).
     int openFlags;
 
+    /**
+     * Maximum number of frames whose dirty data is written to storage
+     * together by writeGroup(), followed by a single fdatasync of each file
+     * (unless the files were opened O_SYNC). 1 means each frame is written
+     * on its own by Frame::performWrite().
+     */
+    const size_t writeGroupSize;
+
     /**
      * The file descriptors of the storage files. See bytesInFramelet() for
      * details on how data is divided between files.
@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <thread>
+
 #include "TestUtil.h"
 #include "BackupMasterRecovery.h"
 #include "MultiFileStorage.h"
@@ -279,6 +281,73 @@ TEST_F(MultiFileStorageTest, Frame_appendSync) {
     EXPECT_STREQ(test, metadata);
 }
 
+TEST_F(MultiFileStorageTest, Frame_appendSyncGrouped) {
+    Frame::testingSkipRealIo = false;
+    // Without O_SYNC: grouped writes are made durable with fdatasync.
+    MultiFileStorage storage(segmentSize, segmentFrames, 0, segmentFrames,
+                             filePath1, O_DIRECT, 4);
+    storage.ioQueue.halt();
+    BackupStorage::FrameRef otherRef = storage.open(false, ServerId(), 0);
+    Frame* other = static_cast<Frame*>(otherRef.get());
+    other->append(testSource, 0, 5, 0, test, testLength + 1);
+    EXPECT_FALSE(other->isSynced());
+
+    BackupStorage::FrameRef frameRef = storage.open(true, ServerId(), 1);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+    EXPECT_TRUE(frame->isSynced());
+    EXPECT_TRUE(other->isSynced());
+    EXPECT_FALSE(frame->performingIo);
+    EXPECT_FALSE(other->performingIo);
+
+    // Force a read from disk.
+    other->buffer.reset();
+    {
+        Frame::Lock lock(storage.mutex);
+        other->loadRequested = true;
+        other->performRead(lock);
+    }
+    EXPECT_STREQ(test, bytes(other->load()));
+    EXPECT_STREQ(test, bytes(const_cast<void*>(other->getMetadata())));
+}
+
+// Helper function that runs in a separate thread for the following test.
+static void appendInThread(MultiFileStorage::Frame* frame, Buffer* source,
+        const char* metadata, size_t metadataLength) {
+    frame->append(*source, 0, 5, 0, metadata, metadataLength);
+}
+
+TEST_F(MultiFileStorageTest, Frame_appendSyncGroupedWaitsForIo) {
+    MultiFileStorage storage(segmentSize, segmentFrames, 0, segmentFrames,
+                             filePath1, O_DIRECT, 4);
+    storage.ioQueue.halt();
+    BackupStorage::FrameRef frameRef = storage.open(true, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->performingIo = true;
+    std::thread thread(appendInThread, frame, &testSource, test,
+                       testLength + 1);
+
+    // Once the data is appended, the append must block until the other
+    // IO on the frame finishes.
+    for (int i = 0; i < 1000; i++) {
+        Frame::Lock lock(storage.mutex);
+        if (frame->appendedLength > 0)
+            break;
+        lock.unlock();
+        usleep(1000);
+    }
+    {
+        Frame::Lock lock(storage.mutex);
+        EXPECT_EQ(5LU, frame->appendedLength);
+        EXPECT_FALSE(frame->isSynced());
+        frame->performingIo = false;
+        storage.ioFinished.notify_all();
+    }
+    thread.join();
+    EXPECT_TRUE(frame->isSynced());
+    EXPECT_FALSE(frame->performingIo);
+}
+
 TEST_F(MultiFileStorageTest, Frame_appendNothingAdded) {
     BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
     Frame* frame = static_cast<Frame*>(frameRef.get());
@@ -654,6 +723,54 @@ TEST_F(MultiFileStorageTest, Frame_performWriteSmokeTestOffsets) {
               TestLog::get());
 }
 
+TEST_F(MultiFileStorageTest, Frame_performTaskGroupsWrites) {
+    MultiFileStorage storage(segmentSize, segmentFrames, 0, segmentFrames,
+                             filePath1, O_DIRECT, 3);
+    storage.ioQueue.halt();
+    std::vector<BackupStorage::FrameRef> frameRefs;
+    std::vector<Frame*> frames;
+    for (uint32_t i = 0; i < segmentFrames; ++i) {
+        frameRefs.push_back(storage.open(false, ServerId(), i));
+        frames.push_back(static_cast<Frame*>(frameRefs.back().get()));
+        frames.back()->append(testSource, 0, 5, 0, test, testLength + 1);
+    }
+    TestLog::Enable _;
+    frames[2]->performTask();
+    EXPECT_EQ("writeGroup: sourceBufferOffset 0 count 512 frameIndex 0 | "
+              "writeGroup: sourceBufferOffset 0 count 512 frameIndex 1 | "
+              "writeGroup: sourceBufferOffset 0 count 512 frameIndex 2",
+              TestLog::get());
+    EXPECT_TRUE(frames[0]->isSynced());
+    EXPECT_TRUE(frames[1]->isSynced());
+    EXPECT_TRUE(frames[2]->isSynced());
+    EXPECT_FALSE(frames[3]->isSynced());
+    foreach (Frame* frame, frames)
+        EXPECT_FALSE(frame->performingIo);
+
+    // Frames written along with another frame have nothing left to do.
+    TestLog::reset();
+    frames[0]->performTask();
+    EXPECT_EQ("", TestLog::get());
+
+    frames[3]->performTask();
+    EXPECT_EQ("writeGroup: sourceBufferOffset 0 count 512 frameIndex 3",
+              TestLog::get());
+    EXPECT_TRUE(frames[3]->isSynced());
+}
+
+TEST_F(MultiFileStorageTest, Frame_performTaskBeingWrittenInGroup) {
+    storage1->ioQueue.halt();
+    BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+    TestLog::Enable _;
+    frame->performingIo = true;
+    frame->performTask();
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_FALSE(frame->isSynced());
+    frame->performingIo = false;
+}
+
 TEST_F(MultiFileStorageTest, Frame_performRead) {
     BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
     Frame* frame = static_cast<Frame*>(frameRef.get());
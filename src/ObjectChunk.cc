@@ -0,0 +1,306 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Crc32C.h"
+#include "ObjectChunk.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a new chunk in preparation for appending it to the log. The
+ * key and the data are not copied; both must remain valid until the chunk
+ * has been appended to the log.
+ *
+ * \param key
+ *      Primary key of the chunked object.
+ * \param version
+ *      Version of the chunked object.
+ * \param chunkIndex
+ *      Position of this chunk within the object's value.
+ * \param timestamp
+ *      The creation time of this chunk, as returned by the WallTime module.
+ * \param dataBuffer
+ *      Buffer containing the chunk's data.
+ * \param dataOffset
+ *      Byte offset of the chunk's data within dataBuffer.
+ * \param dataLength
+ *      Number of data bytes in this chunk.
+ */
+ObjectChunk::ObjectChunk(Key& key, uint64_t version, uint32_t chunkIndex,
+                         uint32_t timestamp, Buffer& dataBuffer,
+                         uint32_t dataOffset, uint32_t dataLength)
+    : header(key.getTableId(), version, chunkIndex, timestamp,
+             key.getStringKeyLength()),
+      stringKey(key.getStringKey()),
+      buffer(&dataBuffer),
+      keyOffset(0),
+      dataOffset(dataOffset),
+      dataLength(dataLength)
+{
+    header.checksum = computeChecksum();
+}
+
+/**
+ * Construct an ObjectChunk by deserializing an existing one, typically one
+ * stored in the log or in a recovery segment.
+ *
+ * \param buffer
+ *      Buffer pointing to a complete serialized chunk. It is the caller's
+ *      responsibility to make sure the buffer actually contains one.
+ * \param offset
+ *      Starting offset in the buffer where the chunk begins.
+ * \param length
+ *      Total length of the chunk in bytes. A length of 0 means that the
+ *      chunk occupies the entire buffer starting at offset.
+ */
+ObjectChunk::ObjectChunk(Buffer& buffer, uint32_t offset, uint32_t length)
+    : header(*buffer.getOffset<Header>(offset)),
+      stringKey(NULL),
+      buffer(&buffer),
+      keyOffset(offset + sizeof32(Header)),
+      dataOffset(offset + sizeof32(Header) + header.keyLength),
+      dataLength()
+{
+    if (length == 0)
+        length = buffer.size() - offset;
+    dataLength = length - sizeof32(Header) - header.keyLength;
+}
+
+/**
+ * Append the full chunk, exactly as it should be stored in the log, to a
+ * buffer. The data is appended by reference.
+ *
+ * \param output
+ *      The buffer to append a serialized version of this chunk to.
+ */
+void
+ObjectChunk::assembleForLog(Buffer& output)
+{
+    output.appendExternal(&header, sizeof32(header));
+    if (stringKey != NULL)
+        output.appendExternal(stringKey, header.keyLength);
+    else
+        output.appendExternal(buffer, keyOffset, header.keyLength);
+    appendDataToBuffer(output);
+}
+
+/**
+ * Append (by reference) this chunk's slice of the object's value to a buffer.
+ *
+ * \param output
+ *      The buffer to append the data to.
+ */
+void
+ObjectChunk::appendDataToBuffer(Buffer& output)
+{
+    output.appendExternal(buffer, dataOffset, dataLength);
+}
+
+/**
+ * Obtain the 64-bit table identifier of the chunked object.
+ */
+uint64_t
+ObjectChunk::getTableId()
+{
+    return header.tableId;
+}
+
+/**
+ * Obtain a contiguous copy of the primary key of the chunked object.
+ */
+const void*
+ObjectChunk::getKey()
+{
+    if (stringKey != NULL)
+        return stringKey;
+    return buffer->getRange(keyOffset, header.keyLength);
+}
+
+/**
+ * Obtain the length of the primary key of the chunked object.
+ */
+KeyLength
+ObjectChunk::getKeyLength()
+{
+    return header.keyLength;
+}
+
+/**
+ * Obtain the version of the object this chunk belongs to.
+ */
+uint64_t
+ObjectChunk::getVersion()
+{
+    return header.version;
+}
+
+/**
+ * Obtain the position of this chunk within its object's value.
+ */
+uint32_t
+ObjectChunk::getChunkIndex()
+{
+    return header.chunkIndex;
+}
+
+/**
+ * Obtain the creation timestamp of this chunk.
+ */
+uint32_t
+ObjectChunk::getTimestamp()
+{
+    return header.timestamp;
+}
+
+/**
+ * Obtain the number of value bytes stored in this chunk.
+ */
+uint32_t
+ObjectChunk::getDataLength()
+{
+    return dataLength;
+}
+
+/**
+ * Obtain the checksum stored in the chunk's header. This is the value the
+ * object's manifest records for the chunk.
+ */
+uint32_t
+ObjectChunk::getChecksum()
+{
+    return header.checksum;
+}
+
+/**
+ * Compute a checksum on the chunk and determine whether or not it matches
+ * what is stored in its header. Returns true if the checksum looks ok,
+ * otherwise returns false.
+ */
+bool
+ObjectChunk::checkIntegrity()
+{
+    return computeChecksum() == header.checksum;
+}
+
+/**
+ * Obtain the total size of the chunk including its header and key.
+ */
+uint32_t
+ObjectChunk::getSerializedLength()
+{
+    return sizeof32(header) + header.keyLength + dataLength;
+}
+
+/**
+ * Compute the chunk's checksum and return it.
+ */
+uint32_t
+ObjectChunk::computeChecksum()
+{
+    assert(OFFSET_OF(Header, checksum) ==
+        (sizeof(header) - sizeof(header.checksum)));
+
+    Crc32C crc;
+    crc.update(&header, downCast<uint32_t>(OFFSET_OF(Header, checksum)));
+    if (stringKey != NULL)
+        crc.update(stringKey, header.keyLength);
+    else
+        crc.update(*buffer, keyOffset, header.keyLength);
+    crc.update(*buffer, dataOffset, dataLength);
+    return crc.getResult();
+}
+
+/**
+ * Construct an empty manifest for a new chunked object. Chunk checksums
+ * are added with addChunk() as chunks are created.
+ *
+ * \param valueLength
+ *      Total length of the object's value.
+ * \param chunkSize
+ *      Maximum number of value bytes stored in each chunk.
+ */
+ObjectChunkManifest::ObjectChunkManifest(uint64_t valueLength,
+                                         uint32_t chunkSize)
+    : header()
+    , checksums()
+{
+    header.valueLength = valueLength;
+    header.chunkCount = 0;
+    header.chunkSize = chunkSize;
+}
+
+/**
+ * Deserialize a manifest, typically from the value of a manifest entry in
+ * the log.
+ *
+ * \param buffer
+ *      Buffer containing the serialized manifest.
+ * \param offset
+ *      Byte offset of the manifest within buffer.
+ */
+ObjectChunkManifest::ObjectChunkManifest(Buffer& buffer, uint32_t offset)
+    : header(*buffer.getOffset<Header>(offset))
+    , checksums(header.chunkCount)
+{
+    if (header.chunkCount > 0) {
+        buffer.copy(offset + sizeof32(Header),
+                    header.chunkCount * sizeof32(uint32_t),
+                    &checksums[0]);
+    }
+}
+
+/**
+ * Record the next chunk of the object.
+ *
+ * \param checksum
+ *      Checksum of the chunk's log entry (see ObjectChunk::getChecksum).
+ */
+void
+ObjectChunkManifest::addChunk(uint32_t checksum)
+{
+    checksums.push_back(checksum);
+    header.chunkCount = downCast<uint32_t>(checksums.size());
+}
+
+/**
+ * Append a serialized copy of this manifest to a buffer.
+ *
+ * \param buffer
+ *      The buffer to append to.
+ */
+void
+ObjectChunkManifest::assemble(Buffer& buffer)
+{
+    buffer.appendCopy(&header);
+    if (header.chunkCount > 0) {
+        buffer.appendCopy(&checksums[0],
+                          header.chunkCount * sizeof32(uint32_t));
+    }
+}
+
+/**
+ * Return the checksum recorded for a given chunk.
+ *
+ * \param chunkIndex
+ *      Index of the chunk. Must be less than getChunkCount().
+ */
+uint32_t
+ObjectChunkManifest::getChunkChecksum(uint32_t chunkIndex)
+{
+    assert(chunkIndex < checksums.size());
+    return checksums[chunkIndex];
+}
+
+} // namespace RAMCloud
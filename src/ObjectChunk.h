@@ -0,0 +1,210 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_OBJECTCHUNK_H
+#define RAMCLOUD_OBJECTCHUNK_H
+
+#include <vector>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "Key.h"
+
+namespace RAMCloud {
+
+/**
+ * Objects whose value is too large to be stored in a single log entry (and
+ * thus in a single segment) are stored as a "chunked object": a sequence of
+ * ObjectChunk log entries, each holding a contiguous slice of the value,
+ * followed by a manifest entry (LOG_ENTRY_TYPE_OBJMANIFEST). The manifest has
+ * exactly the format of an Object, except that its value is an
+ * ObjectChunkManifest describing the chunks rather than the user's data.
+ *
+ * The manifest is the commit point for the object: it is appended only after
+ * all of its chunks, so once it is durable all of the chunks are as well.
+ * Chunks are indexed in the hash table under the same key hash as their
+ * manifest, so they are protected by the same bucket lock and found with the
+ * same lookup. A chunk is live only while the manifest currently in the hash
+ * table has the chunk's version and records the chunk's checksum.
+ *
+ * When stored in the log, an ObjectChunk has the following layout:
+ *
+ * +--------------------+-------------+------------+
+ * | ObjectChunk Header | Primary Key | Chunk Data |
+ * +--------------------+-------------+------------+
+ */
+class ObjectChunk {
+  public:
+    ObjectChunk(Key& key, uint64_t version, uint32_t chunkIndex,
+                uint32_t timestamp, Buffer& dataBuffer,
+                uint32_t dataOffset, uint32_t dataLength);
+    explicit ObjectChunk(Buffer& buffer, uint32_t offset = 0,
+                         uint32_t length = 0);
+
+    void assembleForLog(Buffer& buffer);
+    void appendDataToBuffer(Buffer& buffer);
+
+    uint64_t getTableId();
+    const void* getKey();
+    KeyLength getKeyLength();
+    uint64_t getVersion();
+    uint32_t getChunkIndex();
+    uint32_t getTimestamp();
+    uint32_t getDataLength();
+    uint32_t getChecksum();
+
+    bool checkIntegrity();
+    uint32_t getSerializedLength();
+    uint32_t computeChecksum();
+
+    /**
+     * This data structure defines the format of an ObjectChunk header stored
+     * in a master server's log.
+     */
+    class Header {
+      public:
+        /**
+         * Construct a serialized ObjectChunk header.
+         *
+         * \param tableId
+         *      Table containing the chunked object.
+         * \param version
+         *      Version of the chunked object this chunk belongs to.
+         * \param chunkIndex
+         *      Position of this chunk within the object's value.
+         * \param timestamp
+         *      The creation time of this chunk, as returned by the WallTime
+         *      module. Used by the cleaner to order live entries.
+         * \param keyLength
+         *      Length of the primary key that follows the header.
+         */
+        Header(uint64_t tableId, uint64_t version, uint32_t chunkIndex,
+               uint32_t timestamp, KeyLength keyLength)
+            : tableId(tableId),
+              version(version),
+              chunkIndex(chunkIndex),
+              timestamp(timestamp),
+              keyLength(keyLength),
+              checksum(0)
+        {
+        }
+
+        /// Table to which the chunked object belongs.
+        uint64_t tableId;
+
+        /// Version of the object this chunk is part of. Chunks of older or
+        /// aborted versions are garbage.
+        uint64_t version;
+
+        /// Index of this chunk in the object's value; the chunk's data
+        /// starts at byte chunkIndex * chunkSize of the value.
+        uint32_t chunkIndex;
+
+        /// Chunk creation timestamp. WallTime.cc is the clock.
+        uint32_t timestamp;
+
+        /// Length of the primary key following this header.
+        KeyLength keyLength;
+
+        /// CRC32C checksum covering everything but this field, including the
+        /// key and the data. The manifest records this value for every chunk
+        /// so that stale chunks with the same version (for example, left
+        /// behind by a write that never committed) can be told apart.
+        uint32_t checksum;
+
+        /// Following this class will be the key and then the data. This
+        /// member is only here to denote this.
+        char keyAndData[0];
+    } __attribute__((__packed__));
+    static_assert(sizeof(Header) == 30,
+        "Unexpected serialized ObjectChunk size");
+
+    /// Copy of the chunk header that is in, or will be written to, the log.
+    Header header;
+
+    /// If the chunk was constructed from a Key, this points to the key's
+    /// contiguous string. Otherwise NULL and the key is in #buffer.
+    const void* stringKey;
+
+    /// Buffer holding the data (and, for deserialized chunks, the key).
+    Buffer* buffer;
+
+    /// Offset of the primary key within #buffer; unused if #stringKey is set.
+    uint32_t keyOffset;
+
+    /// Offset of the data within #buffer.
+    uint32_t dataOffset;
+
+    /// Number of data bytes in this chunk.
+    uint32_t dataLength;
+
+    DISALLOW_COPY_AND_ASSIGN(ObjectChunk);
+};
+
+/**
+ * The value of a chunked object's manifest entry. It records how the value
+ * was split and the checksum of each chunk entry, which is how readers,
+ * the cleaner and recovery decide which chunk entries belong to the object.
+ *
+ * +-----------------+---------------------------------+
+ * | Manifest Header | uint32_t checksum[chunkCount]   |
+ * +-----------------+---------------------------------+
+ */
+class ObjectChunkManifest {
+  public:
+    ObjectChunkManifest(uint64_t valueLength, uint32_t chunkSize);
+    explicit ObjectChunkManifest(Buffer& buffer, uint32_t offset = 0);
+
+    void addChunk(uint32_t checksum);
+    void assemble(Buffer& buffer);
+
+    /// Total length of the object's value, in bytes.
+    uint64_t getValueLength() { return header.valueLength; }
+
+    /// Number of chunks the value was split into.
+    uint32_t getChunkCount() { return header.chunkCount; }
+
+    /// Maximum number of value bytes stored in each chunk.
+    uint32_t getChunkSize() { return header.chunkSize; }
+
+    uint32_t getChunkChecksum(uint32_t chunkIndex);
+
+    /**
+     * Fixed-length portion of a serialized manifest.
+     */
+    struct Header {
+        /// Total length of the object's value, in bytes.
+        uint64_t valueLength;
+
+        /// Number of chunks (and checksums following this header).
+        uint32_t chunkCount;
+
+        /// Maximum number of value bytes in each chunk; every chunk but
+        /// the last holds exactly this many.
+        uint32_t chunkSize;
+    } __attribute__((__packed__));
+    static_assert(sizeof(Header) == 16,
+        "Unexpected serialized ObjectChunkManifest size");
+
+    /// Copy of the serialized header.
+    Header header;
+
+    /// Checksum of each chunk entry, indexed by chunk number.
+    std::vector<uint32_t> checksums;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_OBJECTCHUNK_H
@@ -0,0 +1,145 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ObjectChunk.h"
+
+namespace RAMCloud {
+
+/**
+ * Unit tests for ObjectChunk and ObjectChunkManifest.
+ */
+class ObjectChunkTest : public ::testing::Test {
+  public:
+    ObjectChunkTest()
+        : stringKey(),
+          data(),
+          dataBuffer(),
+          logBuffer(),
+          chunkFromKey(),
+          chunkFromBuffer()
+    {
+        snprintf(stringKey, sizeof(stringKey), "key!");
+        snprintf(data, sizeof(data), "0123456789");
+        Key key(572, stringKey, 5);
+
+        dataBuffer.appendExternal(data, 10);
+        chunkFromKey.construct(key, 3UL, 2U, 99U, dataBuffer, 4U, 6U);
+        chunkFromKey->assembleForLog(logBuffer);
+
+        // prepend some garbage to logBuffer so that we can test the
+        // constructor with a non-zero offset
+        memcpy(logBuffer.allocPrepend(sizeof(stringKey)), &stringKey,
+                sizeof(stringKey));
+
+        chunkFromBuffer.construct(logBuffer, sizeof32(stringKey),
+                                  logBuffer.size() - sizeof32(stringKey));
+
+        chunks[0] = &*chunkFromKey;
+        chunks[1] = &*chunkFromBuffer;
+    }
+
+    // Don't use static strings, since they'll be loaded into read-only
+    // memory and we can't mutate to test checksumming.
+    char stringKey[5];
+    char data[11];
+
+    Buffer dataBuffer;
+    Buffer logBuffer;
+
+    Tub<ObjectChunk> chunkFromKey;
+    Tub<ObjectChunk> chunkFromBuffer;
+
+    ObjectChunk* chunks[2];
+
+    DISALLOW_COPY_AND_ASSIGN(ObjectChunkTest);
+};
+
+TEST_F(ObjectChunkTest, constructors) {
+    for (uint32_t i = 0; i < arrayLength(chunks); i++) {
+        ObjectChunk& chunk = *chunks[i];
+        EXPECT_EQ(572U, chunk.getTableId());
+        EXPECT_EQ(5U, chunk.getKeyLength());
+        EXPECT_EQ("key!", string(reinterpret_cast<const char*>(
+                chunk.getKey())));
+        EXPECT_EQ(3UL, chunk.getVersion());
+        EXPECT_EQ(2U, chunk.getChunkIndex());
+        EXPECT_EQ(99U, chunk.getTimestamp());
+        EXPECT_EQ(6U, chunk.getDataLength());
+        EXPECT_EQ(sizeof(ObjectChunk::Header) + 5 + 6,
+                  chunk.getSerializedLength());
+    }
+    EXPECT_EQ(chunkFromKey->getChecksum(), chunkFromBuffer->getChecksum());
+}
+
+TEST_F(ObjectChunkTest, assembleForLog) {
+    for (uint32_t i = 0; i < arrayLength(chunks); i++) {
+        Buffer buffer;
+        chunks[i]->assembleForLog(buffer);
+        EXPECT_EQ(sizeof(ObjectChunk::Header) + 5 + 6, buffer.size());
+        const ObjectChunk::Header* header =
+                buffer.getStart<ObjectChunk::Header>();
+        EXPECT_EQ(572U, header->tableId);
+        EXPECT_EQ(3UL, header->version);
+        EXPECT_EQ(2U, header->chunkIndex);
+        EXPECT_EQ(chunks[i]->getChecksum(), header->checksum);
+        EXPECT_EQ("key!", string(reinterpret_cast<const char*>(
+                buffer.getRange(sizeof32(*header), 5))));
+        EXPECT_EQ("456789", string(reinterpret_cast<const char*>(
+                buffer.getRange(sizeof32(*header) + 5, 6)), 6));
+    }
+}
+
+TEST_F(ObjectChunkTest, appendDataToBuffer) {
+    for (uint32_t i = 0; i < arrayLength(chunks); i++) {
+        Buffer buffer;
+        chunks[i]->appendDataToBuffer(buffer);
+        EXPECT_EQ("456789", TestUtil::toString(&buffer));
+    }
+}
+
+TEST_F(ObjectChunkTest, checkIntegrity) {
+    for (uint32_t i = 0; i < arrayLength(chunks); i++)
+        EXPECT_TRUE(chunks[i]->checkIntegrity());
+
+    // Both chunks reference the same data (assembleForLog does not copy).
+    data[5] = 'X';
+    for (uint32_t i = 0; i < arrayLength(chunks); i++)
+        EXPECT_FALSE(chunks[i]->checkIntegrity());
+}
+
+TEST_F(ObjectChunkTest, manifest) {
+    ObjectChunkManifest manifest(2500UL, 1000U);
+    EXPECT_EQ(0U, manifest.getChunkCount());
+    manifest.addChunk(11);
+    manifest.addChunk(22);
+    manifest.addChunk(33);
+
+    Buffer buffer;
+    buffer.appendCopy("junk", 4);
+    manifest.assemble(buffer);
+    EXPECT_EQ(4 + sizeof(ObjectChunkManifest::Header) + 3 * 4,
+              buffer.size());
+
+    ObjectChunkManifest deserialized(buffer, 4);
+    EXPECT_EQ(2500UL, deserialized.getValueLength());
+    EXPECT_EQ(1000U, deserialized.getChunkSize());
+    EXPECT_EQ(3U, deserialized.getChunkCount());
+    EXPECT_EQ(11U, deserialized.getChunkChecksum(0));
+    EXPECT_EQ(22U, deserialized.getChunkChecksum(1));
+    EXPECT_EQ(33U, deserialized.getChunkChecksum(2));
+}
+
+}  // namespace RAMCloud
@@ -18,22 +18,49 @@
 #include "IndexKey.h"
 #include "ObjectFinder.h"
 #include "FailSession.h"
+#include "SharedTableConfigs.h"
 
 namespace RAMCloud {
 
 /**
  * The implementation of ObjectFinder::TableConfigFetcher that is used for
- * normal execution. This class is not thread-safe; requests to the class
- * must be serialized externally.
+ * normal execution. It remembers the last configuration received for each
+ * table, so that refetching a configuration that hasn't changed (e.g.,
+ * while waiting for a recovery to finish) costs the coordinator almost
+ * nothing. If a SharedTableConfigs is provided, configurations are also
+ * exchanged with the fetchers of other clients in the same process, so that
+ * each configuration change is fetched from the coordinator only once. This
+ * class is not thread-safe; requests to the class must be serialized
+ * externally.
  */
 class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
   public:
-    explicit RealTableConfigFetcher(Context* context)
+    /**
+     * Constructor for RealTableConfigFetcher.
+     *
+     * \param context
+     *      Overall information about this client.
+     * \param shared
+     *      If non-NULL, configurations are shared through this object,
+     *      which must outlive the fetcher.
+     */
+    explicit RealTableConfigFetcher(Context* context,
+            SharedTableConfigs* shared = NULL)
         : context(context)
         , getTableConfigRpc()
         , tableId()
+        , configs()
+        , nextUse(0)
+        , shared(shared)
+        , reader(shared == NULL ? NULL : shared->registerReader())
     {}
 
+    ~RealTableConfigFetcher()
+    {
+        if (shared != NULL)
+            shared->unregisterReader(reader);
+    }
+
     /**
      * This method deletes the currently cached outstanding RPC, restoring
      * this object to its original pristine state.
@@ -72,35 +99,154 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
                                     IndexletWithLocator>* tableIndexMap)
     {
         if (!getTableConfigRpc) {
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
+            if (getSharedConfig(requestedTableId)) {
+                addToMaps(requestedTableId, configs[requestedTableId].config,
+                        tableMap, tableIndexMap);
+                return true;
+            }
+            startRpc(requestedTableId);
         }
 
         if (!getTableConfigRpc->isReady()) {
             return false;
         }
 
-        ProtoBuf::TableConfig tableConfig;
+        ProtoBuf::TableConfig newConfig;
+        uint64_t version;
+        bool changed;
         try {
-            getTableConfigRpc->wait(&tableConfig);
+            changed = getTableConfigRpc->wait(&newConfig, &version);
         } catch (TableDoesntExistException& e) {
+            configs.erase(*tableId);
+            if (shared != NULL)
+                shared->erase(*tableId);
             clear();
             throw e;
         }
 
+        // Remember the configuration, so that next time the coordinator
+        // needn't send it unless it has changed.
+        const ProtoBuf::TableConfig* config = &newConfig;
+        if (changed) {
+            if (version != 0) {
+                CachedConfig& cached = cache(*tableId);
+                cached.version = version;
+                cached.config.Swap(&newConfig);
+                config = &cached.config;
+                if (shared != NULL)
+                    shared->put(*tableId, version, cached.config);
+            } else {
+                configs.erase(*tableId);
+            }
+        } else {
+            config = &cache(*tableId).config;
+        }
+        addToMaps(*tableId, *config, tableMap, tableIndexMap);
+
+        if (*tableId == requestedTableId) {
+            clear();
+            return true;
+        } else {
+            // The RPC processed above isn't the one we want; initiate a new
+            // RPC for the table we currently request.
+            startRpc(requestedTableId);
+            return false;
+        }
+    }
+
+  private:
+    /// Maximum number of entries in #configs.
+    static const size_t MAX_CACHED_CONFIGS = 1000;
+
+    /**
+     * The most recent configuration received for a table.
+     */
+    struct CachedConfig {
+        CachedConfig()
+            : version(0)
+            , config()
+            , lastUse(0)
+        {}
+
+        /// Version of the configuration, as returned by the coordinator.
+        uint64_t version;
+
+        /// The configuration itself.
+        ProtoBuf::TableConfig config;
+
+        /// Value of #nextUse when the entry was last stored or confirmed;
+        /// used to pick an entry to evict.
+        uint64_t lastUse;
+    };
+
+    /**
+     * Return the entry in #configs for a table, creating an empty one if
+     * there is none, and mark it as the most recently used. If #configs is
+     * full, the least recently used entry is evicted to make room, so that
+     * a client that touches many tables doesn't accumulate their
+     * configurations forever.
+     *
+     * \param configTableId
+     *      The table whose entry is needed.
+     */
+    CachedConfig&
+    cache(uint64_t configTableId)
+    {
+        if (configs.size() >= MAX_CACHED_CONFIGS &&
+                configs.find(configTableId) == configs.end()) {
+            auto victim = configs.begin();
+            for (auto it = configs.begin(); it != configs.end(); ++it) {
+                if (it->second.lastUse < victim->second.lastUse)
+                    victim = it;
+            }
+            configs.erase(victim);
+        }
+        CachedConfig& cached = configs[configTableId];
+        cached.lastUse = nextUse++;
+        return cached;
+    }
+
+    /**
+     * Add the tablets and indexlets of a table's configuration to the
+     * ObjectFinder's maps.
+     *
+     * \param configTableId
+     *      The table whose configuration this is.
+     * \param tableConfig
+     *      The configuration, as returned by the coordinator.
+     * \param[out] tableMap
+     *      Reference to ObjectFinder::tableMap.
+     * \param[out] tableIndexMap
+     *      Reference to ObjectFinder::tableIndexMap.
+     */
+    void
+    addToMaps(uint64_t configTableId,
+              const ProtoBuf::TableConfig& tableConfig,
+              std::map<TabletKey, TabletWithLocator>* tableMap,
+              std::multimap<std::pair<uint64_t, uint8_t>,
+                            IndexletWithLocator>* tableIndexMap)
+    {
         for (const ProtoBuf::TableConfig::Tablet& tablet :
                 tableConfig.tablet()) {
-            Tablet rawTablet(*tableId,
+            Tablet rawTablet(configTableId,
                              tablet.start_key_hash(),
                              tablet.end_key_hash(),
                              ServerId(tablet.server_id()),
                              Tablet::Status(tablet.state()),
                              LogPosition(tablet.ctime_log_head_id(),
                                          tablet.ctime_log_head_offset()));
+            TabletWithLocator tabletWithLocator(rawTablet,
+                                                tablet.service_locator());
+            if (tablet.has_recovery_service_locator()) {
+                tabletWithLocator.tablet.recoveryMasterId =
+                        ServerId(tablet.recovery_server_id());
+                tabletWithLocator.recoveryLocator =
+                        tablet.recovery_service_locator();
+            }
 
             tableMap->emplace(
-                    TabletKey{*tableId, tablet.start_key_hash()},
-                    TabletWithLocator(rawTablet, tablet.service_locator()));
+                    TabletKey{configTableId, tablet.start_key_hash()},
+                    tabletWithLocator);
         }
 
         for (const ProtoBuf::TableConfig::Index& index : tableConfig.index()) {
@@ -116,24 +262,64 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
                         rawIndexlet, indexlet.service_locator());
 
                 tableIndexMap->emplace(
-                        std::make_pair(*tableId, index.index_id()),
+                        std::make_pair(configTableId, index.index_id()),
                         indexletWithLocator);
             }
         }
+    }
 
-        if (*tableId == requestedTableId) {
-            clear();
-            return true;
-        } else {
-            // The RPC processed above isn't the one we want; initiate a new
-            // RPC for the table we currently request.
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
+    /**
+     * Check whether another client sharing #shared has recorded a newer
+     * configuration for a table than the one we last used; if so, adopt it
+     * as our cached configuration, so that no RPC is needed.
+     *
+     * \param requestedTableId
+     *      The table whose configuration is needed.
+     * \return
+     *      True means configs[requestedTableId] now holds a configuration
+     *      that we haven't used before.
+     */
+    bool
+    getSharedConfig(uint64_t requestedTableId)
+    {
+        if (shared == NULL)
+            return false;
+        uint64_t knownVersion = 0;
+        auto it = configs.find(requestedTableId);
+        if (it != configs.end())
+            knownVersion = it->second.version;
+        ProtoBuf::TableConfig config;
+        uint64_t version;
+        if (!shared->get(reader, requestedTableId, knownVersion, &version,
+                &config)) {
             return false;
         }
+        RAMCLOUD_TEST_LOG("table %lu: using shared configuration",
+                requestedTableId);
+        CachedConfig& cached = cache(requestedTableId);
+        cached.version = version;
+        cached.config.Swap(&config);
+        return true;
+    }
+
+    /**
+     * Start an RPC to fetch the configuration of a table, asking the
+     * coordinator not to resend the configuration we already have.
+     *
+     * \param requestedTableId
+     *      The id of the table whose configuration is to be fetched.
+     */
+    void
+    startRpc(uint64_t requestedTableId)
+    {
+        uint64_t knownVersion = 0;
+        auto it = configs.find(requestedTableId);
+        if (it != configs.end())
+            knownVersion = it->second.version;
+        tableId = requestedTableId;
+        getTableConfigRpc.construct(context, requestedTableId, knownVersion);
     }
 
-  private:
     Context* const context;
 
     /// The outstanding RPC currently cached by this table config fetcher.
@@ -144,6 +330,22 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
     /// outstanding RPC.
     Tub<uint64_t> tableId;
 
+    /// The last configuration received for each table, indexed by table
+    /// id. Entries are kept after ObjectFinder flushes its copy of a
+    /// table's configuration, so that they can be validated cheaply, but
+    /// there are at most MAX_CACHED_CONFIGS of them (see #cache).
+    std::unordered_map<uint64_t, CachedConfig> configs;
+
+    /// Counter used to order uses of #configs entries.
+    uint64_t nextUse;
+
+    /// If non-NULL, configurations are shared with other clients through
+    /// this object.
+    SharedTableConfigs* shared;
+
+    /// This fetcher's reader for #shared; NULL if #shared is NULL.
+    SharedTableConfigs::Reader* reader;
+
     DISALLOW_COPY_AND_ASSIGN(RealTableConfigFetcher);
 };
 
@@ -228,6 +430,11 @@ ObjectFinder::flushSession(uint64_t tableId, KeyHash keyHash)
         context->transportManager->flushSession(
                 tabletWithLocator->serviceLocator);
         tabletWithLocator->session = NULL;
+        if (tabletWithLocator->recoverySession) {
+            context->transportManager->flushSession(
+                    tabletWithLocator->recoveryLocator);
+            tabletWithLocator->recoverySession = NULL;
+        }
     }
 }
 
@@ -469,6 +676,25 @@ void ObjectFinder::reset()
     tableConfigFetcher->clear();
 }
 
+/**
+ * Arrange for table configurations to be shared with the ObjectFinders of
+ * other clients in the same process (see ShardedRamCloud): configurations
+ * fetched by any of them are used by all, so each change is fetched from the
+ * coordinator only once. Only the configurations are shared; each
+ * ObjectFinder keeps its own tablet map and sessions, so lookups never touch
+ * shared state.
+ *
+ * \param shared
+ *      Configurations are exchanged through this object, which must
+ *      outlive this ObjectFinder.
+ */
+void
+ObjectFinder::shareTableConfigs(SharedTableConfigs* shared)
+{
+    SpinLock::Guard _(mutex);
+    tableConfigFetcher.reset(new RealTableConfigFetcher(context, shared));
+}
+
 /**
  * Find information about the tablet containing a key in a given table.
  *
@@ -528,6 +754,49 @@ ObjectFinder::tryLookup(uint64_t tableId, KeyHash keyHash)
     return tabletWithLocator->session;
 }
 
+/**
+ * This method is similar to tryLookup, except that it is used by reads that
+ * are willing to accept degraded results. If the tablet containing the key
+ * hash is being recovered, and the coordinator has said which recovery
+ * master is replaying it, a session for that recovery master is returned,
+ * rather than waiting for the recovery to complete. The recovery master
+ * serves reads from the data that it has replayed so far.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param keyHash
+ *      A hash value in the space of key hashes.
+ * \return
+ *      Session for communication with the server who holds the tablet (or
+ *      is recovering it). NULL session means the result is not available
+ *      yet and the caller should try again later.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+Transport::SessionRef
+ObjectFinder::tryLookupDegraded(uint64_t tableId, KeyHash keyHash)
+{
+    Transport::SessionRef session = tryLookup(tableId, keyHash);
+    if (session)
+        return session;
+
+    SpinLock::Guard guard(mutex);
+    TabletKey key{tableId, keyHash};
+    TabletWithLocator* tabletWithLocator = lookupTabletInCache(guard, &key);
+    if (tabletWithLocator == NULL ||
+            tabletWithLocator->tablet.status != Tablet::Status::RECOVERING ||
+            tabletWithLocator->recoveryLocator.empty()) {
+        return Transport::SessionRef();
+    }
+    if (!tabletWithLocator->recoverySession) {
+        tabletWithLocator->recoverySession =
+                context->transportManager->getSession(
+                tabletWithLocator->recoveryLocator);
+    }
+    return tabletWithLocator->recoverySession;
+}
+
 /**
  * Attempts to find the master holding the indexlet containing a given key.
  *
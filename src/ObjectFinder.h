@@ -33,6 +33,8 @@
 
 namespace RAMCloud {
 
+class SharedTableConfigs;
+
 /**
  * Structure to define the key search value for the ObjectFinder map.
  */
@@ -105,12 +107,23 @@ struct TabletWithLocator {
     /// NORMAL, it is simply set to 0.
     const uint64_t nextFetchTime;
 
+    /// If the tablet is RECOVERING, the service locator of the recovery
+    /// master that is replaying it, if the coordinator has assigned one
+    /// (empty otherwise). Degraded reads are sent there.
+    string recoveryLocator;
+
+    /// Session corresponding to recoveryLocator, or NULL if it hasn't
+    /// been fetched yet.
+    Transport::SessionRef recoverySession;
+
     TabletWithLocator(Tablet tablet, string serviceLocator)
         : tablet(tablet)
         , serviceLocator(serviceLocator)
         , session(NULL)
         , nextFetchTime(tablet.status == Tablet::Status::RECOVERING ?
                         Cycles::rdtsc() + Cycles::fromMicroseconds(10000) : 0)
+        , recoveryLocator()
+        , recoverySession(NULL)
     {}
 };
 
@@ -144,6 +157,7 @@ class ObjectFinder {
     TabletWithLocator* lookupTablet(uint64_t tableId, KeyHash keyHash);
 
     void reset();
+    void shareTableConfigs(SharedTableConfigs* shared);
 
     Transport::SessionRef tryLookup(uint64_t tableId, const void* key,
                                     KeyLength keyLength);
@@ -151,6 +165,8 @@ class ObjectFinder {
     Transport::SessionRef tryLookup(uint64_t tableId, uint8_t indexId,
                                     const void* key, KeyLength keyLength,
                                     bool* indexDoesntExist);
+    Transport::SessionRef tryLookupDegraded(uint64_t tableId,
+                                            KeyHash keyHash);
 
     void waitForTabletDown(uint64_t tableId);
     void waitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs = ~0lu);
@@ -53,6 +53,7 @@ struct Refresher : public ObjectFinder::TableConfigFetcher {
 
         if (called < 2) {
             tablet2.tablet.status = Tablet::RECOVERING;
+            tablet2.recoveryLocator = "mock:host=recovery1";
         }
 
         TabletKey key2 {tablet2.tablet.tableId,
@@ -311,6 +312,26 @@ TEST_F(ObjectFinderTest, tryLookup_index_success) {
             1, 1, "abc", 3, &indexDoesntExist));
 }
 
+TEST_F(ObjectFinderTest, tryLookupDegraded) {
+    // While the tablet is recovering, reads go to the recovery master.
+    Transport::SessionRef session = objectFinder->tryLookupDegraded(1, 9999lu);
+    ASSERT_TRUE(session != NULL);
+    EXPECT_EQ("mock:host=recovery1", session->serviceLocator);
+
+    // Once it has been recovered, they go to its new owner.
+    objectFinder->flush(1);
+    session = objectFinder->tryLookupDegraded(1, 9999lu);
+    ASSERT_TRUE(session != NULL);
+    EXPECT_EQ("mock:host=server1", session->serviceLocator);
+
+    // Tablets without a recovery master can't be read.
+    refresher->called = 0;
+    objectFinder->flush(1);
+    objectFinder->tryLookupTablet(1, 9999lu);
+    objectFinder->tableMap.begin()->second.recoveryLocator = "";
+    EXPECT_TRUE(objectFinder->tryLookupDegraded(1, 9999lu) == NULL);
+}
+
 TEST_F(ObjectFinderTest, tryLookupIndexlet) {
     char a = 'a';
     char b = 'b';
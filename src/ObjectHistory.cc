@@ -0,0 +1,406 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ObjectHistory.h"
+
+namespace RAMCloud {
+
+/**
+ * Constructor for ObjectHistory.
+ *
+ * \param log
+ *      Log containing the objects whose prior versions are retained.
+ * \param clock
+ *      The master's cluster clock, used to stamp writes. NULL disables
+ *      the history.
+ * \param windowMs
+ *      Prior versions are retained for this many milliseconds after they
+ *      are superseded. 0 disables the history.
+ * \param maxVersions
+ *      At most this many prior versions are retained at once, regardless of
+ *      #windowMs. 0 disables the history.
+ */
+ObjectHistory::ObjectHistory(AbstractLog* log, ClusterClock* clock,
+                             uint32_t windowMs, uint32_t maxVersions)
+    : log(log)
+    , clock(clock)
+    , enabled(clock != NULL && windowMs != 0 && maxVersions != 0)
+    , windowMs(windowMs)
+    , windowCycles(Cycles::fromNanoseconds(windowMs * 1000000UL))
+    , maxVersions(maxVersions)
+    , shards()
+    , versionCount(0)
+{
+}
+
+/**
+ * Destructor for ObjectHistory. Retained versions are not freed; the log
+ * is expected to go away along with the history.
+ */
+ObjectHistory::~ObjectHistory()
+{
+}
+
+/**
+ * Called instead of AbstractLog::free when the version of an object that the
+ * hash table refers to is replaced by a new version or a tombstone. The old
+ * version is retained until it falls out of the window, at which point it is
+ * freed in the log.
+ *
+ * \param key
+ *      Key of the object.
+ * \param oldReference
+ *      Log reference to the version being replaced.
+ * \param retainable
+ *      False means the old version can't be retained and is freed right away
+ *      (chunked objects, whose chunks are freed when they are replaced);
+ *      snapshots that would see it fail with STATUS_SNAPSHOT_TOO_OLD.
+ * \param stamp
+ *      Cluster time of the write replacing the old version. The default
+ *      means the current time of the master's clock. Otherwise the clock is
+ *      advanced to at least this time.
+ */
+void
+ObjectHistory::retire(Key& key, AbstractLog::Reference oldReference,
+                      bool retainable, ClusterTime stamp)
+{
+    if (!enabled) {
+        log->free(oldReference);
+        return;
+    }
+
+    Shard& shard = shardFor(key);
+    Lock lock(shard.mutex);
+    if (retainable) {
+        record(lock, shard, key, PRESENT, oldReference.toInteger(), stamp);
+    } else {
+        log->free(oldReference);
+        record(lock, shard, key, UNAVAILABLE, 0, stamp);
+    }
+}
+
+/**
+ * Record that an object which did not exist has been created, so that
+ * snapshots before the creation won't see it.
+ *
+ * \param key
+ *      Key of the new object.
+ * \param stamp
+ *      Cluster time of the write creating the object; see retire().
+ */
+void
+ObjectHistory::recordCreation(Key& key, ClusterTime stamp)
+{
+    if (!enabled)
+        return;
+
+    Shard& shard = shardFor(key);
+    Lock lock(shard.mutex);
+    record(lock, shard, key, NONEXISTENT, 0, stamp);
+}
+
+/**
+ * Find the version of an object that is visible in the snapshot at a given
+ * cluster time. The caller must hold the object's HashTableBucketLock for as
+ * long as it uses the version found.
+ *
+ * \param key
+ *      Key of the object.
+ * \param snapshotTime
+ *      Cluster time of the snapshot. Writes stamped before this time are
+ *      visible and all others aren't. The caller should have advanced the
+ *      master's clock to this time before locking the object.
+ * \param[out] reference
+ *      If PRIOR is returned, the log reference of the visible version.
+ * \return
+ *      See ObjectHistory::Result.
+ */
+ObjectHistory::Result
+ObjectHistory::find(Key& key, ClusterTime snapshotTime,
+                    AbstractLog::Reference* reference)
+{
+    if (!enabled)
+        return TOO_OLD;
+
+    Shard& shard = shardFor(key);
+    Lock lock(shard.mutex);
+    if (snapshotTime <= shard.horizon)
+        return TOO_OLD;
+
+    // The visible version is the one replaced by the earliest write at or
+    // after the snapshot time. If no such write is retained, no write since
+    // the snapshot time has happened, so the current version is visible.
+    Version* visible = NULL;
+    auto range = shard.index.equal_range(key.getHash());
+    for (auto it = range.first; it != range.second; ++it) {
+        Version* version = it->second;
+        ClusterTime supersededAt(version->supersededAt);
+        if (!version->matches(key) || supersededAt < snapshotTime)
+            continue;
+        if (visible == NULL ||
+                supersededAt < ClusterTime(visible->supersededAt) ||
+                (supersededAt == ClusterTime(visible->supersededAt) &&
+                 version->sequence < visible->sequence)) {
+            visible = version;
+        }
+    }
+
+    if (visible == NULL)
+        return CURRENT;
+    switch (visible->state) {
+        case PRESENT:
+            *reference = AbstractLog::Reference(visible->reference);
+            return PRIOR;
+        case NONEXISTENT:
+            return ABSENT;
+        default:
+            return TOO_OLD;
+    }
+}
+
+/**
+ * Returns true if the given log entry is a prior version of an object that
+ * is being retained. Used by the cleaner to decide whether an object that the
+ * hash table no longer refers to must be relocated.
+ *
+ * \param key
+ *      Key of the object.
+ * \param reference
+ *      Log reference of the entry.
+ */
+bool
+ObjectHistory::isRetained(Key& key, AbstractLog::Reference reference)
+{
+    if (!enabled)
+        return false;
+
+    Shard& shard = shardFor(key);
+    Lock lock(shard.mutex);
+    return lookup(lock, shard, key, reference.toInteger()) != NULL;
+}
+
+/**
+ * Update the log reference of a retained version after the cleaner has
+ * relocated it.
+ *
+ * \param key
+ *      Key of the object.
+ * \param oldReference
+ *      Log reference of the version before it was relocated.
+ * \param newReference
+ *      Log reference of the relocated version.
+ * \return
+ *      False if the version has been discarded in the meantime (so that the
+ *      relocated copy is dead), true otherwise.
+ */
+bool
+ObjectHistory::updateReference(Key& key, AbstractLog::Reference oldReference,
+                               AbstractLog::Reference newReference)
+{
+    if (!enabled)
+        return false;
+
+    Shard& shard = shardFor(key);
+    Lock lock(shard.mutex);
+    Version* version = lookup(lock, shard, key, oldReference.toInteger());
+    if (version == NULL)
+        return false;
+    version->reference = newReference.toInteger();
+    return true;
+}
+
+/**
+ * Discard every retained version. This must be called whenever objects
+ * enter or leave the hash table other than through retire(), e.g. when a
+ * tablet is recovered, migrated or dropped, since the history would no
+ * longer describe them.
+ *
+ * The stamps of writes made on other masters are unknown, so snapshots
+ * before the end of one window from now are refused.
+ */
+void
+ObjectHistory::forget()
+{
+    if (!enabled)
+        return;
+
+    ClusterTime limit = clock->getTime() +
+            ClusterTimeDuration::fromNanoseconds(windowMs * 1000000L);
+    foreach (Shard& shard, shards) {
+        Lock lock(shard.mutex);
+        foreach (Version& version, shard.versions) {
+            if (version.state == PRESENT)
+                log->free(AbstractLog::Reference(version.reference));
+        }
+        versionCount -= shard.versions.size();
+        shard.versions.clear();
+        shard.index.clear();
+        if (shard.horizon < limit)
+            shard.horizon = limit;
+    }
+}
+
+/**
+ * Discard every retained version because the log is short of memory, so
+ * that the cleaner can reclaim the space they occupy. Unlike forget(), the
+ * history still describes the objects in the hash table: only snapshots at
+ * or before the newest discarded write are refused from now on.
+ */
+void
+ObjectHistory::shed()
+{
+    if (!enabled)
+        return;
+
+    size_t discarded = 0;
+    foreach (Shard& shard, shards) {
+        Lock lock(shard.mutex);
+        discarded += shard.versions.size();
+        while (!shard.versions.empty())
+            discardOldest(lock, shard);
+    }
+    if (discarded > 0) {
+        RAMCLOUD_CLOG(NOTICE, "Log is short of memory; discarded %lu prior "
+                "versions retained for snapshot reads", discarded);
+    }
+}
+
+/**
+ * Return the number of prior versions currently retained.
+ */
+size_t
+ObjectHistory::size()
+{
+    return versionCount;
+}
+
+/**
+ * Append a version to the history and discard the versions that have
+ * fallen out of the window.
+ *
+ * \param lock
+ *      Ensures that the caller holds the lock of \a shard.
+ * \param shard
+ *      The shard that \a key maps to.
+ * \param key
+ *      Key of the object being written.
+ * \param state
+ *      State of the object before the write.
+ * \param reference
+ *      Log reference of the prior version, if \a state is PRESENT.
+ * \param stamp
+ *      Cluster time of the write; see retire().
+ */
+void
+ObjectHistory::record(Lock& lock, Shard& shard, Key& key, State state,
+                      uint64_t reference, ClusterTime stamp)
+{
+    if (stamp == ClusterTime())
+        stamp = clock->getTime();
+    else
+        clock->updateClock(stamp);
+
+    shard.versions.emplace_back(shard.nextSequence++, key, state, reference,
+                                stamp);
+    shard.index.insert(std::make_pair(key.getHash(),
+                                      &shard.versions.back()));
+    versionCount++;
+    trim(lock, shard);
+}
+
+/**
+ * Discard the oldest versions in a shard until every remaining one is
+ * within the window, and until there are no more than #maxVersions in all
+ * (or the shard is empty). The shards aren't locked together, so once the
+ * history is full the versions discarded are the oldest ones of the shard
+ * being written, not necessarily the oldest overall.
+ *
+ * \param lock
+ *      Ensures that the caller holds the lock of \a shard.
+ * \param shard
+ *      The shard to trim.
+ */
+void
+ObjectHistory::trim(Lock& lock, Shard& shard)
+{
+    uint64_t now = Cycles::rdtsc();
+    while (!shard.versions.empty()) {
+        Version* oldest = &shard.versions.front();
+        if (versionCount <= maxVersions &&
+                now - oldest->retiredCycles <= windowCycles) {
+            break;
+        }
+        discardOldest(lock, shard);
+    }
+}
+
+/**
+ * Free the oldest retained version in a shard and advance the shard's
+ * horizon past it.
+ *
+ * \param lock
+ *      Ensures that the caller holds the lock of \a shard.
+ * \param shard
+ *      The shard to discard from; must not be empty.
+ */
+void
+ObjectHistory::discardOldest(Lock& lock, Shard& shard)
+{
+    Version* oldest = &shard.versions.front();
+    if (oldest->state == PRESENT)
+        log->free(AbstractLog::Reference(oldest->reference));
+    ClusterTime supersededAt(oldest->supersededAt);
+    if (shard.horizon < supersededAt)
+        shard.horizon = supersededAt;
+
+    auto range = shard.index.equal_range(oldest->keyHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == oldest) {
+            shard.index.erase(it);
+            break;
+        }
+    }
+    shard.versions.pop_front();
+    versionCount--;
+}
+
+/**
+ * Find the retained version of an object at a given log reference.
+ *
+ * \param lock
+ *      Ensures that the caller holds the lock of \a shard.
+ * \param shard
+ *      The shard that \a key maps to.
+ * \param key
+ *      Key of the object.
+ * \param reference
+ *      Log reference of the version.
+ * \return
+ *      The version, or NULL if it isn't retained.
+ */
+ObjectHistory::Version*
+ObjectHistory::lookup(Lock& lock, Shard& shard, Key& key, uint64_t reference)
+{
+    auto range = shard.index.equal_range(key.getHash());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->state == PRESENT &&
+                it->second->reference == reference) {
+            return it->second;
+        }
+    }
+    return NULL;
+}
+
+} // namespace RAMCloud
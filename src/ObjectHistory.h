@@ -0,0 +1,226 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_OBJECTHISTORY_H
+#define RAMCLOUD_OBJECTHISTORY_H
+
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+#include "Common.h"
+#include "AbstractLog.h"
+#include "ClusterClock.h"
+#include "Cycles.h"
+#include "Key.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * An ObjectHistory keeps a bounded window of the versions of objects that
+ * have been overwritten or removed, so that a master can answer reads "as of"
+ * a cluster time in the recent past (see ObjectManager::readSnapshot). This
+ * lets read-only transactions read a consistent snapshot without locking or
+ * validating anything.
+ *
+ * Whenever the ObjectManager replaces the version of an object that the hash
+ * table refers to, it hands the old version to retire() rather than freeing it
+ * in the log. The old version stays live in the log (the cleaner relocates it
+ * if isRetained() says so) and is stamped with the cluster time of the write
+ * that superseded it. Versions are kept in the order they were retired (in a
+ * side index keyed by key hash, rather than chained from the hash table
+ * entries, so the hash table's format is unchanged) and are freed, oldest
+ * first, once they have been retained longer than the window or when there
+ * are more of them than the configured maximum. The latest cluster time
+ * stamped on any discarded version is remembered as a horizon: snapshots at
+ * or before it can no longer be served. Retained
+ * versions take up log space, so when the log runs out of memory they are
+ * all discarded (see shed()) rather than making writes wait for them.
+ *
+ * A version of an object is visible at cluster time T iff the write that
+ * created it was stamped before T. The stamps come from the master's
+ * ClusterClock, which every snapshot read advances to its snapshot time, so a
+ * write that happens after a snapshot read on the same master is never
+ * visible to that snapshot. Transactions stamp all of their writes with the
+ * same commit time on every participant (see MasterService::txDecision).
+ *
+ * This class is thread-safe. The versions are split by key hash into
+ * shards, each with its own lock, so that writes to different objects
+ * rarely contend. Callers are expected to hold the HashTableBucketLock of
+ * the object involved, which keeps retire() and the cleaner's relocation
+ * of the same object in order.
+ */
+class ObjectHistory {
+  PUBLIC:
+    /// Outcome of find().
+    enum Result {
+        /// The version in the hash table (if any) is the one visible.
+        CURRENT,
+        /// A retained prior version is visible; its reference is returned.
+        PRIOR,
+        /// The object did not exist at the requested time.
+        ABSENT,
+        /// The visible version is no longer retained.
+        TOO_OLD
+    };
+
+    ObjectHistory(AbstractLog* log, ClusterClock* clock, uint32_t windowMs,
+                  uint32_t maxVersions);
+    ~ObjectHistory();
+
+    bool isEnabled() const { return enabled; }
+    void retire(Key& key, AbstractLog::Reference oldReference, bool retainable,
+                ClusterTime stamp = ClusterTime());
+    void recordCreation(Key& key, ClusterTime stamp = ClusterTime());
+    Result find(Key& key, ClusterTime snapshotTime,
+                AbstractLog::Reference* reference);
+    bool isRetained(Key& key, AbstractLog::Reference reference);
+    bool updateReference(Key& key, AbstractLog::Reference oldReference,
+                         AbstractLog::Reference newReference);
+    void forget();
+    void shed();
+    size_t size();
+
+  PRIVATE:
+    /// What a Version records about the object's state before a write.
+    enum State {
+        /// The prior version is in the log at #Version::reference.
+        PRESENT,
+        /// The object did not exist.
+        NONEXISTENT,
+        /// The prior version existed but was not retained (e.g. a chunked
+        /// object, whose chunks are freed as soon as it is replaced).
+        UNAVAILABLE
+    };
+
+    /**
+     * Describes one write to an object: the version it replaced and the
+     * cluster time at which the replacement happened.
+     */
+    struct Version {
+        Version(uint64_t sequence, Key& key, State state,
+                uint64_t reference, ClusterTime supersededAt)
+            : sequence(sequence)
+            , tableId(key.getTableId())
+            , keyHash(key.getHash())
+            , key(static_cast<const char*>(key.getStringKey()),
+                  key.getStringKeyLength())
+            , state(state)
+            , reference(reference)
+            , supersededAt(supersededAt.getEncoded())
+            , retiredCycles(Cycles::rdtsc())
+        {}
+
+        bool matches(Key& other) const {
+            return tableId == other.getTableId() &&
+                   key.size() == other.getStringKeyLength() &&
+                   memcmp(key.data(), other.getStringKey(), key.size()) == 0;
+        }
+
+        /// Order in which versions were retired; breaks ties between
+        /// versions superseded at the same cluster time.
+        uint64_t sequence;
+        uint64_t tableId;
+        KeyHash keyHash;
+        string key;
+        State state;
+        /// Log reference of the prior version if #state is PRESENT.
+        uint64_t reference;
+        /// Encoded cluster time of the write that replaced this version.
+        uint64_t supersededAt;
+        /// Cycles::rdtsc() when this version was retired; used to enforce
+        /// #windowCycles.
+        uint64_t retiredCycles;
+    };
+
+    /**
+     * The versions of the objects whose key hashes map to one shard (see
+     * #shardFor), and the lock that protects them.
+     */
+    struct Shard {
+        Shard()
+            : mutex("ObjectHistory::mutex")
+            , versions()
+            , index()
+            , nextSequence(0)
+            , horizon()
+        {}
+
+        /// Protects everything below.
+        SpinLock mutex;
+
+        /// Versions in the order they were retired (oldest first).
+        std::deque<Version> versions;
+
+        /// Indexes #versions by key hash. Pointers into a deque remain
+        /// valid while elements are added and removed at its ends.
+        std::unordered_multimap<KeyHash, Version*> index;
+
+        /// Sequence number for the next retired version.
+        uint64_t nextSequence;
+
+        /// Snapshots of objects in this shard at or before this cluster
+        /// time can't be served, because versions superseded by then may
+        /// have been discarded.
+        ClusterTime horizon;
+
+        DISALLOW_COPY_AND_ASSIGN(Shard);
+    };
+
+    typedef std::lock_guard<SpinLock> Lock;
+
+    /// Number of entries in #shards.
+    static const uint32_t NUM_SHARDS = 16;
+
+    Shard& shardFor(Key& key) { return shards[key.getHash() % NUM_SHARDS]; }
+    void record(Lock& lock, Shard& shard, Key& key, State state,
+                uint64_t reference, ClusterTime stamp);
+    void trim(Lock& lock, Shard& shard);
+    void discardOldest(Lock& lock, Shard& shard);
+    Version* lookup(Lock& lock, Shard& shard, Key& key, uint64_t reference);
+
+    /// Log the retained versions live in. Versions are freed here once
+    /// they fall out of the window.
+    AbstractLog* log;
+
+    /// Clock used to stamp writes that don't carry their own cluster time.
+    ClusterClock* clock;
+
+    /// False means nothing is retained: retire() frees old versions right
+    /// away, and find() always returns TOO_OLD.
+    const bool enabled;
+
+    /// How long versions are retained, in milliseconds.
+    const uint32_t windowMs;
+
+    /// #windowMs, in Cycles.
+    const uint64_t windowCycles;
+
+    /// The largest number of versions retained at once (in all shards).
+    const size_t maxVersions;
+
+    /// The retained versions, split by key hash.
+    Shard shards[NUM_SHARDS];
+
+    /// Total number of versions retained in #shards.
+    std::atomic<size_t> versionCount;
+
+    DISALLOW_COPY_AND_ASSIGN(ObjectHistory);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_OBJECTHISTORY_H
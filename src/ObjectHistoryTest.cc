@@ -0,0 +1,314 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MasterTableMetadata.h"
+#include "ObjectHistory.h"
+#include "ObjectManager.h"
+#include "TabletManager.h"
+#include "TransactionManager.h"
+#include "TxRecoveryManager.h"
+#include "UnackedRpcResults.h"
+
+namespace RAMCloud {
+
+class ObjectHistoryTest : public ::testing::Test,
+                          public AbstractLog::ReferenceFreer {
+  public:
+    Context context;
+    ClusterClock clusterClock;
+    ClientLeaseValidator clientLeaseValidator;
+    ServerId serverId;
+    ServerList serverList;
+    ServerConfig masterConfig;
+    MasterTableMetadata masterTableMetadata;
+    ObjectManager objectManager;
+    UnackedRpcResults unackedRpcResults;
+    TransactionManager transactionManager;
+    TxRecoveryManager txRecoveryManager;
+    TabletManager tabletManager;
+    ObjectHistory* history;
+
+    ObjectHistoryTest()
+        : context()
+        , clusterClock()
+        , clientLeaseValidator(&context, &clusterClock)
+        , serverId(5)
+        , serverList(&context)
+        , masterConfig(configForTesting())
+        , masterTableMetadata()
+        , objectManager(&context,
+                        &serverId,
+                        &masterConfig,
+                        &tabletManager,
+                        &masterTableMetadata,
+                        &unackedRpcResults,
+                        &transactionManager,
+                        &txRecoveryManager,
+                        &clusterClock)
+        , unackedRpcResults(&context,
+                            this,
+                            &clientLeaseValidator,
+                            &tabletManager)
+        , transactionManager(&context,
+                             objectManager.getLog(),
+                             &unackedRpcResults,
+                             &tabletManager)
+        , txRecoveryManager(&context)
+        , tabletManager()
+        , history(&objectManager.history)
+    {
+        objectManager.initOnceEnlisted();
+        tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+        clusterClock.updateClock(ClusterTime(100));
+    }
+
+    static ServerConfig
+    configForTesting()
+    {
+        ServerConfig config = ServerConfig::forTesting();
+        config.master.snapshotWindowMs = 1000;
+        config.master.maxSnapshotVersions = 3;
+        return config;
+    }
+
+    void
+    freeLogEntry(Log::Reference ref)
+    {
+        objectManager.getLog()->free(ref);
+    }
+
+    /**
+     * Write an object at the given cluster time, returning its version.
+     */
+    uint64_t
+    write(Key& key, string value, uint64_t time)
+    {
+        clusterClock.updateClock(ClusterTime(time));
+        Buffer dataBuffer;
+        Object object(key, value.c_str(), downCast<uint32_t>(value.size()),
+                      0, 0, dataBuffer);
+        uint64_t version = 0;
+        EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL,
+                                                       &version));
+        return version;
+    }
+
+    /**
+     * Read an object in the snapshot at the given cluster time, returning
+     * a description of the outcome. Like MasterService::readSnapshot, this
+     * advances the clock to the snapshot time first.
+     */
+    string
+    readAt(Key& key, uint64_t time)
+    {
+        clusterClock.updateClock(ClusterTime(time));
+        Buffer buffer;
+        uint64_t version = 0;
+        Status status = objectManager.readSnapshot(key, ClusterTime(time),
+                                                   &buffer, &version);
+        if (status != STATUS_OK)
+            return statusToSymbol(status);
+        return format("version %lu", version);
+    }
+
+    /**
+     * Return the reference the hash table holds for the given key.
+     */
+    Log::Reference
+    currentReference(Key& key)
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        LogEntryType type;
+        Buffer buffer;
+        Log::Reference reference;
+        EXPECT_TRUE(objectManager.lookup(lock, key, type, buffer, NULL,
+                                         &reference));
+        return reference;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ObjectHistoryTest);
+};
+
+TEST_F(ObjectHistoryTest, constructor_disabled) {
+    EXPECT_TRUE(history->isEnabled());
+    ObjectHistory noClock(objectManager.getLog(), NULL, 1000, 3);
+    EXPECT_FALSE(noClock.isEnabled());
+    ObjectHistory noWindow(objectManager.getLog(), &clusterClock, 0, 3);
+    EXPECT_FALSE(noWindow.isEnabled());
+    ObjectHistory noVersions(objectManager.getLog(), &clusterClock, 1000, 0);
+    EXPECT_FALSE(noVersions.isEnabled());
+
+    Key key(1, "a", 1);
+    Log::Reference reference;
+    EXPECT_EQ(ObjectHistory::TOO_OLD,
+              noClock.find(key, ClusterTime(200), &reference));
+    noClock.recordCreation(key);
+    EXPECT_EQ(0u, noClock.size());
+}
+
+TEST_F(ObjectHistoryTest, find) {
+    Key key(1, "a", 1);
+    uint64_t v1 = write(key, "one", 110);
+    uint64_t v2 = write(key, "two", 120);
+    uint64_t v3 = write(key, "three", 130);
+    EXPECT_EQ(3u, history->size());
+
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", readAt(key, 105));
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", readAt(key, 110));
+    EXPECT_EQ(format("version %lu", v1), readAt(key, 111));
+    EXPECT_EQ(format("version %lu", v1), readAt(key, 120));
+    EXPECT_EQ(format("version %lu", v2), readAt(key, 121));
+    EXPECT_EQ(format("version %lu", v3), readAt(key, 131));
+
+    // Reads advance the clock, so later writes are never visible to them.
+    uint64_t v4 = write(key, "four", 0);
+    EXPECT_EQ(format("version %lu", v3), readAt(key, 131));
+    EXPECT_EQ(format("version %lu", v4), readAt(key, 132));
+
+    // Other keys with other histories don't interfere.
+    Key other(1, "b", 1);
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", readAt(other, 132));
+}
+
+TEST_F(ObjectHistoryTest, find_sameStamp) {
+    Key key(1, "a", 1);
+    uint64_t v1 = write(key, "one", 110);
+    write(key, "two", 120);
+    uint64_t v3 = write(key, "three", 120);
+    // Neither write stamped 120 is visible at 120.
+    EXPECT_EQ(format("version %lu", v1), readAt(key, 120));
+    EXPECT_EQ(format("version %lu", v3), readAt(key, 121));
+}
+
+TEST_F(ObjectHistoryTest, find_removed) {
+    Key key(1, "a", 1);
+    uint64_t v1 = write(key, "one", 110);
+    clusterClock.updateClock(ClusterTime(120));
+    EXPECT_EQ(STATUS_OK, objectManager.removeObject(key, NULL, NULL));
+    EXPECT_EQ(format("version %lu", v1), readAt(key, 115));
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", readAt(key, 121));
+}
+
+TEST_F(ObjectHistoryTest, find_unavailable) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    {
+        ObjectHistory::Shard& shard = history->shardFor(key);
+        ObjectHistory::Lock lock(shard.mutex);
+        history->record(lock, shard, key, ObjectHistory::UNAVAILABLE, 0,
+                        ClusterTime(120));
+    }
+    EXPECT_EQ("STATUS_SNAPSHOT_TOO_OLD", readAt(key, 115));
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", readAt(key, 105));
+}
+
+TEST_F(ObjectHistoryTest, isRetained_and_updateReference) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    Log::Reference first = currentReference(key);
+    EXPECT_FALSE(history->isRetained(key, first));
+    write(key, "two", 120);
+    EXPECT_TRUE(history->isRetained(key, first));
+
+    Log::Reference second = currentReference(key);
+    EXPECT_TRUE(history->updateReference(key, first, second));
+    EXPECT_FALSE(history->isRetained(key, first));
+    EXPECT_TRUE(history->isRetained(key, second));
+    EXPECT_FALSE(history->updateReference(key, first, second));
+
+    Key other(1, "b", 1);
+    EXPECT_FALSE(history->isRetained(other, second));
+}
+
+TEST_F(ObjectHistoryTest, trim_maxVersions) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    write(key, "two", 120);
+    write(key, "three", 130);
+    uint64_t v4 = write(key, "four", 140);
+    write(key, "five", 150);
+    EXPECT_EQ(3u, history->size());
+    EXPECT_EQ(ClusterTime(120), history->shardFor(key).horizon);
+
+    EXPECT_EQ("STATUS_SNAPSHOT_TOO_OLD", readAt(key, 115));
+    EXPECT_EQ("STATUS_SNAPSHOT_TOO_OLD", readAt(key, 120));
+    EXPECT_EQ(format("version %lu", v4), readAt(key, 145));
+}
+
+TEST_F(ObjectHistoryTest, trim_maxVersionsAcrossShards) {
+    // Find two keys in different shards.
+    Key key(1, "a", 1);
+    char otherString[] = "b";
+    for (;; otherString[0]++) {
+        Key candidate(1, otherString, 1);
+        if (&history->shardFor(candidate) != &history->shardFor(key))
+            break;
+    }
+    Key other(1, otherString, 1);
+
+    write(key, "one", 110);
+    write(key, "two", 120);
+    write(other, "one", 130);
+    write(other, "two", 140);
+    EXPECT_EQ(3u, history->size());
+
+    // The limit applies to the whole history, but the versions discarded
+    // are the oldest ones of the shard being written.
+    EXPECT_EQ(2u, history->shardFor(key).versions.size());
+    EXPECT_EQ(1u, history->shardFor(other).versions.size());
+    EXPECT_EQ(ClusterTime(130), history->shardFor(other).horizon);
+    EXPECT_EQ(ClusterTime(), history->shardFor(key).horizon);
+}
+
+TEST_F(ObjectHistoryTest, trim_window) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    write(key, "two", 120);
+    history->shardFor(key).versions.front().retiredCycles = 0;
+    write(key, "three", 130);
+    EXPECT_EQ(2u, history->size());
+    EXPECT_EQ(ClusterTime(110), history->shardFor(key).horizon);
+}
+
+TEST_F(ObjectHistoryTest, forget) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    write(key, "two", 120);
+    history->forget();
+    EXPECT_EQ(0u, history->size());
+    EXPECT_EQ(0u, history->shardFor(key).index.size());
+    EXPECT_EQ(ClusterTime(120) + ClusterTimeDuration::fromNanoseconds(
+                      1000 * 1000000L),
+              history->shardFor(key).horizon);
+    EXPECT_EQ("STATUS_SNAPSHOT_TOO_OLD", readAt(key, 121));
+}
+
+TEST_F(ObjectHistoryTest, shed) {
+    Key key(1, "a", 1);
+    write(key, "one", 110);
+    write(key, "two", 120);
+    uint64_t v3 = write(key, "three", 130);
+    history->shed();
+    EXPECT_EQ(0u, history->size());
+    EXPECT_EQ(0u, history->shardFor(key).index.size());
+    EXPECT_EQ(ClusterTime(130), history->shardFor(key).horizon);
+    EXPECT_EQ("STATUS_SNAPSHOT_TOO_OLD", readAt(key, 125));
+
+    // Later snapshots are still served from the current version.
+    EXPECT_EQ(format("version %lu", v3), readAt(key, 135));
+}
+
+}  // namespace RAMCloud
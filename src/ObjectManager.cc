@@ -21,6 +21,7 @@
 #include "IndexletManager.h"
 #include "LogEntryRelocator.h"
 #include "ObjectManager.h"
+#include "ObjectChunk.h"
 #include "Object.h"
 #include "PerfStats.h"
 #include "ShortMacros.h"
@@ -36,6 +37,10 @@
 
 namespace RAMCloud {
 
+#ifdef TESTING
+bool ObjectManager::mockWriteAppendFailure = false;
+#endif
+
 /**
  * Construct an ObjectManager.
  *
@@ -67,6 +72,10 @@ namespace RAMCloud {
  *      Pointer to the master's TxRecoveryManager instance.  This keeps track
  *      of ongoing transaction recoveries; these recoveries may need records
  *      stored in the log.
+ * \param clusterClock
+ *      Pointer to the master's ClusterClock, used to stamp writes so that
+ *      snapshot reads can be served (see readSnapshot). NULL disables
+ *      snapshot reads.
  */
 ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 const ServerConfig* config,
@@ -74,7 +83,8 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager)
+                TxRecoveryManager* txRecoveryManager,
+                ClusterClock* clusterClock)
     : context(context)
     , config(config)
     , tabletManager(tabletManager)
@@ -95,7 +105,10 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
             config->master.useHugepages)
     , anyWrites(false)
     , hashTableBucketLocks()
-    , lockTable(1000, log)
+    , lockTable(1000, log, config->master.txLockWaitUs,
+                config->master.txLockMaxWaiters)
+    , history(&log, clusterClock, config->master.snapshotWindowMs,
+              config->master.maxSnapshotVersions)
     , mutex("ObjectManager::mutex")
     , tombstoneRemover(this, &objectMap)
     , tombstoneProtectorCount(0)
@@ -123,6 +136,13 @@ ObjectManager::~ObjectManager()
  * Linearizable RPC handler should pass "this" objectManager to the constructor
  * of UnackedRpcResults.
  *
+ * RpcResults stored in the same entry as an object are not freed here: the
+ * entry is freed along with the object when it is overwritten or removed,
+ * since the log expects each entry to be freed exactly once. (Until the
+ * object goes away the entry really is live; if the object goes first, the
+ * entry is counted as dead slightly early, which only affects the cleaner's
+ * choice of segments.)
+ *
  * \param ref
  *      Log reference for log entry to be freed.
  */
@@ -130,6 +150,9 @@ void
 ObjectManager::freeLogEntry(Log::Reference ref)
 {
     assert(ref.toInteger());
+    Buffer buffer;
+    if (log.getRawEntry(ref, buffer) == LOG_ENTRY_TYPE_OBJRPCRESULT)
+        return;
     log.free(ref);
 }
 
@@ -232,26 +255,43 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
             Log::Reference candidateRef(candidates.getReference());
             LogEntryType type = log.getEntry(candidateRef, candidateBuffer);
 
-            if (type != LOG_ENTRY_TYPE_OBJ)
+            if (type != LOG_ENTRY_TYPE_OBJ &&
+                    type != LOG_ENTRY_TYPE_OBJMANIFEST)
                 continue;
 
             Object object(candidateBuffer);
 
             // Candidate may have only partially matching primary key hash.
             if (object.getPKHash() == pKHash) {
-                *numObjects += 1;
+                uint32_t keysLength = object.getKeysAndValueLength() -
+                        object.getValueLength();
+                uint32_t startLength = response->size();
                 response->emplaceAppend<uint64_t>(object.getVersion());
-                response->emplaceAppend<uint32_t>(
+                uint32_t* keysAndValueLength =
+                        response->emplaceAppend<uint32_t>(
                         object.getKeysAndValueLength());
                 object.appendKeysAndValueToBuffer(*response);
 
+                if (type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+                    Key key(type, candidateBuffer);
+                    response->truncate(response->size() -
+                            object.getValueLength());
+                    if (!appendChunkedValue(log, objectMap, key, object,
+                            response)) {
+                        response->truncate(startLength);
+                        continue;
+                    }
+                    *keysAndValueLength = response->size() - startLength -
+                            sizeof32(uint64_t) - sizeof32(uint32_t);
+                }
+
+                *numObjects += 1;
                 tabletManager->incrementReadCount(object.getTableId(),
                         object.getPKHash());
                 ++PerfStats::threadStats.readCount;
-                uint32_t valueLength = object.getValueLength();
+                uint32_t valueLength = *keysAndValueLength - keysLength;
                 PerfStats::threadStats.readObjectBytes += valueLength;
-                PerfStats::threadStats.readKeyBytes +=
-                        object.getKeysAndValueLength() - valueLength;
+                PerfStats::threadStats.readKeyBytes += keysLength;
             }
         }
 
@@ -280,7 +320,8 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
     if (expect_false(it->isDone()))
         return;
 
-    if (expect_true(it->getType() == LOG_ENTRY_TYPE_OBJ)) {
+    if (expect_true(it->getType() == LOG_ENTRY_TYPE_OBJ) ||
+            it->getType() == LOG_ENTRY_TYPE_OBJRPCRESULT) {
         const Object::Header* obj =
             it->getContiguous<Object::Header>(NULL, 0);
 
@@ -316,21 +357,31 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
  * \param valueOnly
  *      If true, then only the value portion of the object is written to
  *      outBuffer. Otherwise, keys and value are written to outBuffer.
+ * \param[out] degraded
+ *      If non-NULL, the caller will accept a degraded read: if this master
+ *      is still recovering the object's tablet (it is NOT_READY), the
+ *      object is read from the data replayed so far, and true is returned
+ *      here. Since segments are replayed in no particular order, the
+ *      version returned may not be the latest one.
  * \return
  *      Returns STATUS_OK if the lookup succeeded and the reject rules did not
  *      preclude this read. Other status values indicate different failures
  *      (object not found, tablet doesn't exist, reject rules applied, etc).
+ *
+ * \throw RetryException
+ *      A degraded read found no object, but one may yet be replayed.
  */
 Status
 ObjectManager::readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
-                bool valueOnly)
+                bool valueOnly, bool* degraded)
 {
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
-    // If the tablet doesn't exist in the NORMAL state, we must plead ignorance.
-    if (!tabletManager->checkAndIncrementReadCount(key))
+    // If the tablet doesn't exist in the NORMAL state, we must plead ignorance
+    // (unless the caller will take whatever has been recovered so far).
+    if (!tabletManager->checkAndIncrementReadCount(key, degraded))
         return STATUS_UNKNOWN_TABLET;
 
     Buffer buffer;
@@ -338,8 +389,16 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     uint64_t version;
     Log::Reference reference;
     bool found = lookup(lock, key, type, buffer, &version, &reference);
-    if (!found || type != LOG_ENTRY_TYPE_OBJ)
+    if (!found || (type != LOG_ENTRY_TYPE_OBJ &&
+                   type != LOG_ENTRY_TYPE_OBJMANIFEST)) {
+        // A missing object (or a tombstone) means nothing during recovery:
+        // a newer version could still be replayed. The client must wait.
+        if (degraded != NULL && *degraded) {
+            throw RetryException(HERE, 1000, 2000,
+                    "Object's tablet is still being recovered");
+        }
         return STATUS_OBJECT_DOESNT_EXIST;
+    }
 
     if (outVersion != NULL)
         *outVersion = version;
@@ -350,24 +409,224 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
             return status;
     }
 
-    // Ensure the object being read is replicated durably.
-    log.syncTo(reference);
+    // Ensure the object being read is replicated durably. Objects replayed
+    // during recovery already are (they came from backups), and may still
+    // be in a side log.
+    if (degraded == NULL || !*degraded)
+        log.syncTo(reference);
 
     Object object(buffer);
-    if (valueOnly) {
+    uint32_t keysLength =
+            object.getKeysAndValueLength() - object.getValueLength();
+    uint32_t valueLength = object.getValueLength();
+    if (type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+        // Stream the chunks into outBuffer by reference in place of the
+        // manifest; the value is never copied or reassembled in memory.
+        uint32_t startLength = outBuffer->size();
+        if (!valueOnly) {
+            object.appendKeysAndValueToBuffer(*outBuffer);
+            outBuffer->truncate(outBuffer->size() - valueLength);
+        }
+        uint32_t valueStart = outBuffer->size();
+        if (!appendChunkedValue(log, objectMap, key, object, outBuffer)) {
+            outBuffer->truncate(startLength);
+            if (degraded != NULL && *degraded) {
+                // Some chunks haven't been replayed yet.
+                throw RetryException(HERE, 1000, 2000,
+                        "Object's tablet is still being recovered");
+            }
+            LOG(ERROR, "Chunked object is missing chunks; key: %s, "
+                "version %lu", key.toString().c_str(), version);
+            return STATUS_INTERNAL_ERROR;
+        }
+        valueLength = outBuffer->size() - valueStart;
+    } else if (valueOnly) {
         object.appendValueToBuffer(outBuffer);
     } else {
         object.appendKeysAndValueToBuffer(*outBuffer);
     }
     ++PerfStats::threadStats.readCount;
-    uint32_t valueLength = object.getValueLength();
     PerfStats::threadStats.readObjectBytes += valueLength;
-    PerfStats::threadStats.readKeyBytes +=
-            object.getKeysAndValueLength() - valueLength;
+    PerfStats::threadStats.readKeyBytes += keysLength;
 
     return STATUS_OK;
 }
 
+/**
+ * Read the version of an object that was current at a given cluster time,
+ * using the versions retained by #history. Reads at the same cluster time
+ * on any number of masters see a consistent snapshot, without locking
+ * anything.
+ *
+ * \param key
+ *      Key of the object being read.
+ * \param snapshotTime
+ *      Cluster time of the snapshot. The caller must have advanced the
+ *      master's ClusterClock to at least this time, so that writes which
+ *      happen after this read aren't visible at the same time.
+ * \param outBuffer
+ *      Buffer to populate with the keys and value of the object, if found.
+ * \param outVersion
+ *      If non-NULL and the object is found, its version is returned here.
+ * \return
+ *      STATUS_OK if the object existed at the snapshot time.
+ *      STATUS_OBJECT_DOESNT_EXIST if it did not, STATUS_SNAPSHOT_TOO_OLD if
+ *      the version visible at that time is no longer retained, and
+ *      STATUS_RETRY if a transaction that may yet change the object in the
+ *      snapshot is in progress. Other status values indicate different
+ *      failures (e.g. the tablet doesn't exist).
+ */
+Status
+ObjectManager::readSnapshot(Key& key, ClusterTime snapshotTime,
+                Buffer* outBuffer, uint64_t* outVersion)
+{
+    objectMap.prefetchBucket(key.getHash());
+    HashTableBucketLock lock(*this, key);
+
+    if (!tabletManager->checkAndIncrementReadCount(key, NULL))
+        return STATUS_UNKNOWN_TABLET;
+
+    // A prepared transaction may commit before the snapshot time, and so
+    // must be decided before the object can be read.
+    if (lockTable.isLockAcquired(key))
+        return STATUS_RETRY;
+
+    Buffer buffer;
+    LogEntryType type;
+    uint64_t version;
+    Log::Reference reference;
+    switch (history.find(key, snapshotTime, &reference)) {
+        case ObjectHistory::TOO_OLD:
+            return STATUS_SNAPSHOT_TOO_OLD;
+        case ObjectHistory::ABSENT:
+            return STATUS_OBJECT_DOESNT_EXIST;
+        case ObjectHistory::PRIOR:
+            type = log.getEntry(reference, buffer);
+            version = Object(buffer).getVersion();
+            break;
+        default:
+            if (!lookup(lock, key, type, buffer, &version, &reference) ||
+                    (type != LOG_ENTRY_TYPE_OBJ &&
+                     type != LOG_ENTRY_TYPE_OBJMANIFEST)) {
+                return STATUS_OBJECT_DOESNT_EXIST;
+            }
+            break;
+    }
+
+    if (outVersion != NULL)
+        *outVersion = version;
+    log.syncTo(reference);
+
+    Object object(buffer);
+    uint32_t valueLength = object.getValueLength();
+    if (type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+        uint32_t startLength = outBuffer->size();
+        object.appendKeysAndValueToBuffer(*outBuffer);
+        outBuffer->truncate(outBuffer->size() - valueLength);
+        uint32_t valueStart = outBuffer->size();
+        if (!appendChunkedValue(log, objectMap, key, object, outBuffer)) {
+            outBuffer->truncate(startLength);
+            LOG(ERROR, "Chunked object is missing chunks; key: %s, "
+                "version %lu", key.toString().c_str(), version);
+            return STATUS_INTERNAL_ERROR;
+        }
+        valueLength = outBuffer->size() - valueStart;
+    } else {
+        object.appendKeysAndValueToBuffer(*outBuffer);
+    }
+    ++PerfStats::threadStats.readCount;
+    PerfStats::threadStats.readObjectBytes += valueLength;
+    return STATUS_OK;
+}
+
+/**
+ * Discard all of the versions retained for snapshot reads. This must be
+ * called when objects enter the hash table other than by being written
+ * (e.g. when a recovered or migrated tablet is taken over), since their
+ * history is unknown.
+ */
+void
+ObjectManager::forgetHistory()
+{
+    history.forget();
+}
+
+/**
+ * Append the value of a chunked object to a buffer. The chunks are appended
+ * in order and by reference, so no copy of the value is ever made; the
+ * buffer simply points at the chunks in the log.
+ *
+ * The caller must ensure that the chunks cannot be freed while the buffer
+ * is in use, either by holding the object's HashTableBucketLock or by the
+ * same means used to keep any other log entry alive (e.g. the log's epoch
+ * mechanism for RPC responses).
+ *
+ * \param log
+ *      The log containing the manifest and its chunks.
+ * \param objectMap
+ *      The hash table referencing the chunks.
+ * \param key
+ *      Primary key of the chunked object.
+ * \param manifestObject
+ *      The object's manifest entry, as returned by lookup().
+ * \param[out] outBuffer
+ *      Buffer to append the value to.
+ * \return
+ *      True if every chunk named by the manifest was found and appended.
+ *      False otherwise, in which case nothing was appended.
+ */
+bool
+ObjectManager::appendChunkedValue(Log& log, HashTable& objectMap, Key& key,
+                Object& manifestObject, Buffer* outBuffer)
+{
+    Buffer manifestBuffer;
+    manifestObject.appendValueToBuffer(&manifestBuffer);
+    ObjectChunkManifest manifest(manifestBuffer);
+    uint32_t chunkCount = manifest.getChunkCount();
+    uint64_t version = manifestObject.getVersion();
+
+    // Chunks are indexed under the same key hash as their manifest, so a
+    // single pass over the candidates finds all of them.
+    std::vector<Log::Reference> chunks(chunkCount);
+    uint32_t chunksFound = 0;
+    HashTable::Candidates candidates;
+    objectMap.lookup(key.getHash(), candidates);
+    for (; !candidates.isDone(); candidates.next()) {
+        Buffer candidateBuffer;
+        Log::Reference candidateRef(candidates.getReference());
+        if (log.getEntry(candidateRef, candidateBuffer) !=
+                LOG_ENTRY_TYPE_OBJCHUNK)
+            continue;
+
+        ObjectChunk chunk(candidateBuffer);
+        uint32_t index = chunk.getChunkIndex();
+        if (chunk.getVersion() != version || index >= chunkCount ||
+                chunk.getChecksum() != manifest.getChunkChecksum(index) ||
+                chunks[index] != Log::Reference())
+            continue;
+
+        Key chunkKey(LOG_ENTRY_TYPE_OBJCHUNK, candidateBuffer);
+        if (key != chunkKey)
+            continue;
+
+        chunks[index] = candidateRef;
+        chunksFound++;
+    }
+
+    if (chunksFound != chunkCount)
+        return false;
+
+    foreach (Log::Reference chunkReference, chunks) {
+        Buffer chunkBuffer;
+        log.getEntry(chunkReference, chunkBuffer);
+        ObjectChunk chunk(chunkBuffer);
+        outBuffer->append(&chunkBuffer,
+                          chunk.getSerializedLength() - chunk.getDataLength(),
+                          chunk.getDataLength());
+    }
+    return true;
+}
+
 /**
  * Remove an object previously written to this ObjectManager.
  *
@@ -428,7 +687,8 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
     Buffer buffer;
     Log::Reference reference;
     if (!lookup(lock, key, type, buffer, NULL, &reference) ||
-            type != LOG_ENTRY_TYPE_OBJ) {
+            (type != LOG_ENTRY_TYPE_OBJ &&
+             type != LOG_ENTRY_TYPE_OBJMANIFEST)) {
         static RejectRules defaultRejectRules;
         if (rejectRules == NULL)
             rejectRules = &defaultRejectRules;
@@ -474,6 +734,7 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
     if (!log.append(appends, (rpcResult ? 2 : 1))) {
         // The log is out of space. Tell the client to retry and hope
         // that the cleaner makes space soon.
+        history.shed();
         return STATUS_RETRY;
     }
 
@@ -485,11 +746,185 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
                           appends[0].buffer.size() + appends[1].buffer.size(),
                           rpcResult ? 2 : 1);
     segmentManager.raiseSafeVersion(object.getVersion() + 1);
-    log.free(reference);
+    history.retire(key, reference, type != LOG_ENTRY_TYPE_OBJMANIFEST);
     remove(lock, key);
+    if (type == LOG_ENTRY_TYPE_OBJMANIFEST)
+        freeChunks(lock, key);
+    return STATUS_OK;
+}
+
+/**
+ * Add a segment of objects assembled by a client (see BulkLoader) to the
+ * log. Every object in the segment is given the same newly allocated
+ * version, and the segment is then replayed into a SideLog just like a
+ * segment received during migration, so the whole batch costs a single
+ * sync rather than one per object. An object replaces an existing object
+ * with the same key only if the existing object's version is lower; if
+ * a key appears more than once in the segment, the first one is kept.
+ *
+ * The objects become visible as they are replayed, before they are
+ * durable; this is intended for initial loads, where nobody depends on
+ * the data until the load has completed.
+ *
+ * \param tableId
+ *      Table that all of the objects must belong to.
+ * \param firstKeyHash
+ *      Lowest key hash of the tablet receiving the objects.
+ * \param lastKeyHash
+ *      Highest key hash of the tablet receiving the objects.
+ * \param segment
+ *      The segment's contents. The version, timestamp, and checksum of
+ *      each object are rewritten in place.
+ * \param length
+ *      Number of bytes in \a segment.
+ * \param certificate
+ *      Used to verify the integrity of the segment's metadata.
+ * \param[out] objectCount
+ *      The number of objects in the segment is returned here.
+ * \return
+ *      STATUS_OK if the objects were added. STATUS_REQUEST_FORMAT_ERROR
+ *      means the segment is corrupt, contains entries other than objects,
+ *      contains malformed objects, or contains objects from a different
+ *      table; STATUS_UNKNOWN_TABLET
+ *      means that some object's key hash lies outside the tablet. In
+ *      either case nothing is added.
+ */
+Status
+ObjectManager::bulkLoad(uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, void* segment, uint32_t length,
+        const SegmentCertificate& certificate, uint32_t* objectCount)
+{
+    *objectCount = 0;
+    uint64_t version = segmentManager.allocateVersion();
+    uint32_t timestamp = WallTime::secondsTimestamp();
+    try {
+        SegmentIterator it(segment, length, certificate);
+        it.checkMetadataIntegrity();
+        for (; !it.isDone(); it.next()) {
+            if (it.getType() != LOG_ENTRY_TYPE_OBJ)
+                return STATUS_REQUEST_FORMAT_ERROR;
+
+            // The segment is contiguous and belongs to the caller, so the
+            // header can be modified in place.
+            uint32_t entryLength = it.getLength();
+            Object::Header* header = const_cast<Object::Header*>(
+                    it.getContiguous<Object::Header>(NULL, 0));
+            if (!isWellFormedObject(header, entryLength)) {
+                LOG(WARNING, "Bulk load segment for table %lu contains a "
+                        "malformed object", tableId);
+                return STATUS_REQUEST_FORMAT_ERROR;
+            }
+            Object object(header, entryLength);
+            if (object.getTableId() != tableId)
+                return STATUS_REQUEST_FORMAT_ERROR;
+            Key key(tableId, object.getKey(), object.getKeyLength());
+            if (key.getHash() < firstKeyHash || key.getHash() > lastKeyHash)
+                return STATUS_UNKNOWN_TABLET;
+            header->version = version;
+            header->timestamp = timestamp;
+            header->checksum = Object::computeChecksum(header, entryLength);
+            (*objectCount)++;
+        }
+    } catch (SegmentIteratorException& e) {
+        LOG(WARNING, "Bulk load segment for table %lu is corrupt: %s",
+                tableId, e.what());
+        return STATUS_REQUEST_FORMAT_ERROR;
+    }
+
+    TombstoneProtector protector(this);
+    SideLog sideLog(&log);
+    SegmentIterator it(segment, length, certificate);
+    replaySegment(&sideLog, it);
+    sideLog.commit();
+
+    // The objects replaced by the load weren't retired, so snapshots from
+    // before it can't be served.
+    history.forget();
     return STATUS_OK;
 }
 
+/**
+ * Check that an object supplied by a client in a contiguous region of memory
+ * (see #bulkLoad) is self-consistent: its header, key count, key lengths,
+ * and keys must all lie within the region, and it must have a primary key.
+ * This must be done before an Object is constructed from the region, since
+ * Object trusts the lengths it finds there.
+ *
+ * \param entry
+ *      First byte of the serialized object (its Object::Header).
+ * \param length
+ *      Number of bytes in the serialized object.
+ * \return
+ *      True if the object can safely be parsed, false otherwise.
+ */
+bool
+ObjectManager::isWellFormedObject(const void* entry, uint32_t length)
+{
+    if (length < sizeof32(Object::Header) + KEY_INFO_LENGTH(0))
+        return false;
+    const uint8_t* keysAndValue = static_cast<const uint8_t*>(entry) +
+            sizeof(Object::Header);
+    uint32_t keysAndValueLength = length - sizeof32(Object::Header);
+    const KeyOffsets* keyOffsets =
+            reinterpret_cast<const KeyOffsets*>(keysAndValue);
+    KeyCount numKeys = keyOffsets->numKeys;
+    if (numKeys == 0 || KEY_INFO_LENGTH(numKeys) > keysAndValueLength)
+        return false;
+
+    // Cumulative key lengths never decrease, so checking the last one
+    // bounds all of the keys.
+    CumulativeKeyLength previous = 0;
+    for (KeyCount i = 0; i < numKeys; i++) {
+        CumulativeKeyLength cumulative = keyOffsets->cumulativeLengths[i];
+        if (cumulative < previous)
+            return false;
+        previous = cumulative;
+    }
+    if (keyOffsets->cumulativeLengths[0] == 0)
+        return false;
+    return KEY_INFO_LENGTH(numKeys) + previous <= keysAndValueLength;
+}
+
+/**
+ * Invoke a callback for each object in one bucket of the hash table that
+ * belongs to a given tablet. This lets a tablet's live objects be found
+ * without scanning the log: only the hash table and the objects whose
+ * secondary hash bits could be in range are examined. Used by tablet
+ * migration, which walks all of the buckets this way.
+ *
+ * \param bucket
+ *      Index of the hash table bucket to scan.
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param callback
+ *      Invoked with the type, contents, and log reference of each object,
+ *      object manifest, or object chunk in the tablet (and any tombstones
+ *      left in the hash table by recovery). The bucket lock is held during the callback, so
+ *      it must not block or take bucket locks; the buffer is only valid
+ *      during the call, so anything needed must be copied.
+ * \param cookie
+ *      Opaque argument passed to the callback.
+ * \return
+ *      The number of times the callback was invoked.
+ */
+uint64_t
+ObjectManager::forEachTabletEntry(uint64_t bucket, uint64_t tableId,
+        uint64_t firstKeyHash, uint64_t lastKeyHash,
+        void (*callback)(LogEntryType, Buffer&, Log::Reference, void*),
+        void* cookie)
+{
+    HashTableBucketLock lock(*this, bucket);
+    TabletEntryParameters params = { this, tableId, firstKeyHash, lastKeyHash,
+                                     callback, cookie, 0 };
+    objectMap.forEachInBucket(visitIfInTablet, &params, bucket,
+            firstKeyHash, lastKeyHash);
+    return params.count;
+}
+
 /**
  * Scan the hashtable and remove all objects that do not belong to a
  * tablet currently owned by this master. Used to clean up any objects
@@ -498,6 +933,7 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
 void
 ObjectManager::removeOrphanedObjects()
 {
+    history.forget();
     for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
         HashTableBucketLock lock(*this, i);
         CleanupParameters params = { this , &lock };
@@ -629,14 +1065,40 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
         recoverySegmentEntryCount++;
         recoverySegmentEntryBytes += it.getLength();
 
-        if (expect_true(type == LOG_ENTRY_TYPE_OBJ)) {
+        if (expect_true(type == LOG_ENTRY_TYPE_OBJ) ||
+                type == LOG_ENTRY_TYPE_OBJRPCRESULT ||
+                type == LOG_ENTRY_TYPE_OBJMANIFEST) {
             // The recovery segment is guaranteed to be contiguous, so we need
-            // not provide a copyout buffer.
+            // not provide a copyout buffer. Manifests of chunked objects have
+            // the same format as objects and are replayed the same way; their
+            // chunks are handled below.
 
             const Object::Header* recoveryObj =
                 it.getContiguous<Object::Header>(NULL, 0);
 
-            Object replayObj(recoveryObj, it.getLength());
+            // Objects stored with the RpcResult of the write that created
+            // them keep it only if it is still needed; if the object itself
+            // turns out to be stale, the RpcResult is kept on its own.
+            uint32_t objectLength = it.getLength();
+            Buffer rpcResultBuffer;
+            Tub<RpcResult> rpcResult;
+            bool recoverRpcResult = false;
+            if (type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
+                Buffer entryBuffer;
+                entryBuffer.appendExternal(recoveryObj, it.getLength());
+                objectLength =
+                        RpcResult::objectLengthInCombinedEntry(entryBuffer);
+                rpcResultBuffer.appendExternal(
+                        reinterpret_cast<const char*>(recoveryObj) +
+                                objectLength,
+                        RpcResult::lengthInCombinedEntry(entryBuffer));
+                rpcResult.construct(rpcResultBuffer);
+                recoverRpcResult = unackedRpcResults->shouldRecover(
+                        rpcResult->getLeaseId(), rpcResult->getRpcId(),
+                        rpcResult->getAckId(), type);
+            }
+
+            Object replayObj(recoveryObj, objectLength);
             KeyLength primaryKeyLen = 0;
             const void *primaryKey = replayObj.getKey(0, &primaryKeyLen);
 
@@ -658,7 +1120,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
             bool checksumIsValid = ({
                 CycleCounter<uint64_t> c(&verifyChecksumTicks);
-                Object::computeChecksum(recoveryObj, it.getLength()) ==
+                Object::computeChecksum(recoveryObj, objectLength) ==
                     recoveryObj->checksum;
             });
             if (expect_false(!checksumIsValid)) {
@@ -692,6 +1154,10 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                 // Throw new object away if the hash table version is newer
                 if (recoveryObj->version <= currentVersion) {
                     objectDiscardCount++;
+                    if (recoverRpcResult) {
+                        appendRecoveredRpcResult(sideLog, *rpcResult,
+                                rpcResultBuffer, &segmentAppendTicks);
+                    }
                     continue;
                 }
                 if (currentEntryIsObject) {
@@ -720,18 +1186,29 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
             // Add the incoming object or tombstone to our log and update
             // the hash table to refer to it.
             Log::Reference newObjReference;
+            uint32_t appendLength = recoverRpcResult ? it.getLength()
+                                                     : objectLength;
             {
                 CycleCounter<uint64_t> _(&segmentAppendTicks);
-                sideLog->append(LOG_ENTRY_TYPE_OBJ,
+                sideLog->append(type == LOG_ENTRY_TYPE_OBJRPCRESULT &&
+                                        !recoverRpcResult ?
+                                        LOG_ENTRY_TYPE_OBJ : type,
                                 recoveryObj,
-                                it.getLength(),
+                                appendLength,
                                 &newObjReference);
                 TableStats::increment(masterTableMetadata,
                                       key.getTableId(),
-                                      it.getLength(),
+                                      appendLength,
                                       1);
             }
             replace(lock, key, newObjReference);
+            if (recoverRpcResult) {
+                unackedRpcResults->recoverRecord(
+                        rpcResult->getLeaseId(),
+                        rpcResult->getRpcId(),
+                        rpcResult->getAckId(),
+                        reinterpret_cast<void*>(newObjReference.toInteger()));
+            }
 
             // JIRA Issue: RAM-674:
             // If master runs out of space during recovery, this master
@@ -740,7 +1217,83 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
             liveObjectCount++;
             objectAppendCount++;
-            liveObjectBytes += it.getLength();
+            liveObjectBytes += objectLength;
+        } else if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            Key key(type, buffer);
+
+            ObjectChunk recoveryChunk(buffer);
+            bool checksumIsValid = ({
+                CycleCounter<uint64_t> c(&verifyChecksumTicks);
+                recoveryChunk.checkIntegrity();
+            });
+            if (expect_false(!checksumIsValid)) {
+                LOG(WARNING, "bad object chunk checksum! key: %s, version: %lu",
+                    key.toString().c_str(), recoveryChunk.getVersion());
+                // JIRA Issue: RAM-673:
+                // Should throw and try another segment replica.
+            }
+            uint64_t recoverVersion = recoveryChunk.getVersion();
+
+            HashTableBucketLock lock(*this, key);
+
+            // Throw the chunk away if its object has already been replaced
+            // or deleted. Otherwise keep it: chunks precede their manifest
+            // in the log, but may be replayed in any order relative to it.
+            // Chunks whose manifest never shows up (for example, because
+            // the write did not complete before the crash) are discarded by
+            // removeIfTombstone once the tablet is done recovering.
+            LogEntryType currentType;
+            Buffer currentBuffer;
+            uint64_t currentVersion;
+            if (lookup(lock, key, currentType, currentBuffer,
+                       &currentVersion)) {
+                if (recoverVersion < currentVersion ||
+                    (recoverVersion == currentVersion &&
+                     currentType == LOG_ENTRY_TYPE_OBJTOMB)) {
+                    objectDiscardCount++;
+                    continue;
+                }
+            }
+
+            // The same chunk may be replayed more than once (for example,
+            // by a retried migration); keep only a single copy of it.
+            bool duplicate = false;
+            HashTable::Candidates candidates;
+            objectMap.lookup(key.getHash(), candidates);
+            for (; !candidates.isDone(); candidates.next()) {
+                Buffer candidateBuffer;
+                Log::Reference candidateRef(candidates.getReference());
+                if (log.getEntry(candidateRef, candidateBuffer) !=
+                        LOG_ENTRY_TYPE_OBJCHUNK)
+                    continue;
+                ObjectChunk candidate(candidateBuffer);
+                if (candidate.getChecksum() == recoveryChunk.getChecksum() &&
+                        candidate.getVersion() == recoverVersion &&
+                        candidate.getChunkIndex() ==
+                                recoveryChunk.getChunkIndex()) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) {
+                objectDiscardCount++;
+                continue;
+            }
+
+            Log::Reference newChunkReference;
+            {
+                CycleCounter<uint64_t> _(&segmentAppendTicks);
+                sideLog->append(LOG_ENTRY_TYPE_OBJCHUNK, buffer,
+                                &newChunkReference);
+                TableStats::increment(masterTableMetadata,
+                                      key.getTableId(),
+                                      it.getLength(),
+                                      1);
+            }
+            objectMap.insert(key.getHash(), newChunkReference.toInteger());
+            objectAppendCount++;
         } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
             Buffer buffer;
             it.appendToBuffer(buffer);
@@ -916,24 +1469,8 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                                                  rpcResult.getRpcId(),
                                                  rpcResult.getAckId(),
                                                  type)) {
-                Log::Reference newRpcResultReference;
-                {
-                    CycleCounter<uint64_t> _(&segmentAppendTicks);
-                    sideLog->append(LOG_ENTRY_TYPE_RPCRESULT,
-                                    buffer,
-                                    &newRpcResultReference);
-                    TableStats::increment(masterTableMetadata,
-                            rpcResult.getTableId(),
-                            buffer.size(),
-                            1);
-                }
-
-                unackedRpcResults->recoverRecord(
-                        rpcResult.getLeaseId(),
-                        rpcResult.getRpcId(),
-                        rpcResult.getAckId(),
-                        reinterpret_cast<void*>(
-                                newRpcResultReference.toInteger()));
+                appendRecoveredRpcResult(sideLog, rpcResult, buffer,
+                                         &segmentAppendTicks);
             }
         } else if (type == LOG_ENTRY_TYPE_PREP) {
             // We cannot grab lock in this code, which can cause deadlock.
@@ -1171,7 +1708,8 @@ ObjectManager::syncChanges()
  * \param rpcResult
  *      If non-NULL, this method appends rpcResult to the log atomically with
  *      the other record(s) for the write. The extra record is used to ensure
- *      linearizability.
+ *      linearizability. Unless the object is chunked, it is stored in the
+ *      same log entry as the object (LOG_ENTRY_TYPE_OBJRPCRESULT).
  * \param[out] rpcResultPtr
  *      If non-NULL, pointer to the RpcResult in log is returned.
  * \return
@@ -1253,13 +1791,32 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
 
     Tub<ObjectTombstone> tombstone;
     if (currentVersion != VERSION_NONEXISTENT &&
-      currentType == LOG_ENTRY_TYPE_OBJ) {
+      (currentType == LOG_ENTRY_TYPE_OBJ ||
+       currentType == LOG_ENTRY_TYPE_OBJMANIFEST)) {
         Object object(currentBuffer);
         tombstone.construct(object,
                             log.getSegmentId(currentReference),
                             WallTime::secondsTimestamp());
     }
 
+    // Values larger than the chunk size are written as a sequence of chunks
+    // followed by a manifest (see ObjectChunk.h). The chunks are appended
+    // first, and the manifest then takes the place of the object in the
+    // atomic append below, which makes it the commit point for the write.
+    bool chunked = config->master.objectChunkSize != 0 &&
+            newObject.getValueLength() > config->master.objectChunkSize;
+    Buffer manifestKeysAndValue;
+    Tub<Object> manifestObject;
+    std::vector<Log::Reference> chunkReferences;
+    if (chunked) {
+        writeObjectChunks(key, newObject, manifestKeysAndValue,
+                          chunkReferences);
+        manifestObject.construct(newObject.getTableId(),
+                                 newObject.getVersion(),
+                                 newObject.getTimestamp(),
+                                 manifestKeysAndValue);
+    }
+
     // Create a vector of appends in case we need to write multiple log entries
     // including a tombstone, an object and a linearizability record.
     // This is necessary to ensure that both tombstone, object and rpcResult
@@ -1271,12 +1828,19 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     // record should exist if and only if new object is written.
     Log::AppendVector appends[2 + (rpcResult ? 1 : 0)];
 
-    newObject.assembleForLog(appends[0].buffer);
-    appends[0].type = LOG_ENTRY_TYPE_OBJ;
+    if (chunked) {
+        manifestObject->assembleForLog(appends[0].buffer);
+        appends[0].type = LOG_ENTRY_TYPE_OBJMANIFEST;
+    } else {
+        newObject.assembleForLog(appends[0].buffer);
+        appends[0].type = LOG_ENTRY_TYPE_OBJ;
+    }
+    uint32_t objectBytes = appends[0].buffer.size();
 
     // Note: only check for enough space for the object (tombstones
     // don't get included in the limit, since they can be cleaned).
-    if (!log.hasSpaceFor(appends[0].buffer.size())) {
+    if (!log.hasSpaceFor(objectBytes)) {
+        freeUncommittedChunks(key, chunkReferences);
         throw RetryException(HERE, 1000, 2000, "Memory capacity exceeded");
     }
 
@@ -1288,24 +1852,45 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     if (outVersion != NULL)
         *outVersion = newObject.getVersion();
 
-    int rpcResultIndex = 1 + (tombstone ? 1 : 0);
-    if (rpcResult) {
+    // The linearizability record normally shares the object's entry, which
+    // saves the per-entry overheads of a second one. Manifests are relocated
+    // and recovered along with their chunks, so they get a separate record.
+    bool combined = rpcResult && !chunked;
+    int rpcResultIndex = combined ? 0 : 1 + (tombstone ? 1 : 0);
+    if (combined) {
+        rpcResult->assembleForLogWithObject(appends[0].buffer);
+        appends[0].type = LOG_ENTRY_TYPE_OBJRPCRESULT;
+    } else if (rpcResult) {
         rpcResult->assembleForLog(appends[rpcResultIndex].buffer);
         appends[rpcResultIndex].type = LOG_ENTRY_TYPE_RPCRESULT;
     }
 
-    if (!log.append(appends, (tombstone ? 2 : 1) + (rpcResult ? 1 : 0))) {
+    bool appended =
+#ifdef TESTING
+            !mockWriteAppendFailure &&
+#endif
+            log.append(appends, (tombstone ? 2 : 1) +
+                                (rpcResult && !combined ? 1 : 0));
+    if (!appended) {
         // The log is out of space. Tell the client to retry and hope
         // that the cleaner makes space soon.
+        freeUncommittedChunks(key, chunkReferences);
+        history.shed();
         throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
     }
 
     if (tombstone) {
         currentHashTableEntry.setReference(appends[0].reference.toInteger());
-        log.free(currentReference);
+        history.retire(key, currentReference,
+                       currentType != LOG_ENTRY_TYPE_OBJMANIFEST);
     } else {
         objectMap.insert(key.getHash(), appends[0].reference.toInteger());
+        history.recordCreation(key);
     }
+    if (currentType == LOG_ENTRY_TYPE_OBJMANIFEST)
+        freeChunks(lock, key);
+    foreach (Log::Reference chunkReference, chunkReferences)
+        objectMap.insert(key.getHash(), chunkReference.toInteger());
 
     if (rpcResult && rpcResultPtr)
         *rpcResultPtr = appends[rpcResultIndex].reference.toInteger();
@@ -1318,15 +1903,21 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
             newObject.getKeysAndValueLength() - valueLength;
 
     TEST_LOG("object: %u bytes, version %lu",
-        appends[0].buffer.size(), newObject.getVersion());
+        objectBytes, newObject.getVersion());
+
+    if (chunked) {
+        TEST_LOG("chunked: %lu chunks of at most %u bytes",
+            chunkReferences.size(), config->master.objectChunkSize);
+    }
 
     if (tombstone) {
         TEST_LOG("tombstone: %u bytes, version %lu",
             appends[1].buffer.size(), tombstone->getObjectVersion());
     }
     if (rpcResult) {
-        TEST_LOG("rpcResult: %u bytes",
-            appends[rpcResultIndex].buffer.size());
+        TEST_LOG("rpcResult: %u bytes%s",
+            rpcResult->getSerializedLength(),
+            combined ? ", combined with object" : "");
     }
 
     {
@@ -1336,7 +1927,7 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
             byteCount += appends[1].buffer.size();
             recordCount += 1;
         }
-        if (rpcResult) {
+        if (rpcResult && !combined) {
             byteCount += appends[rpcResultIndex].buffer.size();
             recordCount += 1;
         }
@@ -1350,6 +1941,74 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     return STATUS_OK;
 }
 
+/**
+ * Append the value of an object to the log as a sequence of chunks, in
+ * preparation for writing the object's manifest. Used by writeObject() for
+ * values larger than the configured chunk size. Each chunk is appended
+ * separately, so the value may span any number of segments; the chunks are
+ * not added to the hash table until the manifest has been appended.
+ *
+ * \param key
+ *      Primary key of the object being written.
+ * \param newObject
+ *      The object being written. Its version and timestamp must already
+ *      be set.
+ * \param[out] manifestKeysAndValue
+ *      The keys of newObject followed by the serialized manifest for the
+ *      chunks are appended here; this is the keysAndValue of the manifest
+ *      entry that commits the write.
+ * \param[out] chunkReferences
+ *      Log references to the chunks appended, in order.
+ * \throw RetryException
+ *      The log is out of space. Any chunks already appended have been freed.
+ */
+void
+ObjectManager::writeObjectChunks(Key& key, Object& newObject,
+                Buffer& manifestKeysAndValue,
+                std::vector<Log::Reference>& chunkReferences)
+{
+    uint32_t chunkSize = config->master.objectChunkSize;
+    uint32_t valueLength = newObject.getValueLength();
+
+    // As for ordinary objects, only the new data counts against the limit.
+    if (!log.hasSpaceFor(newObject.getSerializedLength())) {
+        throw RetryException(HERE, 1000, 2000, "Memory capacity exceeded");
+    }
+
+    Buffer value;
+    newObject.appendValueToBuffer(&value);
+
+    ObjectChunkManifest manifest(valueLength, chunkSize);
+    uint32_t chunkIndex = 0;
+    for (uint32_t offset = 0; offset < valueLength; offset += chunkSize) {
+        ObjectChunk chunk(key, newObject.getVersion(), chunkIndex++,
+                          newObject.getTimestamp(), value, offset,
+                          std::min(chunkSize, valueLength - offset));
+
+        Log::AppendVector append;
+        chunk.assembleForLog(append.buffer);
+        append.type = LOG_ENTRY_TYPE_OBJCHUNK;
+        if (!log.append(&append, 1)) {
+            freeUncommittedChunks(key, chunkReferences);
+            history.shed();
+            throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
+        }
+
+        // Chunks are accounted for from the time they are appended until
+        // they are freed (see relocateObject).
+        TableStats::increment(masterTableMetadata,
+                              key.getTableId(),
+                              append.buffer.size(),
+                              1);
+        manifest.addChunk(chunk.getChecksum());
+        chunkReferences.push_back(append.reference);
+    }
+
+    newObject.appendKeysAndValueToBuffer(manifestKeysAndValue);
+    manifestKeysAndValue.truncate(manifestKeysAndValue.size() - valueLength);
+    manifest.assemble(manifestKeysAndValue);
+}
+
 /**
  * Write the RpcResult log-entry indicating that transaction prepare has failed
  * and transition should be aborted.
@@ -1441,6 +2100,10 @@ ObjectManager::writeRpcResultOnly(RpcResult* rpcResult, uint64_t* rpcResultPtr)
  * \return
  *      STATUS_OK if the object was written. Otherwise, for example,
  *      STATUS_UNKNOWN_TABLE may be returned.
+ * \throw RetryException
+ *      The object is locked by another transaction and this one has been
+ *      queued to wait for the lock (see LockTable::admit); the prepare should
+ *      be retried shortly.
  */
 Status
 ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
@@ -1481,13 +2144,20 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
     if (tablet.state != TabletManager::NORMAL)
         return STATUS_UNKNOWN_TABLET;
 
-    // If the key is already locked, abort.
-    if (lockTable.isLockAcquired(key)) {
-        RAMCLOUD_LOG(DEBUG,
-                "TxPrepare fail. Key: %.*s, object is already locked",
-                keyLength, reinterpret_cast<const char*>(keyString));
-        writePrepareFail(rpcResult, rpcResultPtr);
-        return STATUS_OK;
+    // If the key is already locked, either wait for the lock or abort.
+    TransactionId txId(newOp.header.clientId, newOp.header.clientTxId);
+    switch (lockTable.admit(key, txId)) {
+        case LockTable::PROCEED:
+            break;
+        case LockTable::WAIT:
+            throw RetryException(HERE, 10, 50,
+                    "Waiting for a transaction lock");
+        case LockTable::ABORT:
+            RAMCLOUD_LOG(DEBUG,
+                    "TxPrepare fail. Key: %.*s, object is already locked",
+                    keyLength, reinterpret_cast<const char*>(keyString));
+            writePrepareFail(rpcResult, rpcResultPtr);
+            return STATUS_OK;
     }
 
     LogEntryType currentType = LOG_ENTRY_TYPE_INVALID;
@@ -1844,6 +2514,10 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
  * \param[out] removedObjBuffer
  *      If non-NULL, pointer to the buffer in log for the object being removed
  *      is returned.
+ * \param commitTime
+ *      Cluster time at which the transaction commits; the removal becomes
+ *      visible to snapshots after this time. The default means the current
+ *      time of the master's clock.
  * \return
  *      Returns STATUS_OK if the remove succeeded. Other status values indicate
  *      different failures (tablet doesn't exist, reject rules applied, etc).
@@ -1851,7 +2525,8 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
 Status
 ObjectManager::commitRemove(PreparedOp& op,
                             Log::Reference& refToPreparedOp,
-                            Buffer* removedObjBuffer)
+                            Buffer* removedObjBuffer,
+                            ClusterTime commitTime)
 {
     uint16_t keyLength = 0;
     const void *keyString = op.object.getKey(0, &keyLength);
@@ -1877,7 +2552,8 @@ ObjectManager::commitRemove(PreparedOp& op,
     Buffer buffer;
     Log::Reference reference;
     if (!lookup(lock, key, type, buffer, NULL, &reference) ||
-            type != LOG_ENTRY_TYPE_OBJ) {
+            (type != LOG_ENTRY_TYPE_OBJ &&
+             type != LOG_ENTRY_TYPE_OBJMANIFEST)) {
         static RejectRules defaultRejectRules;
         return rejectOperation(&defaultRejectRules, VERSION_NONEXISTENT);
     }
@@ -1907,6 +2583,7 @@ ObjectManager::commitRemove(PreparedOp& op,
         // The log is out of space. Tell the client to retry and hope
         // that either the cleaner makes space soon or we shift load
         // off of this server.
+        history.shed();
         return STATUS_RETRY;
     }
 
@@ -1932,10 +2609,13 @@ ObjectManager::commitRemove(PreparedOp& op,
     }
 
     segmentManager.raiseSafeVersion(object.getVersion() + 1);
-    log.free(reference);
+    history.retire(key, reference, type != LOG_ENTRY_TYPE_OBJMANIFEST,
+                   commitTime);
     log.free(refToPreparedOp);
     transactionManager->removeOp(op.header.clientId, op.header.rpcId);
     remove(lock, key);
+    if (type == LOG_ENTRY_TYPE_OBJMANIFEST)
+        freeChunks(lock, key);
     return STATUS_OK;
 }
 
@@ -1950,6 +2630,10 @@ ObjectManager::commitRemove(PreparedOp& op,
  * \param[out] removedObjBuffer
  *      If non-NULL, pointer to the buffer in log for the object being removed
  *      is returned.
+ * \param commitTime
+ *      Cluster time at which the transaction commits; the new version becomes
+ *      visible to snapshots after this time. The default means the current
+ *      time of the master's clock.
  * \return
  *      STATUS_OK if the object was written. Otherwise, for example,
  *      STATUS_UKNOWN_TABLE may be returned.
@@ -1957,7 +2641,8 @@ ObjectManager::commitRemove(PreparedOp& op,
 Status
 ObjectManager::commitWrite(PreparedOp& op,
                            Log::Reference& refToPreparedOp,
-                           Buffer* removedObjBuffer)
+                           Buffer* removedObjBuffer,
+                           ClusterTime commitTime)
 {
     uint16_t keyLength = 0;
     const void *keyString = op.object.getKey(0, &keyLength);
@@ -1987,7 +2672,8 @@ ObjectManager::commitWrite(PreparedOp& op,
     HashTable::Candidates currentHashTableEntry;
     if (!lookup(lock, key, type, buffer, NULL,
                 &oldReference, &currentHashTableEntry) ||
-            type != LOG_ENTRY_TYPE_OBJ) {
+            (type != LOG_ENTRY_TYPE_OBJ &&
+             type != LOG_ENTRY_TYPE_OBJMANIFEST)) {
         newKey = true;
     }
 
@@ -2032,6 +2718,7 @@ ObjectManager::commitWrite(PreparedOp& op,
 
     if (!log.hasSpaceFor(appends[1].buffer.size())) {
         // We must bound the amount of live data to ensure deletes are possible
+        history.shed();
         throw RetryException(HERE, 1000, 2000, "Log is out of space!");
     }
 
@@ -2039,6 +2726,7 @@ ObjectManager::commitWrite(PreparedOp& op,
         // The log is out of space. Tell the client to retry and hope
         // that either the cleaner makes space soon or we shift load
         // off of this server.
+        history.shed();
         return STATUS_RETRY;
     }
 
@@ -2067,9 +2755,13 @@ ObjectManager::commitWrite(PreparedOp& op,
 
     if (!newKey) {
         currentHashTableEntry.setReference(appends[1].reference.toInteger());
-        log.free(oldReference);
+        history.retire(key, oldReference, type != LOG_ENTRY_TYPE_OBJMANIFEST,
+                       commitTime);
+        if (type == LOG_ENTRY_TYPE_OBJMANIFEST)
+            freeChunks(lock, key);
     } else {
         objectMap.insert(key.getHash(), appends[1].reference.toInteger());
+        history.recordCreation(key, commitTime);
     }
     return STATUS_OK;
 }
@@ -2392,10 +3084,13 @@ ObjectManager::writeTombstone(Key& key, Buffer *logBuffer)
 uint32_t
 ObjectManager::getTimestamp(LogEntryType type, Buffer& buffer)
 {
-    if (type == LOG_ENTRY_TYPE_OBJ)
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+            type == LOG_ENTRY_TYPE_OBJRPCRESULT)
         return getObjectTimestamp(buffer);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         return getTombstoneTimestamp(buffer);
+    else if (type == LOG_ENTRY_TYPE_OBJCHUNK)
+        return getObjectChunkTimestamp(buffer);
     else if (type == LOG_ENTRY_TYPE_TXDECISION)
         return getTxDecisionRecordTimestamp(buffer);
     else
@@ -2428,8 +3123,13 @@ ObjectManager::relocate(LogEntryType type, Buffer& oldBuffer,
 {
     if (type == LOG_ENTRY_TYPE_OBJ)
         relocateObject(oldBuffer, oldReference, relocator);
+    else if (type == LOG_ENTRY_TYPE_OBJMANIFEST ||
+             type == LOG_ENTRY_TYPE_OBJCHUNK)
+        relocateObject(oldBuffer, oldReference, relocator, type);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         relocateTombstone(oldBuffer, oldReference, relocator);
+    else if (type == LOG_ENTRY_TYPE_OBJRPCRESULT)
+        relocateObjectRpcResult(oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_RPCRESULT)
         relocateRpcResult(oldBuffer, relocator);
     else if (type == LOG_ENTRY_TYPE_PREP)
@@ -2515,6 +3215,43 @@ ObjectManager::TombstoneProtector::~TombstoneProtector()
     }
 }
 
+/**
+ * Used by replaySegment() to add an RpcResult that is still needed to the
+ * recovered log and record it in UnackedRpcResults.
+ *
+ * \param sideLog
+ *      Log to which the recovered entries are being appended.
+ * \param rpcResult
+ *      The RpcResult to add; UnackedRpcResults::shouldRecover() must already
+ *      have agreed to keep it.
+ * \param buffer
+ *      Buffer holding exactly the serialized \a rpcResult.
+ * \param[out] appendTicks
+ *      Incremented by the cycles spent appending to \a sideLog.
+ */
+void
+ObjectManager::appendRecoveredRpcResult(SideLog* sideLog, RpcResult& rpcResult,
+        Buffer& buffer, uint64_t* appendTicks)
+{
+    Log::Reference newRpcResultReference;
+    {
+        CycleCounter<uint64_t> _(appendTicks);
+        sideLog->append(LOG_ENTRY_TYPE_RPCRESULT,
+                        buffer,
+                        &newRpcResultReference);
+        TableStats::increment(masterTableMetadata,
+                rpcResult.getTableId(),
+                buffer.size(),
+                1);
+    }
+
+    unackedRpcResults->recoverRecord(
+            rpcResult.getLeaseId(),
+            rpcResult.getRpcId(),
+            rpcResult.getAckId(),
+            reinterpret_cast<void*>(newRpcResultReference.toInteger()));
+}
+
 /**
  * Produce a human-readable description of the contents of a segment.
  * Intended primarily for use in unit tests.
@@ -2542,6 +3279,37 @@ ObjectManager::dumpSegment(Segment* segment)
                     separator, it.getOffset(), it.getLength(),
                     object.getTableId(), object.getKeyLength(),
                     static_cast<const char*>(object.getKey()));
+        } else if (type == LOG_ENTRY_TYPE_OBJRPCRESULT) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            Object object(buffer);
+            RpcResult rpcResult(buffer,
+                    RpcResult::objectLengthInCombinedEntry(buffer),
+                    RpcResult::lengthInCombinedEntry(buffer));
+            result += format("%sobject with rpcResult at offset %u, length %u "
+                    "with tableId %lu, key '%.*s', leaseId %lu, rpcId %lu",
+                    separator, it.getOffset(), it.getLength(),
+                    object.getTableId(), object.getKeyLength(),
+                    static_cast<const char*>(object.getKey()),
+                    rpcResult.getLeaseId(), rpcResult.getRpcId());
+        } else if (type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            Object object(buffer);
+            result += format("%smanifest at offset %u, length %u with tableId "
+                    "%lu, key '%.*s'",
+                    separator, it.getOffset(), it.getLength(),
+                    object.getTableId(), object.getKeyLength(),
+                    static_cast<const char*>(object.getKey()));
+        } else if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            ObjectChunk chunk(buffer);
+            result += format("%schunk %u at offset %u, length %u with tableId "
+                    "%lu, key '%.*s'",
+                    separator, chunk.getChunkIndex(), it.getOffset(),
+                    it.getLength(), chunk.getTableId(), chunk.getKeyLength(),
+                    static_cast<const char*>(chunk.getKey()));
         } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
             Buffer buffer;
             it.appendToBuffer(buffer);
@@ -2650,6 +3418,21 @@ ObjectManager::getTombstoneTimestamp(Buffer& buffer)
     return tomb.getTimestamp();
 }
 
+/**
+ * Callback used by the Log to determine the age of an ObjectChunk.
+ *
+ * \param buffer
+ *      Buffer pointing to the chunk the timestamp is to be extracted from.
+ * \return
+ *      The chunk's creation timestamp (the same as its object's).
+ */
+uint32_t
+ObjectManager::getObjectChunkTimestamp(Buffer& buffer)
+{
+    ObjectChunk chunk(buffer);
+    return chunk.getTimestamp();
+}
+
 /**
  * Method used by the Lod to determine the age of a TxDecisionRecord.
  *
@@ -2714,12 +3497,20 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
         Log::Reference candidateRef(candidates.getReference());
         LogEntryType type = log.getEntry(candidateRef, candidateBuffer);
 
+        // Chunks share their object's key, but are never the current entry
+        // for it; the manifest is.
+        if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            candidates.next();
+            continue;
+        }
+
         Key candidateKey(type, candidateBuffer);
         if (key == candidateKey) {
             outType = type;
             buffer.append(&candidateBuffer);
             if (outVersion != NULL) {
-                if (type == LOG_ENTRY_TYPE_OBJ) {
+                if (type == LOG_ENTRY_TYPE_OBJ ||
+                        type == LOG_ENTRY_TYPE_OBJMANIFEST) {
                     Object o(candidateBuffer);
                     *outVersion = o.getVersion();
                 } else {
@@ -2763,6 +3554,10 @@ ObjectManager::remove(HashTableBucketLock& lock, Key& key)
         Buffer buffer;
         Log::Reference candidateRef(candidates.getReference());
         LogEntryType type = log.getEntry(candidateRef, buffer);
+        if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            candidates.next();
+            continue;
+        }
         Key candidateKey(type, buffer);
         if (key == candidateKey) {
             candidates.remove();
@@ -2773,6 +3568,154 @@ ObjectManager::remove(HashTableBucketLock& lock, Key& key)
     return false;
 }
 
+/**
+ * Remove all of the chunks of a chunked object from the hash table and
+ * free them in the log. Called once the object's manifest has been
+ * superseded or deleted.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param key
+ *      Key of the chunked object.
+ */
+void
+ObjectManager::freeChunks(HashTableBucketLock& lock, Key& key)
+{
+    HashTable::Candidates candidates;
+    objectMap.lookup(key.getHash(), candidates);
+    for (; !candidates.isDone(); candidates.next()) {
+        Buffer buffer;
+        Log::Reference candidateRef(candidates.getReference());
+        if (log.getEntry(candidateRef, buffer) != LOG_ENTRY_TYPE_OBJCHUNK)
+            continue;
+        Key candidateKey(LOG_ENTRY_TYPE_OBJCHUNK, buffer);
+        if (key == candidateKey) {
+            candidates.remove();
+            TableStats::decrement(masterTableMetadata,
+                                  key.getTableId(),
+                                  buffer.size(),
+                                  1);
+            log.free(candidateRef);
+        }
+    }
+}
+
+/**
+ * Free the chunks appended by a write that then failed (they were never
+ * added to the hash table), and remove them from the table's statistics.
+ *
+ * \param key
+ *      Key of the object being written.
+ * \param chunkReferences
+ *      Log references to the chunks; cleared here.
+ */
+void
+ObjectManager::freeUncommittedChunks(Key& key,
+                std::vector<Log::Reference>& chunkReferences)
+{
+    foreach (Log::Reference chunkReference, chunkReferences) {
+        Buffer buffer;
+        log.getEntry(chunkReference, buffer);
+        TableStats::decrement(masterTableMetadata,
+                              key.getTableId(),
+                              buffer.size(),
+                              1);
+        log.free(chunkReference);
+    }
+    chunkReferences.clear();
+}
+
+/**
+ * Remove a chunk from the hash table and free it in the log unless the
+ * current manifest for its key refers to it, i.e. unless the manifest has
+ * the chunk's version and records the chunk's checksum at the chunk's index.
+ * Chunks in tablets this master does not own are always removed.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held.
+ * \param key
+ *      Key of the chunk.
+ * \param reference
+ *      Log reference to the chunk, as stored in the hash table.
+ * \param buffer
+ *      Buffer pointing to the chunk in the log.
+ */
+void
+ObjectManager::removeIfStaleChunk(HashTableBucketLock& lock, Key& key,
+                Log::Reference reference, Buffer& buffer)
+{
+    ObjectChunk chunk(buffer);
+    LogEntryType currentType;
+    Buffer currentBuffer;
+    if (tabletManager->getTablet(key) &&
+            lookup(lock, key, currentType, currentBuffer) &&
+            currentType == LOG_ENTRY_TYPE_OBJMANIFEST) {
+        Object manifestObject(currentBuffer);
+        Buffer manifestBuffer;
+        manifestObject.appendValueToBuffer(&manifestBuffer);
+        ObjectChunkManifest manifest(manifestBuffer);
+        uint32_t index = chunk.getChunkIndex();
+        if (manifestObject.getVersion() == chunk.getVersion() &&
+                index < manifest.getChunkCount() &&
+                manifest.getChunkChecksum(index) == chunk.getChecksum())
+            return;
+    }
+
+    TEST_LOG("discarding chunk %u of version %lu",
+             chunk.getChunkIndex(), chunk.getVersion());
+    HashTable::Candidates candidates;
+    objectMap.lookup(key.getHash(), candidates);
+    for (; !candidates.isDone(); candidates.next()) {
+        if (candidates.getReference() == reference.toInteger()) {
+            candidates.remove();
+            break;
+        }
+    }
+    TableStats::decrement(masterTableMetadata,
+                          key.getTableId(),
+                          buffer.size(),
+                          1);
+    log.free(reference);
+}
+
+/**
+ * Passes an entry found in the hash table to the callback of
+ * forEachTabletEntry if it belongs to the tablet being scanned.
+ *
+ * \param reference
+ *      Reference into the log for an entry, on callback from
+ *      objectMap->forEachInBucket().
+ * \param cookie
+ *      Pointer to the TabletEntryParameters describing the scan.
+ */
+void
+ObjectManager::visitIfInTablet(uint64_t reference, void *cookie)
+{
+    TabletEntryParameters* params =
+            reinterpret_cast<TabletEntryParameters*>(cookie);
+    Buffer buffer;
+    LogEntryType type = params->objectManager->log.getEntry(
+            Log::Reference(reference), buffer);
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB &&
+            type != LOG_ENTRY_TYPE_OBJMANIFEST &&
+            type != LOG_ENTRY_TYPE_OBJCHUNK)
+        return;
+
+    Key key(type, buffer);
+    if (key.getTableId() != params->tableId)
+        return;
+    KeyHash keyHash = key.getHash();
+    if (keyHash < params->firstKeyHash || keyHash > params->lastKeyHash)
+        return;
+
+    params->callback(type, buffer, Log::Reference(reference),
+            params->cookie);
+    params->count++;
+}
+
 /**
  * Removes an object from the hash table and frees it from the log if
  * it belongs to a tablet that doesn't exist in the master's TabletManager.
@@ -2796,11 +3739,17 @@ ObjectManager::removeIfOrphanedObject(uint64_t reference, void *cookie)
     Buffer buffer;
 
     type = objectManager->log.getEntry(Log::Reference(reference), buffer);
-    if (type != LOG_ENTRY_TYPE_OBJ)
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJMANIFEST &&
+            type != LOG_ENTRY_TYPE_OBJCHUNK)
         return;
 
     Key key(type, buffer);
     if (!objectManager->tabletManager->getTablet(key)) {
+        if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            objectManager->removeIfStaleChunk(*params->lock, key,
+                    Log::Reference(reference), buffer);
+            return;
+        }
         TEST_LOG("removing orphaned object at ref %lu", reference);
         bool r = objectManager->remove(*params->lock, key);
         if (!r) {
@@ -2855,6 +3804,17 @@ ObjectManager::removeIfTombstone(uint64_t maybeTomb, void *cookie)
 
         // Tombstones are not explicitly freed in the log. The cleaner will
         // figure out that they're dead.
+    } else if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+        // Replay keeps every chunk it sees, since it cannot know which
+        // manifest will end up current. Once replay for the tablet is over,
+        // drop the chunks that the current manifest does not refer to.
+        Key key(type, buffer);
+        TabletManager::Tablet tablet;
+        if (!objectManager->tabletManager->getTablet(key, &tablet) ||
+          tablet.state != TabletManager::NOT_READY) {
+            objectManager->removeIfStaleChunk(*params->lock, key,
+                    Log::Reference(maybeTomb), buffer);
+        }
     }
 }
 
@@ -2908,7 +3868,9 @@ ObjectManager::rejectOperation(const RejectRules* rejectRules, uint64_t version)
 
 /**
  * Callback used by the LogCleaner when it's cleaning a Segment and comes
- * across an Object.
+ * across an Object, a chunked object's manifest, or one of its chunks. All
+ * three are referenced directly from the hash table, so they are handled
+ * identically.
  *
  * This callback will decide if the object is still alive. If it is, it must
  * use the relocator to move it to a new location and atomically update the
@@ -2928,12 +3890,15 @@ ObjectManager::rejectOperation(const RejectRules* rejectRules, uint64_t version)
  *      It is possible that relocation may fail (because more memory needs to
  *      be allocated). In this case, the callback should just return. The
  *      cleaner will note the failure, allocate more memory, and try again.
+ * \param type
+ *      Type of the entry being relocated: LOG_ENTRY_TYPE_OBJ,
+ *      LOG_ENTRY_TYPE_OBJMANIFEST, or LOG_ENTRY_TYPE_OBJCHUNK.
  */
 void
 ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
-                LogEntryRelocator& relocator)
+                LogEntryRelocator& relocator, LogEntryType type)
 {
-    Key key(LOG_ENTRY_TYPE_OBJ, oldBuffer);
+    Key key(type, oldBuffer);
     HashTableBucketLock lock(*this, key);
 
     // Note that we do not query the TabletManager to see if this object
@@ -2960,13 +3925,30 @@ ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
 
         // Try to relocate this live object. If we fail, just return. The
         // cleaner will allocate more memory and retry.
-        if (!relocator.append(LOG_ENTRY_TYPE_OBJ, oldBuffer))
+        if (!relocator.append(type, oldBuffer))
             return;
 
         candidates.setReference(relocator.getNewReference().toInteger());
         return;
     }
 
+    // Prior versions retained for snapshot reads must also be kept. If the
+    // version is discarded before its new reference is recorded, the copy
+    // is simply dead and will be dropped the next time it is cleaned.
+    if (type == LOG_ENTRY_TYPE_OBJ && history.isRetained(key, oldReference)) {
+        if (!relocator.append(type, oldBuffer))
+            return;
+        history.updateReference(key, oldReference,
+                                relocator.getNewReference());
+        return;
+    }
+
+    // Chunks are removed from the stats as soon as they are freed (a
+    // failed write's chunks may fill whole segments, which the cleaner can
+    // discard without looking at them).
+    if (type == LOG_ENTRY_TYPE_OBJCHUNK)
+        return;
+
     // No reference was found meaning object will be cleaned.  We should update
     // the stats accordingly.
     TableStats::decrement(masterTableMetadata,
@@ -3053,6 +4035,103 @@ ObjectManager::relocateRpcResult(Buffer& oldBuffer,
     }
 }
 
+/**
+ * Method used by the LogCleaner when it's cleaning a Segment and comes across
+ * an object stored together with its RpcResult.
+ *
+ * The object and the RpcResult die independently: the object when it is
+ * overwritten or removed, and the RpcResult when the client acknowledges the
+ * RPC. Only the parts that are still alive are relocated, so a combined entry
+ * may turn into a plain object or a plain RpcResult.
+ *
+ * \param oldBuffer
+ *      Buffer pointing to the entry's current location, which will soon be
+ *      invalidated.
+ * \param oldReference
+ *      Reference to the old entry in the log. The hash table points to this
+ *      iff the object is alive.
+ * \param relocator
+ *      The relocator may be used to store the live parts of the entry in a
+ *      new location. If relocation fails, the callback just returns; the
+ *      cleaner will allocate more memory and retry.
+ */
+void
+ObjectManager::relocateObjectRpcResult(Buffer& oldBuffer,
+        Log::Reference oldReference, LogEntryRelocator& relocator)
+{
+    uint32_t objectLength = RpcResult::objectLengthInCombinedEntry(oldBuffer);
+    uint32_t rpcResultLength = RpcResult::lengthInCombinedEntry(oldBuffer);
+    RpcResult rpcResult(oldBuffer, objectLength, rpcResultLength);
+    Buffer objectBuffer;
+    objectBuffer.appendExternal(&oldBuffer, 0, objectLength);
+    Key key(LOG_ENTRY_TYPE_OBJ, objectBuffer);
+
+    bool keepRpcResult = !unackedRpcResults->isRpcAcked(
+            rpcResult.getLeaseId(), rpcResult.getRpcId());
+
+    HashTableBucketLock lock(*this, key);
+    HashTable::Candidates candidates;
+    objectMap.lookup(key.getHash(), candidates);
+    while (!candidates.isDone() &&
+           candidates.getReference() != oldReference.toInteger()) {
+        candidates.next();
+    }
+    bool inHashTable = !candidates.isDone();
+    bool keepObject = inHashTable || history.isRetained(key, oldReference);
+
+    Buffer rpcResultBuffer;
+    bool relocated;
+    if (keepObject && keepRpcResult) {
+        relocated = relocator.append(LOG_ENTRY_TYPE_OBJRPCRESULT, oldBuffer);
+    } else if (keepObject) {
+        relocated = relocator.append(LOG_ENTRY_TYPE_OBJ, objectBuffer);
+    } else if (keepRpcResult) {
+        rpcResultBuffer.appendExternal(&oldBuffer, objectLength,
+                                       rpcResultLength);
+        relocated = relocator.append(LOG_ENTRY_TYPE_RPCRESULT,
+                                     rpcResultBuffer);
+    } else {
+        TableStats::decrement(masterTableMetadata,
+                              key.getTableId(),
+                              oldBuffer.size(),
+                              1);
+        return;
+    }
+
+    // If relocation failed, just return. The cleaner will allocate more
+    // memory and retry.
+    if (!relocated)
+        return;
+
+    uint64_t newReference = relocator.getNewReference().toInteger();
+    if (inHashTable) {
+        candidates.setReference(newReference);
+    } else if (keepObject) {
+        history.updateReference(key, oldReference,
+                                relocator.getNewReference());
+    }
+    if (keepRpcResult) {
+        unackedRpcResults->recordCompletion(
+                rpcResult.getLeaseId(),
+                rpcResult.getRpcId(),
+                reinterpret_cast<void*>(newReference),
+                true);
+    }
+
+    // Account for the part that was dropped, if any.
+    uint32_t keptBytes = 0;
+    if (keepObject)
+        keptBytes += objectLength;
+    if (keepRpcResult)
+        keptBytes += rpcResultLength;
+    if (!keepObject || !keepRpcResult) {
+        TableStats::decrement(masterTableMetadata,
+                              key.getTableId(),
+                              oldBuffer.size() - keptBytes,
+                              0);
+    }
+}
+
 /**
  * Method used by the LogCleaner when it's cleaning a Segment and comes across
  * an PreparedOp.
@@ -3287,6 +4366,10 @@ ObjectManager::replace(HashTableBucketLock& lock, Key& key,
         Buffer buffer;
         Log::Reference candidateRef(candidates.getReference());
         LogEntryType type = log.getEntry(candidateRef, buffer);
+        if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            candidates.next();
+            continue;
+        }
         Key candidateKey(type, buffer);
         if (key == candidateKey) {
             candidates.setReference(reference.toInteger());
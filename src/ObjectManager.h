@@ -38,6 +38,7 @@
 #include "MasterTableMetadata.h"
 #include "UnackedRpcResults.h"
 #include "LockTable.h"
+#include "ObjectHistory.h"
 
 namespace RAMCloud {
 
@@ -64,9 +65,18 @@ class ObjectManager : public LogEntryHandlers,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager);
+                TxRecoveryManager* txRecoveryManager,
+                ClusterClock* clusterClock = NULL);
     virtual ~ObjectManager();
+    Status bulkLoad(uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, void* segment, uint32_t length,
+                const SegmentCertificate& certificate, uint32_t* objectCount);
     virtual void freeLogEntry(Log::Reference ref);
+    uint64_t forEachTabletEntry(uint64_t bucket, uint64_t tableId,
+                uint64_t firstKeyHash, uint64_t lastKeyHash,
+                void (*callback)(LogEntryType, Buffer&, Log::Reference,
+                void*),
+                void* cookie);
     void initOnceEnlisted();
 
     void readHashes(const uint64_t tableId, uint32_t reqNumHashes,
@@ -76,7 +86,12 @@ class ObjectManager : public LogEntryHandlers,
     void prefetchHashTableBucket(SegmentIterator* it);
     Status readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
-                bool valueOnly = false);
+                bool valueOnly = false, bool* degraded = NULL);
+    Status readSnapshot(Key& key, ClusterTime snapshotTime,
+                Buffer* outBuffer, uint64_t* outVersion);
+    void forgetHistory();
+    static bool appendChunkedValue(Log& log, HashTable& objectMap, Key& key,
+                Object& manifestObject, Buffer* outBuffer);
     Status removeObject(Key& key, RejectRules* rejectRules,
                 uint64_t* outVersion, Buffer* removedObjBuffer = NULL,
                 RpcResult* rpcResult = NULL, uint64_t* rpcResultPtr = NULL);
@@ -100,9 +115,11 @@ class ObjectManager : public LogEntryHandlers,
     Status writeTxDecisionRecord(TxDecisionRecord& record);
     Status commitRead(PreparedOp& op, Log::Reference& refToPreparedOp);
     Status commitRemove(PreparedOp& op, Log::Reference& refToPreparedOp,
-                        Buffer* removedObjBuffer = NULL);
+                        Buffer* removedObjBuffer = NULL,
+                        ClusterTime commitTime = ClusterTime());
     Status commitWrite(PreparedOp& op, Log::Reference& refToPreparedOp,
-                        Buffer* removedObjBuffer = NULL);
+                        Buffer* removedObjBuffer = NULL,
+                        ClusterTime commitTime = ClusterTime());
 
     /**
      * The following three methods are used when multiple log entries
@@ -154,6 +171,12 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneProtector);
     };
 
+#ifdef TESTING
+    /// If true, the log append that commits a write in writeObject fails
+    /// as if the log were out of memory. Used in unit tests.
+    static bool mockWriteAppendFailure;
+#endif
+
   PRIVATE:
     /**
      * An instance of this class locks the bucket of the hash table that a given
@@ -248,6 +271,28 @@ class ObjectManager : public LogEntryHandlers,
         ObjectManager::HashTableBucketLock* lock;
     };
 
+    /**
+     * Struct used to pass parameters into the visitIfInTablet method through
+     * the generic HashTable::forEachInBucket method.
+     */
+    struct TabletEntryParameters {
+        /// Pointer to the ObjectManager class owning the hash table.
+        ObjectManager* objectManager;
+
+        /// Only entries in this table, with key hashes in the range
+        /// [firstKeyHash, lastKeyHash], are passed to the callback.
+        uint64_t tableId;
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+
+        /// Caller's function and its argument.
+        void (*callback)(LogEntryType, Buffer&, Log::Reference, void*);
+        void* cookie;
+
+        /// Number of times the callback was invoked.
+        uint64_t count;
+    };
+
     /**
      * This object executes in the background (as a WorkerTimer) to remove
      * tombstones that were added to the objectMap by replaySegment().
@@ -274,9 +319,12 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneRemover);
     };
 
+    void appendRecoveredRpcResult(SideLog* sideLog, RpcResult& rpcResult,
+                Buffer& buffer, uint64_t* appendTicks);
     static string dumpSegment(Segment* segment);
     uint32_t getObjectTimestamp(Buffer& buffer);
     uint32_t getTombstoneTimestamp(Buffer& buffer);
+    uint32_t getObjectChunkTimestamp(Buffer& buffer);
     uint32_t getTxDecisionRecordTimestamp(Buffer& buffer);
     bool lookup(HashTableBucketLock& lock, Key& key,
                 LogEntryType& outType, Buffer& buffer,
@@ -284,14 +332,24 @@ class ObjectManager : public LogEntryHandlers,
                 Log::Reference* outReference = NULL,
                 HashTable::Candidates* outCandidates = NULL);
     friend void recoveryCleanup(uint64_t maybeTomb, void *cookie);
+    void freeChunks(HashTableBucketLock& lock, Key& key);
+    void freeUncommittedChunks(Key& key,
+                std::vector<Log::Reference>& chunkReferences);
     bool remove(HashTableBucketLock& lock, Key& key);
+    void removeIfStaleChunk(HashTableBucketLock& lock, Key& key,
+                Log::Reference reference, Buffer& buffer);
     static void removeIfOrphanedObject(uint64_t reference, void *cookie);
     static void removeIfTombstone(uint64_t maybeTomb, void *cookie);
+    static void visitIfInTablet(uint64_t reference, void *cookie);
+    static bool isWellFormedObject(const void* entry, uint32_t length);
     void removeTombstones();
     Status rejectOperation(const RejectRules* rejectRules, uint64_t version)
                 __attribute__((warn_unused_result));
     void relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
-                LogEntryRelocator& relocator);
+                LogEntryRelocator& relocator,
+                LogEntryType type = LOG_ENTRY_TYPE_OBJ);
+    void relocateObjectRpcResult(Buffer& oldBuffer,
+                Log::Reference oldReference, LogEntryRelocator& relocator);
     void relocatePreparedOp(Buffer& oldBuffer, Log::Reference oldReference,
                 LogEntryRelocator& relocator);
     void relocatePreparedOpTombstone(Buffer& oldBuffer,
@@ -302,6 +360,9 @@ class ObjectManager : public LogEntryHandlers,
     void relocateTxDecisionRecord(
             Buffer& oldBuffer, LogEntryRelocator& relocator);
     bool replace(HashTableBucketLock& lock, Key& key, Log::Reference reference);
+    void writeObjectChunks(Key& key, Object& newObject,
+                Buffer& manifestKeysAndValue,
+                std::vector<Log::Reference>& chunkReferences);
 
     /**
      * Shared RAMCloud information.
@@ -399,6 +460,12 @@ class ObjectManager : public LogEntryHandlers,
      */
     LockTable lockTable;
 
+    /**
+     * Retains the versions of objects that have been overwritten or removed
+     * for a while, so that snapshot reads can be served (see readSnapshot).
+     */
+    ObjectHistory history;
+
     /**
      * Protects access to tombstoneRemover and tombstoneProtectorCount.
      */
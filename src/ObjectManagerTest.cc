@@ -355,6 +355,31 @@ class ObjectManagerTest : public ::testing::Test,
     }
 
 
+    /**
+     * Write an object linearizably on behalf of client 1, as MasterService
+     * does, and return the Log::Reference of its RpcResult.
+     */
+    Log::Reference
+    writeLinearizable(Key& key, string value, uint64_t rpcId, uint64_t ackId)
+    {
+        WireFormat::ClientLease clientLease = {1, 0, 0};
+        void* result;
+        unackedRpcResults.checkDuplicate(clientLease, rpcId, ackId, &result);
+
+        Buffer dataBuffer;
+        Object o(key, value.c_str(), downCast<uint32_t>(value.size()),
+                 0, 0, dataBuffer);
+        Buffer respBuffer;
+        RpcResult rpcResult(key.getTableId(), key.getHash(),
+                            clientLease.leaseId, rpcId, ackId, respBuffer);
+        uint64_t rpcResultPtr;
+        objectManager.writeObject(o, NULL, NULL, NULL,
+                                  &rpcResult, &rpcResultPtr);
+        unackedRpcResults.recordCompletion(clientLease.leaseId, rpcId,
+                reinterpret_cast<void*>(rpcResultPtr));
+        return Log::Reference(rpcResultPtr);
+    }
+
     /**
      * Store a PreparedOp in the log, return its Log::Reference.  Used only
      * to help acquire transaction locks.  TableStats not updated.
@@ -620,6 +645,31 @@ antiGetEntryFilter(string s)
     return s != "getEntry";
 }
 
+TEST_F(ObjectManagerTest, readSnapshot) {
+    Buffer buffer;
+    Key key(1, "1", 1);
+    storeObject(key, "hi", 93);
+    uint64_t version;
+
+    // no tablet, no dice
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET, objectManager.readSnapshot(key,
+            ClusterTime(10), &buffer, &version));
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+
+    // key locked, STATUS_RETRY.
+    Log::Reference lockRef = storePreparedOp(key);
+    EXPECT_TRUE(objectManager.lockTable.tryAcquireLock(key, lockRef));
+    EXPECT_EQ(STATUS_RETRY, objectManager.readSnapshot(key,
+            ClusterTime(10), &buffer, &version));
+    EXPECT_TRUE(objectManager.lockTable.releaseLock(key, lockRef));
+
+    // No versions are retained unless configured (see ObjectHistoryTest).
+    EXPECT_FALSE(objectManager.history.isEnabled());
+    EXPECT_EQ(STATUS_SNAPSHOT_TOO_OLD, objectManager.readSnapshot(key,
+            ClusterTime(10), &buffer, &version));
+    EXPECT_EQ(0u, buffer.size());
+}
+
 TEST_F(ObjectManagerTest, removeObject) {
     Key key(1, "1", 1);
     storeObject(key, "hi", 93);
@@ -1287,8 +1337,9 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
     uint64_t deadRpcId = 3;
 
     UnackedRpcResults *unackedRpcResults = objectManager.unackedRpcResults;
-    EXPECT_EQ(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
+    UnackedRpcResults::ClientMap& clients =
+            unackedRpcResults->shardFor(expectedLeaseId).clients;
+    EXPECT_EQ(clients.end(), clients.find(expectedLeaseId));
 
     {
         SegmentCertificate certificate;
@@ -1300,9 +1351,8 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(clients.end(), clients.find(expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->clientCount());
 
     // Test noop case.
 
@@ -1316,9 +1366,8 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(clients.end(), clients.find(expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->clientCount());
 }
 
 TEST_F(ObjectManagerTest, replaySegment_preparedOp_basics) {
@@ -1643,6 +1692,106 @@ TEST_F(ObjectManagerTest, writeObject) {
     objectManager.getLog()->totalLiveBytes = original;
 }
 
+TEST_F(ObjectManagerTest, writeObject_chunked) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    masterConfig.master.objectChunkSize = 4;
+    Key key(1, "1", 1);
+    Buffer buffer;
+    Object obj(key, "0123456789", 10, 0, 0, buffer);
+
+    TestLog::Enable _(writeObjectFilter);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    EXPECT_NE(string::npos, TestLog::get().find(
+            "chunked: 3 chunks of at most 4 bytes"));
+
+    Buffer value;
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, &version));
+    EXPECT_EQ(1UL, version);
+    EXPECT_EQ("0123456789", TestUtil::toString(&value));
+
+    // Overwriting with a small object stores it normally and frees the
+    // chunks of the old version.
+    Buffer buffer2;
+    Object obj2(key, "abc", 3, 0, 0, buffer2);
+    TestLog::reset();
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, 0, 0));
+    EXPECT_EQ(string::npos, TestLog::get().find("chunked"));
+
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, &version));
+    EXPECT_EQ(2UL, version);
+    EXPECT_EQ("abc", TestUtil::toString(&value));
+
+    HashTable::Candidates candidates;
+    objectManager.objectMap.lookup(key.getHash(), candidates);
+    int entries = 0;
+    for (; !candidates.isDone(); candidates.next())
+        entries++;
+    EXPECT_EQ(1, entries);
+}
+
+TEST_F(ObjectManagerTest, writeObject_chunkedAppendFails) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "1", 1);
+    Buffer buffer;
+    Object obj(key, "0123456789", 10, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    string stats = verifyMetadata(1);
+
+    // The chunks are appended, but the manifest isn't.
+    masterConfig.master.objectChunkSize = 4;
+    Key key2(1, "2", 1);
+    Buffer buffer2;
+    Object obj2(key2, "0123456789", 10, 0, 0, buffer2);
+    ObjectManager::mockWriteAppendFailure = true;
+    EXPECT_THROW(objectManager.writeObject(obj2, 0, 0), RetryException);
+    ObjectManager::mockWriteAppendFailure = false;
+
+    EXPECT_EQ(stats, verifyMetadata(1));
+    HashTable::Candidates candidates;
+    objectManager.objectMap.lookup(key2.getHash(), candidates);
+    EXPECT_TRUE(candidates.isDone());
+}
+
+TEST_F(ObjectManagerTest, writeObject_combinedRpcResult) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "1", 1);
+
+    TestLog::Enable _(writeObjectFilter);
+    Log::Reference rpcResultRef = writeLinearizable(key, "value", 10, 1);
+    EXPECT_EQ("writeObject: object: 33 bytes, version 1 | "
+              "writeObject: rpcResult: 44 bytes, combined with object",
+              TestLog::get());
+
+    // The RpcResult shares the object's entry.
+    Log::Reference objectRef;
+    EXPECT_TRUE(lookup(key, &objectRef));
+    EXPECT_EQ(objectRef.toInteger(), rpcResultRef.toInteger());
+    EXPECT_EQ("found=true tableId=1 byteCount=79 recordCount=1",
+              verifyMetadata(1));
+
+    Buffer buffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJRPCRESULT,
+              objectManager.log.getRawEntry(objectRef, buffer));
+    EXPECT_EQ(79U, buffer.size());
+    buffer.reset();
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ,
+              objectManager.log.getEntry(objectRef, buffer));
+    EXPECT_EQ(33U, buffer.size());
+    Object object(buffer);
+    EXPECT_EQ("value", string(reinterpret_cast<const char*>(
+              object.getValue()), object.getValueLength()));
+
+    buffer.reset();
+    objectManager.log.getRawEntry(objectRef, buffer);
+    RpcResult rpcResult(buffer,
+            RpcResult::objectLengthInCombinedEntry(buffer),
+            RpcResult::lengthInCombinedEntry(buffer));
+    EXPECT_EQ(1UL, rpcResult.getLeaseId());
+    EXPECT_EQ(10UL, rpcResult.getRpcId());
+}
+
 TEST_F(ObjectManagerTest, writeObject_returnRemovedObj) {
     tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
     Key key(1, "a", 1);
@@ -1977,6 +2126,217 @@ TEST_F(ObjectManagerTest, commitWrite) {
                             value.size()));
 }
 
+// Callback for forEachTabletEntry: records the key of each object.
+static void
+recordTabletEntry(LogEntryType type, Buffer& buffer,
+        Log::Reference reference, void* cookie)
+{
+    Key key(type, buffer);
+    string* keys = static_cast<string*>(cookie);
+    if (!keys->empty())
+        keys->append(" ");
+    keys->append(format("%lu:", key.getTableId()));
+    keys->append(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength());
+}
+
+// Packs objects into a segment the way BulkLoader does, and copies the
+// segment into segmentBuf (which must be at least 1000 bytes).
+static uint32_t
+buildBulkLoadSegment(char* segmentBuf, uint64_t tableId,
+        std::vector<const char*> keys, SegmentCertificate* certificate)
+{
+    Segment s;
+    foreach (const char* keyString, keys) {
+        Key key(tableId, keyString, downCast<KeyLength>(strlen(keyString)));
+        Buffer value;
+        Object obj(key, keyString, downCast<uint32_t>(strlen(keyString)),
+                0, 0, value);
+        Buffer entry;
+        obj.assembleForLog(entry);
+        EXPECT_TRUE(s.append(LOG_ENTRY_TYPE_OBJ, entry));
+    }
+    s.close();
+    Buffer buffer;
+    s.appendToBuffer(buffer);
+    EXPECT_GE(1000U, buffer.size());
+    buffer.copy(0, buffer.size(), segmentBuf);
+    s.getAppendedLength(certificate);
+    return buffer.size();
+}
+
+TEST_F(ObjectManagerTest, bulkLoad) {
+    Key keyA(0, "a", 1);
+    Buffer value;
+    Object old(keyA, "old", 3, 0, 0, value);
+    uint64_t oldVersion;
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(old, NULL, NULL));
+    objectManager.readObject(keyA, &value, NULL, &oldVersion);
+
+    char segment[1000];
+    SegmentCertificate certificate;
+    uint32_t length = buildBulkLoadSegment(segment, 0, {"a", "b", "c"},
+            &certificate);
+    uint32_t objectCount;
+    EXPECT_EQ(STATUS_OK, objectManager.bulkLoad(0, 0, ~0UL, segment, length,
+            certificate, &objectCount));
+    EXPECT_EQ(3U, objectCount);
+
+    // All objects get the same new version, which replaces the old "a".
+    const char* keys[] = {"a", "b", "c"};
+    uint64_t versions[3];
+    for (int i = 0; i < 3; i++) {
+        Key key(0, keys[i], 1);
+        value.reset();
+        EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, NULL,
+                &versions[i]));
+        EXPECT_EQ(keys[i], TestUtil::toString(&value));
+    }
+    EXPECT_LT(oldVersion, versions[0]);
+    EXPECT_EQ(versions[0], versions[1]);
+    EXPECT_EQ(versions[0], versions[2]);
+}
+
+TEST_F(ObjectManagerTest, bulkLoad_rejected) {
+    char segment[1000];
+    SegmentCertificate certificate;
+    uint32_t objectCount;
+    uint32_t length = buildBulkLoadSegment(segment, 0, {"a", "b"},
+            &certificate);
+
+    // Wrong table.
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, objectManager.bulkLoad(1, 0, ~0UL,
+            segment, length, certificate, &objectCount));
+
+    // Key hash outside the tablet.
+    Key keyB(0, "b", 1);
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET, objectManager.bulkLoad(0, 0,
+            keyB.getHash() - 1, segment, length, certificate, &objectCount));
+
+    // Corrupt segment.
+    certificate.checksum++;
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, objectManager.bulkLoad(0, 0, ~0UL,
+            segment, length, certificate, &objectCount));
+
+    // Nothing was added.
+    Key keyA(0, "a", 1);
+    Buffer value;
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            objectManager.readObject(keyA, &value, NULL, NULL));
+}
+
+TEST_F(ObjectManagerTest, bulkLoad_malformedObject) {
+    TestLog::Enable _;
+    Key key(0, "abc", 3);
+    Buffer buffer;
+    Object obj(key, "value", 5, 0, 0, buffer);
+    Buffer entry;
+    obj.assembleForLog(entry);
+    char object[100];
+    uint32_t objectLength = entry.size();
+    entry.copy(0, objectLength, object);
+
+    SegmentCertificate certificate;
+    uint32_t objectCount;
+    char segment[1000];
+    Buffer segmentBuffer;
+
+    // Entry too short to hold even the object header.
+    Segment truncated;
+    EXPECT_TRUE(truncated.append(LOG_ENTRY_TYPE_OBJ, object,
+            sizeof32(Object::Header) - 4));
+    truncated.close();
+    truncated.appendToBuffer(segmentBuffer);
+    segmentBuffer.copy(0, segmentBuffer.size(), segment);
+    truncated.getAppendedLength(&certificate);
+    TestLog::reset();
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, objectManager.bulkLoad(0, 0, ~0UL,
+            segment, segmentBuffer.size(), certificate, &objectCount));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "contains a malformed object"));
+
+    // Key length extends past the end of the entry.
+    Object::Header* header = reinterpret_cast<Object::Header*>(object);
+    KeyOffsets* keyOffsets = reinterpret_cast<KeyOffsets*>(
+            header->keysAndData);
+    keyOffsets->cumulativeLengths[0] = 1000;
+    Segment badKey;
+    EXPECT_TRUE(badKey.append(LOG_ENTRY_TYPE_OBJ, object, objectLength));
+    badKey.close();
+    segmentBuffer.reset();
+    badKey.appendToBuffer(segmentBuffer);
+    segmentBuffer.copy(0, segmentBuffer.size(), segment);
+    badKey.getAppendedLength(&certificate);
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, objectManager.bulkLoad(0, 0, ~0UL,
+            segment, segmentBuffer.size(), certificate, &objectCount));
+    EXPECT_EQ(0U, objectCount);
+}
+
+TEST_F(ObjectManagerTest, isWellFormedObject) {
+    Key key(0, "abc", 3);
+    Buffer buffer;
+    Object obj(key, "value", 5, 0, 0, buffer);
+    Buffer entry;
+    obj.assembleForLog(entry);
+    char object[100];
+    uint32_t length = entry.size();
+    entry.copy(0, length, object);
+    EXPECT_TRUE(ObjectManager::isWellFormedObject(object, length));
+
+    // Truncated in the header, in the key lengths, and in the key.
+    EXPECT_FALSE(ObjectManager::isWellFormedObject(object,
+            sizeof32(Object::Header)));
+    EXPECT_FALSE(ObjectManager::isWellFormedObject(object,
+            sizeof32(Object::Header) + KEY_INFO_LENGTH(1) - 1));
+    EXPECT_FALSE(ObjectManager::isWellFormedObject(object,
+            sizeof32(Object::Header) + KEY_INFO_LENGTH(1) + 2));
+
+    // Too many keys for the entry.
+    Object::Header* header = reinterpret_cast<Object::Header*>(object);
+    KeyOffsets* keyOffsets = reinterpret_cast<KeyOffsets*>(
+            header->keysAndData);
+    keyOffsets->numKeys = 255;
+    EXPECT_FALSE(ObjectManager::isWellFormedObject(object, length));
+
+    // No primary key.
+    keyOffsets->numKeys = 0;
+    EXPECT_FALSE(ObjectManager::isWellFormedObject(object, length));
+}
+
+TEST_F(ObjectManagerTest, forEachTabletEntry) {
+    tabletManager.addTablet(97, 0, ~0UL, TabletManager::NORMAL);
+    tabletManager.addTablet(98, 0, ~0UL, TabletManager::NORMAL);
+    const char* keys[] = {"a", "b", "c", "d", "e", "f"};
+    foreach (const char* keyString, keys) {
+        for (uint64_t tableId = 97; tableId <= 98; tableId++) {
+            Key key(tableId, keyString, 1);
+            Buffer value;
+            Object obj(key, "hi", 2, 0, 0, value);
+            EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+        }
+    }
+
+    // Only objects in the requested table and key hash range are found.
+    Key keyB(97, "b", 1);
+    string found;
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < objectManager.objectMap.getNumBuckets(); i++) {
+        count += objectManager.forEachTabletEntry(i, 97, keyB.getHash(),
+                keyB.getHash(), recordTabletEntry, &found);
+    }
+    EXPECT_EQ(1U, count);
+    EXPECT_EQ("97:b", found);
+
+    found.clear();
+    count = 0;
+    for (uint64_t i = 0; i < objectManager.objectMap.getNumBuckets(); i++) {
+        count += objectManager.forEachTabletEntry(i, 98, 0, ~0UL,
+                recordTabletEntry, &found);
+    }
+    EXPECT_EQ(6U, count);
+    EXPECT_EQ(string::npos, found.find("97:"));
+}
+
 TEST_F(ObjectManagerTest, flushEntriesToLog) {
 
     tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
@@ -2814,6 +3174,87 @@ TEST_F(ObjectManagerTest, relocateRpcResult_cleanRecord) {
     EXPECT_FALSE(relocator.didAppend);
 }
 
+TEST_F(ObjectManagerTest, relocateObjectRpcResult) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "1", 1);
+    Buffer buffer;
+    void* result;
+    WireFormat::ClientLease clientLease = {1, 0, 0};
+
+    // Both parts alive: the whole entry moves.
+    Log::Reference oldRef = writeLinearizable(key, "value", 10, 1);
+    LogEntryType type = objectManager.log.getRawEntry(oldRef, buffer);
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJRPCRESULT, type);
+    {
+        LogEntryRelocator relocator(
+            objectManager.segmentManager.getHeadSegment(), 1000);
+        objectManager.relocate(type, buffer, oldRef, relocator);
+        EXPECT_TRUE(relocator.didAppend);
+        Log::Reference newRef = relocator.getNewReference();
+        Log::Reference objectRef;
+        EXPECT_TRUE(lookup(key, &objectRef));
+        EXPECT_EQ(newRef.toInteger(), objectRef.toInteger());
+        unackedRpcResults.checkDuplicate(clientLease, 10, 1, &result);
+        EXPECT_EQ(newRef.toInteger(), reinterpret_cast<uint64_t>(result));
+        buffer.reset();
+        EXPECT_EQ(LOG_ENTRY_TYPE_OBJRPCRESULT,
+                  objectManager.log.getRawEntry(newRef, buffer));
+        oldRef = newRef;
+    }
+
+    // Object overwritten, rpc not yet acked: only the RpcResult moves.
+    Log::Reference secondRef = writeLinearizable(key, "value2", 11, 1);
+    {
+        LogEntryRelocator relocator(
+            objectManager.segmentManager.getHeadSegment(), 1000);
+        objectManager.relocate(type, buffer, oldRef, relocator);
+        EXPECT_TRUE(relocator.didAppend);
+        Log::Reference newRef = relocator.getNewReference();
+        unackedRpcResults.checkDuplicate(clientLease, 10, 1, &result);
+        EXPECT_EQ(newRef.toInteger(), reinterpret_cast<uint64_t>(result));
+        Buffer newBuffer;
+        EXPECT_EQ(LOG_ENTRY_TYPE_RPCRESULT,
+                  objectManager.log.getEntry(newRef, newBuffer));
+        RpcResult rpcResult(newBuffer);
+        EXPECT_EQ(10UL, rpcResult.getRpcId());
+    }
+
+    // Rpc acked, object alive: only the object moves.
+    Key otherKey(1, "2", 1);
+    writeLinearizable(otherKey, "other", 12, 11);
+    EXPECT_TRUE(unackedRpcResults.isRpcAcked(1, 11));
+    buffer.reset();
+    type = objectManager.log.getRawEntry(secondRef, buffer);
+    {
+        LogEntryRelocator relocator(
+            objectManager.segmentManager.getHeadSegment(), 1000);
+        objectManager.relocate(type, buffer, secondRef, relocator);
+        EXPECT_TRUE(relocator.didAppend);
+        Log::Reference newRef = relocator.getNewReference();
+        Log::Reference objectRef;
+        EXPECT_TRUE(lookup(key, &objectRef));
+        EXPECT_EQ(newRef.toInteger(), objectRef.toInteger());
+        Buffer newBuffer;
+        EXPECT_EQ(LOG_ENTRY_TYPE_OBJ,
+                  objectManager.log.getRawEntry(newRef, newBuffer));
+        EXPECT_EQ(buffer.size() - 2 -
+                  RpcResult::lengthInCombinedEntry(buffer),
+                  newBuffer.size());
+    }
+
+    // Both parts dead: nothing moves.
+    Log::Reference thirdRef = writeLinearizable(key, "value3", 13, 12);
+    writeLinearizable(key, "value4", 14, 13);
+    buffer.reset();
+    type = objectManager.log.getRawEntry(thirdRef, buffer);
+    {
+        LogEntryRelocator relocator(
+            objectManager.segmentManager.getHeadSegment(), 1000);
+        objectManager.relocate(type, buffer, thirdRef, relocator);
+        EXPECT_FALSE(relocator.didAppend);
+    }
+}
+
 static bool
 segmentExists(string s)
 {
@@ -50,6 +50,7 @@ ObjectRpcWrapper::ObjectRpcWrapper(Context* context, uint64_t tableId,
     , context(context)
     , tableId(tableId)
     , keyHash(Key::getHash(tableId, key, keyLength))
+    , allowDegraded(false)
 {
 }
 
@@ -79,6 +80,7 @@ ObjectRpcWrapper::ObjectRpcWrapper(Context* context, uint64_t tableId,
     , context(context)
     , tableId(tableId)
     , keyHash(keyHash)
+    , allowDegraded(false)
 {
 }
 
@@ -119,7 +121,12 @@ void
 ObjectRpcWrapper::send()
 {
     try {
-        session = context->objectFinder->tryLookup(tableId, keyHash);
+        if (allowDegraded) {
+            session = context->objectFinder->tryLookupDegraded(tableId,
+                    keyHash);
+        } else {
+            session = context->objectFinder->tryLookup(tableId, keyHash);
+        }
         if (session) {
             state = IN_PROGRESS;
             session->sendRequest(&request, response, this);
@@ -57,6 +57,12 @@ class ObjectRpcWrapper : public RpcWrapper {
     uint64_t tableId;
     uint64_t keyHash;
 
+    /// True means the request may be sent to a recovery master if the
+    /// object's tablet is being recovered (see
+    /// ObjectFinder::tryLookupDegraded); false means wait until the tablet
+    /// has been recovered.
+    bool allowDegraded;
+
     DISALLOW_COPY_AND_ASSIGN(ObjectRpcWrapper);
 };
 
@@ -167,6 +167,7 @@ OptionParser::setup(int argc, char* argv[])
         vector<string> logLevels;
         string configFile(".ramcloud");
         bool debugOnSegfault = false;
+        bool deferLogFormatting = false;
 
         // Basic options supported on the command line of all apps
         OptionsDescription commonOptions("Common");
@@ -191,6 +192,11 @@ OptionParser::setup(int argc, char* argv[])
              po::value<vector<string> >(&logLevels),
              "One or more module-specific log levels, specified in the form "
              "moduleName=level")
+            ("deferLogFormatting",
+             ProgramOptions::bool_switch(&deferLogFormatting),
+             "Format log messages in the logger's print thread rather than "
+             "in the threads that log them, which only copy their arguments "
+             "(see Logger::setDeferredFormatting)")
             ("coordinator,C",
              po::value<string>(&options.coordinatorLocator)->
                default_value("fast+udp:host=0.0.0.0,port=12246"),
@@ -309,6 +315,7 @@ OptionParser::setup(int argc, char* argv[])
             Perf::setNameAndPath(serverName, logPath);
         }
         Logger::get().setLogLevels(defaultLogLevel);
+        Logger::get().setDeferredFormatting(deferLogFormatting);
         foreach (auto moduleLevel, logLevels) {
             auto pos = moduleLevel.find("=");
             if (pos == string::npos) {
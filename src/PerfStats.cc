@@ -115,6 +115,10 @@ PerfStats::collectStats(PerfStats* total)
         total->backupWriteActiveCycles += stats->backupWriteActiveCycles;
         total->migrationPhase1Bytes += stats->migrationPhase1Bytes;
         total->migrationPhase1Cycles += stats->migrationPhase1Cycles;
+        total->txLockConflicts += stats->txLockConflicts;
+        total->txLockWaits += stats->txLockWaits;
+        total->txLockAborts += stats->txLockAborts;
+        total->txLockWaitCycles += stats->txLockWaitCycles;
         total->networkInputBytes += stats->networkInputBytes;
         total->networkOutputBytes += stats->networkOutputBytes;
         total->temp1 += stats->temp1;
@@ -307,6 +311,20 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
             formatMetricRatio(&diff, "migrationPhase1Cycles",
             "collectionTime", " %8.3f").c_str()));
 
+    result.append("\nTransaction locks:\n");
+    result.append(format("%-30s %s\n", "  Lock conflicts/second (K)",
+            formatMetricRate(&diff, "txLockConflicts",
+            " %8.2f", 1e-3).c_str()));
+    result.append(format("%-30s %s\n", "  Waits per conflict",
+            formatMetricRatio(&diff, "txLockWaits", "txLockConflicts",
+            " %8.2f").c_str()));
+    result.append(format("%-30s %s\n", "  Aborts per conflict",
+            formatMetricRatio(&diff, "txLockAborts", "txLockConflicts",
+            " %8.2f").c_str()));
+    result.append(format("%-30s %s\n", "  Lock wait load factor",
+            formatMetricRatio(&diff, "txLockWaitCycles",
+            "collectionTime", " %8.3f").c_str()));
+
     result.append("\nNetwork:\n");
     result.append(format("%-30s %s\n", "  Input bytes (MB/s)",
             formatMetricRate(&diff, "networkInputBytes",
@@ -399,6 +417,10 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(backupWriteActiveCycles);
         ADD_METRIC(migrationPhase1Bytes);
         ADD_METRIC(migrationPhase1Cycles);
+        ADD_METRIC(txLockConflicts);
+        ADD_METRIC(txLockWaits);
+        ADD_METRIC(txLockAborts);
+        ADD_METRIC(txLockWaitCycles);
         ADD_METRIC(networkInputBytes);
         ADD_METRIC(networkOutputBytes);
         ADD_METRIC(temp1);
@@ -218,6 +218,26 @@ struct PerfStats {
     /// side to complete replay during Phase 1.
     uint64_t migrationPhase1Cycles;
 
+    //--------------------------------------------------------------------
+    // Statistics for transaction locks follow below.
+    //--------------------------------------------------------------------
+
+    /// Number of transaction prepares that found the object already locked
+    /// (or other prepares waiting for its lock).
+    uint64_t txLockConflicts;
+
+    /// Number of times a conflicting prepare was asked to retry while
+    /// keeping its place in the object's wait queue.
+    uint64_t txLockWaits;
+
+    /// Number of conflicting prepares that voted to abort, either right
+    /// away or after waiting too long.
+    uint64_t txLockAborts;
+
+    /// Total time (in cycles) that prepares which eventually acquired a
+    /// lock spent waiting for it.
+    uint64_t txLockWaitCycles;
+
     //--------------------------------------------------------------------
     // Statistics for the network follow below.
     //--------------------------------------------------------------------
@@ -0,0 +1,229 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "PerfStatsSampler.h"
+#include "Cycles.h"
+#include "Fence.h"
+#include "MasterService.h"
+#include "ShortMacros.h"
+#include "Transport.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a PerfStatsSampler. No samples are taken until start is called.
+ *
+ * \param context
+ *      Overall information about the server.
+ * \param intervalMs
+ *      Time between samples, in milliseconds (must be nonzero).
+ * \param maxSamples
+ *      Number of samples retained; once this many have been taken, each
+ *      new sample replaces the oldest one.
+ */
+PerfStatsSampler::PerfStatsSampler(Context* context, uint32_t intervalMs,
+        uint32_t maxSamples)
+    : context(context)
+    , intervalMs(intervalMs)
+    , mutex("PerfStatsSampler::mutex")
+    , ring(std::max(maxSamples, 1u))
+    , nextSequence(0)
+    , thread()
+    , threadShouldExit(false)
+{
+    assert(intervalMs > 0);
+}
+
+/**
+ * Destructor for PerfStatsSampler; stops the sampler thread.
+ */
+PerfStatsSampler::~PerfStatsSampler()
+{
+    halt();
+}
+
+/**
+ * Append the most recent samples to a buffer, in the format returned by
+ * the GET_PERF_STATS_HISTORY server control: a HistoryHeader followed by
+ * the samples, oldest first.
+ *
+ * \param maxSamples
+ *      Return at most this many samples (the newest ones). 0 means return
+ *      all of the samples retained, subject to the limit on RPC size.
+ * \param output
+ *      The header and samples are appended here.
+ * \param serverCount
+ *      Number of servers whose histories may be combined into a single
+ *      response (by serverControlAll); each gets an equal share of the
+ *      limit on RPC size, so that the combined response fits.
+ */
+void
+PerfStatsSampler::appendHistory(uint32_t maxSamples, Buffer* output,
+        uint32_t serverCount)
+{
+    // Leave room for the ServerControlAll header, and for each server's
+    // ServerControl and history headers.
+    uint32_t share = (Transport::MAX_RPC_LEN - 1000) /
+            std::max(serverCount, 1u);
+    uint32_t overhead = sizeof32(WireFormat::ServerControl::Response) +
+            sizeof32(HistoryHeader);
+    uint32_t limit = (share > overhead)
+            ? (share - overhead) / sizeof32(PerfStats) : 0;
+    if ((maxSamples == 0) || (maxSamples > limit))
+        maxSamples = limit;
+
+    SpinLock::Guard _(mutex);
+    uint64_t available = std::min(nextSequence,
+            static_cast<uint64_t>(ring.size()));
+    uint32_t count = downCast<uint32_t>(std::min(available,
+            static_cast<uint64_t>(maxSamples)));
+    HistoryHeader* header = output->emplaceAppend<HistoryHeader>();
+    header->firstSequence = nextSequence - count;
+    header->sampleCount = count;
+    header->sampleLength = sizeof32(PerfStats);
+    for (uint64_t i = header->firstSequence; i < nextSequence; i++) {
+        output->appendCopy(&ring[i % ring.size()]);
+    }
+}
+
+/**
+ * Stop the sampler thread, if it is running. Once this method returns the
+ * thread has exited.
+ */
+void
+PerfStatsSampler::halt()
+{
+    if (thread) {
+        threadShouldExit = true;
+        Fence::sfence();
+        thread->join();
+        threadShouldExit = false;
+        thread.destroy();
+    }
+}
+
+/**
+ * Extract the samples from the result of a GET_PERF_STATS_HISTORY
+ * server control sent to all servers.
+ *
+ * \param rawData
+ *      Response buffer from a call to RamCloud::serverControlAll.
+ * \param[out] results
+ *      Filled in with one entry for each server that responded.
+ */
+void
+PerfStatsSampler::parseClusterHistory(Buffer* rawData,
+        std::vector<History>* results)
+{
+    results->clear();
+    uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
+    while (offset < rawData->size()) {
+        WireFormat::ServerControl::Response* header =
+                rawData->getOffset<WireFormat::ServerControl::Response>(offset);
+        if (header == NULL)
+            break;
+        offset += sizeof32(*header);
+        uint32_t end = offset + header->outputLength;
+        HistoryHeader* history = rawData->getOffset<HistoryHeader>(offset);
+        if ((history == NULL) || (end > rawData->size()))
+            break;
+        offset += sizeof32(*history);
+
+        results->emplace_back();
+        History& result = results->back();
+        result.serverId = header->serverId;
+        result.firstSequence = history->firstSequence;
+        result.samples.resize(history->sampleCount);
+        uint32_t length = std::min(history->sampleLength, sizeof32(PerfStats));
+        for (uint32_t i = 0; i < history->sampleCount; i++) {
+            if (offset + history->sampleLength > end) {
+                result.samples.resize(i);
+                break;
+            }
+            memset(&result.samples[i], 0, sizeof(PerfStats));
+            rawData->copy(offset, length, &result.samples[i]);
+            offset += history->sampleLength;
+        }
+        offset = end;
+    }
+}
+
+/**
+ * Record one sample of the server's current statistics. Normally invoked
+ * by the sampler thread.
+ */
+void
+PerfStatsSampler::sample()
+{
+    PerfStats stats;
+    PerfStats::collectStats(&stats);
+    MasterService* masterService = context->getMasterService();
+    if (masterService != NULL) {
+        masterService->objectManager.getLog()->getMemoryStats(&stats);
+    }
+
+    SpinLock::Guard _(mutex);
+    ring[nextSequence % ring.size()] = stats;
+    nextSequence++;
+}
+
+/**
+ * Start the sampler thread (if it isn't already running).
+ */
+void
+PerfStatsSampler::start()
+{
+    if (!thread)
+        thread.construct(samplerThreadEntry, this);
+}
+
+/**
+ * Main loop of the sampler thread: take a sample every intervalMs until
+ * asked to exit by halt().
+ *
+ * \param sampler
+ *      The PerfStatsSampler that owns the thread.
+ */
+void
+PerfStatsSampler::samplerThreadEntry(PerfStatsSampler* sampler)
+{
+    LOG(NOTICE, "PerfStats sampler started (interval %u ms, %lu samples)",
+            sampler->intervalMs, sampler->ring.size());
+    uint64_t intervalCycles = Cycles::fromNanoseconds(
+            1000000lu * sampler->intervalMs);
+    uint64_t nextSample = Cycles::rdtsc();
+    while (1) {
+        Fence::lfence();
+        if (sampler->threadShouldExit)
+            break;
+        sampler->sample();
+
+        // Sample on a fixed schedule rather than a fixed delay, so that
+        // the time taken to sample doesn't accumulate as drift. If we fell
+        // behind (e.g. the machine is overloaded), skip the missed samples.
+        nextSample += intervalCycles;
+        uint64_t now = Cycles::rdtsc();
+        if (nextSample <= now) {
+            nextSample = now;
+            continue;
+        }
+        useconds_t micros = downCast<useconds_t>(
+                Cycles::toMicroseconds(nextSample - now));
+        if (micros > 0)
+            usleep(micros);
+    }
+}
+
+} // namespace RAMCloud
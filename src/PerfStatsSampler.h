@@ -0,0 +1,127 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_PERFSTATSSAMPLER_H
+#define RAMCLOUD_PERFSTATSSAMPLER_H
+
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "PerfStats.h"
+#include "SpinLock.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+class Context;
+
+/**
+ * A PerfStatsSampler records a time series of a server's PerfStats. A
+ * dedicated thread aggregates the per-thread statistics (plus the log's
+ * memory statistics, on masters) at a fixed interval and stores each
+ * reading in a fixed-size ring, overwriting the oldest readings. Since
+ * the readings include dispatch and worker active cycles as well as the
+ * log, cleaner and replication counters, the differences between
+ * consecutive samples show utilization and background activity at the
+ * resolution of the sampling interval.
+ *
+ * The history is exported with the GET_PERF_STATS_HISTORY server control;
+ * see appendHistory for the format.
+ */
+class PerfStatsSampler {
+  PUBLIC:
+    /**
+     * The output of GET_PERF_STATS_HISTORY consists of this header
+     * followed by sampleCount samples (each sampleLength bytes), oldest
+     * first.
+     */
+    struct HistoryHeader {
+        /// Sequence number of the first sample in the response. Samples
+        /// are numbered from 0 in the order they were taken; a gap between
+        /// successive responses means samples were overwritten before they
+        /// were retrieved.
+        uint64_t firstSequence;
+
+        /// Number of samples following this header.
+        uint32_t sampleCount;
+
+        /// Size of each sample in bytes (sizeof(PerfStats) on the server).
+        uint32_t sampleLength;
+    } __attribute__((packed));
+
+    /**
+     * The samples from one server, as extracted by parseClusterHistory.
+     */
+    struct History {
+        History()
+            : serverId(0)
+            , firstSequence(0)
+            , samples()
+        {}
+
+        /// Server the samples came from.
+        uint64_t serverId;
+
+        /// Sequence number of samples[0].
+        uint64_t firstSequence;
+
+        /// Samples, oldest first.
+        std::vector<PerfStats> samples;
+    };
+
+    PerfStatsSampler(Context* context, uint32_t intervalMs,
+            uint32_t maxSamples);
+    ~PerfStatsSampler();
+    void appendHistory(uint32_t maxSamples, Buffer* output,
+            uint32_t serverCount = 1);
+    void halt();
+    static void parseClusterHistory(Buffer* rawData,
+            std::vector<History>* results);
+    void sample();
+    void start();
+
+  PRIVATE:
+    static void samplerThreadEntry(PerfStatsSampler* sampler);
+
+    /// Used to find the MasterService, whose log statistics are included
+    /// in each sample.
+    Context* context;
+
+    /// Time between samples, in milliseconds.
+    uint32_t intervalMs;
+
+    /// Protects #ring and #nextSequence.
+    SpinLock mutex;
+
+    /// Most recent samples; the sample with sequence number i is stored
+    /// at index i % ring.size().
+    std::vector<PerfStats> ring;
+
+    /// Sequence number to assign to the next sample.
+    uint64_t nextSequence;
+
+    /// Thread taking the samples; empty if not running.
+    Tub<std::thread> thread;
+
+    /// Set by halt() to ask the sampler thread to exit.
+    volatile bool threadShouldExit;
+
+    DISALLOW_COPY_AND_ASSIGN(PerfStatsSampler);
+};
+
+} // end RAMCloud
+
+#endif  /* RAMCLOUD_PERFSTATSSAMPLER_H */
@@ -0,0 +1,160 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "PerfStatsSampler.h"
+#include "ServerId.h"
+
+namespace RAMCloud {
+
+class PerfStatsSamplerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    PerfStatsSampler sampler;
+
+    PerfStatsSamplerTest()
+        : logEnabler()
+        , context()
+        , sampler(&context, 1, 3)
+    {
+        PerfStats::registerStats(&PerfStats::threadStats);
+    }
+
+    // Take samples whose readCounts are first, first+1, ... last.
+    void
+    takeSamples(uint64_t first, uint64_t last)
+    {
+        uint64_t saved = PerfStats::threadStats.readCount;
+        for (uint64_t i = first; i <= last; i++) {
+            PerfStats::threadStats.readCount = i;
+            sampler.sample();
+        }
+        PerfStats::threadStats.readCount = saved;
+    }
+
+    // Returns a string containing the sequence number and readCount
+    // values in a GET_PERF_STATS_HISTORY result.
+    string
+    describeHistory(Buffer* buffer)
+    {
+        PerfStatsSampler::HistoryHeader* header =
+                buffer->getStart<PerfStatsSampler::HistoryHeader>();
+        string result = format("first %lu:", header->firstSequence);
+        for (uint32_t i = 0; i < header->sampleCount; i++) {
+            PerfStats* stats = buffer->getOffset<PerfStats>(
+                    sizeof32(*header) + i*header->sampleLength);
+            result += format(" %lu", stats->readCount);
+        }
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(PerfStatsSamplerTest);
+};
+
+TEST_F(PerfStatsSamplerTest, appendHistory) {
+    Buffer buffer;
+    sampler.appendHistory(0, &buffer);
+    EXPECT_EQ("first 0:", describeHistory(&buffer));
+
+    takeSamples(100, 101);
+    buffer.reset();
+    sampler.appendHistory(0, &buffer);
+    EXPECT_EQ("first 0: 100 101", describeHistory(&buffer));
+
+    // The ring only holds 3 samples.
+    takeSamples(102, 104);
+    buffer.reset();
+    sampler.appendHistory(0, &buffer);
+    EXPECT_EQ("first 2: 102 103 104", describeHistory(&buffer));
+
+    buffer.reset();
+    sampler.appendHistory(2, &buffer);
+    EXPECT_EQ("first 3: 103 104", describeHistory(&buffer));
+
+    // So many servers that each can only return 2 samples.
+    uint32_t perServer = sizeof32(WireFormat::ServerControl::Response) +
+            sizeof32(PerfStatsSampler::HistoryHeader) +
+            2 * sizeof32(PerfStats);
+    buffer.reset();
+    sampler.appendHistory(0, &buffer,
+            (Transport::MAX_RPC_LEN - 1000) / perServer);
+    EXPECT_EQ("first 3: 103 104", describeHistory(&buffer));
+}
+
+TEST_F(PerfStatsSamplerTest, parseClusterHistory) {
+    takeSamples(100, 102);
+    Buffer buffer;
+    WireFormat::ServerControlAll::Response* header =
+            buffer.emplaceAppend<WireFormat::ServerControlAll::Response>();
+    header->common.status = STATUS_OK;
+    header->serverCount = 2;
+    header->respCount = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+        WireFormat::ServerControl::Response* subHead = buffer.
+                emplaceAppend<WireFormat::ServerControl::Response>();
+        subHead->common.status = STATUS_OK;
+        subHead->serverId = ServerId(i + 1, 0).getId();
+        uint32_t length = buffer.size();
+        sampler.appendHistory(3 - i, &buffer);
+        subHead->outputLength = buffer.size() - length;
+    }
+    header->totalRespLength = buffer.size() - sizeof32(*header);
+
+    std::vector<PerfStatsSampler::History> results;
+    PerfStatsSampler::parseClusterHistory(&buffer, &results);
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(ServerId(1, 0).getId(), results[0].serverId);
+    EXPECT_EQ(0u, results[0].firstSequence);
+    ASSERT_EQ(3u, results[0].samples.size());
+    EXPECT_EQ(100u, results[0].samples[0].readCount);
+    EXPECT_EQ(102u, results[0].samples[2].readCount);
+    EXPECT_EQ(ServerId(2, 0).getId(), results[1].serverId);
+    EXPECT_EQ(1u, results[1].firstSequence);
+    ASSERT_EQ(2u, results[1].samples.size());
+    EXPECT_EQ(101u, results[1].samples[0].readCount);
+
+    // Truncated response.
+    buffer.truncate(buffer.size() - 10);
+    PerfStatsSampler::parseClusterHistory(&buffer, &results);
+    EXPECT_EQ(1u, results.size());
+}
+
+TEST_F(PerfStatsSamplerTest, sample) {
+    takeSamples(7, 7);
+    EXPECT_EQ(1u, sampler.nextSequence);
+    EXPECT_EQ(7u, sampler.ring[0].readCount);
+    EXPECT_NE(0u, sampler.ring[0].collectionTime);
+}
+
+TEST_F(PerfStatsSamplerTest, startAndHalt) {
+    sampler.start();
+    EXPECT_TRUE(sampler.thread);
+
+    // See "Timing-Dependent Tests" in designNotes.
+    for (int i = 0; i < 1000; i++) {
+        if (sampler.nextSequence >= 2)
+            break;
+        usleep(1000);
+    }
+    EXPECT_LE(2u, sampler.nextSequence);
+    sampler.halt();
+    EXPECT_FALSE(sampler.thread);
+    uint64_t count = sampler.nextSequence;
+    usleep(5000);
+    EXPECT_EQ(count, sampler.nextSequence);
+}
+
+}  // namespace RAMCloud
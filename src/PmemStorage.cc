@@ -0,0 +1,682 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <emmintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "PmemStorage.h"
+#include "BackupMasterRecovery.h"
+#include "Buffer.h"
+#include "ClientException.h"
+#include "Crc32C.h"
+#include "CycleCounter.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+namespace {
+/**
+ * Image of a superblock as stored in the mapping: the superblock followed
+ * by a checksum over it.
+ */
+struct SuperblockContents {
+    SuperblockContents()
+        : superblock()
+        , checksum()
+    {}
+
+    BackupStorage::Superblock superblock;
+    Crc32C::ResultType checksum;
+} __attribute__((packed));
+}
+
+static_assert(sizeof(SuperblockContents) <= MultiFileStorage::BLOCK_SIZE,
+              "Superblock doesn't fit in its space in the mapping");
+
+// --- PmemStorage::Frame ---
+
+/**
+ * Create a Frame associated with a region of the mapping that may hold a
+ * replica. Only called when PmemStorage is constructed.
+ */
+PmemStorage::Frame::Frame(PmemStorage* storage, size_t frameIndex)
+    : storage(storage)
+    , frameIndex(frameIndex)
+    , data(storage->frameStart(frameIndex))
+    , metadata(data + storage->segmentSize)
+    , isOpen()
+    , isClosed()
+    , appendedToByCurrentProcess()
+    , loadRequested()
+    , ioMutex()
+{
+}
+
+/**
+ * Returns true if append has been called on this frame during the life of this
+ * process; returns false otherwise. This includes across free()/open() cycles.
+ * See MultiFileStorage::Frame::wasAppendedToByCurrentProcess().
+ */
+bool
+PmemStorage::Frame::wasAppendedToByCurrentProcess()
+{
+    return appendedToByCurrentProcess;
+}
+
+/**
+ * No-op for PmemStorage; the metadata is read directly from the mapping.
+ */
+void
+PmemStorage::Frame::loadMetadata()
+{
+}
+
+/**
+ * Return a pointer to the most recently appended metadata for this frame.
+ * Warning: Concurrent calls to append modify the metadata that the return
+ * of this method points to. In practice it should only be called when the
+ * frame isn't accepting appends (either it was just constructed or one of
+ * close, load, or free has already been called on it). Used only during
+ * backup restart and master recovery to extract details about the replica
+ * in this frame without loading the frame.
+ */
+const void*
+PmemStorage::Frame::getMetadata()
+{
+    return metadata;
+}
+
+/**
+ * Doesn't do much for PmemStorage, since replicas never need to be read
+ * into memory; prevents any further append() calls from being accepted.
+ */
+void
+PmemStorage::Frame::startLoading()
+{
+    Lock ioLock(ioMutex);
+    Lock lock(storage->mutex);
+    loadRequested = true;
+}
+
+/**
+ * Returns true if calling load() would not block, which is always the case
+ * for PmemStorage.
+ */
+bool
+PmemStorage::Frame::isLoaded()
+{
+    return true;
+}
+
+/**
+ * Return a pointer to the replica data for recovery. The pointer refers
+ * directly to the mapping, so this never blocks or performs IO; every
+ * append() was already durable when it returned. Prevents any further
+ * append() calls from being accepted.
+ */
+void*
+PmemStorage::Frame::load()
+{
+    startLoading();
+    return data;
+}
+
+/**
+ * Has no effect for PmemStorage.
+ */
+void
+PmemStorage::Frame::unload()
+{
+}
+
+/**
+ * Append data to frame and update metadata. The data is durable before
+ * the metadata is written, and both are durable when this returns.
+ * The storage-wide lock is only held while the request is checked; data
+ * is copied and persisted holding just this frame's #ioMutex, so appends
+ * to different frames proceed in parallel.
+ *
+ * Idempotence: the caller must guarantee duplicated calls provide identical
+ * arguments.
+ *
+ * append() after a load() or a close() throws an exception to
+ * the master performing the append since it is either an error by the master
+ * or the master has crashed.
+ *
+ * \param source
+ *      Buffer contained the data to be copied into the frame.
+ * \param sourceOffset
+ *      Offset into \a source where data should be copied from.
+ * \param length
+ *      Bytes to copy to the frame starting at \a sourceOffset in \a source.
+ * \param destinationOffset
+ *      Offset into the frame where the source data should be copied.
+ * \param metadata
+ *      Metadata which should be written to storage immediately after the data
+ *      appended is written. May be NULL if there is no updated metadata to
+ *      commit to storage along with this data.
+ * \param metadataLength
+ *      Bytes of metadata pointed to by \a metadata. Ignored if \a metadata
+ *      is NULL.
+ */
+void
+PmemStorage::Frame::append(Buffer& source,
+                           size_t sourceOffset,
+                           size_t length,
+                           size_t destinationOffset,
+                           const void* metadata,
+                           size_t metadataLength)
+{
+    Lock ioLock(ioMutex);
+    Lock lock(storage->mutex);
+    CycleCounter<uint64_t> ticks;
+    if (!isOpen) {
+        LOG(WARNING, "Tried to append to a frame but it wasn't "
+            "open on this backup; this can happen legitimately if a master's "
+            "rpc system retried a closing write rpc.");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    if (loadRequested) {
+        LOG(NOTICE, "Tried to append to a frame but it was already enqueued "
+            "for load for recovery; calling master is probably already dead");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    // Three conditions because overflow is possible on addition.
+    if (length > storage->segmentSize ||
+        destinationOffset > storage->segmentSize ||
+        length + destinationOffset > storage->segmentSize)
+    {
+        LOG(ERROR, "Out-of-bounds appended attempted on storage frame: "
+            "offset %lu, length %lu, segmentSize %lu ",
+            destinationOffset, length, storage->segmentSize);
+        throw BackupSegmentOverflowException(HERE);
+    }
+    if (metadataLength > METADATA_SIZE) {
+        LOG(ERROR, "Tried to append to a frame with metadata of length %lu "
+            "but storage only allows max length of %d",
+            metadataLength, METADATA_SIZE);
+        throw BackupSegmentOverflowException(HERE);
+    }
+
+    appendedToByCurrentProcess = true;
+    lock.unlock();
+
+    source.copy(downCast<uint32_t>(sourceOffset),
+                downCast<uint32_t>(length),
+                data + destinationOffset);
+    storage->persist(data + destinationOffset, length);
+
+    if (metadata) {
+        memcpy(this->metadata, metadata, metadataLength);
+        storage->persist(this->metadata, metadataLength);
+    }
+    ioLock.unlock();
+
+    storage->sleepToThrottleWrites(length + metadataLength, ticks.stop());
+}
+
+/**
+ * Mark this frame as closed. Calls to close after a call to load() throw
+ * BackupBadSegmentIdException which should kill the calling master; in this
+ * case recovery has already started for them so they are likely already dead.
+ */
+void
+PmemStorage::Frame::close()
+{
+    Lock ioLock(ioMutex);
+    Lock lock(storage->mutex);
+    if (isClosed)
+        return;
+    if (loadRequested) {
+        LOG(NOTICE, "Tried to close a frame but it was already enqueued "
+            "for load for recovery; calling master is probably already dead");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    isOpen = false;
+    isClosed = true;
+}
+
+// See BackupStorage.h for documentation.
+void
+PmemStorage::Frame::reopen(size_t length)
+{
+    // The replica's data is already in the mapping; just accept appends
+    // again.
+    Lock ioLock(ioMutex);
+    Lock _(storage->mutex);
+    isOpen = true;
+    isClosed = false;
+    loadRequested = false;
+}
+
+/**
+ * Do not call; see BackupStorage::freeFrame().
+ * Make this frame available for reuse; data previously stored in this frame
+ * may or may not be part of future recoveries. It does not modify storage,
+ * only in-memory bookkeeping structures, so a previously freed frame will not
+ * be free on restart until higher-level backup code explicitly free them after
+ * it determines it is not needed.
+ */
+void
+PmemStorage::Frame::free()
+{
+    Lock ioLock(ioMutex);
+    Lock lock(storage->mutex);
+    isOpen = false;
+    isClosed = false;
+    loadRequested = false;
+    storage->freeMap[frameIndex] = 1;
+}
+
+// - private -
+
+/**
+ * Open the frame, resetting its state to accept appends for a new replica.
+ * The metadata of any replica formerly stored in the frame is erased, so
+ * that getMetadata() doesn't return it; its data is left in place (and is
+ * useless without the metadata).
+ *
+ * Idempotence: Duplicate calls to open() are ignored until the frame is freed.
+ * Calling open() after the frame is freed will reset this frame for reuse
+ * with an new replica.
+ */
+void
+PmemStorage::Frame::open()
+{
+    Lock ioLock(ioMutex);
+    Lock lock(storage->mutex);
+    if (isOpen || isClosed)
+        return;
+    lock.unlock();
+
+    // Appends wait for ioMutex, so none can see the frame open before its
+    // old metadata has been erased.
+    memset(metadata, '\0', METADATA_SIZE);
+    storage->persist(metadata, METADATA_SIZE);
+
+    lock.lock();
+    isOpen = true;
+    isClosed = false;
+    loadRequested = false;
+}
+
+// --- PmemStorage ---
+
+/**
+ * Create a PmemStorage, mapping its file (which is created or extended
+ * as needed).
+ *
+ * \param segmentSize
+ *      The size in bytes of the segments this storage will deal with.
+ * \param frameCount
+ *      The number of segments this storage can store simultaneously.
+ * \param writeRateLimit
+ *      When specified, writes to this storage instance should be
+ *      limited to at most the given rate (in megabytes per second).
+ *      The special value 0 turns off throttling.
+ * \param filePath
+ *      Path of the file (on a DAX filesystem, for persistent memory) or
+ *      device (such as /dev/dax0.0) to map.
+ *
+ * \throw BackupStorageException
+ *      The file couldn't be opened, sized, or mapped.
+ */
+PmemStorage::PmemStorage(size_t segmentSize,
+                         size_t frameCount,
+                         size_t writeRateLimit,
+                         const char* filePath)
+    : BackupStorage(segmentSize, Type::PERSISTENT_MEMORY, writeRateLimit)
+    , mutex()
+    , fd(-1)
+    , mappedLength()
+    , base(NULL)
+    , mapSync(false)
+    , frameStride((segmentSize + METADATA_SIZE + CACHE_LINE_SIZE - 1) /
+                  CACHE_LINE_SIZE * CACHE_LINE_SIZE)
+    , superblock()
+    , lastSuperblockFrame(1)
+    , frames()
+    , frameCount(frameCount)
+    , freeMap(frameCount)
+    , lastAllocatedFrame(FreeMap::npos)
+{
+    mappedLength = HEADER_SIZE + frameCount * frameStride;
+
+    fd = ::open(filePath, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) {
+        int e = errno;
+        LOG(ERROR, "Failed to open backup storage file %s: %s",
+            filePath, strerror(e));
+        throw BackupStorageException(HERE,
+            format("Failed to open backup storage file %s", filePath), e);
+    }
+
+    // Regular files are extended to hold the whole storage; devices are
+    // assumed to be big enough already.
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+            static_cast<size_t>(st.st_size) < mappedLength) {
+        int e = posix_fallocate(fd, 0, mappedLength);
+        if (e != 0) {
+            ::close(fd);
+            throw BackupStorageException(HERE,
+                format("Failed to allocate %lu bytes for backup storage "
+                       "file %s", mappedLength, filePath), e);
+        }
+    }
+
+    void* mapping = MAP_FAILED;
+#if defined(MAP_SYNC) && defined(MAP_SHARED_VALIDATE)
+    mapping = mmap(NULL, mappedLength, PROT_READ | PROT_WRITE,
+                   MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    mapSync = (mapping != MAP_FAILED);
+#endif
+    if (mapping == MAP_FAILED) {
+        mapping = mmap(NULL, mappedLength, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        int e = errno;
+        ::close(fd);
+        throw BackupStorageException(HERE,
+            format("Failed to map backup storage file %s", filePath), e);
+    }
+    base = static_cast<char*>(mapping);
+
+    for (size_t frame = 0; frame < frameCount; ++frame)
+        frames.emplace_back(this, frame);
+    freeMap.set();
+
+    LOG(NOTICE, "Backup storage mapped %lu bytes of %s for %lu frame(s) "
+        "(%s)", mappedLength, filePath, frameCount,
+        mapSync ? "MAP_SYNC; appends persisted with cache line flushes" :
+                  "not DAX; appends persisted with msync");
+}
+
+/// Unmap and close the file.
+PmemStorage::~PmemStorage()
+{
+    if (munmap(base, mappedLength) == -1)
+        LOG(ERROR, "Couldn't unmap backup storage: %s", strerror(errno));
+    if (::close(fd) == -1)
+        LOG(ERROR, "Couldn't close backup storage: %s", strerror(errno));
+}
+
+/**
+ * Allocate a frame on storage, resetting its state to accept appends for a new
+ * replica. See MultiFileStorage::open() for details.
+ *
+ * \param sync
+ *      Ignored for PmemStorage. All append() calls store data
+ *      synchronously.
+ * \param masterId
+ *      The server that owns the segment associated with this replica.
+ * \param segmentId
+ *      Unique identifier (in the log of masterId) of the segment
+ *      associated with this replica.
+ * \return
+ *      Reference to a frame through which handles all IO for a single
+ *      replica. Maintains a reference count; when destroyed if the
+ *      reference count drops to zero the frame will be freed for reuse with
+ *      another replica.
+ */
+BackupStorage::FrameRef
+PmemStorage::open(bool sync, ServerId masterId, uint64_t segmentId)
+{
+    Lock lock(mutex);
+    FreeMap::size_type next = freeMap.find_next(lastAllocatedFrame);
+    if (next == FreeMap::npos) {
+        next = freeMap.find_first();
+        if (next == FreeMap::npos) {
+            RAMCLOUD_CLOG(WARNING, "Master tried to open a storage frame "
+                "but there are no frames free (all %lu frames are in use); "
+                "rejecting", frameCount);
+            throw BackupOpenRejectedException(HERE);
+        }
+    }
+    lastAllocatedFrame = next;
+    size_t frameIndex = next;
+    assert(freeMap[frameIndex] == 1);
+    freeMap[frameIndex] = 0;
+    Frame* frame = &frames[frameIndex];
+    lock.unlock();
+    frame->open();
+    return {frame, BackupStorage::freeFrame};
+}
+
+/**
+ * Returns the maximum number of bytes of metadata that can be stored
+ * which each append(). Also, how many bytes of getMetadata() are safe
+ * for access after getMetadata() calls, though returned data may or may
+ * not contain valid or meaningful (or even consistent with the
+ * replica) metadata.
+ */
+size_t
+PmemStorage::getMetadataSize()
+{
+    return METADATA_SIZE;
+}
+
+/**
+ * Marks ALL storage frames as allocated. This should only be performed at
+ * backup startup. The caller is reponsible for freeing the frames if the
+ * metadata indicates the replica data stored there isn't useful. Frames
+ * whose metadata is intact are marked open or closed as their metadata
+ * indicates.
+ *
+ * \return
+ *      Pointer to every frame which has various uses depending on the
+ *      metadata that is found in that frame. BackupService code is expected
+ *      to examine the metadata and either free the frame or take note of the
+ *      metadata in the frame for potential use in future recoveries.
+ */
+std::vector<BackupStorage::FrameRef>
+PmemStorage::loadAllMetadata()
+{
+    std::vector<FrameRef> ret;
+    ret.reserve(frames.size());
+    foreach (Frame& frame, frames) {
+        assert(freeMap[frame.frameIndex] == 1);
+        freeMap[frame.frameIndex] = 0;
+
+        const BackupReplicaMetadata* metadata =
+                static_cast<const BackupReplicaMetadata*>(frame.getMetadata());
+        if (metadata->checkIntegrity()) {
+            frame.isClosed = metadata->closed;
+            frame.isOpen = !metadata->closed;
+        }
+        ret.push_back({&frame, BackupStorage::freeFrame});
+    }
+    return ret;
+}
+
+/**
+ * Store a new superblock in the mapping. Both copies are overwritten, the
+ * older one first, so that one intact copy survives a crash at any point.
+ *
+ * \param serverId
+ *      The server id of the process using this storage.
+ * \param clusterName
+ *      Name of the cluster this backup belongs to; see
+ *      Superblock::clusterName.
+ * \param frameSkipMask
+ *      Only used for testing; bit i set means superblock copy i is not
+ *      written.
+ */
+void
+PmemStorage::resetSuperblock(ServerId serverId,
+                             const string& clusterName,
+                             const uint32_t frameSkipMask)
+{
+    Superblock newSuperblock =
+        Superblock(superblock.version + 1, serverId, clusterName.c_str());
+    SuperblockContents contents;
+    contents.superblock = newSuperblock;
+    Crc32C crc;
+    crc.update(&contents.superblock, sizeof(contents.superblock));
+    contents.checksum = crc.getResult();
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        const uint32_t nextFrame = (lastSuperblockFrame + 1) % 2;
+        if (!((frameSkipMask >> nextFrame) & 0x01)) {
+            char* destination = base + nextFrame * SUPERBLOCK_SIZE;
+            memcpy(destination, &contents, sizeof(contents));
+            persist(destination, sizeof(contents));
+            LOG(DEBUG, "Superblock frame %u written", nextFrame);
+        }
+        lastSuperblockFrame = nextFrame;
+    }
+
+    superblock = newSuperblock;
+}
+
+/**
+ * Find the most recent intact superblock in the mapping; if there is none
+ * a default superblock is returned. See MultiFileStorage::loadSuperblock().
+ */
+BackupStorage::Superblock
+PmemStorage::loadSuperblock()
+{
+    Tub<Superblock> left = tryLoadSuperblock(0);
+    Tub<Superblock> right = tryLoadSuperblock(1);
+
+    bool chooseLeft = false;
+    if (left && right) {
+        chooseLeft = left->version >= right->version;
+    } else if (!left && !right) {
+        LOG(WARNING,
+            "Backup couldn't find existing superblock; "
+            "starting as fresh backup.");
+        right.construct();
+        chooseLeft = false;
+    } else {
+        chooseLeft = left;
+    }
+
+    if (chooseLeft) {
+        superblock = *left;
+        lastSuperblockFrame = 0;
+    } else {
+        superblock = *right;
+        lastSuperblockFrame = 1;
+    }
+    return superblock;
+}
+
+/**
+ * No-op for PmemStorage; every append is durable before it returns.
+ */
+void
+PmemStorage::quiesce()
+{
+}
+
+/**
+ * Erase the metadata of every frame, so that no replica in the mapping is
+ * reused by this or any future backup. Only safe immediately after this
+ * class is instantiated, before it is used to allocate or perform
+ * operations on frames.
+ */
+void
+PmemStorage::fry()
+{
+    foreach (Frame& frame, frames) {
+        memset(frame.metadata, '\0', METADATA_SIZE);
+        persist(frame.metadata, METADATA_SIZE);
+    }
+}
+
+// - private -
+
+/**
+ * Return the start of the region of the mapping for a frame: its replica
+ * data, followed by its metadata block.
+ */
+char*
+PmemStorage::frameStart(size_t frameIndex) const
+{
+    return base + HEADER_SIZE + frameIndex * frameStride;
+}
+
+/**
+ * Make a range of the mapping durable. With MAP_SYNC this flushes the
+ * cache lines holding the range and fences; otherwise it msyncs the pages
+ * holding the range. DIEs if the range can't be made durable.
+ *
+ * \param start
+ *      First byte of the range; must be in the mapping.
+ * \param length
+ *      Bytes in the range.
+ */
+void
+PmemStorage::persist(const void* start, size_t length)
+{
+    if (length == 0)
+        return;
+    uintptr_t first = reinterpret_cast<uintptr_t>(start);
+    uintptr_t end = first + length;
+    if (mapSync) {
+        for (uintptr_t line = first & ~(CACHE_LINE_SIZE - 1UL); line < end;
+                line += CACHE_LINE_SIZE) {
+            _mm_clflush(reinterpret_cast<const void*>(line));
+        }
+        _mm_sfence();
+        return;
+    }
+
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t page = first & ~(pageSize - 1);
+    if (msync(reinterpret_cast<void*>(page), end - page, MS_SYNC) == -1) {
+        DIE("Failed to flush backup storage (%lu bytes at offset %lu): %s",
+            length, first - reinterpret_cast<uintptr_t>(base),
+            strerror(errno));
+    }
+}
+
+/**
+ * Read one of the two copies of the superblock from the mapping.
+ *
+ * \param superblockFrame
+ *      Which copy to read (0 or 1).
+ * \return
+ *      The superblock, or empty if the copy's checksum doesn't match.
+ */
+Tub<BackupStorage::Superblock>
+PmemStorage::tryLoadSuperblock(uint32_t superblockFrame)
+{
+    SuperblockContents contents;
+    memcpy(&contents, base + superblockFrame * SUPERBLOCK_SIZE,
+           sizeof(contents));
+
+    Crc32C crc;
+    crc.update(&contents.superblock, sizeof(contents.superblock));
+    if (contents.checksum != crc.getResult()) {
+        LOG(NOTICE, "Stored superblock %u had a bad checksum",
+            superblockFrame);
+        return {};
+    }
+    char& endOfName = contents.superblock.clusterName[
+            sizeof(contents.superblock.clusterName) - 1];
+    if (endOfName != '\0')
+        DIE("Stored superblock's cluster name should end in \\0; "
+            "this should never happen unless there is a software bug");
+    return { contents.superblock };
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,228 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_PMEMSTORAGE_H
+#define RAMCLOUD_PMEMSTORAGE_H
+
+#include <deque>
+
+#include "Common.h"
+#include "BackupStorage.h"
+#include "MultiFileStorage.h"
+
+namespace RAMCloud {
+
+/**
+ * A BackupStorage backend which keeps replicas in a memory-mapped file,
+ * intended for persistent memory (e.g. a file on a DAX filesystem or a
+ * /dev/dax device). Appends are copied straight into the mapping and made
+ * durable by flushing the affected cache lines, so there is no block IO
+ * and no staging buffer; loading a replica for recovery just returns a
+ * pointer into the mapping.
+ *
+ * The file is mapped with MAP_SYNC when the kernel and filesystem support
+ * it, which guarantees that flushed cache lines are durable without any
+ * further calls into the kernel. Otherwise (an ordinary file, as used for
+ * testing) it falls back to a plain shared mapping and makes appends
+ * durable with msync; this is correct but much slower.
+ *
+ * The file starts with two copies of the superblock, followed by one region
+ * for each frame: the replica data and then its metadata block.
+ */
+class PmemStorage : public BackupStorage {
+  public:
+    /**
+     * Represents the region of the mapping which holds a single replica and
+     * its metadata. PmemStorage keeps exactly one frame for each such region.
+     * Frames get reused for different replicas making a frame something of a
+     * state machine.
+     *
+     * Backups open() frames, append() data, and then close() them. When the
+     * replica is no longer needed free() releases the frame for reuse by
+     * another replica, for which, the same cycle will be repeated.
+     * See PmemStorage::open() to allocate and open a Frame.
+     */
+    class Frame : public BackupStorage::Frame {
+      PUBLIC:
+        typedef std::unique_lock<std::mutex> Lock;
+
+        Frame(PmemStorage* storage, size_t frameIndex);
+
+        bool wasAppendedToByCurrentProcess();
+
+        void loadMetadata();
+        const void* getMetadata();
+
+        void startLoading();
+        bool isLoaded();
+        bool currentlyOpen() { return isOpen; }
+        void* load();
+        void unload();
+
+        void append(Buffer& source,
+                    size_t sourceOffset,
+                    size_t length,
+                    size_t destinationOffset,
+                    const void* metadata,
+                    size_t metadataLength);
+        void close();
+        void reopen(size_t length);
+        void free();
+
+      PRIVATE:
+        void open();
+
+        /// Storage where this frame resides.
+        PmemStorage* storage;
+
+        /// Index of the frame in #storage.frames. Used to mark the frame free.
+        const size_t frameIndex;
+
+        /// Start of the replica data for this frame in the mapping.
+        char* data;
+
+        /// Start of the metadata block for this frame in the mapping.
+        char* metadata;
+
+        /**
+         * Tracks whether a replica has been opened (either initially or
+         * since the time of the last free). False if #isClosed.
+         */
+        bool isOpen;
+
+        /**
+         * Tracks whether a replica has been closed (either initially or
+         * since the time of the last free). False if #isOpen.
+         */
+        bool isClosed;
+
+        /**
+         * Tracks whether append has been called on this frame during the
+         * life of this process. This includes across free()/open() cycles.
+         * See MultiFileStorage::Frame::appendedToByCurrentProcess.
+         */
+        bool appendedToByCurrentProcess;
+
+        /**
+         * True if the replica data has been requested. Only used to reject
+         * appends after load requests; replicas never need to be read.
+         */
+        bool loadRequested;
+
+        /**
+         * Serializes appends to this frame, so that its metadata is updated
+         * in order, and keeps open(), close(), free(), and load requests
+         * from running while an append is copying into the frame. Unlike
+         * PmemStorage::mutex, it is held while data is copied and persisted.
+         * Always acquired before PmemStorage::mutex.
+         */
+        std::mutex ioMutex;
+
+        // ONLY for open() and loadAllMetadata(); please try not to touch
+        // other details of frames in PmemStorage (or elsewhere).
+        friend class PmemStorage;
+        DISALLOW_COPY_AND_ASSIGN(Frame);
+    };
+
+    PmemStorage(size_t segmentSize,
+                size_t frameCount,
+                size_t writeRateLimit,
+                const char* filePath);
+    ~PmemStorage();
+
+    FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
+    size_t getMetadataSize();
+    std::vector<FrameRef> loadAllMetadata();
+    void resetSuperblock(ServerId serverId,
+                         const string& clusterName,
+                         uint32_t frameSkipMask = 0);
+    Superblock loadSuperblock();
+    void quiesce();
+    void fry();
+
+  PRIVATE:
+    /// Maximum size of metadata for each frame.
+    enum { METADATA_SIZE = MultiFileStorage::METADATA_SIZE };
+
+    /// Space reserved for each of the two copies of the superblock.
+    enum { SUPERBLOCK_SIZE = MultiFileStorage::BLOCK_SIZE };
+
+    /// Space at the start of the file reserved for the superblocks.
+    enum { HEADER_SIZE = 4096 };
+
+    char* frameStart(size_t frameIndex) const;
+    void persist(const void* start, size_t length);
+    Tub<Superblock> tryLoadSuperblock(uint32_t superblockFrame);
+
+    /// Protects concurrent operations on storage and the state of all of its
+    /// frames; not held while replica data is copied or persisted (see
+    /// Frame::ioMutex).
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /// File descriptor of the mapped file.
+    int fd;
+
+    /// Bytes of the file that are mapped (the whole storage).
+    size_t mappedLength;
+
+    /// Start of the mapping.
+    char* base;
+
+    /**
+     * True if the file is mapped with MAP_SYNC, so that flushing cache lines
+     * is enough to make writes durable; false means writes are made durable
+     * with msync.
+     */
+    bool mapSync;
+
+    /// Distance in bytes between the starts of consecutive frames.
+    const size_t frameStride;
+
+    /// Holds the most recent image of the superblock.
+    Superblock superblock;
+
+    /// Tracks which of the superblock frames was most recently written.
+    uint32_t lastSuperblockFrame;
+
+    /**
+     * Frame for each region of the mapping which can hold a replica.
+     * Frames get reused for different replicas making a frame something of a
+     * state machine, but are all created and destroyed along with the
+     * storage instance.
+     */
+    std::deque<Frame> frames;
+
+    /// The number of replicas this storage can store simultaneously.
+    const size_t frameCount;
+
+    /// Type of the freeMap.  A bitmap.
+    typedef boost::dynamic_bitset<> FreeMap;
+    /// Keeps a bit set for each frame in frames indicating if it is free.
+    FreeMap freeMap;
+
+    /**
+     * Track the last used segment frame so they can be used in FIFO.
+     * This gives recovery dump tools a much better chance at recovering
+     * data since old data is destroyed from storage first rather than new.
+     */
+    FreeMap::size_type lastAllocatedFrame;
+
+    DISALLOW_COPY_AND_ASSIGN(PmemStorage);
+};
+
+} // namespace RAMCloud
+
+#endif
@@ -0,0 +1,180 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "BackupMasterRecovery.h"
+#include "ClientException.h"
+#include "PmemStorage.h"
+
+namespace RAMCloud {
+
+class PmemStorageTest : public ::testing::Test {
+  public:
+    typedef char* bytes;
+    enum { METADATA_SIZE = PmemStorage::METADATA_SIZE };
+    typedef PmemStorage::Frame Frame;
+
+    const char* test;
+    uint32_t testLength;
+    Buffer testSource;
+    uint32_t segmentFrames;
+    uint32_t segmentSize;
+    const char* filePath;
+    Tub<PmemStorage> storage;
+
+    PmemStorageTest()
+        : test("test")
+        , testLength(downCast<uint32_t>(strlen(test)))
+        , testSource()
+        , segmentFrames(4)
+        , segmentSize(4 * 1024)
+        , filePath("/tmp/ramcloud-pmem-storage-test-delete-this")
+        , storage()
+    {
+        Logger::get().setLogLevels(SILENT_LOG_LEVEL);
+        unlink(filePath);
+        testSource.appendExternal(test, testLength + 1);
+        storage.construct(segmentSize, segmentFrames, 0, filePath);
+    }
+
+    ~PmemStorageTest()
+    {
+        storage.destroy();
+        unlink(filePath);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(PmemStorageTest);
+};
+
+TEST_F(PmemStorageTest, Frame_append) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+
+    char* replica = bytes(frame->load());
+    EXPECT_EQ(storage->frameStart(0), replica);
+    EXPECT_STREQ(test, replica);
+    char* metadata = static_cast<bytes>(const_cast<void*>(
+                                                frame->getMetadata()));
+    EXPECT_EQ(storage->frameStart(0) + segmentSize, metadata);
+    EXPECT_STREQ(test, metadata);
+    EXPECT_TRUE(frame->isLoaded());
+
+    // No appends once loading has started.
+    EXPECT_THROW(frame->append(testSource, 0, 5, 0, NULL, 0),
+                 BackupBadSegmentIdException);
+}
+
+TEST_F(PmemStorageTest, Frame_appendOutOfBounds) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    EXPECT_THROW(frame->append(testSource, 0, 5, segmentSize, NULL, 0),
+                 BackupSegmentOverflowException);
+    char metadata[METADATA_SIZE + 1];
+    EXPECT_THROW(frame->append(testSource, 0, 5, 0, metadata,
+                               sizeof(metadata)),
+                 BackupSegmentOverflowException);
+    frame->close();
+    EXPECT_THROW(frame->append(testSource, 0, 5, 0, NULL, 0),
+                 BackupBadSegmentIdException);
+}
+
+TEST_F(PmemStorageTest, Frame_open) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+    frame.reset();
+    EXPECT_EQ(1, storage->freeMap[0]);
+
+    // Old metadata is erased when the frame is reused.
+    storage->lastAllocatedFrame = PmemStorage::FreeMap::npos;
+    frame = storage->open(false, ServerId(), 0);
+    EXPECT_EQ(storage->frameStart(0) + segmentSize,
+              frame->getMetadata());
+    EXPECT_STREQ("", static_cast<const char*>(frame->getMetadata()));
+}
+
+TEST_F(PmemStorageTest, replicasSurviveRestart) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    BackupReplicaMetadata metadata(SegmentCertificate(), 99, 88,
+                                   segmentSize, 0, false, true);
+    frame->append(testSource, 0, 5, 0, &metadata, sizeof(metadata));
+    BackupStorage::FrameRef closedFrame =
+            storage->open(false, ServerId(), 1);
+    BackupReplicaMetadata closedMetadata(SegmentCertificate(), 99, 89,
+                                         segmentSize, 0, true, true);
+    closedFrame->append(testSource, 0, 5, 0,
+                        &closedMetadata, sizeof(closedMetadata));
+    closedFrame->close();
+    frame.reset();
+    closedFrame.reset();
+    storage.destroy();
+
+    storage.construct(segmentSize, segmentFrames, 0, filePath);
+    auto frames = storage->loadAllMetadata();
+    ASSERT_EQ(segmentFrames, frames.size());
+    EXPECT_EQ(0, storage->freeMap[0]);
+    const BackupReplicaMetadata* found =
+        static_cast<const BackupReplicaMetadata*>(frames[0]->getMetadata());
+    EXPECT_TRUE(found->checkIntegrity());
+    EXPECT_EQ(88lu, found->segmentId);
+    EXPECT_TRUE(frames[0]->currentlyOpen());
+    EXPECT_FALSE(frames[1]->currentlyOpen());
+    EXPECT_STREQ(test, bytes(frames[1]->load()));
+    EXPECT_FALSE(frames[2]->currentlyOpen());
+
+    // Reopened replicas accept appends again.
+    frames[0]->reopen(5);
+    frames[0]->append(testSource, 0, 5, 5, NULL, 0);
+    EXPECT_STREQ(test, bytes(frames[0]->load()) + 5);
+
+    storage->fry();
+    EXPECT_FALSE(found->checkIntegrity());
+}
+
+TEST_F(PmemStorageTest, resetSuperblock) {
+    EXPECT_EQ("__unnamed__",
+              string(storage->loadSuperblock().getClusterName()));
+    storage->resetSuperblock({9999, 1}, "hasso");
+    storage->resetSuperblock({9999, 2}, "hasso", 0x2);
+    EXPECT_EQ(2lu, storage->tryLoadSuperblock(0)->version);
+    EXPECT_EQ(1lu, storage->tryLoadSuperblock(1)->version);
+    storage.destroy();
+
+    storage.construct(segmentSize, segmentFrames, 0, filePath);
+    BackupStorage::Superblock superblock = storage->loadSuperblock();
+    EXPECT_EQ(2lu, superblock.version);
+    EXPECT_EQ(ServerId(9999, 2), superblock.getServerId());
+    EXPECT_EQ("hasso", string(superblock.getClusterName()));
+    EXPECT_EQ(0u, storage->lastSuperblockFrame);
+}
+
+TEST_F(PmemStorageTest, open_noFreeFrames) {
+    std::vector<BackupStorage::FrameRef> frames;
+    for (uint32_t i = 0; i < segmentFrames; ++i)
+        frames.push_back(storage->open(false, ServerId(), i));
+    EXPECT_THROW(storage->open(false, ServerId(), 0),
+                 BackupOpenRejectedException);
+}
+
+TEST_F(PmemStorageTest, persist) {
+    // /tmp isn't DAX, so msync is used.
+    EXPECT_FALSE(storage->mapSync);
+    storage->persist(storage->frameStart(1) + 3, 10);
+    storage->persist(storage->frameStart(1), 0);
+
+    storage->mapSync = true;
+    storage->persist(storage->frameStart(1) + 3, 200);
+    storage->mapSync = false;
+}
+
+} // namespace RAMCloud
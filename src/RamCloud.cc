@@ -21,6 +21,7 @@
 #include "CoordinatorClient.h"
 #include "CoordinatorSession.h"
 #include "Dispatch.h"
+#include "EnumerationFilter.h"
 #include "LinearizableObjectRpcWrapper.h"
 #include "FailSession.h"
 #include "MasterClient.h"
@@ -31,7 +32,9 @@
 #include "Object.h"
 #include "ObjectFinder.h"
 #include "ProtoBuf.h"
+#include "ReadCoalescer.h"
 #include "RpcTracker.h"
+#include "Segment.h"
 #include "ShortMacros.h"
 #include "TimeTrace.h"
 
@@ -60,6 +63,8 @@ RamCloud::RamCloud(CommandLineOptions* options)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , readCoalescer()
+    , readCoalescerMutex("RamCloud::readCoalescerMutex")
 {
     coordinatorLocator = options->getExternalStorageLocator();
     if (coordinatorLocator.size() == 0) {
@@ -82,6 +87,8 @@ RamCloud::RamCloud(Context* context)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , readCoalescer()
+    , readCoalescerMutex("RamCloud::readCoalescerMutex")
 {
     coordinatorLocator = context->options->getExternalStorageLocator();
     if (coordinatorLocator.size() == 0) {
@@ -101,6 +108,8 @@ RamCloud::RamCloud(const char* locator, const char* clusterName)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , readCoalescer()
+    , readCoalescerMutex("RamCloud::readCoalescerMutex")
 {
     clientContext->coordinatorSession->setLocation(locator, clusterName);
 }
@@ -112,6 +121,8 @@ RamCloud::RamCloud(Context* context, const char* locator,
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , readCoalescer()
+    , readCoalescerMutex("RamCloud::readCoalescerMutex")
 {
     clientContext->coordinatorSession->setLocation(locator, clusterName);
 }
@@ -122,6 +133,7 @@ RamCloud::RamCloud(Context* context, const char* locator,
 
 RamCloud::~RamCloud()
 {
+    readCoalescer.reset();
     delete clientLeaseAgent;
 
     delete rpcTracker;
@@ -144,8 +156,16 @@ RamCloud::poll()
 {
     // If we're not running in the dispatch thread, there's no need to do
     // anything (the dispatch thread will be polling continuously).
-    if (clientContext->dispatch->isDispatchThread())
+    if (clientContext->dispatch->isDispatchThread()) {
         clientContext->dispatch->poll();
+        std::shared_ptr<ReadCoalescer> coalescer;
+        {
+            SpinLock::Guard _(readCoalescerMutex);
+            coalescer = readCoalescer;
+        }
+        if (coalescer)
+            coalescer->poll();
+    }
 }
 
 /**
@@ -445,6 +465,123 @@ DropIndexRpc::DropIndexRpc(RamCloud* ramcloud, uint64_t tableId,
     send();
 }
 
+/**
+ * Stop coalescing reads (see #enableReadCoalescing). Reads that have
+ * already joined the coalescer still complete through it.
+ */
+void
+RamCloud::disableReadCoalescing()
+{
+    // The old coalescer is destroyed (if no ReadRpcs still use it) after
+    // releasing the lock.
+    std::shared_ptr<ReadCoalescer> old;
+    SpinLock::Guard _(readCoalescerMutex);
+    old.swap(readCoalescer);
+}
+
+/**
+ * Start coalescing reads issued through this object. From now on each
+ * ReadRpc without reject rules (including those started by #read) shares
+ * its request with any other pending read of the same object, and the
+ * pending reads are sent together as a MultiRead (one RPC per master)
+ * instead of one RPC per read. This reduces load on the masters when a
+ * client has many reads outstanding, especially of hot objects, at the
+ * cost of up to batchWindowNs of additional latency.
+ *
+ * \param batchWindowNs
+ *      How long (in nanoseconds) a read may wait for other reads to join
+ *      its batch. With the default of 0, the batch is sent as soon as the
+ *      client waits for (or polls) any read, which combines all the reads
+ *      it started asynchronously before then without delaying any of them.
+ *      If coalescing was already enabled, reads that joined the previous
+ *      coalescer still complete through it; new reads use the new window.
+ */
+void
+RamCloud::enableReadCoalescing(uint64_t batchWindowNs)
+{
+    std::shared_ptr<ReadCoalescer> coalescer =
+            std::make_shared<ReadCoalescer>(this, batchWindowNs);
+    SpinLock::Guard _(readCoalescerMutex);
+    coalescer.swap(readCoalescer);
+}
+
+/**
+ * Constructor for BulkLoadRpc: initiates an RPC that asks the master that
+ * owns a tablet to add all of the objects in a segment to its log. This is
+ * normally invoked by BulkLoader; returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Table containing the objects.
+ * \param firstKeyHash
+ *      Lowest key hash of the tablet that the segment was packed for; also
+ *      used to select the master.
+ * \param lastKeyHash
+ *      Highest key hash of the tablet that the segment was packed for.
+ * \param segment
+ *      Holds the objects, in the same format as in the log. The segment is
+ *      sent in its entirety and must not be modified or deleted until the
+ *      RPC completes.
+ */
+BulkLoadRpc::BulkLoadRpc(RamCloud* ramcloud, uint64_t tableId,
+        uint64_t firstKeyHash, uint64_t lastKeyHash, Segment* segment)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, firstKeyHash,
+            sizeof(WireFormat::BulkLoad::Response))
+{
+    WireFormat::BulkLoad::Request* reqHdr(
+            allocHeader<WireFormat::BulkLoad>());
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = firstKeyHash;
+    reqHdr->lastKeyHash = lastKeyHash;
+    segment->getAppendedLength(&reqHdr->certificate);
+    reqHdr->segmentBytes = segment->appendToBuffer(request);
+    send();
+}
+
+// See RpcWrapper for documentation.
+bool
+BulkLoadRpc::checkStatus()
+{
+    if (responseHeader->status == STATUS_UNKNOWN_TABLET) {
+        // The master no longer owns the whole tablet. Unlike other object
+        // RPCs, retrying can't help: the segment must be split up according
+        // to the current tablet map, which is up to the caller.
+        context->objectFinder->flush(tableId);
+        return true;
+    }
+    return ObjectRpcWrapper::checkStatus();
+}
+
+/**
+ * Wait for a BULK_LOAD RPC to complete.
+ *
+ * \param[out] objectCount
+ *      If non-NULL, the number of objects added by the master is returned
+ *      here after a successful return.
+ *
+ * \return
+ *      True means the master stored the segment's objects. False means the
+ *      master no longer owns the entire tablet (it was split or migrated),
+ *      so none of the objects were stored; the caller should regroup them
+ *      according to the current tablet map and send them again.
+ */
+bool
+BulkLoadRpc::wait(uint32_t* objectCount)
+{
+    waitInternal(context->dispatch);
+    if (responseHeader->status == STATUS_UNKNOWN_TABLET)
+        return false;
+    if (responseHeader->status != STATUS_OK)
+        ClientException::throwException(HERE, responseHeader->status);
+    const WireFormat::BulkLoad::Response* respHdr(
+            getResponseHeader<WireFormat::BulkLoad>());
+    if (objectCount != NULL)
+        *objectCount = respHdr->objectCount;
+    return true;
+}
+
 /**
  * Send a message to a given server and cause that server to echo with the
  * exact same message.
@@ -659,6 +796,10 @@ EchoRpc::wait()
  *      tablet. When this happens, the return value will be set to
  *      point to the next tablet, or will be set to zero if this is
  *      the end of the entire table.
+ * \param filter
+ *      If non-NULL, the server returns only the objects that match this
+ *      filter, projected as it specifies (see EnumerationFilter). The
+ *      same filter must be passed on every call of an enumeration.
  *
  * \return
  *       The return value is a key hash indicating where to continue
@@ -670,10 +811,11 @@ EchoRpc::wait()
  */
 uint64_t
 RamCloud::enumerateTable(uint64_t tableId, bool keysOnly,
-        uint64_t tabletFirstHash, Buffer& state, Buffer& objects)
+        uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+        const EnumerationFilter* filter)
 {
     EnumerateTableRpc rpc(this, tableId, keysOnly,
-                            tabletFirstHash, state, objects);
+                            tabletFirstHash, state, objects, filter);
     return rpc.wait(state);
 }
 
@@ -706,9 +848,13 @@ RamCloud::enumerateTable(uint64_t tableId, bool keysOnly,
  * \param[out] objects
  *      After a successful return, this buffer will contain zero or
  *      more objects from the requested tablet.
+ * \param filter
+ *      If non-NULL, the server returns only the objects that match this
+ *      filter, projected as it specifies (see EnumerationFilter).
  */
 EnumerateTableRpc::EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId,
-        bool keysOnly, uint64_t tabletFirstHash, Buffer& state, Buffer& objects)
+        bool keysOnly, uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+        const EnumerationFilter* filter)
     : ObjectRpcWrapper(ramcloud->clientContext, tableId, tabletFirstHash,
             sizeof(WireFormat::Enumerate::Response), &objects)
 {
@@ -720,6 +866,9 @@ EnumerateTableRpc::EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId,
     reqHdr->iteratorBytes = state.size();
     for (Buffer::Iterator it(&state); !it.isDone(); it.next())
         request.append(it.getData(), it.getLength());
+    reqHdr->filterBytes = 0;
+    if (filter != NULL && !filter->isEmpty())
+        reqHdr->filterBytes = filter->serialize(request);
     send();
 }
 
@@ -772,6 +921,105 @@ EnumerateTableRpc::wait(Buffer& state)
     return result;
 }
 
+/**
+ * Write a snapshot of a tablet to a file on the local disk of the master
+ * that owns it. The snapshot can later be loaded into a tablet of a table
+ * with the same id (on the same or a different master) with
+ * #importTabletSnapshot, for example to restore the table after it has
+ * been dropped and recreated, or to clone it into another cluster.
+ *
+ * \param tableId
+ *      Table containing the tablet.
+ * \param keyHash
+ *      Any key hash in the tablet; the entire tablet is exported.
+ * \param path
+ *      Name of the snapshot file, relative to the master's snapshot
+ *      directory (see its --snapshotDir option); an existing file is
+ *      replaced.
+ * \param basePath
+ *      If non-NULL, the name of an earlier snapshot of the same tablet on
+ *      the same master. Only the objects modified since that snapshot are
+ *      written, along with enough information to apply deletions; the base
+ *      must be imported before the new snapshot.
+ *
+ * \return
+ *      The number of objects written to the snapshot file.
+ *
+ * \exception InvalidParameterException
+ *      The master has no snapshot directory, or a file name is absolute
+ *      or contains "..".
+ * \exception InternalError
+ *      The snapshot couldn't be written (see the master's log).
+ */
+uint64_t
+RamCloud::exportTabletSnapshot(uint64_t tableId, uint64_t keyHash,
+        const char* path, const char* basePath)
+{
+    ExportSnapshotRpc rpc(this, tableId, keyHash, path, basePath);
+    return rpc.wait();
+}
+
+/**
+ * Constructor for ExportSnapshotRpc: initiates an RPC in the same way as
+ * #RamCloud::exportTabletSnapshot, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Table containing the tablet.
+ * \param keyHash
+ *      Any key hash in the tablet; the entire tablet is exported.
+ * \param path
+ *      Name of the snapshot file, relative to the master's snapshot
+ *      directory.
+ * \param basePath
+ *      If non-NULL, the name of an earlier snapshot of the same tablet;
+ *      an incremental snapshot is written.
+ */
+ExportSnapshotRpc::ExportSnapshotRpc(RamCloud* ramcloud, uint64_t tableId,
+        uint64_t keyHash, const char* path, const char* basePath)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, keyHash,
+            sizeof(WireFormat::ExportSnapshot::Response))
+{
+    WireFormat::ExportSnapshot::Request* reqHdr(
+            allocHeader<WireFormat::ExportSnapshot>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyHash = keyHash;
+    reqHdr->pathLength = downCast<uint32_t>(strlen(path) + 1);
+    request.append(path, reqHdr->pathLength);
+    reqHdr->basePathLength = 0;
+    if (basePath != NULL) {
+        reqHdr->basePathLength = downCast<uint32_t>(strlen(basePath) + 1);
+        request.append(basePath, reqHdr->basePathLength);
+    }
+    send();
+}
+
+/**
+ * Wait for an EXPORT_SNAPSHOT RPC to complete, and return the same results
+ * as #RamCloud::exportTabletSnapshot.
+ *
+ * \param[out] firstKeyHash
+ *      If non-NULL, the lowest key hash in the exported tablet is
+ *      returned here.
+ * \param[out] lastKeyHash
+ *      If non-NULL, the highest key hash in the exported tablet is
+ *      returned here.
+ */
+uint64_t
+ExportSnapshotRpc::wait(uint64_t* firstKeyHash, uint64_t* lastKeyHash)
+{
+    simpleWait(context);
+    const WireFormat::ExportSnapshot::Response* respHdr(
+            getResponseHeader<WireFormat::ExportSnapshot>());
+    if (firstKeyHash != NULL)
+        *firstKeyHash = respHdr->firstKeyHash;
+    if (lastKeyHash != NULL)
+        *lastKeyHash = respHdr->lastKeyHash;
+    return respHdr->objectCount;
+}
+
 /**
  * Retrieve various metrics from a master server's log module.
  *
@@ -1221,6 +1469,82 @@ GetTableIdRpc::wait()
     return respHdr->tableId;
 }
 
+/**
+ * Load a snapshot written by #exportTabletSnapshot into a table. The
+ * snapshot file must be on the local disk of the master that owns the
+ * tablet covering the snapshot's key hashes, and the table must have the
+ * same id as the table that was exported. Objects already in the table
+ * are replaced only by newer versions from the snapshot. Incremental
+ * snapshots must be imported after their base.
+ *
+ * \param tableId
+ *      Table to load the objects into.
+ * \param keyHash
+ *      Any key hash in the snapshot; used to select the master.
+ * \param path
+ *      Name of the snapshot file, relative to the master's snapshot
+ *      directory.
+ *
+ * \return
+ *      The number of objects in the snapshot file.
+ *
+ * \exception InvalidParameterException
+ *      The master doesn't own a tablet covering the snapshot, the snapshot
+ *      was taken from a table with a different id, or the name isn't
+ *      acceptable (see #exportTabletSnapshot).
+ * \exception InternalError
+ *      The snapshot couldn't be read (see the master's log).
+ */
+uint64_t
+RamCloud::importTabletSnapshot(uint64_t tableId, uint64_t keyHash,
+        const char* path)
+{
+    ImportSnapshotRpc rpc(this, tableId, keyHash, path);
+    return rpc.wait();
+}
+
+/**
+ * Constructor for ImportSnapshotRpc: initiates an RPC in the same way as
+ * #RamCloud::importTabletSnapshot, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Table to load the objects into.
+ * \param keyHash
+ *      Any key hash in the snapshot; used to select the master.
+ * \param path
+ *      Name of the snapshot file, relative to the master's snapshot
+ *      directory.
+ */
+ImportSnapshotRpc::ImportSnapshotRpc(RamCloud* ramcloud, uint64_t tableId,
+        uint64_t keyHash, const char* path)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, keyHash,
+            sizeof(WireFormat::ImportSnapshot::Response))
+{
+    WireFormat::ImportSnapshot::Request* reqHdr(
+            allocHeader<WireFormat::ImportSnapshot>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyHash = keyHash;
+    reqHdr->pathLength = downCast<uint32_t>(strlen(path) + 1);
+    request.append(path, reqHdr->pathLength);
+    send();
+}
+
+/**
+ * Wait for an IMPORT_SNAPSHOT RPC to complete, and return the same results
+ * as #RamCloud::importTabletSnapshot.
+ */
+uint64_t
+ImportSnapshotRpc::wait()
+{
+    simpleWait(context);
+    const WireFormat::ImportSnapshot::Response* respHdr(
+            getResponseHeader<WireFormat::ImportSnapshot>());
+    return respHdr->objectCount;
+}
+
 /**
  * Atomically increment the value of an object whose contents are an
  * IEEE754 double precision 8-byte floating point value.  If the object does
@@ -2017,6 +2341,47 @@ RamCloud::read(uint64_t tableId, const void* key, uint16_t keyLength,
     rpc.wait(version, objectExists);
 }
 
+/**
+ * Read the contents of an object, accepting a possibly stale result if the
+ * object's master has crashed and is being recovered. In that case the read
+ * is served by the recovery master from the data it has replayed so far,
+ * rather than waiting (typically a second or two) for the recovery to
+ * finish. A degraded result is a version of the object that was written at
+ * some point, but newer versions may exist; the version number can be used
+ * to decide whether it is acceptable. If the object hasn't been replayed
+ * yet, the read waits. When the object's tablet isn't being recovered, this
+ * behaves just like #read.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the
+ *      contents of the desired object - only the value portion of the object.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] degraded
+ *      If non-NULL, true is returned here if the object was read from a
+ *      tablet that was still being recovered (so the value may be stale).
+ * \param[out] objectExists
+ *      If non-NULL, the ObjectDoesntExistException is not thrown and a flag
+ *      indicating the existence of the object is returned here.
+ */
+void
+RamCloud::readDegraded(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, uint64_t* version, bool* degraded, bool* objectExists)
+{
+    DegradedReadRpc rpc(this, tableId, key, keyLength, value);
+    rpc.wait(version, degraded, objectExists);
+}
+
 /**
  * Read the current contents of an object including the keys and the value.
  *
@@ -2073,15 +2438,26 @@ RamCloud::readKeysAndValue(uint64_t tableId, const void* key,
  *      contents of the desired object.
  * \param rejectRules
  *      If non-NULL, specifies conditions under which the read
- *      should be aborted with an error.
+ *      should be aborted with an error. Reads with reject rules are
+ *      never coalesced.
  */
 ReadRpc::ReadRpc(RamCloud* ramcloud, uint64_t tableId,
         const void* key, uint16_t keyLength, Buffer* value,
         const RejectRules* rejectRules)
     : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
             sizeof(WireFormat::Read::Response), value)
+    , coalescedRead()
+    , coalescer()
 {
     value->reset();
+    if (rejectRules == NULL) {
+        SpinLock::Guard _(ramcloud->readCoalescerMutex);
+        coalescer = ramcloud->readCoalescer;
+    }
+    if (coalescer) {
+        coalescedRead = coalescer->join(tableId, key, keyLength);
+        return;
+    }
     WireFormat::Read::Request* reqHdr(allocHeader<WireFormat::Read>());
     reqHdr->tableId = tableId;
     reqHdr->keyLength = keyLength;
@@ -2090,6 +2466,16 @@ ReadRpc::ReadRpc(RamCloud* ramcloud, uint64_t tableId,
     send();
 }
 
+// See RpcWrapper::isReady for documentation.
+bool
+ReadRpc::isReady()
+{
+    if (!coalescedRead)
+        return RpcWrapper::isReady();
+    coalescer->poll();
+    return coalescedRead->finished;
+}
+
 /**
  * Wait for the RPC to complete, and return the same results as
  * #RamCloud::read.
@@ -2107,6 +2493,29 @@ ReadRpc::wait(uint64_t* version, bool* objectExists)
         *objectExists = true;
 
     waitInternal(context->dispatch);
+    if (coalescedRead) {
+        const MultiReadObject& request = coalescedRead->request;
+        if (version != NULL)
+            *version = request.version;
+        if (request.status != STATUS_OK) {
+            if (objectExists != NULL &&
+                    request.status == STATUS_OBJECT_DOESNT_EXIST) {
+                *objectExists = false;
+                return;
+            }
+            ClientException::throwException(HERE, request.status);
+        }
+
+        // Copy out just the value; the object may be shared with other
+        // ReadRpcs.
+        ObjectBuffer* object = coalescedRead->value.get();
+        uint32_t valueOffset;
+        object->getValueOffset(&valueOffset);
+        uint32_t length = object->size() - valueOffset;
+        object->copy(valueOffset, length, response->alloc(length));
+        return;
+    }
+
     const WireFormat::Read::Response* respHdr(
             getResponseHeader<WireFormat::Read>());
     if (version != NULL)
@@ -2127,6 +2536,83 @@ ReadRpc::wait(uint64_t* version, bool* objectExists)
     assert(respHdr->length == response->size());
 }
 
+/**
+ * Constructor for DegradedReadRpc: initiates an RPC in the same way as
+ * #RamCloud::readDegraded, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the
+ *      contents of the desired object - only the value portion of the object.
+ */
+DegradedReadRpc::DegradedReadRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, Buffer* value)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
+            sizeof(WireFormat::Read::Response), value)
+{
+    allowDegraded = true;
+    value->reset();
+    WireFormat::Read::Request* reqHdr(allocHeader<WireFormat::Read>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->rejectRules = defaultRejectRules;
+    reqHdr->allowDegraded = 1;
+    request.append(key, keyLength);
+    send();
+}
+
+/**
+ * Wait for the RPC to complete, and return the same results as
+ * #RamCloud::readDegraded.
+ *
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] degraded
+ *      If non-NULL, true is returned here if the object was read from a
+ *      tablet that was still being recovered.
+ * \param[out] objectExists
+ *      If non-NULL, the ObjectDoesntExistException is not thrown and a flag
+ *      indicating the existence of the object is returned here.
+ */
+void
+DegradedReadRpc::wait(uint64_t* version, bool* degraded, bool* objectExists)
+{
+    if (objectExists != NULL)
+        *objectExists = true;
+
+    waitInternal(context->dispatch);
+    const WireFormat::Read::Response* respHdr(
+            getResponseHeader<WireFormat::Read>());
+    if (version != NULL)
+        *version = respHdr->version;
+    if (degraded != NULL)
+        *degraded = (respHdr->degraded != 0);
+
+    if (respHdr->common.status != STATUS_OK) {
+        if (objectExists != NULL &&
+                respHdr->common.status == STATUS_OBJECT_DOESNT_EXIST) {
+            *objectExists = false;
+        } else {
+            ClientException::throwException(HERE, respHdr->common.status);
+        }
+    }
+
+    response->truncateFront(sizeof(*respHdr));
+    assert(respHdr->length == response->size());
+}
+
 /**
  * Constructor for ReadKeysAndValueRpc: initiates an RPC in the same way as
  * #RamCloud::read, but returns once the RPC has been initiated, without
@@ -2205,6 +2691,89 @@ ReadKeysAndValueRpc::wait(uint64_t* version, bool* objectExists)
     assert(respHdr->length == response->size());
 }
 
+/**
+ * Constructor for ReadSnapshotRpc: initiates a read of an object as it was
+ * at a given cluster time, but returns once the RPC has been initiated,
+ * without waiting for it to complete. If a transaction that may change the
+ * object in the snapshot is in progress, the RPC is retried until the
+ * transaction has been decided.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Primary key for the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param snapshotTime
+ *      Cluster time of the snapshot; see ClientLeaseAgent::getClusterTime.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the
+ *      contents of the desired object consisting of all the keys and the
+ *      value.
+ */
+ReadSnapshotRpc::ReadSnapshotRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, ClusterTime snapshotTime,
+        ObjectBuffer* value)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
+            sizeof(WireFormat::ReadSnapshot::Response), value)
+{
+    value->reset();
+    WireFormat::ReadSnapshot::Request* reqHdr(allocHeader<
+                            WireFormat::ReadSnapshot>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->snapshotTime = snapshotTime.getEncoded();
+    request.append(key, keyLength);
+    send();
+}
+
+/**
+ * Wait for the RPC to complete, and return the same results as
+ * #RamCloud::read.
+ *
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] objectExists
+ *      If non-NULL, the ObjectDoesntExistException is not thrown and a flag
+ *      indicating the existence of the object is returned here.
+ *
+ * \throw SnapshotTooOldException
+ *      The master no longer retains the version of the object that was
+ *      current at the snapshot time.
+ */
+void
+ReadSnapshotRpc::wait(uint64_t* version, bool* objectExists)
+{
+    if (objectExists != NULL)
+        *objectExists = true;
+
+    waitInternal(context->dispatch);
+    const WireFormat::ReadSnapshot::Response* respHdr(
+            getResponseHeader<WireFormat::ReadSnapshot>());
+    if (version != NULL)
+        *version = respHdr->version;
+
+    if (respHdr->common.status != STATUS_OK) {
+        if (objectExists != NULL &&
+                respHdr->common.status == STATUS_OBJECT_DOESNT_EXIST) {
+            *objectExists = false;
+        } else {
+            ClientException::throwException(HERE, respHdr->common.status);
+        }
+    }
+
+    // Truncate the response Buffer so that it consists of nothing
+    // but the object data.
+    response->truncateFront(sizeof(*respHdr));
+    assert(respHdr->length == response->size());
+}
+
 /**
  * Delete an object from a table. If the object does not currently exist
  * then the operation succeeds without doing anything (unless rejectRules
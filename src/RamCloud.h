@@ -23,6 +23,7 @@
 #include "ObjectRpcWrapper.h"
 #include "OptionParser.h"
 #include "ServerMetrics.h"
+#include "SpinLock.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -35,12 +36,17 @@
 namespace RAMCloud {
 class ClientLeaseAgent;
 class ClientTransactionManager;
+class ClusterTime;
+class CoalescedRead;
+class EnumerationFilter;
 class MultiIncrementObject;
 class MultiReadObject;
 class MultiRemoveObject;
 class MultiWriteObject;
 class ObjectFinder;
+class ReadCoalescer;
 class RpcTracker;
+class Segment;
 
 /**
  * This structure describes a key (primary or secondary) and its length.
@@ -78,10 +84,15 @@ class RamCloud {
     void createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
             uint8_t numIndexlets = 1);
     void dropIndex(uint64_t tableId, uint8_t indexId);
+    void disableReadCoalescing();
     void echo(const char* serviceLocator, const void* message, uint32_t length,
          uint32_t echoLength, Buffer* reply = NULL);
+    void enableReadCoalescing(uint64_t batchWindowNs = 0);
     uint64_t enumerateTable(uint64_t tableId, bool keysOnly,
-         uint64_t tabletFirstHash, Buffer& state, Buffer& objects);
+         uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+         const EnumerationFilter* filter = NULL);
+    uint64_t exportTabletSnapshot(uint64_t tableId, uint64_t keyHash,
+            const char* path, const char* basePath = NULL);
     void getLogMetrics(const char* serviceLocator,
             ProtoBuf::LogMetrics& logMetrics);
     ServerMetrics getMetrics(uint64_t tableId, const void* key,
@@ -94,6 +105,8 @@ class RamCloud {
             ProtoBuf::ServerStatistics& serverStats);
     string* getServiceLocator();
     uint64_t getTableId(const char* name);
+    uint64_t importTabletSnapshot(uint64_t tableId, uint64_t keyHash,
+            const char* path);
     double incrementDouble(uint64_t tableId,
             const void* key, uint16_t keyLength,
             double incrementValue, const RejectRules* rejectRules = NULL,
@@ -129,6 +142,9 @@ class RamCloud {
     void read(uint64_t tableId, const void* key, uint16_t keyLength,
             Buffer* value, const RejectRules* rejectRules = NULL,
             uint64_t* version = NULL, bool* objectExists = NULL);
+    void readDegraded(uint64_t tableId, const void* key, uint16_t keyLength,
+            Buffer* value, uint64_t* version = NULL, bool* degraded = NULL,
+            bool* objectExists = NULL);
     void readKeysAndValue(uint64_t tableId, const void* key, uint16_t keyLength,
             ObjectBuffer* value, const RejectRules* rejectRules = NULL,
             uint64_t* version = NULL, bool* objectExists = NULL);
@@ -203,6 +219,16 @@ class RamCloud {
     RpcTracker *rpcTracker;
     ClientTransactionManager *transactionManager;
 
+    /// If non-NULL, unconditional reads are coalesced and batched by this
+    /// object (see enableReadCoalescing). Shared with the ReadRpcs that
+    /// have joined it, so that it outlives them even if coalescing is
+    /// disabled or restarted while they are outstanding.
+    std::shared_ptr<ReadCoalescer> readCoalescer;
+
+    /// Protects #readCoalescer, which ReadRpcs in other threads copy while
+    /// it may be replaced by enableReadCoalescing or disableReadCoalescing.
+    SpinLock readCoalescerMutex;
+
   private:
     DISALLOW_COPY_AND_ASSIGN(RamCloud);
 };
@@ -283,6 +309,24 @@ class DropIndexRpc : public CoordinatorRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(DropIndexRpc);
 };
 
+/**
+ * Carries a segment of objects packed by a BulkLoader to the master that
+ * owns their tablet.
+ */
+class BulkLoadRpc : public ObjectRpcWrapper {
+  public:
+    BulkLoadRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash, Segment* segment);
+    ~BulkLoadRpc() {}
+    bool wait(uint32_t* objectCount = NULL);
+
+  PROTECTED:
+    virtual bool checkStatus();
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(BulkLoadRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::echo operation,
  * allowing it to execute asynchronously.
@@ -334,7 +378,8 @@ class EchoRpc : public RpcWrapper {
 class EnumerateTableRpc : public ObjectRpcWrapper {
   public:
     EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId, bool keysOnly,
-            uint64_t tabletFirstHash, Buffer& iter, Buffer& objects);
+            uint64_t tabletFirstHash, Buffer& iter, Buffer& objects,
+            const EnumerationFilter* filter = NULL);
     ~EnumerateTableRpc() {}
     uint64_t wait(Buffer& nextIter);
 
@@ -342,6 +387,22 @@ class EnumerateTableRpc : public ObjectRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(EnumerateTableRpc);
 };
 
+/**
+ * Encapsulates the state of a RamCloud::exportTabletSnapshot operation,
+ * allowing it to execute asynchronously.
+ */
+class ExportSnapshotRpc : public ObjectRpcWrapper {
+  public:
+    ExportSnapshotRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t keyHash,
+            const char* path, const char* basePath = NULL);
+    ~ExportSnapshotRpc() {}
+    uint64_t wait(uint64_t* firstKeyHash = NULL,
+            uint64_t* lastKeyHash = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ExportSnapshotRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::testingFill operation,
  * allowing it to execute asynchronously.
@@ -461,6 +522,21 @@ class GetTableIdRpc : public CoordinatorRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(GetTableIdRpc);
 };
 
+/**
+ * Encapsulates the state of a RamCloud::importTabletSnapshot operation,
+ * allowing it to execute asynchronously.
+ */
+class ImportSnapshotRpc : public ObjectRpcWrapper {
+  public:
+    ImportSnapshotRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t keyHash,
+            const char* path);
+    ~ImportSnapshotRpc() {}
+    uint64_t wait();
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ImportSnapshotRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::incrementDouble operation,
  * allowing it to execute asynchronously.
@@ -965,12 +1041,37 @@ class ReadRpc : public ObjectRpcWrapper {
             uint16_t keyLength, Buffer* value,
             const RejectRules* rejectRules = NULL);
     ~ReadRpc() {}
+    virtual bool isReady();
     void wait(uint64_t* version = NULL, bool* objectExists = NULL);
 
   PRIVATE:
+    /// If the read was handed to the client's ReadCoalescer, this holds
+    /// the shared read providing its result (and no RPC is sent by this
+    /// object). Empty otherwise.
+    std::shared_ptr<CoalescedRead> coalescedRead;
+
+    /// The ReadCoalescer that #coalescedRead belongs to, if it is in use.
+    std::shared_ptr<ReadCoalescer> coalescer;
+
     DISALLOW_COPY_AND_ASSIGN(ReadRpc);
 };
 
+/**
+ * Encapsulates the state of a RamCloud::readDegraded operation,
+ * allowing it to execute asynchronously.
+ */
+class DegradedReadRpc : public ObjectRpcWrapper {
+  public:
+    DegradedReadRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, Buffer* value);
+    ~DegradedReadRpc() {}
+    void wait(uint64_t* version = NULL, bool* degraded = NULL,
+            bool* objectExists = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(DegradedReadRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::read operation,
  * allowing it to execute asynchronously. The difference from
@@ -988,6 +1089,22 @@ class ReadKeysAndValueRpc : public ObjectRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(ReadKeysAndValueRpc);
 };
 
+/**
+ * Reads an object as it was at a given cluster time, so that reads of
+ * several objects at the same time see a consistent snapshot. Used by
+ * read-only Transactions.
+ */
+class ReadSnapshotRpc : public ObjectRpcWrapper {
+  public:
+    ReadSnapshotRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, ClusterTime snapshotTime, ObjectBuffer* value);
+    ~ReadSnapshotRpc() {}
+    void wait(uint64_t* version = NULL, bool* objectExists = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ReadSnapshotRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::remove operation,
  * allowing it to execute asynchronously.
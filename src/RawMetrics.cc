@@ -22,6 +22,7 @@
 #include "ShortMacros.h"
 #include "RawMetrics.h"
 #include "MetricList.pb.h"
+#include "RpcLatency.h"
 #include "Segment.h"
 
 namespace RAMCloud {
@@ -61,7 +62,8 @@ RawMetrics::init()
 
 /**
  * Generate a string that contains a serialized representation of all of the
- * performance counters.
+ * performance counters, followed by the latency percentiles for each RPC
+ * opcode (see RpcLatency::addMetrics).
  *
  * \param out
  *      The contents of this variable are replaced with a (binary) string
@@ -82,6 +84,9 @@ RawMetrics::serialize(std::string& out)
         metric->set_name(info.name);
         metric->set_value(*info.value);
     }
+
+    // Also include the server-side latency of each opcode.
+    RpcLatency::addMetrics(&list);
     out.clear();
     list.SerializeToString(&out);
 }
@@ -0,0 +1,160 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ReadCoalescer.h"
+#include "Cycles.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a CoalescedRead.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Primary key for the object within tableId; it is copied.
+ * \param keyLength
+ *      Size in bytes of the key.
+ */
+CoalescedRead::CoalescedRead(uint64_t tableId, const void* key,
+        uint16_t keyLength)
+    : tableId(tableId)
+    , key(static_cast<const char*>(key), keyLength)
+    , value()
+    , request(tableId, this->key.data(), keyLength, &value)
+    , finished(false)
+{
+}
+
+/**
+ * Construct a ReadCoalescer.
+ *
+ * \param ramcloud
+ *      The RAMCloud object on whose behalf reads will be issued.
+ * \param batchWindowNs
+ *      How long (in nanoseconds) the first read of a batch waits for other
+ *      reads to join it before the batch is sent. 0 means that the batch
+ *      is sent as soon as the coalescer is polled, which still combines
+ *      all the reads started by a client before it waits for any of them.
+ */
+ReadCoalescer::ReadCoalescer(RamCloud* ramcloud, uint64_t batchWindowNs)
+    : ramcloud(ramcloud)
+    , batchWindowCycles(Cycles::fromNanoseconds(batchWindowNs))
+    , mutex("ReadCoalescer::mutex")
+    , windowStart(0)
+    , pending()
+    , batches()
+{
+}
+
+/**
+ * Destructor for ReadCoalescer: cancels any outstanding MultiReads.
+ * Reads that are still referenced by ReadRpcs will never finish.
+ */
+ReadCoalescer::~ReadCoalescer()
+{
+    Lock lock(mutex);
+    foreach (Batch& batch, batches) {
+        batch.multiRead->cancel();
+    }
+}
+
+/**
+ * Arrange for an object to be read, sharing the request with any other
+ * read of the same object that hasn't been sent yet.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Primary key for the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \return
+ *      The read whose result the caller should use; it is finished once
+ *      its \c finished flag is set (call #poll to make progress).
+ */
+std::shared_ptr<CoalescedRead>
+ReadCoalescer::join(uint64_t tableId, const void* key, uint16_t keyLength)
+{
+    std::pair<uint64_t, string> id(tableId,
+            string(static_cast<const char*>(key), keyLength));
+    Lock lock(mutex);
+    PendingMap::iterator it = pending.find(id);
+    if (it != pending.end())
+        return it->second;
+
+    if (pending.empty())
+        windowStart = Cycles::rdtsc();
+    std::shared_ptr<CoalescedRead> read =
+            std::make_shared<CoalescedRead>(tableId, key, keyLength);
+    pending[id] = read;
+    return read;
+}
+
+/**
+ * Make incremental progress: send the pending reads if their batching
+ * window has expired, and collect the results of completed MultiReads.
+ * If another thread is already polling, this returns immediately: that
+ * thread will finish the reads for everyone, and spinning here could
+ * deadlock with it while it waits for the dispatch thread.
+ */
+void
+ReadCoalescer::poll()
+{
+    if (!mutex.try_lock())
+        return;
+    Lock lock(mutex, std::adopt_lock);
+
+    if (!pending.empty() &&
+            (Cycles::rdtsc() - windowStart >= batchWindowCycles)) {
+        sendBatch(lock);
+    }
+
+    std::list<Batch>::iterator it = batches.begin();
+    while (it != batches.end()) {
+        if (!it->multiRead->isReady()) {
+            it++;
+            continue;
+        }
+        foreach (std::shared_ptr<CoalescedRead>& read, it->reads) {
+            read->finished = true;
+        }
+        it = batches.erase(it);
+    }
+}
+
+/**
+ * Issue a MultiRead for all of the pending reads.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+ReadCoalescer::sendBatch(Lock& lock)
+{
+    batches.emplace_back();
+    Batch& batch = batches.back();
+    batch.reads.reserve(pending.size());
+    batch.requests.reserve(pending.size());
+    foreach (PendingMap::value_type& entry, pending) {
+        batch.reads.push_back(entry.second);
+        batch.requests.push_back(&entry.second->request);
+    }
+    pending.clear();
+    batch.multiRead.construct(ramcloud, &batch.requests[0],
+            downCast<uint32_t>(batch.requests.size()));
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,150 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_READCOALESCER_H
+#define RAMCLOUD_READCOALESCER_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Common.h"
+#include "MultiRead.h"
+#include "ObjectBuffer.h"
+#include "RamCloud.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * Shared state for one object read issued by the ReadCoalescer. Every
+ * ReadRpc that asked for the same object while the read was still waiting
+ * to be sent holds a reference to the same CoalescedRead, and all of them
+ * obtain their result from it.
+ */
+class CoalescedRead {
+  PUBLIC:
+    CoalescedRead(uint64_t tableId, const void* key, uint16_t keyLength);
+
+    /// Table containing the object.
+    uint64_t tableId;
+
+    /// Primary key of the object (a private copy, so that the RPCs that
+    /// joined this read don't need to keep their keys alive).
+    string key;
+
+    /// Filled in by the MultiRead with the object (if it exists).
+    Tub<ObjectBuffer> value;
+
+    /// Request passed to the MultiRead; its status and version describe
+    /// the outcome once #finished is true.
+    MultiReadObject request;
+
+    /// True once the MultiRead carrying this read has completed. Set by
+    /// whichever thread polls the coalescer, and read by the threads
+    /// waiting for their ReadRpcs.
+    std::atomic<bool> finished;
+
+    DISALLOW_COPY_AND_ASSIGN(CoalescedRead);
+};
+
+/**
+ * A ReadCoalescer reduces the number of RPCs a client issues for reads.
+ * It is enabled with RamCloud::enableReadCoalescing; once enabled, each
+ * unconditional ReadRpc joins the coalescer instead of sending its own RPC:
+ *
+ * - Reads of the same object that are started within the same batching
+ *   window share a single request, and the result is fanned out to all
+ *   of them.
+ * - At the end of the window all pending reads, for any number of
+ *   objects, are issued together as a MultiRead, which sends one RPC to
+ *   each master holding some of the objects.
+ *
+ * Reads only join requests that have not yet been sent; a read started
+ * after the RPC for the same object went out gets a new request, so
+ * coalescing never returns a value older than the start of the read.
+ *
+ * This class is thread-safe: ReadRpcs issued by different threads through
+ * the same RamCloud object join the same pending reads. It is driven by
+ * ReadRpc::isReady and RamCloud::poll; only one thread at a time polls,
+ * and the others simply check whether their reads have finished.
+ */
+class ReadCoalescer {
+  PUBLIC:
+    ReadCoalescer(RamCloud* ramcloud, uint64_t batchWindowNs);
+    ~ReadCoalescer();
+    std::shared_ptr<CoalescedRead> join(uint64_t tableId, const void* key,
+            uint16_t keyLength);
+    void poll();
+
+  PRIVATE:
+    typedef std::lock_guard<SpinLock> Lock;
+
+    void sendBatch(Lock& lock);
+
+    /**
+     * A MultiRead issued by the coalescer, along with the reads it carries.
+     */
+    struct Batch {
+        Batch()
+            : reads()
+            , requests()
+            , multiRead()
+        {}
+
+        /// Reads being carried by #multiRead.
+        std::vector<std::shared_ptr<CoalescedRead>> reads;
+
+        /// Request pointers passed to #multiRead (one per entry in #reads).
+        std::vector<MultiReadObject*> requests;
+
+        /// The operation fetching the objects.
+        Tub<MultiRead> multiRead;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
+    /// The client on whose behalf reads are issued.
+    RamCloud* ramcloud;
+
+    /// Reads wait at most this long (in Cycles::rdtsc ticks) for other
+    /// reads to join their batch. 0 means the batch is sent on the next
+    /// call to poll.
+    uint64_t batchWindowCycles;
+
+    /// Monitor-style lock: protects all of the state below (but not the
+    /// contents of CoalescedReads once they have been sent).
+    SpinLock mutex;
+
+    /// Cycles::rdtsc time when the oldest entry in #pending joined.
+    uint64_t windowStart;
+
+    /// Reads that have not been sent yet, indexed by (table, key) so that
+    /// identical reads can share them.
+    typedef std::map<std::pair<uint64_t, string>,
+            std::shared_ptr<CoalescedRead>> PendingMap;
+    PendingMap pending;
+
+    /// MultiReads that have been sent but haven't completed.
+    std::list<Batch> batches;
+
+    DISALLOW_COPY_AND_ASSIGN(ReadCoalescer);
+};
+
+} // end RAMCloud
+
+#endif  /* RAMCLOUD_READCOALESCER_H */
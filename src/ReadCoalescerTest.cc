@@ -0,0 +1,241 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+#include "ReadCoalescer.h"
+
+namespace RAMCloud {
+
+class ReadCoalescerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId1;
+    uint64_t tableId2;
+
+  public:
+    ReadCoalescerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId1(-1)
+        , tableId2(-2)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId1 = ramcloud->createTable("table1");
+        tableId2 = ramcloud->createTable("table2");
+        ramcloud->write(tableId1, "0", 1, "abcdef", 6);
+        ramcloud->write(tableId1, "1", 1, "ghi", 3);
+        ramcloud->write(tableId2, "0", 1, "jklmn", 5);
+        ramcloud->enableReadCoalescing();
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ReadCoalescerTest);
+};
+
+TEST_F(ReadCoalescerTest, sanityCheck) {
+    Buffer value1, value2, value3, value4;
+    ReadRpc rpc1(ramcloud.get(), tableId1, "0", 1, &value1);
+    ReadRpc rpc2(ramcloud.get(), tableId1, "1", 1, &value2);
+    ReadRpc rpc3(ramcloud.get(), tableId1, "0", 1, &value3);
+    ReadRpc rpc4(ramcloud.get(), tableId2, "0", 1, &value4);
+    ReadCoalescer* coalescer = ramcloud->readCoalescer.get();
+    EXPECT_EQ(3u, coalescer->pending.size());
+    EXPECT_EQ(rpc1.coalescedRead, rpc3.coalescedRead);
+
+    uint64_t version;
+    rpc3.wait(&version);
+    EXPECT_EQ(1u, version);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value3));
+    rpc1.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value1));
+    rpc2.wait();
+    EXPECT_EQ("ghi", TestUtil::toString(&value2));
+    rpc4.wait();
+    EXPECT_EQ("jklmn", TestUtil::toString(&value4));
+    EXPECT_EQ(0u, coalescer->pending.size());
+    EXPECT_EQ(0u, coalescer->batches.size());
+}
+
+TEST_F(ReadCoalescerTest, read) {
+    Buffer value;
+    ramcloud->read(tableId1, "1", 1, &value);
+    EXPECT_EQ("ghi", TestUtil::toString(&value));
+}
+
+TEST_F(ReadCoalescerTest, read_objectDoesntExist) {
+    Buffer value;
+    bool objectExists = true;
+    ramcloud->read(tableId1, "99", 2, &value, NULL, NULL, &objectExists);
+    EXPECT_FALSE(objectExists);
+    EXPECT_THROW(ramcloud->read(tableId1, "99", 2, &value),
+            ObjectDoesntExistException);
+}
+
+TEST_F(ReadCoalescerTest, read_rejectRulesNotCoalesced) {
+    Buffer value;
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = 1;
+    rules.givenVersion = 2;
+    ReadRpc rpc(ramcloud.get(), tableId1, "0", 1, &value, &rules);
+    EXPECT_FALSE(rpc.coalescedRead);
+    EXPECT_THROW(rpc.wait(), WrongVersionException);
+}
+
+TEST_F(ReadCoalescerTest, join_afterSend) {
+    Buffer value1, value2;
+    ReadRpc rpc1(ramcloud.get(), tableId1, "0", 1, &value1);
+    ramcloud->readCoalescer->poll();
+    EXPECT_EQ(0u, ramcloud->readCoalescer->pending.size());
+
+    // The first read has been sent, so the second one must not share it.
+    ReadRpc rpc2(ramcloud.get(), tableId1, "0", 1, &value2);
+    EXPECT_NE(rpc1.coalescedRead, rpc2.coalescedRead);
+    rpc2.wait();
+    rpc1.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value1));
+    EXPECT_EQ("abcdef", TestUtil::toString(&value2));
+}
+
+// Helper for the multithreaded tests below: starts a number of reads of
+// the same object.
+static void
+startReads(RamCloud* ramcloud, uint64_t tableId, int count,
+        std::vector<std::unique_ptr<Buffer>>* values,
+        std::vector<std::unique_ptr<ReadRpc>>* rpcs)
+{
+    for (int i = 0; i < count; i++) {
+        values->emplace_back(new Buffer());
+        rpcs->emplace_back(new ReadRpc(ramcloud, tableId, "0", 1,
+                values->back().get()));
+    }
+}
+
+TEST_F(ReadCoalescerTest, join_multipleThreads) {
+    std::vector<std::unique_ptr<Buffer>> values[4];
+    std::vector<std::unique_ptr<ReadRpc>> rpcs[4];
+    std::thread threads[4];
+    for (int i = 0; i < 4; i++) {
+        threads[i] = std::thread(startReads, ramcloud.get(), tableId1, 100,
+                &values[i], &rpcs[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        threads[i].join();
+    }
+
+    // Nothing has been sent yet, so every thread joined the same read.
+    EXPECT_EQ(1u, ramcloud->readCoalescer->pending.size());
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(100u, rpcs[i].size());
+        for (size_t j = 0; j < rpcs[i].size(); j++) {
+            EXPECT_EQ(rpcs[0][0]->coalescedRead, rpcs[i][j]->coalescedRead);
+            rpcs[i][j]->wait();
+            EXPECT_EQ("abcdef", TestUtil::toString(values[i][j].get()));
+        }
+    }
+}
+
+TEST_F(ReadCoalescerTest, enableReadCoalescing_multipleThreads) {
+    std::vector<std::unique_ptr<Buffer>> values[2];
+    std::vector<std::unique_ptr<ReadRpc>> rpcs[2];
+    std::thread threads[2];
+    for (int i = 0; i < 2; i++) {
+        threads[i] = std::thread(startReads, ramcloud.get(), tableId1, 200,
+                &values[i], &rpcs[i]);
+    }
+
+    // Replace the coalescer while the other threads are copying it.
+    for (int i = 0; i < 100; i++) {
+        ramcloud->enableReadCoalescing();
+    }
+    for (int i = 0; i < 2; i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < 2; i++) {
+        for (size_t j = 0; j < rpcs[i].size(); j++) {
+            EXPECT_TRUE(rpcs[i][j]->coalescedRead);
+            rpcs[i][j]->wait();
+            EXPECT_EQ("abcdef", TestUtil::toString(values[i][j].get()));
+        }
+    }
+}
+
+TEST_F(ReadCoalescerTest, poll_batchWindow) {
+    ramcloud->enableReadCoalescing(1000000000UL);
+    ReadCoalescer* coalescer = ramcloud->readCoalescer.get();
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId1, "0", 1, &value);
+    coalescer->poll();
+    EXPECT_EQ(1u, coalescer->pending.size());
+    EXPECT_FALSE(rpc.isReady());
+
+    coalescer->batchWindowCycles = 0;
+    rpc.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+}
+
+TEST_F(ReadCoalescerTest, disableReadCoalescing_readsOutstanding) {
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId1, "0", 1, &value);
+    ramcloud->disableReadCoalescing();
+    EXPECT_FALSE(ramcloud->readCoalescer);
+    EXPECT_EQ(1u, rpc.coalescer->pending.size());
+    rpc.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+}
+
+TEST_F(ReadCoalescerTest, enableReadCoalescing_readsOutstanding) {
+    Buffer value1, value2;
+    ReadRpc rpc1(ramcloud.get(), tableId1, "0", 1, &value1);
+    ramcloud->enableReadCoalescing();
+    ReadRpc rpc2(ramcloud.get(), tableId1, "0", 1, &value2);
+
+    // The first read stays with the coalescer it joined.
+    EXPECT_NE(rpc1.coalescer, rpc2.coalescer);
+    EXPECT_EQ(1, rpc1.coalescer.use_count());
+    EXPECT_EQ(rpc2.coalescer, ramcloud->readCoalescer);
+    rpc2.wait();
+    rpc1.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value1));
+    EXPECT_EQ("abcdef", TestUtil::toString(&value2));
+}
+
+TEST_F(ReadCoalescerTest, disableReadCoalescing) {
+    ramcloud->disableReadCoalescing();
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId1, "0", 1, &value);
+    EXPECT_FALSE(rpc.coalescedRead);
+    rpc.wait();
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+}
+
+}  // namespace RAMCloud
@@ -1045,6 +1045,9 @@ Recovery::startRecoveryMasters()
         auto& task = recoverTasks[tablet.user_data()];
         if (task) {
             *task->dataToRecover.add_tablet() = tablet;
+            tableManager->recoveryMasterAssigned(tablet.table_id(),
+                    tablet.start_key_hash(), tablet.end_key_hash(),
+                    task->serverId);
             if (tableManager->isIndexletTable(tablet.table_id())) {
                 ProtoBuf::Indexlet& entry =
                     *task->dataToRecover.add_indexlet();
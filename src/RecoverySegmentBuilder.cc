@@ -15,6 +15,7 @@
 
 #include "RecoverySegmentBuilder.h"
 #include "Object.h"
+#include "ObjectChunk.h"
 #include "RpcResult.h"
 #include "SegmentIterator.h"
 #include "ServerId.h"
@@ -80,6 +81,9 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             continue;
         }
         if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB
+            && type != LOG_ENTRY_TYPE_OBJRPCRESULT
+            && type != LOG_ENTRY_TYPE_OBJMANIFEST
+            && type != LOG_ENTRY_TYPE_OBJCHUNK
             && type != LOG_ENTRY_TYPE_SAFEVERSION
             && type != LOG_ENTRY_TYPE_RPCRESULT
             && type != LOG_ENTRY_TYPE_PREP
@@ -140,11 +144,18 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             continue;
         }
 
-        if (type == LOG_ENTRY_TYPE_OBJ) {
+        if (type == LOG_ENTRY_TYPE_OBJ ||
+                type == LOG_ENTRY_TYPE_OBJRPCRESULT ||
+                type == LOG_ENTRY_TYPE_OBJMANIFEST) {
             Object object(entryBuffer);
             tableId = object.getTableId();
             keyHash = Key::getHash(tableId,
                                    object.getKey(), object.getKeyLength());
+        } else if (type == LOG_ENTRY_TYPE_OBJCHUNK) {
+            ObjectChunk chunk(entryBuffer);
+            tableId = chunk.getTableId();
+            keyHash = Key::getHash(tableId,
+                                   chunk.getKey(), chunk.getKeyLength());
         } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
             ObjectTombstone tomb(entryBuffer);
             tableId = tomb.getTableId();
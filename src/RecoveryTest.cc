@@ -1103,6 +1103,14 @@ TEST_F(RecoveryTest, startRecoveryMasters) {
     EXPECT_EQ(2u, recovery.numPartitions);
     EXPECT_EQ(0u, recovery.successfulRecoveryMasters);
     EXPECT_EQ(0u, recovery.unsuccessfulRecoveryMasters);
+
+    // The coordinator knows where each tablet is being recovered.
+    ServerId first = tableManager.getTablet(123, 0).recoveryMasterId;
+    ServerId second = tableManager.getTablet(123, 10).recoveryMasterId;
+    EXPECT_TRUE(first.isValid());
+    EXPECT_TRUE(second.isValid());
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, tableManager.getTablet(123, 20).recoveryMasterId);
 }
 
 /**
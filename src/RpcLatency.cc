@@ -0,0 +1,283 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <cmath>
+
+#include "RpcLatency.h"
+#include "Cycles.h"
+#include "MetricList.pb.h"
+#include "ServerStatistics.pb.h"
+
+namespace RAMCloud {
+
+__thread RpcLatency::ThreadStats* RpcLatency::threadStats = NULL;
+volatile uint64_t RpcLatency::generation = 0;
+SpinLock RpcLatency::mutex("RpcLatency::mutex");
+std::vector<RpcLatency::ThreadStats*> RpcLatency::registeredStats;
+
+/**
+ * Add entries to a list of metrics (such as the one returned by GET_METRICS)
+ * giving the number of samples, their total, and a few percentiles for
+ * each opcode and metric that has samples. The names of the entries have
+ * the form "rpcLatency.READ.total.p99Ns"; all times are in nanoseconds.
+ *
+ * \param list
+ *      Entries are appended to this list.
+ */
+void
+RpcLatency::addMetrics(ProtoBuf::MetricList* list)
+{
+    Summaries summaries;
+    merge(&summaries);
+    foreach (Summaries::value_type& entry, summaries) {
+        Summary& summary = entry.second;
+        string prefix = format("rpcLatency.%s.%s.",
+                WireFormat::opcodeSymbol(entry.first / NUM_METRICS),
+                metricName(entry.first % NUM_METRICS));
+        std::pair<const char*, uint64_t> values[] = {
+            {"count", summary.count},
+            {"totalNs", Cycles::toNanoseconds(summary.totalCycles)},
+            {"p50Ns", Cycles::toNanoseconds(summary.getPercentile(0.5))},
+            {"p99Ns", Cycles::toNanoseconds(summary.getPercentile(0.99))},
+            {"p999Ns", Cycles::toNanoseconds(summary.getPercentile(0.999))},
+            {"maxNs", Cycles::toNanoseconds(summary.maxCycles)},
+        };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            ProtoBuf::MetricList_Entry* metric = list->add_metric();
+            metric->set_name(prefix + values[i].first);
+            metric->set_value(values[i].second);
+        }
+    }
+}
+
+/**
+ * Fill in the latency histograms of a ServerStatistics (see
+ * MasterService::getServerStatistics).
+ *
+ * \param[out] serverStats
+ *      An entry is added to its rpc_latency field for each opcode and
+ *      metric that has samples.
+ */
+void
+RpcLatency::getStatistics(ProtoBuf::ServerStatistics* serverStats)
+{
+    Summaries summaries;
+    merge(&summaries);
+    foreach (Summaries::value_type& entry, summaries) {
+        Summary& summary = entry.second;
+        ProtoBuf::ServerStatistics_RpcLatency* latency =
+                serverStats->add_rpc_latency();
+        latency->set_opcode(entry.first / NUM_METRICS);
+        latency->set_metric(entry.first % NUM_METRICS);
+        latency->set_count(summary.count);
+        latency->set_total_ns(Cycles::toNanoseconds(summary.totalCycles));
+        latency->set_max_ns(Cycles::toNanoseconds(summary.maxCycles));
+        latency->set_p50_ns(Cycles::toNanoseconds(
+                summary.getPercentile(0.5)));
+        latency->set_p99_ns(Cycles::toNanoseconds(
+                summary.getPercentile(0.99)));
+        latency->set_p999_ns(Cycles::toNanoseconds(
+                summary.getPercentile(0.999)));
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            if (summary.buckets[i] == 0)
+                continue;
+            ProtoBuf::ServerStatistics_RpcLatency_Bucket* bucket =
+                    latency->add_bucket();
+            bucket->set_limit_ns(Cycles::toNanoseconds(bucketLimit(i)));
+            bucket->set_count(summary.buckets[i]);
+        }
+    }
+}
+
+/**
+ * Return a human-readable name for a Metric, such as "queueWait".
+ *
+ * \param metric
+ *      One of the values of Metric.
+ */
+const char*
+RpcLatency::metricName(uint32_t metric)
+{
+    static const char* names[] = {"queueWait", "service", "total"};
+    static_assert(sizeof(names) / sizeof(names[0]) == NUM_METRICS,
+            "names doesn't match Metric");
+    if (metric >= NUM_METRICS)
+        return "unknown";
+    return names[metric];
+}
+
+/**
+ * Discard all of the samples recorded so far. Threads clear their own
+ * histograms lazily, the next time they record a sample; until then, their
+ * histograms are ignored.
+ */
+void
+RpcLatency::reset()
+{
+    SpinLock::Guard _(mutex);
+    generation = generation + 1;
+}
+
+/**
+ * Return the largest value that falls in a histogram bucket.
+ *
+ * \param index
+ *      Index of the bucket (see bucketIndex).
+ */
+uint64_t
+RpcLatency::bucketLimit(uint32_t index)
+{
+    if (index < 2 * SUB_BUCKETS)
+        return index;
+    uint32_t shift = index / SUB_BUCKETS - 1;
+    uint64_t lowest = static_cast<uint64_t>(
+            SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lowest + ((1UL << shift) - 1);
+}
+
+/**
+ * Combine the histograms of all threads.
+ *
+ * \param[out] summaries
+ *      Filled in with a histogram for each opcode and metric that has
+ *      samples.
+ */
+void
+RpcLatency::merge(Summaries* summaries)
+{
+    SpinLock::Guard _(mutex);
+    foreach (ThreadStats* stats, registeredStats) {
+        if (stats->generation != generation)
+            continue;
+        for (uint32_t opcode = 0; opcode < WireFormat::ILLEGAL_RPC_TYPE;
+                opcode++) {
+            Counts* counts = stats->counts[opcode];
+            if (counts == NULL)
+                continue;
+            Fence::enter();
+            for (uint32_t metric = 0; metric < NUM_METRICS; metric++) {
+                uint64_t count = 0;
+                for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+                    count += counts->buckets[metric][i];
+                if (count == 0)
+                    continue;
+                Summary& summary = (*summaries)[opcode * NUM_METRICS + metric];
+                for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+                    summary.buckets[i] += counts->buckets[metric][i];
+                summary.count += count;
+                summary.totalCycles += counts->totalCycles[metric];
+                summary.maxCycles = std::max(summary.maxCycles,
+                        counts->maxCycles[metric]);
+            }
+        }
+    }
+}
+
+/**
+ * Create the histograms for the calling thread and register them so that
+ * merge will find them.
+ *
+ * \return
+ *      The calling thread's histograms.
+ */
+RpcLatency::ThreadStats*
+RpcLatency::registerThread()
+{
+    SpinLock::Guard _(mutex);
+    threadStats = new ThreadStats();
+    threadStats->generation = generation;
+    registeredStats.push_back(threadStats);
+    return threadStats;
+}
+
+/**
+ * Construct a ThreadStats with no histograms.
+ */
+RpcLatency::ThreadStats::ThreadStats()
+    : counts()
+    , generation(0)
+{
+}
+
+/**
+ * Create the histograms for an opcode. Invoked only by the owning thread.
+ *
+ * \param opcode
+ *      Opcode whose histograms are needed.
+ * \return
+ *      The new (empty) histograms.
+ */
+RpcLatency::Counts*
+RpcLatency::ThreadStats::allocate(uint32_t opcode)
+{
+    Counts* newCounts = new Counts();
+
+    // Make sure that the histograms are zeroed before merge can see them.
+    Fence::leave();
+    counts[opcode] = newCounts;
+    return newCounts;
+}
+
+/**
+ * Discard all of the samples in this thread's histograms. Invoked only by
+ * the owning thread, when it notices that reset has been called.
+ *
+ * \param newGeneration
+ *      The value of RpcLatency::generation at the time of the reset.
+ */
+void
+RpcLatency::ThreadStats::clear(uint64_t newGeneration)
+{
+    for (uint32_t opcode = 0; opcode < WireFormat::ILLEGAL_RPC_TYPE;
+            opcode++) {
+        if (counts[opcode] != NULL)
+            memset(counts[opcode], 0, sizeof(Counts));
+    }
+
+    // The histograms mustn't be merged again until they're empty.
+    Fence::leave();
+    generation = newGeneration;
+}
+
+/**
+ * Return the value at or below which the given fraction of the samples
+ * fall, using the nearest-rank method. The result is the largest value in
+ * the bucket where the percentile falls (but no more than the largest
+ * sample), so it overestimates by less than 1/SUB_BUCKETS.
+ *
+ * \param fraction
+ *      Fraction of the samples (between 0 and 1), e.g. 0.99 for the 99th
+ *      percentile.
+ * \return
+ *      The percentile, in Cycles::rdtsc ticks; 0 if there are no samples.
+ */
+uint64_t
+RpcLatency::Summary::getPercentile(double fraction)
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(
+            ceil(fraction * static_cast<double>(count)));
+    rank = std::min(std::max(rank, 1UL), count);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(bucketLimit(i), maxCycles);
+    }
+    return maxCycles;
+}
+
+} // namespace RAMCloud
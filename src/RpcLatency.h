@@ -0,0 +1,218 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCLATENCY_H
+#define RAMCLOUD_RPCLATENCY_H
+
+#include <map>
+
+#include "Common.h"
+#include "BitOps.h"
+#include "Fence.h"
+#include "SpinLock.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+namespace ProtoBuf {
+class MetricList;
+class ServerStatistics;
+}
+
+/**
+ * This class keeps server-side latency histograms for each RPC opcode, so
+ * that the tail latency of a server can be monitored (and alerted on)
+ * directly, rather than only through the latencies observed by clients.
+ * WorkerManager records three times for every RPC it passes to a worker:
+ * how long the request waited before a worker started on it, how long the
+ * worker spent executing it, and the total time from its arrival until the
+ * reply was passed to the transport.
+ *
+ * Recording must be cheap enough to leave on all the time, so each thread
+ * records into its own histograms, without locks or atomic operations, much
+ * like PerfStats. The histograms use log-linear buckets in the style of
+ * HdrHistogram: each power of two is divided into SUB_BUCKETS buckets, so
+ * any value is recorded with a relative error of less than 1/SUB_BUCKETS.
+ * When statistics are requested (see getStatistics and addMetrics) the
+ * histograms of all threads are merged.
+ *
+ * Like PerfStats, this class should never be constructed; it offers only
+ * static methods.
+ */
+class RpcLatency {
+  PUBLIC:
+    /// The times that are recorded for each RPC.
+    enum Metric {
+        /// From when the WorkerManager receives the request until a worker
+        /// starts executing it (includes time spent in a Level queue).
+        QUEUE_WAIT = 0,
+        /// Time the worker spends executing the request.
+        SERVICE    = 1,
+        /// From when the WorkerManager receives the request until its
+        /// response has been passed to the transport.
+        TOTAL      = 2,
+        NUM_METRICS = 3
+    };
+
+    /**
+     * Add a sample to the calling thread's histogram for an opcode and
+     * metric.
+     *
+     * \param opcode
+     *      Opcode of the RPC; must be less than WireFormat::ILLEGAL_RPC_TYPE.
+     * \param metric
+     *      Which of the RPC's times is being recorded.
+     * \param cycles
+     *      The time, in Cycles::rdtsc ticks.
+     */
+    static inline void
+    record(uint32_t opcode, Metric metric, uint64_t cycles)
+    {
+        ThreadStats* stats = threadStats;
+        if (expect_false(stats == NULL))
+            stats = registerThread();
+        if (expect_false(stats->generation != generation))
+            stats->clear(generation);
+        Counts* counts = stats->counts[opcode];
+        if (expect_false(counts == NULL))
+            counts = stats->allocate(opcode);
+        counts->buckets[metric][bucketIndex(cycles)]++;
+        counts->totalCycles[metric] += cycles;
+        if (cycles > counts->maxCycles[metric])
+            counts->maxCycles[metric] = cycles;
+    }
+
+    static void addMetrics(ProtoBuf::MetricList* list);
+    static void getStatistics(ProtoBuf::ServerStatistics* serverStats);
+    static const char* metricName(uint32_t metric);
+    static void reset();
+
+    /// Number of buckets each power of two is divided into; must be a power
+    /// of two.
+    static const uint32_t SUB_BUCKETS = 16;
+
+    /// log2(SUB_BUCKETS).
+    static const uint32_t SUB_BUCKET_BITS = 4;
+
+    /// Number of buckets needed to cover all 64-bit values.
+    static const uint32_t NUM_BUCKETS =
+            (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  PRIVATE:
+    /**
+     * Return the index of the histogram bucket that holds a value. Values
+     * less than 2 * SUB_BUCKETS each have a bucket of their own; above
+     * that, each power of two is split into SUB_BUCKETS equal buckets.
+     *
+     * \param value
+     *      The value to be recorded.
+     */
+    static inline uint32_t
+    bucketIndex(uint64_t value)
+    {
+        if (value < 2 * SUB_BUCKETS)
+            return static_cast<uint32_t>(value);
+        uint32_t shift = static_cast<uint32_t>(BitOps::findLastSet(value)) -
+                1 - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS +
+                static_cast<uint32_t>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t bucketLimit(uint32_t index);
+
+    /// The histograms kept by one thread for one opcode. Only the owning
+    /// thread modifies them; other threads read them without synchronization
+    /// (like PerfStats), so they may see slightly stale values.
+    struct Counts {
+        Counts()
+            : buckets()
+            , totalCycles()
+            , maxCycles()
+        {}
+
+        /// Number of samples in each bucket, for each Metric.
+        uint64_t buckets[NUM_METRICS][NUM_BUCKETS];
+
+        /// Sum of all of the samples for each Metric.
+        uint64_t totalCycles[NUM_METRICS];
+
+        /// Largest sample for each Metric.
+        uint64_t maxCycles[NUM_METRICS];
+
+        DISALLOW_COPY_AND_ASSIGN(Counts);
+    };
+
+    /// All of the histograms kept by one thread.
+    struct ThreadStats {
+        ThreadStats();
+        Counts* allocate(uint32_t opcode);
+        void clear(uint64_t newGeneration);
+
+        /// Histograms for each opcode; NULL until the thread records the
+        /// first sample for that opcode. Histograms are allocated lazily
+        /// because each thread sees only a few opcodes.
+        Counts* counts[WireFormat::ILLEGAL_RPC_TYPE];
+
+        /// The value of RpcLatency::generation when the histograms were last
+        /// cleared; if it's out of date, the histograms are ignored when
+        /// merging and cleared before the next sample is recorded.
+        volatile uint64_t generation;
+
+        DISALLOW_COPY_AND_ASSIGN(ThreadStats);
+    };
+
+    /// The merged histogram for one opcode and metric.
+    struct Summary {
+        Summary()
+            : buckets(NUM_BUCKETS, 0)
+            , count(0)
+            , totalCycles(0)
+            , maxCycles(0)
+        {}
+
+        uint64_t getPercentile(double fraction);
+
+        std::vector<uint64_t> buckets;
+        uint64_t count;
+        uint64_t totalCycles;
+        uint64_t maxCycles;
+    };
+
+    /// Merged histograms, keyed by opcode * NUM_METRICS + metric.
+    typedef std::map<uint32_t, Summary> Summaries;
+
+    RpcLatency();
+    static void merge(Summaries* summaries);
+    static ThreadStats* registerThread();
+
+    /// This thread's histograms; NULL until the thread records its first
+    /// sample.
+    static __thread ThreadStats* threadStats;
+
+    /// Incremented by reset; see ThreadStats::generation.
+    static volatile uint64_t generation;
+
+    /// Protects registeredStats.
+    static SpinLock mutex;
+
+    /// The histograms of every thread that has recorded a sample. Like
+    /// PerfStats, these are never freed, since their threads may still
+    /// be running.
+    static std::vector<ThreadStats*> registeredStats;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_RPCLATENCY_H
@@ -0,0 +1,181 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "Cycles.h"
+#include "MetricList.pb.h"
+#include "RpcLatency.h"
+#include "ServerStatistics.pb.h"
+
+namespace RAMCloud {
+
+class RpcLatencyTest : public ::testing::Test {
+  public:
+    typedef RpcLatency L;
+
+    RpcLatencyTest()
+    {
+        // With this setting, cycles and nanoseconds are the same.
+        Cycles::mockCyclesPerSec = 1e9;
+        L::reset();
+    }
+
+    ~RpcLatencyTest()
+    {
+        L::reset();
+        Cycles::mockCyclesPerSec = 0;
+    }
+
+    /**
+     * Return a description of the merged histograms: for each opcode and
+     * metric, the number of samples and the largest one.
+     */
+    string
+    statistics()
+    {
+        ProtoBuf::ServerStatistics serverStats;
+        L::getStatistics(&serverStats);
+        string result;
+        foreach (const ProtoBuf::ServerStatistics::RpcLatency& latency,
+                serverStats.rpc_latency()) {
+            if (!result.empty())
+                result += " | ";
+            result += format("%s %s: %lu max %lu",
+                    WireFormat::opcodeSymbol(latency.opcode()),
+                    L::metricName(latency.metric()),
+                    latency.count(), latency.max_ns());
+        }
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcLatencyTest);
+};
+
+TEST_F(RpcLatencyTest, record_mergeThreads) {
+    L::record(WireFormat::READ, L::TOTAL, 1000);
+    L::record(WireFormat::READ, L::SERVICE, 700);
+    std::thread thread([] {
+        L::record(WireFormat::READ, L::TOTAL, 3000);
+        L::record(WireFormat::WRITE, L::QUEUE_WAIT, 50);
+    });
+    thread.join();
+    EXPECT_EQ("READ service: 1 max 700 | READ total: 2 max 3000 | "
+            "WRITE queueWait: 1 max 50", statistics());
+}
+
+TEST_F(RpcLatencyTest, bucketIndex) {
+    EXPECT_EQ(0u, L::bucketIndex(0));
+    EXPECT_EQ(31u, L::bucketIndex(31));
+    EXPECT_EQ(32u, L::bucketIndex(32));
+    EXPECT_EQ(32u, L::bucketIndex(33));
+    EXPECT_EQ(33u, L::bucketIndex(34));
+    EXPECT_EQ(47u, L::bucketIndex(63));
+    EXPECT_EQ(48u, L::bucketIndex(64));
+    EXPECT_EQ(48u, L::bucketIndex(67));
+    EXPECT_EQ(49u, L::bucketIndex(68));
+    EXPECT_EQ(L::NUM_BUCKETS - 1, L::bucketIndex(~0UL));
+}
+
+TEST_F(RpcLatencyTest, bucketLimit) {
+    EXPECT_EQ(5u, L::bucketLimit(5));
+    EXPECT_EQ(33u, L::bucketLimit(32));
+    EXPECT_EQ(67u, L::bucketLimit(48));
+    EXPECT_EQ(~0UL, L::bucketLimit(L::NUM_BUCKETS - 1));
+    for (uint32_t i = 0; i < L::NUM_BUCKETS - 1; i++) {
+        EXPECT_EQ(i, L::bucketIndex(L::bucketLimit(i)));
+        EXPECT_EQ(i + 1, L::bucketIndex(L::bucketLimit(i) + 1));
+    }
+}
+
+TEST_F(RpcLatencyTest, addMetrics) {
+    for (uint64_t i = 1; i <= 1000; i++)
+        L::record(WireFormat::READ, L::TOTAL, i == 1000 ? 100000 : 1000);
+    ProtoBuf::MetricList list;
+    L::addMetrics(&list);
+    string metrics;
+    foreach (const ProtoBuf::MetricList::Entry& metric, list.metric()) {
+        metrics += format("%s%s %lu", metrics.empty() ? "" : ", ",
+                metric.name().c_str(), metric.value());
+    }
+    EXPECT_EQ("rpcLatency.READ.total.count 1000, "
+            "rpcLatency.READ.total.totalNs 1099000, "
+            "rpcLatency.READ.total.p50Ns 1023, "
+            "rpcLatency.READ.total.p99Ns 1023, "
+            "rpcLatency.READ.total.p999Ns 1023, "
+            "rpcLatency.READ.total.maxNs 100000", metrics);
+}
+
+TEST_F(RpcLatencyTest, getStatistics) {
+    L::record(WireFormat::WRITE, L::SERVICE, 10);
+    L::record(WireFormat::WRITE, L::SERVICE, 10);
+    L::record(WireFormat::WRITE, L::SERVICE, 100);
+    ProtoBuf::ServerStatistics serverStats;
+    L::getStatistics(&serverStats);
+    ASSERT_EQ(1, serverStats.rpc_latency_size());
+    const ProtoBuf::ServerStatistics::RpcLatency& latency =
+            serverStats.rpc_latency(0);
+    EXPECT_EQ(uint32_t(WireFormat::WRITE), latency.opcode());
+    EXPECT_EQ(uint32_t(L::SERVICE), latency.metric());
+    EXPECT_EQ(3lu, latency.count());
+    EXPECT_EQ(120lu, latency.total_ns());
+    EXPECT_EQ(100lu, latency.max_ns());
+    EXPECT_EQ(10lu, latency.p50_ns());
+    EXPECT_EQ(100lu, latency.p99_ns());
+    ASSERT_EQ(2, latency.bucket_size());
+    EXPECT_EQ(10lu, latency.bucket(0).limit_ns());
+    EXPECT_EQ(2lu, latency.bucket(0).count());
+    EXPECT_EQ(103lu, latency.bucket(1).limit_ns());
+    EXPECT_EQ(1lu, latency.bucket(1).count());
+}
+
+TEST_F(RpcLatencyTest, metricName) {
+    EXPECT_STREQ("queueWait", L::metricName(L::QUEUE_WAIT));
+    EXPECT_STREQ("total", L::metricName(L::TOTAL));
+    EXPECT_STREQ("unknown", L::metricName(L::NUM_METRICS));
+}
+
+TEST_F(RpcLatencyTest, reset) {
+    L::record(WireFormat::READ, L::TOTAL, 1000);
+    std::thread thread([] {
+        L::record(WireFormat::WRITE, L::TOTAL, 2000);
+    });
+    thread.join();
+    L::reset();
+    EXPECT_EQ("", statistics());
+
+    // This thread clears its histograms when it records its next sample;
+    // the other thread's are still ignored.
+    L::record(WireFormat::READ, L::TOTAL, 500);
+    EXPECT_EQ("READ total: 1 max 500", statistics());
+}
+
+TEST_F(RpcLatencyTest, getPercentile) {
+    L::Summary summary;
+    EXPECT_EQ(0lu, summary.getPercentile(0.5));
+    for (uint64_t i = 1; i <= 100; i++) {
+        summary.buckets[L::bucketIndex(i)]++;
+        summary.count++;
+    }
+    summary.maxCycles = 100;
+    EXPECT_EQ(1lu, summary.getPercentile(0.0));
+    EXPECT_EQ(25lu, summary.getPercentile(0.25));
+    EXPECT_EQ(51lu, summary.getPercentile(0.5));
+    EXPECT_EQ(99lu, summary.getPercentile(0.99));
+    EXPECT_EQ(100lu, summary.getPercentile(1.0));
+}
+
+} // namespace RAMCloud
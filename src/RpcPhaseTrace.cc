@@ -0,0 +1,368 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "RpcPhaseTrace.h"
+#include "Fence.h"
+#include "Logger.h"
+#include "ShortMacros.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+volatile bool RpcPhaseTrace::enabled = false;
+__thread uint64_t RpcPhaseTrace::currentRpcId = 0;
+__thread uint32_t RpcPhaseTrace::currentOpcode = 0;
+__thread RpcPhaseTrace::ThreadBuffer* RpcPhaseTrace::threadBuffer = NULL;
+SpinLock RpcPhaseTrace::mutex("RpcPhaseTrace::mutex");
+std::vector<RpcPhaseTrace::ThreadBuffer*> RpcPhaseTrace::threadBuffers;
+std::unordered_map<uint64_t, RpcPhaseTrace::PendingEvent>
+        RpcPhaseTrace::pendingEvents;
+std::map<uint32_t, Histogram> RpcPhaseTrace::histograms;
+uint64_t RpcPhaseTrace::unmatchedEvents = 0;
+uint64_t RpcPhaseTrace::lastEviction = 0;
+std::thread* RpcPhaseTrace::drainThread = NULL;
+volatile bool RpcPhaseTrace::drainThreadShouldExit = false;
+
+/**
+ * Events are left in the thread buffers until they are at least this old,
+ * so that events recorded at about the same time in different threads are
+ * paired in the order they happened even if some were still being written
+ * when drain ran.
+ */
+static const uint64_t SETTLE_NS = 100 * 1000;
+
+/**
+ * Events that have waited this long for the other end of their phase are
+ * discarded: the other end was dropped, or the RPC was abandoned.
+ */
+static const uint64_t STALE_NS = 1000 * 1000 * 1000;
+
+/**
+ * Process all of the events in the thread buffers that are old enough
+ * (see SETTLE_NS): pair each with the other end of its phase and store the
+ * duration of the phase in the appropriate histogram. Normally invoked
+ * periodically by the drain thread, but it may be called at any time.
+ */
+void
+RpcPhaseTrace::drain()
+{
+    SpinLock::Guard _(mutex);
+    uint64_t now = Cycles::rdtsc();
+    uint64_t cutoff = now - Cycles::fromNanoseconds(SETTLE_NS);
+
+    std::vector<Event> events;
+    foreach (ThreadBuffer* buffer, threadBuffers) {
+        uint64_t head = buffer->head.load();
+        Fence::enter();
+        uint64_t i;
+        for (i = buffer->tail.load(); i < head; i++) {
+            Event& event = buffer->events[i & (ThreadBuffer::SIZE - 1)];
+            if (event.timestamp > cutoff)
+                break;
+            events.push_back(event);
+        }
+        Fence::leave();
+        buffer->tail.store(i);
+    }
+
+    // Each buffer is in time order, but the two ends of a phase may be in
+    // different buffers.
+    std::sort(events.begin(), events.end(),
+            [](const Event& a, const Event& b) {
+                return a.timestamp < b.timestamp;
+            });
+    foreach (const Event& event, events) {
+        pairEvent(event);
+    }
+
+    if (now - lastEviction > Cycles::fromNanoseconds(STALE_NS)) {
+        evictStaleEvents(now);
+        lastEviction = now;
+    }
+}
+
+/**
+ * Return a human-readable name for a phase.
+ *
+ * \param phase
+ *      One of the values of Phase.
+ */
+const char*
+RpcPhaseTrace::phaseName(uint32_t phase)
+{
+    switch (phase) {
+        case DISPATCH_RECEIVE:  return "dispatch receive";
+        case WORKER_HANDOFF:    return "worker handoff";
+        case LOG_APPEND:        return "log append";
+        case REPLICATION_SYNC:  return "replication sync";
+        case RESPONSE_SEND:     return "response send";
+    }
+    return "unknown";
+}
+
+/**
+ * Discard all of the histograms and any events that haven't been processed
+ * yet.
+ */
+void
+RpcPhaseTrace::reset()
+{
+    SpinLock::Guard _(mutex);
+    foreach (ThreadBuffer* buffer, threadBuffers) {
+        buffer->tail.store(buffer->head.load());
+        buffer->dropped.store(0);
+    }
+    pendingEvents.clear();
+    histograms.clear();
+    unmatchedEvents = 0;
+    lastEviction = 0;
+}
+
+/**
+ * Return the current histograms, after draining the thread buffers.
+ *
+ * \param[out] out
+ *      Filled in with one entry for each opcode and phase for which there
+ *      are samples, in order of opcode and phase.
+ */
+void
+RpcPhaseTrace::serialize(ProtoBuf::RpcPhaseHistograms* out)
+{
+    drain();
+    SpinLock::Guard _(mutex);
+    out->Clear();
+    for (auto& it : histograms) {
+        ProtoBuf::RpcPhaseHistograms::Entry* entry = out->add_entry();
+        entry->set_opcode(it.first / NUM_PHASES);
+        entry->set_phase(it.first % NUM_PHASES);
+        it.second.serialize(*entry->mutable_histogram());
+    }
+    uint64_t dropped = 0;
+    foreach (ThreadBuffer* buffer, threadBuffers) {
+        dropped += buffer->dropped.load();
+    }
+    out->set_dropped_events(dropped);
+    out->set_unmatched_events(unmatchedEvents);
+}
+
+/**
+ * Start recording trace points, and start a thread that aggregates them
+ * periodically. Does nothing if tracing is already running.
+ *
+ * \param intervalMs
+ *      How often to aggregate the recorded trace points, in milliseconds.
+ *      0 means no thread is started; drain must be called explicitly.
+ */
+void
+RpcPhaseTrace::start(uint32_t intervalMs)
+{
+    SpinLock::Guard _(mutex);
+    enabled = true;
+    if ((drainThread == NULL) && (intervalMs != 0)) {
+        drainThreadShouldExit = false;
+        drainThread = new std::thread(drainThreadMain, intervalMs);
+    }
+}
+
+/**
+ * Stop recording trace points, and stop the drain thread if it is running.
+ * The histograms are retained.
+ */
+void
+RpcPhaseTrace::stop()
+{
+    std::thread* thread;
+    {
+        SpinLock::Guard _(mutex);
+        enabled = false;
+        thread = drainThread;
+        drainThread = NULL;
+        drainThreadShouldExit = true;
+    }
+    if (thread != NULL) {
+        thread->join();
+        delete thread;
+    }
+}
+
+/**
+ * Return a human-readable summary of histograms retrieved from a server:
+ * one line for each opcode and phase, with latencies in microseconds.
+ *
+ * \param histograms
+ *      Result of serialize (typically from a GET_RPC_PHASE_HISTOGRAMS
+ *      server control).
+ */
+string
+RpcPhaseTrace::toString(const ProtoBuf::RpcPhaseHistograms& histograms)
+{
+    string s = format("%-24s %-16s %10s %8s %8s %8s %8s %8s\n",
+            "opcode", "phase", "count", "avg", "median", "99%",
+            "99.9%", "max");
+    foreach (const ProtoBuf::RpcPhaseHistograms::Entry& entry,
+            histograms.entry()) {
+        Histogram histogram(entry.histogram());
+        s += format("%-24s %-16s %10lu %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+                WireFormat::opcodeSymbol(entry.opcode()),
+                phaseName(entry.phase()),
+                histogram.getTotalSamples(),
+                1e-03 * static_cast<double>(histogram.getAverage()),
+                1e-03 * static_cast<double>(histogram.getPercentile(0.5)),
+                1e-03 * static_cast<double>(histogram.getPercentile(0.99)),
+                1e-03 * static_cast<double>(histogram.getPercentile(0.999)),
+                1e-03 * static_cast<double>(histogram.getMax()));
+    }
+    if (histograms.dropped_events() != 0 ||
+            histograms.unmatched_events() != 0) {
+        s += format("%lu trace points dropped, %lu unmatched\n",
+                histograms.dropped_events(), histograms.unmatched_events());
+    }
+    return s;
+}
+
+/**
+ * Allocate a buffer for the calling thread and add it to the list of
+ * buffers that are drained.
+ */
+RpcPhaseTrace::ThreadBuffer*
+RpcPhaseTrace::createThreadBuffer()
+{
+    SpinLock::Guard _(mutex);
+    threadBuffer = new ThreadBuffer;
+    threadBuffers.push_back(threadBuffer);
+    return threadBuffer;
+}
+
+/**
+ * Main loop of the drain thread: call drain every intervalMs until asked
+ * to exit by stop().
+ *
+ * \param intervalMs
+ *      Time between calls to drain, in milliseconds.
+ */
+void
+RpcPhaseTrace::drainThreadMain(uint32_t intervalMs)
+{
+    LOG(NOTICE, "RPC phase tracing started (interval %u ms)", intervalMs);
+    while (1) {
+        Fence::lfence();
+        if (drainThreadShouldExit)
+            break;
+        drain();
+        usleep(1000 * intervalMs);
+    }
+}
+
+/**
+ * Discard events that have been waiting too long for the other end of
+ * their phase (see STALE_NS). The caller must hold #mutex.
+ *
+ * \param now
+ *      Current Cycles::rdtsc time.
+ */
+void
+RpcPhaseTrace::evictStaleEvents(uint64_t now)
+{
+    uint64_t staleCycles = Cycles::fromNanoseconds(STALE_NS);
+    for (auto it = pendingEvents.begin(); it != pendingEvents.end(); ) {
+        if (now - it->second.timestamp > staleCycles) {
+            unmatchedEvents++;
+            it = pendingEvents.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+/**
+ * Match an event with the other end of its phase, if it has been seen,
+ * and add the duration of the phase to its histogram; otherwise save the
+ * event until the other end shows up. The caller must hold #mutex.
+ *
+ * \param event
+ *      The next event, in time order.
+ */
+void
+RpcPhaseTrace::pairEvent(const Event& event)
+{
+    uint64_t key = (event.rpcId << 3) | event.phase;
+    auto it = pendingEvents.find(key);
+    if (it == pendingEvents.end()) {
+        pendingEvents[key] = {event.timestamp, event.opcode, event.edge};
+        return;
+    }
+
+    PendingEvent& other = it->second;
+    if (other.edge == event.edge) {
+        // The other end of the earlier event was lost (e.g. a buffer was
+        // full); keep the newer one.
+        unmatchedEvents++;
+        other = {event.timestamp, event.opcode, event.edge};
+        return;
+    }
+
+    // The END normally comes after the START, but they may be swapped if
+    // they were recorded at almost the same time in different threads.
+    uint64_t startTime = other.timestamp;
+    uint64_t endTime = event.timestamp;
+    uint32_t opcode = other.opcode;
+    if (event.edge == START) {
+        std::swap(startTime, endTime);
+        opcode = event.opcode;
+    }
+    uint64_t elapsed = (endTime > startTime) ? endTime - startTime : 0;
+    pendingEvents.erase(it);
+
+    uint32_t histogramKey = opcode * NUM_PHASES + event.phase;
+    auto histogram = histograms.find(histogramKey);
+    if (histogram == histograms.end()) {
+        histogram = histograms.emplace(histogramKey,
+                Histogram(HISTOGRAM_BUCKETS, HISTOGRAM_BUCKET_WIDTH_NS)).first;
+    }
+    histogram->second.storeSample(Cycles::toNanoseconds(elapsed));
+}
+
+/**
+ * Does the work of record and Scope once it's known that tracing is
+ * running: append an event to the calling thread's buffer.
+ *
+ * \copydetails record(uint64_t, uint32_t, Phase, Edge, uint64_t)
+ */
+void
+RpcPhaseTrace::recordInternal(uint64_t rpcId, uint32_t opcode, Phase phase,
+        Edge edge, uint64_t timestamp)
+{
+    ThreadBuffer* buffer = threadBuffer;
+    if (expect_false(buffer == NULL)) {
+        buffer = createThreadBuffer();
+    }
+    uint64_t head = buffer->head.load();
+    if (head - buffer->tail.load() >= ThreadBuffer::SIZE) {
+        buffer->dropped.add(1);
+        return;
+    }
+    Event& event = buffer->events[head & (ThreadBuffer::SIZE - 1)];
+    event.timestamp = timestamp;
+    event.rpcId = rpcId;
+    event.opcode = static_cast<uint16_t>(opcode);
+    event.phase = static_cast<uint8_t>(phase);
+    event.edge = static_cast<uint8_t>(edge);
+    Fence::leave();
+    buffer->head.store(head + 1);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,295 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCPHASETRACE_H
+#define RAMCLOUD_RPCPHASETRACE_H
+
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "Cycles.h"
+#include "Histogram.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * This class continuously turns trace points in the server's RPC path into
+ * per-opcode latency histograms for each phase of an RPC's execution, so
+ * that the source of tail latency can be found on a running server without
+ * dumping and hand-analyzing a TimeTrace.
+ *
+ * Each phase is delimited by a START and an END trace point that carry the
+ * id of the RPC (on servers, the address of its Transport::ServerRpc). The
+ * two ends of a phase may be recorded in different threads (e.g. a handoff
+ * starts in the dispatch thread and ends in a worker). As with TimeTrace,
+ * trace points go into per-thread buffers, so recording one takes only a
+ * few nanoseconds and no synchronization. A background thread (see start)
+ * regularly drains the buffers, orders their events by time, pairs the
+ * START and END of each phase of each RPC and stores the elapsed time in
+ * the histogram for that opcode and phase. The histograms can be
+ * retrieved at any time with the GET_RPC_PHASE_HISTOGRAMS server control.
+ *
+ * Trace points are ignored unless tracing has been started. Like TimeTrace,
+ * this class should never be constructed; it offers only static methods.
+ */
+class RpcPhaseTrace {
+  PUBLIC:
+    /// The phases of an RPC that are measured.
+    enum Phase {
+        /// From when the dispatch thread gets the request until it hands
+        /// it to a worker (includes waiting for a worker to be free).
+        DISPATCH_RECEIVE = 0,
+        /// From the handoff until the worker starts executing the request.
+        WORKER_HANDOFF   = 1,
+        /// Appending entries to the log (including waiting for the log's
+        /// append lock).
+        LOG_APPEND       = 2,
+        /// Waiting for appended entries to be replicated to backups.
+        REPLICATION_SYNC = 3,
+        /// From when the worker makes the response available until the
+        /// dispatch thread has passed it to the transport.
+        RESPONSE_SEND    = 4,
+        NUM_PHASES       = 5
+    };
+
+    /// Which end of a phase a trace point marks.
+    enum Edge {
+        START = 0,
+        END   = 1
+    };
+
+    /**
+     * Record the start or end of a phase of an RPC in the calling thread's
+     * buffer. Does nothing if tracing hasn't been started.
+     *
+     * \param rpcId
+     *      Identifies the RPC; the same id must be used for all of its trace
+     *      points, and no other RPC in progress at the same time may use it.
+     *      Only the low 61 bits are significant.
+     * \param opcode
+     *      Opcode of the RPC (one of WireFormat::Opcode).
+     * \param phase
+     *      The phase that is starting or ending.
+     * \param edge
+     *      START or END.
+     */
+    static inline void
+    record(uint64_t rpcId, uint32_t opcode, Phase phase, Edge edge)
+    {
+        if (expect_true(!enabled))
+            return;
+        recordInternal(rpcId, opcode, phase, edge, Cycles::rdtsc());
+    }
+
+    /**
+     * \copydoc record(uint64_t, uint32_t, Phase, Edge)
+     * \param timestamp
+     *      Time of the event, in Cycles::rdtsc ticks.
+     */
+    static inline void
+    record(uint64_t rpcId, uint32_t opcode, Phase phase, Edge edge,
+            uint64_t timestamp)
+    {
+        if (expect_true(!enabled))
+            return;
+        recordInternal(rpcId, opcode, phase, edge, timestamp);
+    }
+
+    /**
+     * Worker threads call this method before executing an RPC, so that
+     * trace points deep in the master (see Scope) can be attributed to it.
+     *
+     * \param rpcId
+     *      Id of the RPC that the calling thread is about to execute, or 0
+     *      once the RPC has completed.
+     * \param opcode
+     *      Opcode of the RPC.
+     */
+    static inline void
+    setCurrentRpc(uint64_t rpcId, uint32_t opcode)
+    {
+        currentRpcId = rpcId;
+        currentOpcode = opcode;
+    }
+
+    /**
+     * Objects of this class record the START and END of a phase for the
+     * RPC that the current thread is executing (see setCurrentRpc) when
+     * they are constructed and destroyed. Nothing is recorded if the thread
+     * isn't executing an RPC or tracing isn't running.
+     */
+    class Scope {
+      public:
+        explicit Scope(Phase phase)
+            : phase(phase)
+            , rpcId(enabled ? currentRpcId : 0)
+        {
+            if (rpcId != 0)
+                recordInternal(rpcId, currentOpcode, phase, START,
+                        Cycles::rdtsc());
+        }
+
+        ~Scope()
+        {
+            if (rpcId != 0)
+                recordInternal(rpcId, currentOpcode, phase, END,
+                        Cycles::rdtsc());
+        }
+
+      PRIVATE:
+        /// The phase being measured.
+        Phase phase;
+
+        /// The RPC the phase belongs to; 0 means don't record anything.
+        uint64_t rpcId;
+
+        DISALLOW_COPY_AND_ASSIGN(Scope);
+    };
+
+    static void drain();
+    static const char* phaseName(uint32_t phase);
+    static void reset();
+    static void serialize(ProtoBuf::RpcPhaseHistograms* histograms);
+    static void start(uint32_t intervalMs);
+    static void stop();
+    static string toString(const ProtoBuf::RpcPhaseHistograms& histograms);
+
+    /// Number of buckets in each histogram.
+    static const uint64_t HISTOGRAM_BUCKETS = 10000;
+
+    /// Width of each histogram bucket, in nanoseconds: samples up to 1 ms
+    /// are recorded at 100 ns resolution, longer ones count as outliers.
+    static const uint64_t HISTOGRAM_BUCKET_WIDTH_NS = 100;
+
+  PRIVATE:
+    /// A trace point, as stored in the per-thread buffers.
+    struct Event {
+        /// Cycles::rdtsc time of the event.
+        uint64_t timestamp;
+
+        /// Id of the RPC.
+        uint64_t rpcId;
+
+        /// Opcode of the RPC.
+        uint16_t opcode;
+
+        /// A Phase.
+        uint8_t phase;
+
+        /// An Edge.
+        uint8_t edge;
+    };
+
+    /**
+     * Holds the events recorded by a single thread until they are drained.
+     * The owning thread is the only producer, and drain (holding #mutex) is
+     * the only consumer.
+     */
+    struct ThreadBuffer {
+        ThreadBuffer()
+            : events()
+            , head(0)
+            , tail(0)
+            , dropped(0)
+        {}
+
+        /// Must be a power of two.
+        static const uint32_t SIZE = 1 << 14;
+
+        /// Circular array of events; the event with index i is stored at
+        /// events[i % SIZE].
+        Event events[SIZE];
+
+        /// Index of the next event to be recorded; only modified by the
+        /// owning thread.
+        Atomic<uint64_t> head;
+
+        /// Index of the oldest event that hasn't been drained; only
+        /// modified by drain.
+        Atomic<uint64_t> tail;
+
+        /// Number of events discarded because the buffer was full.
+        Atomic<uint64_t> dropped;
+
+        DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+    };
+
+    /// An unmatched START or END that drain is holding until it sees the
+    /// other end of its phase.
+    struct PendingEvent {
+        uint64_t timestamp;
+        uint16_t opcode;
+        uint8_t edge;
+    };
+
+    RpcPhaseTrace();
+    static ThreadBuffer* createThreadBuffer();
+    static void drainThreadMain(uint32_t intervalMs);
+    static void evictStaleEvents(uint64_t now);
+    static void pairEvent(const Event& event);
+    static void recordInternal(uint64_t rpcId, uint32_t opcode, Phase phase,
+            Edge edge, uint64_t timestamp);
+
+    /// Trace points are ignored unless this is true.
+    static volatile bool enabled;
+
+    /// Id of the RPC that this thread is executing (0 if none).
+    static __thread uint64_t currentRpcId;
+
+    /// Opcode of currentRpcId.
+    static __thread uint32_t currentOpcode;
+
+    /// This thread's buffer; NULL until the thread records its first event.
+    static __thread ThreadBuffer* threadBuffer;
+
+    /// Serializes drain, reset and serialize, and protects everything
+    /// below.
+    static SpinLock mutex;
+
+    /// All of the buffers that have been created. Like TimeTrace, buffers
+    /// are never freed, since threads that exit may have left events in
+    /// them.
+    static std::vector<ThreadBuffer*> threadBuffers;
+
+    /// Events waiting for the other end of their phase, keyed by
+    /// (rpcId << 3) | phase.
+    static std::unordered_map<uint64_t, PendingEvent> pendingEvents;
+
+    /// The histograms, keyed by opcode * NUM_PHASES + phase. Samples are
+    /// in nanoseconds.
+    static std::map<uint32_t, Histogram> histograms;
+
+    /// Number of trace points that were discarded because the other end of
+    /// their phase never showed up (e.g. it was dropped).
+    static uint64_t unmatchedEvents;
+
+    /// Cycles::rdtsc time when evictStaleEvents last ran.
+    static uint64_t lastEviction;
+
+    /// Thread that calls drain periodically; NULL if not running. A pointer
+    /// rather than a Tub avoids problems with static destruction order.
+    static std::thread* drainThread;
+
+    /// Set by stop() to ask the drain thread to exit.
+    static volatile bool drainThreadShouldExit;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_RPCPHASETRACE_H
@@ -0,0 +1,246 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "RpcPhaseTrace.h"
+#include "StringUtil.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+class RpcPhaseTraceTest : public ::testing::Test {
+  public:
+    typedef RpcPhaseTrace T;
+
+    RpcPhaseTraceTest()
+    {
+        // With these settings, cycles and nanoseconds are the same.
+        Cycles::mockCyclesPerSec = 1e9;
+        Cycles::mockTscValue = 10000000000lu;
+        T::reset();
+        T::start(0);
+    }
+
+    ~RpcPhaseTraceTest()
+    {
+        T::stop();
+        T::reset();
+        T::setCurrentRpc(0, 0);
+        Cycles::mockTscValue = 0;
+        Cycles::mockCyclesPerSec = 0;
+    }
+
+    /**
+     * Drain the trace and return a description of the histograms: for each
+     * opcode and phase, the number of samples and the largest sample.
+     */
+    string
+    histograms()
+    {
+        ProtoBuf::RpcPhaseHistograms histograms;
+        T::serialize(&histograms);
+        string result;
+        foreach (const ProtoBuf::RpcPhaseHistograms::Entry& entry,
+                histograms.entry()) {
+            Histogram histogram(entry.histogram());
+            if (!result.empty())
+                result += " | ";
+            result += format("%s %s: %lu max %lu",
+                    WireFormat::opcodeSymbol(entry.opcode()),
+                    T::phaseName(entry.phase()),
+                    histogram.getTotalSamples(), histogram.getMax());
+        }
+        if (histograms.dropped_events() != 0 ||
+                histograms.unmatched_events() != 0) {
+            result += format(" (%lu dropped, %lu unmatched)",
+                    histograms.dropped_events(),
+                    histograms.unmatched_events());
+        }
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcPhaseTraceTest);
+};
+
+TEST_F(RpcPhaseTraceTest, record_notStarted) {
+    T::stop();
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START, 1000);
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::END, 2000);
+    T::start(0);
+    EXPECT_EQ("", histograms());
+}
+
+TEST_F(RpcPhaseTraceTest, record_bufferFull) {
+    for (uint32_t i = 0; i < T::ThreadBuffer::SIZE + 2; i++) {
+        T::record(i + 1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START,
+                1000);
+    }
+    EXPECT_EQ(2lu, T::threadBuffer->dropped.load());
+    T::reset();
+    EXPECT_EQ(0lu, T::threadBuffer->dropped.load());
+
+    // Once drained, there is room again.
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START, 1000);
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::END, 1500);
+    EXPECT_EQ("READ dispatch receive: 1 max 500", histograms());
+}
+
+TEST_F(RpcPhaseTraceTest, Scope) {
+    {
+        // No current RPC: nothing is recorded.
+        T::Scope _(T::LOG_APPEND);
+        Cycles::mockTscValue += 1000;
+    }
+    T::setCurrentRpc(5, WireFormat::WRITE);
+    {
+        T::Scope _(T::LOG_APPEND);
+        Cycles::mockTscValue += 700;
+    }
+    {
+        T::Scope _(T::REPLICATION_SYNC);
+        Cycles::mockTscValue += 3000;
+    }
+    T::setCurrentRpc(0, 0);
+    Cycles::mockTscValue += 1000000;
+    EXPECT_EQ("WRITE log append: 1 max 700 | "
+            "WRITE replication sync: 1 max 3000", histograms());
+}
+
+TEST_F(RpcPhaseTraceTest, drain_pairAcrossThreads) {
+    uint64_t start = Cycles::mockTscValue - 50000000;
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START, start);
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::END, start + 200);
+    T::record(1, WireFormat::READ, T::WORKER_HANDOFF, T::START, start + 200);
+    std::thread worker([start] {
+        T::record(1, WireFormat::READ, T::WORKER_HANDOFF, T::END,
+                start + 1200);
+        T::record(1, WireFormat::READ, T::RESPONSE_SEND, T::START,
+                start + 5000);
+    });
+    worker.join();
+    T::record(1, WireFormat::READ, T::RESPONSE_SEND, T::END, start + 5300);
+    EXPECT_EQ("READ dispatch receive: 1 max 200 | "
+            "READ worker handoff: 1 max 1000 | "
+            "READ response send: 1 max 300", histograms());
+}
+
+TEST_F(RpcPhaseTraceTest, drain_leaveRecentEvents) {
+    uint64_t now = Cycles::mockTscValue;
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START,
+            now - 200000);
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::END, now - 10);
+    EXPECT_EQ("", histograms());
+    EXPECT_EQ(1u, T::pendingEvents.size());
+    EXPECT_EQ(1lu, T::threadBuffer->head.load() -
+            T::threadBuffer->tail.load());
+
+    Cycles::mockTscValue += 1000000;
+    EXPECT_EQ("READ dispatch receive: 1 max 199990", histograms());
+    EXPECT_EQ(0u, T::pendingEvents.size());
+}
+
+TEST_F(RpcPhaseTraceTest, drain_evictStaleEvents) {
+    uint64_t now = Cycles::mockTscValue;
+    T::record(1, WireFormat::READ, T::DISPATCH_RECEIVE, T::START, now - 2000);
+    T::drain();
+    EXPECT_EQ(1u, T::pendingEvents.size());
+
+    // Not stale yet.
+    Cycles::mockTscValue += 500000000;
+    T::drain();
+    EXPECT_EQ(1u, T::pendingEvents.size());
+
+    Cycles::mockTscValue += 1000000000;
+    EXPECT_EQ(" (0 dropped, 1 unmatched)", histograms());
+    EXPECT_EQ(0u, T::pendingEvents.size());
+}
+
+TEST_F(RpcPhaseTraceTest, pairEvent) {
+    T::Event event = {1000, 7, WireFormat::READ, T::LOG_APPEND, T::START};
+    T::pairEvent(event);
+
+    // Another START for the same phase of the same RPC: the first one is
+    // given up.
+    event.timestamp = 2000;
+    T::pairEvent(event);
+    EXPECT_EQ(1lu, T::unmatchedEvents);
+
+    // The END pairs with the remaining START; a different phase or RPC
+    // doesn't.
+    event = {2500, 7, WireFormat::READ, T::REPLICATION_SYNC, T::END};
+    T::pairEvent(event);
+    event = {2500, 8, WireFormat::READ, T::LOG_APPEND, T::END};
+    T::pairEvent(event);
+    event = {2600, 7, WireFormat::READ, T::LOG_APPEND, T::END};
+    T::pairEvent(event);
+    EXPECT_EQ(2u, T::pendingEvents.size());
+
+    // An END may be seen before its START.
+    event = {1000, 8, WireFormat::READ, T::LOG_APPEND, T::START};
+    T::pairEvent(event);
+    EXPECT_EQ(1u, T::pendingEvents.size());
+
+    // The remaining event is long past, so it's discarded as stale.
+    EXPECT_EQ("READ log append: 2 max 1500 (0 dropped, 2 unmatched)",
+            histograms());
+}
+
+TEST_F(RpcPhaseTraceTest, serialize) {
+    uint64_t start = Cycles::mockTscValue - 50000000;
+    T::record(1, WireFormat::WRITE, T::LOG_APPEND, T::START, start);
+    T::record(1, WireFormat::WRITE, T::LOG_APPEND, T::END, start + 100);
+    T::record(2, WireFormat::READ, T::RESPONSE_SEND, T::START, start);
+    T::record(2, WireFormat::READ, T::RESPONSE_SEND, T::END, start + 200);
+    T::record(3, WireFormat::READ, T::DISPATCH_RECEIVE, T::START, start);
+    T::record(3, WireFormat::READ, T::DISPATCH_RECEIVE, T::END,
+            start + 2000000);
+
+    ProtoBuf::RpcPhaseHistograms histograms;
+    T::serialize(&histograms);
+    ASSERT_EQ(3, histograms.entry_size());
+    EXPECT_EQ(uint32_t(WireFormat::READ), histograms.entry(0).opcode());
+    EXPECT_EQ(uint32_t(T::DISPATCH_RECEIVE), histograms.entry(0).phase());
+    EXPECT_EQ(1lu, histograms.entry(0).histogram().outliers());
+    EXPECT_EQ(T::HISTOGRAM_BUCKETS,
+            histograms.entry(0).histogram().num_buckets());
+    EXPECT_EQ(T::HISTOGRAM_BUCKET_WIDTH_NS,
+            histograms.entry(0).histogram().bucket_width());
+    EXPECT_EQ(uint32_t(WireFormat::READ), histograms.entry(1).opcode());
+    EXPECT_EQ(uint32_t(T::RESPONSE_SEND), histograms.entry(1).phase());
+    EXPECT_EQ(uint32_t(WireFormat::WRITE), histograms.entry(2).opcode());
+    EXPECT_EQ(uint32_t(T::LOG_APPEND), histograms.entry(2).phase());
+}
+
+TEST_F(RpcPhaseTraceTest, toString) {
+    uint64_t start = Cycles::mockTscValue - 50000000;
+    for (uint64_t i = 1; i <= 100; i++) {
+        T::record(i, WireFormat::READ, T::WORKER_HANDOFF, T::START, start);
+        T::record(i, WireFormat::READ, T::WORKER_HANDOFF, T::END,
+                start + (i == 100 ? 50000 : 1000));
+    }
+    ProtoBuf::RpcPhaseHistograms histograms;
+    T::serialize(&histograms);
+    EXPECT_EQ("opcode                   phase                 count      "
+            "avg   median      99%    99.9%      max\n"
+            "READ                     worker handoff          100      "
+            "1.5      1.0      1.0     50.0     50.0\n",
+            T::toString(histograms));
+
+    histograms.set_unmatched_events(3);
+    EXPECT_TRUE(StringUtil::endsWith(T::toString(histograms),
+            "0 trace points dropped, 3 unmatched\n"));
+}
+
+} // namespace RAMCloud
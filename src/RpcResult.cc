@@ -182,6 +182,53 @@ RpcResult::assembleForLog(void* memBlock)
     memcpy(dst + sizeof32(header), getResp(), respLength);
 }
 
+/**
+ * Append this RpcResult to a buffer that already holds an object, as
+ * assembled by Object::assembleForLog, so that the buffer's contents can be
+ * appended to the log as a single LOG_ENTRY_TYPE_OBJRPCRESULT entry.
+ *
+ * \param buffer
+ *      Buffer holding the serialized object and nothing after it.
+ */
+void
+RpcResult::assembleForLogWithObject(Buffer& buffer)
+{
+    assembleForLog(buffer);
+    buffer.emplaceAppend<uint16_t>(downCast<uint16_t>(respLength));
+}
+
+/**
+ * Return the length of the object at the start of a
+ * LOG_ENTRY_TYPE_OBJRPCRESULT entry.
+ *
+ * \param buffer
+ *      Buffer whose contents from \a offset to the end are the entry.
+ * \param offset
+ *      Offset in \a buffer of the start of the entry.
+ */
+uint32_t
+RpcResult::objectLengthInCombinedEntry(Buffer& buffer, uint32_t offset)
+{
+    return buffer.size() - offset - sizeof32(uint16_t) -
+            lengthInCombinedEntry(buffer);
+}
+
+/**
+ * Return the length of the RpcResult in a LOG_ENTRY_TYPE_OBJRPCRESULT entry.
+ * The RpcResult starts right after the object (see
+ * #objectLengthInCombinedEntry).
+ *
+ * \param buffer
+ *      Buffer which ends with the entry.
+ */
+uint32_t
+RpcResult::lengthInCombinedEntry(Buffer& buffer)
+{
+    const uint16_t* length =
+            buffer.getOffset<uint16_t>(buffer.size() - sizeof32(uint16_t));
+    return sizeof32(Header) + *length;
+}
+
 /**
  * Append the response portion of this RpcResult to a provided
  * buffer.
@@ -39,6 +39,15 @@ namespace RAMCloud {
  * +------------------+----------+
  * | RpcResult Header | Response |
  * +------------------+----------+
+ *
+ * A linearizable write stores its RpcResult in the same log entry as the
+ * object it wrote (LOG_ENTRY_TYPE_OBJRPCRESULT), which saves the metadata,
+ * hash computations and cleaning work of a second entry. That entry has the
+ * following layout, where the trailer holds the length of the response:
+ *
+ * +--------+------------------+----------+-----------------+
+ * | Object | RpcResult Header | Response | uint16_t length |
+ * +--------+------------------+----------+-----------------+
  */
 class RpcResult {
   public:
@@ -53,8 +62,13 @@ class RpcResult {
 
     void assembleForLog(Buffer& buffer);
     void assembleForLog(void* buffer);
+    void assembleForLogWithObject(Buffer& buffer);
     void appendRespToBuffer(Buffer& buffer);
 
+    static uint32_t objectLengthInCombinedEntry(Buffer& buffer,
+                                                uint32_t offset = 0);
+    static uint32_t lengthInCombinedEntry(Buffer& buffer);
+
     uint64_t getTableId();
     KeyHash getKeyHash();
     uint64_t getLeaseId();
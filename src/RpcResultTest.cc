@@ -184,6 +184,30 @@ TEST_F(RpcResultTest, assembleForLog_contigMemory) {
     }
 }
 
+TEST_F(RpcResultTest, assembleForLogWithObject) {
+    Buffer buffer;
+    buffer.appendCopy("object", 6);
+    rpcResultFromResponse->assembleForLogWithObject(buffer);
+    EXPECT_EQ(6 + sizeof(RpcResult::Header) +
+              sizeof(WireFormat::Write::Response) + 2, buffer.size());
+    EXPECT_EQ(sizeof(WireFormat::Write::Response),
+              *buffer.getOffset<uint16_t>(buffer.size() - 2));
+
+    EXPECT_EQ(6U, RpcResult::objectLengthInCombinedEntry(buffer));
+    EXPECT_EQ(rpcResultFromResponse->getSerializedLength(),
+              RpcResult::lengthInCombinedEntry(buffer));
+
+    RpcResult record(buffer, 6, RpcResult::lengthInCombinedEntry(buffer));
+    EXPECT_EQ(10UL, record.getRpcId());
+    EXPECT_EQ(sizeof32(WireFormat::Write::Response), record.getRespLength());
+
+    // An offset skips bytes preceding the entry.
+    Buffer prefixed;
+    prefixed.appendCopy("xx", 2);
+    prefixed.appendExternal(&buffer, 0, buffer.size());
+    EXPECT_EQ(6U, RpcResult::objectLengthInCombinedEntry(prefixed, 2));
+}
+
 TEST_F(RpcResultTest, appendRespToBuffer) {
     for (uint32_t i = 0; i < arrayLength(records); i++) {
         RpcResult& record = *records[i];
@@ -64,6 +64,9 @@ struct ServerConfig {
         , maxObjectDataSize(segmentSize / 4)
         , maxObjectKeySize((64 * 1024) - 1)
         , maxCores(2)
+        , perfStatsSampleIntervalMs(0)
+        , perfStatsHistorySamples(1000)
+        , rpcPhaseTraceIntervalMs(0)
         , master(testing)
         , backup(testing)
     {}
@@ -88,6 +91,9 @@ struct ServerConfig {
         , maxObjectDataSize(segmentSize / 8)
         , maxObjectKeySize((64 * 1024) - 1)
         , maxCores(2)
+        , perfStatsSampleIntervalMs(0)
+        , perfStatsHistorySamples(6000)
+        , rpcPhaseTraceIntervalMs(0)
         , master()
         , backup()
     {}
@@ -137,6 +143,9 @@ struct ServerConfig {
         config.set_max_object_data_size(maxObjectDataSize);
         config.set_max_object_key_size(maxObjectKeySize);
         config.set_max_cores(maxCores);
+        config.set_perf_stats_sample_interval_ms(perfStatsSampleIntervalMs);
+        config.set_perf_stats_history_samples(perfStatsHistorySamples);
+        config.set_rpc_phase_trace_interval_ms(rpcPhaseTraceIntervalMs);
 
         if (services.has(WireFormat::MASTER_SERVICE))
             master.serialize(*config.mutable_master());
@@ -217,6 +226,27 @@ struct ServerConfig {
      */
     uint32_t maxCores;
 
+    /**
+     * If nonzero, the server records a sample of its PerfStats every this
+     * many milliseconds, for retrieval with the GET_PERF_STATS_HISTORY
+     * server control (see PerfStatsSampler). 0 disables sampling.
+     */
+    uint32_t perfStatsSampleIntervalMs;
+
+    /**
+     * Number of PerfStats samples retained by the server when
+     * perfStatsSampleIntervalMs is nonzero; older samples are discarded.
+     */
+    uint32_t perfStatsHistorySamples;
+
+    /**
+     * If nonzero, the server traces the phases of the RPCs it executes and
+     * aggregates the trace into latency histograms every this many
+     * milliseconds, for retrieval with the GET_RPC_PHASE_HISTOGRAMS server
+     * control (see RpcPhaseTrace). 0 disables tracing.
+     */
+    uint32_t rpcPhaseTraceIntervalMs;
+
     /**
      * Configuration details specific to the MasterService on a server,
      * if any.  If !config.has(MASTER_SERVICE) then this field is ignored.
@@ -240,6 +270,12 @@ struct ServerConfig {
             , useMinCopysets(false)
             , usePlusOneBackup(false)
             , allowLocalBackup(false)
+            , objectChunkSize(0)
+            , snapshotWindowMs(0)
+            , maxSnapshotVersions(0)
+            , txLockWaitUs(0)
+            , txLockMaxWaiters(0)
+            , snapshotDir()
         {}
 
         /**
@@ -261,6 +297,12 @@ struct ServerConfig {
             , useMinCopysets()
             , usePlusOneBackup()
             , allowLocalBackup()
+            , objectChunkSize()
+            , snapshotWindowMs()
+            , maxSnapshotVersions()
+            , txLockWaitUs()
+            , txLockMaxWaiters()
+            , snapshotDir()
         {}
 
         /**
@@ -282,6 +324,12 @@ struct ServerConfig {
             config.set_use_mincopysets(useMinCopysets);
             config.set_use_plusonebackup(usePlusOneBackup);
             config.set_use_local_backup(allowLocalBackup);
+            config.set_object_chunk_size(objectChunkSize);
+            config.set_snapshot_window_ms(snapshotWindowMs);
+            config.set_max_snapshot_versions(maxSnapshotVersions);
+            config.set_tx_lock_wait_us(txLockWaitUs);
+            config.set_tx_lock_max_waiters(txLockMaxWaiters);
+            config.set_snapshot_dir(snapshotDir);
         }
 
         /**
@@ -304,6 +352,12 @@ struct ServerConfig {
             useMinCopysets = config.use_mincopysets();
             usePlusOneBackup = config.use_plusonebackup();
             allowLocalBackup = config.use_local_backup();
+            objectChunkSize = config.object_chunk_size();
+            snapshotWindowMs = config.snapshot_window_ms();
+            maxSnapshotVersions = config.max_snapshot_versions();
+            txLockWaitUs = config.tx_lock_wait_us();
+            txLockMaxWaiters = config.tx_lock_max_waiters();
+            snapshotDir = config.snapshot_dir();
         }
 
         /// Total number bytes to use for the in-memory Log.
@@ -355,6 +409,35 @@ struct ServerConfig {
 
         /// If true, allow replication to local backup.
         bool allowLocalBackup;
+
+        /// Objects whose values are larger than this many bytes are split
+        /// into chunks of at most this size, each stored in its own log
+        /// entry, so that they need not fit in a single segment. 0 disables
+        /// chunking.
+        uint32_t objectChunkSize;
+
+        /// Versions of objects that have been overwritten or removed are
+        /// retained for this many milliseconds, so that snapshot reads (see
+        /// ObjectHistory) can be served. 0 disables snapshot reads.
+        uint32_t snapshotWindowMs;
+
+        /// Upper bound on the number of prior versions retained for
+        /// snapshot reads at once. 0 disables snapshot reads.
+        uint32_t maxSnapshotVersions;
+
+        /// Longest time, in microseconds, that a transaction prepare which
+        /// finds an object locked waits for the lock before voting to abort
+        /// (see LockTable::admit). 0 means such prepares abort immediately.
+        uint32_t txLockWaitUs;
+
+        /// Upper bound on the number of transaction prepares waiting for
+        /// the lock on any one object.
+        uint32_t txLockMaxWaiters;
+
+        /// Directory holding the files written by EXPORT_SNAPSHOT and read
+        /// by IMPORT_SNAPSHOT; the file names in those requests are
+        /// relative to it. Empty means the master refuses both requests.
+        string snapshotDir;
     } master;
 
     /**
@@ -369,6 +452,7 @@ struct ServerConfig {
         Backup(Testing) // NOLINT
             : gc(false)
             , inMemory(true)
+            , persistentMemory(false)
             , sync(false)
             , numSegmentFrames(4)
             , maxNonVolatileBuffers(0)
@@ -377,6 +461,7 @@ struct ServerConfig {
             , strategy(1)
             , mockSpeed(100)
             , writeRateLimit(0)
+            , writeGroupSize(1)
         {}
 
         /**
@@ -387,6 +472,7 @@ struct ServerConfig {
         Backup()
             : gc(true)
             , inMemory(false)
+            , persistentMemory(false)
             , sync(false)
             , numSegmentFrames(512)
             , maxNonVolatileBuffers(0)
@@ -395,6 +481,7 @@ struct ServerConfig {
             , strategy(1)
             , mockSpeed(0)
             , writeRateLimit(0)
+            , writeGroupSize(1)
         {}
 
         /**
@@ -405,6 +492,7 @@ struct ServerConfig {
         {
             config.set_gc(gc);
             config.set_in_memory(inMemory);
+            config.set_persistent_memory(persistentMemory);
             config.set_num_segment_frames(numSegmentFrames);
             config.set_max_non_volatile_buffers(maxNonVolatileBuffers);
             config.set_max_recovery_replicas(maxRecoveryReplicas);
@@ -413,6 +501,7 @@ struct ServerConfig {
             config.set_strategy(strategy);
             config.set_mock_speed(mockSpeed);
             config.set_write_rate_limit(writeRateLimit);
+            config.set_write_group_size(writeGroupSize);
         }
 
         /**
@@ -424,6 +513,7 @@ struct ServerConfig {
         {
             gc = config.gc();
             inMemory = config.in_memory();
+            persistentMemory = config.persistent_memory();
             numSegmentFrames = config.num_segment_frames();
             maxNonVolatileBuffers = config.max_non_volatile_buffers();
             maxRecoveryReplicas = config.max_recovery_replicas();
@@ -432,6 +522,7 @@ struct ServerConfig {
             strategy = config.strategy();
             mockSpeed = config.mock_speed();
             writeRateLimit = config.write_rate_limit();
+            writeGroupSize = config.write_group_size();
         }
 
         /**
@@ -445,6 +536,14 @@ struct ServerConfig {
         /// Whether the BackupService should store replicas in RAM or on disk.
         bool inMemory;
 
+        /**
+         * If true (and #inMemory is false), #file is memory-mapped and
+         * replicas are persisted with cache line flushes (see PmemStorage);
+         * intended for a file on a DAX filesystem backed by persistent
+         * memory.
+         */
+        bool persistentMemory;
+
         /**
          * If true backups block until data from calls to writeSegment have
          * been written to storage. Setting this to false is only safe if
@@ -497,6 +596,16 @@ struct ServerConfig {
          * If non-0, limit writes to backup to this many megabytes per second.
          */
         size_t writeRateLimit;
+
+        /**
+         * Maximum number of replicas whose new data is written to storage
+         * in a single batch, followed by one sync of each storage file
+         * (rather than opening the files O_SYNC so that every write is
+         * synchronous). Larger groups turn many small writes from many
+         * masters into fewer, larger, sorted writes. 1 means each replica
+         * is written separately.
+         */
+        uint32_t writeGroupSize;
     } backup;
 
   public:
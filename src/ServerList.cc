@@ -115,10 +115,11 @@ ServerList::operator[](uint32_t index)
  *    care restarting backups may inadvertently discard important segment
  *    replicas. The ordering is upheld by the current CoordinatorServerList
  *    implementation in two ways:
- *    a) Update lists are only single-entry only and dispatched in the order
- *       they were generated. The coordinator code is ordered carefully to
- *       ensure the REMOVE/CRASHED for the old server precedes the UP of the
- *       enlisting server.
+ *    a) Update lists are dispatched in the order they were generated, and
+ *       an update that coalesces several versions lists their entries in
+ *       the order they were generated. The coordinator code is ordered
+ *       carefully to ensure the REMOVE/CRASHED for the old server precedes
+ *       the UP of the enlisting server.
  *    b) Full lists are the only multi-entry lists; the entries are in the
  *       order they appear in the coordinator server list structure. Because
  *       "slots" in that structure are reused it is possible that an
@@ -163,9 +164,12 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
             return version;
         }
     } else {
-        // Ignore an update unless its version number exactly follows
-        // the local version number.
-        if (list.version_number() != version + 1) {
+        // Ignore an update unless it starts exactly at the local version
+        // number. An update normally covers just its own version, but it
+        // may coalesce several (see base_version in ServerList.proto).
+        uint64_t baseVersion = list.has_base_version() ? list.base_version()
+                : list.version_number() - 1;
+        if (baseVersion != version) {
             LOG(NOTICE, "Ignoring out-of order server list update with "
                     "version %lu (local server list is at version %lu)",
                     list.version_number(), version);
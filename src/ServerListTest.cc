@@ -106,6 +106,32 @@ TEST_F(ServerListTest, applyServerList_wrongVersion) {
             TestLog::get());
 }
 
+TEST_F(ServerListTest, applyServerList_coalescedUpdate) {
+    ProtoBuf::ServerList update;
+    ServerListBuilder{update}
+        ({}, *ServerId{1, 0}, "mock:host=one", 101, 1)
+        ({}, *ServerId{2, 0}, "mock:host=two", 102, 1)
+        ({}, *ServerId{1, 0}, "mock:host=one", 101, 1, ServerStatus::CRASHED);
+    update.set_type(ProtoBuf::ServerList_Type_UPDATE);
+    update.set_version_number(13);
+    update.set_base_version(9);
+    sl.version = 10;
+
+    // Doesn't start at the local version.
+    TestLog::Enable _;
+    EXPECT_EQ(10lu, sl.applyServerList(update));
+    EXPECT_EQ("applyServerList: Ignoring out-of order server list update "
+            "with version 13 (local server list is at version 10)",
+            TestLog::get());
+
+    update.set_base_version(10);
+    EXPECT_EQ(13lu, sl.applyServerList(update));
+    EXPECT_FALSE(sl.isUp({1, 0}));
+    EXPECT_TRUE(sl.contains({1, 0}));
+    EXPECT_TRUE(sl.isUp({2, 0}));
+    EXPECT_EQ(3lu, tr.changes.size());
+}
+
 TEST_F(ServerListTest, applyServerList_success) {
     // Apply Full List
     ProtoBuf::ServerList wholeList;
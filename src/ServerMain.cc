@@ -111,6 +111,11 @@ main(int argc, char *argv[])
             ("backupInMemory,m",
              ProgramOptions::bool_switch(&config.backup.inMemory),
              "Backup will store segment replicas in memory")
+            ("backupPersistentMemory",
+             ProgramOptions::bool_switch(&config.backup.persistentMemory),
+             "Backup will memory-map its file (which should be on a DAX "
+             "filesystem backed by persistent memory) and persist segment "
+             "replicas with cache line flushes instead of block IO")
             ("backupOnly,B",
              ProgramOptions::bool_switch(&backupOnly),
              "The server should run the backup service only (no master)")
@@ -126,6 +131,14 @@ main(int argc, char *argv[])
              "of bandwidth this backup should use. Useful for artificially "
              "restricting bandwidth when measuring various parts of the "
              "system.")
+            ("backupWriteGroupSize",
+             ProgramOptions::value<uint32_t>(
+                &config.backup.writeGroupSize)->default_value(1),
+             "Maximum number of replicas whose new data the backup writes to "
+             "storage together, followed by a single fdatasync. Values "
+             "greater than 1 batch the small writes from many masters into "
+             "fewer, larger ones; 1 writes each replica separately with "
+             "O_SYNC.")
             ("cleanerBalancer",
              ProgramOptions::value<string>(&config.master.cleanerBalancer)->
                 default_value("tombstoneRatio:0.40"),
@@ -196,6 +209,18 @@ main(int argc, char *argv[])
                &config.backup.maxRecoveryReplicas)->default_value(20),
              "Maximum number of replicas any given master recovery will buffer "
              "in memory.")
+            ("perfStatsHistorySamples",
+             ProgramOptions::value<uint32_t>(
+                &config.perfStatsHistorySamples)->default_value(6000),
+             "Number of PerfStats samples the server retains for "
+             "GET_PERF_STATS_HISTORY (see perfStatsSampleInterval).")
+            ("perfStatsSampleInterval",
+             ProgramOptions::value<uint32_t>(
+                &config.perfStatsSampleIntervalMs)->default_value(0),
+             "If nonzero, a background thread records the server's "
+             "PerfStats every this many milliseconds so that clients "
+             "(e.g. DumpPerfStats --history) can retrieve a time series "
+             "of the server's activity.")
             ("preferredIndex",
              ProgramOptions::value<uint32_t>(
                 &config.preferredIndex)->default_value(0),
@@ -205,6 +230,14 @@ main(int argc, char *argv[])
             ("replicas,r",
              ProgramOptions::value<uint32_t>(&config.master.numReplicas),
              "Number of backup copies to make for each segment")
+            ("rpcPhaseTraceInterval",
+             ProgramOptions::value<uint32_t>(
+                &config.rpcPhaseTraceIntervalMs)->default_value(0),
+             "If nonzero, the server traces the phases of each RPC it "
+             "executes (dispatch, handoff, log append, replication, "
+             "response) and aggregates them into per-opcode latency "
+             "histograms every this many milliseconds, for retrieval "
+             "with DumpPerfStats --phases.")
             ("segmentFrames",
              ProgramOptions::value<uint32_t>(&config.backup.numSegmentFrames)->
                 default_value(512),
@@ -242,6 +275,45 @@ main(int argc, char *argv[])
                 default_value(false),
              "Whether to use (masterServerId+1)modulo n or random "
              "replication for backupServerId")
+            ("objectChunkSize",
+             ProgramOptions::value<uint32_t>(
+                &config.master.objectChunkSize)->default_value(1024 * 1024),
+             "Objects with values larger than this many bytes are stored as "
+             "a sequence of chunks of at most this size, so they may span "
+             "segments (0 disables chunking; must be well below the "
+             "segment size)")
+            ("snapshotDir",
+             ProgramOptions::value<string>(&config.master.snapshotDir)->
+                default_value(""),
+             "Directory in which tablet snapshots are written and from "
+             "which they are loaded (see RamCloud::exportTabletSnapshot); "
+             "snapshot file names must be relative to it. Snapshots are "
+             "disabled if this is empty")
+            ("snapshotWindow",
+             ProgramOptions::value<uint32_t>(
+                &config.master.snapshotWindowMs)->default_value(0),
+             "Number of milliseconds for which overwritten and removed "
+             "versions of objects are retained to serve snapshot reads in "
+             "read-only transactions. Retaining versions adds work to every "
+             "write and holds on to log memory (versions are discarded if "
+             "the log runs short). 0, the default, disables snapshot reads")
+            ("maxSnapshotVersions",
+             ProgramOptions::value<uint32_t>(
+                &config.master.maxSnapshotVersions)->default_value(100000),
+             "Maximum number of overwritten and removed versions of objects "
+             "retained at once to serve snapshot reads (0 disables snapshot "
+             "reads)")
+            ("txLockWait",
+             ProgramOptions::value<uint32_t>(
+                &config.master.txLockWaitUs)->default_value(0),
+             "Number of microseconds a transaction prepare may wait for an "
+             "object locked by another transaction before voting to abort "
+             "(0 means abort immediately)")
+            ("txLockMaxWaiters",
+             ProgramOptions::value<uint32_t>(
+                &config.master.txLockMaxWaiters)->default_value(16),
+             "Maximum number of transaction prepares waiting for the lock "
+             "on any one object; additional ones abort")
             ("writeCostThreshold,w",
              ProgramOptions::value<uint32_t>(
                 &config.master.cleanerWriteCostThreshold)->default_value(8),
@@ -21,6 +21,7 @@
 
 #include "Buffer.h"
 #include "ServerMetrics.h"
+#include "StringUtil.h"
 
 namespace RAMCloud {
 
@@ -79,6 +80,22 @@ ServerMetrics::~ServerMetrics() {
     // Nothing to do here.
 }
 
+/**
+ * Returns true if the given metric is a latency percentile or maximum
+ * (see RpcLatency::addMetrics). These describe all of the samples recorded
+ * since the server started, so they can't be differenced.
+ *
+ * \param name
+ *      Name of a metric.
+ */
+bool
+ServerMetrics::isLatencyStatistic(const string& name)
+{
+    return StringUtil::startsWith(name, "rpcLatency.") &&
+            StringUtil::endsWith(name, "Ns") &&
+            !StringUtil::endsWith(name, ".totalNs");
+}
+
 /**
  * Given another ServerMetrics, compute a new ServerMetrics object by
  * subtracting each value in \c other from the corresponding value in the
@@ -108,7 +125,8 @@ ServerMetrics::difference(ServerMetrics& other)
         if ((it->first.compare("clockFrequency") == 0) ||
                 (it->first.compare("pid") == 0) ||
                 (it->first.compare("serverId") == 0) ||
-                (it->first.compare("segmentSize") == 0)) {
+                (it->first.compare("segmentSize") == 0) ||
+                isLatencyStatistic(it->first)) {
             diff[it->first] = it->second;
         } else {
             diff[it->first] = it->second - otherValue;
@@ -93,6 +93,8 @@ class ServerMetrics {
     };
 
   PRIVATE:
+    static bool isLatencyStatistic(const string& name);
+
     /// Holds all of the metrics.
     std::unordered_map<std::string, uint64_t> metrics;
 };
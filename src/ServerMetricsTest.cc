@@ -91,6 +91,24 @@ TEST_F(ServerMetricsTest, difference_skipSpecialValues) {
     EXPECT_EQ(30U, diff["serverId"]);
 }
 
+TEST_F(ServerMetricsTest, difference_latencyStatistics) {
+    ServerMetrics metrics;
+    metrics["rpcLatency.READ.total.count"] = 10;
+    metrics["rpcLatency.READ.total.totalNs"] = 20;
+    metrics["rpcLatency.READ.total.p99Ns"] = 30;
+    metrics["rpcLatency.READ.total.maxNs"] = 40;
+    ServerMetrics metrics2;
+    metrics2["rpcLatency.READ.total.count"] = 1;
+    metrics2["rpcLatency.READ.total.totalNs"] = 2;
+    metrics2["rpcLatency.READ.total.p99Ns"] = 3;
+    metrics2["rpcLatency.READ.total.maxNs"] = 4;
+    ServerMetrics diff = metrics.difference(metrics2);
+    EXPECT_EQ(9U, diff["rpcLatency.READ.total.count"]);
+    EXPECT_EQ(18U, diff["rpcLatency.READ.total.totalNs"]);
+    EXPECT_EQ(30U, diff["rpcLatency.READ.total.p99Ns"]);
+    EXPECT_EQ(40U, diff["rpcLatency.READ.total.maxNs"]);
+}
+
 // The following tests are for methods defined in ServerMetrics.h.
 
 TEST_F(ServerMetricsTest, iteration) {
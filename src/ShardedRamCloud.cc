@@ -0,0 +1,158 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ShardedRamCloud.h"
+#include "ObjectFinder.h"
+#include "ThreadId.h"
+#include "TransportManager.h"
+
+namespace RAMCloud {
+
+Atomic<uint64_t> ShardedRamCloud::nextId(1);
+__thread uint64_t ShardedRamCloud::cachedId = 0;
+__thread RamCloud* ShardedRamCloud::cachedShard = NULL;
+Transport* ShardedRamCloud::mockTransport = NULL;
+
+/**
+ * Construct a ShardedRamCloud whose shards are configured from command-line
+ * options.
+ *
+ * \param options
+ *      Options used to create each shard's Context and RamCloud object (see
+ *      RamCloud::RamCloud(CommandLineOptions*)); must outlive this object.
+ */
+ShardedRamCloud::ShardedRamCloud(CommandLineOptions* options)
+    : options(options)
+    , coordinatorLocator()
+    , clusterName()
+    , tableConfigs()
+    , mutex("ShardedRamCloud::mutex")
+    , shards()
+    , id(nextId.inc())
+{
+}
+
+/**
+ * Construct a ShardedRamCloud whose shards use default options.
+ *
+ * \param serviceLocator
+ *      Service locator for the cluster coordinator.
+ * \param clusterName
+ *      Name of the cluster to connect to.
+ */
+ShardedRamCloud::ShardedRamCloud(const char* serviceLocator,
+        const char* clusterName)
+    : options(NULL)
+    , coordinatorLocator(serviceLocator)
+    , clusterName(clusterName)
+    , tableConfigs()
+    , mutex("ShardedRamCloud::mutex")
+    , shards()
+    , id(nextId.inc())
+{
+}
+
+/**
+ * Destructor for ShardedRamCloud: deletes all of the shards. No thread may
+ * use its shard once this method has been invoked.
+ */
+ShardedRamCloud::~ShardedRamCloud()
+{
+    // The shards must go first, since their ObjectFinders refer to
+    // tableConfigs.
+    SpinLock::Guard _(mutex);
+    for (std::unordered_map<int, Shard*>::iterator it = shards.begin();
+            it != shards.end(); it++) {
+        Shard* shard = it->second;
+        delete shard->ramcloud;
+        delete shard->context;
+        delete shard;
+    }
+    shards.clear();
+    if (cachedId == id) {
+        cachedId = 0;
+        cachedShard = NULL;
+    }
+}
+
+/**
+ * Return the calling thread's RamCloud object, creating it if this is the
+ * thread's first call. The object must be used only by the calling thread;
+ * it remains valid until this ShardedRamCloud is destroyed.
+ */
+RamCloud*
+ShardedRamCloud::get()
+{
+    if (cachedId == id)
+        return cachedShard;
+
+    int thread = ThreadId::get();
+    Shard* shard;
+    {
+        SpinLock::Guard _(mutex);
+        std::unordered_map<int, Shard*>::iterator it = shards.find(thread);
+        shard = (it == shards.end()) ? NULL : it->second;
+    }
+    if (shard == NULL) {
+        // Creating a shard may be slow (e.g. it opens transports), so
+        // don't hold the lock while doing it.
+        shard = createShard();
+        SpinLock::Guard _(mutex);
+        shards[thread] = shard;
+    }
+    cachedId = id;
+    cachedShard = shard->ramcloud;
+    return cachedShard;
+}
+
+/**
+ * Return the number of threads that have obtained a shard with #get.
+ */
+size_t
+ShardedRamCloud::getShardCount()
+{
+    SpinLock::Guard _(mutex);
+    return shards.size();
+}
+
+/**
+ * Create the objects for a new shard, with a Context of its own whose
+ * ObjectFinder shares table configurations with the other shards.
+ *
+ * \return
+ *      The new shard; the caller must record it in #shards.
+ */
+ShardedRamCloud::Shard*
+ShardedRamCloud::createShard()
+{
+    Shard* shard = new Shard();
+    if (options != NULL) {
+        shard->context = new Context(false, options);
+    } else {
+        shard->context = new Context(false);
+    }
+    if (mockTransport != NULL)
+        shard->context->transportManager->registerMock(mockTransport);
+    shard->context->objectFinder->shareTableConfigs(&tableConfigs);
+    if (options != NULL) {
+        shard->ramcloud = new RamCloud(shard->context);
+    } else {
+        shard->ramcloud = new RamCloud(shard->context,
+                coordinatorLocator.c_str(), clusterName.c_str());
+    }
+    return shard;
+}
+
+} // namespace RAMCloud
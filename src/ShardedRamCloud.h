@@ -0,0 +1,119 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SHARDEDRAMCLOUD_H
+#define RAMCLOUD_SHARDEDRAMCLOUD_H
+
+#include <unordered_map>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "RamCloud.h"
+#include "SharedTableConfigs.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+class CommandLineOptions;
+class Transport;
+
+/**
+ * A ShardedRamCloud gives each thread of a multi-threaded client a RamCloud
+ * object of its own (a "shard"), so that threads never contend with each
+ * other: each shard has its own Context, and therefore its own Dispatch,
+ * transports and sessions, ObjectFinder, client lease, and RpcTracker (and
+ * hence its own block of RPC ids). The only state the shards share is the
+ * table configurations fetched from the coordinator (see SharedTableConfigs),
+ * which are read without locks, so that a table's configuration is fetched
+ * once per process rather than once per thread.
+ *
+ * Typical usage: create one ShardedRamCloud per process, and have each
+ * thread call #get to obtain its RamCloud object; that object must be used
+ * only by that thread.
+ */
+class ShardedRamCloud {
+  PUBLIC:
+    explicit ShardedRamCloud(CommandLineOptions* options);
+    explicit ShardedRamCloud(const char* serviceLocator,
+            const char* clusterName = "main");
+    ~ShardedRamCloud();
+
+    RamCloud* get();
+    size_t getShardCount();
+
+  PRIVATE:
+    /// The objects belonging to one thread.
+    struct Shard {
+        Shard()
+            : context(NULL)
+            , ramcloud(NULL)
+        {}
+
+        /// The shard's Context; owned by the shard.
+        Context* context;
+
+        /// The shard's client; owned by the shard.
+        RamCloud* ramcloud;
+
+        DISALLOW_COPY_AND_ASSIGN(Shard);
+    };
+
+    Shard* createShard();
+
+    /// If non-NULL, shards are created with these options (which must
+    /// outlive this object); otherwise #coordinatorLocator and #clusterName
+    /// are used.
+    CommandLineOptions* options;
+
+    /// Service locator for the cluster coordinator (unused if #options is
+    /// non-NULL).
+    string coordinatorLocator;
+
+    /// Name of the cluster (unused if #options is non-NULL).
+    string clusterName;
+
+    /// Table configurations shared by the ObjectFinders of all the shards.
+    SharedTableConfigs tableConfigs;
+
+    /// Protects #shards.
+    SpinLock mutex;
+
+    /// The shard of each thread that has called #get, keyed by ThreadId.
+    std::unordered_map<int, Shard*> shards;
+
+    /// Uniquely identifies this object, so that the per-thread cache in #get
+    /// can't be confused by a new object at the same address.
+    const uint64_t id;
+
+    /// Used to assign #id.
+    static Atomic<uint64_t> nextId;
+
+    /// The #id of the ShardedRamCloud whose shard is in #cachedShard, or 0.
+    static __thread uint64_t cachedId;
+
+    /// The calling thread's shard of the ShardedRamCloud whose #id is
+    /// #cachedId; saves a lookup in #shards on each call to #get.
+    static __thread RamCloud* cachedShard;
+
+    /// If non-NULL, this transport is registered as the "mock" transport of
+    /// each new shard (used for unit testing).
+    static Transport* mockTransport;
+
+    DISALLOW_COPY_AND_ASSIGN(ShardedRamCloud);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_SHARDEDRAMCLOUD_H
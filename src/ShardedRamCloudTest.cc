@@ -0,0 +1,117 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "ObjectFinder.h"
+#include "ShardedRamCloud.h"
+
+namespace RAMCloud {
+
+class ShardedRamCloudTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<ShardedRamCloud> sharded;
+
+  public:
+    ShardedRamCloudTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , sharded()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master";
+        cluster.addServer(config);
+
+        ShardedRamCloud::mockTransport = &cluster.transport;
+        sharded.construct("mock:host=coordinator");
+    }
+
+    ~ShardedRamCloudTest()
+    {
+        sharded.destroy();
+        ShardedRamCloud::mockTransport = NULL;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ShardedRamCloudTest);
+};
+
+// Helper function that runs in a separate thread for the following test.
+static void readInThread(ShardedRamCloud* sharded, uint64_t tableId,
+        RamCloud** shard, string* value) {
+    *shard = sharded->get();
+    Buffer buffer;
+    (*shard)->read(tableId, "0", 1, &buffer);
+    *value = TestUtil::toString(&buffer);
+}
+
+TEST_F(ShardedRamCloudTest, get_shardPerThread) {
+    RamCloud* shard = sharded->get();
+    EXPECT_EQ(shard, sharded->get());
+    uint64_t tableId = shard->createTable("table");
+    shard->write(tableId, "0", 1, "abcdef", 6);
+    EXPECT_EQ(1u, sharded->getShardCount());
+
+    RamCloud* otherShard = NULL;
+    string value;
+    std::thread(readInThread, sharded.get(), tableId, &otherShard,
+            &value).join();
+    EXPECT_EQ("abcdef", value);
+    EXPECT_NE(shard, otherShard);
+    EXPECT_NE(shard->clientContext, otherShard->clientContext);
+    EXPECT_NE(shard->rpcTracker, otherShard->rpcTracker);
+    EXPECT_EQ(2u, sharded->getShardCount());
+}
+
+TEST_F(ShardedRamCloudTest, get_differentObjects) {
+    RamCloud* shard = sharded->get();
+    ShardedRamCloud sharded2("mock:host=coordinator");
+    RamCloud* shard2 = sharded2.get();
+    EXPECT_NE(shard, shard2);
+    EXPECT_EQ(shard, sharded->get());
+    EXPECT_EQ(shard2, sharded2.get());
+}
+
+TEST_F(ShardedRamCloudTest, createShard_shareTableConfigs) {
+    RamCloud* shard = sharded->get();
+    uint64_t tableId = shard->createTable("table");
+    shard->write(tableId, "0", 1, "abcdef", 6);
+    EXPECT_EQ(1u, sharded->tableConfigs.current.load()->count(tableId));
+
+    // A configuration that another shard has already fetched is used
+    // without asking the coordinator.
+    ShardedRamCloud::Shard* shard2 = sharded->createShard();
+    TestLog::reset();
+    Buffer value;
+    shard2->ramcloud->read(tableId, "0", 1, &value);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), format(
+            "getSharedConfig: table %lu: using shared configuration",
+            tableId)));
+    delete shard2->ramcloud;
+    delete shard2->context;
+    delete shard2;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,224 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "SharedTableConfigs.h"
+#include "Fence.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a SharedTableConfigs with no configurations.
+ */
+SharedTableConfigs::SharedTableConfigs()
+    : current(new Snapshot())
+    , epoch(1)
+    , mutex("SharedTableConfigs::mutex")
+    , readers()
+    , retired()
+{
+}
+
+/**
+ * Destructor for SharedTableConfigs. All of the Readers must have been
+ * unregistered.
+ */
+SharedTableConfigs::~SharedTableConfigs()
+{
+    assert(readers.empty());
+    for (size_t i = 0; i < retired.size(); i++)
+        delete retired[i].first;
+    delete current.load();
+}
+
+/**
+ * Discard the configuration of a table (e.g. because the table has been
+ * dropped).
+ *
+ * \param tableId
+ *      Table whose configuration is no longer valid.
+ */
+void
+SharedTableConfigs::erase(uint64_t tableId)
+{
+    SpinLock::Guard _(mutex);
+    if (current.load()->count(tableId) == 0)
+        return;
+    Snapshot* snapshot = new Snapshot(*current.load());
+    snapshot->erase(tableId);
+    publish(snapshot);
+}
+
+/**
+ * Return the configuration of a table, if it is more recent than one the
+ * caller already has. This method never blocks.
+ *
+ * \param reader
+ *      The calling thread's Reader.
+ * \param tableId
+ *      Table whose configuration is wanted.
+ * \param knownVersion
+ *      The version of the table's configuration that the caller already
+ *      has (0 if none).
+ * \param[out] version
+ *      If the result is true, the configuration's version is stored here.
+ * \param[out] config
+ *      If the result is true, the configuration is copied here.
+ * \return
+ *      True means a configuration newer than \a knownVersion was returned;
+ *      false means that there is none.
+ */
+bool
+SharedTableConfigs::get(Reader* reader, uint64_t tableId,
+        uint64_t knownVersion, uint64_t* version,
+        ProtoBuf::TableConfig* config)
+{
+    // The exchange is a full fence: the reader's epoch must be visible to
+    // writers before the snapshot pointer is loaded, so that a writer can't
+    // free the snapshot without noticing this reader.
+    reader->epoch.exchange(epoch.load());
+    const Snapshot* snapshot = current.load();
+    Fence::enter();
+
+    bool result = false;
+    Snapshot::const_iterator it = snapshot->find(tableId);
+    if (it != snapshot->end() && it->second->version > knownVersion) {
+        *version = it->second->version;
+        config->CopyFrom(it->second->config);
+        result = true;
+    }
+
+    Fence::leave();
+    reader->epoch.store(0);
+    return result;
+}
+
+/**
+ * Record a configuration that was just fetched from the coordinator, unless
+ * a newer one has already been recorded.
+ *
+ * \param tableId
+ *      Table whose configuration this is.
+ * \param version
+ *      Version of the configuration, as returned by the coordinator; must
+ *      be nonzero.
+ * \param config
+ *      The configuration itself; it is copied.
+ */
+void
+SharedTableConfigs::put(uint64_t tableId, uint64_t version,
+        const ProtoBuf::TableConfig& config)
+{
+    // Build the entry before taking the lock, since copying the
+    // configuration may be slow.
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->version = version;
+    entry->config.CopyFrom(config);
+
+    SpinLock::Guard _(mutex);
+    Snapshot::const_iterator it = current.load()->find(tableId);
+    if (it != current.load()->end() && it->second->version >= version)
+        return;
+    Snapshot* snapshot = new Snapshot(*current.load());
+    (*snapshot)[tableId] = entry;
+    publish(snapshot);
+}
+
+/**
+ * Create a Reader for the calling thread.
+ *
+ * \return
+ *      A Reader to pass to #get. It must eventually be passed to
+ *      #unregisterReader.
+ */
+SharedTableConfigs::Reader*
+SharedTableConfigs::registerReader()
+{
+    Reader* reader = new Reader();
+    SpinLock::Guard _(mutex);
+    readers.push_back(reader);
+    return reader;
+}
+
+/**
+ * Discard a Reader created by #registerReader.
+ *
+ * \param reader
+ *      Reader that will no longer be used.
+ */
+void
+SharedTableConfigs::unregisterReader(Reader* reader)
+{
+    SpinLock::Guard _(mutex);
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (readers[i] == reader) {
+            readers[i] = readers.back();
+            readers.pop_back();
+            break;
+        }
+    }
+    delete reader;
+    reclaim();
+}
+
+/**
+ * Replace the current snapshot and retire the old one. The caller must
+ * hold #mutex.
+ *
+ * \param snapshot
+ *      The new snapshot; this object takes ownership of it.
+ */
+void
+SharedTableConfigs::publish(Snapshot* snapshot)
+{
+    Snapshot* old = current.load();
+    Fence::leave();
+    current.store(snapshot);
+
+    // The increment is a full fence, so the new snapshot is visible before
+    // reclaim looks at the readers' epochs.
+    uint64_t newEpoch = epoch.inc() + 1;
+    retired.push_back(std::make_pair(old, newEpoch));
+    reclaim();
+}
+
+/**
+ * Free the retired snapshots that no reader can still be using. The caller
+ * must hold #mutex.
+ */
+void
+SharedTableConfigs::reclaim()
+{
+    uint64_t oldestEpoch = ~0lu;
+    foreach (Reader* reader, readers) {
+        uint64_t readerEpoch = reader->epoch.load();
+        if (readerEpoch != 0 && readerEpoch < oldestEpoch)
+            oldestEpoch = readerEpoch;
+    }
+
+    // Readers that began in an earlier epoch may have loaded any snapshot
+    // that was current since then.
+    size_t remaining = 0;
+    for (size_t i = 0; i < retired.size(); i++) {
+        if (retired[i].second <= oldestEpoch) {
+            delete retired[i].first;
+        } else {
+            retired[remaining] = retired[i];
+            remaining++;
+        }
+    }
+    retired.resize(remaining);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,128 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SHAREDTABLECONFIGS_H
+#define RAMCLOUD_SHAREDTABLECONFIGS_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "SpinLock.h"
+#include "TableConfig.pb.h"
+
+namespace RAMCloud {
+
+/**
+ * A SharedTableConfigs holds the most recent table configurations (tablet
+ * and indexlet maps) fetched from the coordinator, so that they can be
+ * shared by the ObjectFinders of several clients in the same process (see
+ * ShardedRamCloud). Without it, each client thread would fetch every
+ * table's configuration from the coordinator separately, and would do so
+ * again after every migration or recovery.
+ *
+ * Configurations are read far more often than they change, so the class
+ * uses a simple form of read-copy-update: readers never lock, but load a
+ * pointer to an immutable snapshot of all the configurations. Writers
+ * (serialized by a lock) copy the snapshot, modify the copy, and publish
+ * it; the old snapshot is freed once no reader can still be using it. To
+ * make that possible, each reading thread registers a Reader, which records
+ * the epoch in which the thread's current read began.
+ *
+ * This class is thread-safe.
+ */
+class SharedTableConfigs {
+  PUBLIC:
+    /**
+     * Each thread that calls #get must use a Reader of its own, obtained
+     * from #registerReader.
+     */
+    class Reader {
+      public:
+        Reader()
+            : epoch(0)
+        {}
+
+        /// The value of SharedTableConfigs::epoch when this reader's
+        /// current call to #get began, or 0 if there is no such call.
+        Atomic<uint64_t> epoch;
+
+        DISALLOW_COPY_AND_ASSIGN(Reader);
+    };
+
+    SharedTableConfigs();
+    ~SharedTableConfigs();
+
+    void erase(uint64_t tableId);
+    bool get(Reader* reader, uint64_t tableId, uint64_t knownVersion,
+            uint64_t* version, ProtoBuf::TableConfig* config);
+    void put(uint64_t tableId, uint64_t version,
+            const ProtoBuf::TableConfig& config);
+    Reader* registerReader();
+    void unregisterReader(Reader* reader);
+
+  PRIVATE:
+    /// The configuration of one table.
+    struct Entry {
+        Entry()
+            : version(0)
+            , config()
+        {}
+
+        /// Version of the configuration, as returned by the coordinator.
+        uint64_t version;
+
+        /// The configuration itself.
+        ProtoBuf::TableConfig config;
+
+        DISALLOW_COPY_AND_ASSIGN(Entry);
+    };
+
+    /// An immutable collection of configurations, keyed by table id. The
+    /// entries themselves are shared between snapshots.
+    typedef std::unordered_map<uint64_t, std::shared_ptr<const Entry>>
+            Snapshot;
+
+    void publish(Snapshot* snapshot);
+    void reclaim();
+
+    /// The current snapshot; never NULL. Replaced (never modified) by
+    /// writers.
+    Atomic<Snapshot*> current;
+
+    /// Incremented each time a new snapshot is published. Starts at 1, so
+    /// that 0 can mean "not reading" in Reader::epoch.
+    Atomic<uint64_t> epoch;
+
+    /// Serializes writers, and protects #readers and #retired.
+    SpinLock mutex;
+
+    /// Every Reader that has been registered and not yet unregistered.
+    std::vector<Reader*> readers;
+
+    /// Snapshots that have been replaced but may still be in use, each
+    /// paired with the value of #epoch after it was replaced; a snapshot
+    /// can be freed once every active reader's epoch is at least that
+    /// large.
+    std::vector<std::pair<Snapshot*, uint64_t>> retired;
+
+    DISALLOW_COPY_AND_ASSIGN(SharedTableConfigs);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_SHAREDTABLECONFIGS_H
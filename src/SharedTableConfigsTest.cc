@@ -0,0 +1,144 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "SharedTableConfigs.h"
+
+namespace RAMCloud {
+
+class SharedTableConfigsTest : public ::testing::Test {
+  public:
+    SharedTableConfigs configs;
+    SharedTableConfigs::Reader* reader;
+
+    SharedTableConfigsTest()
+        : configs()
+        , reader(configs.registerReader())
+    {
+    }
+
+    ~SharedTableConfigsTest()
+    {
+        configs.unregisterReader(reader);
+    }
+
+    /**
+     * Record a configuration for a table whose only tablet is stored on
+     * the given server.
+     */
+    void
+    put(uint64_t tableId, uint64_t version, const char* locator)
+    {
+        ProtoBuf::TableConfig config;
+        ProtoBuf::TableConfig::Tablet* tablet = config.add_tablet();
+        tablet->set_table_id(tableId);
+        tablet->set_start_key_hash(0);
+        tablet->set_end_key_hash(~0lu);
+        tablet->set_state(ProtoBuf::TableConfig::Tablet::NORMAL);
+        tablet->set_server_id(1);
+        tablet->set_service_locator(locator);
+        tablet->set_ctime_log_head_id(0);
+        tablet->set_ctime_log_head_offset(0);
+        configs.put(tableId, version, config);
+    }
+
+    /**
+     * Return a description of the configuration of a table that is newer
+     * than knownVersion, or "none".
+     */
+    string
+    get(uint64_t tableId, uint64_t knownVersion)
+    {
+        uint64_t version;
+        ProtoBuf::TableConfig config;
+        if (!configs.get(reader, tableId, knownVersion, &version, &config))
+            return "none";
+        return format("version %lu: %s", version,
+                config.tablet(0).service_locator().c_str());
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(SharedTableConfigsTest);
+};
+
+TEST_F(SharedTableConfigsTest, erase) {
+    put(5, 3, "mock:host=server1");
+    configs.erase(5);
+    EXPECT_EQ("none", get(5, 0));
+
+    // Erasing a table that isn't there doesn't publish a new snapshot.
+    configs.erase(6);
+    EXPECT_EQ(3lu, configs.epoch.load());
+}
+
+TEST_F(SharedTableConfigsTest, get) {
+    EXPECT_EQ("none", get(5, 0));
+    put(5, 3, "mock:host=server1");
+    EXPECT_EQ("version 3: mock:host=server1", get(5, 0));
+    EXPECT_EQ("version 3: mock:host=server1", get(5, 2));
+    EXPECT_EQ("none", get(5, 3));
+    EXPECT_EQ("none", get(6, 0));
+    EXPECT_EQ(0lu, reader->epoch.load());
+}
+
+TEST_F(SharedTableConfigsTest, put) {
+    put(5, 3, "mock:host=server1");
+    put(6, 1, "mock:host=server3");
+
+    // Older (or repeated) versions are ignored.
+    put(5, 2, "mock:host=server2");
+    put(5, 3, "mock:host=server2");
+    EXPECT_EQ("version 3: mock:host=server1", get(5, 0));
+    put(5, 4, "mock:host=server2");
+    EXPECT_EQ("version 4: mock:host=server2", get(5, 0));
+    EXPECT_EQ("version 1: mock:host=server3", get(6, 0));
+}
+
+TEST_F(SharedTableConfigsTest, registerReader) {
+    SharedTableConfigs::Reader* reader2 = configs.registerReader();
+    EXPECT_EQ(2u, configs.readers.size());
+    EXPECT_EQ(reader2, configs.readers[1]);
+    configs.unregisterReader(reader2);
+    EXPECT_EQ(1u, configs.readers.size());
+    EXPECT_EQ(reader, configs.readers[0]);
+}
+
+TEST_F(SharedTableConfigsTest, unregisterReader_reclaim) {
+    SharedTableConfigs::Reader* reader2 = configs.registerReader();
+    reader2->epoch.store(configs.epoch.load());
+    put(5, 1, "mock:host=server1");
+    EXPECT_EQ(1u, configs.retired.size());
+    configs.unregisterReader(reader2);
+    EXPECT_EQ(0u, configs.retired.size());
+}
+
+TEST_F(SharedTableConfigsTest, reclaim) {
+    // A reader that began before a snapshot was replaced keeps it (and all
+    // later ones) alive.
+    reader->epoch.store(configs.epoch.load());
+    put(5, 1, "mock:host=server1");
+    put(5, 2, "mock:host=server1");
+    EXPECT_EQ(2u, configs.retired.size());
+
+    // A reader that began later doesn't need the first snapshot.
+    reader->epoch.store(configs.epoch.load() - 1);
+    configs.reclaim();
+    EXPECT_EQ(1u, configs.retired.size());
+
+    reader->epoch.store(0);
+    configs.reclaim();
+    EXPECT_EQ(0u, configs.retired.size());
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,1433 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHOR(S) BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "Common.h"
+#include "ShortMacros.h"
+#include "ShmTransport.h"
+#include "WireFormat.h"
+#include "WorkerManager.h"
+
+// Older C libraries don't define these.
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+namespace RAMCloud {
+
+/**
+ * Default object used to make system calls.
+ */
+static Syscall defaultSyscall;
+
+/**
+ * Used by this class to make all system calls.  In normal production
+ * use it points to defaultSyscall; for testing it points to a mock
+ * object.
+ */
+Syscall* ShmTransport::sys = &defaultSyscall;
+
+/**
+ * Construct a ShmTransport instance.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server or client.
+ * \param serviceLocator
+ *      If non-NULL this transport will be used to serve incoming RPC
+ *      requests as well as make outgoing requests; the locator's "name"
+ *      option names the socket on which clients open sessions. If NULL
+ *      this transport will be used only for outgoing requests.
+ *
+ * \throw TransportException
+ *      There was a problem that prevented us from creating the transport.
+ */
+ShmTransport::ShmTransport(Context* context,
+        const ServiceLocator* serviceLocator)
+    : context(context)
+    , locatorString()
+    , listenSocket(-1)
+    , acceptHandler()
+    , connections()
+    , nextConnectionId(1)
+    , sessions()
+    , serverRpcPool()
+    , clientRpcPool()
+    , poller(this)
+{
+    if (serviceLocator == NULL)
+        return;
+    struct sockaddr_un address;
+    socklen_t addressLength = getSocketAddress(getSocketName(serviceLocator),
+            &address);
+    locatorString = serviceLocator->getOriginalString();
+
+    listenSocket = sys->socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket == -1) {
+        LOG(WARNING, "ShmTransport couldn't create listen socket: %s",
+                strerror(errno));
+        throw TransportException(HERE,
+                "ShmTransport couldn't create listen socket", errno);
+    }
+
+    int r = sys->fcntl(listenSocket, F_SETFL, O_NONBLOCK);
+    if (r != 0) {
+        sys->close(listenSocket);
+        LOG(WARNING, "ShmTransport couldn't set nonblocking on listen "
+                "socket: %s", strerror(errno));
+        throw TransportException(HERE,
+                "ShmTransport couldn't set nonblocking on listen socket",
+                errno);
+    }
+
+    if (sys->bind(listenSocket, reinterpret_cast<sockaddr*>(&address),
+            addressLength) == -1) {
+        sys->close(listenSocket);
+        string message = format("ShmTransport couldn't bind to '%s'",
+                locatorString.c_str());
+        LOG(WARNING, "%s: %s", message.c_str(), strerror(errno));
+        throw TransportException(HERE, message, errno);
+    }
+
+    if (sys->listen(listenSocket, INT_MAX) == -1) {
+        sys->close(listenSocket);
+        LOG(WARNING, "ShmTransport couldn't listen on socket: %s",
+                strerror(errno));
+        throw TransportException(HERE,
+                "ShmTransport couldn't listen on socket", errno);
+    }
+
+    // Arrange to be notified whenever anyone connects to listenSocket.
+    acceptHandler.construct(listenSocket, this);
+}
+
+/**
+ * Destructor for ShmTransports: close file descriptors, unmap shared
+ * memory, and perform any other needed cleanup.
+ */
+ShmTransport::~ShmTransport()
+{
+    acceptHandler.destroy();
+    if (listenSocket >= 0) {
+        sys->close(listenSocket);
+        listenSocket = -1;
+    }
+    while (!connections.empty()) {
+        closeConnection(connections.begin()->first);
+    }
+    while (!sessions.empty()) {
+        sessions.front().close();
+    }
+}
+
+// See Transport::getSession for documentation.
+Transport::SessionRef
+ShmTransport::getSession(const ServiceLocator* serviceLocator,
+        uint32_t timeoutMs)
+{
+    return new ShmSession(this, serviceLocator);
+}
+
+/**
+ * Close the server's end of a session and clean up all related state.
+ *
+ * \param id
+ *      Identifier of the connection to close.
+ */
+void
+ShmTransport::closeConnection(uint64_t id)
+{
+    std::unordered_map<uint64_t, Connection*>::iterator it =
+            connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection* connection = it->second;
+    int fd = connection->fd;
+    connections.erase(it);
+    delete connection;
+    sys->close(fd);
+}
+
+/**
+ * Return the name of the socket on which the server for a given service
+ * locator accepts sessions.
+ *
+ * \param serviceLocator
+ *      Locator for a server using this transport.
+ *
+ * \throw TransportException
+ *      The locator has no "name" option.
+ */
+string
+ShmTransport::getSocketName(const ServiceLocator* serviceLocator)
+{
+    if (!serviceLocator->hasOption("name")) {
+        throw TransportException(HERE, format(
+                "ShmTransport service locator '%s' is missing the "
+                "'name' option", serviceLocator->getOriginalString().c_str()));
+    }
+    return "ramcloud-shm:" + serviceLocator->getOption("name");
+}
+
+/**
+ * Fill in the address of a Unix domain socket in the abstract namespace
+ * (which needs no file system cleanup when the server exits).
+ *
+ * \param name
+ *      Name of the socket, as returned by getSocketName.
+ * \param[out] address
+ *      Filled in with the socket's address.
+ * \return
+ *      The length of the address.
+ *
+ * \throw TransportException
+ *      The name is too long.
+ */
+socklen_t
+ShmTransport::getSocketAddress(const string& name,
+        struct sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (name.size() + 1 > sizeof(address->sun_path)) {
+        throw TransportException(HERE, format(
+                "ShmTransport socket name '%s' is too long", name.c_str()));
+    }
+    // A leading NUL byte selects the abstract namespace.
+    memcpy(address->sun_path + 1, name.data(), name.size());
+    return downCast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 +
+            name.size());
+}
+
+/**
+ * Write as much of a message (header plus payload) to a ring as there is
+ * space for, picking up where a previous call left off.
+ *
+ * \param ring
+ *      Ring to write the message to.
+ * \param nonce
+ *      Nonce for the message header.
+ * \param payload
+ *      Contents of the message.
+ * \param[in,out] bytesSent
+ *      # bytes of the message (header included) already written; updated
+ *      to reflect the bytes written by this call. Must be 0 for a new
+ *      message.
+ * \return
+ *      True means the entire message has now been written.
+ */
+bool
+ShmTransport::sendMessage(Ring* ring, uint64_t nonce, Buffer* payload,
+        uint32_t* bytesSent)
+{
+    if (*bytesSent < sizeof32(Header)) {
+        Header header;
+        header.nonce = nonce;
+        header.len = payload->size();
+        *bytesSent += ring->write(
+                reinterpret_cast<char*>(&header) + *bytesSent,
+                sizeof32(Header) - *bytesSent);
+        if (*bytesSent < sizeof32(Header)) {
+            return false;
+        }
+    }
+    uint32_t offset = *bytesSent - sizeof32(Header);
+    *bytesSent += ring->write(payload, offset, payload->size() - offset);
+    return *bytesSent == sizeof32(Header) + payload->size();
+}
+
+//-------------------------------------
+// ShmTransport::Ring
+//-------------------------------------
+
+/**
+ * Construct a Ring; it can't be used until attach is invoked.
+ */
+ShmTransport::Ring::Ring()
+    : control(NULL)
+    , data(NULL)
+    , capacity(0)
+    , head(0)
+    , tail(0)
+    , corrupt(false)
+{
+}
+
+/**
+ * Associate this object with a ring in shared memory.
+ *
+ * \param base
+ *      Address of the ring's RingControl; the data area follows it.
+ * \param capacity
+ *      Size of the ring's data area, in bytes.
+ */
+void
+ShmTransport::Ring::attach(void* base, uint32_t capacity)
+{
+    control = static_cast<RingControl*>(base);
+    data = static_cast<char*>(base) + sizeof(RingControl);
+    this->capacity = capacity;
+}
+
+/**
+ * Initialize the shared state of an empty ring. Invoked once, by the process
+ * that creates the shared memory, before the memory is shared.
+ *
+ * \param base
+ *      Address of the ring's RingControl.
+ */
+void
+ShmTransport::Ring::initialize(void* base)
+{
+    RingControl* control = static_cast<RingControl*>(base);
+    control->head.store(0);
+    control->tail.store(0);
+}
+
+/**
+ * Return the number of bytes that the consumer can read now (0 if the
+ * ring is corrupt).
+ */
+uint32_t
+ShmTransport::Ring::readableBytes()
+{
+    // The producer's head must be between our tail and our tail plus the
+    // capacity; anything else would move us outside the data area.
+    uint64_t available = control->head.load(std::memory_order_acquire)
+            - tail;
+    if (corrupt || available > capacity) {
+        corrupt = true;
+        return 0;
+    }
+    return downCast<uint32_t>(available);
+}
+
+/**
+ * Return the number of bytes that the producer can write now (0 if the
+ * ring is corrupt).
+ */
+uint32_t
+ShmTransport::Ring::writableBytes()
+{
+    uint64_t used = head - control->tail.load(std::memory_order_acquire);
+    if (corrupt || used > capacity) {
+        corrupt = true;
+        return 0;
+    }
+    return capacity - downCast<uint32_t>(used);
+}
+
+/**
+ * Copy bytes into the data area, wrapping around its end if needed.
+ *
+ * \param position
+ *      Total number of bytes written before the first byte to copy.
+ * \param src
+ *      Bytes to copy; NULL means store zeros.
+ * \param length
+ *      Number of bytes to copy; must fit in the free space.
+ */
+void
+ShmTransport::Ring::copyIn(uint64_t position, const void* src,
+        uint32_t length)
+{
+    uint32_t offset = downCast<uint32_t>(position % capacity);
+    uint32_t first = std::min(length, capacity - offset);
+    const char* source = static_cast<const char*>(src);
+    if (source == NULL) {
+        memset(data + offset, 0, first);
+        memset(data, 0, length - first);
+    } else {
+        memcpy(data + offset, source, first);
+        memcpy(data, source + first, length - first);
+    }
+}
+
+/**
+ * Copy bytes out of the data area, wrapping around its end if needed.
+ *
+ * \param position
+ *      Total number of bytes consumed before the first byte to copy.
+ * \param dest
+ *      Where to copy the bytes.
+ * \param length
+ *      Number of bytes to copy; must not exceed the readable bytes.
+ */
+void
+ShmTransport::Ring::copyOut(uint64_t position, void* dest, uint32_t length)
+{
+    uint32_t offset = downCast<uint32_t>(position % capacity);
+    uint32_t first = std::min(length, capacity - offset);
+    char* destination = static_cast<char*>(dest);
+    memcpy(destination, data + offset, first);
+    memcpy(destination + first, data, length - first);
+}
+
+/**
+ * Consume bytes from the ring.
+ *
+ * \param dest
+ *      Where to store the bytes.
+ * \param length
+ *      Maximum number of bytes to read.
+ * \return
+ *      The number of bytes actually read (limited by what is available).
+ */
+uint32_t
+ShmTransport::Ring::read(void* dest, uint32_t length)
+{
+    uint32_t count = std::min(length, readableBytes());
+    copyOut(tail, dest, count);
+    tail += count;
+    control->tail.store(tail, std::memory_order_release);
+    return count;
+}
+
+/**
+ * Consume bytes from the ring, appending them to a buffer.
+ *
+ * \param dest
+ *      Buffer to which the bytes are appended.
+ * \param length
+ *      Maximum number of bytes to read.
+ * \return
+ *      The number of bytes actually read (limited by what is available).
+ */
+uint32_t
+ShmTransport::Ring::read(Buffer* dest, uint32_t length)
+{
+    uint32_t count = std::min(length, readableBytes());
+    if (count == 0) {
+        return 0;
+    }
+    copyOut(tail, dest->alloc(count), count);
+    tail += count;
+    control->tail.store(tail, std::memory_order_release);
+    return count;
+}
+
+/**
+ * Consume and discard bytes from the ring.
+ *
+ * \param length
+ *      Maximum number of bytes to discard.
+ * \return
+ *      The number of bytes actually discarded.
+ */
+uint32_t
+ShmTransport::Ring::skip(uint32_t length)
+{
+    uint32_t count = std::min(length, readableBytes());
+    tail += count;
+    control->tail.store(tail, std::memory_order_release);
+    return count;
+}
+
+/**
+ * Append bytes to the ring.
+ *
+ * \param src
+ *      Bytes to write.
+ * \param length
+ *      Maximum number of bytes to write.
+ * \return
+ *      The number of bytes actually written (limited by the free space).
+ */
+uint32_t
+ShmTransport::Ring::write(const void* src, uint32_t length)
+{
+    uint32_t count = std::min(length, writableBytes());
+    copyIn(head, src, count);
+    head += count;
+    control->head.store(head, std::memory_order_release);
+    return count;
+}
+
+/**
+ * Append a range of a buffer to the ring.
+ *
+ * \param src
+ *      Buffer containing the bytes to write.
+ * \param offset
+ *      Offset in src of the first byte to write.
+ * \param length
+ *      Maximum number of bytes to write.
+ * \return
+ *      The number of bytes actually written (limited by the free space).
+ */
+uint32_t
+ShmTransport::Ring::write(Buffer* src, uint32_t offset, uint32_t length)
+{
+    uint32_t count = std::min(length, writableBytes());
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t position = head;
+    for (Buffer::Iterator it(src, offset, count); !it.isDone(); it.next()) {
+        copyIn(position, it.getData(), it.getLength());
+        position += it.getLength();
+    }
+    head += count;
+    control->head.store(head, std::memory_order_release);
+    return count;
+}
+
+/**
+ * Append zero bytes to the ring.
+ *
+ * \param length
+ *      Maximum number of bytes to write.
+ * \return
+ *      The number of bytes actually written (limited by the free space).
+ */
+uint32_t
+ShmTransport::Ring::writeZeros(uint32_t length)
+{
+    return write(static_cast<const void*>(NULL), length);
+}
+
+//-------------------------------------
+// ShmTransport::Region
+//-------------------------------------
+
+/**
+ * Map a session's shared memory region.
+ *
+ * \param fd
+ *      The memfd holding the region; the caller may close it once this
+ *      constructor returns.
+ * \param ringBytes
+ *      Capacity of each ring.
+ * \param initialize
+ *      True means the region was just created and its rings must be
+ *      initialized.
+ *
+ * \throw TransportException
+ *      The region couldn't be mapped.
+ */
+ShmTransport::Region::Region(int fd, uint32_t ringBytes, bool initialize)
+    : base(NULL)
+    , size(getSize(ringBytes))
+    , requests()
+    , responses()
+{
+    base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        base = NULL;
+        LOG(WARNING, "ShmTransport couldn't map %lu bytes of shared memory: "
+                "%s", size, strerror(errno));
+        throw TransportException(HERE,
+                "ShmTransport couldn't map shared memory", errno);
+    }
+    char* responseBase = static_cast<char*>(base) + sizeof(RingControl)
+            + ringBytes;
+    if (initialize) {
+        Ring::initialize(base);
+        Ring::initialize(responseBase);
+    }
+    requests.attach(base, ringBytes);
+    responses.attach(responseBase, ringBytes);
+}
+
+/**
+ * Destructor for Regions: unmaps the shared memory.
+ */
+ShmTransport::Region::~Region()
+{
+    if (base != NULL) {
+        munmap(base, size);
+    }
+}
+
+/**
+ * Return the size of a shared memory region whose rings each hold
+ * ringBytes bytes.
+ */
+size_t
+ShmTransport::Region::getSize(uint32_t ringBytes)
+{
+    return 2 * (sizeof(RingControl) + ringBytes);
+}
+
+//-------------------------------------
+// ShmTransport::IncomingMessage
+//-------------------------------------
+
+/**
+ * Construct an IncomingMessage.
+ *
+ * \param buffer
+ *      If non-NULL, specifies a buffer in which to place the incoming
+ *      message; the caller should ensure that the buffer is empty.
+ * \param session
+ *      If non-NULL, the session's findRpc is invoked once the header has
+ *      arrived to find the buffer to use.
+ */
+ShmTransport::IncomingMessage::IncomingMessage(Buffer* buffer,
+        ShmSession* session)
+    : header()
+    , headerBytesReceived(0)
+    , messageBytesReceived(0)
+    , buffer(buffer)
+    , session(session)
+{
+}
+
+/**
+ * Discard the rest of this message (for example, because its RPC was
+ * canceled); the bytes still have to be consumed from the ring.
+ */
+void
+ShmTransport::IncomingMessage::cancel()
+{
+    buffer = NULL;
+}
+
+/**
+ * Read as much of the message as is currently available in a ring.
+ *
+ * \param ring
+ *      Ring from which to read.
+ * \return
+ *      True means the message is now complete; false means more bytes are
+ *      still to come.
+ */
+bool
+ShmTransport::IncomingMessage::readMessage(Ring* ring)
+{
+    if (headerBytesReceived < sizeof32(Header)) {
+        headerBytesReceived += ring->read(
+                reinterpret_cast<char*>(&header) + headerBytesReceived,
+                sizeof32(Header) - headerBytesReceived);
+        if (headerBytesReceived < sizeof32(Header)) {
+            return false;
+        }
+        if (session != NULL) {
+            buffer = session->findRpc(&header);
+        }
+        if (header.len > MAX_RPC_LEN) {
+            LOG(WARNING, "ShmTransport received oversize message (%u bytes); "
+                    "discarding extra bytes", header.len);
+            buffer = NULL;
+        }
+    }
+
+    while (messageBytesReceived < header.len) {
+        uint32_t remaining = header.len - messageBytesReceived;
+        uint32_t count = (buffer != NULL) ? ring->read(buffer, remaining)
+                : ring->skip(remaining);
+        if (count == 0) {
+            return false;
+        }
+        messageBytesReceived += count;
+    }
+    return true;
+}
+
+//-------------------------------------
+// ShmTransport::ShmServerRpc
+//-------------------------------------
+
+// See Transport::ServerRpc::sendReply for documentation.
+void
+ShmTransport::ShmServerRpc::sendReply()
+{
+    std::unordered_map<uint64_t, Connection*>::iterator it =
+            transport->connections.find(connectionId);
+
+    // If the client has gone away, just discard the response.
+    if (it != transport->connections.end()) {
+        Connection* connection = it->second;
+        if (!connection->rpcsWaitingToReply.empty()) {
+            // Can't write the response yet; earlier ones are backed up.
+            connection->rpcsWaitingToReply.push_back(*this);
+            return;
+        }
+        connection->bytesSent = 0;
+        if (!sendMessage(&connection->region->responses, nonce,
+                &replyPayload, &connection->bytesSent)) {
+            // The rest will be written by the poller as the client drains
+            // the ring.
+            connection->rpcsWaitingToReply.push_back(*this);
+            return;
+        }
+    }
+
+    // The whole response was written immediately (this should be the
+    // common case).  Recycle the RPC object.
+    transport->serverRpcPool.destroy(this);
+}
+
+// See Transport::ServerRpc::getClientServiceLocator for documentation.
+string
+ShmTransport::ShmServerRpc::getClientServiceLocator()
+{
+    std::unordered_map<uint64_t, Connection*>::iterator it =
+            transport->connections.find(connectionId);
+    if (it == transport->connections.end()) {
+        return "shm:";
+    }
+    return format("shm:pid=%d", it->second->pid);
+}
+
+//-------------------------------------
+// ShmTransport::AcceptHandler
+//-------------------------------------
+
+/**
+ * Constructor for AcceptHandlers.
+ *
+ * \param fd
+ *      File descriptor for a socket on which the #listen system call has
+ *      been invoked.
+ * \param transport
+ *      The ShmTransport that manages this socket.
+ */
+ShmTransport::AcceptHandler::AcceptHandler(int fd, ShmTransport* transport)
+    : Dispatch::File(transport->context->dispatch, fd,
+            Dispatch::FileEvent::READABLE)
+    , transport(transport)
+{
+    // Empty constructor body.
+}
+
+/**
+ * This method is invoked by Dispatch when a listening socket becomes
+ * readable; it accepts the incoming connection. The client's memfd will
+ * arrive on the new socket shortly.
+ *
+ * \param events
+ *      Indicates whether the socket was readable, writable, or both
+ *      (OR-ed combination of Dispatch::FileEvent bits).
+ */
+void
+ShmTransport::AcceptHandler::handleFileEvent(int events)
+{
+    int acceptedFd = sys->accept(transport->listenSocket, NULL, NULL);
+    if (acceptedFd < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                (errno == EINTR)) {
+            return;
+        }
+
+        // Unexpected error: log a message and then close the socket
+        // (so we don't get repeated errors).
+        LOG(ERROR, "error in ShmTransport::AcceptHandler accepting "
+                "connection for '%s': %s",
+                transport->locatorString.c_str(), strerror(errno));
+        setEvents(0);
+        sys->close(transport->listenSocket);
+        transport->listenSocket = -1;
+        return;
+    }
+
+    // Record the client's pid, for getClientServiceLocator.
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    pid_t pid = 0;
+    if (getsockopt(acceptedFd, SOL_SOCKET, SO_PEERCRED, &credentials,
+            &length) == 0) {
+        pid = credentials.pid;
+    }
+    sys->fcntl(acceptedFd, F_SETFL, O_NONBLOCK);
+
+    uint64_t id = transport->nextConnectionId;
+    transport->nextConnectionId++;
+    transport->connections[id] = new Connection(transport, acceptedFd, id,
+            pid);
+}
+
+//-------------------------------------
+// ShmTransport::ServerSocketHandler
+//-------------------------------------
+
+/**
+ * Constructor for ServerSocketHandlers.
+ *
+ * \param fd
+ *      Socket connected to a client.
+ * \param transport
+ *      The ShmTransport that manages this socket.
+ * \param id
+ *      Identifier of the Connection for this socket.
+ */
+ShmTransport::ServerSocketHandler::ServerSocketHandler(int fd,
+        ShmTransport* transport, uint64_t id)
+    : Dispatch::File(transport->context->dispatch, fd,
+            Dispatch::FileEvent::READABLE)
+    , transport(transport)
+    , connectionId(id)
+{
+    // Empty constructor body.
+}
+
+/**
+ * This method is invoked by Dispatch when a client's socket becomes
+ * readable. The first time, this means the client has sent the descriptor
+ * of its shared memory region; after that, it means the client has closed
+ * the session (or exited).
+ *
+ * \param events
+ *      Indicates whether the socket was readable, writable, or both
+ *      (OR-ed combination of Dispatch::FileEvent bits).
+ */
+void
+ShmTransport::ServerSocketHandler::handleFileEvent(int events)
+{
+    std::unordered_map<uint64_t, Connection*>::iterator it =
+            transport->connections.find(connectionId);
+    if (it == transport->connections.end()) {
+        return;
+    }
+    Connection* connection = it->second;
+    char data[8];
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = sizeof(data);
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = &control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count = sys->recvmsg(connection->fd, &message, 0);
+    if (count < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+                (errno == EINTR)) {
+            return;
+        }
+        LOG(WARNING, "ShmTransport error reading from client socket: %s",
+                strerror(errno));
+        transport->closeConnection(connectionId);
+        return;
+    }
+    if (count == 0) {
+        // The client closed the session.
+        transport->closeConnection(connectionId);
+        return;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    if (connection->region || (cmsg == NULL) ||
+            (cmsg->cmsg_level != SOL_SOCKET) ||
+            (cmsg->cmsg_type != SCM_RIGHTS)) {
+        // Clients don't send anything else on the socket.
+        LOG(WARNING, "ShmTransport received unexpected data from client "
+                "pid %d; closing session", connection->pid);
+        transport->closeConnection(connectionId);
+        return;
+    }
+    int memfd;
+    memcpy(&memfd, CMSG_DATA(cmsg), sizeof(memfd));
+
+    // The client must not be able to change the size of the region once we
+    // have mapped it (shrinking it would make our accesses fault), so
+    // insist that it has been sealed.
+    const int requiredSeals = F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL;
+    int seals = sys->fcntl(memfd, F_GET_SEALS, 0);
+    if ((seals < 0) || ((seals & requiredSeals) != requiredSeals)) {
+        LOG(WARNING, "ShmTransport received unsealed shared memory region "
+                "from client pid %d; closing session", connection->pid);
+        sys->close(memfd);
+        transport->closeConnection(connectionId);
+        return;
+    }
+
+    // The size of the region determines the ring size.
+    struct stat stats;
+    uint32_t ringBytes = 0;
+    if ((fstat(memfd, &stats) == 0) && (stats.st_size > 0)) {
+        uint64_t size = downCast<uint64_t>(stats.st_size);
+        if ((size % 2 == 0) && (size >= Region::getSize(MIN_RING_BYTES))
+                && (size <= Region::getSize(MAX_RING_BYTES))) {
+            ringBytes = downCast<uint32_t>(size/2 - sizeof(RingControl));
+        }
+    }
+    if (ringBytes == 0) {
+        LOG(WARNING, "ShmTransport received bad shared memory region from "
+                "client pid %d; closing session", connection->pid);
+        sys->close(memfd);
+        transport->closeConnection(connectionId);
+        return;
+    }
+    try {
+        connection->region.construct(memfd, ringBytes, false);
+    } catch (TransportException& e) {
+        sys->close(memfd);
+        transport->closeConnection(connectionId);
+        return;
+    }
+    sys->close(memfd);
+}
+
+//-------------------------------------
+// ShmTransport::Connection
+//-------------------------------------
+
+/**
+ * Construct a Connection.
+ *
+ * \param transport
+ *      The transport that accepted the connection.
+ * \param fd
+ *      Socket connected to the client. The caller closes it after
+ *      deleting this object.
+ * \param id
+ *      Unique identifier for the connection.
+ * \param pid
+ *      Process id of the client (0 if unknown).
+ */
+ShmTransport::Connection::Connection(ShmTransport* transport, int fd,
+        uint64_t id, pid_t pid)
+    : transport(transport)
+    , fd(fd)
+    , id(id)
+    , pid(pid)
+    , region()
+    , rpc(NULL)
+    , message()
+    , rpcsWaitingToReply()
+    , bytesSent(0)
+    , ioHandler(fd, transport, id)
+{
+}
+
+/**
+ * Destructor for Connections.
+ */
+ShmTransport::Connection::~Connection()
+{
+    if (rpc != NULL) {
+        transport->serverRpcPool.destroy(rpc);
+    }
+    while (!rpcsWaitingToReply.empty()) {
+        ShmServerRpc& reply = rpcsWaitingToReply.front();
+        rpcsWaitingToReply.pop_front();
+        transport->serverRpcPool.destroy(&reply);
+    }
+}
+
+/**
+ * Receive any requests that have arrived from the client (passing complete
+ * ones on for servicing), and continue writing responses that didn't fit
+ * in the response ring earlier.
+ *
+ * \return
+ *      True means some useful work was done.
+ */
+bool
+ShmTransport::Connection::poll()
+{
+    if (!region) {
+        return false;
+    }
+    bool didWork = false;
+
+    while (region->requests.readableBytes() > 0) {
+        didWork = true;
+        if (rpc == NULL) {
+            rpc = transport->serverRpcPool.construct(transport, id);
+            message.construct(&rpc->requestPayload,
+                    static_cast<ShmSession*>(NULL));
+        }
+        if (!message->readMessage(&region->requests)) {
+            break;
+        }
+
+        // The incoming request is complete; pass it off for servicing.
+        ShmServerRpc* request = rpc;
+        request->nonce = message->header.nonce;
+        rpc = NULL;
+        transport->context->workerManager->handleRpc(request);
+    }
+
+    while (!rpcsWaitingToReply.empty()) {
+        ShmServerRpc& reply = rpcsWaitingToReply.front();
+        uint32_t oldBytesSent = bytesSent;
+        bool done = sendMessage(&region->responses, reply.nonce,
+                &reply.replyPayload, &bytesSent);
+        if (bytesSent != oldBytesSent) {
+            didWork = true;
+        }
+        if (!done) {
+            break;
+        }
+        rpcsWaitingToReply.pop_front();
+        transport->serverRpcPool.destroy(&reply);
+        bytesSent = 0;
+    }
+    return didWork;
+}
+
+//-------------------------------------
+// ShmTransport::ShmSession
+//-------------------------------------
+
+/**
+ * Create a session: allocate the shared memory region, map it, and pass it
+ * to the server.
+ *
+ * \param transport
+ *      The transport that owns this session.
+ * \param serviceLocator
+ *      Identifies the server. The "ringBytes" option, if present,
+ *      overrides DEFAULT_RING_BYTES.
+ *
+ * \throw TransportException
+ *      The server couldn't be reached or the region couldn't be created.
+ */
+ShmTransport::ShmSession::ShmSession(ShmTransport* transport,
+        const ServiceLocator* serviceLocator)
+    : Session(serviceLocator->getOriginalString())
+    , transport(transport)
+    , fd(-1)
+    , region()
+    , serial(1)
+    , rpcsWaitingToSend()
+    , rpcsWaitingForResponse()
+    , bytesSent(0)
+    , padBytesToSend(0)
+    , current(NULL)
+    , message()
+    , clientIoHandler()
+    , sessionLinks()
+{
+    struct sockaddr_un address;
+    socklen_t addressLength = getSocketAddress(getSocketName(serviceLocator),
+            &address);
+    uint32_t ringBytes = DEFAULT_RING_BYTES;
+    if (serviceLocator->hasOption("ringBytes")) {
+        ringBytes = serviceLocator->getOption<uint32_t>("ringBytes");
+        if ((ringBytes < MIN_RING_BYTES) || (ringBytes > MAX_RING_BYTES)) {
+            throw TransportException(HERE, format(
+                    "ShmTransport ringBytes option must be between %u "
+                    "and %u", MIN_RING_BYTES, MAX_RING_BYTES));
+        }
+    }
+
+    fd = sys->socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        LOG(WARNING, "ShmTransport couldn't open socket for session: %s",
+            strerror(errno));
+        throw TransportException(HERE,
+                "ShmTransport couldn't open socket for session", errno);
+    }
+    if (sys->connect(fd, reinterpret_cast<sockaddr*>(&address),
+            addressLength) == -1) {
+        sys->close(fd);
+        fd = -1;
+        LOG(WARNING, "ShmTransport couldn't connect to %s: %s",
+            this->serviceLocator.c_str(), strerror(errno));
+        throw TransportException(HERE, format(
+                "ShmTransport couldn't connect to %s",
+                this->serviceLocator.c_str()), errno);
+    }
+
+    // Create and map the shared memory region, then hand it to the server.
+    // The region is sealed at its final size: the server refuses regions
+    // whose size could still change.
+    int memfd = static_cast<int>(syscall(SYS_memfd_create, "ramcloud-shm",
+            MFD_CLOEXEC|MFD_ALLOW_SEALING));
+    if ((memfd < 0) || (ftruncate(memfd, Region::getSize(ringBytes)) != 0)
+            || (sys->fcntl(memfd, F_ADD_SEALS,
+            F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL) != 0)) {
+        int error = errno;
+        if (memfd >= 0) {
+            sys->close(memfd);
+        }
+        sys->close(fd);
+        fd = -1;
+        LOG(WARNING, "ShmTransport couldn't create shared memory for "
+                "session: %s", strerror(error));
+        throw TransportException(HERE,
+                "ShmTransport couldn't create shared memory", error);
+    }
+    try {
+        region.construct(memfd, ringBytes, true);
+    } catch (TransportException& e) {
+        sys->close(memfd);
+        sys->close(fd);
+        fd = -1;
+        throw;
+    }
+
+    char data = 0;
+    struct iovec iov;
+    iov.iov_base = &data;
+    iov.iov_len = sizeof(data);
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(memfd));
+    ssize_t sent = sys->sendmsg(fd, &msg, 0);
+    int error = errno;
+    sys->close(memfd);
+    if (sent != sizeof(data)) {
+        region.destroy();
+        sys->close(fd);
+        fd = -1;
+        LOG(WARNING, "ShmTransport couldn't pass shared memory to %s: %s",
+            this->serviceLocator.c_str(), strerror(error));
+        throw TransportException(HERE, format(
+                "ShmTransport couldn't pass shared memory to %s",
+                this->serviceLocator.c_str()), error);
+    }
+
+    // Arrange for notification if the server goes away, and start polling.
+    Dispatch::Lock lock(transport->context->dispatch);
+    clientIoHandler.construct(fd, this);
+    message.construct(static_cast<Buffer*>(NULL), this);
+    transport->sessions.push_back(*this);
+}
+
+/**
+ * Destructor for ShmSession objects.
+ */
+ShmTransport::ShmSession::~ShmSession()
+{
+    close();
+}
+
+// See documentation for Transport::Session::abort.
+void
+ShmTransport::ShmSession::abort()
+{
+    close();
+}
+
+// See Transport::Session::cancelRequest for documentation.
+void
+ShmTransport::ShmSession::cancelRequest(RpcNotifier* notifier)
+{
+    foreach (ShmClientRpc& rpc, rpcsWaitingForResponse) {
+        if (rpc.notifier == notifier) {
+            rpcsWaitingForResponse.erase(
+                    rpcsWaitingForResponse.iterator_to(rpc));
+            transport->clientRpcPool.destroy(&rpc);
+
+            // If we have started reading the response message,
+            // discard the rest of it.
+            if (&rpc == current) {
+                message->cancel();
+                current = NULL;
+            }
+            return;
+        }
+    }
+    foreach (ShmClientRpc& rpc, rpcsWaitingToSend) {
+        if (rpc.notifier == notifier) {
+            if ((&rpc == &rpcsWaitingToSend.front()) && (bytesSent > 0)) {
+                // Part of the request is already in the ring; the server
+                // still expects the rest of it, but the request buffer may
+                // go away as soon as we return. Fill in with zeros (the
+                // response, if any, will be discarded).
+                padBytesToSend = sizeof32(Header) + rpc.request->size()
+                        - bytesSent;
+                bytesSent = 0;
+            }
+            rpcsWaitingToSend.erase(rpcsWaitingToSend.iterator_to(rpc));
+            transport->clientRpcPool.destroy(&rpc);
+            return;
+        }
+    }
+}
+
+/**
+ * Close the session: fail all outstanding RPCs and release the socket and
+ * the shared memory.
+ */
+void
+ShmTransport::ShmSession::close()
+{
+    if (fd >= 0) {
+        Dispatch::Lock lock(transport->context->dispatch);
+        clientIoHandler.destroy();
+        transport->sessions.erase(transport->sessions.iterator_to(*this));
+        sys->close(fd);
+        fd = -1;
+    }
+    while (!rpcsWaitingForResponse.empty()) {
+        ShmClientRpc& rpc = rpcsWaitingForResponse.front();
+        rpc.notifier->failed();
+        rpcsWaitingForResponse.pop_front();
+        transport->clientRpcPool.destroy(&rpc);
+    }
+    while (!rpcsWaitingToSend.empty()) {
+        ShmClientRpc& rpc = rpcsWaitingToSend.front();
+        rpc.notifier->failed();
+        rpcsWaitingToSend.pop_front();
+        transport->clientRpcPool.destroy(&rpc);
+    }
+    current = NULL;
+    region.destroy();
+}
+
+/**
+ * This method is invoked once the header has been received for a response.
+ * It finds the corresponding ShmClientRpc and returns the Buffer to use for
+ * the response.
+ *
+ * \param header
+ *      The header from the incoming response.
+ *
+ * \return
+ *      The response buffer for the RPC, or NULL if no matching RPC can be
+ *      found (it was probably canceled), in which case the response should
+ *      be discarded.
+ */
+Buffer*
+ShmTransport::ShmSession::findRpc(Header* header)
+{
+    foreach (ShmClientRpc& rpc, rpcsWaitingForResponse) {
+        if (rpc.nonce == header->nonce) {
+            current = &rpc;
+            return rpc.response;
+        }
+    }
+    return NULL;
+}
+
+// See Transport::Session::getRpcInfo for documentation.
+string
+ShmTransport::ShmSession::getRpcInfo()
+{
+    const char* separator = "";
+    string result;
+    foreach (ShmClientRpc& rpc, rpcsWaitingForResponse) {
+        result += separator;
+        result += WireFormat::opcodeSymbol(rpc.request);
+        separator = ", ";
+    }
+    foreach (ShmClientRpc& rpc, rpcsWaitingToSend) {
+        result += separator;
+        result += WireFormat::opcodeSymbol(rpc.request);
+        separator = ", ";
+    }
+    if (result.empty())
+        result = "no active RPCs";
+    result += " to server at ";
+    result += serviceLocator;
+    return result;
+}
+
+// See Transport::Session::sendRequest for documentation.
+void
+ShmTransport::ShmSession::sendRequest(Buffer* request, Buffer* response,
+        RpcNotifier* notifier)
+{
+    response->reset();
+    if (fd == -1) {
+        notifier->failed();
+        return;
+    }
+    ShmClientRpc* rpc = transport->clientRpcPool.construct(request, response,
+            notifier, serial);
+    serial++;
+    rpcsWaitingToSend.push_back(*rpc);
+    if ((rpcsWaitingToSend.size() == 1) && (padBytesToSend == 0)) {
+        // Nothing ahead of us: try to write the request right away (this
+        // should be the common case).
+        if (sendMessage(&region->requests, rpc->nonce, request,
+                &bytesSent)) {
+            rpcsWaitingToSend.pop_front();
+            rpcsWaitingForResponse.push_back(*rpc);
+            bytesSent = 0;
+        }
+    }
+}
+
+/**
+ * Continue writing requests that didn't fit in the request ring, and
+ * receive any responses that have arrived.
+ *
+ * \return
+ *      True means some useful work was done.
+ */
+bool
+ShmTransport::ShmSession::poll()
+{
+    bool didWork = false;
+
+    if (padBytesToSend > 0) {
+        uint32_t count = region->requests.writeZeros(padBytesToSend);
+        padBytesToSend -= count;
+        didWork = (count > 0);
+    }
+    while ((padBytesToSend == 0) && !rpcsWaitingToSend.empty()) {
+        ShmClientRpc& rpc = rpcsWaitingToSend.front();
+        uint32_t oldBytesSent = bytesSent;
+        bool done = sendMessage(&region->requests, rpc.nonce, rpc.request,
+                &bytesSent);
+        if (bytesSent != oldBytesSent) {
+            didWork = true;
+        }
+        if (!done) {
+            break;
+        }
+        rpcsWaitingToSend.pop_front();
+        rpcsWaitingForResponse.push_back(rpc);
+        bytesSent = 0;
+    }
+
+    while (region->responses.readableBytes() > 0) {
+        didWork = true;
+        if (!message->readMessage(&region->responses)) {
+            break;
+        }
+
+        // This RPC is finished.
+        if (current != NULL) {
+            rpcsWaitingForResponse.erase(
+                    rpcsWaitingForResponse.iterator_to(*current));
+            current->notifier->completed();
+            transport->clientRpcPool.destroy(current);
+            current = NULL;
+        }
+        message.construct(static_cast<Buffer*>(NULL), this);
+    }
+    return didWork;
+}
+
+//-------------------------------------
+// ShmTransport::ClientSocketHandler
+//-------------------------------------
+
+/**
+ * Constructor for ClientSocketHandlers.
+ *
+ * \param fd
+ *      Socket connected to the server.
+ * \param session
+ *      The session that owns the socket.
+ */
+ShmTransport::ClientSocketHandler::ClientSocketHandler(int fd,
+        ShmSession* session)
+    : Dispatch::File(session->transport->context->dispatch, fd,
+            Dispatch::FileEvent::READABLE)
+    , session(session)
+{
+    // Empty constructor body.
+}
+
+/**
+ * This method is invoked by Dispatch when a session's socket becomes
+ * readable, which only happens when the server has closed its end (the
+ * server never sends anything on it). Fail all outstanding RPCs.
+ *
+ * \param events
+ *      Indicates whether the socket was readable, writable, or both
+ *      (OR-ed combination of Dispatch::FileEvent bits).
+ */
+void
+ShmTransport::ClientSocketHandler::handleFileEvent(int events)
+{
+    LOG(NOTICE, "ShmTransport server at %s closed session",
+            session->serviceLocator.c_str());
+    session->close();
+}
+
+//-------------------------------------
+// ShmTransport::Poller
+//-------------------------------------
+
+/**
+ * Construct the transport's poller.
+ *
+ * \param transport
+ *      The transport whose connections and sessions are polled.
+ */
+ShmTransport::Poller::Poller(ShmTransport* transport)
+    : Dispatch::Poller(transport->context->dispatch, "ShmTransport::Poller")
+    , transport(transport)
+{
+}
+
+/**
+ * This method is invoked in the inner polling loop of the dispatcher; it
+ * moves messages through all of the transport's rings, and closes any
+ * connection or session whose peer has corrupted its rings.
+ *
+ * \return
+ *      1 if useful work was done, 0 otherwise.
+ */
+int
+ShmTransport::Poller::poll()
+{
+    int result = 0;
+    for (std::unordered_map<uint64_t, Connection*>::iterator it =
+            transport->connections.begin();
+            it != transport->connections.end(); ) {
+        // Advance first: the connection may be closed below.
+        Connection* connection = it->second;
+        it++;
+        if (connection->poll()) {
+            result = 1;
+        }
+        if (connection->region && connection->region->isCorrupt()) {
+            LOG(WARNING, "ShmTransport found corrupt rings in session with "
+                    "client pid %d; closing session", connection->pid);
+            transport->closeConnection(connection->id);
+            result = 1;
+        }
+    }
+    for (SessionList::iterator it = transport->sessions.begin();
+            it != transport->sessions.end(); ) {
+        ShmSession* session = &*it;
+        it++;
+        if (session->poll()) {
+            result = 1;
+        }
+        if (session->region->isCorrupt()) {
+            LOG(WARNING, "ShmTransport found corrupt rings in session with "
+                    "%s; closing session", session->serviceLocator.c_str());
+            session->close();
+            result = 1;
+        }
+    }
+    return result;
+}
+
+}  // namespace RAMCloud
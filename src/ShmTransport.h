@@ -0,0 +1,504 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHOR(S) BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SHMTRANSPORT_H
+#define RAMCLOUD_SHMTRANSPORT_H
+
+#include <sys/un.h>
+#include <atomic>
+#include <unordered_map>
+
+#include "BoostIntrusive.h"
+#include "Dispatch.h"
+#include "ObjectPool.h"
+#include "ServerRpcPool.h"
+#include "ServiceLocator.h"
+#include "Syscall.h"
+#include "Transport.h"
+
+namespace RAMCloud {
+
+/**
+ * A transport for clients that run on the same machine as a server. Requests
+ * and responses are exchanged through a pair of single-producer,
+ * single-consumer byte rings in a shared memory region, so an RPC involves
+ * no system calls and no copies other than into and out of the rings; both
+ * sides discover new messages by polling the rings from the dispatcher.
+ *
+ * Servers listen on a Unix domain socket in the abstract namespace, named by
+ * the "name" option of the service locator (e.g. "shm:name=master1"). To
+ * open a session, a client creates a memfd holding the rings, seals it so
+ * that its size can't change, maps it, and passes the descriptor to the
+ * server over that socket. The socket stays
+ * open for the lifetime of the session; it carries no data, but when either
+ * side exits the other sees end-of-file and cleans up.
+ *
+ * Messages larger than the free space in a ring are streamed through it in
+ * pieces, so the ring size only bounds the amount of data in flight.
+ */
+class ShmTransport : public Transport {
+  public:
+    explicit ShmTransport(Context* context,
+            const ServiceLocator* serviceLocator = NULL);
+    ~ShmTransport();
+    SessionRef getSession(const ServiceLocator* serviceLocator,
+            uint32_t timeoutMs = 0);
+    string getServiceLocator() {
+        return locatorString;
+    }
+
+    /// Default capacity, in bytes, of each ring (one for requests, one for
+    /// responses) in a session's shared memory region. Can be overridden
+    /// with the "ringBytes" option in a client's service locator.
+    static const uint32_t DEFAULT_RING_BYTES = 1024 * 1024;
+
+    /// Smallest ring capacity a client may ask for.
+    static const uint32_t MIN_RING_BYTES = 1024;
+
+    /// Largest ring capacity a client may ask for (servers refuse regions
+    /// with larger rings).
+    static const uint32_t MAX_RING_BYTES = 64 * 1024 * 1024;
+
+    class ShmServerRpc;
+  PRIVATE:
+    class Connection;
+    class IncomingMessage;
+    class ShmSession;
+
+    /**
+     * Header for request and response messages: precedes the actual data
+     * of the message in the ring.
+     */
+    struct Header {
+        /// Unique identifier for this RPC: generated on the client, and
+        /// returned by the server in responses.
+        uint64_t nonce;
+
+        /// The size in bytes of the payload (which follows immediately).
+        uint32_t len;
+    } __attribute__((packed));
+
+    /**
+     * Shared state for one ring; it lives at the start of the ring's area
+     * in the shared memory region, followed by the ring's data. The two
+     * counters are in separate cache lines so that producer and consumer
+     * don't contend for a line on every update.
+     */
+    struct RingControl {
+        /// Total # bytes ever written into the ring by the producer.
+        std::atomic<uint64_t> head;
+        char pad1[64 - sizeof(std::atomic<uint64_t>)];
+
+        /// Total # bytes ever consumed from the ring by the consumer.
+        std::atomic<uint64_t> tail;
+        char pad2[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    static_assert(sizeof(RingControl) == 128, "Unexpected RingControl size");
+
+    /**
+     * A single-producer, single-consumer byte ring stored in memory shared
+     * between two processes. Each process has its own Ring object that
+     * refers to the shared memory; one of them only writes and the other
+     * only reads.
+     *
+     * The peer process can write anything into the shared memory, so each
+     * Ring keeps its own copy of the counters it advances, and checks the
+     * peer's counter against it before using it; if the two are
+     * inconsistent, the ring is marked corrupt and no more bytes move
+     * through it.
+     */
+    class Ring {
+      public:
+        Ring();
+        void attach(void* base, uint32_t capacity);
+        static void initialize(void* base);
+        /// Return true if the peer has stored an impossible counter value
+        /// in the ring's shared state.
+        bool isCorrupt() {
+            return corrupt;
+        }
+        uint32_t readableBytes();
+        uint32_t writableBytes();
+        uint32_t read(void* dest, uint32_t length);
+        uint32_t read(Buffer* dest, uint32_t length);
+        uint32_t skip(uint32_t length);
+        uint32_t write(const void* src, uint32_t length);
+        uint32_t write(Buffer* src, uint32_t offset, uint32_t length);
+        uint32_t writeZeros(uint32_t length);
+
+      PRIVATE:
+        void copyIn(uint64_t position, const void* src, uint32_t length);
+        void copyOut(uint64_t position, void* dest, uint32_t length);
+
+        /// Shared counters for the ring; NULL until attach is called.
+        RingControl* control;
+
+        /// First byte of the ring's data area.
+        char* data;
+
+        /// # bytes in the data area.
+        uint32_t capacity;
+
+        /// Total # bytes written into the ring by this process (only
+        /// meaningful in the producer); the shared copy in #control is
+        /// never read back.
+        uint64_t head;
+
+        /// Total # bytes consumed from the ring by this process (only
+        /// meaningful in the consumer); the shared copy in #control is
+        /// never read back.
+        uint64_t tail;
+
+        /// True means the peer's counter has been found to be invalid.
+        bool corrupt;
+
+        DISALLOW_COPY_AND_ASSIGN(Ring);
+    };
+
+    /**
+     * A shared memory region holding the two rings of a session, as mapped
+     * into this process.
+     */
+    class Region {
+      public:
+        Region(int fd, uint32_t ringBytes, bool initialize);
+        ~Region();
+        static size_t getSize(uint32_t ringBytes);
+
+        /// Return true if the peer has corrupted either ring.
+        bool isCorrupt() {
+            return requests.isCorrupt() || responses.isCorrupt();
+        }
+
+        /// Base address of the mapping.
+        void* base;
+
+        /// # bytes mapped at base.
+        size_t size;
+
+        /// Ring carrying requests from the client to the server.
+        Ring requests;
+
+        /// Ring carrying responses from the server to the client.
+        Ring responses;
+
+        DISALLOW_COPY_AND_ASSIGN(Region);
+    };
+
+    /**
+     * Used to receive a message (on either client or server) from a ring,
+     * possibly over several calls as the sender fills the ring.
+     */
+    class IncomingMessage {
+      public:
+        IncomingMessage(Buffer* buffer, ShmSession* session);
+        bool readMessage(Ring* ring);
+        void cancel();
+
+        /// Header of the message; only valid once headerBytesReceived
+        /// reaches sizeof(Header).
+        Header header;
+
+        /// # bytes of header received so far.
+        uint32_t headerBytesReceived;
+
+        /// # bytes of the message body received (or discarded) so far.
+        uint32_t messageBytesReceived;
+
+        /// Buffer in which the incoming message is stored; NULL means the
+        /// message is being discarded (e.g. its RPC was canceled).
+        Buffer* buffer;
+
+        /// If non-NULL, the session is asked for the buffer to use once
+        /// the header has arrived.
+        ShmSession* session;
+
+        DISALLOW_COPY_AND_ASSIGN(IncomingMessage);
+    };
+
+  public:
+    /**
+     * The shared memory implementation of Transport::ServerRpc.
+     */
+    class ShmServerRpc : public Transport::ServerRpc {
+        friend class ShmTransport;
+        friend class ObjectPool<ShmServerRpc>;
+      public:
+        virtual ~ShmServerRpc() {}
+        void sendReply();
+        string getClientServiceLocator();
+      PRIVATE:
+        ShmServerRpc(ShmTransport* transport, uint64_t connectionId)
+            : transport(transport)
+            , connectionId(connectionId)
+            , nonce(0)
+            , queueEntries()
+        {}
+
+        /// The transport that received this request.
+        ShmTransport* transport;
+
+        /// Identifies the connection on which the request arrived (and
+        /// the response must be returned).
+        uint64_t connectionId;
+
+        /// Nonce from the request; returned in the response.
+        uint64_t nonce;
+
+        /// Used to link this RPC onto its connection's rpcsWaitingToReply.
+        IntrusiveListHook queueEntries;
+
+        DISALLOW_COPY_AND_ASSIGN(ShmServerRpc);
+    };
+
+  PRIVATE:
+    /**
+     * Client-side state for an outstanding RPC.
+     */
+    class ShmClientRpc {
+      public:
+        ShmClientRpc(Buffer* request, Buffer* response,
+                RpcNotifier* notifier, uint64_t nonce)
+            : request(request)
+            , response(response)
+            , notifier(notifier)
+            , nonce(nonce)
+            , queueEntries()
+        {}
+
+        Buffer* request;          /// Request message for the RPC.
+        Buffer* response;         /// Will eventually hold the response.
+        RpcNotifier* notifier;    /// Used to report completion.
+        uint64_t nonce;           /// Pairs the RPC with its response.
+        IntrusiveListHook queueEntries;
+                                  /// Links the RPC onto rpcsWaitingToSend or
+                                  /// rpcsWaitingForResponse of its session.
+        DISALLOW_COPY_AND_ASSIGN(ShmClientRpc);
+    };
+
+    static bool sendMessage(Ring* ring, uint64_t nonce, Buffer* payload,
+            uint32_t* bytesSent);
+
+    /**
+     * Accepts connections on a server's listening socket.
+     */
+    class AcceptHandler : public Dispatch::File {
+      public:
+        AcceptHandler(int fd, ShmTransport* transport);
+        virtual void handleFileEvent(int events);
+      PRIVATE:
+        ShmTransport* transport;
+        DISALLOW_COPY_AND_ASSIGN(AcceptHandler);
+    };
+
+    /**
+     * Watches the socket of a server-side connection: the first message
+     * on it carries the client's memfd, and end-of-file means the client
+     * has gone away.
+     */
+    class ServerSocketHandler : public Dispatch::File {
+      public:
+        ServerSocketHandler(int fd, ShmTransport* transport, uint64_t id);
+        virtual void handleFileEvent(int events);
+      PRIVATE:
+        ShmTransport* transport;
+        uint64_t connectionId;
+        DISALLOW_COPY_AND_ASSIGN(ServerSocketHandler);
+    };
+
+    /**
+     * Watches a session's socket so the session can be aborted when the
+     * server goes away.
+     */
+    class ClientSocketHandler : public Dispatch::File {
+      public:
+        ClientSocketHandler(int fd, ShmSession* session);
+        virtual void handleFileEvent(int events);
+      PRIVATE:
+        ShmSession* session;
+        DISALLOW_COPY_AND_ASSIGN(ClientSocketHandler);
+    };
+
+    /**
+     * Server-side state for one client session.
+     */
+    class Connection {
+      public:
+        Connection(ShmTransport* transport, int fd, uint64_t id, pid_t pid);
+        ~Connection();
+        bool poll();
+
+        /// The transport that owns this connection.
+        ShmTransport* transport;
+
+        /// Socket connected to the client.
+        int fd;
+
+        /// Unique identifier for this connection; never reused.
+        uint64_t id;
+
+        /// Process id of the client (for getClientServiceLocator).
+        pid_t pid;
+
+        /// Shared memory with the client; empty until the client's memfd
+        /// has been received.
+        Tub<Region> region;
+
+        /// Request currently being received, if any.
+        ShmServerRpc* rpc;
+
+        /// State of the request currently being received.
+        Tub<IncomingMessage> message;
+
+        INTRUSIVE_LIST_TYPEDEF(ShmServerRpc, queueEntries) ServerRpcList;
+        /// Responses waiting to be written; the front one may be partially
+        /// written.
+        ServerRpcList rpcsWaitingToReply;
+
+        /// # bytes (header included) of the front of rpcsWaitingToReply
+        /// already written.
+        uint32_t bytesSent;
+
+        /// Notifies us of the client's memfd and of end-of-file.
+        ServerSocketHandler ioHandler;
+
+        DISALLOW_COPY_AND_ASSIGN(Connection);
+    };
+
+    /**
+     * The shared memory implementation of Sessions.
+     */
+    class ShmSession : public Session {
+      public:
+        ShmSession(ShmTransport* transport,
+                const ServiceLocator* serviceLocator);
+        ~ShmSession();
+        virtual void abort();
+        virtual void cancelRequest(RpcNotifier* notifier);
+        virtual string getRpcInfo();
+        virtual void sendRequest(Buffer* request, Buffer* response,
+                RpcNotifier* notifier);
+        Buffer* findRpc(Header* header);
+        bool poll();
+
+      PRIVATE:
+        void close();
+
+        /// The transport that owns this session.
+        ShmTransport* transport;
+
+        /// Socket connected to the server; -1 once the session is closed.
+        int fd;
+
+        /// Shared memory with the server.
+        Tub<Region> region;
+
+        /// Used to generate nonces for RPCs.
+        uint64_t serial;
+
+        INTRUSIVE_LIST_TYPEDEF(ShmClientRpc, queueEntries) ClientRpcList;
+        /// RPCs whose requests have not been completely written; the front
+        /// one may be partially written.
+        ClientRpcList rpcsWaitingToSend;
+
+        /// RPCs whose requests have been written but whose responses have
+        /// not been completely received.
+        ClientRpcList rpcsWaitingForResponse;
+
+        /// # bytes (header included) of the front of rpcsWaitingToSend
+        /// already written.
+        uint32_t bytesSent;
+
+        /// If the RPC whose request was partially written gets canceled,
+        /// the rest of its request must still be written so the server
+        /// stays in sync; it is replaced by this many zero bytes.
+        uint32_t padBytesToSend;
+
+        /// RPC for which a response is currently being received (NULL if
+        /// none, or if it was canceled).
+        ShmClientRpc* current;
+
+        /// State of the response currently being received.
+        Tub<IncomingMessage> message;
+
+        /// Notices when the server closes its end of the socket.
+        Tub<ClientSocketHandler> clientIoHandler;
+
+        /// Used to link this session onto the transport's sessions list.
+        IntrusiveListHook sessionLinks;
+
+        friend class ShmTransport;
+        friend class ClientSocketHandler;
+        DISALLOW_COPY_AND_ASSIGN(ShmSession);
+    };
+
+    /**
+     * Drives all of the transport's rings from the dispatcher.
+     */
+    class Poller : public Dispatch::Poller {
+      public:
+        explicit Poller(ShmTransport* transport);
+        virtual int poll();
+      PRIVATE:
+        ShmTransport* transport;
+        DISALLOW_COPY_AND_ASSIGN(Poller);
+    };
+
+    void closeConnection(uint64_t id);
+    static string getSocketName(const ServiceLocator* serviceLocator);
+    static socklen_t getSocketAddress(const string& name,
+            struct sockaddr_un* address);
+
+    static Syscall* sys;
+
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// Service locator on which this transport accepts sessions (empty
+    /// if this isn't a server).
+    string locatorString;
+
+    /// Socket on which servers listen for new sessions; -1 means this
+    /// instance is not a server.
+    int listenSocket;
+
+    /// Used to wait for listenSocket to become readable.
+    Tub<AcceptHandler> acceptHandler;
+
+    /// Server-side connections, indexed by Connection::id.
+    std::unordered_map<uint64_t, Connection*> connections;
+
+    /// Identifier to assign to the next connection.
+    uint64_t nextConnectionId;
+
+    INTRUSIVE_LIST_TYPEDEF(ShmSession, sessionLinks) SessionList;
+    /// Client sessions that are still open; polled by #poller.
+    SessionList sessions;
+
+    /// Pool allocator for ShmServerRpc objects.
+    ServerRpcPool<ShmServerRpc> serverRpcPool;
+
+    /// Pool allocator for ShmClientRpc objects.
+    ObjectPool<ShmClientRpc> clientRpcPool;
+
+    /// Polls all connections and sessions.
+    Poller poller;
+
+    DISALLOW_COPY_AND_ASSIGN(ShmTransport);
+};
+
+}  // namespace RAMCloud
+
+#endif  // RAMCLOUD_SHMTRANSPORT_H
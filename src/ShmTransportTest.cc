@@ -0,0 +1,315 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any purpose
+ * with or without fee is hereby granted, provided that the above copyright
+ * notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockSyscall.h"
+#include "MockWrapper.h"
+#include "ShmTransport.h"
+#include "WorkerManager.h"
+
+namespace RAMCloud {
+
+class ShmTransportTest : public ::testing::Test {
+  public:
+    Context context;
+    WorkerManager* workerManager;
+    ServiceLocator locator;
+    TestLog::Enable logEnabler;
+    ShmTransport server;
+    ShmTransport client;
+
+    ShmTransportTest()
+            : context()
+            , workerManager(NULL)
+            , locator(format("shm:name=ShmTransportTest.%d", getpid()))
+            , logEnabler()
+            , server(&context, &locator)
+            , client(&context)
+    {
+        workerManager = new WorkerManager(&context);
+        context.workerManager = workerManager;
+        workerManager->testingSaveRpcs = 1;
+    }
+
+    string catchConstruct(ServiceLocator* locator) {
+        string message("no exception");
+        try {
+            ShmTransport server2(&context, locator);
+        } catch (TransportException& e) {
+            message = e.message;
+        }
+        return message;
+    }
+
+    // Run the dispatcher until the server has mapped the shared memory of
+    // a session (but give up if it takes too long).
+    bool waitForSession(ShmTransport& transport)
+    {
+        // See "Timing-Dependent Tests" in designNotes.
+        for (int i = 0; i < 1000; i++) {
+            context.dispatch->poll();
+            for (auto& entry : transport.connections) {
+                if (entry.second->region)
+                    return true;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ShmTransportTest);
+};
+
+TEST_F(ShmTransportTest, sanityCheck) {
+    Transport::SessionRef session = client.getSession(&locator);
+
+    // Send two requests from the client.
+    MockWrapper rpc1("request1");
+    session->sendRequest(&rpc1.request, &rpc1.response, &rpc1);
+    MockWrapper rpc2("request2");
+    session->sendRequest(&rpc2.request, &rpc2.response, &rpc2);
+
+    // Receive the two requests on the server.
+    Transport::ServerRpc* serverRpc1 = workerManager->waitForRpc(1.0);
+    EXPECT_TRUE(serverRpc1 != NULL);
+    EXPECT_EQ("request1", TestUtil::toString(&serverRpc1->requestPayload));
+    Transport::ServerRpc* serverRpc2 = workerManager->waitForRpc(1.0);
+    EXPECT_TRUE(serverRpc2 != NULL);
+    EXPECT_EQ("request2", TestUtil::toString(&serverRpc2->requestPayload));
+    EXPECT_EQ(format("shm:pid=%d", getpid()),
+            serverRpc1->getClientServiceLocator());
+
+    // Reply to the requests in backwards order.
+    serverRpc2->replyPayload.fillFromString("response2");
+    serverRpc2->sendReply();
+    serverRpc1->replyPayload.fillFromString("response1");
+    serverRpc1->sendReply();
+
+    // Receive the responses in the client.
+    EXPECT_STREQ("completed: 0, failed: 0", rpc1.getState());
+    EXPECT_STREQ("completed: 0, failed: 0", rpc2.getState());
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc1));
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc2));
+    EXPECT_EQ("response1", TestUtil::toString(&rpc1.response));
+    EXPECT_EQ("response2", TestUtil::toString(&rpc2.response));
+}
+
+TEST_F(ShmTransportTest, constructor_noName) {
+    ServiceLocator badLocator("shm:");
+    EXPECT_EQ("ShmTransport service locator 'shm:' is missing the 'name' "
+            "option", catchConstruct(&badLocator));
+}
+
+TEST_F(ShmTransportTest, constructor_nameInUse) {
+    EXPECT_EQ(format("ShmTransport couldn't bind to '%s': Address already "
+            "in use", locator.getOriginalString().c_str()),
+            catchConstruct(&locator));
+}
+
+TEST_F(ShmTransportTest, Ring_wrapAround) {
+    char memory[sizeof(ShmTransport::RingControl) + 16];
+    ShmTransport::Ring::initialize(memory);
+    ShmTransport::Ring ring;
+    ring.attach(memory, 16);
+    EXPECT_EQ(0u, ring.readableBytes());
+    EXPECT_EQ(16u, ring.writableBytes());
+
+    EXPECT_EQ(10u, ring.write("abcdefghij", 10));
+    char output[20];
+    EXPECT_EQ(6u, ring.read(output, 6));
+    EXPECT_EQ("abcdef", string(output, 6));
+
+    // Only 12 bytes fit; the write wraps around the end of the ring.
+    EXPECT_EQ(12u, ring.write("0123456789ABCDEF", 16));
+    EXPECT_EQ(0u, ring.writableBytes());
+    Buffer buffer;
+    EXPECT_EQ(16u, ring.read(&buffer, 20));
+    EXPECT_EQ("ghij0123456789AB", TestUtil::toString(&buffer));
+
+    EXPECT_EQ(3u, ring.writeZeros(3));
+    EXPECT_EQ(2u, ring.skip(2));
+    EXPECT_EQ(1u, ring.read(output, 5));
+    EXPECT_EQ(0, output[0]);
+}
+
+TEST_F(ShmTransportTest, Ring_corruptCounters) {
+    char memory[sizeof(ShmTransport::RingControl) + 16];
+    ShmTransport::Ring::initialize(memory);
+    ShmTransport::Ring consumer;
+    consumer.attach(memory, 16);
+    ShmTransport::Ring producer;
+    producer.attach(memory, 16);
+    EXPECT_EQ(4u, producer.write("abcd", 4));
+
+    // A head more than a ring's worth beyond our tail is refused.
+    ShmTransport::RingControl* control =
+            reinterpret_cast<ShmTransport::RingControl*>(memory);
+    control->head.store(17);
+    char output[20];
+    EXPECT_EQ(0u, consumer.read(output, 20));
+    EXPECT_TRUE(consumer.isCorrupt());
+    control->head.store(4);
+    EXPECT_EQ(0u, consumer.readableBytes());
+
+    // So is a tail beyond our head.
+    EXPECT_FALSE(producer.isCorrupt());
+    control->tail.store(5);
+    EXPECT_EQ(0u, producer.write("efgh", 4));
+    EXPECT_TRUE(producer.isCorrupt());
+}
+
+TEST_F(ShmTransportTest, sendRequest_largeMessages) {
+    // The messages are much larger than the rings, so they have to be
+    // streamed through them.
+    ServiceLocator smallRings(locator.getOriginalString() + ",ringBytes=1024");
+    Transport::SessionRef session = client.getSession(&smallRings);
+    MockWrapper rpc;
+    TestUtil::fillLargeBuffer(&rpc.request, 50000);
+    session->sendRequest(&rpc.request, &rpc.response, &rpc);
+
+    Transport::ServerRpc* serverRpc = workerManager->waitForRpc(1.0);
+    ASSERT_TRUE(serverRpc != NULL);
+    EXPECT_EQ("ok", TestUtil::checkLargeBuffer(&serverRpc->requestPayload,
+            50000));
+    TestUtil::fillLargeBuffer(&serverRpc->replyPayload, 40000);
+    serverRpc->sendReply();
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc));
+    EXPECT_EQ("ok", TestUtil::checkLargeBuffer(&rpc.response, 40000));
+}
+
+TEST_F(ShmTransportTest, cancelRequest_partiallySent) {
+    ServiceLocator smallRings(locator.getOriginalString() + ",ringBytes=1024");
+    Transport::SessionRef session = client.getSession(&smallRings);
+    Tub<MockWrapper> rpc1;
+    rpc1.construct();
+    TestUtil::fillLargeBuffer(&rpc1->request, 5000);
+    session->sendRequest(&rpc1->request, &rpc1->response, rpc1.get());
+    MockWrapper rpc2("request2");
+    session->sendRequest(&rpc2.request, &rpc2.response, &rpc2);
+
+    // Cancel the first request after only part of it fit in the ring; the
+    // rest of it is filled in with zeros.
+    session->cancelRequest(rpc1.get());
+    rpc1.destroy();
+    Transport::ServerRpc* serverRpc1 = workerManager->waitForRpc(1.0);
+    ASSERT_TRUE(serverRpc1 != NULL);
+    EXPECT_EQ(5000u, serverRpc1->requestPayload.size());
+    EXPECT_EQ(0, *serverRpc1->requestPayload.getOffset<char>(4999));
+    serverRpc1->replyPayload.fillFromString("response1");
+    serverRpc1->sendReply();
+
+    // The second request is unaffected.
+    Transport::ServerRpc* serverRpc2 = workerManager->waitForRpc(1.0);
+    ASSERT_TRUE(serverRpc2 != NULL);
+    EXPECT_EQ("request2", TestUtil::toString(&serverRpc2->requestPayload));
+    serverRpc2->replyPayload.fillFromString("response2");
+    serverRpc2->sendReply();
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc2));
+    EXPECT_EQ("response2", TestUtil::toString(&rpc2.response));
+}
+
+TEST_F(ShmTransportTest, sessionClosedByServer) {
+    ServiceLocator locator2(format("shm:name=ShmTransportTest2.%d",
+            getpid()));
+    Tub<ShmTransport> server2;
+    server2.construct(&context, &locator2);
+    Transport::SessionRef session = client.getSession(&locator2);
+    EXPECT_TRUE(waitForSession(*server2));
+    MockWrapper rpc("request");
+    session->sendRequest(&rpc.request, &rpc.response, &rpc);
+
+    server2.destroy();
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc));
+    EXPECT_STREQ("completed: 0, failed: 1", rpc.getState());
+
+    // New requests fail immediately.
+    MockWrapper rpc2("request2");
+    session->sendRequest(&rpc2.request, &rpc2.response, &rpc2);
+    EXPECT_STREQ("completed: 0, failed: 1", rpc2.getState());
+}
+
+TEST_F(ShmTransportTest, sessionClosedByClient) {
+    Transport::SessionRef session = client.getSession(&locator);
+    EXPECT_TRUE(waitForSession(server));
+    EXPECT_EQ(1u, server.connections.size());
+    session->abort();
+    for (int i = 0; (i < 1000) && !server.connections.empty(); i++) {
+        context.dispatch->poll();
+        usleep(1000);
+    }
+    EXPECT_EQ(0u, server.connections.size());
+}
+
+TEST_F(ShmTransportTest, sessionConstructor_ringBytesTooLarge) {
+    ServiceLocator bigRings(format("%s,ringBytes=%u",
+            locator.getOriginalString().c_str(),
+            ShmTransport::MAX_RING_BYTES + 1));
+    string message("no exception");
+    try {
+        client.getSession(&bigRings);
+    } catch (TransportException& e) {
+        message = e.message;
+    }
+    EXPECT_EQ(format("ShmTransport ringBytes option must be between %u and "
+            "%u", ShmTransport::MIN_RING_BYTES, ShmTransport::MAX_RING_BYTES),
+            message);
+}
+
+TEST_F(ShmTransportTest, serverSocketHandler_unsealedRegion) {
+    Transport::SessionRef session = client.getSession(&locator);
+
+    // Make the server's check of the seals fail.
+    MockSyscall sys;
+    sys.fcntlErrno = EINVAL;
+    Syscall* savedSys = ShmTransport::sys;
+    ShmTransport::sys = &sys;
+    TestLog::reset();
+    for (int i = 0; (i < 1000) && !TestUtil::contains(TestLog::get(),
+            "unsealed"); i++) {
+        context.dispatch->poll();
+        usleep(1000);
+    }
+    ShmTransport::sys = savedSys;
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), "handleFileEvent: "
+            "ShmTransport received unsealed shared memory region from "
+            "client pid"));
+    EXPECT_EQ(0u, server.connections.size());
+}
+
+TEST_F(ShmTransportTest, poll_corruptRings) {
+    Transport::SessionRef session = client.getSession(&locator);
+    EXPECT_TRUE(waitForSession(server));
+    ShmTransport::ShmSession* shmSession =
+            static_cast<ShmTransport::ShmSession*>(session.get());
+    MockWrapper rpc("request");
+    session->sendRequest(&rpc.request, &rpc.response, &rpc);
+
+    // The client claims to have written far more than fits in the ring.
+    shmSession->region->requests.control->head.store(1lu << 40);
+    TestLog::reset();
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc));
+    EXPECT_STREQ("completed: 0, failed: 1", rpc.getState());
+    EXPECT_EQ(0u, server.connections.size());
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), "poll: ShmTransport "
+            "found corrupt rings in session with client pid"));
+}
+
+TEST_F(ShmTransportTest, getRpcInfo) {
+    Transport::SessionRef session = client.getSession(&locator);
+    EXPECT_EQ(format("no active RPCs to server at %s",
+            locator.getOriginalString().c_str()), session->getRpcInfo());
+}
+
+}  // namespace RAMCloud
@@ -18,6 +18,7 @@
 
 #include <linux/futex.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <netinet/in.h>
@@ -75,6 +76,10 @@ class Syscall {
         return ::epoll_wait(epfd, events, maxEvents, timeout);
     }
     VIRTUAL_FOR_TESTING
+    int eventfd(unsigned int initval, int flags) {
+        return ::eventfd(initval, flags);
+    }
+    VIRTUAL_FOR_TESTING
     void exit(int status) {
         ::exit(status);
     }
@@ -121,6 +126,10 @@ class Syscall {
         return ::pwrite(fd, buf, count, offset);
     }
     VIRTUAL_FOR_TESTING
+    ssize_t read(int fd, void* buf, size_t count) {
+        return ::read(fd, buf, count);
+    }
+    VIRTUAL_FOR_TESTING
     ssize_t recv(int sockfd, void *buf, size_t len, int flags) {
         return ::recv(sockfd, buf, len, flags);
     }
@@ -130,6 +139,10 @@ class Syscall {
         return ::recvfrom(sockfd, buf, len, flags, from, fromLen);
     }
     VIRTUAL_FOR_TESTING
+    ssize_t recvmsg(int sockfd, msghdr *msg, int flags) {
+        return ::recvmsg(sockfd, msg, flags);
+    }
+    VIRTUAL_FOR_TESTING
     ssize_t recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
             unsigned int flags, struct timespec *timeout) {
         return ::recvmmsg(sockfd, msgvec, vlen, flags, timeout);
@@ -14,6 +14,7 @@
  */
 
 #include "TableEnumerator.h"
+#include "ObjectFinder.h"
 #include "ShortMacros.h"
 
 namespace RAMCloud {
@@ -38,12 +39,78 @@ TableEnumerator::TableEnumerator(RamCloud& ramcloud,
     : ramcloud(ramcloud)
     , tableId(tableId)
     , keysOnly(keysOnly)
-    , tabletStartHash(0)
+    , filter()
+    , maxParallel(1)
+    , started(false)
     , done(false)
+    , streams()
+    , current(NULL)
+    , nextOffset(0)
+{
+}
+
+/**
+ * Constructor for TableEnumerator objects that return only the objects
+ * matching a filter, and that may fetch from several tablets at once.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster to use for this
+ *      enumeration.
+ * \param tableId
+ *      Identifier for the table to enumerate.
+ * \param keysOnly
+ *      False means that full objects are returned, containing both keys
+ *      and data. True means that the returned objects have
+ *      been truncated so that the object data (normally the last
+ *      field of the object) is omitted.
+ * \param filter
+ *      Evaluated by the masters: only matching objects are returned, and
+ *      only the parts of them that the filter selects. Copied.
+ * \param maxParallel
+ *      Maximum number of enumeration RPCs outstanding at once. Values
+ *      greater than 1 cause the tablets of the table to be enumerated
+ *      concurrently (at most one RPC per tablet at a time), in which case
+ *      objects are no longer returned in tablet order.
+ */
+TableEnumerator::TableEnumerator(RamCloud& ramcloud,
+                                uint64_t tableId,
+                                bool keysOnly,
+                                const EnumerationFilter& filter,
+                                uint32_t maxParallel)
+    : ramcloud(ramcloud)
+    , tableId(tableId)
+    , keysOnly(keysOnly)
+    , filter(filter)
+    , maxParallel(std::max(maxParallel, 1u))
+    , started(false)
+    , done(false)
+    , streams()
+    , current(NULL)
+    , nextOffset(0)
+{
+}
+
+/**
+ * Construct a Stream.
+ *
+ * \param firstHash
+ *      Smallest key hash covered by the stream.
+ * \param lastHash
+ *      Largest key hash covered by the stream.
+ * \param filter
+ *      The enumeration's filter; copied.
+ */
+TableEnumerator::Stream::Stream(uint64_t firstHash, uint64_t lastHash,
+                                const EnumerationFilter& filter)
+    : lastHash(lastHash)
+    , nextHash(firstHash)
+    , filter(filter)
     , state()
     , objects()
-    , nextOffset(0)
+    , rpc()
 {
+    if (lastHash != ~0UL)
+        this->filter.setKeyHashLimit(lastHash);
 }
 
 /**
@@ -84,6 +151,7 @@ TableEnumerator::next(uint32_t* size, const void** object)
     requestMoreObjects();
     if (done) return;
 
+    Buffer& objects = current->objects;
     uint32_t objectSize = *objects.getOffset<uint32_t>(nextOffset);
     nextOffset += downCast<uint32_t>(sizeof(uint32_t));
 
@@ -123,8 +191,8 @@ TableEnumerator::nextObjectBlob(Buffer** buffer)
     if (done) {
         return;
     }
-    nextOffset = objects.size();
-    *buffer = &objects;
+    nextOffset = current->objects.size();
+    *buffer = &current->objects;
 }
 
 /**
@@ -170,32 +238,108 @@ TableEnumerator::nextKeyAndData(uint32_t* keyLength, const void** key,
     }
 }
 
+/**
+ * Used internally when an enumeration starts to create #streams. If the
+ * enumeration is parallel there is one stream for each tablet of the
+ * table, as currently known to the client; otherwise a single stream
+ * covers the whole table.
+ */
+void
+TableEnumerator::divideTable()
+{
+    if (maxParallel == 1) {
+        streams.emplace_back(0, ~0UL, filter);
+        return;
+    }
+
+    ObjectFinder* objectFinder = ramcloud.clientContext->objectFinder;
+    uint64_t firstHash = 0;
+    while (true) {
+        TabletWithLocator* tablet = objectFinder->lookupTablet(tableId,
+                firstHash);
+        uint64_t lastHash = tablet->tablet.endKeyHash;
+        streams.emplace_back(firstHash, lastHash, filter);
+        if (lastHash == ~0UL)
+            break;
+        firstHash = lastHash + 1;
+    }
+}
+
 /**
  * Used internally by #hasNext() and #next() to retrieve objects. Will
- * set the #done field if enumeration is complete. Otherwise the
- * #objects Buffer will contain at least one object.
+ * set the #done field if enumeration is complete. Otherwise
+ * #current will refer to a stream whose objects Buffer contains at least
+ * one object.
  */
 void
 TableEnumerator::requestMoreObjects()
 {
-    if (done || nextOffset < objects.size()) return;
+    if (done || (current != NULL && nextOffset < current->objects.size()))
+        return;
 
+    if (!started) {
+        divideTable();
+        started = true;
+    }
+    if (current != NULL) {
+        current->objects.reset();
+        current = NULL;
+    }
     nextOffset = 0;
+
     while (true) {
-        tabletStartHash = ramcloud.enumerateTable(tableId, keysOnly,
-                                            tabletStartHash, state, objects);
-        if (objects.size() > 0) {
-            return;
+        // Keep up to maxParallel RPCs outstanding, at most one per stream.
+        uint32_t outstanding = 0;
+        foreach (Stream& stream, streams) {
+            if (stream.rpc)
+                outstanding++;
         }
-        // End of table?
-        if (objects.size() == 0 && tabletStartHash == 0) {
+        foreach (Stream& stream, streams) {
+            if (outstanding >= maxParallel)
+                break;
+            if (stream.rpc || stream.objects.size() > 0)
+                continue;
+            stream.rpc.construct(&ramcloud, tableId, keysOnly,
+                    stream.nextHash, stream.state, stream.objects,
+                    &stream.filter);
+            outstanding++;
+        }
+
+        std::list<Stream>::iterator it = streams.begin();
+        while (it != streams.end()) {
+            Stream& stream = *it;
+            if (stream.objects.size() > 0 && !stream.rpc) {
+                // Objects that arrived while another stream was being read.
+                current = &stream;
+                return;
+            }
+            if (!stream.rpc || !stream.rpc->isReady()) {
+                it++;
+                continue;
+            }
+            stream.nextHash = stream.rpc->wait(stream.state);
+            stream.rpc.destroy();
+            if (stream.objects.size() > 0) {
+                current = &stream;
+                return;
+            }
+
+            // No more objects from the server we contacted. If its tablet
+            // ended before the end of this stream's range there are
+            // probably some objects on a different server: try again with
+            // the next tablet. A nextHash of 0 means the end of the table.
+            if (stream.nextHash == 0 || stream.nextHash > stream.lastHash) {
+                it = streams.erase(it);
+                continue;
+            }
+            it++;
+        }
+
+        if (streams.empty()) {
             done = true;
             return;
         }
-
-        // If we get here it means that the last server we contacted
-        // has no more objects for us, but there are probably some other
-        // objects in a different server. Try again with a new server.
+        ramcloud.poll();
     }
 }
 
@@ -16,8 +16,12 @@
 #ifndef RAMCLOUD_TABLEENUMERATOR_H
 #define RAMCLOUD_TABLEENUMERATOR_H
 
+#include <list>
+
 #include "RamCloud.h"
+#include "EnumerationFilter.h"
 #include "Object.h"
+#include "Tub.h"
 
 namespace RAMCloud {
 
@@ -25,16 +29,62 @@ namespace RAMCloud {
  * This class provides the client-side interface for table enumeration;
  * each instance of this class can be used to enumerate the objects in
  * a single table.
+ *
+ * By default the tablets of the table are enumerated one at a time, with
+ * one RPC outstanding. Optionally, the enumeration can be restricted to
+ * the objects matching an EnumerationFilter (which is evaluated on the
+ * masters) and can fetch from several tablets concurrently; in that case
+ * objects from different tablets are returned in the order in which
+ * their RPCs complete.
  */
 class TableEnumerator {
   public:
     TableEnumerator(RamCloud& ramCloud, uint64_t tableId, bool keysOnly);
+    TableEnumerator(RamCloud& ramCloud, uint64_t tableId, bool keysOnly,
+                    const EnumerationFilter& filter, uint32_t maxParallel = 1);
     bool hasNext();
     void next(uint32_t* size, const void** object);
     void nextObjectBlob(Buffer** buffer);
     void nextKeyAndData(uint32_t* keyLength, const void** key,
                         uint32_t* dataLength, const void** data);
-  private:
+  PRIVATE:
+    /**
+     * Enumeration state for one range of key hashes. Each stream is
+     * enumerated with its own sequence of EnumerateTableRpcs; when
+     * enumerating in parallel there is one stream for each tablet of the
+     * table (as of when the enumeration started).
+     */
+    struct Stream {
+        Stream(uint64_t firstHash, uint64_t lastHash,
+               const EnumerationFilter& filter);
+
+        /// Largest key hash covered by this stream.
+        uint64_t lastHash;
+
+        /// Where to continue enumeration (the tabletFirstHash for the
+        /// next RPC).
+        uint64_t nextHash;
+
+        /// The caller's filter, restricted to the stream's key hashes so
+        /// that objects are returned exactly once even if tablets have
+        /// been merged since the streams were created.
+        EnumerationFilter filter;
+
+        /// Opaque storage keeps track of the state of enumeration;
+        /// contents are managed by the server.
+        Buffer state;
+
+        /// Objects returned by the most recent RPC; empty once they
+        /// have all been consumed.
+        Buffer objects;
+
+        /// The RPC currently fetching objects for this stream, if any.
+        Tub<EnumerateTableRpc> rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Stream);
+    };
+
+    void divideTable();
     void requestMoreObjects();
 
     /// The RamCloud master object.
@@ -49,21 +99,27 @@ class TableEnumerator {
     /// field of the object) is omitted.
     bool keysOnly;
 
-    /// The start hash of the tablet being enumerated.
-    uint64_t tabletStartHash;
+    /// Selects the objects to return; see EnumerationFilter.
+    EnumerationFilter filter;
+
+    /// Maximum number of RPCs outstanding at once. If this is 1, the
+    /// table is enumerated as a single stream.
+    uint32_t maxParallel;
+
+    /// Set to true once #streams has been created.
+    bool started;
 
     /// Set to true when the entire enumeration has completed.
     bool done;
 
-    /// Opaque storage keeps track of the state of enumeration;
-    /// contents are managed by the server.
-    Buffer state;
+    /// Streams whose enumeration hasn't finished, in key hash order.
+    std::list<Stream> streams;
 
-    /// A buffer to hold the payload of object last received from
-    /// the server, and currently being read out by the client.
-    Buffer objects;
+    /// The stream whose objects are currently being read out by the
+    /// client, or NULL if none.
+    Stream* current;
 
-    /// The next offset to read within the objects buffer.
+    /// The next offset to read within current->objects.
     uint32_t nextOffset;
 
     DISALLOW_COPY_AND_ASSIGN(TableEnumerator);
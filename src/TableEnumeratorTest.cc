@@ -312,4 +312,77 @@ TEST_F(TableEnumeratorTest, nextKeyData) {
     EXPECT_FALSE(iter.hasNext());
 }
 
+TEST_F(TableEnumeratorTest, filter) {
+    ramcloud.write(tableId1, "user:0", 6, "abcdef", 6);
+    ramcloud.write(tableId1, "user:1", 6, "ghijkl", 6);
+    ramcloud.write(tableId1, "item:2", 6, "abcxyz", 6);
+    ramcloud.write(tableId1, "user:3", 6, "abcuvw", 6);
+
+    EnumerationFilter filter;
+    filter.setKeyPrefix("user:", 5);
+    filter.setValuePattern(0, "abc", 3);
+    filter.setValueSlice(3, 2);
+    TableEnumerator iter(ramcloud, tableId1, false, filter);
+
+    std::vector<string> results;
+    uint32_t keyLength, dataLength;
+    const void* key;
+    const void* data;
+    while (iter.hasNext()) {
+        iter.nextKeyAndData(&keyLength, &key, &dataLength, &data);
+        results.push_back(string(static_cast<const char*>(key), keyLength) +
+                "=" + string(static_cast<const char*>(data), dataLength));
+    }
+    std::sort(results.begin(), results.end());
+    ASSERT_EQ(2U, results.size());
+    EXPECT_EQ("user:0=de", results[0]);
+    EXPECT_EQ("user:3=uv", results[1]);
+}
+
+TEST_F(TableEnumeratorTest, parallel) {
+    uint32_t totalObjects = 200;
+    for (uint32_t i = 0; i < totalObjects; i++) {
+        ramcloud.write(tableId1, &i, 4, &i, 4);
+    }
+
+    EnumerationFilter filter;
+    TableEnumerator iter(ramcloud, tableId1, false, filter, 4);
+    std::vector<bool> seen(totalObjects, false);
+    uint32_t count = 0;
+    while (iter.hasNext()) {
+        uint32_t size;
+        const void* buffer;
+        iter.next(&size, &buffer);
+        Object object(buffer, size);
+        uint32_t key = *static_cast<const uint32_t*>(object.getKey());
+        ASSERT_LT(key, totalObjects);
+        EXPECT_FALSE(seen[key]);
+        seen[key] = true;
+        count++;
+    }
+    EXPECT_EQ(totalObjects, count);
+    EXPECT_EQ(0U, iter.streams.size());
+}
+
+TEST_F(TableEnumeratorTest, divideTable) {
+    EnumerationFilter filter;
+    TableEnumerator iter(ramcloud, tableId1, false, filter, 4);
+    iter.divideTable();
+    ASSERT_EQ(2U, iter.streams.size());
+    EXPECT_EQ(0U, iter.streams.front().nextHash);
+    EXPECT_EQ(0x7fffffffffffffffUL, iter.streams.front().lastHash);
+    EXPECT_EQ(0x7fffffffffffffffUL,
+            iter.streams.front().filter.lastKeyHash);
+    EXPECT_EQ(0x8000000000000000UL, iter.streams.back().nextHash);
+    EXPECT_EQ(~0UL, iter.streams.back().lastHash);
+    EXPECT_TRUE(iter.streams.back().filter.isEmpty());
+
+    // Sequential enumerations use a single stream for the whole table.
+    TableEnumerator sequential(ramcloud, tableId1, false);
+    sequential.divideTable();
+    ASSERT_EQ(1U, sequential.streams.size());
+    EXPECT_EQ(0U, sequential.streams.front().nextHash);
+    EXPECT_EQ(~0UL, sequential.streams.front().lastHash);
+}
+
 }  // namespace RAMCloud
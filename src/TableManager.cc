@@ -42,6 +42,9 @@ TableManager::TableManager(Context* context,
     , directory()
     , idMap()
     , backingTableMap()
+    , nextConfigVersion((generateRandom() >> 1) + 1)
+    , tableConfigLock("TableManager::tableConfigLock")
+    , tableConfigs()
 {
     context->tableManager = this;
 }
@@ -180,6 +183,7 @@ TableManager::coordSplitAndMigrateIndexlet(
     index->indexlets.push_back(new Indexlet(
             splitKey, splitKeyLength, firstNotOwnedKey, firstNotOwnedKeyLength,
             newOwner, newBackingTableId, tableId, indexId));
+    invalidateTableConfig(lock, table);
 
     MasterClient::takeIndexletOwnership(
             context, newOwner, tableId, indexId, newBackingTableId,
@@ -298,6 +302,7 @@ TableManager::createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
     }
 
     table->indexMap[indexId] = index;
+    invalidateTableConfig(lock, table);
     notifyCreateIndex(lock, index);
     return;
 }
@@ -408,6 +413,60 @@ TableManager::dropIndex(uint64_t tableId, uint8_t indexId)
     dropIndex(lock, tableId, indexId);
 }
 
+/**
+ * Returns a snapshot of the configuration of a table, for use in responding
+ * to GET_TABLE_CONFIG requests. Snapshots are created on demand and then
+ * reused until the table changes, so most calls return quickly without
+ * acquiring the monitor lock.
+ *
+ * \param tableId
+ *      The id of the table whose configuration is desired.
+ * \return
+ *      The table's current configuration. If the table doesn't exist, the
+ *      configuration is empty and its version is 0.
+ */
+std::shared_ptr<const TableManager::TableConfigSnapshot>
+TableManager::getTableConfig(uint64_t tableId)
+{
+    {
+        SpinLock::Guard _(tableConfigLock);
+        auto it = tableConfigs.find(tableId);
+        if (it != tableConfigs.end())
+            return it->second;
+    }
+
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        return std::make_shared<const TableConfigSnapshot>(0, "");
+    Table* table = it->second;
+
+    // Some other thread may have created the snapshot while we were
+    // waiting for the lock.
+    {
+        SpinLock::Guard _(tableConfigLock);
+        auto cached = tableConfigs.find(tableId);
+        if (cached != tableConfigs.end())
+            return cached->second;
+    }
+
+    ProtoBuf::TableConfig tableConfig;
+    bool complete = serializeTableConfig(lock, table, &tableConfig);
+    string config;
+    tableConfig.SerializeToString(&config);
+    if (!complete) {
+        // Don't let clients hang on to this configuration: it will be
+        // different once the missing masters' tablets have been recovered.
+        return std::make_shared<const TableConfigSnapshot>(0, config);
+    }
+    std::shared_ptr<const TableConfigSnapshot> snapshot =
+            std::make_shared<const TableConfigSnapshot>(table->configVersion,
+            config);
+    SpinLock::Guard _(tableConfigLock);
+    tableConfigs[tableId] = snapshot;
+    return snapshot;
+}
+
 /**
  * Return the tableId of the table with the given name.
  *
@@ -554,6 +613,7 @@ TableManager::indexletRecovered(
         {
             indexlet->serverId = serverId;
             indexlet->backingTableId = backingTableId;
+            invalidateTableConfig(lock, table);
             foundIndexlet = 1;
             LOG(NOTICE, "found indexlet and changed its server id to %s",
                 serverId.toString().c_str());
@@ -564,6 +624,25 @@ TableManager::indexletRecovered(
     }
 }
 
+/**
+ * Invoked whenever the tablets or indexlets of a table change: gives the
+ * table's configuration a new version and discards its snapshot, so that
+ * the next GET_TABLE_CONFIG request sees the change.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table that has changed (or has just been created or is about to be
+ *      deleted).
+ */
+void
+TableManager::invalidateTableConfig(const Lock& lock, Table* table)
+{
+    table->configVersion = nextConfigVersion++;
+    SpinLock::Guard _(tableConfigLock);
+    tableConfigs.erase(table->id);
+}
+
 /**
  * Return if a table is indexlet table or not
  *
@@ -598,12 +677,17 @@ TableManager::markAllTabletsRecovering(ServerId serverId)
     for (Directory::iterator it = directory.begin(); it != directory.end();
             ++it) {
         Table* table = it->second;
+        bool changed = false;
         foreach (Tablet* tablet, table->tablets) {
             if (tablet->serverId == serverId) {
                 tablet->status = Tablet::RECOVERING;
+                tablet->recoveryMasterId = ServerId();
                 results.push_back(*tablet);
+                changed = true;
             }
         }
+        if (changed)
+            invalidateTableConfig(lock, table);
     }
     return results;
 }
@@ -668,6 +752,8 @@ TableManager::reassignTabletOwnership(
     tablet->ctime = headOfLogAtCreation;
     tablet->serverId = newOwner;
     tablet->status = Tablet::NORMAL;
+    tablet->recoveryMasterId = ServerId();
+    invalidateTableConfig(lock, table);
 
     // Record information about the new assignment in external storage,
     // in case we crash.
@@ -685,6 +771,44 @@ TableManager::reassignTabletOwnership(
     updateManager->updateFinished(externalInfo.sequence_number());
 }
 
+/**
+ * Invoked by Recovery when it hands a recovering tablet to a recovery
+ * master. The master is advertised in the table's configuration, so that
+ * clients willing to accept degraded reads can read the tablet's objects
+ * from the master while it is still replaying them, rather than waiting
+ * for the recovery to finish. This information is not recorded in external
+ * storage: it only matters until the recovery completes.
+ *
+ * \param tableId
+ *      Id of table containing the tablet.
+ * \param startKeyHash
+ *      First key hash that is part of range of key hashes for the tablet.
+ * \param endKeyHash
+ *      Last key hash that is part of range of key hashes for the tablet.
+ * \param recoveryMasterId
+ *      The master that will replay the tablet.
+ */
+void
+TableManager::recoveryMasterAssigned(uint64_t tableId, uint64_t startKeyHash,
+        uint64_t endKeyHash, ServerId recoveryMasterId)
+{
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        return;
+    Table* table = it->second;
+    Tablet* tablet = findTablet(lock, table, startKeyHash);
+    if ((tablet->startKeyHash != startKeyHash) ||
+            (tablet->endKeyHash != endKeyHash) ||
+            (tablet->status != Tablet::RECOVERING)) {
+        // The tablet has changed since the recovery was planned; there's
+        // nothing useful to advertise.
+        return;
+    }
+    tablet->recoveryMasterId = recoveryMasterId;
+    invalidateTableConfig(lock, table);
+}
+
 /**
  * This method is called shortly after the coordinator assumes leadership
  * of the cluster; it recovers all of the table metadata from external
@@ -781,70 +905,7 @@ TableManager::serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
     IdMap::iterator it = idMap.find(tableId);
     if (it == idMap.end())
         return;
-    Table* table = it->second;
-
-    // filling tablets
-    foreach (Tablet* tablet, table->tablets) {
-        ProtoBuf::TableConfig::Tablet& entry(*tableConfig->add_tablet());
-        tablet->serialize((ProtoBuf::Tablets::Tablet&)entry);
-        try {
-            string locator = context->serverList->getLocator(
-                    tablet->serverId);
-            entry.set_service_locator(locator);
-        } catch (const ServerListException& e) {
-            RAMCLOUD_CLOG(NOTICE, "Server id (%s) in tablet map no longer "
-                    "in server list; omitting locator for entry (tableName %s, "
-                    "tableId %lu, startKeyHash 0x%lx)",
-                    tablet->serverId.toString().c_str(), table->name.c_str(),
-                    tableId, tablet->startKeyHash);
-        }
-    }
-
-    // filling indexes
-    for (IndexMap::const_iterator iit = table->indexMap.begin();
-            iit != table->indexMap.end(); ++iit) {
-        Index* index = iit->second;
-        if (index == NULL)
-            continue;
-
-        ProtoBuf::TableConfig::Index& index_entry(*tableConfig->add_index());
-        index_entry.set_index_id(index->indexId);
-        index_entry.set_index_type(index->indexType);
-
-        // filling indexlets
-        foreach (Indexlet* indexlet, index->indexlets) {
-            ProtoBuf::TableConfig::Index::Indexlet&
-                   entry(*index_entry.add_indexlet());
-            if (indexlet->firstKey != NULL) {
-                entry.set_start_key(string(
-                        reinterpret_cast<char*>(indexlet->firstKey),
-                        indexlet->firstKeyLength));
-            } else {
-                entry.set_start_key("");
-            }
-
-            if (indexlet->firstNotOwnedKey != NULL) {
-                entry.set_end_key(string(
-                        reinterpret_cast<char*>(indexlet->firstNotOwnedKey),
-                        indexlet->firstNotOwnedKeyLength));
-            } else {
-                entry.set_end_key("");
-            }
-
-            entry.set_server_id(indexlet->serverId.getId());
-            try {
-                string locator = context->serverList->getLocator(
-                        indexlet->serverId);
-                entry.set_service_locator(locator);
-            } catch (const ServerListException& e) {
-                RAMCLOUD_LOG(NOTICE, "Server id (%s) in index map no longer in "
-                    "server list; omitting locator for entry (tableName %s,"
-                    "tableId %lu, indexId %d)",
-                    indexlet->serverId.toString().c_str(), table->name.c_str(),
-                    tableId, index->indexId);
-            }
-        }
-    }
+    serializeTableConfig(lock, it->second, tableConfig);
 }
 
 /**
@@ -869,36 +930,32 @@ TableManager::splitTablet(const char* name, uint64_t splitKeyHash)
     Directory::iterator it = directory.find(name);
     if (it == directory.end())
         throw NoSuchTable(HERE);
-    Table* table = it->second;
-    Tablet* tablet = findTablet(lock, table, splitKeyHash);
-    if (splitKeyHash == tablet->startKeyHash)
-        return;
-    if (tablet->status == Tablet::RECOVERING) {
-        // We can't process this request right now, because recovery may
-        // undo it. Try again when recovery is finished.
-        throw RetryException(HERE, 1000000, 2000000,
-                "can't split tablet now: recovery is underway");
-    }
-
-    // Perform the split on our in-memory structures.
-    table->tablets.push_back(new Tablet(tablet->tableId, splitKeyHash,
-            tablet->endKeyHash, tablet->serverId, tablet->status,
-            tablet->ctime));
-    tablet->endKeyHash = splitKeyHash - 1;
-
-    // Record information about the split in external storage, in case we
-    // crash.
-    ProtoBuf::Table externalInfo;
-    serializeTable(lock, table, &externalInfo);
-    externalInfo.set_sequence_number(updateManager->nextSequenceNumber());
-    ProtoBuf::Table::Split* split = externalInfo.mutable_split();
-    split->set_server_id(tablet->serverId.getId());
-    split->set_split_key_hash(splitKeyHash);
-    syncTable(lock, table, &externalInfo);
+    splitTablet(lock, it->second, splitKeyHash);
+}
 
-    // Finish up by notifying the relevant master.
-    notifySplitTablet(lock, &externalInfo);
-    updateManager->updateFinished(externalInfo.sequence_number());
+/**
+ * Split a tablet into two disjoint tablets at a specific key hash. This
+ * method is identical to the one above, except that the table is specified
+ * by its id (this form is used by the TabletBalancer).
+ *
+ * \param tableId
+ *      Id of the table that contains the tablet to be split.
+ * \param splitKeyHash
+ *      Key hash to used to partition the tablet into two. Keys less than
+ *      \a splitKeyHash belong to one tablet, keys greater than or equal to
+ *      \a splitKeyHash belong to the other.
+ *
+ * \throw NoSuchTable
+ *      If tableId does not specify an existing table.
+ */
+void
+TableManager::splitTablet(uint64_t tableId, uint64_t splitKeyHash)
+{
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        throw NoSuchTable(HERE);
+    splitTablet(lock, it->second, splitKeyHash);
 }
 
 /**
@@ -935,6 +992,7 @@ TableManager::splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash)
             tablet->endKeyHash, tablet->serverId, tablet->status,
             tablet->ctime));
     tablet->endKeyHash = splitKeyHash - 1;
+    invalidateTableConfig(lock, table);
 
     // No need to record anything in external storage right now. If
     // recovery completes successfully, the Table info will get written
@@ -988,6 +1046,8 @@ TableManager::tabletRecovered(
     tablet->serverId = serverId;
     tablet->status = Tablet::NORMAL;
     tablet->ctime = ctime;
+    tablet->recoveryMasterId = ServerId();
+    invalidateTableConfig(lock, table);
 
     // Record this update in external storage, in case we crash.  For this
     // operation there is nothing to "complete" after crash recovery other
@@ -1079,6 +1139,7 @@ TableManager::createTable(const Lock& lock, const char* name,
     }
     directory[name] = table;
     idMap[tableId] = table;
+    invalidateTableConfig(lock, table);
 
     // Create a record in external storage.  If we crash, this will be used
     // by the next coordinator (a) so that it knows about the existence of
@@ -1137,6 +1198,7 @@ TableManager::dropIndex(const Lock& lock, uint64_t tableId, uint8_t indexId)
 
     LOG(NOTICE, "Dropping index '%u' from table '%lu'", indexId, tableId);
     table->indexMap.erase(indexId);
+    invalidateTableConfig(lock, table);
     notifyDropIndex(lock, index);
     delete index;
 
@@ -1199,6 +1261,7 @@ TableManager::dropTable(const Lock& lock, const char* name)
     }
 
     // Delete the table and notify the masters storing its tablets.
+    invalidateTableConfig(lock, table);
     directory.erase(it);
     idMap.erase(table->id);
     delete table;
@@ -1592,6 +1655,7 @@ TableManager::recreateTable(const Lock& lock, ProtoBuf::Table* info)
     }
     directory[name] = table;
     idMap[id] = table;
+    invalidateTableConfig(lock, table);
     return table;
 }
 
@@ -1633,6 +1697,155 @@ TableManager::serializeTable(const Lock& lock, Table* table,
     }
 }
 
+/**
+ * Does most of the work of the public serializeTableConfig and of
+ * getTableConfig: fills in a protocol buffer with information describing
+ * which masters store which pieces of data for a given table.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table whose configuration should be serialized.
+ * \param[out] tableConfig
+ *      Protocol buffer to which entries are added representing each of
+ *      the tablets and indexes of the table.
+ * \return
+ *      False means that the locator for some tablet or indexlet was
+ *      omitted, because its master is no longer in the server list; true
+ *      means the configuration is complete.
+ */
+bool
+TableManager::serializeTableConfig(const Lock& lock, Table* table,
+        ProtoBuf::TableConfig* tableConfig)
+{
+    bool complete = true;
+
+    // filling tablets
+    foreach (Tablet* tablet, table->tablets) {
+        ProtoBuf::TableConfig::Tablet& entry(*tableConfig->add_tablet());
+        tablet->serialize((ProtoBuf::Tablets::Tablet&)entry);
+        try {
+            string locator = context->serverList->getLocator(
+                    tablet->serverId);
+            entry.set_service_locator(locator);
+        } catch (const ServerListException& e) {
+            RAMCLOUD_CLOG(NOTICE, "Server id (%s) in tablet map no longer "
+                    "in server list; omitting locator for entry (tableName %s, "
+                    "tableId %lu, startKeyHash 0x%lx)",
+                    tablet->serverId.toString().c_str(), table->name.c_str(),
+                    table->id, tablet->startKeyHash);
+            complete = false;
+        }
+        if (tablet->status == Tablet::RECOVERING &&
+                tablet->recoveryMasterId.isValid()) {
+            try {
+                entry.set_recovery_service_locator(
+                        context->serverList->getLocator(
+                        tablet->recoveryMasterId));
+                entry.set_recovery_server_id(
+                        tablet->recoveryMasterId.getId());
+            } catch (const ServerListException& e) {
+                // The recovery master has vanished, so the recovery will
+                // be retried (and the tablet reassigned); leave it out.
+            }
+        }
+    }
+
+    // filling indexes
+    for (IndexMap::const_iterator iit = table->indexMap.begin();
+            iit != table->indexMap.end(); ++iit) {
+        Index* index = iit->second;
+        if (index == NULL)
+            continue;
+
+        ProtoBuf::TableConfig::Index& index_entry(*tableConfig->add_index());
+        index_entry.set_index_id(index->indexId);
+        index_entry.set_index_type(index->indexType);
+
+        // filling indexlets
+        foreach (Indexlet* indexlet, index->indexlets) {
+            ProtoBuf::TableConfig::Index::Indexlet&
+                   entry(*index_entry.add_indexlet());
+            if (indexlet->firstKey != NULL) {
+                entry.set_start_key(string(
+                        reinterpret_cast<char*>(indexlet->firstKey),
+                        indexlet->firstKeyLength));
+            } else {
+                entry.set_start_key("");
+            }
+
+            if (indexlet->firstNotOwnedKey != NULL) {
+                entry.set_end_key(string(
+                        reinterpret_cast<char*>(indexlet->firstNotOwnedKey),
+                        indexlet->firstNotOwnedKeyLength));
+            } else {
+                entry.set_end_key("");
+            }
+
+            entry.set_server_id(indexlet->serverId.getId());
+            try {
+                string locator = context->serverList->getLocator(
+                        indexlet->serverId);
+                entry.set_service_locator(locator);
+            } catch (const ServerListException& e) {
+                RAMCLOUD_LOG(NOTICE, "Server id (%s) in index map no longer in "
+                    "server list; omitting locator for entry (tableName %s,"
+                    "tableId %lu, indexId %d)",
+                    indexlet->serverId.toString().c_str(), table->name.c_str(),
+                    table->id, index->indexId);
+                complete = false;
+            }
+        }
+    }
+    return complete;
+}
+
+/**
+ * Does most of the work of the public splitTablet methods.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table that contains the tablet to be split.
+ * \param splitKeyHash
+ *      Key hash to used to partition the tablet into two.
+ */
+void
+TableManager::splitTablet(const Lock& lock, Table* table,
+        uint64_t splitKeyHash)
+{
+    Tablet* tablet = findTablet(lock, table, splitKeyHash);
+    if (splitKeyHash == tablet->startKeyHash)
+        return;
+    if (tablet->status == Tablet::RECOVERING) {
+        // We can't process this request right now, because recovery may
+        // undo it. Try again when recovery is finished.
+        throw RetryException(HERE, 1000000, 2000000,
+                "can't split tablet now: recovery is underway");
+    }
+
+    // Perform the split on our in-memory structures.
+    table->tablets.push_back(new Tablet(tablet->tableId, splitKeyHash,
+            tablet->endKeyHash, tablet->serverId, tablet->status,
+            tablet->ctime));
+    tablet->endKeyHash = splitKeyHash - 1;
+    invalidateTableConfig(lock, table);
+
+    // Record information about the split in external storage, in case we
+    // crash.
+    ProtoBuf::Table externalInfo;
+    serializeTable(lock, table, &externalInfo);
+    externalInfo.set_sequence_number(updateManager->nextSequenceNumber());
+    ProtoBuf::Table::Split* split = externalInfo.mutable_split();
+    split->set_server_id(tablet->serverId.getId());
+    split->set_split_key_hash(splitKeyHash);
+    syncTable(lock, table, &externalInfo);
+
+    // Finish up by notifying the relevant master.
+    notifySplitTablet(lock, &externalInfo);
+    updateManager->updateFinished(externalInfo.sequence_number());
+}
+
 /**
  * Update next_table_id on external storage.
  *
@@ -1693,6 +1906,7 @@ TableManager::testAddTablet(const Tablet& tablet)
         throw FatalError(HERE, "table doesn't exist");
     Table* table = it->second;
     table->tablets.push_back(new Tablet(tablet));
+    invalidateTableConfig(lock, table);
 }
 
 /**
@@ -1713,6 +1927,7 @@ TableManager::testCreateTable(const char* name, uint64_t id)
     Table* table = new Table(name, id);
     directory[name] = table;
     idMap[id] = table;
+    invalidateTableConfig(lock, table);
     if (nextTableId <= id)
         nextTableId = id+1;
 }
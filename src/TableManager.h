@@ -16,11 +16,14 @@
 #ifndef RAMCLOUD_TABLEMANAGER_H
 #define RAMCLOUD_TABLEMANAGER_H
 
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #include "Common.h"
 #include "CoordinatorUpdateManager.h"
 #include "ServerId.h"
+#include "SpinLock.h"
 #include "Table.pb.h"
 #include "Tablet.h"
 #include "TableConfig.pb.h"
@@ -61,6 +64,31 @@ class TableManager {
         explicit NoSuchIndexlet(const CodeLocation& where) : Exception(where) {}
     };
 
+    /**
+     * An immutable copy of a table's configuration (its tablets and
+     * indexlets, along with the locators of their masters), serialized in
+     * the form returned by GET_TABLE_CONFIG. Snapshots are shared by all
+     * of the clients that fetch the same table; when the table changes,
+     * a new snapshot with a new version replaces the old one.
+     */
+    struct TableConfigSnapshot {
+        TableConfigSnapshot(uint64_t version, const string& config)
+            : version(version)
+            , config(config)
+        {}
+
+        /// Identifies this configuration of the table; different
+        /// configurations of a table always have different versions. 0
+        /// means the snapshot must not be reused (e.g., the table
+        /// doesn't exist).
+        const uint64_t version;
+
+        /// A serialized ProtoBuf::TableConfig.
+        const string config;
+
+        DISALLOW_COPY_AND_ASSIGN(TableConfigSnapshot);
+    };
+
     explicit TableManager(Context* context,
             CoordinatorUpdateManager* updateManager);
     ~TableManager();
@@ -75,6 +103,8 @@ class TableManager {
     string debugString(bool shortForm = false);
     void dropIndex(uint64_t tableId, uint8_t indexId);
     void dropTable(const char* name);
+    std::shared_ptr<const TableConfigSnapshot> getTableConfig(
+            uint64_t tableId);
     uint64_t getTableId(const char* name);
     Tablet getTablet(uint64_t tableId, uint64_t keyHash);
     bool getIndexletInfoByBackingTableId(uint64_t backingTableId,
@@ -89,9 +119,12 @@ class TableManager {
             uint64_t startKeyHash, uint64_t endKeyHash,
             uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset);
     void recover(uint64_t lastCompletedUpdate);
+    void recoveryMasterAssigned(uint64_t tableId, uint64_t startKeyHash,
+            uint64_t endKeyHash, ServerId recoveryMasterId);
     void serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
             uint64_t tableId);
     void splitTablet(const char* name, uint64_t splitKeyHash);
+    void splitTablet(uint64_t tableId, uint64_t splitKeyHash);
     void splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash);
     void tabletRecovered(uint64_t tableId, uint64_t startKeyHash,
             uint64_t endKeyHash, ServerId serverId, LogPosition ctime);
@@ -186,6 +219,7 @@ class TableManager {
             , id(id)
             , tablets()
             , indexMap()
+            , configVersion(0)
         {}
         ~Table();
 
@@ -202,6 +236,11 @@ class TableManager {
         /// Information about each of the indexes in the table. The
         /// entries are allocated and freed dynamically.
         IndexMap indexMap;
+
+        /// Version of the table's current configuration; see
+        /// TableConfigSnapshot::version. Changed by
+        /// invalidateTableConfig whenever the tablets or indexlets change.
+        uint64_t configVersion;
     };
 
     /**
@@ -241,6 +280,24 @@ class TableManager {
     typedef std::unordered_map<uint64_t, Indexlet*> IndexletTableMap;
     IndexletTableMap backingTableMap;
 
+    /// The next version to assign to a table configuration. It starts at a
+    /// random value, so that versions handed out by a previous coordinator
+    /// are (almost certainly) never mistaken for current ones.
+    uint64_t nextConfigVersion;
+
+    /// Protects tableConfigs. This is separate from mutex, so that
+    /// GET_TABLE_CONFIG requests for unchanged tables don't wait for (or
+    /// delay) operations that hold mutex, such as RPCs to masters.
+    SpinLock tableConfigLock;
+
+    /// Snapshots of table configurations that have been requested since the
+    /// tables last changed, indexed by table id. Entries are added with
+    /// both mutex and tableConfigLock held, and removed (by
+    /// invalidateTableConfig) under mutex as soon as a table changes, so
+    /// that a snapshot found here is always current.
+    std::unordered_map<uint64_t, std::shared_ptr<const TableConfigSnapshot>>
+            tableConfigs;
+
     uint64_t createTable(const Lock& lock, const char* name,
             uint32_t serverSpan, ServerId serverId = ServerId());
     void dropIndex(const Lock& lock, uint64_t tableId, uint8_t indexId);
@@ -248,6 +305,7 @@ class TableManager {
     TableManager::Indexlet* findIndexlet(const Lock& lock, Index* index,
             const void* key, uint16_t keyLength);
     Tablet* findTablet(const Lock& lock, Table* table, uint64_t keyHash);
+    void invalidateTableConfig(const Lock& lock, Table* table);
     void notifyCreate(const Lock& lock, Table* table);
     void notifyCreateIndex(const Lock& lock, Index* index);
     void notifyDropTable(const Lock& lock, ProtoBuf::Table* info);
@@ -258,6 +316,9 @@ class TableManager {
     Table* recreateTable(const Lock& lock, ProtoBuf::Table* info);
     void serializeTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
+    bool serializeTableConfig(const Lock& lock, Table* table,
+            ProtoBuf::TableConfig* tableConfig);
+    void splitTablet(const Lock& lock, Table* table, uint64_t splitKeyHash);
     void syncNextTableId(const Lock& lock);
     void syncTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
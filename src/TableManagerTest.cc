@@ -360,6 +360,48 @@ TEST_F(TableManagerTest, dropTable_index) {
     EXPECT_EQ(0U, master2->indexletManager.getNumIndexlets());
 }
 
+TEST_F(TableManagerTest, getTableConfig_basics) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("table1", 1);
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot =
+            tableManager->getTableConfig(1);
+    EXPECT_NE(0lu, snapshot->version);
+    ProtoBuf::TableConfig tableConfig;
+    EXPECT_TRUE(tableConfig.ParseFromString(snapshot->config));
+    EXPECT_EQ("tablet { table_id: 1 start_key_hash: 0 "
+            "end_key_hash: 18446744073709551615 state: NORMAL "
+            "server_id: 1 service_locator: \"mock:host=server0\" "
+            "ctime_log_head_id: 0 ctime_log_head_offset: 0 }",
+            tableConfig.ShortDebugString());
+
+    // The snapshot is reused until the table changes.
+    EXPECT_EQ(snapshot, tableManager->getTableConfig(1));
+    tableManager->splitTablet("table1", 1000);
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot2 =
+            tableManager->getTableConfig(1);
+    EXPECT_NE(snapshot, snapshot2);
+    EXPECT_NE(snapshot->version, snapshot2->version);
+    EXPECT_NE(snapshot->config, snapshot2->config);
+}
+
+TEST_F(TableManagerTest, getTableConfig_noSuchTable) {
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot =
+            tableManager->getTableConfig(5);
+    EXPECT_EQ(0lu, snapshot->version);
+    EXPECT_EQ("", snapshot->config);
+    EXPECT_EQ(0u, tableManager->tableConfigs.size());
+}
+
+TEST_F(TableManagerTest, getTableConfig_missingLocator) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("table1", 1);
+    tableManager->directory["table1"]->tablets[0]->serverId = ServerId(4);
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot =
+            tableManager->getTableConfig(1);
+    EXPECT_EQ(0lu, snapshot->version);
+    EXPECT_NE("", snapshot->config);
+    EXPECT_EQ(0u, tableManager->tableConfigs.size());
+}
 
 TEST_F(TableManagerTest, getTableId) {
     cluster.addServer(masterConfig);
@@ -385,6 +427,25 @@ TEST_F(TableManagerTest, getIndexletInfoByBackingTableId) {
     EXPECT_EQ(2U, indexlet.backing_table_id());
 };
 
+TEST_F(TableManagerTest, invalidateTableConfig) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("table1", 1);
+    tableManager->createTable("table2", 1);
+    tableManager->getTableConfig(1);
+    tableManager->getTableConfig(2);
+    EXPECT_EQ(2u, tableManager->tableConfigs.size());
+    uint64_t version = tableManager->directory["table1"]->configVersion;
+
+    tableManager->markAllTabletsRecovering(ServerId(1));
+    EXPECT_EQ(0u, tableManager->tableConfigs.size());
+    EXPECT_NE(version, tableManager->directory["table1"]->configVersion);
+
+    // Dropping a table discards its snapshot, too.
+    tableManager->getTableConfig(2);
+    tableManager->dropTable("table2");
+    EXPECT_EQ(0u, tableManager->tableConfigs.size());
+}
+
 TEST_F(TableManagerTest, isIndexletTable) {
     cluster.addServer(masterConfig);
     cluster.addServer(masterConfig);
@@ -489,6 +550,40 @@ TEST_F(TableManagerTest, reassignTabletOwnership_exceptions) {
             1, 0x7fffffffffffffff, 99, 100), TableManager::NoSuchTablet);
 }
 
+TEST_F(TableManagerTest, recoveryMasterAssigned) {
+    cluster.addServer(masterConfig);
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    tableManager->directory["foo"]->tablets[1]->status = Tablet::RECOVERING;
+
+    // Unknown tablets and tablets that aren't recovering are ignored.
+    tableManager->recoveryMasterAssigned(99, 0x8000000000000000,
+            0xffffffffffffffff, ServerId(2));
+    tableManager->recoveryMasterAssigned(1, 0x8000000000000000,
+            0xfffffffffffffffe, ServerId(2));
+    tableManager->recoveryMasterAssigned(1, 0, 0x7fffffffffffffff,
+            ServerId(2));
+    EXPECT_FALSE(tableManager->getTablet(1, 0).recoveryMasterId.isValid());
+    EXPECT_FALSE(tableManager->getTablet(1, ~0lu).recoveryMasterId.isValid());
+
+    std::shared_ptr<const TableManager::TableConfigSnapshot> snapshot =
+            tableManager->getTableConfig(1);
+    tableManager->recoveryMasterAssigned(1, 0x8000000000000000,
+            0xffffffffffffffff, ServerId(2));
+    EXPECT_NE(snapshot->version, tableManager->getTableConfig(1)->version);
+    ProtoBuf::TableConfig tableConfig;
+    tableManager->serializeTableConfig(&tableConfig, 1);
+    EXPECT_FALSE(tableConfig.tablet(0).has_recovery_server_id());
+    EXPECT_EQ(2lu, tableConfig.tablet(1).recovery_server_id());
+    EXPECT_EQ("mock:host=server1",
+            tableConfig.tablet(1).recovery_service_locator());
+
+    // The recovery master is forgotten once the recovery is over.
+    tableManager->tabletRecovered(1, 0x8000000000000000, 0xffffffffffffffff,
+            ServerId(2), LogPosition(10, 11));
+    EXPECT_FALSE(tableManager->getTablet(1, ~0lu).recoveryMasterId.isValid());
+}
+
 TEST_F(TableManagerTest, recover_basics) {
     // Set up recovery information for 2 tables, one with 1 tablet and
     // the other with 2 tablets.
@@ -0,0 +1,661 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+
+#include "TableSnapshot.h"
+#include "LogCleaner.h"
+#include "Object.h"
+#include "ObjectChunk.h"
+#include "SegmentIterator.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Writes the contents of a snapshot file. The file is first written under
+ * a temporary name and renamed into place by #finish, so a crash or error
+ * during #create never leaves a partial snapshot under the real name.
+ */
+class TableSnapshot::Writer {
+  public:
+    explicit Writer(const string& path);
+    ~Writer();
+    void append(LogEntryType type, Buffer& buffer);
+    void finish(Header* header, const std::vector<uint64_t>& cutSegmentIds,
+            const std::vector<uint64_t>* liveKeyHashes);
+
+  private:
+    void flushSegment();
+    void write(const void* data, size_t length);
+
+    /// Final name of the file.
+    string path;
+
+    /// Name under which the file is written until #finish.
+    string tempPath;
+
+    /// Open file descriptor for tempPath, or -1 once the file is closed.
+    int fd;
+
+    /// Segment currently being filled; empty if none has been started.
+    Tub<Segment> segment;
+
+    /// Number of segments written to the file so far.
+    uint32_t segmentCount;
+
+    DISALLOW_COPY_AND_ASSIGN(Writer);
+};
+
+/**
+ * Create the temporary file and reserve space for the header.
+ *
+ * \param path
+ *      Name of the snapshot file.
+ *
+ * \throw SnapshotException
+ *      The file couldn't be created.
+ */
+TableSnapshot::Writer::Writer(const string& path)
+    : path(path)
+    , tempPath(path + ".tmp")
+    , fd(-1)
+    , segment()
+    , segmentCount(0)
+{
+    fd = open(tempPath.c_str(), O_CREAT|O_TRUNC|O_WRONLY, 0644);
+    if (fd < 0) {
+        throw SnapshotException(HERE,
+                format("couldn't create snapshot file %s", tempPath.c_str()),
+                errno);
+    }
+    Header header;
+    memset(&header, 0, sizeof(header));
+    write(&header, sizeof(header));
+}
+
+/**
+ * Destructor for Writers: if #finish wasn't reached, the partial file is
+ * removed.
+ */
+TableSnapshot::Writer::~Writer()
+{
+    if (fd >= 0) {
+        close(fd);
+        unlink(tempPath.c_str());
+    }
+}
+
+/**
+ * Add one log entry to the snapshot, starting a new segment if the current
+ * one is full.
+ *
+ * \param type
+ *      Type of the entry.
+ * \param buffer
+ *      Contents of the entry.
+ */
+void
+TableSnapshot::Writer::append(LogEntryType type, Buffer& buffer)
+{
+    if (segment && segment->append(type, buffer))
+        return;
+    flushSegment();
+    segment.construct();
+    if (!segment->append(type, buffer)) {
+        throw SnapshotException(HERE, format("log entry of %u bytes doesn't "
+                "fit in a segment", buffer.size()));
+    }
+}
+
+/**
+ * Write the final segment, the cut, the live key hashes, and the header,
+ * then move the file to its final name.
+ *
+ * \param header
+ *      Header for the file; its magic, formatVersion, segmentCount, and
+ *      cutSegmentCount are filled in here.
+ * \param cutSegmentIds
+ *      The sorted ids of the segments in the cut.
+ * \param liveKeyHashes
+ *      For incremental snapshots, the sorted key hashes of the objects live
+ *      in the tablet (header->liveObjectCount of them); NULL otherwise.
+ *
+ * \throw SnapshotException
+ *      The file couldn't be written.
+ */
+void
+TableSnapshot::Writer::finish(Header* header,
+        const std::vector<uint64_t>& cutSegmentIds,
+        const std::vector<uint64_t>* liveKeyHashes)
+{
+    flushSegment();
+    if (!cutSegmentIds.empty()) {
+        write(&cutSegmentIds.front(),
+                cutSegmentIds.size() * sizeof(uint64_t));
+    }
+    if (liveKeyHashes != NULL && !liveKeyHashes->empty()) {
+        write(&liveKeyHashes->front(),
+                liveKeyHashes->size() * sizeof(uint64_t));
+    }
+
+    header->magic = MAGIC;
+    header->formatVersion = FORMAT_VERSION;
+    header->segmentCount = segmentCount;
+    header->cutSegmentCount = downCast<uint32_t>(cutSegmentIds.size());
+    if (pwrite(fd, header, sizeof(*header), 0) != sizeof(*header) ||
+            fdatasync(fd) != 0) {
+        throw SnapshotException(HERE,
+                format("couldn't write snapshot file %s", tempPath.c_str()),
+                errno);
+    }
+    close(fd);
+    fd = -1;
+    if (rename(tempPath.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        unlink(tempPath.c_str());
+        throw SnapshotException(HERE,
+                format("couldn't rename snapshot file to %s", path.c_str()),
+                error);
+    }
+}
+
+/**
+ * Write the segment being filled (if any) to the file.
+ */
+void
+TableSnapshot::Writer::flushSegment()
+{
+    if (!segment)
+        return;
+    segment->close();
+    SegmentHeader segmentHeader;
+    segmentHeader.length = segment->getAppendedLength(
+            &segmentHeader.certificate);
+    write(&segmentHeader, sizeof(segmentHeader));
+
+    Buffer contents;
+    segment->appendToBuffer(contents);
+    for (Buffer::Iterator it(&contents); !it.isDone(); it.next())
+        write(it.getData(), it.getLength());
+    segment.destroy();
+    segmentCount++;
+}
+
+/**
+ * Append bytes to the file.
+ *
+ * \param data
+ *      First byte to write.
+ * \param length
+ *      Number of bytes to write.
+ *
+ * \throw SnapshotException
+ *      The write failed.
+ */
+void
+TableSnapshot::Writer::write(const void* data, size_t length)
+{
+    const char* next = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t written = ::write(fd, next, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw SnapshotException(HERE,
+                    format("couldn't write snapshot file %s",
+                    tempPath.c_str()), errno);
+        }
+        next += written;
+        length -= written;
+    }
+}
+
+/**
+ * Open an existing snapshot file and check that it is well formed. The
+ * file remains mapped until the TableSnapshot is destroyed.
+ *
+ * \param path
+ *      Name of the snapshot file.
+ *
+ * \throw SnapshotException
+ *      The file couldn't be opened or isn't a valid snapshot.
+ */
+TableSnapshot::TableSnapshot(const string& path)
+    : path(path)
+    , contents(NULL)
+    , length(0)
+    , header(NULL)
+    , segments()
+    , cutSegmentIds(NULL)
+    , liveKeyHashes(NULL)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw SnapshotException(HERE,
+                format("couldn't open snapshot file %s", path.c_str()),
+                errno);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        int error = errno;
+        close(fd);
+        throw SnapshotException(HERE,
+                format("couldn't stat snapshot file %s", path.c_str()),
+                error);
+    }
+    length = fileStat.st_size;
+    if (length < sizeof(Header)) {
+        close(fd);
+        throw SnapshotException(HERE,
+                format("snapshot file %s is truncated", path.c_str()));
+    }
+    contents = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (contents == MAP_FAILED) {
+        contents = NULL;
+        throw SnapshotException(HERE,
+                format("couldn't map snapshot file %s", path.c_str()),
+                error);
+    }
+
+    // From here on the destructor won't run if we throw, so unmap first.
+    const char* base = static_cast<const char*>(contents);
+    header = reinterpret_cast<const Header*>(base);
+    const char* problem = NULL;
+    size_t offset = sizeof(Header);
+    if (header->magic != MAGIC || header->formatVersion != FORMAT_VERSION) {
+        problem = "isn't a snapshot or has an unsupported format";
+    } else {
+        for (uint32_t i = 0; i < header->segmentCount; i++) {
+            const SegmentHeader* segmentHeader =
+                    reinterpret_cast<const SegmentHeader*>(base + offset);
+            if (length - offset < sizeof(SegmentHeader) ||
+                    length - offset - sizeof(SegmentHeader) <
+                    segmentHeader->length) {
+                problem = "is truncated";
+                break;
+            }
+            segments.push_back(segmentHeader);
+            offset += sizeof(SegmentHeader) + segmentHeader->length;
+        }
+        // The cut and the live key hashes make up the rest of the file.
+        size_t cutBytes = header->cutSegmentCount * sizeof(uint64_t);
+        uint64_t hashCount = header->incremental ? header->liveObjectCount : 0;
+        if (problem == NULL && (length - offset < cutBytes ||
+                (length - offset - cutBytes) % sizeof(uint64_t) != 0 ||
+                (length - offset - cutBytes) / sizeof(uint64_t) !=
+                hashCount)) {
+            problem = "has the wrong length";
+        }
+        cutSegmentIds = reinterpret_cast<const uint64_t*>(base + offset);
+        if (header->incremental) {
+            liveKeyHashes = reinterpret_cast<const uint64_t*>(
+                    base + offset + cutBytes);
+        }
+    }
+    if (problem != NULL) {
+        munmap(contents, length);
+        throw SnapshotException(HERE, format("snapshot file %s %s",
+                path.c_str(), problem));
+    }
+}
+
+/**
+ * Destructor for TableSnapshots: unmaps the file.
+ */
+TableSnapshot::~TableSnapshot()
+{
+    if (contents != NULL) {
+        munmap(contents, length);
+    }
+}
+
+namespace {
+
+/**
+ * A copy of one of a tablet's log entries, made while TableSnapshot::create
+ * holds the lock on the hash table bucket referring to it.
+ */
+struct SnapshotEntry {
+    SnapshotEntry(LogEntryType type, Buffer& buffer, uint64_t segmentId)
+        : type(type)
+        , contents()
+        , segmentId(segmentId)
+    {
+        contents.resize(buffer.size());
+        buffer.copy(0, buffer.size(), &contents[0]);
+    }
+
+    /// LOG_ENTRY_TYPE_OBJ, LOG_ENTRY_TYPE_OBJMANIFEST, or
+    /// LOG_ENTRY_TYPE_OBJCHUNK.
+    LogEntryType type;
+
+    /// Contents of the entry.
+    string contents;
+
+    /// Id of the segment that held the entry.
+    uint64_t segmentId;
+};
+
+/**
+ * Cookie for copySnapshotEntry.
+ */
+struct SnapshotScan {
+    explicit SnapshotScan(Log* log)
+        : log(log)
+        , entries()
+    {}
+
+    /// Log containing the tablet.
+    Log* log;
+
+    /// Entries found in the hash table bucket being scanned.
+    std::vector<SnapshotEntry> entries;
+
+    DISALLOW_COPY_AND_ASSIGN(SnapshotScan);
+};
+
+/**
+ * Callback for ObjectManager::forEachTabletEntry, used by
+ * TableSnapshot::create to copy the live entries of a tablet.
+ */
+void
+copySnapshotEntry(LogEntryType type, Buffer& buffer,
+        Log::Reference reference, void* cookie)
+{
+    // Tombstones in the hash table are left over from recovery; the
+    // objects they describe are deleted, so there is nothing to copy.
+    if (type == LOG_ENTRY_TYPE_OBJTOMB)
+        return;
+    SnapshotScan* scan = static_cast<SnapshotScan*>(cookie);
+    scan->entries.emplace_back(type, buffer,
+            scan->log->getSegmentId(reference));
+}
+
+} // anonymous namespace
+
+/**
+ * Write a snapshot of the objects in a tablet to a file. The snapshot
+ * contains the newest version of each object written before this method
+ * was invoked, and possibly some updates made while it runs (each object
+ * is copied atomically, but the objects aren't all copied at the same
+ * instant).
+ *
+ * The objects are found through the hash table, one bucket at a time, so
+ * only the tablet's live entries are read, no matter how large the rest of
+ * the log is. Each bucket's entries are copied while its lock is held, and
+ * written to the file after the lock is released; neither the cleaner nor
+ * writers to other buckets are held up while the file is written.
+ *
+ * \param objectManager
+ *      Owns the log containing the tablet.
+ * \param tableId
+ *      Table containing the tablet.
+ * \param firstKeyHash
+ *      Lowest key hash in the tablet.
+ * \param lastKeyHash
+ *      Highest key hash in the tablet.
+ * \param path
+ *      Name of the snapshot file; any existing file is replaced.
+ * \param base
+ *      If non-NULL, an earlier snapshot of the same tablet taken on this
+ *      master; an incremental snapshot relative to it is written. NULL
+ *      means write a full snapshot.
+ * \param[out] header
+ *      The header of the new snapshot is copied here.
+ *
+ * \throw SnapshotException
+ *      The file couldn't be written, or \a base doesn't describe the
+ *      same tablet.
+ */
+void
+TableSnapshot::create(ObjectManager* objectManager, uint64_t tableId,
+        uint64_t firstKeyHash, uint64_t lastKeyHash, const string& path,
+        const TableSnapshot* base, Header* header)
+{
+    if (base != NULL && (base->header->tableId != tableId ||
+            base->header->firstKeyHash != firstKeyHash ||
+            base->header->lastKeyHash != lastKeyHash)) {
+        throw SnapshotException(HERE, format("base snapshot %s describes a "
+                "different tablet", base->path.c_str()));
+    }
+
+    Log* log = objectManager->getLog();
+    Writer writer(path);
+    memset(header, 0, sizeof(*header));
+    header->tableId = tableId;
+    header->firstKeyHash = firstKeyHash;
+    header->lastKeyHash = lastKeyHash;
+    if (base != NULL) {
+        header->incremental = 1;
+        header->baseCutSegmentId = base->header->cutSegmentId;
+        header->baseMaxVersion = base->header->maxVersion;
+    }
+
+    // The cut is every segment in the log (other than the new head) once
+    // the head has rolled over. The cleaner is disabled only while the
+    // list is collected: otherwise it could list both the survivors of a
+    // cleaning pass and the segments they replace. Every object that is
+    // still in one of these segments when a later incremental snapshot is
+    // taken must be in this snapshot, since it was live throughout.
+    std::vector<uint64_t> cutSegmentIds;
+    {
+        LogCleaner::Disabler disabler(log->cleaner);
+        header->cutSegmentId = log->rollHeadOver().getSegmentId();
+        LogSegmentVector segments;
+        log->segmentManager->getActiveSegments(0, segments);
+        foreach (LogSegment* segment, segments) {
+            if (segment->id < header->cutSegmentId)
+                cutSegmentIds.push_back(segment->id);
+        }
+    }
+    std::sort(cutSegmentIds.begin(), cutSegmentIds.end());
+
+    // Deleted objects aren't in the hash table, but the target must still
+    // assign versions above theirs. Removing an object raises the safe
+    // version above it, so every version deleted so far is below this one.
+    header->maxVersion = log->segmentManager->allocateVersion() - 1;
+
+    SnapshotScan scan(log);
+    std::vector<uint64_t> liveKeyHashes;
+    HashTable* objectMap = objectManager->getObjectMap();
+    for (uint64_t bucket = 0; bucket < objectMap->getNumBuckets(); bucket++) {
+        scan.entries.clear();
+        objectManager->forEachTabletEntry(bucket, tableId, firstKeyHash,
+                lastKeyHash, copySnapshotEntry, &scan);
+        foreach (SnapshotEntry& entry, scan.entries) {
+            if (entry.type != LOG_ENTRY_TYPE_OBJ &&
+                    entry.type != LOG_ENTRY_TYPE_OBJMANIFEST) {
+                continue;
+            }
+            Buffer buffer;
+            buffer.append(entry.contents.data(),
+                    downCast<uint32_t>(entry.contents.size()));
+            Key key(entry.type, buffer);
+            uint64_t version = Object(buffer).getVersion();
+            header->maxVersion = std::max(header->maxVersion, version);
+            header->liveObjectCount++;
+            if (base != NULL) {
+                liveKeyHashes.push_back(key.getHash());
+                if (std::binary_search(base->cutSegmentIds,
+                        base->cutSegmentIds + base->header->cutSegmentCount,
+                        entry.segmentId)) {
+                    continue;
+                }
+            }
+
+            if (entry.type == LOG_ENTRY_TYPE_OBJMANIFEST) {
+                // The chunks must precede the manifest, just as in the
+                // log. They have the same key hash, so they were copied
+                // from the same bucket.
+                std::map<uint32_t, Buffer*> chunks;
+                std::vector<std::unique_ptr<Buffer>> chunkBuffers;
+                foreach (SnapshotEntry& chunkEntry, scan.entries) {
+                    if (chunkEntry.type != LOG_ENTRY_TYPE_OBJCHUNK)
+                        continue;
+                    chunkBuffers.emplace_back(new Buffer());
+                    Buffer* chunkBuffer = chunkBuffers.back().get();
+                    chunkBuffer->append(chunkEntry.contents.data(),
+                            downCast<uint32_t>(chunkEntry.contents.size()));
+                    ObjectChunk chunk(*chunkBuffer);
+                    if (chunk.getVersion() != version ||
+                            !(Key(chunkEntry.type, *chunkBuffer) == key)) {
+                        continue;
+                    }
+                    chunks[chunk.getChunkIndex()] = chunkBuffer;
+                }
+                for (auto& chunk : chunks)
+                    writer.append(LOG_ENTRY_TYPE_OBJCHUNK, *chunk.second);
+            }
+            writer.append(entry.type, buffer);
+            header->objectCount++;
+        }
+    }
+
+    // Make sure that the target assigns versions above any in the
+    // snapshot, including the versions of deleted objects.
+    ObjectSafeVersion safeVersion(header->maxVersion + 1);
+    Buffer buffer;
+    safeVersion.assembleForLog(buffer);
+    writer.append(LOG_ENTRY_TYPE_SAFEVERSION, buffer);
+
+    std::sort(liveKeyHashes.begin(), liveKeyHashes.end());
+    writer.finish(header, cutSegmentIds,
+            base != NULL ? &liveKeyHashes : NULL);
+    LOG(NOTICE, "Wrote %s snapshot of tablet %lu [0x%lx,0x%lx] to %s: "
+            "%lu objects in %u segments (cut at segment %lu)",
+            base != NULL ? "incremental" : "full", tableId, firstKeyHash,
+            lastKeyHash, path.c_str(), header->objectCount,
+            header->segmentCount, header->cutSegmentId);
+}
+
+namespace {
+
+/**
+ * Cookie for collectDeletedObjects.
+ */
+struct DeletionScan {
+    DeletionScan(const uint64_t* liveBegin, const uint64_t* liveEnd,
+            uint64_t maxVersion)
+        : liveBegin(liveBegin)
+        , liveEnd(liveEnd)
+        , maxVersion(maxVersion)
+        , keys()
+    {}
+
+    /// Sorted key hashes of the objects live at the snapshot point.
+    const uint64_t* liveBegin;
+    const uint64_t* liveEnd;
+
+    /// Objects with versions above this weren't loaded from the base
+    /// snapshot (they were written after it was loaded), so they must be
+    /// kept.
+    uint64_t maxVersion;
+
+    /// Primary keys of the objects to delete.
+    std::vector<string> keys;
+
+    DISALLOW_COPY_AND_ASSIGN(DeletionScan);
+};
+
+/**
+ * Callback for ObjectManager::forEachTabletEntry, used by
+ * TableSnapshot::load to find objects that an incremental snapshot
+ * says were deleted.
+ */
+void
+collectDeletedObjects(LogEntryType type, Buffer& buffer,
+        Log::Reference reference, void* cookie)
+{
+    if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJMANIFEST)
+        return;
+    DeletionScan* scan = static_cast<DeletionScan*>(cookie);
+    Key key(type, buffer);
+    if (std::binary_search(scan->liveBegin, scan->liveEnd, key.getHash()))
+        return;
+    if (Object(buffer).getVersion() > scan->maxVersion)
+        return;
+    scan->keys.emplace_back(static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength());
+}
+
+} // anonymous namespace
+
+/**
+ * Add the objects in this snapshot to a master. The master must already
+ * own a tablet covering the snapshot's key hashes, and the snapshot must
+ * have been taken from a table with the same id (primary key hashes depend
+ * on the table id). Existing objects with newer versions are retained.
+ *
+ * If this is an incremental snapshot, the objects in its base snapshot
+ * (and any intermediate incremental snapshots) must already have been
+ * loaded; objects that were deleted since the base was taken are removed.
+ *
+ * \param objectManager
+ *      The objects are added to this master's log.
+ * \return
+ *      The number of objects stored in the snapshot file.
+ *
+ * \throw SnapshotException
+ *      The snapshot is corrupt.
+ */
+uint64_t
+TableSnapshot::load(ObjectManager* objectManager)
+{
+    ObjectManager::TombstoneProtector protector(objectManager);
+    SideLog sideLog(objectManager->getLog());
+    try {
+        foreach (const SegmentHeader* segmentHeader, segments) {
+            SegmentIterator it(segmentHeader + 1, segmentHeader->length,
+                    segmentHeader->certificate);
+            it.checkMetadataIntegrity();
+            objectManager->replaySegment(&sideLog, it);
+        }
+    } catch (SegmentIteratorException& e) {
+        throw SnapshotException(HERE, format("snapshot file %s is corrupt: "
+                "%s", path.c_str(), e.what()));
+    }
+    sideLog.commit();
+
+    if (header->incremental) {
+        DeletionScan scan(liveKeyHashes,
+                liveKeyHashes + header->liveObjectCount,
+                header->baseMaxVersion);
+        uint64_t numBuckets = objectManager->getObjectMap()->getNumBuckets();
+        for (uint64_t bucket = 0; bucket < numBuckets; bucket++) {
+            objectManager->forEachTabletEntry(bucket, header->tableId,
+                    header->firstKeyHash, header->lastKeyHash,
+                    collectDeletedObjects, &scan);
+        }
+        foreach (const string& keyString, scan.keys) {
+            Key key(header->tableId, keyString.data(),
+                    downCast<KeyLength>(keyString.size()));
+            objectManager->removeObject(key, NULL, NULL);
+        }
+        if (!scan.keys.empty())
+            objectManager->syncChanges();
+    }
+    return header->objectCount;
+}
+
+} // namespace RAMCloud
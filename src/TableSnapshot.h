@@ -0,0 +1,179 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLESNAPSHOT_H
+#define RAMCLOUD_TABLESNAPSHOT_H
+
+#include "Common.h"
+#include "ObjectManager.h"
+#include "Segment.h"
+
+namespace RAMCloud {
+
+/**
+ * Thrown when a snapshot file can't be written, read, or parsed.
+ */
+struct SnapshotException : public Exception {
+    explicit SnapshotException(const CodeLocation& where)
+        : Exception(where) {}
+    SnapshotException(const CodeLocation& where, std::string msg)
+        : Exception(where, msg) {}
+    SnapshotException(const CodeLocation& where, int errNo)
+        : Exception(where, errNo) {}
+    SnapshotException(const CodeLocation& where, string msg, int errNo)
+        : Exception(where, msg, errNo) {}
+};
+
+/**
+ * A TableSnapshot is a point-in-time copy of the objects in one tablet,
+ * stored in a file on the master's local disk. Snapshots are written by
+ * #create and loaded back (on the same or another master) by #load.
+ *
+ * A snapshot file consists of a Header, followed by a sequence of
+ * segments (each preceded by a SegmentHeader) in the same format as the
+ * log, followed by the sorted ids of the log segments that made up the
+ * cut (see below), followed (for incremental snapshots only) by a sorted
+ * array of the key hashes of all of the objects that were live in the
+ * tablet when the snapshot was taken. The file is read with mmap, and its
+ * segments are replayed into a SideLog directly from the mapped memory, so
+ * loading a snapshot costs about the same as receiving a migrated tablet,
+ * rather than one write RPC per object.
+ *
+ * A snapshot contains the newest version of each object in the tablet,
+ * found by walking the hash table rather than the log. When it is taken,
+ * the log head is rolled over, and the ids of the segments before the new
+ * head are recorded as the snapshot's cut: every object still in one of
+ * those segments later on is guaranteed to be in the snapshot.
+ *
+ * An incremental snapshot is taken relative to an earlier (base) snapshot
+ * of the same tablet. It contains only the objects whose newest version is
+ * in a segment that wasn't part of the base snapshot's cut (including
+ * side log segments that were committed to the log after the base was
+ * taken, objects updated while the base was being written, and objects
+ * moved by the cleaner, which are harmless duplicates).
+ * Deletions are conveyed by the array of live key hashes rather than by
+ * tombstones, since the cleaner may already have discarded the tombstones.
+ */
+class TableSnapshot {
+  PUBLIC:
+    /// Value of Header::magic.
+    static const uint32_t MAGIC = 0x52435350;     // "RCSP"
+
+    /// Value of Header::formatVersion.
+    static const uint32_t FORMAT_VERSION = 2;
+
+    /**
+     * Describes a snapshot; this is the first thing in the file.
+     */
+    struct Header {
+        /// Always MAGIC.
+        uint32_t magic;
+
+        /// Always FORMAT_VERSION.
+        uint32_t formatVersion;
+
+        /// Table and range of key hashes covered by the snapshot.
+        uint64_t tableId;
+        uint64_t firstKeyHash;
+        uint64_t lastKeyHash;
+
+        /// Id of the head segment allocated when the cut was taken; the
+        /// cut consists of segments with lower ids.
+        uint64_t cutSegmentId;
+
+        /// For incremental snapshots, the cutSegmentId of the base
+        /// snapshot; 0 for full snapshots.
+        uint64_t baseCutSegmentId;
+
+        /// Every object in the snapshot, and every object deleted from the
+        /// tablet before it was taken, has a version no higher than this.
+        uint64_t maxVersion;
+
+        /// For incremental snapshots, the maxVersion of the base snapshot;
+        /// 0 for full snapshots.
+        uint64_t baseMaxVersion;
+
+        /// Number of objects stored in the file.
+        uint64_t objectCount;
+
+        /// Number of objects live in the tablet at the snapshot point.
+        uint64_t liveObjectCount;
+
+        /// Number of segments following this header.
+        uint32_t segmentCount;
+
+        /// Number of segment ids in the cut, which follow the segments.
+        uint32_t cutSegmentCount;
+
+        /// Nonzero means this is an incremental snapshot, and
+        /// liveObjectCount key hashes follow the segments.
+        uint32_t incremental;
+    } __attribute__((packed));
+
+    /**
+     * Precedes each segment in the file.
+     */
+    struct SegmentHeader {
+        SegmentHeader()
+            : length(0)
+            , certificate()
+        {}
+
+        /// Number of bytes of segment data following this header.
+        uint32_t length;
+
+        /// Used to verify the integrity of the segment.
+        SegmentCertificate certificate;
+    } __attribute__((packed));
+
+    explicit TableSnapshot(const string& path);
+    ~TableSnapshot();
+    static void create(ObjectManager* objectManager, uint64_t tableId,
+            uint64_t firstKeyHash, uint64_t lastKeyHash, const string& path,
+            const TableSnapshot* base, Header* header);
+    const Header& getHeader() const { return *header; }
+    uint64_t load(ObjectManager* objectManager);
+
+  PRIVATE:
+    class Writer;
+
+    /// Name of the file.
+    string path;
+
+    /// Contents of the file (mapped read-only).
+    void* contents;
+
+    /// Size of the file in bytes.
+    size_t length;
+
+    /// The header at the start of #contents.
+    const Header* header;
+
+    /// Location of each segment's SegmentHeader within #contents.
+    std::vector<const SegmentHeader*> segments;
+
+    /// The sorted ids of the log segments that made up the cut.
+    const uint64_t* cutSegmentIds;
+
+    /// For incremental snapshots, the sorted key hashes of the objects
+    /// live at the snapshot point; NULL for full snapshots.
+    const uint64_t* liveKeyHashes;
+
+    DISALLOW_COPY_AND_ASSIGN(TableSnapshot);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLESNAPSHOT_H
@@ -0,0 +1,312 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "TestUtil.h"
+#include "MasterService.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+#include "TableSnapshot.h"
+
+namespace RAMCloud {
+
+class TableSnapshotTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    MasterService* master1;
+    MasterService* master2;
+    uint64_t tableId;
+    string dir;
+
+    TableSnapshotTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , master1()
+        , master2()
+        , tableId()
+        , dir()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        master1 = cluster.addServer(config)->master.get();
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+
+        // The second master doesn't own any tablets as far as the
+        // coordinator knows; snapshots are loaded into it directly.
+        config.localLocator = "mock:host=master2";
+        master2 = cluster.addServer(config)->master.get();
+        master2->tabletManager.addTablet(tableId, 0, ~0UL,
+                TabletManager::NORMAL);
+
+        char dirName[100];
+        strncpy(dirName, "/tmp/ramcloud-snapshot-test-delete-this-XXXXXX",
+                sizeof(dirName));
+        dir = mkdtemp(dirName);
+    }
+
+    ~TableSnapshotTest()
+    {
+        string cmd = "rm -rf " + dir;
+        system(cmd.c_str());
+    }
+
+    // Returns the value of an object on a master, or the symbol for the
+    // status if the read fails.
+    string
+    read(MasterService* master, const char* key)
+    {
+        Key objectKey(tableId, key, downCast<uint16_t>(strlen(key)));
+        Buffer value;
+        Status status = master->objectManager.readObject(objectKey, &value,
+                NULL, NULL, true);
+        if (status != STATUS_OK)
+            return statusToSymbol(status);
+        return TestUtil::toString(&value);
+    }
+
+    // Opens a snapshot file and returns the message from the resulting
+    // SnapshotException, or "ok" if the file is valid.
+    string
+    openError(const string& path)
+    {
+        try {
+            TableSnapshot snapshot(path);
+        } catch (SnapshotException& e) {
+            return e.message;
+        }
+        return "ok";
+    }
+
+    // Writes a full (base == NULL) or incremental snapshot of the table
+    // on master1 and returns its header.
+    TableSnapshot::Header
+    snapshot(const string& path, const TableSnapshot* base = NULL)
+    {
+        TableSnapshot::Header header;
+        TableSnapshot::create(&master1->objectManager, tableId, 0, ~0UL,
+                path, base, &header);
+        return header;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TableSnapshotTest);
+};
+
+TEST_F(TableSnapshotTest, constructor) {
+    ramcloud->write(tableId, "a", 1, "value a");
+    snapshot(dir + "/full");
+    TableSnapshot snapshot(dir + "/full");
+    EXPECT_EQ(TableSnapshot::MAGIC, snapshot.getHeader().magic);
+    EXPECT_EQ(1U, snapshot.segments.size());
+    EXPECT_LT(0U, snapshot.getHeader().cutSegmentCount);
+    EXPECT_TRUE(std::is_sorted(snapshot.cutSegmentIds,
+            snapshot.cutSegmentIds + snapshot.getHeader().cutSegmentCount));
+    EXPECT_GT(snapshot.getHeader().cutSegmentId, snapshot.cutSegmentIds[
+            snapshot.getHeader().cutSegmentCount - 1]);
+    EXPECT_TRUE(snapshot.liveKeyHashes == NULL);
+}
+
+TEST_F(TableSnapshotTest, constructor_errors) {
+    EXPECT_TRUE(TestUtil::contains(openError(dir + "/missing"),
+            "couldn't open snapshot file"));
+
+    string path = dir + "/bad";
+    int fd = open(path.c_str(), O_CREAT|O_WRONLY, 0644);
+    TableSnapshot::Header header;
+    memset(&header, 0, sizeof(header));
+    EXPECT_EQ(10, write(fd, &header, 10));
+    close(fd);
+    EXPECT_TRUE(TestUtil::contains(openError(path), "is truncated"));
+
+    fd = open(path.c_str(), O_TRUNC|O_WRONLY);
+    EXPECT_EQ(ssize_t(sizeof(header)), write(fd, &header, sizeof(header)));
+    close(fd);
+    EXPECT_TRUE(TestUtil::contains(openError(path), "unsupported format"));
+
+    // Claims a segment that isn't there.
+    header.magic = TableSnapshot::MAGIC;
+    header.formatVersion = TableSnapshot::FORMAT_VERSION;
+    header.segmentCount = 1;
+    fd = open(path.c_str(), O_TRUNC|O_WRONLY);
+    EXPECT_EQ(ssize_t(sizeof(header)), write(fd, &header, sizeof(header)));
+    close(fd);
+    EXPECT_TRUE(TestUtil::contains(openError(path), "is truncated"));
+
+    // Trailing garbage.
+    header.segmentCount = 0;
+    fd = open(path.c_str(), O_TRUNC|O_WRONLY);
+    EXPECT_EQ(ssize_t(sizeof(header)), write(fd, &header, sizeof(header)));
+    EXPECT_EQ(4, write(fd, "junk", 4));
+    close(fd);
+    EXPECT_TRUE(TestUtil::contains(openError(path), "wrong length"));
+
+    // Claims a cut that isn't there.
+    header.cutSegmentCount = 2;
+    fd = open(path.c_str(), O_TRUNC|O_WRONLY);
+    EXPECT_EQ(ssize_t(sizeof(header)), write(fd, &header, sizeof(header)));
+    EXPECT_EQ(8, write(fd, "12345678", 8));
+    close(fd);
+    EXPECT_TRUE(TestUtil::contains(openError(path), "wrong length"));
+}
+
+TEST_F(TableSnapshotTest, create) {
+    uint64_t version;
+    ramcloud->write(tableId, "a", 1, "value a");
+    ramcloud->write(tableId, "b", 1, "old b");
+    ramcloud->write(tableId, "b", 1, "value b", NULL, &version);
+    ramcloud->write(tableId, "c", 1, "value c");
+    ramcloud->remove(tableId, "c", 1);
+
+    uint64_t headId = master1->objectManager.getLog()->head->id;
+    TableSnapshot::Header header = snapshot(dir + "/full");
+    EXPECT_EQ(headId + 1, header.cutSegmentId);
+    EXPECT_EQ(2U, header.objectCount);
+    EXPECT_EQ(2U, header.liveObjectCount);
+    EXPECT_EQ(0U, header.incremental);
+    EXPECT_LT(version, header.maxVersion);
+    EXPECT_EQ("ok", openError(dir + "/full"));
+    EXPECT_NE(0, access((dir + "/full.tmp").c_str(), F_OK));
+
+    ramcloud->write(tableId, "d", 1, "value d");
+    header = snapshot(dir + "/full2");
+    EXPECT_EQ(3U, header.objectCount);
+}
+
+TEST_F(TableSnapshotTest, create_incrementalIncludesLateSideLog) {
+    ramcloud->write(tableId, "a", 1, "value a");
+    SideLog sideLog(master1->objectManager.getLog());
+    Key key(tableId, "s", 1);
+    Buffer buffer;
+    Object object(key, "value s", 7, 1, 0, buffer);
+    Buffer entry;
+    object.assembleForLog(entry);
+    Segment segment;
+    ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_OBJ, entry));
+    SegmentIterator it(segment);
+    {
+        ObjectManager::TombstoneProtector _(&master1->objectManager);
+        master1->objectManager.replaySegment(&sideLog, it);
+    }
+
+    // The replayed object is in the hash table, so the full snapshot
+    // includes it. Its segment has an id below the cut, but it isn't part
+    // of the log until after the cut, so the delta includes it again.
+    snapshot(dir + "/full");
+    TableSnapshot full(dir + "/full");
+    EXPECT_EQ(2U, full.getHeader().objectCount);
+    sideLog.commit();
+
+    TableSnapshot::Header header = snapshot(dir + "/delta", &full);
+    EXPECT_EQ(1U, header.objectCount);
+    EXPECT_EQ(2U, header.liveObjectCount);
+    TableSnapshot delta(dir + "/delta");
+    EXPECT_EQ(1U, delta.load(&master2->objectManager));
+    EXPECT_EQ("value s", read(master2, "s"));
+}
+
+TEST_F(TableSnapshotTest, create_badBase) {
+    ramcloud->write(tableId, "a", 1, "value a");
+    snapshot(dir + "/full");
+    TableSnapshot base(dir + "/full");
+    TableSnapshot::Header header;
+    string message;
+    try {
+        TableSnapshot::create(&master1->objectManager, tableId + 1, 0, ~0UL,
+                dir + "/delta", &base, &header);
+    } catch (SnapshotException& e) {
+        message = e.message;
+    }
+    EXPECT_TRUE(TestUtil::contains(message, "different tablet"));
+    EXPECT_NE(0, access((dir + "/delta.tmp").c_str(), F_OK));
+}
+
+TEST_F(TableSnapshotTest, create_badPath) {
+    string message;
+    try {
+        snapshot(dir + "/missing/full");
+    } catch (SnapshotException& e) {
+        message = e.message;
+    }
+    EXPECT_TRUE(TestUtil::contains(message, "couldn't create snapshot file"));
+}
+
+TEST_F(TableSnapshotTest, load) {
+    ramcloud->write(tableId, "a", 1, "value a");
+    ramcloud->write(tableId, "b", 1, "value b");
+    ramcloud->write(tableId, "c", 1, "value c");
+    ramcloud->remove(tableId, "c", 1);
+    TableSnapshot::Header header = snapshot(dir + "/full");
+
+    TableSnapshot snapshot(dir + "/full");
+    EXPECT_EQ(2U, snapshot.load(&master2->objectManager));
+    EXPECT_EQ("value a", read(master2, "a"));
+    EXPECT_EQ("value b", read(master2, "b"));
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", read(master2, "c"));
+    EXPECT_LT(header.maxVersion,
+            master2->objectManager.segmentManager.safeVersion);
+}
+
+TEST_F(TableSnapshotTest, load_incremental) {
+    ramcloud->write(tableId, "a", 1, "value a");
+    ramcloud->write(tableId, "b", 1, "value b");
+    ramcloud->write(tableId, "c", 1, "value c");
+    snapshot(dir + "/full");
+    TableSnapshot full(dir + "/full");
+
+    ramcloud->write(tableId, "a", 1, "new a");
+    ramcloud->remove(tableId, "b", 1);
+    ramcloud->write(tableId, "d", 1, "value d");
+    TableSnapshot::Header header = snapshot(dir + "/delta", &full);
+    EXPECT_EQ(1U, header.incremental);
+    EXPECT_EQ(full.getHeader().cutSegmentId, header.baseCutSegmentId);
+    EXPECT_EQ(full.getHeader().maxVersion, header.baseMaxVersion);
+    EXPECT_EQ(2U, header.objectCount);
+    EXPECT_EQ(3U, header.liveObjectCount);
+
+    TableSnapshot delta(dir + "/delta");
+    ASSERT_TRUE(delta.liveKeyHashes != NULL);
+    EXPECT_TRUE(std::is_sorted(delta.liveKeyHashes,
+            delta.liveKeyHashes + header.liveObjectCount));
+
+    // An object written on the target after the full snapshot was loaded
+    // must survive, even though the delta doesn't mention it (loading
+    // raised the target's safe version above the full snapshot's versions).
+    full.load(&master2->objectManager);
+    Key key(tableId, "e", 1);
+    Buffer buffer;
+    Object object(key, "value e", 7, 0, 0, buffer);
+    master2->objectManager.writeObject(object, NULL, NULL);
+
+    EXPECT_EQ(2U, delta.load(&master2->objectManager));
+    EXPECT_EQ("new a", read(master2, "a"));
+    EXPECT_EQ("STATUS_OBJECT_DOESNT_EXIST", read(master2, "b"));
+    EXPECT_EQ("value c", read(master2, "c"));
+    EXPECT_EQ("value d", read(master2, "d"));
+    EXPECT_EQ("value e", read(master2, "e"));
+}
+
+}  // namespace RAMCloud
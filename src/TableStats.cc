@@ -164,6 +164,49 @@ decrement(MasterTableMetadata* mtm,
     }
 }
 
+/**
+ * Estimate the number of bytes of data belonging to one tablet on this
+ * master, assuming that the table's data is spread evenly over the key hashes
+ * that this master owns. Used to report tablet sizes to the coordinator's
+ * TabletBalancer.
+ *
+ * \param mtm
+ *      Pointer to MasterTableMetadata container that is storing the current
+ *      stats information.  Must not be NULL.
+ * \param tableId
+ *      Id of the table containing the tablet.
+ * \param startKeyHash
+ *      First key hash value of the tablet.
+ * \param endKeyHash
+ *      Last key hash value of the tablet.
+ * \return
+ *      Estimated number of bytes of log data in the tablet; 0 if there are
+ *      no stats for the table.
+ */
+uint64_t
+estimateByteCount(MasterTableMetadata* mtm,
+                  uint64_t tableId,
+                  uint64_t startKeyHash,
+                  uint64_t endKeyHash)
+{
+    MasterTableMetadata::Entry* entry;
+    entry = mtm->find(tableId);
+    if (entry == NULL)
+        return 0;
+
+    SpinLock::Guard _(entry->stats.lock);
+    double keyHashCount = static_cast<double>(entry->stats.keyHashCount);
+    if (entry->stats.totalOwnership)
+        keyHashCount = 18446744073709551616.0;  // 2^64
+    if (keyHashCount == 0)
+        return 0;
+    double tabletKeyHashes = static_cast<double>(endKeyHash - startKeyHash)
+            + 1;
+    double bytes = static_cast<double>(entry->stats.byteCount) *
+            std::min(tabletKeyHashes / keyHashCount, 1.0);
+    return static_cast<uint64_t>(bytes);
+}
+
 
 /**
  * Compress and serialize all table stats information in the MasterTableMetadata
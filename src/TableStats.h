@@ -89,6 +89,10 @@ void decrement(MasterTableMetadata* mtm,
                uint64_t byteCount,
                uint64_t recordCount);
 void serialize(Buffer* buf, MasterTableMetadata *mtm);
+uint64_t estimateByteCount(MasterTableMetadata* mtm,
+                           uint64_t tableId,
+                           uint64_t startKeyHash,
+                           uint64_t endKeyHash);
 
 /**
  * This threshold defines the size below which tables stats information will be
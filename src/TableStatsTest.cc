@@ -175,6 +175,23 @@ TEST_F(TableStatsTest, decrement) {
     }
 }
 
+TEST_F(TableStatsTest, estimateByteCount) {
+    EXPECT_EQ(0U, TableStats::estimateByteCount(&mtm, 1, 0, 9));
+
+    // Two tablets with 10 and 30 key hashes.
+    TableStats::addKeyHashRange(&mtm, 1, 0, 9);
+    TableStats::addKeyHashRange(&mtm, 1, 100, 129);
+    TableStats::increment(&mtm, 1, 4000, 40);
+    EXPECT_EQ(1000U, TableStats::estimateByteCount(&mtm, 1, 0, 9));
+    EXPECT_EQ(3000U, TableStats::estimateByteCount(&mtm, 1, 100, 129));
+
+    // Total ownership.
+    TableStats::addKeyHashRange(&mtm, 2, 0, ~0UL);
+    TableStats::increment(&mtm, 2, 4000, 40);
+    EXPECT_EQ(4000U, TableStats::estimateByteCount(&mtm, 2, 0, ~0UL));
+    EXPECT_EQ(2000U, TableStats::estimateByteCount(&mtm, 2, 0, ~0UL/2));
+}
+
 TEST_F(TableStatsTest, serialize_basic) {
     // First Check an empty mtm.
     {
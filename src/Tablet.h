@@ -63,6 +63,14 @@ struct Tablet {
      */
     LogPosition ctime;
 
+    /**
+     * If the tablet is RECOVERING and has been handed to a recovery master,
+     * the id of that master (otherwise invalid). Reads from clients that
+     * accept degraded results are sent there while the recovery is under
+     * way.
+     */
+    ServerId recoveryMasterId;
+
     Tablet(uint64_t tableId, uint64_t startKeyHash, uint64_t endKeyHash,
             ServerId serverId, Status status, LogPosition ctime)
         : tableId(tableId)
@@ -71,6 +79,7 @@ struct Tablet {
         , serverId(serverId)
         , status(status)
         , ctime(ctime)
+        , recoveryMasterId()
     {}
 
     Tablet(const Tablet& tablet)
@@ -80,6 +89,7 @@ struct Tablet {
         , serverId(tablet.serverId)
         , status(tablet.status)
         , ctime(tablet.ctime)
+        , recoveryMasterId(tablet.recoveryMasterId)
     {}
 
     void serialize(ProtoBuf::Tablets::Tablet& entry) const;
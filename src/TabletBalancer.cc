@@ -0,0 +1,427 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TabletBalancer.h"
+#include "ClientException.h"
+#include "CoordinatorServerList.h"
+#include "Cycles.h"
+#include "MasterClient.h"
+#include "ShortMacros.h"
+#include "TableManager.h"
+
+namespace RAMCloud {
+
+namespace {
+/**
+ * The two kinds of load that the balancer tries to even out.
+ */
+enum Resource { OPERATIONS = 0, MEMORY = 1 };
+
+/// Returns the amount of a resource used by a tablet or master.
+template<typename T>
+double
+getLoad(const T& t, int resource)
+{
+    return (resource == OPERATIONS) ? t.opsPerSecond
+                                    : static_cast<double>(t.bytes);
+}
+}
+
+/**
+ * Construct a TabletBalancer; it does nothing until #enable is called.
+ *
+ * \param context
+ *      Overall information about the coordinator.
+ * \param tableManager
+ *      The coordinator's TableManager.
+ */
+TabletBalancer::TabletBalancer(Context* context, TableManager* tableManager)
+    : WorkerTimer(context->dispatch)
+    , context(context)
+    , tableManager(tableManager)
+    , config()
+    , lastSamples()
+    , imbalancedRounds(0)
+    , cooldown(0)
+    , migration()
+    , migrationAction()
+{
+}
+
+/**
+ * Destructor for TabletBalancer.
+ */
+TabletBalancer::~TabletBalancer()
+{
+    stop();
+}
+
+/**
+ * Perform one round of balancing: sample the masters' statistics and, if
+ * the masters have been unbalanced for long enough, split or migrate a
+ * tablet. Normally invoked by the timer; public for testing.
+ */
+void
+TabletBalancer::balance()
+{
+    std::vector<MasterLoad> masters;
+    bool complete = collect(&masters);
+
+    // Don't consider another action while a migration is in progress; the
+    // cooldown starts once it has finished.
+    if (migration) {
+        if (!migration->isReady())
+            return;
+        finishMigration();
+        return;
+    }
+
+    if (cooldown > 0) {
+        cooldown--;
+        return;
+    }
+
+    // Rates aren't known for tablets that appeared since the last round
+    // (e.g. because of a split); wait until they are.
+    if (!complete)
+        return;
+
+    Action action = plan(masters);
+    if (action.type == Action::NONE) {
+        imbalancedRounds = 0;
+        return;
+    }
+    imbalancedRounds++;
+    if (imbalancedRounds < config.hysteresisRounds)
+        return;
+    execute(action);
+    imbalancedRounds = 0;
+    cooldown = config.cooldownRounds;
+}
+
+/**
+ * Stop balancing.
+ */
+void
+TabletBalancer::disable()
+{
+    stop();
+}
+
+/**
+ * Start balancing (or change the configuration, if already started).
+ *
+ * \param config
+ *      Parameters for the balancer.
+ */
+void
+TabletBalancer::enable(const Config& config)
+{
+    this->config = config;
+    LOG(NOTICE, "Tablet balancing enabled: interval %.1f s, imbalance "
+            "ratio %.2f", config.intervalSeconds, config.imbalanceRatio);
+    start(0);
+}
+
+/**
+ * This method is invoked by the timer; it performs one round of balancing,
+ * then arranges for the next one.
+ */
+void
+TabletBalancer::handleTimerEvent()
+{
+    balance();
+    start(Cycles::rdtsc() + Cycles::fromSeconds(config.intervalSeconds));
+}
+
+/**
+ * Fetch statistics from all of the masters in the cluster and compute the
+ * current load on each of them.
+ *
+ * \param[out] masters
+ *      Filled in with one entry for each master that responded.
+ * \return
+ *      True means the rate of operations is known for every tablet; false
+ *      means some tablets are new since the last round, so their rates
+ *      (and their masters' loads) are incomplete.
+ */
+bool
+TabletBalancer::collect(std::vector<MasterLoad>* masters)
+{
+    std::vector<ServerId> ids;
+    ServerId id;
+    while (true) {
+        bool end;
+        id = context->coordinatorServerList->nextServer(id,
+                ServiceMask({WireFormat::MASTER_SERVICE}), &end);
+        if (end || !id.isValid())
+            break;
+        ids.push_back(id);
+    }
+
+    // Query all of the masters in parallel, but don't wait long for any of
+    // them: the timer thread is shared with other timers.
+    uint64_t abortTime = Cycles::rdtsc() +
+            Cycles::fromSeconds(config.statsTimeoutSeconds);
+    std::unique_ptr<Tub<GetMasterStatisticsRpc>[]> rpcs(
+            new Tub<GetMasterStatisticsRpc>[ids.size()]);
+    for (size_t i = 0; i < ids.size(); i++)
+        rpcs[i].construct(context, ids[i]);
+
+    bool complete = true;
+    std::map<TabletKey, Sample> samples;
+    for (size_t i = 0; i < ids.size(); i++) {
+        ProtoBuf::ServerStatistics stats;
+        try {
+            if (!rpcs[i]->wait(&stats, abortTime)) {
+                LOG(NOTICE, "Master %s didn't return its statistics in "
+                        "time; leaving it out of this round",
+                        ids[i].toString().c_str());
+                complete = false;
+                continue;
+            }
+        } catch (const ServerNotUpException& e) {
+            continue;
+        } catch (const ClientException& e) {
+            LOG(WARNING, "Couldn't get statistics from master %s: %s; "
+                    "leaving it out of this round",
+                    ids[i].toString().c_str(), e.toSymbol());
+            complete = false;
+            continue;
+        }
+        uint64_t now = Cycles::rdtsc();
+
+        MasterLoad master(ids[i]);
+        foreach (const ProtoBuf::ServerStatistics::TabletEntry& entry,
+                stats.tabletentry()) {
+            // Tablets backing indexlets can't be migrated individually.
+            if (tableManager->isIndexletTable(entry.table_id()))
+                continue;
+
+            TabletKey key(ids[i].getId(), entry.table_id(),
+                    entry.start_key_hash(), entry.end_key_hash());
+            Sample sample = {entry.number_read_and_writes(), now};
+            samples[key] = sample;
+
+            double opsPerSecond = 0;
+            auto it = lastSamples.find(key);
+            if (it != lastSamples.end() &&
+                    it->second.operations <= sample.operations &&
+                    it->second.cycles < now) {
+                opsPerSecond = static_cast<double>(
+                        sample.operations - it->second.operations) /
+                        Cycles::toSeconds(now - it->second.cycles);
+            } else {
+                complete = false;
+            }
+            master.tablets.emplace_back(entry.table_id(),
+                    entry.start_key_hash(), entry.end_key_hash(),
+                    opsPerSecond, entry.byte_count());
+            master.opsPerSecond += opsPerSecond;
+            master.bytes += static_cast<double>(entry.byte_count());
+        }
+        masters->push_back(master);
+    }
+    lastSamples.swap(samples);
+    return complete;
+}
+
+/**
+ * Carry out an action chosen by #plan, after checking that the coordinator
+ * still agrees about the tablet's state. Errors are logged, not thrown;
+ * the balancer simply tries again in a later round. A migration is only
+ * started here; #finishMigration reaps it once it has completed.
+ *
+ * \param action
+ *      What to do.
+ */
+void
+TabletBalancer::execute(const Action& action)
+{
+    try {
+        Tablet tablet = tableManager->getTablet(action.tableId,
+                action.startKeyHash);
+        if (tablet.startKeyHash != action.startKeyHash ||
+                tablet.endKeyHash != action.endKeyHash ||
+                tablet.serverId != action.source ||
+                tablet.status != Tablet::NORMAL) {
+            LOG(NOTICE, "Tablet [0x%lx,0x%lx] in table %lu changed since "
+                    "its statistics were collected; not rebalancing it",
+                    action.startKeyHash, action.endKeyHash, action.tableId);
+            return;
+        }
+
+        if (action.type == Action::SPLIT) {
+            LOG(NOTICE, "Splitting tablet [0x%lx,0x%lx] in table %lu on "
+                    "master %s at 0x%lx to rebalance load",
+                    action.startKeyHash, action.endKeyHash, action.tableId,
+                    action.source.toString().c_str(), action.splitKeyHash);
+            tableManager->splitTablet(action.tableId, action.splitKeyHash);
+        } else {
+            LOG(NOTICE, "Migrating tablet [0x%lx,0x%lx] in table %lu from "
+                    "master %s to master %s to rebalance load",
+                    action.startKeyHash, action.endKeyHash, action.tableId,
+                    action.source.toString().c_str(),
+                    action.target.toString().c_str());
+            migrationAction = action;
+            migration.construct(context, action.source, action.tableId,
+                    action.startKeyHash, action.endKeyHash, action.target);
+        }
+    } catch (const TableManager::NoSuchTable& e) {
+        LOG(NOTICE, "Table %lu was dropped; not rebalancing it",
+                action.tableId);
+    } catch (const TableManager::NoSuchTablet& e) {
+        LOG(NOTICE, "Tablet [0x%lx,0x%lx] in table %lu no longer exists; "
+                "not rebalancing it", action.startKeyHash, action.endKeyHash,
+                action.tableId);
+    } catch (const ServerNotUpException& e) {
+        LOG(WARNING, "Couldn't rebalance tablet [0x%lx,0x%lx] in table %lu: "
+                "master %s isn't up", action.startKeyHash, action.endKeyHash,
+                action.tableId, action.source.toString().c_str());
+    } catch (const ClientException& e) {
+        LOG(WARNING, "Couldn't rebalance tablet [0x%lx,0x%lx] in table %lu: "
+                "%s", action.startKeyHash, action.endKeyHash, action.tableId,
+                e.toSymbol());
+    }
+}
+
+/**
+ * Collect the result of the migration started by #execute, once it has
+ * completed, and start the cooldown period. Errors are logged, not thrown.
+ */
+void
+TabletBalancer::finishMigration()
+{
+    const Action& action = migrationAction;
+    try {
+        migration->wait();
+        LOG(NOTICE, "Finished migrating tablet [0x%lx,0x%lx] in table %lu "
+                "to master %s", action.startKeyHash, action.endKeyHash,
+                action.tableId, action.target.toString().c_str());
+    } catch (const ServerNotUpException& e) {
+        LOG(WARNING, "Couldn't rebalance tablet [0x%lx,0x%lx] in table %lu: "
+                "master %s isn't up", action.startKeyHash, action.endKeyHash,
+                action.tableId, action.source.toString().c_str());
+    } catch (const ClientException& e) {
+        LOG(WARNING, "Couldn't rebalance tablet [0x%lx,0x%lx] in table %lu: "
+                "%s", action.startKeyHash, action.endKeyHash, action.tableId,
+                e.toSymbol());
+    }
+    migration.destroy();
+    cooldown = config.cooldownRounds;
+}
+
+/**
+ * Decide whether anything should be done about the current load on the
+ * masters, and if so, what. See the class documentation for the policy.
+ *
+ * \param masters
+ *      Current load on each master, from #collect.
+ * \return
+ *      The chosen action; its type is NONE if the masters are balanced
+ *      well enough, or if no action would improve the balance.
+ */
+TabletBalancer::Action
+TabletBalancer::plan(const std::vector<MasterLoad>& masters)
+{
+    Action action;
+    if (masters.size() < 2)
+        return action;
+
+    // Find the resource that is most out of balance, along with the most
+    // and least loaded masters for that resource.
+    double mean[2] = {0, 0};
+    int resource = -1;
+    double worstRatio = 0;
+    const MasterLoad* source = NULL;
+    const MasterLoad* target = NULL;
+    for (int r = OPERATIONS; r <= MEMORY; r++) {
+        const MasterLoad* busiest = &masters[0];
+        const MasterLoad* idlest = &masters[0];
+        double total = 0;
+        foreach (const MasterLoad& master, masters) {
+            total += getLoad(master, r);
+            if (getLoad(master, r) > getLoad(*busiest, r))
+                busiest = &master;
+            if (getLoad(master, r) < getLoad(*idlest, r))
+                idlest = &master;
+        }
+        mean[r] = total / static_cast<double>(masters.size());
+        if (mean[r] <= 0)
+            continue;
+        double excess = getLoad(*busiest, r) - mean[r];
+        double minExcess = (r == OPERATIONS) ? config.minOpsPerSecond
+                : static_cast<double>(config.minBytes);
+        double ratio = getLoad(*busiest, r) / mean[r];
+        if (ratio <= config.imbalanceRatio || excess < minExcess)
+            continue;
+        if (ratio > worstRatio) {
+            worstRatio = ratio;
+            resource = r;
+            source = busiest;
+            target = idlest;
+        }
+    }
+    if (resource < 0)
+        return action;
+
+    // Move the largest tablet that narrows the gap between the two masters
+    // without making the target the busier one, and without overloading
+    // the target in the other resource.
+    int other = 1 - resource;
+    double gap = getLoad(*source, resource) - getLoad(*target, resource);
+    const TabletLoad* best = NULL;
+    const TabletLoad* hottest = NULL;
+    foreach (const TabletLoad& tablet, source->tablets) {
+        double load = getLoad(tablet, resource);
+        if (hottest == NULL || load > getLoad(*hottest, resource))
+            hottest = &tablet;
+        if (load <= 0 || load > gap / 2)
+            continue;
+        if (getLoad(tablet, other) > 0 &&
+                getLoad(*target, other) + getLoad(tablet, other) >
+                mean[other] * config.imbalanceRatio)
+            continue;
+        if (best == NULL || load > getLoad(*best, resource))
+            best = &tablet;
+    }
+
+    if (best != NULL) {
+        action.type = Action::MIGRATE;
+        action.tableId = best->tableId;
+        action.startKeyHash = best->startKeyHash;
+        action.endKeyHash = best->endKeyHash;
+        action.source = source->serverId;
+        action.target = target->serverId;
+        return action;
+    }
+
+    // Nothing fits, so split the hottest tablet (assuming its load is
+    // spread evenly over its key hashes) so that half of it can move.
+    if (hottest != NULL && getLoad(*hottest, resource) > gap / 2 &&
+            hottest->endKeyHash - hottest->startKeyHash >=
+            config.minSplitKeyHashes) {
+        action.type = Action::SPLIT;
+        action.tableId = hottest->tableId;
+        action.startKeyHash = hottest->startKeyHash;
+        action.endKeyHash = hottest->endKeyHash;
+        action.splitKeyHash = hottest->startKeyHash +
+                (hottest->endKeyHash - hottest->startKeyHash) / 2 + 1;
+        action.source = source->serverId;
+    }
+    return action;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,242 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLETBALANCER_H
+#define RAMCLOUD_TABLETBALANCER_H
+
+#include <map>
+#include <tuple>
+
+#include "Common.h"
+#include "Context.h"
+#include "MasterClient.h"
+#include "ServerId.h"
+#include "WorkerTimer.h"
+
+namespace RAMCloud {
+
+class TableManager;
+
+/**
+ * The TabletBalancer runs on the coordinator and moves load between masters
+ * without operator intervention. At regular intervals it asks each master
+ * for the statistics of its tablets (operations performed so far and an
+ * estimate of the bytes stored), converts the operation counts into rates,
+ * and then decides on at most one action to even out the masters:
+ *   - If the busiest master (in operations per second, or else in bytes)
+ *     has a tablet that can move to the least busy master without making
+ *     that master the busier of the two, the tablet is migrated.
+ *   - Otherwise, if the busiest master's hottest tablet is too big to move,
+ *     it is split in half, so that a later round can move one of the halves.
+ *
+ * Operations per second stand in for master CPU load. To avoid thrashing:
+ *   - A master must exceed the mean load by a configurable ratio (and by an
+ *     absolute minimum) before anything is done.
+ *   - The imbalance must persist for several consecutive rounds.
+ *   - After each action, the balancer waits several rounds, so that it sees
+ *     the effect of the action before deciding on another one.
+ *   - A tablet is only moved if the move narrows the gap between the two
+ *     masters; it never makes the target busier than the source.
+ *
+ * The balancer runs on the coordinator's worker timer thread, which it
+ * shares with other timers (such as the cluster clock), so it never blocks
+ * for long: statistics requests are abandoned after a deadline, and a
+ * migration is started asynchronously and checked for completion in later
+ * rounds; no new action is taken until it finishes.
+ *
+ * The balancer is disabled until #enable is called.
+ */
+class TabletBalancer : public WorkerTimer {
+  PUBLIC:
+    /**
+     * Parameters that control how aggressively the balancer acts.
+     */
+    struct Config {
+        Config()
+            : intervalSeconds(10.0)
+            , imbalanceRatio(1.25)
+            , hysteresisRounds(3)
+            , cooldownRounds(3)
+            , minOpsPerSecond(1000.0)
+            , minBytes(256 * 1024 * 1024)
+            , minSplitKeyHashes(1UL << 48)
+            , statsTimeoutSeconds(1.0)
+        {}
+
+        /// Time between successive rounds (samples of the masters'
+        /// statistics).
+        double intervalSeconds;
+
+        /// A master is overloaded if its load exceeds the mean load of all
+        /// masters by this factor.
+        double imbalanceRatio;
+
+        /// Number of consecutive rounds in which a master must be overloaded
+        /// before the balancer acts.
+        uint32_t hysteresisRounds;
+
+        /// Number of rounds to wait after an action before considering
+        /// another one.
+        uint32_t cooldownRounds;
+
+        /// Differences in operation rates smaller than this (operations per
+        /// second above the mean) are ignored.
+        double minOpsPerSecond;
+
+        /// Differences in memory usage smaller than this (bytes above the
+        /// mean) are ignored.
+        uint64_t minBytes;
+
+        /// Tablets covering fewer key hashes than this are never split:
+        /// their load most likely comes from a few hot objects, which
+        /// splitting can't spread.
+        uint64_t minSplitKeyHashes;
+
+        /// Masters that haven't returned their statistics within this many
+        /// seconds of the start of a round are left out of that round.
+        double statsTimeoutSeconds;
+    };
+
+    TabletBalancer(Context* context, TableManager* tableManager);
+    ~TabletBalancer();
+    void balance();
+    void disable();
+    void enable(const Config& config);
+    virtual void handleTimerEvent();
+
+  PRIVATE:
+    /**
+     * Load on one tablet, as measured in the most recent round.
+     */
+    struct TabletLoad {
+        TabletLoad(uint64_t tableId, uint64_t startKeyHash,
+                uint64_t endKeyHash, double opsPerSecond, uint64_t bytes)
+            : tableId(tableId)
+            , startKeyHash(startKeyHash)
+            , endKeyHash(endKeyHash)
+            , opsPerSecond(opsPerSecond)
+            , bytes(bytes)
+        {}
+
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// Reads and writes per second since the previous round.
+        double opsPerSecond;
+
+        /// Estimated number of bytes stored in the tablet.
+        uint64_t bytes;
+    };
+
+    /**
+     * Load on one master: the sum of the loads on its tablets.
+     */
+    struct MasterLoad {
+        explicit MasterLoad(ServerId serverId)
+            : serverId(serverId)
+            , opsPerSecond(0)
+            , bytes(0)
+            , tablets()
+        {}
+
+        ServerId serverId;
+        double opsPerSecond;
+        double bytes;
+        std::vector<TabletLoad> tablets;
+    };
+
+    /**
+     * Describes the change that the balancer has decided to make.
+     */
+    struct Action {
+        enum Type { NONE, MIGRATE, SPLIT };
+
+        Action()
+            : type(NONE)
+            , tableId(0)
+            , startKeyHash(0)
+            , endKeyHash(0)
+            , splitKeyHash(0)
+            , source()
+            , target()
+        {}
+
+        Type type;
+
+        /// The tablet to migrate or split.
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// For SPLIT: first key hash of the second half.
+        uint64_t splitKeyHash;
+
+        /// Master that owns the tablet.
+        ServerId source;
+
+        /// For MIGRATE: master that will own the tablet.
+        ServerId target;
+    };
+
+    /// Identifies a tablet on a particular master: server id, table id,
+    /// first and last key hash.
+    typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> TabletKey;
+
+    /// Cumulative statistics for a tablet, as of some round.
+    struct Sample {
+        /// Number of reads and writes since the tablet was created.
+        uint64_t operations;
+
+        /// Cycles::rdtsc() when the statistics were received.
+        uint64_t cycles;
+    };
+
+    bool collect(std::vector<MasterLoad>* masters);
+    void execute(const Action& action);
+    void finishMigration();
+    Action plan(const std::vector<MasterLoad>& masters);
+
+    /// Shared information about the coordinator.
+    Context* context;
+
+    /// Used to split tablets and to check their current state.
+    TableManager* tableManager;
+
+    /// Controls the behavior of the balancer.
+    Config config;
+
+    /// Each tablet's statistics from the previous round.
+    std::map<TabletKey, Sample> lastSamples;
+
+    /// Number of consecutive rounds in which #plan wanted to act.
+    uint32_t imbalancedRounds;
+
+    /// Number of rounds left to wait before another action is allowed.
+    uint32_t cooldown;
+
+    /// The migration started by the most recent MIGRATE action, while it is
+    /// still in progress.
+    Tub<RequestMigrationRpc> migration;
+
+    /// The action that started #migration (used for log messages).
+    Action migrationAction;
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancer);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLETBALANCER_H
@@ -0,0 +1,281 @@
+/* Copyright (c) 2016 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "CoordinatorService.h"
+#include "MockCluster.h"
+#include "MockTransport.h"
+#include "RamCloud.h"
+#include "TabletBalancer.h"
+
+namespace RAMCloud {
+
+class TabletBalancerTest : public ::testing::Test {
+  public:
+    typedef TabletBalancer::Action Action;
+    typedef TabletBalancer::MasterLoad MasterLoad;
+
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    CoordinatorService* service;
+    TabletBalancer* balancer;
+    ServerId master1;
+    ServerId master2;
+    uint64_t tableId;
+
+    TabletBalancerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , service(cluster.coordinator.get())
+        , balancer(&service->tabletBalancer)
+        , master1()
+        , master2()
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.master.numReplicas = 0;
+        config.localLocator = "mock:host=master1";
+        master1 = cluster.addServer(config)->serverId;
+
+        // Create the table before the second master exists, so that all of
+        // the load starts out on the first master.
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+
+        config.localLocator = "mock:host=master2";
+        master2 = cluster.addServer(config)->serverId;
+
+        balancer->config.hysteresisRounds = 2;
+        balancer->config.cooldownRounds = 1;
+        balancer->config.minOpsPerSecond = 0;
+    }
+
+    // Adds a tablet with the given load to a master.
+    void
+    addTablet(MasterLoad* master, uint64_t startKeyHash,
+            uint64_t endKeyHash, double opsPerSecond, uint64_t bytes = 0)
+    {
+        master->tablets.emplace_back(tableId, startKeyHash, endKeyHash,
+                opsPerSecond, bytes);
+        master->opsPerSecond += opsPerSecond;
+        master->bytes += static_cast<double>(bytes);
+    }
+
+    // Returns a human-readable description of an action.
+    string
+    toString(const Action& action)
+    {
+        switch (action.type) {
+        case Action::MIGRATE:
+            return format("migrate [%lu,%lu] from %s to %s",
+                    action.startKeyHash, action.endKeyHash,
+                    action.source.toString().c_str(),
+                    action.target.toString().c_str());
+        case Action::SPLIT:
+            return format("split [%lu,%lu] at %lu on %s",
+                    action.startKeyHash, action.endKeyHash,
+                    action.splitKeyHash, action.source.toString().c_str());
+        default:
+            return "none";
+        }
+    }
+
+    // Writes a batch of objects spread over the whole table.
+    void
+    generateLoad()
+    {
+        for (int i = 0; i < 50; i++) {
+            string key = format("key%d", i);
+            ramcloud->write(tableId, key.data(),
+                    downCast<uint16_t>(key.size()), "value", 5);
+        }
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancerTest);
+};
+
+TEST_F(TabletBalancerTest, plan_balanced) {
+    std::vector<MasterLoad> masters = {MasterLoad(ServerId(1, 0)),
+                                       MasterLoad(ServerId(2, 0))};
+    EXPECT_EQ("none", toString(balancer->plan(masters)));
+
+    // Not unbalanced enough.
+    addTablet(&masters[0], 0, 99, 1100);
+    addTablet(&masters[1], 100, 199, 1000);
+    EXPECT_EQ("none", toString(balancer->plan(masters)));
+
+    // Unbalanced, but the difference is too small to matter.
+    balancer->config.minOpsPerSecond = 1000;
+    addTablet(&masters[0], 200, 299, 1600);
+    EXPECT_EQ("none", toString(balancer->plan(masters)));
+
+    // Only one master.
+    masters.pop_back();
+    EXPECT_EQ("none", toString(balancer->plan(masters)));
+}
+
+TEST_F(TabletBalancerTest, plan_migrate) {
+    std::vector<MasterLoad> masters = {MasterLoad(ServerId(1, 0)),
+                                       MasterLoad(ServerId(2, 0))};
+    addTablet(&masters[0], 0, 99, 3000);
+    addTablet(&masters[0], 100, 199, 1500);
+    addTablet(&masters[0], 200, 299, 500);
+    addTablet(&masters[1], 300, 399, 1000);
+
+    // The largest tablet that fits in half of the 4000 ops/sec gap.
+    EXPECT_EQ("migrate [100,199] from 1.0 to 2.0",
+            toString(balancer->plan(masters)));
+}
+
+TEST_F(TabletBalancerTest, plan_migrateRespectsOtherResource) {
+    std::vector<MasterLoad> masters = {MasterLoad(ServerId(1, 0)),
+                                       MasterLoad(ServerId(2, 0)),
+                                       MasterLoad(ServerId(3, 0))};
+    balancer->config.minBytes = 0;
+    addTablet(&masters[0], 0, 99, 1400, 1000);
+    addTablet(&masters[0], 100, 199, 1000, 100);
+    addTablet(&masters[0], 200, 299, 600, 0);
+    addTablet(&masters[1], 300, 399, 0, 2000);
+    addTablet(&masters[2], 400, 499, 1000, 2000);
+
+    // Moving the busiest tablet that fits would overload master2's memory.
+    EXPECT_EQ("migrate [100,199] from 1.0 to 2.0",
+            toString(balancer->plan(masters)));
+}
+
+TEST_F(TabletBalancerTest, plan_memory) {
+    std::vector<MasterLoad> masters = {MasterLoad(ServerId(1, 0)),
+                                       MasterLoad(ServerId(2, 0))};
+    balancer->config.minBytes = 1000;
+    addTablet(&masters[0], 0, 99, 1000, 5000);
+    addTablet(&masters[0], 100, 199, 0, 2000);
+    addTablet(&masters[1], 200, 299, 1000, 1000);
+    EXPECT_EQ("migrate [100,199] from 1.0 to 2.0",
+            toString(balancer->plan(masters)));
+}
+
+TEST_F(TabletBalancerTest, plan_split) {
+    std::vector<MasterLoad> masters = {MasterLoad(ServerId(1, 0)),
+                                       MasterLoad(ServerId(2, 0))};
+    addTablet(&masters[0], 0, ~0UL, 5000);
+    EXPECT_EQ("split [0,18446744073709551615] at 9223372036854775808 on 1.0",
+            toString(balancer->plan(masters)));
+
+    // Too narrow to split.
+    masters[0].tablets[0].endKeyHash = 1000;
+    EXPECT_EQ("none", toString(balancer->plan(masters)));
+}
+
+TEST_F(TabletBalancerTest, balance) {
+    // First round: no rates yet.
+    balancer->balance();
+    EXPECT_EQ(0U, balancer->imbalancedRounds);
+    EXPECT_EQ(1U, balancer->lastSamples.size());
+
+    // The whole table is on master1, so it must be split. This happens
+    // only after the imbalance has been seen twice.
+    generateLoad();
+    balancer->balance();
+    EXPECT_EQ(1U, balancer->imbalancedRounds);
+    EXPECT_EQ(~0UL, service->tableManager.getTablet(tableId, 0).endKeyHash);
+    generateLoad();
+    TestLog::reset();
+    balancer->balance();
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), format(
+            "Splitting tablet [0x0,0xffffffffffffffff] in table %lu on "
+            "master %s at 0x8000000000000000 to rebalance load",
+            tableId, master1.toString().c_str())));
+    EXPECT_EQ(~0UL/2, service->tableManager.getTablet(tableId, 0).endKeyHash);
+    EXPECT_EQ(1U, balancer->cooldown);
+
+    // Cooling down (and sampling the new tablets).
+    generateLoad();
+    balancer->balance();
+    EXPECT_EQ(0U, balancer->imbalancedRounds);
+    EXPECT_EQ(2U, balancer->lastSamples.size());
+
+    // Now one half moves to master2.
+    generateLoad();
+    balancer->balance();
+    EXPECT_EQ(1U, balancer->imbalancedRounds);
+    generateLoad();
+    TestLog::reset();
+    balancer->balance();
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            format("to master %s to rebalance load",
+            master2.toString().c_str())));
+    ServerId owner0 = service->tableManager.getTablet(tableId, 0).serverId;
+    ServerId owner1 = service->tableManager.getTablet(tableId,
+            1UL << 63).serverId;
+    EXPECT_NE(owner0, owner1);
+
+    // The migration is reaped in the next round, which starts the cooldown.
+    EXPECT_TRUE(balancer->migration);
+    TestLog::reset();
+    balancer->balance();
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "Finished migrating tablet"));
+    EXPECT_FALSE(balancer->migration);
+    EXPECT_EQ(1U, balancer->cooldown);
+}
+
+TEST_F(TabletBalancerTest, collect_masterReturnsError) {
+    MockTransport mockTransport(service->context);
+    service->context->transportManager->registerMock(&mockTransport,
+            "mock2");
+    service->serverList.haltUpdater();
+    ServerId badId = service->serverList.enlistServer(
+            {WireFormat::MASTER_SERVICE, WireFormat::ADMIN_SERVICE},
+            0, 100, "mock2:");
+    mockTransport.setInput("21");   // STATUS_INTERNAL_ERROR
+
+    std::vector<MasterLoad> masters;
+    TestLog::reset();
+    EXPECT_FALSE(balancer->collect(&masters));
+    EXPECT_EQ(2U, masters.size());
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), format(
+            "Couldn't get statistics from master %s: STATUS_INTERNAL_ERROR",
+            badId.toString().c_str())));
+}
+
+TEST_F(TabletBalancerTest, execute_tabletChanged) {
+    Action action;
+    action.type = Action::SPLIT;
+    action.tableId = tableId;
+    action.startKeyHash = 0;
+    action.endKeyHash = ~0UL;
+    action.splitKeyHash = 1000;
+    action.source = master2;
+    TestLog::reset();
+    balancer->execute(action);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "changed since its statistics were collected"));
+    EXPECT_EQ(~0UL, service->tableManager.getTablet(tableId, 0).endKeyHash);
+
+    action.tableId = tableId + 10;
+    TestLog::reset();
+    balancer->execute(action);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), "no longer exists"));
+}
+
+}  // namespace RAMCloud
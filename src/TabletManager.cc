@@ -41,6 +41,10 @@ TabletManager::TabletManager()
  * \param state
  *      The initial state of the tablet (see the TabletState enum for more
  *      details).
+ * \param recovering
+ *      True if the tablet is being added so that this master can recover it
+ *      from a crashed master's log. Such tablets can be read in degraded
+ *      mode before recovery completes (see checkAndIncrementReadCount).
  * \return
  *      Returns true if successfully added, false if the tablet cannot be
  *      added because it overlaps with one or more existing tablets.
@@ -49,7 +53,8 @@ bool
 TabletManager::addTablet(uint64_t tableId,
                          uint64_t startKeyHash,
                          uint64_t endKeyHash,
-                         TabletState state)
+                         TabletState state,
+                         bool recovering)
 {
     SpinLock::Guard guard(lock);
 
@@ -60,7 +65,8 @@ TabletManager::addTablet(uint64_t tableId,
     }
 
     tabletMap.insert(std::make_pair(tableId,
-                     Tablet(tableId, startKeyHash, endKeyHash, state)));
+                     Tablet(tableId, startKeyHash, endKeyHash, state,
+                            recovering)));
 
     if (state == TabletState::NOT_READY) {
         numLoadingTablets++;
@@ -77,17 +83,27 @@ TabletManager::addTablet(uint64_t tableId,
  *
  * \param key
  *      The Key whose tablet we're looking up.
+ * \param[out] notReady
+ *      If non-NULL, a NOT_READY tablet that this master is recovering is
+ *      also accepted, and this is set to indicate whether it was such a
+ *      tablet. Used for degraded reads. Tablets that are NOT_READY because
+ *      they are being migrated here are never accepted: until migration
+ *      finishes, the source master still owns them and may take writes.
  * \return
  *      True if a tablet was found, otherwise false.
  */
 bool
-TabletManager::checkAndIncrementReadCount(Key& key) {
+TabletManager::checkAndIncrementReadCount(Key& key, bool* notReady) {
     SpinLock::Guard guard(lock);
     TabletMap::iterator it = lookup(key.getTableId(), key.getHash(), guard);
 
     if (it == tabletMap.end())
         return false;
-    if (it->second.state != NORMAL) {
+    bool recovering = (it->second.state == NOT_READY &&
+            it->second.recovering);
+    if (notReady != NULL)
+        *notReady = recovering;
+    if (it->second.state != NORMAL && !(notReady != NULL && recovering)) {
         if (it->second.state == TabletManager::LOCKED_FOR_MIGRATION)
             throw RetryException(HERE, 1000, 2000,
                     "Tablet is currently locked for migration!");
@@ -292,7 +308,8 @@ TabletManager::splitTablet(uint64_t tableId,
     // decide to do the split
     if (splitKeyHash != t->startKeyHash) {
         tabletMap.insert(std::make_pair(tableId, Tablet
-                         (tableId, splitKeyHash, t->endKeyHash, t->state)));
+                         (tableId, splitKeyHash, t->endKeyHash, t->state,
+                          t->recovering)));
         t->endKeyHash = splitKeyHash - 1;
 
         // It's unclear what to do with the counts when splitting. The old
@@ -350,6 +367,8 @@ TabletManager::changeState(uint64_t tableId,
         return false;
 
     t->state = newState;
+    if (newState != TabletState::NOT_READY)
+        t->recovering = false;
 
     assert(oldState != newState);
     if (newState == TabletState::NOT_READY) {
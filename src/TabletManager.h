@@ -77,6 +77,7 @@ class TabletManager {
             , startKeyHash(-1)
             , endKeyHash(-1)
             , state(NOT_READY)
+            , recovering(false)
             , readCount(-1)
             , writeCount(-1)
         {
@@ -85,11 +86,13 @@ class TabletManager {
         Tablet(uint64_t tableId,
                uint64_t startKeyHash,
                uint64_t endKeyHash,
-               TabletState state)
+               TabletState state,
+               bool recovering = false)
             : tableId(tableId)
             , startKeyHash(startKeyHash)
             , endKeyHash(endKeyHash)
             , state(state)
+            , recovering(recovering)
             , readCount(0)
             , writeCount(0)
         {
@@ -107,6 +110,11 @@ class TabletManager {
         /// The current state of the tablet. See TabletState.
         TabletState state;
 
+        /// True if this master is rebuilding the tablet from a crashed
+        /// master's log (as opposed to receiving it through migration).
+        /// Only meaningful while the tablet is NOT_READY.
+        bool recovering;
+
         /// The number of read operations performed on objects in this tablet.
         uint64_t readCount;
 
@@ -150,8 +158,9 @@ class TabletManager {
     bool addTablet(uint64_t tableId,
                    uint64_t startKeyHash,
                    uint64_t endKeyHash,
-                   TabletState state);
-    bool checkAndIncrementReadCount(Key& key);
+                   TabletState state,
+                   bool recovering = false);
+    bool checkAndIncrementReadCount(Key& key, bool* notReady = NULL);
     bool getTablet(Key& key,
                    Tablet* outTablet = NULL);
     bool getTablet(uint64_t tableId,
@@ -78,6 +78,46 @@ TEST_F(TabletManagerTest, checkAndIncrementReadCount) {
             "{ tableId: 5 startKeyHash: 11082539161020170669 endKeyHash:"
             " 11082539161020170669 state: 0 reads: 1 writes: 0 }",
             tm.toString());
+
+    // Tablets that are being recovered can only be read in degraded mode.
+    bool notReady = true;
+    EXPECT_TRUE(tm.checkAndIncrementReadCount(key, &notReady));
+    EXPECT_FALSE(notReady);
+    tm.deleteTablet(5, key.getHash(), key.getHash());
+    tm.addTablet(5, key.getHash(), key.getHash(), TabletManager::NOT_READY,
+            true);
+    EXPECT_FALSE(tm.checkAndIncrementReadCount(key));
+    EXPECT_TRUE(tm.checkAndIncrementReadCount(key, &notReady));
+    EXPECT_TRUE(notReady);
+    EXPECT_EQ(
+            "{ tableId: 5 startKeyHash: 11082539161020170669 endKeyHash:"
+            " 11082539161020170669 state: 1 reads: 1 writes: 0 }",
+            tm.toString());
+
+    // Once recovery finishes, the tablet is read normally.
+    tm.changeState(5, key.getHash(), key.getHash(), TabletManager::NOT_READY,
+            TabletManager::NORMAL);
+    EXPECT_TRUE(tm.checkAndIncrementReadCount(key, &notReady));
+    EXPECT_FALSE(notReady);
+}
+
+TEST_F(TabletManagerTest, checkAndIncrementReadCount_migrationTarget) {
+    Key key(5, "1", 1);
+    tm.addTablet(5, key.getHash(), key.getHash(), TabletManager::NOT_READY);
+    bool notReady = true;
+    EXPECT_FALSE(tm.checkAndIncrementReadCount(key, &notReady));
+    EXPECT_FALSE(notReady);
+
+    // Same for a tablet that was recovered here and is now migrating back.
+    tm.deleteTablet(5, key.getHash(), key.getHash());
+    tm.addTablet(5, key.getHash(), key.getHash(), TabletManager::NOT_READY,
+            true);
+    tm.changeState(5, key.getHash(), key.getHash(), TabletManager::NOT_READY,
+            TabletManager::NORMAL);
+    tm.changeState(5, key.getHash(), key.getHash(), TabletManager::NORMAL,
+            TabletManager::NOT_READY);
+    EXPECT_FALSE(tm.checkAndIncrementReadCount(key, &notReady));
+    EXPECT_FALSE(notReady);
 }
 
 TEST_F(TabletManagerTest, getTablet_byKey) {
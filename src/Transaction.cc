@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include "ClientLeaseAgent.h"
 #include "ClientTransactionManager.h"
 #include "ClientTransactionTask.h"
 #include "ClientException.h"
@@ -25,11 +26,17 @@ namespace RAMCloud {
  *
  * \param ramcloud
  *      Overall information about the calling client.
+ * \param snapshot
+ *      True means this transaction is read-only and reads a consistent
+ *      snapshot of the cluster without ever aborting; remove and write
+ *      throw InvalidParameterException. Defaults to false.
  */
-Transaction::Transaction(RamCloud* ramcloud)
+Transaction::Transaction(RamCloud* ramcloud, bool snapshot)
     : ramcloud(ramcloud)
     , taskPtr(new ClientTransactionTask(ramcloud))
     , commitStarted(false)
+    , snapshot(snapshot)
+    , snapshotTime()
     , nextReadBatchPtr()
 {
 }
@@ -46,24 +53,8 @@ Transaction::Transaction(RamCloud* ramcloud)
 bool
 Transaction::commit()
 {
-    ClientTransactionTask* task = taskPtr.get();
-
-    if (!commitStarted) {
-        commitStarted = true;
-        ramcloud->transactionManager->startTransactionTask(taskPtr);
-    }
-
-    while (!task->allDecisionsSent()) {
-        ramcloud->transactionManager->poll();
-        ramcloud->poll();
-    }
-
-    if (expect_false(task->getDecision() ==
-            WireFormat::TxDecision::UNDECIDED)) {
-        ClientException::throwException(HERE, STATUS_INTERNAL_ERROR);
-    }
-
-    return (task->getDecision() == WireFormat::TxDecision::COMMIT);
+    CommitOp op(this);
+    return op.wait();
 }
 
 /**
@@ -78,6 +69,11 @@ Transaction::sync()
 {
     ClientTransactionTask* task = taskPtr.get();
 
+    if (snapshot) {
+        commitStarted = true;
+        return;
+    }
+
     if (!commitStarted) {
         commitStarted = true;
         ramcloud->transactionManager->startTransactionTask(taskPtr);
@@ -150,6 +146,10 @@ Transaction::remove(uint64_t tableId, const void* key, uint16_t keyLength)
         throw TxOpAfterCommit(HERE);
     }
 
+    if (expect_false(snapshot)) {
+        throw InvalidParameterException(HERE);
+    }
+
     ClientTransactionTask* task = taskPtr.get();
     task->readOnly = false;
 
@@ -193,6 +193,10 @@ Transaction::write(uint64_t tableId, const void* key, uint16_t keyLength,
         throw TxOpAfterCommit(HERE);
     }
 
+    if (expect_false(snapshot)) {
+        throw InvalidParameterException(HERE);
+    }
+
     if (length > 1048576) { // RAMCloud doesn't support data > 1MB.
         throw RequestTooLargeException(HERE);
     }
@@ -214,6 +218,63 @@ Transaction::write(uint64_t tableId, const void* key, uint16_t keyLength,
     entry->type = ClientTransactionTask::CacheEntry::WRITE;
 }
 
+/**
+ * Constructor for Transaction::CommitOp: starts committing a transaction
+ * just like #Transaction::commit, but returns once the commit has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param transaction
+ *      The Transaction to commit.
+ */
+Transaction::CommitOp::CommitOp(Transaction* transaction)
+    : transaction(transaction)
+{
+    // Every read of a snapshot transaction was consistent when it was made,
+    // so there is nothing to validate.
+    if (!transaction->commitStarted && !transaction->snapshot) {
+        transaction->ramcloud->transactionManager->startTransactionTask(
+                transaction->taskPtr);
+    }
+    transaction->commitStarted = true;
+}
+
+/**
+ * Indicates whether a commit decision has been reached and sent to all
+ * participant servers, so that #wait will not block. Also gives the
+ * client's transaction manager a chance to make progress.
+ */
+bool
+Transaction::CommitOp::isReady()
+{
+    if (transaction->snapshot)
+        return true;
+    transaction->ramcloud->transactionManager->poll();
+    return transaction->taskPtr->allDecisionsSent();
+}
+
+/**
+ * Wait for the commit to complete, and return the same results as
+ * #Transaction::commit.
+ *
+ * \return
+ *      True if the transaction was able to commit.  False otherwise.
+ */
+bool
+Transaction::CommitOp::wait()
+{
+    while (!isReady())
+        transaction->ramcloud->poll();
+    if (transaction->snapshot)
+        return true;
+
+    ClientTransactionTask* task = transaction->taskPtr.get();
+    if (expect_false(task->getDecision() ==
+            WireFormat::TxDecision::UNDECIDED)) {
+        ClientException::throwException(HERE, STATUS_INTERNAL_ERROR);
+    }
+    return (task->getDecision() == WireFormat::TxDecision::COMMIT);
+}
+
 /**
  * Constructor for Transaction::ReadOp: initiates a read just like
  * #Transaction::read, but returns once the operation has been initiated,
@@ -235,7 +296,7 @@ Transaction::write(uint64_t tableId, const void* key, uint16_t keyLength,
  *      contents of the desired object - only the value portion of the object.
  * \param batch
  *      True if this operation can be batched trading latency for throughput.
- *      Defaults to false.
+ *      Defaults to false.  Ignored for snapshot transactions.
  */
 Transaction::ReadOp::ReadOp(Transaction* transaction, uint64_t tableId,
         const void* key, uint16_t keyLength, Buffer* value, bool batch)
@@ -245,7 +306,7 @@ Transaction::ReadOp::ReadOp(Transaction* transaction, uint64_t tableId,
     , keyLength(keyLength)
     , value(value)
     , buf()
-    , requestBatched(batch)
+    , requestBatched(batch && !transaction->snapshot)
     , singleRequest()
     , batchedRequest()
 {
@@ -264,7 +325,18 @@ Transaction::ReadOp::ReadOp(Transaction* transaction, uint64_t tableId,
 
     // If no cache entry exists an rpc should be issued.
     if (entry == NULL) {
-        if (!requestBatched) {
+        if (transaction->snapshot) {
+            assert(singleRequest);
+            if (!transaction->snapshotTime) {
+                transaction->snapshotTime.construct(
+                        transaction->ramcloud->clientLeaseAgent->
+                        getClusterTime());
+            }
+            buf.construct();
+            singleRequest->snapshotRpc.construct(
+                    transaction->ramcloud, tableId, key, keyLength,
+                    *transaction->snapshotTime, buf.get());
+        } else if (!requestBatched) {
             assert(singleRequest);
             buf.construct();
             singleRequest->readRpc.construct(
@@ -307,6 +379,8 @@ Transaction::ReadOp::isReady()
 {
     if (!requestBatched) {
         assert(singleRequest);
+        if (singleRequest->snapshotRpc)
+            return singleRequest->snapshotRpc->isReady();
         return (!singleRequest->readRpc || singleRequest->readRpc->isReady());
     } else {
         assert(batchedRequest);
@@ -364,9 +438,13 @@ Transaction::ReadOp::wait(bool* objectExists)
         if (!requestBatched) {
             assert(singleRequest);
             // If no entry exists in cache an rpc must have been issued.
-            assert(singleRequest->readRpc);
+            assert(singleRequest->readRpc || singleRequest->snapshotRpc);
 
-            singleRequest->readRpc->wait(&version, &objectFound);
+            if (singleRequest->snapshotRpc) {
+                singleRequest->snapshotRpc->wait(&version, &objectFound);
+            } else {
+                singleRequest->readRpc->wait(&version, &objectFound);
+            }
             if (objectFound)
                 data = buf->getValue(&dataLength);
         } else {
@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "Common.h"
+#include "ClusterTime.h"
 #include "MultiRead.h"
 #include "RamCloud.h"
 
@@ -46,6 +47,14 @@ class ClientTransactionTask;
  * objects should be discarded after the transaction either commits or aborts;
  * a single Transaction object is not intended to be reused to represent
  * multiple transaction attempts.
+ *
+ * A transaction constructed in snapshot mode is read-only: all of its reads
+ * return the objects as they were at a single cluster time (chosen at the
+ * first read), served from the versions that masters retain for a short
+ * window (see ObjectHistory). Such a transaction never aborts and commit
+ * contacts no servers; instead a read may throw SnapshotTooOldException if
+ * the snapshot has fallen out of the window, in which case the client should
+ * start over with a new transaction.
  */
 class Transaction {
   PRIVATE:
@@ -53,7 +62,7 @@ class Transaction {
     struct ReadBatch;
 
   PUBLIC:
-    explicit Transaction(RamCloud* ramcloud);
+    explicit Transaction(RamCloud* ramcloud, bool snapshot = false);
 
     bool commit();
     void sync();
@@ -92,10 +101,13 @@ class Transaction {
         struct SingleRequest{
             SingleRequest()
                 : readRpc()
+                , snapshotRpc()
             {}
 
             /// If the value is already cached this rpc is unused.
             Tub<ReadKeysAndValueRpc> readRpc;
+            /// Used instead of readRpc if the transaction is in snapshot mode.
+            Tub<ReadSnapshotRpc> snapshotRpc;
         };
         Tub<SingleRequest> singleRequest;   // Use Tub to prevent misuse.
 
@@ -116,6 +128,22 @@ class Transaction {
         DISALLOW_COPY_AND_ASSIGN(ReadOp);
     };
 
+    /**
+     * Encapsulates the state of a Transaction::commit operation, allowing
+     * it to execute asynchronously.
+     */
+    class CommitOp {
+      public:
+        explicit CommitOp(Transaction* transaction);
+        bool isReady();
+        bool wait();
+
+      PRIVATE:
+        Transaction* transaction;       /// Transaction being committed.
+
+        DISALLOW_COPY_AND_ASSIGN(CommitOp);
+    };
+
   PRIVATE:
     /// Overall client state information.
     RamCloud* ramcloud;
@@ -128,6 +156,14 @@ class Transaction {
     /// subsequent read, remove, write, and commit calls.
     bool commitStarted;
 
+    /// True if this is a read-only transaction whose reads are served from
+    /// a snapshot (see Transaction::Transaction).
+    const bool snapshot;
+
+    /// Cluster time of the snapshot, if this is a snapshot transaction and
+    /// the first read has been issued.
+    Tub<ClusterTime> snapshotTime;
+
     /// Keeps a batch of batch allowed ReadOps organized with its supporting
     /// MultiRead rpc.
     struct ReadBatch {
@@ -60,6 +60,8 @@ class TransactionTest : public ::testing::Test {
         config.maxObjectDataSize = 1024;
         config.segmentSize = 128*1024;
         config.segletSize = 128*1024;
+        config.master.snapshotWindowMs = 1000;
+        config.master.maxSnapshotVersions = 100;
         cluster.addServer(config);
         config.services = {WireFormat::MASTER_SERVICE,
                            WireFormat::ADMIN_SERVICE};
@@ -142,6 +144,35 @@ TEST_F(TransactionTest, commit_abort) {
     EXPECT_TRUE(transaction->commitStarted);
 }
 
+TEST_F(TransactionTest, commit_snapshot) {
+    ramcloud->write(tableId1, "0", 1, "abcdef", 6);
+    ramcloud->write(tableId1, "1", 1, "old", 3);
+    transaction.construct(ramcloud.get(), true);
+    task = transaction->taskPtr.get();
+
+    Buffer value;
+    transaction->read(tableId1, "0", 1, &value);
+    EXPECT_EQ("abcdef", string(reinterpret_cast<const char*>(
+                    value.getRange(0, value.size())), value.size()));
+    EXPECT_TRUE(transaction->snapshotTime);
+
+    // Writes after the snapshot time are not visible, even to reads that
+    // happen after them.
+    ramcloud->write(tableId1, "1", 1, "new", 3);
+    ramcloud->write(tableId1, "2", 1, "new", 3);
+    transaction->read(tableId1, "1", 1, &value);
+    EXPECT_EQ("old", string(reinterpret_cast<const char*>(
+                    value.getRange(0, value.size())), value.size()));
+    bool objectExists = true;
+    transaction->read(tableId1, "2", 1, &value, &objectExists);
+    EXPECT_FALSE(objectExists);
+
+    // Nothing to validate, so nothing is sent.
+    EXPECT_TRUE(transaction->commit());
+    EXPECT_EQ(ClientTransactionTask::INIT, task->state);
+    transaction->sync();
+}
+
 TEST_F(TransactionTest, commit_internalError) {
     transaction->commit();
     transaction->taskPtr.get()->decision = WireFormat::TxDecision::UNDECIDED;
@@ -343,6 +374,12 @@ TEST_F(TransactionTest, remove) {
     EXPECT_EQ(entry, task->findCacheEntry(key));
 }
 
+TEST_F(TransactionTest, remove_snapshot) {
+    transaction.construct(ramcloud.get(), true);
+    EXPECT_THROW(transaction->remove(tableId1, "0", 1),
+                 InvalidParameterException);
+}
+
 TEST_F(TransactionTest, remove_afterCommit) {
     transaction->commitStarted = true;
     EXPECT_THROW(transaction->remove(1, "test", 4),
@@ -382,6 +419,12 @@ TEST_F(TransactionTest, write) {
     EXPECT_EQ(entry, task->findCacheEntry(key));
 }
 
+TEST_F(TransactionTest, write_snapshot) {
+    transaction.construct(ramcloud.get(), true);
+    EXPECT_THROW(transaction->write(tableId1, "0", 1, "hello", 5),
+                 InvalidParameterException);
+}
+
 TEST_F(TransactionTest, write_afterCommit) {
     transaction->commitStarted = true;
     EXPECT_THROW(transaction->write(1, "test", 4, "hello", 5),
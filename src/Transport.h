@@ -78,6 +78,7 @@ class Transport {
             , replyPayload()
             , epoch(0)
             , activities(~0)
+            , receivedTime(0)
             , outstandingRpcListHook()
         {}
 
@@ -156,6 +157,12 @@ class Transport {
         static const int READ_ACTIVITY = 1;
         static const int APPEND_ACTIVITY = 2;
 
+        /**
+         * Cycles::rdtsc time when the WorkerManager received this RPC;
+         * used to measure server-side latency (see RpcLatency).
+         */
+        uint64_t receivedTime;
+
         /**
          * Hook for the list of active server RPCs that the ServerRpcPool class
          * maintains. RPCs are added when ServerRpc-derived classes are
@@ -19,6 +19,7 @@
 #include "HomaTransport.h"
 #include "OptionParser.h"
 #include "ShortMacros.h"
+#include "ShmTransport.h"
 #include "RawMetrics.h"
 #include "TransportManager.h"
 #include "TransportFactory.h"
@@ -74,6 +75,15 @@ static struct HomaUdpTransportFactory : public TransportFactory {
     }
 } homaUdpTransportFactory;
 
+static struct ShmTransportFactory : public TransportFactory {
+    ShmTransportFactory()
+        : TransportFactory("shm") {}
+    Transport* createTransport(Context* context,
+            const ServiceLocator* localServiceLocator) {
+        return new ShmTransport(context, localServiceLocator);
+    }
+} shmTransportFactory;
+
 #ifdef ONLOAD
 static struct BasicSolarFlareTransportFactory : public TransportFactory {
     BasicSolarFlareTransportFactory()
@@ -201,6 +211,7 @@ TransportManager::TransportManager(Context* context)
     transportFactories.push_back(&tcpTransportFactory);
     transportFactories.push_back(&basicUdpTransportFactory);
     transportFactories.push_back(&homaUdpTransportFactory);
+    transportFactories.push_back(&shmTransportFactory);
 #ifdef ONLOAD
     transportFactories.push_back(&basicSolarFlareTransportFactory);
     transportFactories.push_back(&homaSolarFlareTransportFactory);
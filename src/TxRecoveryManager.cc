@@ -478,6 +478,9 @@ TxRecoveryManager::RecoveryTask::DecisionRpc::DecisionRpc(Context* context,
     reqHdr->transactionId = task->transactionId;
     reqHdr->recovered = true;
     reqHdr->participantCount = 0;
+    // The participants' prepare times aren't known here; each one stamps
+    // the writes with its own cluster time.
+    reqHdr->commitTime = 0;
     participantCount = &reqHdr->participantCount;
 }
 
@@ -162,9 +162,8 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
                                      AbstractLog::ReferenceFreer* freer,
                                      ClientLeaseValidator* leaseValidator,
                                      TabletManager* tabletManager)
-    : clients(20)
-    , mutex()
-    , default_rpclist_size(50)
+    : shards()
+    , default_rpclist_size(64)
     , context(context)
     , leaseValidator(leaseValidator)
     , cleaner(this)
@@ -178,9 +177,10 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
  */
 UnackedRpcResults::~UnackedRpcResults()
 {
-    for (ClientMap::iterator it = clients.begin(); it != clients.end(); ++it) {
-        Client* client = it->second;
-        delete client;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        foreach (ClientMap::value_type& entry, shards[i].clients) {
+            delete entry.second;
+        }
     }
 }
 
@@ -239,12 +239,11 @@ UnackedRpcResults::checkDuplicate(WireFormat::ClientLease clientLease,
                                   uint64_t ackId,
                                   void** resultPtrOut)
 {
-    Lock lock(mutex);
+    uint64_t clientId = clientLease.leaseId;
+    Lock lock(shardFor(clientId).mutex);
     *resultPtrOut = NULL;
     bool isDuplicate = false;
 
-    uint64_t clientId = clientLease.leaseId;
-
     Client* client = getOrInitClientRecord(clientId, lock);
 
     // Update lease with more up-to-date information if available to avoid
@@ -321,7 +320,7 @@ UnackedRpcResults::shouldRecover(uint64_t clientId,
                                  uint64_t ackId,
                                  LogEntryType entryType)
 {
-    Lock lock(mutex);
+    Lock lock(shardFor(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
     if (client->maxAckId < ackId)
         client->processAck(ackId, freer);
@@ -358,7 +357,7 @@ UnackedRpcResults::recordCompletion(uint64_t clientId,
                                       void* result,
                                       bool ignoreIfAcked)
 {
-    Lock lock(mutex);
+    Lock lock(shardFor(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (ignoreIfAcked && client == NULL) {
         return;
@@ -400,7 +399,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
                                  uint64_t ackId,
                                  void* result)
 {
-    Lock lock(mutex);
+    Lock lock(shardFor(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
 
     //1. Handle Ack.
@@ -432,7 +431,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
 void
 UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(shardFor(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
 
     if (client == NULL) {
@@ -442,7 +441,7 @@ UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
     // If a client cancels an RPC, the current RPC may have been acked while
     // being processed. In this case, we should not overwrite.
     if (client->maxAckId < rpcId) {
-        client->rpcs[rpcId % client->len].id = 0;
+        client->slot(rpcId).id = 0;
     }
 }
 
@@ -463,7 +462,7 @@ UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 bool
 UnackedRpcResults::isRpcAcked(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(shardFor(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (client == NULL) {
         return true;
@@ -486,7 +485,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
     : unackedRpcResults(unackedRpcResults)
     , clientId(clientId)
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->shardFor(clientId).mutex);
     // Make a new client record if it doesn't exist.
     Client* client = unackedRpcResults->getOrInitClientRecord(clientId, lock);
     ++client->doNotRemove;
@@ -498,7 +497,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
  */
 UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->shardFor(clientId).mutex);
     Client* client = unackedRpcResults->getClientRecord(clientId, lock);
     assert(client != NULL);
     --client->doNotRemove;
@@ -508,26 +507,37 @@ UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
  * Clean up stale clients who haven't communicated long.
  * Should not concurrently run this function in several threads.
  * Serialized by Cleaner inherited from WorkerTimer.
+ *
+ * Each call examines at most Cleaner::maxIterPerPeriod clients, continuing
+ * from where the previous call stopped, and releases the shard lock every
+ * Cleaner::maxIterPerLock clients so that RPCs are not held up behind a long
+ * sweep. Leases are validated without holding any lock, since that may
+ * require talking to the coordinator.
  */
 void
 UnackedRpcResults::cleanByTimeout()
 {
     vector<ClientLease> victims;
-    {
-        Lock lock(mutex);
+    victims.reserve(Cleaner::maxIterPerPeriod / 10);
 
-        // Sweep table and pick candidates.
-        victims.reserve(Cleaner::maxIterPerPeriod / 10);
+    // Sweep the shards and pick candidates.
+    int checked = 0;
+    uint32_t shardsFinished = 0;
+    while (checked < Cleaner::maxIterPerPeriod
+            && shardsFinished < NUM_SHARDS) {
+        Shard& shard = shards[cleaner.nextShardToCheck];
+        Lock lock(shard.mutex);
 
         ClientMap::iterator it;
         if (cleaner.nextClientToCheck) {
-            it = clients.find(cleaner.nextClientToCheck);
+            it = shard.clients.find(cleaner.nextClientToCheck);
         } else {
-            it = clients.begin();
+            it = shard.clients.begin();
         }
-        for (int i = 0; i < Cleaner::maxIterPerPeriod && it != clients.end();
-                        //&& victims.size() < Cleaner::maxCheckPerPeriod;
-             ++i, ++it) {
+        for (int i = 0; i < Cleaner::maxIterPerLock
+                && checked < Cleaner::maxIterPerPeriod
+                && it != shard.clients.end();
+             ++i, ++checked, ++it) {
             Client* client = it->second;
 
             ClientLease lease = {it->first,
@@ -537,8 +547,11 @@ UnackedRpcResults::cleanByTimeout()
                 victims.push_back(lease);
             }
         }
-        if (it == clients.end()) {
+        if (it == shard.clients.end()) {
             cleaner.nextClientToCheck = 0;
+            cleaner.nextShardToCheck =
+                    (cleaner.nextShardToCheck + 1) % NUM_SHARDS;
+            shardsFinished++;
         } else {
             cleaner.nextClientToCheck = it->first;
         }
@@ -547,36 +560,55 @@ UnackedRpcResults::cleanByTimeout()
     // Check with coordinator whether the lease is expired.
     // And erase entry if the lease is expired.
     for (uint32_t i = 0; i < victims.size(); ++i) {
-        Lock lock(mutex);
-        // Do not clean if this client record is protected
-        if (clients[victims[i].leaseId]->doNotRemove)
+        ClientLease lease = victims[i];
+        Shard& shard = shardFor(lease.leaseId);
+        {
+            Lock lock(shard.mutex);
+            Client* client = getClientRecord(lease.leaseId, lock);
+            // Do not clean if this client record is protected or if there
+            // are RPCs still in progress for this client.
+            if (client == NULL || client->doNotRemove
+                    || client->numRpcsInProgress)
+                continue;
+        }
+
+        bool valid = leaseValidator->validate(lease, &lease);
+
+        Lock lock(shard.mutex);
+        Client* client = getClientRecord(victims[i].leaseId, lock);
+        if (client == NULL)
             continue;
-        // Do not clean if there are RPCs still in progress for this client.
-        if (clients[victims[i].leaseId]->numRpcsInProgress)
+        if (valid) {
+            ClusterTime leaseExpiration(lease.leaseExpiration);
+            if (client->leaseExpiration < leaseExpiration) {
+                client->leaseExpiration = leaseExpiration;
+            }
             continue;
+        }
 
-        ClientLease lease = victims[i];
-        if (leaseValidator->validate(lease, &lease)) {
-            clients[victims[i].leaseId]->leaseExpiration =
-                                            ClusterTime(lease.leaseExpiration);
-        } else {
-            TabletManager::Protector tp(tabletManager);
-            if (tp.notReadyTabletExists()) {
-                // Since there is a NOT_READY tablet (eg. recovery/migration),
-                // we cannot garbage collect expired clients safely.
-                // Both RpcResult entries and participant list entry need to be
-                // recovered to make a correct GC decision, but with a tablet
-                // currently NOT_READY, it is possible to have only RpcResult
-                // recovered, not Transaction ParticipantList entry yet.
-                return;
-            }
-            // After preventing the start of tablet migration or recovery,
-            // check SingleClientProtector once more before deletion.
-            if (clients[victims[i].leaseId]->doNotRemove)
-                continue;
+        // The record may have been used while the lock was released; if so
+        // the client proved its lease was valid then, so keep the record.
+        if (client->numRpcsInProgress || ClusterTime(
+                victims[i].leaseExpiration) < client->leaseExpiration)
+            continue;
 
-            clients.erase(victims[i].leaseId);
+        TabletManager::Protector tp(tabletManager);
+        if (tp.notReadyTabletExists()) {
+            // Since there is a NOT_READY tablet (eg. recovery/migration),
+            // we cannot garbage collect expired clients safely.
+            // Both RpcResult entries and participant list entry need to be
+            // recovered to make a correct GC decision, but with a tablet
+            // currently NOT_READY, it is possible to have only RpcResult
+            // recovered, not Transaction ParticipantList entry yet.
+            return;
         }
+        // After preventing the start of tablet migration or recovery,
+        // check SingleClientProtector once more before deletion.
+        if (client->doNotRemove)
+            continue;
+
+        shard.clients.erase(victims[i].leaseId);
+        delete client;
     }
 }
 
@@ -587,6 +619,7 @@ UnackedRpcResults::cleanByTimeout()
 bool
 UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
     Client* client;
+    ClientMap& clients = shardFor(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it == clients.end()) {
         return false;
@@ -601,6 +634,21 @@ UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
     return client->hasRecord(rpcId);
 }
 
+/**
+ * Returns the number of clients with records, summed over all shards.
+ * This method is used only for unit testing.
+ */
+size_t
+UnackedRpcResults::clientCount()
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+        Lock lock(shards[i].mutex);
+        count += shards[i].clients.size();
+    }
+    return count;
+}
+
 /**
  * Constructor for the UnackedRpcResults' Cleaner.
  *
@@ -610,6 +658,7 @@ UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
 UnackedRpcResults::Cleaner::Cleaner(UnackedRpcResults* unackedRpcResults)
     : WorkerTimer(unackedRpcResults->context->dispatch)
     , unackedRpcResults(unackedRpcResults)
+    , nextShardToCheck(0)
     , nextClientToCheck(0)
 {
 }
@@ -640,7 +689,7 @@ UnackedRpcResults::Cleaner::handleTimerEvent()
  */
 bool
 UnackedRpcResults::Client::hasRecord(uint64_t rpcId) {
-    return rpcs[rpcId % len].id == rpcId;
+    return slot(rpcId).id == rpcId;
 }
 
 /**
@@ -654,8 +703,8 @@ UnackedRpcResults::Client::hasRecord(uint64_t rpcId) {
  */
 void*
 UnackedRpcResults::Client::result(uint64_t rpcId) {
-    assert(rpcs[rpcId % len].id == rpcId);
-    return rpcs[rpcId % len].result;
+    assert(slot(rpcId).id == rpcId);
+    return slot(rpcId).result;
 }
 
 /**
@@ -666,14 +715,14 @@ UnackedRpcResults::Client::result(uint64_t rpcId) {
  */
 void
 UnackedRpcResults::Client::recordNewRpc(uint64_t rpcId) {
-    if (rpcs[rpcId % len].id > maxAckId) {
-        uint64_t difference = (rpcId > rpcs[rpcId % len].id) ?
-                                rpcId - rpcs[rpcId % len].id :
-                                rpcs[rpcId % len].id - rpcId;
-        resizeRpcs(static_cast<int>(difference * 2));
+    if (slot(rpcId).id > maxAckId) {
+        uint64_t difference = (rpcId > slot(rpcId).id) ?
+                                rpcId - slot(rpcId).id :
+                                slot(rpcId).id - rpcId;
+        resizeRpcs(roundUpToPowerOfTwo(static_cast<int>(difference * 2)));
     }
-    assert(rpcs[rpcId % len].id <= maxAckId);
-    rpcs[rpcId % len] = UnackedRpc(rpcId, NULL);
+    assert(slot(rpcId).id <= maxAckId);
+    slot(rpcId) = UnackedRpc(rpcId, NULL);
 }
 
 /**
@@ -689,8 +738,8 @@ void
 UnackedRpcResults::Client::processAck(uint64_t ackId,
                                       AbstractLog::ReferenceFreer* freer) {
     for (uint64_t id = maxAckId + 1; id <= ackId; id++) {
-        if (rpcs[id % len].id == id) {
-            uint64_t resPtr = reinterpret_cast<uint64_t>(rpcs[id % len].result);
+        if (slot(id).id == id) {
+            uint64_t resPtr = reinterpret_cast<uint64_t>(slot(id).result);
             if (resPtr) {
                 Log::Reference reference(resPtr);
                 freer->freeLogEntry(reference);
@@ -715,8 +764,8 @@ UnackedRpcResults::Client::processAck(uint64_t ackId,
  */
 void
 UnackedRpcResults::Client::updateResult(uint64_t rpcId, void* result) {
-    assert(rpcs[rpcId % len].id == rpcId);
-    rpcs[rpcId % len].result = result;
+    assert(slot(rpcId).id == rpcId);
+    slot(rpcId).result = result;
 }
 
 /**
@@ -724,17 +773,19 @@ UnackedRpcResults::Client::updateResult(uint64_t rpcId, void* result) {
  * Client's rpcs is not enough to keep all valid RPCs' info.
  *
  * \param newLen
- *      The new size of the dynamic array, #Client::rpcs
+ *      The new size of the dynamic array, #Client::rpcs; must be a power
+ *      of two.
  */
 void
 UnackedRpcResults::Client::resizeRpcs(int newLen) {
+    assert((newLen & (newLen - 1)) == 0);
     UnackedRpc* to = new UnackedRpc[newLen](); //initialize with <0, NULL>
 
     for (int i = 0; i < len; ++i) {
         if (rpcs[i].id <= maxAckId)
             continue;
-        assert(to[rpcs[i].id % newLen].id == 0);
-        to[rpcs[i].id % newLen] = rpcs[i];
+        assert(to[rpcs[i].id & (newLen - 1)].id == 0);
+        to[rpcs[i].id & (newLen - 1)] = rpcs[i];
     }
     delete[] rpcs;
     rpcs = to;
@@ -747,8 +798,8 @@ UnackedRpcResults::Client::resizeRpcs(int newLen) {
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the shard
+ *      holding \a clientId. Not actually used by the method.
  * \return
  *      Pointer to the client record if one exists; NULL otherwise.
  */
@@ -756,6 +807,7 @@ UnackedRpcResults::Client*
 UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
 {
     Client* client = NULL;
+    ClientMap& clients = shardFor(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
         client = it->second;
@@ -770,8 +822,8 @@ UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the shard
+ *      holding \a clientId. Not actually used by the method.
  * \return
  *      Pointer to the existing or newly inserted client record.
  */
@@ -779,6 +831,7 @@ UnackedRpcResults::Client*
 UnackedRpcResults::getOrInitClientRecord(uint64_t clientId, Lock& lock)
 {
     Client* client = NULL;
+    ClientMap& clients = shardFor(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
         client = it->second;
@@ -790,4 +843,17 @@ UnackedRpcResults::getOrInitClientRecord(uint64_t clientId, Lock& lock)
     return client;
 }
 
+/**
+ * Returns the smallest power of two that is at least \a n (and at least 1).
+ */
+int
+UnackedRpcResults::roundUpToPowerOfTwo(int n)
+{
+    int result = 1;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
 } // namespace RAMCloud
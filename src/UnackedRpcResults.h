@@ -100,6 +100,7 @@ class UnackedRpcResults {
     void cleanByTimeout();
     /// Used only for testing.
     bool hasRecord(uint64_t clientId, uint64_t rpcId);
+    size_t clientCount();
 
     /**
      * Holds info about outstanding RPCs, which is needed to avoid re-doing
@@ -124,8 +125,9 @@ class UnackedRpcResults {
     /**
      * The Cleaner periodically wakes up to clean up records of clients with
      * expired leases in unackedRpcResults.
-     * Cleaner blocks the access to unackedRpcResults, so we limit the number
-     * of clients we clean each time.
+     * Cleaner blocks the access to the shard it is scanning, so we limit the
+     * number of clients we check each time, and how many we check while
+     * holding a shard's lock.
      */
     class Cleaner : public WorkerTimer {
       public:
@@ -135,11 +137,19 @@ class UnackedRpcResults {
         /// The pointer to unackedRpcResults which will be cleaned.
         UnackedRpcResults* unackedRpcResults;
 
-        /// Starting point of next round of cleaning.
+        /// Shard containing the starting point of next round of cleaning.
+        uint32_t nextShardToCheck;
+
+        /// Starting point of next round of cleaning (0 means the start
+        /// of #nextShardToCheck).
         uint64_t nextClientToCheck;
 
         /// The maximum number of clients we check for liveness.
         static const int maxIterPerPeriod = 1000;
+
+        /// The maximum number of clients we check while holding a shard's
+        /// lock.
+        static const int maxIterPerLock = 100;
       private:
         DISALLOW_COPY_AND_ASSIGN(Cleaner);
     };
@@ -154,17 +164,20 @@ class UnackedRpcResults {
          * Constructor for Client
          *
          * \param size
-         *      Initial size of the array which keeps UnackedRpc.
+         *      Initial size of the array which keeps UnackedRpc; must be a
+         *      power of two.
          */
         explicit Client(int size)
             : maxRpcId(0)
             , maxAckId(0)
-            , leaseExpiration()
-            , numRpcsInProgress(0)
             , rpcs(new UnackedRpc[size]())
             , len(size)
+            , numRpcsInProgress(0)
+            , leaseExpiration()
             , doNotRemove(0)
-        {}
+        {
+            assert((size & (size - 1)) == 0);
+        }
 
         ~Client() {
             delete[] rpcs;
@@ -177,6 +190,14 @@ class UnackedRpcResults {
         void processAck(uint64_t ackId, AbstractLog::ReferenceFreer* freer);
         void resizeRpcs(int newLen);
 
+        /// Returns the slot in #rpcs for \a rpcId.
+        UnackedRpc& slot(uint64_t rpcId) {
+            return rpcs[rpcId & (len - 1)];
+        }
+
+        // The fields used by every checkDuplicate() come first, so that
+        // they share a cache line.
+
         /**
          * Keeps the largest RpcId from the client seen in this master.
          * This is used to optimize checkDuplicate() in general case.
@@ -190,31 +211,17 @@ class UnackedRpcResults {
         */
         uint64_t maxAckId;
 
-        /**
-         * A cluster clock value giving a hint about when the client's
-         * lease expires (it definitely will not expire before this time,
-         * but the lease may have been extended since this value was written).
-         * Used in Cleaner for GC.
-         */
-        ClusterTime leaseExpiration;
-
-        /**
-         * The count for rpcIds in stage between checkDuplicate and
-         * recordCompletion (aka. in Progress).
-         * The count is used while cleanup to prevent removing client
-         * with rpcs in progress.
-         */
-        int numRpcsInProgress;
-
         /**
          * Dynamically allocated array keeping #UnackedRpc of this client.
          * This keeps the status of each RPC until being acknowledged.
-         * The array is initially with small size, let's say 5. Then, the info
-         * about a rpc with id = i is recorded in (i % 5)th index of the array.
+         * The array is initially with small size, let's say 4. Then, the info
+         * about a rpc with id = i is recorded in (i % 4)th index of the array.
+         * The size is always a power of two, so that the index can be
+         * computed with a mask rather than a division.
          *
          *   Example of array #Client::rpcs
-         * | index  |  0  |  1  |  2  |  3  |  4  |
-         * | rpc id |  5  | 11  |  7  |  8  |  9  |
+         * | index  |  0  |  1  |  2  |  3  |
+         * | rpc id |  8  |  5  | 10  |  7  |
          *
          * If the index (i % len), where #Client::len is the size of array, is
          * already occupied with other rpc which is not yet acknowledged, we
@@ -229,6 +236,22 @@ class UnackedRpcResults {
          */
         int len;
 
+        /**
+         * The count for rpcIds in stage between checkDuplicate and
+         * recordCompletion (aka. in Progress).
+         * The count is used while cleanup to prevent removing client
+         * with rpcs in progress.
+         */
+        int numRpcsInProgress;
+
+        /**
+         * A cluster clock value giving a hint about when the client's
+         * lease expires (it definitely will not expire before this time,
+         * but the lease may have been extended since this value was written).
+         * Used in Cleaner for GC.
+         */
+        ClusterTime leaseExpiration;
+
         /**
          * Allows other modules to disallow or allow the removal for this client
          * record from UnackedRpcResutls by incrementing or decrementing this
@@ -246,14 +269,43 @@ class UnackedRpcResults {
      * Clients are dynamically allocated and must be freed explicitly.
      */
     typedef std::unordered_map<uint64_t, Client*> ClientMap;
-    ClientMap clients;
+    typedef std::lock_guard<std::mutex> Lock;
 
     /**
-     * Monitor-style lock. Any operation on internal data structure should
-     * hold this lock.
+     * Clients are divided among shards by client id, each with its own
+     * lock, so that linearizable RPCs from different clients rarely contend.
      */
-    std::mutex mutex;
-    typedef std::lock_guard<std::mutex> Lock;
+    struct Shard {
+        Shard()
+            : mutex()
+            , clients(20)
+            , pad()
+        {}
+
+        /**
+         * Monitor-style lock. Any operation on the shard's clients (or
+         * their records) should hold this lock.
+         */
+        std::mutex mutex;
+
+        /// Clients whose ids map to this shard.
+        ClientMap clients;
+
+        /// Keeps shards' locks in different cache lines.
+        char pad[CACHE_LINE_SIZE];
+
+        DISALLOW_COPY_AND_ASSIGN(Shard);
+    };
+
+    /// Number of entries in #shards; must be a power of two.
+    static const uint32_t NUM_SHARDS = 16;
+
+    Shard shards[NUM_SHARDS];
+
+    /// Returns the shard holding the record for \a clientId.
+    Shard& shardFor(uint64_t clientId) {
+        return shards[clientId & (NUM_SHARDS - 1)];
+    }
 
     /**
      * This value is used as initial array size of each Client instance.
@@ -288,6 +340,7 @@ class UnackedRpcResults {
     // Helper methods
     Client* getClientRecord(uint64_t clientId, Lock& lock);
     Client* getOrInitClientRecord(uint64_t clientId, Lock& lock);
+    static int roundUpToPowerOfTwo(int n);
 
     DISALLOW_COPY_AND_ASSIGN(UnackedRpcResults);
 };
@@ -119,11 +119,11 @@ TEST_F(UnackedRpcResultsTest, checkDuplicate_basic) {
                  StaleRpcException);
 
     //3. Fast-path new RPC (rpcId > maxRpcId == true).
-    EXPECT_EQ(10UL, results.clients[1]->maxRpcId);
+    EXPECT_EQ(10UL, results.shardFor(1).clients[1]->maxRpcId);
     EXPECT_FALSE(results.checkDuplicate(clientLease, 11, 6, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
-    EXPECT_EQ(11UL, results.clients[1]->maxRpcId);
-    EXPECT_EQ(6UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(11UL, results.shardFor(1).clients[1]->maxRpcId);
+    EXPECT_EQ(6UL, results.shardFor(1).clients[1]->maxAckId);
 
     EXPECT_TRUE(results.checkDuplicate(clientLease, 11, 6, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
@@ -131,12 +131,12 @@ TEST_F(UnackedRpcResultsTest, checkDuplicate_basic) {
     //4. Duplicate RPC.
     EXPECT_TRUE(results.checkDuplicate(clientLease, 10, 6, &result));
     EXPECT_EQ(1010UL, (uint64_t)result);
-    EXPECT_EQ(6UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(6UL, results.shardFor(1).clients[1]->maxAckId);
 
     //5. Inside the window and new RPC.
     EXPECT_FALSE(results.checkDuplicate(clientLease, 9, 7, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
-    EXPECT_EQ(7UL, results.clients[1]->maxAckId);
+    EXPECT_EQ(7UL, results.shardFor(1).clients[1]->maxAckId);
 
     EXPECT_TRUE(results.checkDuplicate(clientLease, 9, 7, &result));
     EXPECT_EQ(0UL, (uint64_t)result);
@@ -180,8 +180,8 @@ TEST_F(UnackedRpcResultsTest, shouldRecover) {
     EXPECT_TRUE(results.shouldRecover(2, 4, 2, LOG_ENTRY_TYPE_RPCRESULT));
     // ^ ClientId = 2 inserted.
     std::unordered_map<uint64_t, UnackedRpcResults::Client*>::iterator it;
-    it = results.clients.find(2);
-    EXPECT_NE(it, results.clients.end());
+    it = results.shardFor(2).clients.find(2);
+    EXPECT_NE(it, results.shardFor(2).clients.end());
 
     //Ack update
     UnackedRpcResults::Client* client = it->second;
@@ -217,12 +217,12 @@ TEST_F(UnackedRpcResultsTest, recordCompletion) {
     results.recordCompletion(1, 4, reinterpret_cast<void*>(1012), true);
     results.recordCompletion(10, 1, reinterpret_cast<void*>(1012), true);
 
-    EXPECT_EQ(16UL, results.clients[1]->maxRpcId);
-    EXPECT_EQ(50, results.clients[1]->len);
+    EXPECT_EQ(16UL, results.shardFor(1).clients[1]->maxRpcId);
+    EXPECT_EQ(64, results.shardFor(1).clients[1]->len);
 
     //Resized Client keeps the original data.
     results.checkDuplicate(clientLease, 17, 5, &result);
-    EXPECT_EQ(50, results.clients[1]->len);
+    EXPECT_EQ(64, results.shardFor(1).clients[1]->len);
     for (int i = 12; i <= 16; ++i) {
         EXPECT_TRUE(results.checkDuplicate(clientLease, i, 5, &result));
         EXPECT_EQ((uint64_t)(i + 1000), (uint64_t)result);
@@ -258,15 +258,16 @@ TEST_F(UnackedRpcResultsTest, recoverRecord) {
     void* result;
     uint64_t leaseId = 10;
 
-    UnackedRpcResults::ClientMap::iterator it = results.clients.find(leaseId);
-    EXPECT_TRUE(it == results.clients.end());
+    UnackedRpcResults::ClientMap::iterator it =
+            results.shardFor(leaseId).clients.find(leaseId);
+    EXPECT_TRUE(it == results.shardFor(leaseId).clients.end());
 
     // New Record w/ rpcId or ackId updates.
 
     results.recoverRecord(leaseId, 20, 10, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
+    it = results.shardFor(leaseId).clients.find(leaseId);
+    EXPECT_FALSE(it == results.shardFor(leaseId).clients.end());
     EXPECT_EQ(10U, it->second->maxAckId);
     EXPECT_EQ(20U, it->second->maxRpcId);
     EXPECT_TRUE(it->second->hasRecord(20));
@@ -276,8 +277,8 @@ TEST_F(UnackedRpcResultsTest, recoverRecord) {
 
     results.recoverRecord(leaseId, 15, 5, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
+    it = results.shardFor(leaseId).clients.find(leaseId);
+    EXPECT_FALSE(it == results.shardFor(leaseId).clients.end());
     EXPECT_EQ(10U, it->second->maxAckId);
     EXPECT_EQ(20U, it->second->maxRpcId);
     EXPECT_TRUE(it->second->hasRecord(15));
@@ -287,8 +288,8 @@ TEST_F(UnackedRpcResultsTest, recoverRecord) {
 
     results.recoverRecord(leaseId, 5, 1, &result);
 
-    it = results.clients.find(leaseId);
-    EXPECT_FALSE(it == results.clients.end());
+    it = results.shardFor(leaseId).clients.find(leaseId);
+    EXPECT_FALSE(it == results.shardFor(leaseId).clients.end());
     EXPECT_FALSE(it->second->hasRecord(5));
 
     // Duplicate record.
@@ -369,14 +370,14 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     void* result;
     ClientLease clientLease = {0, 0, 0};
     results.cleanByTimeout();
-    EXPECT_EQ(1U, results.clients.size());
+    EXPECT_EQ(1U, results.clientCount());
     clientLease = {2, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
 
     results.cleanByTimeout();
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.clientCount());
 
     TestLog::Enable _;
     TestLog::reset();
@@ -388,12 +389,12 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     service->clusterClock.updateClock(ClusterTime(2));
 
     results.cleanByTimeout();
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.clientCount());
 
     //Complete in progress rpcs and try cleanup again.
     results.recordCompletion(3, 10, &result);
     results.cleanByTimeout();
-    EXPECT_EQ(1U, results.clients.size());
+    EXPECT_EQ(1U, results.clientCount());
 
     EXPECT_EQ(ClusterTime(2U), service->clusterClock.getTime());
 
@@ -405,9 +406,9 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_basic) {
     clientLease = {realLease.leaseId, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(realLease.leaseId, 10, &result);
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.clientCount());
     results.cleanByTimeout();
-    EXPECT_EQ(2U, results.clients.size());
+    EXPECT_EQ(2U, results.clientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
@@ -420,7 +421,7 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(3, 10, &result);
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.clientCount());
 
     service->clusterClock.updateClock(ClusterTime(2));
 
@@ -428,13 +429,14 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_client_doNotRemove) {
         // With prevent client 2 from being cleaned.
         UnackedRpcResults::SingleClientProtector _(&results, 2);
         results.cleanByTimeout();
-        EXPECT_EQ(1U, results.clients.size());
-        EXPECT_TRUE(results.clients.find(2) != results.clients.end());
+        EXPECT_EQ(1U, results.clientCount());
+        EXPECT_TRUE(results.shardFor(2).clients.find(2) !=
+                    results.shardFor(2).clients.end());
     }
 
     // Without the KeepClientRecord object, everything should be cleaned.
     results.cleanByTimeout();
-    EXPECT_EQ(0U, results.clients.size());
+    EXPECT_EQ(0U, results.clientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, cleanByTimeout_TabletIsLoadingState) {
@@ -447,33 +449,78 @@ TEST_F(UnackedRpcResultsTest, cleanByTimeout_TabletIsLoadingState) {
     clientLease = {3, 1, 0};
     results.checkDuplicate(clientLease, 10, 5, &result);
     results.recordCompletion(3, 10, &result);
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.clientCount());
 
     service->clusterClock.updateClock(ClusterTime(2));
 
     // With a NOT_READY tablet, nothing should be cleaned.
     tabletManager.addTablet(0, 10, 20, TabletManager::NOT_READY);
     results.cleanByTimeout();
-    EXPECT_EQ(3U, results.clients.size());
+    EXPECT_EQ(3U, results.clientCount());
 
     // After deleting NOT_READY tablet, everything should be cleaned.
     tabletManager.deleteTablet(0, 10, 20);
     results.cleanByTimeout();
-    EXPECT_EQ(0U, results.clients.size());
+    EXPECT_EQ(0U, results.clientCount());
+}
+
+TEST_F(UnackedRpcResultsTest, cleanByTimeout_allShards) {
+    void* result;
+    for (uint64_t id = 2; id < 2 + 3 * UnackedRpcResults::NUM_SHARDS; ++id) {
+        ClientLease clientLease = {id, 1, 0};
+        results.checkDuplicate(clientLease, 10, 5, &result);
+        results.recordCompletion(id, 10, &result);
+    }
+    EXPECT_EQ(49U, results.clientCount());
+    EXPECT_EQ(4U, results.shards[1].clients.size());
+
+    service->clusterClock.updateClock(ClusterTime(2));
+
+    // A single pass starting mid-way wraps around to cover every shard.
+    results.cleaner.nextShardToCheck = 5;
+    results.cleanByTimeout();
+    EXPECT_EQ(0U, results.clientCount());
+    EXPECT_EQ(5U, results.cleaner.nextShardToCheck);
+    EXPECT_EQ(0U, results.cleaner.nextClientToCheck);
+}
+
+TEST_F(UnackedRpcResultsTest, cleanByTimeout_incremental) {
+    // Fill shard 0 with more protected clients than one pass examines.
+    int count = UnackedRpcResults::Cleaner::maxIterPerPeriod + 10;
+    for (int i = 1; i <= count; ++i) {
+        uint64_t id = i * UnackedRpcResults::NUM_SHARDS;
+        UnackedRpcResults::Client* client =
+                new UnackedRpcResults::Client(results.default_rpclist_size);
+        client->doNotRemove = 1;
+        results.shardFor(id).clients[id] = client;
+    }
+
+    results.cleanByTimeout();
+    EXPECT_EQ(0U, results.cleaner.nextShardToCheck);
+    uint64_t next = results.cleaner.nextClientToCheck;
+    EXPECT_NE(0U, next);
+    EXPECT_EQ(0U, next % UnackedRpcResults::NUM_SHARDS);
+
+    // The next pass picks up where the last one stopped and finishes the
+    // round through the other shards.
+    results.cleanByTimeout();
+    EXPECT_EQ(0U, results.cleaner.nextShardToCheck);
+    EXPECT_EQ(0U, results.cleaner.nextClientToCheck);
+    EXPECT_EQ(count + 1U, results.clientCount());
 }
 
 TEST_F(UnackedRpcResultsTest, hasRecord) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = results.shardFor(1).clients[1];
     EXPECT_TRUE(client->hasRecord(10));
 }
 
 TEST_F(UnackedRpcResultsTest, result) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = results.shardFor(1).clients[1];
     EXPECT_EQ(1010UL, (uint64_t)client->result(10));
 }
 
 TEST_F(UnackedRpcResultsTest, recordNewRpc) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = results.shardFor(1).clients[1];
     client->recordNewRpc(11);
     EXPECT_TRUE(client->hasRecord(11));
 
@@ -492,7 +539,7 @@ TEST_F(UnackedRpcResultsTest, recordNewRpc) {
 }
 
 TEST_F(UnackedRpcResultsTest, recordNewRpc_jumResizeTest) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = results.shardFor(1).clients[1];
     uint64_t rpcId1 = 11;
     client->recordNewRpc(rpcId1);
     EXPECT_TRUE(client->hasRecord(rpcId1));
@@ -532,7 +579,7 @@ TEST_F(UnackedRpcResultsTest, resetRecord) {
 }
 
 TEST_F(UnackedRpcResultsTest, updateResult) {
-    UnackedRpcResults::Client *client = results.clients[1];
+    UnackedRpcResults::Client *client = results.shardFor(1).clients[1];
     EXPECT_EQ(1010UL, (uint64_t)client->result(10));
     client->updateResult(10, reinterpret_cast<void*>(1099));
     EXPECT_EQ(1099UL, (uint64_t)client->result(10));
@@ -544,19 +591,19 @@ TEST_F(UnackedRpcResultsTest, updateResult) {
 }
 
 TEST_F(UnackedRpcResultsTest, getClientRecord) {
-    UnackedRpcResults::Lock lock(results.mutex);
+    UnackedRpcResults::Lock lock(results.shardFor(42).mutex);
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == NULL);
 
     UnackedRpcResults::Client* client =
             new UnackedRpcResults::Client(results.default_rpclist_size);
-    results.clients[42] = client;
+    results.shardFor(42).clients[42] = client;
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == client);
 }
 
 TEST_F(UnackedRpcResultsTest, getOrInitClientRecord) {
-    UnackedRpcResults::Lock lock(results.mutex);
+    UnackedRpcResults::Lock lock(results.shardFor(42).mutex);
 
     EXPECT_TRUE(results.getClientRecord(42, lock) == NULL);
 
@@ -122,6 +122,11 @@ opcodeSymbol(uint32_t opcode)
         case TX_REQUEST_ABORT:             return "TX_REQUEST_ABORT";
         case TX_HINT_FAILED:               return "TX_HINT_FAILED";
         case ECHO:                         return "ECHO";
+        case EXPORT_SNAPSHOT:              return "EXPORT_SNAPSHOT";
+        case IMPORT_SNAPSHOT:              return "IMPORT_SNAPSHOT";
+        case BULK_LOAD:                    return "BULK_LOAD";
+        case RELAY_SERVER_LIST:            return "RELAY_SERVER_LIST";
+        case READ_SNAPSHOT:                return "READ_SNAPSHOT";
         case ILLEGAL_RPC_TYPE:             return "ILLEGAL_RPC_TYPE";
     }
 
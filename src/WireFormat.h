@@ -130,7 +130,12 @@ enum Opcode {
     TX_REQUEST_ABORT            = 78,
     TX_HINT_FAILED              = 79,
     ECHO                        = 80,
-    ILLEGAL_RPC_TYPE            = 81, // 1 + the highest legitimate Opcode
+    EXPORT_SNAPSHOT             = 81,
+    IMPORT_SNAPSHOT             = 82,
+    BULK_LOAD                   = 83,
+    RELAY_SERVER_LIST           = 84,
+    READ_SNAPSHOT               = 85,
+    ILLEGAL_RPC_TYPE            = 86, // 1 + the highest legitimate Opcode
 };
 
 /**
@@ -152,6 +157,8 @@ enum ControlOp {
     LOG_MESSAGE                 = 1010,
     RESET_METRICS               = 1011,
     QUIESCE                     = 1012,
+    GET_PERF_STATS_HISTORY      = 1013,
+    GET_RPC_PHASE_HISTOGRAMS    = 1014,
 };
 
 /**
@@ -447,6 +454,34 @@ struct BackupWrite {
     } __attribute__((packed));
 };
 
+struct BulkLoad {
+    static const Opcode opcode = BULK_LOAD;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        Request()
+            : common()
+            , tableId()
+            , firstKeyHash()
+            , lastKeyHash()
+            , segmentBytes()
+            , certificate()
+        {}
+        RequestCommon common;
+        uint64_t tableId;
+        uint64_t firstKeyHash;      // Range of key hashes of the objects in
+        uint64_t lastKeyHash;       // the segment (the sender's view of the
+                                    // tablet containing them).
+        uint32_t segmentBytes;      // Length of the segment, which follows
+                                    // immediately after this header.
+        SegmentCertificate certificate; // Used to check the integrity of
+                                    // the segment.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t objectCount;       // Number of objects in the segment.
+    } __attribute__((packed));
+};
+
 struct CoordSplitAndMigrateIndexlet {
     static const Opcode opcode = COORD_SPLIT_AND_MIGRATE_INDEXLET;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -625,6 +660,10 @@ struct Enumerate {
                                     // actual iterator follows
                                     // immediately after this header.
                                     // See EnumerationIterator.
+        uint32_t filterBytes;       // Size of the filter in bytes; the
+                                    // filter follows the iterator. 0
+                                    // means return all objects. See
+                                    // EnumerationFilter.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -642,6 +681,30 @@ struct Enumerate {
     } __attribute__((packed));
 };
 
+struct ExportSnapshot {
+    static const Opcode opcode = EXPORT_SNAPSHOT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint64_t keyHash;           // The tablet containing this key hash
+                                    // is exported.
+        uint32_t pathLength;        // Length of the snapshot file name,
+                                    // including terminating NULL. The name
+                                    // follows immediately after this header.
+        uint32_t basePathLength;    // Length of the base snapshot's file
+                                    // name (including terminating NULL),
+                                    // which follows the file name; 0 means
+                                    // write a full snapshot.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t firstKeyHash;      // Range of key hashes in the snapshot.
+        uint64_t lastKeyHash;
+        uint64_t objectCount;       // Number of objects in the file.
+    } __attribute__((packed));
+};
+
 struct FillWithTestData {
     static const Opcode opcode = FILL_WITH_TEST_DATA;
     static const ServiceType service = MASTER_SERVICE;
@@ -841,9 +904,18 @@ struct GetTableConfig {
     struct Request {
         RequestCommon common;
         uint64_t tableId;
+        uint64_t knownVersion;     // If nonzero, the caller already has the
+                                   // configuration with this version; the
+                                   // coordinator will not send it again
+                                   // unless it has changed.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
+        uint64_t version;          // Version of the table's current
+                                   // configuration (0 means the caller
+                                   // shouldn't hold on to it). If this
+                                   // equals knownVersion, the configuration
+                                   // is omitted.
         uint32_t tableConfigLength;  // Number of bytes in the tablet map.
                                    // The bytes of the tablet map follow
                                    // immediately after this header. See
@@ -864,6 +936,24 @@ struct HintServerCrashed {
     } __attribute__((packed));
 };
 
+struct ImportSnapshot {
+    static const Opcode opcode = IMPORT_SNAPSHOT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint64_t keyHash;           // Any key hash in the snapshot; used
+                                    // to route the request.
+        uint32_t pathLength;        // Length of the snapshot file name,
+                                    // including terminating NULL. The name
+                                    // follows immediately after this header.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t objectCount;       // Number of objects in the file.
+    } __attribute__((packed));
+};
+
 struct Increment {
     static const Opcode opcode = INCREMENT;
     static const ServiceType service = MASTER_SERVICE;
@@ -1254,6 +1344,9 @@ struct Read {
                                       // The actual key follows
                                       // immediately after this header.
         RejectRules rejectRules;
+        uint8_t allowDegraded;        // Nonzero means the read may be served
+                                      // by a recovery master from the data
+                                      // it has replayed so far.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1261,6 +1354,9 @@ struct Read {
         uint32_t length;              // Length of the object's value in bytes.
                                       // The actual bytes of the object follow
                                       // immediately after this header.
+        uint8_t degraded;             // Nonzero means the tablet was still
+                                      // being recovered, so a newer version
+                                      // of the object may exist.
     } __attribute__((packed));
 };
 
@@ -1285,6 +1381,28 @@ struct ReadKeysAndValue {
     } __attribute__((packed));
 };
 
+struct ReadSnapshot {
+    static const Opcode opcode = READ_SNAPSHOT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint16_t keyLength;           // Length of the key in bytes.
+                                      // The actual key follows
+                                      // immediately after this header.
+        uint64_t snapshotTime;        // Encoded ClusterTime of the snapshot
+                                      // to read the object from.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t version;
+        uint32_t length;              // Length of the object's keys and value
+                                      // as defined in Object.h in bytes.
+                                      // The actual bytes of the object follow
+                                      // immediately after this header.
+    } __attribute__((packed));
+};
+
 struct ReassignTabletOwnership {
     static const Opcode opcode = REASSIGN_TABLET_OWNERSHIP;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -1405,6 +1523,35 @@ struct RecoveryMasterFinished {
     } __attribute__((packed));
 };
 
+struct RelayServerList {
+    static const Opcode opcode = RELAY_SERVER_LIST;
+    static const ServiceType service = ADMIN_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint32_t relayCount;          // Number of servers to which the
+                                      // recipient should forward the server
+                                      // lists. Their ids (uint64_t each)
+                                      // follow this header, and after them
+                                      // come the server lists, in the same
+                                      // format as for UpdateServerList.
+        uint64_t timeoutNanoseconds;  // Forwarded RPCs that haven't completed
+                                      // within this many nanoseconds are
+                                      // abandoned.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t currentVersion;      // The server list version number of the
+                                      // RPC recipient, after processing this
+                                      // request (must come first, as in
+                                      // UpdateServerList::Response).
+        uint32_t relayCount;          // Number of versions that follow this
+                                      // header (uint64_t each), one for each
+                                      // server in the request: the server's
+                                      // version after receiving the lists,
+                                      // or 0 if it couldn't be reached.
+    } __attribute__((packed));
+};
+
 struct Remove {
     static const Opcode opcode = REMOVE;
     static const ServiceType service = MASTER_SERVICE;
@@ -1714,6 +1861,10 @@ struct TxDecision {
                                     // been recovered.
         uint32_t participantCount;  // Number of local objects participating TX
                                     // for this server.
+        uint64_t commitTime;        // Encoded ClusterTime at which a committed
+                                    // transaction's writes become visible to
+                                    // snapshot reads; 0 means the recipient's
+                                    // current cluster time.
         // List of local Participants
     } __attribute__((packed));
 
@@ -1838,6 +1989,10 @@ struct TxPrepare {
     struct Response {
         ResponseCommon common;
         Vote vote;
+        uint64_t clusterTime;       // Encoded ClusterTime of the participant
+                                    // once the operations were prepared; the
+                                    // transaction's commit time must not be
+                                    // earlier than this.
     } __attribute__((packed));
 };
 
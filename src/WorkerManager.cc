@@ -23,10 +23,12 @@
 #include "MasterService.h"
 #include "PerfStats.h"
 #include "RawMetrics.h"
+#include "RpcLatency.h"
 #include "RpcLevel.h"
 #include "ShortMacros.h"
 #include "ServerRpcPool.h"
 #include "TimeTrace.h"
+#include "RpcPhaseTrace.h"
 #include "WireFormat.h"
 #include "WorkerManager.h"
 
@@ -199,8 +201,11 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
         return;
     }
 
+    rpc->receivedTime = Cycles::rdtsc();
     int level = RpcLevel::getLevel(WireFormat::Opcode(header->opcode));
     timeTrace("handleRpc processing opcode %d", header->opcode);
+    RpcPhaseTrace::record(reinterpret_cast<uint64_t>(rpc), header->opcode,
+            RpcPhaseTrace::DISPATCH_RECEIVE, RpcPhaseTrace::START);
 #ifdef LOG_RPCS
     LOG(NOTICE, "Received %s RPC at %lu with %u bytes",
             WireFormat::opcodeSymbol(header->opcode),
@@ -295,6 +300,7 @@ WorkerManager::poll()
         // there may be an RPC that we have to respond to. Save the RPC
         // information for now.
         Transport::ServerRpc* rpc = worker->rpc;
+        WireFormat::Opcode opcode = worker->opcode;
         worker->rpc = NULL;
 
         // Highest priority: if there are pending requests that are waiting
@@ -328,8 +334,13 @@ WorkerManager::poll()
                     }
                     rpcsWaiting--;
                     level->requestsRunning++;
+                    Transport::ServerRpc* waitingRpc =
+                            level->waitingRpcs.front();
+                    worker->opcode = WireFormat::Opcode(waitingRpc->
+                            requestPayload.getStart<WireFormat::RequestCommon>()
+                            ->opcode);
                     worker->level = i;
-                    worker->handoff(level->waitingRpcs.front());
+                    worker->handoff(waitingRpc);
                     level->waitingRpcs.pop();
                     startedNewRpc = true;
                     break;
@@ -345,9 +356,15 @@ WorkerManager::poll()
                     reinterpret_cast<uint64_t>(rpc),
                     rpc->replyPayload.size());
 #endif
+            // The RPC may be freed by sendReply.
+            uint64_t receivedTime = rpc->receivedTime;
             rpc->sendReply();
+            RpcPhaseTrace::record(reinterpret_cast<uint64_t>(rpc), opcode,
+                    RpcPhaseTrace::RESPONSE_SEND, RpcPhaseTrace::END);
+            RpcLatency::record(opcode, RpcLatency::TOTAL,
+                    Cycles::rdtsc() - receivedTime);
             timeTrace("sent reply for opcode %d, thread %d",
-                    worker->threadId, worker->opcode);
+                    opcode, worker->threadId);
 
         }
 
@@ -456,13 +473,29 @@ WorkerManager::workerMain(Worker* worker)
                 break;
             timeTrace("worker thread %d received opcode %d", worker->threadId,
                     worker->opcode);
+            uint64_t rpcId = reinterpret_cast<uint64_t>(worker->rpc);
+            WireFormat::Opcode opcode = worker->opcode;
+            RpcPhaseTrace::record(rpcId, opcode,
+                    RpcPhaseTrace::WORKER_HANDOFF, RpcPhaseTrace::END);
+            RpcPhaseTrace::setCurrentRpc(rpcId, opcode);
+            uint64_t serviceStart = Cycles::rdtsc();
+            RpcLatency::record(opcode, RpcLatency::QUEUE_WAIT,
+                    serviceStart - worker->rpc->receivedTime);
 
             worker->rpc->epoch = LogProtector::getCurrentEpoch();
             Service::Rpc rpc(worker, &worker->rpc->requestPayload,
                     &worker->rpc->replyPayload);
             Service::handleRpc(worker->context, &rpc);
-
-            // Pass the RPC back to the dispatch thread for completion.
+            RpcPhaseTrace::setCurrentRpc(0, 0);
+            RpcLatency::record(opcode, RpcLatency::SERVICE,
+                    Cycles::rdtsc() - serviceStart);
+
+            // Pass the RPC back to the dispatch thread for completion
+            // (unless sendReply has done that already).
+            if (!worker->replySent()) {
+                RpcPhaseTrace::record(rpcId, opcode,
+                        RpcPhaseTrace::RESPONSE_SEND, RpcPhaseTrace::START);
+            }
             Fence::leave();
             worker->state.store(Worker::POLLING);
             timeTrace("worker thread %d completed opcode %d; "
@@ -530,6 +563,12 @@ Worker::handoff(Transport::ServerRpc* newRpc)
 {
     assert(rpc == NULL);
     rpc = newRpc;
+    if (rpc != WORKER_EXIT) {
+        RpcPhaseTrace::record(reinterpret_cast<uint64_t>(rpc), opcode,
+                RpcPhaseTrace::DISPATCH_RECEIVE, RpcPhaseTrace::END);
+        RpcPhaseTrace::record(reinterpret_cast<uint64_t>(rpc), opcode,
+                RpcPhaseTrace::WORKER_HANDOFF, RpcPhaseTrace::START);
+    }
     Fence::leave();
 #ifdef SMTT
     if (rpc != WORKER_EXIT) {
@@ -564,6 +603,8 @@ Worker::handoff(Transport::ServerRpc* newRpc)
 void
 Worker::sendReply()
 {
+    RpcPhaseTrace::record(reinterpret_cast<uint64_t>(rpc), opcode,
+            RpcPhaseTrace::RESPONSE_SEND, RpcPhaseTrace::START);
     Fence::leave();
     state.store(POSTPROCESSING);
     WorkerManager::timeTrace("worker thread %d postprocesing opcode %d; "
@@ -18,7 +18,10 @@
 #include "MockService.h"
 #include "MockSyscall.h"
 #include "MockTransport.h"
+#include "RpcLatency.h"
 #include "RpcLevel.h"
+#include "RpcPhaseTrace.h"
+#include "ServerStatistics.pb.h"
 #include "Tub.h"
 #include "WorkerManager.h"
 
@@ -106,6 +109,62 @@ TEST_F(WorkerManagerTest, sanityCheck) {
     EXPECT_EQ("serverReply: 0x10001 4 5", transport.outputLog);
 }
 
+TEST_F(WorkerManagerTest, sanityCheck_rpcPhaseTrace) {
+    RpcPhaseTrace::reset();
+    RpcPhaseTrace::start(0);
+    MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
+            &transport, "0x10000 3 4");
+    manager->handleRpc(rpc);
+    for (int i = 0; i < 1000; i++) {
+        context.dispatch->poll();
+        if (!transport.outputLog.empty())
+            break;
+        usleep(1000);
+    }
+    RpcPhaseTrace::stop();
+
+    // Give the trace points time to settle (see RpcPhaseTrace::drain).
+    usleep(2000);
+    ProtoBuf::RpcPhaseHistograms histograms;
+    RpcPhaseTrace::serialize(&histograms);
+    string phases;
+    foreach (const ProtoBuf::RpcPhaseHistograms::Entry& entry,
+            histograms.entry()) {
+        phases += format("%s%s: %lu", phases.empty() ? "" : ", ",
+                RpcPhaseTrace::phaseName(entry.phase()),
+                Histogram(entry.histogram()).getTotalSamples());
+    }
+    EXPECT_EQ("dispatch receive: 1, worker handoff: 1, response send: 1",
+            phases);
+    RpcPhaseTrace::reset();
+}
+
+TEST_F(WorkerManagerTest, sanityCheck_rpcLatency) {
+    RpcLatency::reset();
+    MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
+            &transport, "0x10000 3 4");
+    manager->handleRpc(rpc);
+    for (int i = 0; i < 1000; i++) {
+        context.dispatch->poll();
+        if (!transport.outputLog.empty())
+            break;
+        usleep(1000);
+    }
+    EXPECT_EQ("serverReply: 0x10001 4 5", transport.outputLog);
+
+    ProtoBuf::ServerStatistics serverStats;
+    RpcLatency::getStatistics(&serverStats);
+    string metrics;
+    foreach (const ProtoBuf::ServerStatistics::RpcLatency& latency,
+            serverStats.rpc_latency()) {
+        metrics += format("%s%u %s: %lu", metrics.empty() ? "" : ", ",
+                latency.opcode(), RpcLatency::metricName(latency.metric()),
+                latency.count());
+    }
+    EXPECT_EQ("0 queueWait: 1, 0 service: 1, 0 total: 1", metrics);
+    RpcLatency::reset();
+}
+
 TEST_F(WorkerManagerTest, constructor) {
     EXPECT_EQ(5U, manager->idleThreads.size());
     EXPECT_EQ(4U, manager->levels.size());